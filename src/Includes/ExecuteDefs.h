@@ -141,6 +141,26 @@ public:
 	 *	返回值		是否注册成功
 	 */
 	virtual bool		registerTimer(const char* stdCode, uint32_t elapse){ return false; }
+
+	/*
+	 *	注册一次性的定时事件
+	 *	执行器统一用时间轮管理,到期以后回调执行单元的on_timer
+	 *	执行单元不需要再在on_tick里轮询超时订单和发单时间,没有行情的合约也能按时触发
+	 *	@stdCode	合约代码
+	 *	@delay		延迟时间,单位毫秒
+	 *	@tag		事件标记,回调on_timer的时候原样传回
+	 *
+	 *	返回值		定时器id,返回0说明执行器不支持定时器,执行单元需要自己轮询
+	 */
+	virtual uint64_t	scheduleTimer(const char* stdCode, uint32_t delay, uint32_t tag) { return 0; }
+
+	/*
+	 *	撤销定时事件
+	 *	@timerid	scheduleTimer返回的定时器id
+	 *
+	 *	返回值		定时器是否还在等待中
+	 */
+	virtual bool		cancelTimer(uint64_t timerid) { return false; }
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -229,6 +249,13 @@ public:
 	 */
 	virtual void on_account(const char* currency, double prebalance, double balance, double dynbalance, double avaliable, double closeprofit, double dynprofit, double margin, double fee, double deposit, double withdraw) {}
 
+	/*
+	 *	定时事件回调,由ExecuteContext::scheduleTimer注册
+	 *	stdCode	合约代码
+	 *	tag		注册时传入的事件标记
+	 */
+	virtual void on_timer(const char* stdCode, uint32_t tag) {}
+
 protected:
 	ExecuteContext*	_ctx;
 	std::string		_code;
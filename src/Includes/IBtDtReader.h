@@ -49,6 +49,12 @@ public:
 	virtual bool read_raw_order_queues(const char* exchg, const char* code, uint32_t uDate, std::string& buffer) { return false; }
 	virtual bool read_raw_transactions(const char* exchg, const char* code, uint32_t uDate, std::string& buffer) { return false; }
 
+	/*
+	 *	@brief	读取接口能否被多个线程同时调用
+	 *	@details 回测的预读线程和回放线程会同时读取,不可重入的读取模块由调用方加锁排队
+	 */
+	virtual bool is_reentrant() { return false; }
+
 protected:
 	IBtDtReaderSink*	_sink;
 };
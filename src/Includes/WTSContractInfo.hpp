@@ -302,6 +302,13 @@ public:
 	inline uint32_t getTotalIndex() const noexcept { return m_uTotalIdx; }
 
 	inline void setExtData(void* pExtData) noexcept { m_pExtData = pExtData; }
+
+	/*
+	 *	标准代码在加载合约的时候就算好,收到行情的时候不用再每次拼一遍
+	 *	没有设置的时候为空,调用方要自己处理
+	 */
+	inline void setStdCode(const char* stdCode) { m_strStdCode = stdCode; }
+	inline const char* getStdCode() const { return m_strStdCode.c_str(); }
 	template<typename T>
 	inline T*	getExtData() noexcept { return static_cast<T*>(m_pExtData); }
 
@@ -320,6 +327,7 @@ private:
 
 	std::string m_strFullPid;
 	std::string m_strFullCode;
+	std::string m_strStdCode;	//标准代码,如SHFE.rb.2401
 
 	uint32_t	m_maxMktQty;
 	uint32_t	m_maxLmtQty;
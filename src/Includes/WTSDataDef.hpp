@@ -21,6 +21,10 @@
 #include "WTSStruct.h"
 #include "WTSCollection.hpp"
 
+#ifdef WT_TICK_TRACE
+#include "../Share/WtTickTrace.hpp"
+#endif
+
 using namespace std;
 
 #pragma warning(disable:4267)
@@ -868,6 +872,9 @@ public:
 		auto len = strlen(stdCode);
 		memcpy(pRet->m_tickStruct.code, stdCode, len);
 		pRet->m_tickStruct.code[len] = 0;
+#ifdef WT_TICK_TRACE
+		pRet->m_trace.reset();
+#endif
 
 		return pRet;
 	}
@@ -880,6 +887,9 @@ public:
 	{
 		WTSTickData* pRet = allocate();
 		memcpy(&pRet->m_tickStruct, &tickData, sizeof(WTSTickStruct));
+#ifdef WT_TICK_TRACE
+		pRet->m_trace.reset();
+#endif
 
 		return pRet;
 	}
@@ -1012,9 +1022,19 @@ public:
 	inline void setContractInfo(WTSContractInfo* cInfo) { m_pContract = cInfo; }
 	inline WTSContractInfo* getContractInfo() const { return m_pContract; }
 
+#ifdef WT_TICK_TRACE
+	/*
+	 *	全链路耗时跟踪的时间戳
+	 */
+	inline TickTrace& trace() { return m_trace; }
+#endif
+
 private:
 	WTSTickStruct		m_tickStruct;
 	WTSContractInfo*	m_pContract;
+#ifdef WT_TICK_TRACE
+	TickTrace			m_trace;
+#endif
 };
 
 class WTSOrdQueData : public WTSObject
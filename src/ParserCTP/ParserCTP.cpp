@@ -18,6 +18,7 @@
 #include "../Share/ModuleHelper.hpp"
 #include "../Share/TimeUtils.hpp"
 #include "../Share/StdUtils.hpp"
+#include "../Share/WtTickTrace.hpp"
 
 #include <boost/filesystem.hpp>
 
@@ -232,14 +233,18 @@ void ParserCTP::OnRspUnSubMarketData( CThostFtdcSpecificInstrumentField *pSpecif
 
 void ParserCTP::OnRtnDepthMarketData( CThostFtdcDepthMarketDataField *pDepthMarketData )
 {	
+	//收到行情的时间,要在任何处理之前记录
+	WT_TRACE_NOW(tsRecv);
+
 	if(m_pBaseDataMgr == NULL)
 	{
 		return;
 	}
 
-    WTSContractInfo* contract = m_pBaseDataMgr->getContract(pDepthMarketData->InstrumentID, pDepthMarketData->ExchangeID);
-    if (contract == NULL)
-        return;
+	const CodeMeta& meta = getCodeMeta(pDepthMarketData->InstrumentID, pDepthMarketData->ExchangeID);
+	WTSContractInfo* contract = meta._contract;
+	if (contract == NULL || !m_subBits.test(contract->getTotalIndex()))
+		return;
 
     uint32_t actDate, actTime, actHour;
 
@@ -250,8 +255,15 @@ void ParserCTP::OnRtnDepthMarketData( CThostFtdcDepthMarketDataField *pDepthMark
     }
     else
     {
-        actDate = strtoul(pDepthMarketData->ActionDay, NULL, 10);
-        actTime = strToTime(pDepthMarketData->UpdateTime) * 1000 + pDepthMarketData->UpdateMillisec;
+		//先按固定格式解析,格式不对的再走原来的方法
+		actDate = TimeUtils::parseYMD(pDepthMarketData->ActionDay);
+		if (actDate == 0)
+			actDate = strtoul(pDepthMarketData->ActionDay, NULL, 10);
+
+		uint32_t uTime = TimeUtils::parseHMS(pDepthMarketData->UpdateTime);
+		if (uTime == INVALID_UINT32)
+			uTime = strToTime(pDepthMarketData->UpdateTime);
+		actTime = uTime * 1000 + pDepthMarketData->UpdateMillisec;
         actHour = actTime / 10000000;
 
         if (actDate == m_uTradingDate && actHour >= 20) {
@@ -282,6 +294,7 @@ void ParserCTP::OnRtnDepthMarketData( CThostFtdcDepthMarketDataField *pDepthMark
 
 	WTSTickData* tick = WTSTickData::create(pDepthMarketData->InstrumentID);
 	tick->setContractInfo(contract);
+	WT_TRACE_SET(tick, TTS_PARSER_RECV, tsRecv);
 
 	WTSTickStruct& quote = tick->getTickStruct();
 	strcpy(quote.exchg, pCommInfo->getExchg());
@@ -297,9 +310,9 @@ void ParserCTP::OnRtnDepthMarketData( CThostFtdcDepthMarketDataField *pDepthMark
 	quote.trading_date = m_uTradingDate;
 	if(pDepthMarketData->SettlementPrice != DBL_MAX)
 		quote.settle_price = checkValid(pDepthMarketData->SettlementPrice);
-	if(strcmp(quote.exchg, "CZCE") == 0)
+	if(meta._scale_turnover)
 	{
-		quote.total_turnover = pDepthMarketData->Turnover*pCommInfo->getVolScale();
+		quote.total_turnover = pDepthMarketData->Turnover*meta._turnover_scale;
 	}
 	else
 	{
@@ -350,6 +363,34 @@ void ParserCTP::OnRtnDepthMarketData( CThostFtdcDepthMarketDataField *pDepthMark
 	tick->release();
 }
 
+const ParserCTP::CodeMeta& ParserCTP::getCodeMeta(const char* code, const char* exchg)
+{
+	auto it = m_mapCodeMeta.find(code);
+	if (it != m_mapCodeMeta.end())
+		return it->second;
+
+	//找不到的合约不缓存,基础数据重新加载以后还能查到
+	WTSContractInfo* contract = m_pBaseDataMgr->getContract(code, exchg);
+	if (contract == NULL)
+	{
+		static const CodeMeta EMPTY_META = { NULL, 1.0, false };
+		return EMPTY_META;
+	}
+
+	CodeMeta& meta = m_mapCodeMeta[code];
+	meta._contract = contract;
+	meta._turnover_scale = 1.0;
+	meta._scale_turnover = false;
+	WTSCommodityInfo* pCommInfo = contract->getCommInfo();
+	if (strcmp(pCommInfo->getExchg(), "CZCE") == 0)
+	{
+		meta._scale_turnover = true;
+		meta._turnover_scale = pCommInfo->getVolScale();
+	}
+
+	return meta;
+}
+
 void ParserCTP::OnRspSubMarketData( CThostFtdcSpecificInstrumentField *pSpecificInstrument, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast )
 {
 	if(!IsErrorRspInfo(pRspInfo))
@@ -433,6 +474,14 @@ bool ParserCTP::IsErrorRspInfo(CThostFtdcRspInfoField *pRspInfo)
 
 void ParserCTP::subscribe(const CodeSet &vecSymbols)
 {
+	//订阅的合约设置到位图里,行情回调里只需要测试一位
+	for (auto& code : vecSymbols)
+	{
+		WTSContractInfo* contract = getContract(code);
+		if (contract != NULL)
+			m_subBits.set(contract->getTotalIndex());
+	}
+
 	if(m_uTradingDate == 0)
 	{
 		m_filterSubs = vecSymbols;
@@ -446,6 +495,46 @@ void ParserCTP::subscribe(const CodeSet &vecSymbols)
 
 void ParserCTP::unsubscribe(const CodeSet &vecSymbols)
 {
+	//先清掉订阅位,行情回调里马上就不再处理了,再通知前置退订
+	char ** unsubscribe = new char*[vecSymbols.size()];
+	int nCount = 0;
+	for (auto& code : vecSymbols)
+	{
+		WTSContractInfo* contract = getContract(code);
+		if (contract == NULL)
+			continue;
+
+		m_subBits.reset(contract->getTotalIndex());
+		unsubscribe[nCount++] = (char*)contract->getCode();
+	}
+
+	if (m_pUserAPI && m_uTradingDate != 0 && nCount > 0)
+	{
+		int iResult = m_pUserAPI->UnSubscribeMarketData(unsubscribe, nCount);
+		if (iResult != 0)
+		{
+			if (m_sink)
+				write_log(m_sink, LL_ERROR, "[ParserCTP] Sending md unsubscribe request failed: {}", iResult);
+		}
+		else
+		{
+			if (m_sink)
+				write_log(m_sink, LL_INFO, "[ParserCTP] Market data of {} contracts unsubscribed", nCount);
+		}
+	}
+	delete[] unsubscribe;
+}
+
+WTSContractInfo* ParserCTP::getContract(const std::string& fullCode)
+{
+	if (m_pBaseDataMgr == NULL)
+		return NULL;
+
+	std::size_t pos = fullCode.find('.');
+	if (pos == std::string::npos)
+		return m_pBaseDataMgr->getContract(fullCode.c_str());
+
+	return m_pBaseDataMgr->getContract(fullCode.c_str() + pos + 1, fullCode.substr(0, pos).c_str());
 }
 
 bool ParserCTP::isConnected()
@@ -10,11 +10,14 @@
 #pragma once
 #include "../Includes/IParserApi.h"
 #include "../Share/DLLHelper.hpp"
+#include "../Share/WtSubBitset.hpp"
+#include "../Includes/FasterDefs.h"
 #include "../API/CTP6.3.15/ThostFtdcMdApi.h"
 #include <map>
 
 NS_WTP_BEGIN
 class WTSTickData;
+class WTSContractInfo;
 NS_WTP_END
 
 USING_NS_WTP;
@@ -86,6 +89,23 @@ private:
 	 */
 	bool IsErrorRspInfo(CThostFtdcRspInfoField *pRspInfo);
 
+	/*
+	 *	合约的规范化信息,每个合约第一次收到行情的时候算好,后面直接用
+	 *	找不到的合约不缓存,合约可能是后面才加载的
+	 */
+	typedef struct _CodeMeta
+	{
+		WTSContractInfo*	_contract;
+		double				_turnover_scale;	//成交额的倍数
+		bool				_scale_turnover;	//郑商所的成交额要乘以合约乘数
+	} CodeMeta;
+	const CodeMeta& getCodeMeta(const char* code, const char* exchg);
+
+	/*
+	 *	全代码转成合约,全代码形式如SHFE.rb2401
+	 */
+	WTSContractInfo* getContract(const std::string& fullCode);
+
 
 private:
 	uint32_t			m_uTradingDate;
@@ -99,6 +119,8 @@ private:
 	bool 				m_bLocaltime;	//是否使用本地时间戳
 
 	CodeSet				m_filterSubs;
+	WtSubBitset			m_subBits;		//订阅的合约,按合约全局索引,运行中退订以后立即生效
+	wt_hashmap<std::string, CodeMeta>	m_mapCodeMeta;	//只在行情回调线程里访问
 
 	int					m_iRequestID;
 
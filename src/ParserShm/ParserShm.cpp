@@ -10,6 +10,8 @@
 #include "ParserShm.h"
 #include "../Includes/WTSVariant.hpp"
 #include "../Includes/WTSDataDef.hpp"
+#include "../Includes/WTSContractInfo.hpp"
+#include "../Includes/IBaseDataMgr.h"
 
 #include <boost/bind.hpp>
 
@@ -27,6 +29,18 @@ inline void write_log(IParserSpi* sink, WTSLogLevel ll, const char* format, cons
 	sink->handleParserLog(ll, buffer);
 }
 
+/*
+ *	全代码转成合约,全代码形式如SSE.600000
+ */
+inline WTSContractInfo* get_contract(IBaseDataMgr* bdMgr, const std::string& fullCode)
+{
+	auto pos = fullCode.find('.');
+	if (pos == std::string::npos)
+		return bdMgr->getContract(fullCode.c_str());
+
+	return bdMgr->getContract(fullCode.c_str() + pos + 1, fullCode.substr(0, pos).c_str());
+}
+
 #define UDP_MSG_SUBSCRIBE	0x100
 #define UDP_MSG_PUSHTICK	0x200
 #define UDP_MSG_PUSHORDQUE	0x201	//委托队列
@@ -59,6 +73,7 @@ extern "C"
 ParserShm::ParserShm()
 	: _stopped(false)
 	, _sink(NULL)
+	, _bd_mgr(NULL)
 	, _queue(NULL)
 	, _check_span(0)
 {
@@ -155,11 +170,11 @@ bool ParserShm::connect()
 			{
 			case 0:
 			{
-				const char* fullCode = fmtutil::format("{}.{}", item._tick.exchg, item._tick.code);
-				auto it = _set_subs.find(fullCode);
-				if (it != _set_subs.end())
+				WTSContractInfo* cInfo = NULL;
+				if (is_subscribed(item._tick.exchg, item._tick.code, cInfo))
 				{
 					WTSTickData* newData = WTSTickData::create(item._tick);
+					newData->setContractInfo(cInfo);
 					if (_sink)
 						_sink->handleQuote(newData, 0);
 					newData->release();
@@ -173,11 +188,11 @@ bool ParserShm::connect()
 			break;
 			case 1:
 			{
-				const char* fullCode = fmtutil::format("{}.{}", item._queue.exchg, item._queue.code);
-				auto it = _set_subs.find(fullCode);
-				if (it != _set_subs.end())
+				WTSContractInfo* cInfo = NULL;
+				if (is_subscribed(item._queue.exchg, item._queue.code, cInfo))
 				{
 					WTSOrdQueData* newData = WTSOrdQueData::create(item._queue);
+					newData->setContractInfo(cInfo);
 					if (_sink)
 						_sink->handleOrderQueue(newData);
 					newData->release();
@@ -191,11 +206,11 @@ bool ParserShm::connect()
 			break;
 			case 2:
 			{
-				const char* fullCode = fmtutil::format("{}.{}", item._order.exchg, item._order.code);
-				auto it = _set_subs.find(fullCode);
-				if (it != _set_subs.end())
+				WTSContractInfo* cInfo = NULL;
+				if (is_subscribed(item._order.exchg, item._order.code, cInfo))
 				{
 					WTSOrdDtlData* newData = WTSOrdDtlData::create(item._order);
+					newData->setContractInfo(cInfo);
 					if (_sink)
 						_sink->handleOrderDetail(newData);
 					newData->release();
@@ -209,11 +224,11 @@ bool ParserShm::connect()
 			break;
 			case 3:
 			{
-				const char* fullCode = fmtutil::format("{}.{}", item._trans.exchg, item._trans.code);
-				auto it = _set_subs.find(fullCode);
-				if (it != _set_subs.end())
+				WTSContractInfo* cInfo = NULL;
+				if (is_subscribed(item._trans.exchg, item._trans.code, cInfo))
 				{
 					WTSTransData* newData = WTSTransData::create(item._trans);
+					newData->setContractInfo(cInfo);
 					if (_sink)
 						_sink->handleTransaction(newData);
 					newData->release();
@@ -247,8 +262,37 @@ bool ParserShm::isConnected()
 }
 
 
+bool ParserShm::is_subscribed(const char* exchg, const char* code, WTSContractInfo*& cInfo)
+{
+	if (_bd_mgr == NULL)
+	{
+		const char* fullCode = fmtutil::format("{}.{}", exchg, code);
+		return _set_subs.find(fullCode) != _set_subs.end();
+	}
+
+	cInfo = _bd_mgr->getContract(code, exchg);
+	return (cInfo != NULL) && _sub_bits.test(cInfo->getTotalIndex());
+}
+
 void ParserShm::subscribe( const CodeSet &vecSymbols )
 {
+	//有基础数据的时候只设置订阅位图,接收线程里不用加锁,运行中也可以随时增减订阅
+	if (_bd_mgr != NULL)
+	{
+		uint32_t count = 0;
+		for (const auto& code : vecSymbols)
+		{
+			WTSContractInfo* cInfo = get_contract(_bd_mgr, code);
+			if (cInfo == NULL || !WtSubBitset::is_valid(cInfo->getTotalIndex()))
+				continue;
+
+			_sub_bits.set(cInfo->getTotalIndex());
+			count++;
+		}
+		write_log(_sink, LL_INFO, "[ParserShm] {} of {} instruments subscribed", count, vecSymbols.size());
+		return;
+	}
+
 	auto cit = vecSymbols.begin();
 	for(; cit != vecSymbols.end(); cit++)
 	{
@@ -262,13 +306,22 @@ void ParserShm::subscribe( const CodeSet &vecSymbols )
 
 void ParserShm::unsubscribe(const CodeSet &setSymbols)
 {
+	if (_bd_mgr == NULL)
+		return;
 
+	for (const auto& code : setSymbols)
+	{
+		WTSContractInfo* cInfo = get_contract(_bd_mgr, code);
+		if (cInfo != NULL)
+			_sub_bits.reset(cInfo->getTotalIndex());
+	}
 }
 
 void ParserShm::registerSpi( IParserSpi* listener )
 {
 	bool bReplaced = (_sink!=NULL);
 	_sink = listener;
+	_bd_mgr = (_sink != NULL) ? _sink->getBaseDataMgr() : NULL;
 	if(bReplaced && _sink)
 	{
 		write_log(_sink, LL_WARN, "Listener is replaced");
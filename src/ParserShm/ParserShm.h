@@ -12,10 +12,15 @@
 #include "../Share/StdUtils.hpp"
 #include "../Includes/WTSStruct.h"
 #include "../Share/BoostMappingFile.hpp"
+#include "../Share/WtSubBitset.hpp"
 
 #include <boost/asio.hpp>
 #include <boost/asio/io_service.hpp>
 
+NS_WTP_BEGIN
+class WTSContractInfo;
+NS_WTP_END
+
 USING_NS_WTP;
 using namespace boost::asio;
 
@@ -72,6 +77,13 @@ public:
 
 	virtual void registerSpi(IParserSpi* listener) override;
 
+private:
+	/*
+	 *	检查是否订阅
+	 *	有基础数据的时候按合约索引测试订阅位图,合约信息顺便带出来,后面就不用再查了
+	 */
+	bool	is_subscribed(const char* exchg, const char* code, WTSContractInfo*& cInfo);
+
 private:
 	std::string		_path;
 	typedef std::shared_ptr<BoostMappingFile> MappedFilePtr;
@@ -81,9 +93,11 @@ private:
 	uint32_t		_check_span;
 
 	IParserSpi*		_sink;
+	IBaseDataMgr*	_bd_mgr;
 	bool			_stopped;
 
-	CodeSet			_set_subs;
+	CodeSet			_set_subs;		//没有基础数据的时候,按代码过滤
+	WtSubBitset		_sub_bits;		//订阅的合约,按合约全局索引
 
 	StdThreadPtr	_thrd_parser;
 };
@@ -10,6 +10,8 @@
 #include "ParserUDP.h"
 #include "../Includes/WTSVariant.hpp"
 #include "../Includes/WTSDataDef.hpp"
+#include "../Includes/WTSContractInfo.hpp"
+#include "../Includes/IBaseDataMgr.h"
 
 #include <boost/bind.hpp>
 
@@ -27,6 +29,18 @@ inline void write_log(IParserSpi* sink, WTSLogLevel ll, const char* format, cons
 	sink->handleParserLog(ll, buffer);
 }
 
+/*
+ *	全代码转成合约,全代码形式如SSE.600000
+ */
+inline WTSContractInfo* get_contract(IBaseDataMgr* bdMgr, const std::string& fullCode)
+{
+	auto pos = fullCode.find('.');
+	if (pos == std::string::npos)
+		return bdMgr->getContract(fullCode.c_str());
+
+	return bdMgr->getContract(fullCode.c_str() + pos + 1, fullCode.substr(0, pos).c_str());
+}
+
 #define UDP_MSG_SUBSCRIBE	0x100
 #define UDP_MSG_PUSHTICK	0x200
 #define UDP_MSG_PUSHORDQUE	0x201	//委托队列
@@ -84,6 +98,7 @@ ParserUDP::ParserUDP()
 	, _strand(_io_service)
 	, _stopped(false)
 	, _sink(NULL)
+	, _bd_mgr(NULL)
 	, _connecting(false)
 	, _s_inited(false)
 {
@@ -286,18 +301,48 @@ void ParserUDP::subscribe( const CodeSet &vecSymbols )
 		{
 			_set_subs.insert(code);
 		}
+
+		//同时设置订阅位图,接收的时候只需要测试一位
+		if (_bd_mgr != NULL)
+		{
+			WTSContractInfo* cInfo = get_contract(_bd_mgr, code);
+			if (cInfo != NULL)
+				_sub_bits.set(cInfo->getTotalIndex());
+		}
 	}
 }
 
 void ParserUDP::unsubscribe(const CodeSet &setSymbols)
 {
+	if (_bd_mgr == NULL)
+		return;
+
+	//服务端的订阅不撤销,只清除订阅位,收到的数据直接丢弃
+	for (const auto& code : setSymbols)
+	{
+		WTSContractInfo* cInfo = get_contract(_bd_mgr, code);
+		if (cInfo != NULL)
+			_sub_bits.reset(cInfo->getTotalIndex());
+	}
+}
+
+bool ParserUDP::is_subscribed(const char* exchg, const char* code, WTSContractInfo*& cInfo)
+{
+	if (_bd_mgr == NULL)
+	{
+		const char* fullCode = fmtutil::format("{}.{}", exchg, code);
+		return _set_subs.find(fullCode) != _set_subs.end();
+	}
 
+	cInfo = _bd_mgr->getContract(code, exchg);
+	return (cInfo != NULL) && _sub_bits.test(cInfo->getTotalIndex());
 }
 
 void ParserUDP::registerSpi( IParserSpi* listener )
 {
 	bool bReplaced = (_sink!=NULL);
 	_sink = listener;
+	_bd_mgr = (_sink != NULL) ? _sink->getBaseDataMgr() : NULL;
 	if(bReplaced && _sink)
 	{
 		write_log(_sink, LL_WARN, "Listener is replaced");
@@ -355,11 +400,11 @@ void ParserUDP::extract_buffer(uint32_t length, bool isBroad /* = true */)
 	if (header->_type == UDP_MSG_PUSHTICK || header->_type == UDP_MSG_SUBSCRIBE)
 	{
 		UDPTickPacket* packet = (UDPTickPacket*)header;
-		const char* fullCode = fmtutil::format("{}.{}", packet->_data.exchg, packet->_data.code);
-		auto it = _set_subs.find(fullCode);
-		if (it != _set_subs.end())
+		WTSContractInfo* cInfo = NULL;
+		if (is_subscribed(packet->_data.exchg, packet->_data.code, cInfo))
 		{
 			WTSTickData* curTick = WTSTickData::create(packet->_data);
+			curTick->setContractInfo(cInfo);
 			if (_sink)
 				_sink->handleQuote(curTick, 0);
 
@@ -374,11 +419,11 @@ void ParserUDP::extract_buffer(uint32_t length, bool isBroad /* = true */)
 	else if (header->_type == UDP_MSG_PUSHORDDTL)
 	{
 		UDPOrdDtlPacket* packet = (UDPOrdDtlPacket*)header;
-		const char* fullCode = fmtutil::format("{}.{}", packet->_data.exchg, packet->_data.code);
-		auto it = _set_subs.find(fullCode);
-		if (it != _set_subs.end())
+		WTSContractInfo* cInfo = NULL;
+		if (is_subscribed(packet->_data.exchg, packet->_data.code, cInfo))
 		{
 			WTSOrdDtlData* curData = WTSOrdDtlData::create(packet->_data);
+			curData->setContractInfo(cInfo);
 			if (_sink)
 				_sink->handleOrderDetail(curData);
 
@@ -393,11 +438,11 @@ void ParserUDP::extract_buffer(uint32_t length, bool isBroad /* = true */)
 	else if (header->_type == UDP_MSG_PUSHORDQUE)
 	{
 		UDPOrdQuePacket* packet = (UDPOrdQuePacket*)header;
-		const char* fullCode = fmtutil::format("{}.{}", packet->_data.exchg, packet->_data.code);
-		auto it = _set_subs.find(fullCode);
-		if (it != _set_subs.end())
+		WTSContractInfo* cInfo = NULL;
+		if (is_subscribed(packet->_data.exchg, packet->_data.code, cInfo))
 		{
 			WTSOrdQueData* curData = WTSOrdQueData::create(packet->_data);
+			curData->setContractInfo(cInfo);
 			if (_sink)
 				_sink->handleOrderQueue(curData);
 
@@ -412,11 +457,11 @@ void ParserUDP::extract_buffer(uint32_t length, bool isBroad /* = true */)
 	else if (header->_type == UDP_MSG_PUSHTRANS)
 	{
 		UDPTransPacket* packet = (UDPTransPacket*)header;
-		const char* fullCode = fmtutil::format("{}.{}", packet->_data.exchg, packet->_data.code);
-		auto it = _set_subs.find(fullCode);
-		if (it != _set_subs.end())
+		WTSContractInfo* cInfo = NULL;
+		if (is_subscribed(packet->_data.exchg, packet->_data.code, cInfo))
 		{
 			WTSTransData* curData = WTSTransData::create(packet->_data);
+			curData->setContractInfo(cInfo);
 			if (_sink)
 				_sink->handleTransaction(curData);
 
@@ -10,6 +10,7 @@
 #pragma once
 #include "../Includes/IParserApi.h"
 #include "../Share/StdUtils.hpp"
+#include "../Share/WtSubBitset.hpp"
 
 #include <queue>
 
@@ -17,6 +18,10 @@
 #include <boost/array.hpp>
 #include <boost/asio/io_service.hpp>
 
+NS_WTP_BEGIN
+class WTSContractInfo;
+NS_WTP_END
+
 USING_NS_WTP;
 using namespace boost::asio;
 
@@ -54,6 +59,12 @@ private:
 
 	void	extract_buffer(uint32_t length, bool isBroad);
 
+	/*
+	 *	检查是否订阅
+	 *	有基础数据的时候按合约索引测试订阅位图,合约信息顺便带出来,后面就不用再查了
+	 */
+	bool	is_subscribed(const char* exchg, const char* code, WTSContractInfo*& cInfo);
+
 private:
 	void	doOnConnected();
 	void	doOnDisconnected();
@@ -80,10 +91,12 @@ private:
 	boost::array<char, 1024> _s_buffer;
 
 	IParserSpi*				_sink;
+	IBaseDataMgr*			_bd_mgr;
 	bool					_stopped;
 	bool					_connecting;
 
-	CodeSet					_set_subs;
+	CodeSet					_set_subs;		//订阅的代码,用于向服务端发送订阅请求
+	WtSubBitset				_sub_bits;		//订阅的合约,按合约全局索引
 
 	StdThreadPtr			_thrd_parser;
 
@@ -205,6 +205,10 @@ void ParserXTP::OnTickByTick(XTPTBT *tbt_data)
 		return;
 	}
 
+	//全市场逐笔数据量很大,先测试订阅位,没订阅的直接丢弃,不用再查合约
+	if (!IsSubscribed(tbt_data->exchange_id, tbt_data->ticker))
+		return;
+
 	std::string exchg;
 	if (tbt_data->exchange_id == XTP_EXCHANGE_SH)
 	{
@@ -285,6 +289,9 @@ void ParserXTP::OnDepthMarketData(XTPMD *market_data, int64_t bid1_qty[], int32_
 		return;
 	}
 
+	if (!IsSubscribed(market_data->exchange_id, market_data->ticker))
+		return;
+
 	uint32_t actDate = (uint32_t)(market_data->data_time / 1000000000);
 	uint32_t actTime = market_data->data_time % 1000000000;
 	uint32_t actHour = actTime / 10000000;
@@ -594,10 +601,12 @@ void ParserXTP::subscribe(const CodeSet &vecSymbols)
 			if (strncmp(code.c_str(), "SSE.", 4) == 0)
 			{
 				m_fitSHSubs.insert(code.c_str() + 4);
+				m_bitsSH.set(WtSubBitset::numeric_index(code.c_str() + 4));
 			}
 			else if (strncmp(code.c_str(), "SZSE.", 5) == 0)
 			{
 				m_fitSZSubs.insert(code.c_str() + 5);
+				m_bitsSZ.set(WtSubBitset::numeric_index(code.c_str() + 5));
 			}
 		}
 	}
@@ -609,11 +618,13 @@ void ParserXTP::subscribe(const CodeSet &vecSymbols)
 			if (strncmp(code.c_str(), "SSE.", 4) == 0)
 			{
 				m_fitSHSubs.insert(code.c_str() + 4);
+				m_bitsSH.set(WtSubBitset::numeric_index(code.c_str() + 4));
 				setSH.insert(code.c_str() + 4);
 			}
 			else if (strncmp(code.c_str(), "SZSE.", 5) == 0)
 			{
 				m_fitSZSubs.insert(code.c_str() + 5);
+				m_bitsSZ.set(WtSubBitset::numeric_index(code.c_str() + 5));
 				setSZ.insert(code.c_str() + 5);
 			}
 		}
@@ -676,6 +687,46 @@ void ParserXTP::subscribe(const CodeSet &vecSymbols)
 
 void ParserXTP::unsubscribe(const CodeSet &vecSymbols)
 {
+	//先清掉订阅位,行情回调里马上就不再处理了,再通知柜台退订
+	CodeSet setSH, setSZ;
+	for (auto& code : vecSymbols)
+	{
+		if (strncmp(code.c_str(), "SSE.", 4) == 0)
+		{
+			m_bitsSH.reset(WtSubBitset::numeric_index(code.c_str() + 4));
+			m_fitSHSubs.erase(code.c_str() + 4);
+			setSH.insert(code.c_str() + 4);
+		}
+		else if (strncmp(code.c_str(), "SZSE.", 5) == 0)
+		{
+			m_bitsSZ.reset(WtSubBitset::numeric_index(code.c_str() + 5));
+			m_fitSZSubs.erase(code.c_str() + 5);
+			setSZ.insert(code.c_str() + 5);
+		}
+	}
+
+	if (m_uTradingDate == 0 || m_pUserAPI == NULL)
+		return;
+
+	auto do_unsub = [this](CodeSet& codes, XTP_EXCHANGE_TYPE exchg) {
+		if (codes.empty())
+			return;
+
+		char ** tickers = new char*[codes.size()];
+		int nCount = 0;
+		for (auto it = codes.begin(); it != codes.end(); it++)
+			tickers[nCount++] = (char*)(*it).c_str();
+
+		m_pUserAPI->UnSubscribeMarketData(tickers, nCount, exchg);
+		m_pUserAPI->UnSubscribeTickByTick(tickers, nCount, exchg);
+		delete[] tickers;
+
+		if (m_sink)
+			write_log(m_sink, LL_INFO, "[ParserXTP] {} instruments of {} unsubscribed", nCount, exchg == XTP_EXCHANGE_SH ? "SSE" : "SZSE");
+	};
+
+	do_unsub(setSH, XTP_EXCHANGE_SH);
+	do_unsub(setSZ, XTP_EXCHANGE_SZ);
 }
 
 bool ParserXTP::isConnected()
@@ -14,6 +14,7 @@
 
 #include "../Share/DLLHelper.hpp"
 #include "../Share/StdUtils.hpp"
+#include "../Share/WtSubBitset.hpp"
 
 
 
@@ -89,6 +90,15 @@ private:
 	 *	检查错误信息
 	 */
 	bool IsErrorRspInfo(XTPRI *error_info);
+	/*
+	 *	检查是否订阅
+	 *	沪深的证券代码都是数字,直接作为订阅位图的索引,不用查合约就能判断
+	 */
+	inline bool IsSubscribed(XTP_EXCHANGE_TYPE exchg, const char* ticker) const
+	{
+		const WtSubBitset& bits = (exchg == XTP_EXCHANGE_SH) ? m_bitsSH : m_bitsSZ;
+		return bits.test(WtSubBitset::numeric_index(ticker));
+	}
 
 
 private:
@@ -110,6 +120,8 @@ private:
 
 	CodeSet				m_fitSHSubs;
 	CodeSet				m_fitSZSubs;
+	WtSubBitset			m_bitsSH;	//上交所订阅位图,按数字代码
+	WtSubBitset			m_bitsSZ;	//深交所订阅位图,按数字代码
 
 	int					m_iRequestID;
 
@@ -38,10 +38,13 @@ public:
 		_map_region=NULL;
 	}
 
-	void sync()
+	/*
+	 *	bAsync为false的时候等数据真正落盘再返回
+	 */
+	void sync(bool bAsync = true)
 	{
 		if(_map_region)
-			_map_region->flush();
+			_map_region->flush(0, 0, bAsync);
 	}
 
 	void *addr()
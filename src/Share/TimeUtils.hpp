@@ -316,6 +316,41 @@ public:
 		return (uint32_t)(minTime%10000);
 	}
 
+	/*
+	 *	解析固定格式的时间字符串HH:MM:SS,返回HHMMSS
+	 *	行情接口里的时间基本都是这个格式,直接按位置取数字,不用拷贝和strtoul
+	 *	格式不对返回UINT32_MAX(即INVALID_UINT32),调用方再走通用的解析
+	 */
+	static inline uint32_t parseHMS(const char* s)
+	{
+		//按顺序判断,遇到结尾的'\0'就停下,不会越界
+		if (!(isDigit(s[0]) && isDigit(s[1]) && s[2] == ':' && isDigit(s[3]) && isDigit(s[4]) && s[5] == ':' && isDigit(s[6]) && isDigit(s[7])))
+			return UINT32_MAX;
+
+		return (s[0] - '0') * 100000 + (s[1] - '0') * 10000 + (s[3] - '0') * 1000 + (s[4] - '0') * 100 + (s[6] - '0') * 10 + (s[7] - '0');
+	}
+
+	/*
+	 *	解析固定格式的日期字符串YYYYMMDD
+	 *	格式不对返回0
+	 */
+	static inline uint32_t parseYMD(const char* s)
+	{
+		uint32_t ret = 0;
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			if (!isDigit(s[i]))
+				return 0;
+			ret = ret * 10 + (s[i] - '0');
+		}
+		return ret;
+	}
+
+	static inline bool isDigit(char c)
+	{
+		return (uint8_t)(c - '0') < 10;
+	}
+
 	static inline bool isWeekends(uint32_t uDate)
 	{
 		tm t;	
@@ -0,0 +1,328 @@
+﻿/*!
+ * \file WtCheckpoint.hpp
+ * \project	WonderTrader
+ *
+ * \brief 回测断点的二进制读写
+ *
+ * 断点文件由文件头和若干个数据段组成,每个数据段有名字和长度
+ * 各个模块只管按顺序写自己的状态,读的时候按同样的顺序读回来
+ * 读的过程中任何一步失败,后面的读取都会失败,调用方只需要在最后检查一次
+ */
+#pragma once
+#include <string.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <type_traits>
+
+#include "BoostFile.hpp"
+#include "../Includes/WTSMarcos.h"
+
+#include <boost/filesystem.hpp>
+
+NS_WTP_BEGIN
+
+#define CKPT_FILE_FLAG		"WTCKPT"
+#define CKPT_FILE_VERSION	1
+
+#pragma pack(push, 8)
+typedef struct _CkptFileHeader
+{
+	char		_flag[8];		//文件标记
+	uint32_t	_version;		//版本号
+	uint32_t	_tdate;			//断点所在的交易日
+	uint64_t	_size;			//数据区大小
+	uint64_t	_digest;		//数据区的摘要,FNV-1a
+} CkptFileHeader;
+#pragma pack(pop)
+
+inline uint64_t ckpt_digest(const char* data, std::size_t len)
+{
+	uint64_t h = 14695981039346656037ULL;
+	for (std::size_t i = 0; i < len; i++)
+	{
+		h ^= (uint8_t)data[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+class WtCkptWriter
+{
+public:
+	WtCkptWriter() { _buffer.reserve(64 * 1024); }
+
+	template<typename T>
+	inline void put(const T& v)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be written directly");
+		_buffer.append((const char*)&v, sizeof(T));
+	}
+
+	/*
+	 *	写入一段原始内存,用于带自定义拷贝构造但内存布局是POD的结构体
+	 */
+	inline void put_raw(const void* data, std::size_t len)
+	{
+		_buffer.append((const char*)data, len);
+	}
+
+	inline void put_str(const char* s, std::size_t len)
+	{
+		put((uint32_t)len);
+		_buffer.append(s, len);
+	}
+
+	inline void put_str(const std::string& s) { put_str(s.data(), s.size()); }
+
+	inline void put_str(const char* s) { put_str(s, strlen(s)); }
+
+	template<typename T>
+	inline void put_vec(const std::vector<T>& ay)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be written directly");
+		put((uint32_t)ay.size());
+		if (!ay.empty())
+			_buffer.append((const char*)ay.data(), sizeof(T)*ay.size());
+	}
+
+	/*
+	 *	数据段开始,长度先占位,段结束的时候回填
+	 */
+	inline void begin_block(const char* tag)
+	{
+		put_str(tag);
+		_blocks.emplace_back(_buffer.size());
+		put((uint64_t)0);
+	}
+
+	inline void end_block()
+	{
+		std::size_t pos = _blocks.back();
+		_blocks.pop_back();
+		uint64_t len = _buffer.size() - pos - sizeof(uint64_t);
+		memcpy((char*)_buffer.data() + pos, &len, sizeof(uint64_t));
+	}
+
+	inline const std::string& data() const { return _buffer; }
+
+	inline void clear()
+	{
+		_buffer.clear();
+		_blocks.clear();
+	}
+
+	/*
+	 *	保存到文件
+	 *	先写临时文件再改名,保存的过程中进程退出也不会留下半个断点
+	 */
+	inline bool save(const char* filename, uint32_t tdate)
+	{
+		CkptFileHeader header;
+		memset(&header, 0, sizeof(header));
+		strcpy(header._flag, CKPT_FILE_FLAG);
+		header._version = CKPT_FILE_VERSION;
+		header._tdate = tdate;
+		header._size = _buffer.size();
+		header._digest = ckpt_digest(_buffer.data(), _buffer.size());
+
+		std::string tmpfile = filename;
+		tmpfile += ".tmp";
+		{
+			BoostFile bf;
+			if (!bf.create_new_file(tmpfile.c_str()))
+				return false;
+
+			if (!bf.write_file(&header, sizeof(header)) || !bf.write_file(_buffer.data(), _buffer.size()))
+			{
+				bf.close_file();
+				BoostFile::delete_file(tmpfile.c_str());
+				return false;
+			}
+			bf.close_file();
+		}
+
+		if (BoostFile::exists(filename))
+			BoostFile::delete_file(filename);
+
+		boost::system::error_code ec;
+		boost::filesystem::rename(tmpfile, filename, ec);
+		return !ec;
+	}
+
+private:
+	std::string					_buffer;
+	std::vector<std::size_t>	_blocks;
+};
+
+class WtCkptReader
+{
+public:
+	WtCkptReader() :_data(NULL), _size(0), _pos(0), _good(false), _tdate(0) {}
+
+	/*
+	 *	读取断点文件,文件头和摘要校验不过返回false
+	 */
+	inline bool load(const char* filename)
+	{
+		_good = false;
+		if (!BoostFile::exists(filename))
+			return false;
+
+		if (!BoostFile::read_file_contents(filename, _content) || _content.size() < sizeof(CkptFileHeader))
+			return false;
+
+		const CkptFileHeader* header = (const CkptFileHeader*)_content.data();
+		if (strcmp(header->_flag, CKPT_FILE_FLAG) != 0 || header->_version != CKPT_FILE_VERSION)
+			return false;
+
+		if (header->_size != _content.size() - sizeof(CkptFileHeader))
+			return false;
+
+		const char* data = _content.data() + sizeof(CkptFileHeader);
+		if (header->_digest != ckpt_digest(data, (std::size_t)header->_size))
+			return false;
+
+		_tdate = header->_tdate;
+		return attach(data, (std::size_t)header->_size);
+	}
+
+	/*
+	 *	直接读一块内存,内存由调用方管理
+	 */
+	inline bool attach(const char* data, std::size_t len)
+	{
+		_data = data;
+		_size = len;
+		_pos = 0;
+		_good = true;
+		_blocks.clear();
+		return true;
+	}
+
+	inline bool good() const { return _good; }
+
+	inline uint32_t tdate() const { return _tdate; }
+
+	template<typename T>
+	inline bool get(T& v)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be read directly");
+		return get_raw(&v, sizeof(T));
+	}
+
+	inline bool get_raw(void* data, std::size_t len)
+	{
+		if (!check(len))
+			return false;
+
+		memcpy(data, _data + _pos, len);
+		_pos += len;
+		return true;
+	}
+
+	inline bool get_str(std::string& s)
+	{
+		uint32_t len = 0;
+		if (!get(len) || !check(len))
+			return false;
+
+		s.assign(_data + _pos, len);
+		_pos += len;
+		return true;
+	}
+
+	/*
+	 *	读回到stringstream里,写指针放在末尾,后面可以继续追加
+	 */
+	inline bool get_str(std::stringstream& ss)
+	{
+		std::string s;
+		if (!get_str(s))
+			return false;
+
+		ss.str("");
+		ss.clear();
+		ss << s;
+		return true;
+	}
+
+	template<typename T>
+	inline bool get_vec(std::vector<T>& ay)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be read directly");
+		uint32_t cnt = 0;
+		if (!get(cnt) || !check(sizeof(T)*cnt))
+			return false;
+
+		ay.resize(cnt);
+		if (cnt > 0)
+			memcpy((void*)ay.data(), _data + _pos, sizeof(T)*cnt);
+		_pos += sizeof(T)*cnt;
+		return true;
+	}
+
+	/*
+	 *	进入数据段,段名不一致返回false
+	 */
+	inline bool enter_block(const char* tag)
+	{
+		std::string name;
+		uint64_t len = 0;
+		if (!get_str(name) || !get(len))
+			return false;
+
+		if (name != tag || !check((std::size_t)len))
+		{
+			_good = false;
+			return false;
+		}
+
+		_blocks.emplace_back(_pos + (std::size_t)len);
+		return true;
+	}
+
+	/*
+	 *	离开数据段,没读完的部分直接跳过,新版本在段尾追加的字段不影响老版本读取
+	 */
+	inline bool leave_block()
+	{
+		if (!_good || _blocks.empty())
+			return false;
+
+		std::size_t end = _blocks.back();
+		_blocks.pop_back();
+		if (_pos > end)
+		{
+			_good = false;
+			return false;
+		}
+
+		_pos = end;
+		return true;
+	}
+
+private:
+	inline bool check(std::size_t len)
+	{
+		std::size_t end = _blocks.empty() ? _size : _blocks.back();
+		if (!_good || _pos + len > end)
+		{
+			_good = false;
+			return false;
+		}
+		return true;
+	}
+
+private:
+	std::string		_content;
+	const char*		_data;
+	std::size_t		_size;
+	std::size_t		_pos;
+	bool			_good;
+	uint32_t		_tdate;
+
+	std::vector<std::size_t>	_blocks;
+};
+
+NS_WTP_END
@@ -0,0 +1,459 @@
+﻿/*!
+ * \file WtCompactData.hpp
+ * \project	WonderTrader
+ *
+ * \brief K线和tick的定点紧凑存储
+ *
+ * 价格按小数位数放大成int32,成交量和持仓收窄成uint32/int32,成交额保留double
+ * WTSBarStruct从88字节降到56字节,WTSTickStruct从512字节降到248字节
+ * 小数位数由品种的价格变动单位确定,编码的时候逐条校验能否无损还原,有一条还原不了就返回false,由调用方退回到原来的格式
+ * 解码可以用WtCompactCodec整块转回标准结构体,也可以用WtCompactBars/WtCompactTicks按需读取单个字段
+ */
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <cmath>
+#include <new>
+#include <string>
+#include <algorithm>
+
+#include "../Includes/WTSStruct.h"
+
+NS_WTP_BEGIN
+
+//最多支持的价格小数位数
+#define COMPACT_MAX_PRECISION	8
+
+#pragma pack(push, 8)
+/*
+ *	紧凑数据块的头部,放在数据区的最前面
+ *	tick数据块里每条tick的代码都一样,只存一份
+ */
+typedef struct _CompactBlockInfo
+{
+	uint32_t	_count;			//数据条数
+	uint32_t	_precision;		//价格小数位数
+	char		_exchg[MAX_EXCHANGE_LENGTH];
+	char		_code[MAX_INSTRUMENT_LENGTH];
+
+	_CompactBlockInfo()
+	{
+		memset(this, 0, sizeof(_CompactBlockInfo));
+	}
+} CompactBlockInfo;
+
+struct WTSBarCompact
+{
+	uint64_t	time;
+	uint32_t	date;
+	int32_t		open;
+	int32_t		high;
+	int32_t		low;
+	int32_t		close;
+	int32_t		settle;
+	uint32_t	vol;
+	int32_t		hold;
+	int32_t		add;
+	uint32_t	reserve_;
+	double		money;
+};
+
+struct WTSTickCompact
+{
+	double		total_turnover;
+	double		turn_over;
+
+	uint32_t	trading_date;
+	uint32_t	action_date;
+	uint32_t	action_time;
+
+	int32_t		price;
+	int32_t		open;
+	int32_t		high;
+	int32_t		low;
+	int32_t		settle_price;
+	int32_t		upper_limit;
+	int32_t		lower_limit;
+	int32_t		pre_close;
+	int32_t		pre_settle;
+
+	uint32_t	total_volume;
+	uint32_t	volume;
+	uint32_t	open_interest;
+	uint32_t	pre_interest;
+	int32_t		diff_interest;
+	uint32_t	reserve_;
+
+	int32_t		bid_prices[10];
+	int32_t		ask_prices[10];
+	uint32_t	bid_qty[10];
+	uint32_t	ask_qty[10];
+};
+#pragma pack(pop)
+
+class WtCompactCodec
+{
+public:
+	static inline double scale_of(uint32_t precision)
+	{
+		static const double POW10[COMPACT_MAX_PRECISION + 1] = { 1, 10, 100, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8 };
+		return POW10[std::min<uint32_t>(precision, COMPACT_MAX_PRECISION)];
+	}
+
+	/*
+	 *	根据价格变动单位确定小数位数,0.2是1位,0.005是3位
+	 */
+	static inline uint32_t precision_of(double priceTick)
+	{
+		for (uint32_t p = 0; p < COMPACT_MAX_PRECISION; p++)
+		{
+			double v = priceTick * scale_of(p);
+			if (std::fabs(v - std::round(v)) < 1e-6)
+				return p;
+		}
+		return COMPACT_MAX_PRECISION;
+	}
+
+	/*
+	 *	还原的时候用整数除以10的幂,结果就是离十进制价格最近的double
+	 *	和从行情或者文本里解析出来的价格完全一致,所以乘法不能代替这里的除法
+	 */
+	static inline double to_price(int32_t v, double scale) { return (double)v / scale; }
+
+	static inline bool to_fixed(double px, double scale, int32_t& ret)
+	{
+		if (!std::isfinite(px))
+			return false;
+
+		double v = std::round(px * scale);
+		if (v > (double)INT32_MAX || v < (double)INT32_MIN)
+			return false;
+
+		ret = (int32_t)v;
+		return to_price(ret, scale) == px;
+	}
+
+	static inline bool to_uint(double v, uint32_t& ret)
+	{
+		if (!(v >= 0 && v <= (double)UINT32_MAX))
+			return false;
+
+		ret = (uint32_t)v;
+		return (double)ret == v;
+	}
+
+	static inline bool to_int(double v, int32_t& ret)
+	{
+		if (!(v >= (double)INT32_MIN && v <= (double)INT32_MAX))
+			return false;
+
+		ret = (int32_t)v;
+		return (double)ret == v;
+	}
+
+public:
+	/*
+	 *	K线编码成紧凑格式,输出为CompactBlockInfo加上数据
+	 *	precision是按价格变动单位算出来的小数位数,不够的话会自动往上加,最多到8位
+	 *	有数据没法无损还原的,返回false
+	 */
+	static bool encode_bars(const WTSBarStruct* bars, uint32_t count, uint32_t precision, std::string& out)
+	{
+		for (uint32_t p = precision; p <= COMPACT_MAX_PRECISION; p++)
+		{
+			out.resize(sizeof(CompactBlockInfo) + sizeof(WTSBarCompact)*count);
+			CompactBlockInfo* info = new(&out[0]) CompactBlockInfo();
+			info->_count = count;
+			info->_precision = p;
+
+			WTSBarCompact* items = (WTSBarCompact*)(out.data() + sizeof(CompactBlockInfo));
+			double scale = scale_of(p);
+			bool bPxFailed = false;
+			for (uint32_t idx = 0; idx < count; idx++)
+			{
+				const WTSBarStruct& bar = bars[idx];
+				WTSBarCompact& item = items[idx];
+				item.time = bar.time;
+				item.date = bar.date;
+				item.reserve_ = 0;
+				item.money = bar.money;
+				//期权的hold/add存的是买卖价,不是整数,这种数据不做紧凑存储
+				if (!to_uint(bar.vol, item.vol) || !to_int(bar.hold, item.hold) || !to_int(bar.add, item.add))
+				{
+					out.clear();
+					return false;
+				}
+
+				if (!to_fixed(bar.open, scale, item.open) || !to_fixed(bar.high, scale, item.high) || !to_fixed(bar.low, scale, item.low)
+					|| !to_fixed(bar.close, scale, item.close) || !to_fixed(bar.settle, scale, item.settle))
+				{
+					bPxFailed = true;
+					break;
+				}
+			}
+
+			if (!bPxFailed)
+				return true;
+		}
+
+		out.clear();
+		return false;
+	}
+
+	/*
+	 *	紧凑格式的K线还原成WTSBarStruct
+	 */
+	static bool decode_bars(const char* data, std::size_t len, std::string& out)
+	{
+		if (len < sizeof(CompactBlockInfo))
+			return false;
+
+		const CompactBlockInfo* info = (const CompactBlockInfo*)data;
+		if (len != sizeof(CompactBlockInfo) + sizeof(WTSBarCompact)*info->_count || info->_precision > COMPACT_MAX_PRECISION)
+			return false;
+
+		const WTSBarCompact* items = (const WTSBarCompact*)(data + sizeof(CompactBlockInfo));
+		double scale = scale_of(info->_precision);
+		out.resize(sizeof(WTSBarStruct)*info->_count);
+		WTSBarStruct* bars = (WTSBarStruct*)out.data();
+		for (uint32_t idx = 0; idx < info->_count; idx++)
+			decode_bar(items[idx], scale, bars[idx]);
+
+		return true;
+	}
+
+	static inline void decode_bar(const WTSBarCompact& item, double scale, WTSBarStruct& bar)
+	{
+		bar.date = item.date;
+		bar.reserve_ = 0;
+		bar.time = item.time;
+		bar.open = to_price(item.open, scale);
+		bar.high = to_price(item.high, scale);
+		bar.low = to_price(item.low, scale);
+		bar.close = to_price(item.close, scale);
+		bar.settle = to_price(item.settle, scale);
+		bar.money = item.money;
+		bar.vol = item.vol;
+		bar.hold = item.hold;
+		bar.add = item.add;
+	}
+
+	/*
+	 *	tick编码成紧凑格式,所有tick的代码必须一致
+	 */
+	static bool encode_ticks(const WTSTickStruct* ticks, uint32_t count, uint32_t precision, std::string& out)
+	{
+		for (uint32_t p = precision; p <= COMPACT_MAX_PRECISION; p++)
+		{
+			out.resize(sizeof(CompactBlockInfo) + sizeof(WTSTickCompact)*count);
+			CompactBlockInfo* info = new(&out[0]) CompactBlockInfo();
+			info->_count = count;
+			info->_precision = p;
+			if (count > 0)
+			{
+				wt_strcpy(info->_exchg, ticks[0].exchg, std::min(strlen(ticks[0].exchg), (size_t)MAX_EXCHANGE_LENGTH - 1));
+				wt_strcpy(info->_code, ticks[0].code, std::min(strlen(ticks[0].code), (size_t)MAX_INSTRUMENT_LENGTH - 1));
+			}
+
+			WTSTickCompact* items = (WTSTickCompact*)(out.data() + sizeof(CompactBlockInfo));
+			double scale = scale_of(p);
+			bool bPxFailed = false;
+			for (uint32_t idx = 0; idx < count; idx++)
+			{
+				const WTSTickStruct& ts = ticks[idx];
+				WTSTickCompact& item = items[idx];
+				if (strcmp(ts.exchg, info->_exchg) != 0 || strcmp(ts.code, info->_code) != 0)
+				{
+					out.clear();
+					return false;
+				}
+
+				item.total_turnover = ts.total_turnover;
+				item.turn_over = ts.turn_over;
+				item.trading_date = ts.trading_date;
+				item.action_date = ts.action_date;
+				item.action_time = ts.action_time;
+				item.reserve_ = 0;
+
+				bool bOK = to_uint(ts.total_volume, item.total_volume) && to_uint(ts.volume, item.volume)
+					&& to_uint(ts.open_interest, item.open_interest) && to_uint(ts.pre_interest, item.pre_interest)
+					&& to_int(ts.diff_interest, item.diff_interest);
+				for (uint32_t i = 0; i < 10 && bOK; i++)
+					bOK = to_uint(ts.bid_qty[i], item.bid_qty[i]) && to_uint(ts.ask_qty[i], item.ask_qty[i]);
+
+				if (!bOK)
+				{
+					out.clear();
+					return false;
+				}
+
+				bOK = to_fixed(ts.price, scale, item.price) && to_fixed(ts.open, scale, item.open)
+					&& to_fixed(ts.high, scale, item.high) && to_fixed(ts.low, scale, item.low)
+					&& to_fixed(ts.settle_price, scale, item.settle_price)
+					&& to_fixed(ts.upper_limit, scale, item.upper_limit) && to_fixed(ts.lower_limit, scale, item.lower_limit)
+					&& to_fixed(ts.pre_close, scale, item.pre_close) && to_fixed(ts.pre_settle, scale, item.pre_settle);
+				for (uint32_t i = 0; i < 10 && bOK; i++)
+					bOK = to_fixed(ts.bid_prices[i], scale, item.bid_prices[i]) && to_fixed(ts.ask_prices[i], scale, item.ask_prices[i]);
+
+				if (!bOK)
+				{
+					bPxFailed = true;
+					break;
+				}
+			}
+
+			if (!bPxFailed)
+				return true;
+		}
+
+		out.clear();
+		return false;
+	}
+
+	static bool decode_ticks(const char* data, std::size_t len, std::string& out)
+	{
+		if (len < sizeof(CompactBlockInfo))
+			return false;
+
+		const CompactBlockInfo* info = (const CompactBlockInfo*)data;
+		if (len != sizeof(CompactBlockInfo) + sizeof(WTSTickCompact)*info->_count || info->_precision > COMPACT_MAX_PRECISION)
+			return false;
+
+		const WTSTickCompact* items = (const WTSTickCompact*)(data + sizeof(CompactBlockInfo));
+		double scale = scale_of(info->_precision);
+		out.resize(sizeof(WTSTickStruct)*info->_count);
+		WTSTickStruct* ticks = (WTSTickStruct*)out.data();
+		for (uint32_t idx = 0; idx < info->_count; idx++)
+		{
+			WTSTickStruct* ts = new(&ticks[idx]) WTSTickStruct();
+			strcpy(ts->exchg, info->_exchg);
+			strcpy(ts->code, info->_code);
+			decode_tick(items[idx], scale, *ts);
+		}
+
+		return true;
+	}
+
+	/*
+	 *	只还原数值字段,代码由调用方填
+	 */
+	static inline void decode_tick(const WTSTickCompact& item, double scale, WTSTickStruct& ts)
+	{
+		ts.price = to_price(item.price, scale);
+		ts.open = to_price(item.open, scale);
+		ts.high = to_price(item.high, scale);
+		ts.low = to_price(item.low, scale);
+		ts.settle_price = to_price(item.settle_price, scale);
+		ts.upper_limit = to_price(item.upper_limit, scale);
+		ts.lower_limit = to_price(item.lower_limit, scale);
+		ts.pre_close = to_price(item.pre_close, scale);
+		ts.pre_settle = to_price(item.pre_settle, scale);
+
+		ts.total_volume = item.total_volume;
+		ts.volume = item.volume;
+		ts.total_turnover = item.total_turnover;
+		ts.turn_over = item.turn_over;
+		ts.open_interest = item.open_interest;
+		ts.diff_interest = item.diff_interest;
+		ts.pre_interest = item.pre_interest;
+
+		ts.trading_date = item.trading_date;
+		ts.action_date = item.action_date;
+		ts.action_time = item.action_time;
+
+		for (uint32_t i = 0; i < 10; i++)
+		{
+			ts.bid_prices[i] = to_price(item.bid_prices[i], scale);
+			ts.ask_prices[i] = to_price(item.ask_prices[i], scale);
+			ts.bid_qty[i] = item.bid_qty[i];
+			ts.ask_qty[i] = item.ask_qty[i];
+		}
+	}
+};
+
+/*
+ *	紧凑K线的只读视图,不整体还原,按需读取单个字段
+ *	适合只扫描收盘价、成交量这类少数几个字段的场景
+ */
+class WtCompactBars
+{
+public:
+	WtCompactBars() :_items(NULL), _count(0), _scale(1) {}
+
+	bool attach(const char* data, std::size_t len)
+	{
+		if (len < sizeof(CompactBlockInfo))
+			return false;
+
+		const CompactBlockInfo* info = (const CompactBlockInfo*)data;
+		if (len != sizeof(CompactBlockInfo) + sizeof(WTSBarCompact)*info->_count || info->_precision > COMPACT_MAX_PRECISION)
+			return false;
+
+		_items = (const WTSBarCompact*)(data + sizeof(CompactBlockInfo));
+		_count = info->_count;
+		_scale = WtCompactCodec::scale_of(info->_precision);
+		return true;
+	}
+
+	inline uint32_t size() const { return _count; }
+	inline double	scale() const { return _scale; }
+
+	inline const WTSBarCompact& at(uint32_t idx) const { return _items[idx]; }
+
+	inline double open(uint32_t idx) const { return WtCompactCodec::to_price(_items[idx].open, _scale); }
+	inline double high(uint32_t idx) const { return WtCompactCodec::to_price(_items[idx].high, _scale); }
+	inline double low(uint32_t idx) const { return WtCompactCodec::to_price(_items[idx].low, _scale); }
+	inline double close(uint32_t idx) const { return WtCompactCodec::to_price(_items[idx].close, _scale); }
+	inline double volume(uint32_t idx) const { return _items[idx].vol; }
+
+	inline void	get_bar(uint32_t idx, WTSBarStruct& bar) const { WtCompactCodec::decode_bar(_items[idx], _scale, bar); }
+
+private:
+	const WTSBarCompact*	_items;
+	uint32_t				_count;
+	double					_scale;
+};
+
+class WtCompactTicks
+{
+public:
+	WtCompactTicks() :_info(NULL), _items(NULL), _scale(1) {}
+
+	bool attach(const char* data, std::size_t len)
+	{
+		if (len < sizeof(CompactBlockInfo))
+			return false;
+
+		const CompactBlockInfo* info = (const CompactBlockInfo*)data;
+		if (len != sizeof(CompactBlockInfo) + sizeof(WTSTickCompact)*info->_count || info->_precision > COMPACT_MAX_PRECISION)
+			return false;
+
+		_info = info;
+		_items = (const WTSTickCompact*)(data + sizeof(CompactBlockInfo));
+		_scale = WtCompactCodec::scale_of(info->_precision);
+		return true;
+	}
+
+	inline uint32_t size() const { return _info ? _info->_count : 0; }
+
+	inline const WTSTickCompact& at(uint32_t idx) const { return _items[idx]; }
+
+	inline double price(uint32_t idx) const { return WtCompactCodec::to_price(_items[idx].price, _scale); }
+	inline double bid_price(uint32_t idx, uint32_t level = 0) const { return WtCompactCodec::to_price(_items[idx].bid_prices[level], _scale); }
+	inline double ask_price(uint32_t idx, uint32_t level = 0) const { return WtCompactCodec::to_price(_items[idx].ask_prices[level], _scale); }
+	inline double volume(uint32_t idx) const { return _items[idx].volume; }
+
+	inline void	get_tick(uint32_t idx, WTSTickStruct& ts) const
+	{
+		strcpy(ts.exchg, _info->_exchg);
+		strcpy(ts.code, _info->_code);
+		WtCompactCodec::decode_tick(_items[idx], _scale, ts);
+	}
+
+private:
+	const CompactBlockInfo*	_info;
+	const WTSTickCompact*	_items;
+	double					_scale;
+};
+
+NS_WTP_END
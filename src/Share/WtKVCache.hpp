@@ -4,8 +4,21 @@
 #include "BoostMappingFile.hpp"
 #include "../Includes/FasterDefs.h"
 
-#define SIZE_STEP 200
-#define CACHE_FLAG "&^%$#@!\0"
+#include <atomic>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+/*
+ *	缓存文件直接就是一张开放寻址的哈希表,加载的时候不再需要重建索引
+ *	读不加锁,写入方加锁,扩容的时候新建一个文件重新散列,旧的映射保留到关闭,读线程不会读到失效的地址
+ *	每个条目记录写入时的交易日,换日的时候按照保留的交易日数淘汰旧条目并压缩文件
+ */
+#define KV_INIT_CAPACITY	1024	//初始槽位数,必须是2的幂
+#define KV_MAX_DAYS			8		//最多保留的交易日数
+#define CACHE_FLAG_V2		"WTKVHT2\0"
+#define CACHE_FLAG			"&^%$#@!\0"	//老版本顺序存储的缓存文件标记,加载的时候自动转换
 #define FLAG_SIZE 8
 
 typedef std::shared_ptr<BoostMappingFile> BoostMFPtr;
@@ -19,18 +32,19 @@ typedef std::function<void(const char*)> CacheLogger;
 class WtKVCache
 {
 public:
-	WtKVCache() {}
+	WtKVCache() :_block(NULL), _keep_days(1) {}
 	WtKVCache(const WtKVCache&) = delete;
 	WtKVCache& operator=(const WtKVCache&) = delete;
 
 private:
-	
-
-	typedef struct _CacheItem
+	typedef struct _CacheSlot
 	{
-		char	_key[64] = { 0 };
-		char	_val[64] = { 0 };
-	} CacheItem;
+		std::atomic<uint64_t>	_hash;	//0表示空槽位,key和val写好以后最后写入
+		uint32_t	_date;
+		std::atomic<uint32_t>	_seq;	//覆盖写入的序号,奇数表示正在写,读线程据此判断有没有读到一半的值
+		char		_key[64];
+		char		_val[64];
+	} CacheSlot;
 
 	typedef struct CacheBlock
 	{
@@ -38,213 +52,553 @@ private:
 		uint32_t	_size;
 		uint32_t	_capacity;
 		uint32_t	_date;
-		CacheItem	_items[0];
+		uint32_t	_days[KV_MAX_DAYS];	//最近的交易日,从新到旧
+		uint32_t	_reserve[3];
+		CacheSlot	_slots[0];
 	} CacheBlock;
 
-	typedef struct _CacheBlockPair
+	//老版本的缓存文件格式
+	typedef struct _CacheItemV1
 	{
-		CacheBlock*		_block;
-		BoostMFPtr		_file;
+		char	_key[64];
+		char	_val[64];
+	} CacheItemV1;
 
-		_CacheBlockPair()
+	typedef struct _CacheBlockV1
+	{
+		char		_blk_flag[FLAG_SIZE];
+		uint32_t	_size;
+		uint32_t	_capacity;
+		uint32_t	_date;
+		CacheItemV1	_items[0];
+	} CacheBlockV1;
+
+	std::string					_filename;
+	std::atomic<CacheBlock*>	_block;
+	BoostMFPtr					_file;
+	std::vector<BoostMFPtr>		_retired;	//扩容前的映射,读线程可能还在用,关闭的时候才释放
+	SpinMutex					_lock;
+	uint32_t					_keep_days;
+
+private:
+	static inline uint64_t hash_key(const char* key)
+	{
+		uint64_t h = 14695981039346656037ULL;
+		for (const unsigned char* p = (const unsigned char*)key; *p != '\0'; p++)
 		{
-			_block = NULL;
-			_file = NULL;
+			h ^= *p;
+			h *= 1099511628211ULL;
 		}
-	} CacheBlockPair;
 
-	CacheBlockPair	_cache;
-	SpinMutex		_lock;
-	wt_hashmap<std::string, uint32_t> _indice;
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return (h == 0) ? 1 : h;
+	}
 
-private:
-	bool	resize(uint32_t newCap, CacheLogger logger = nullptr)
+	static inline uint64_t file_size(uint32_t capacity)
+	{
+		return sizeof(CacheBlock) + sizeof(CacheSlot)*(uint64_t)capacity;
+	}
+
+	static inline std::string gen_filename(const std::string& filename, uint32_t capacity)
+	{
+		return filename + "." + std::to_string(capacity);
+	}
+
+	/*
+	 *	key要完整存下来才能比较,放不下的不支持
+	 */
+	static inline bool valid_key(const char* key)
+	{
+		return key != NULL && strlen(key) < sizeof(CacheSlot::_key);
+	}
+
+	/*
+	 *	清空所有槽位
+	 *	槽位里有原子变量,逐个字段复位,不直接memset
+	 */
+	static inline void reset_slots(CacheBlock* cBlock)
+	{
+		for (uint32_t i = 0; i < cBlock->_capacity; i++)
+		{
+			CacheSlot& slot = cBlock->_slots[i];
+			slot._hash.store(0, std::memory_order_relaxed);
+			slot._seq.store(0, std::memory_order_relaxed);
+			slot._date = 0;
+			memset(slot._key, 0, sizeof(slot._key));
+			memset(slot._val, 0, sizeof(slot._val));
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	/*
+	 *	查找key所在的槽位,没有则返回应该插入的空槽位
+	 */
+	static inline CacheSlot* find_slot(CacheBlock* cBlock, const char* key, uint64_t h)
 	{
-		if (_cache._file == NULL)
+		uint32_t mask = cBlock->_capacity - 1;
+		uint32_t idx = (uint32_t)h & mask;
+		for (uint32_t i = 0; i < cBlock->_capacity; i++)
+		{
+			CacheSlot& slot = cBlock->_slots[idx];
+			uint64_t sh = slot._hash.load(std::memory_order_acquire);
+			if (sh == 0)
+				return &slot;
+
+			if (sh == h && strcmp(slot._key, key) == 0)
+				return &slot;
+
+			idx = (idx + 1) & mask;
+		}
+
+		return NULL;
+	}
+
+	static inline bool insert_slot(CacheBlock* cBlock, const char* key, const char* val, uint32_t uDate, uint64_t h, std::size_t len = 0)
+	{
+		CacheSlot* slot = find_slot(cBlock, key, h);
+		if (slot == NULL)
 			return false;
 
-		//调用该函数之前,应该保证线程安全了
-		CacheBlock* cBlock = _cache._block;
-		if (cBlock->_capacity >= newCap)
-			return _cache._file->addr();
+		bool isNew = (slot->_hash.load(std::memory_order_relaxed) == 0);
+		if (isNew)
+		{
+			wt_strcpy(slot->_key, key);
+			wt_strcpy(slot->_val, val, len);
+			slot->_date = uDate;
+			slot->_hash.store(h, std::memory_order_release);
+			cBlock->_size += 1;
+			return true;
+		}
+
+		//已有的key原地覆盖,前后各加一次序号
+		uint32_t seq = slot->_seq.load(std::memory_order_relaxed);
+		slot->_seq.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		wt_strcpy(slot->_val, val, len);
+		slot->_date = uDate;
+		slot->_seq.store(seq + 2, std::memory_order_release);
+		return true;
+	}
 
-		std::string filename = _cache._file->filename();
-		uint64_t uOldSize = sizeof(CacheBlock) + sizeof(CacheItem)*cBlock->_capacity;
-		uint64_t uNewSize = sizeof(CacheBlock) + sizeof(CacheItem)*newCap;
-		std::string data;
-		data.resize((std::size_t)(uNewSize - uOldSize), 0);
+	static BoostMFPtr map_file(const char* filename, CacheLogger logger)
+	{
+		BoostMFPtr mf(new BoostMappingFile);
 		try
 		{
-			BoostFile f;
-			f.open_existing_file(filename.c_str());
-			f.seek_to_end();
-			f.write_file(data.c_str(), data.size());
-			f.close_file();
+			if (!mf->map(filename))
+			{
+				if (logger) logger("Mapping cache file failed");
+				return BoostMFPtr();
+			}
 		}
 		catch (std::exception&)
 		{
-			if (logger) logger("Got an exception while resizing cache file");
-			return false;
+			if (logger) logger("Got an exception while mapping cache file");
+			return BoostMFPtr();
 		}
 
+		return mf;
+	}
 
-		_cache._file.reset();
-		BoostMappingFile* pNewMf = new BoostMappingFile();
+	static bool create_file(const char* filename, uint32_t capacity, CacheLogger logger)
+	{
 		try
 		{
-			if (!pNewMf->map(filename.c_str()))
+			BoostFile bf;
+			if (!bf.create_new_file(filename))
 			{
-				delete pNewMf;
-				if (logger) logger("Mapping cache file failed");
+				if (logger) logger("Creating cache file failed");
 				return false;
 			}
+			bf.truncate_file((std::size_t)file_size(capacity));
+			bf.close_file();
 		}
 		catch (std::exception&)
 		{
-			if (logger) logger("Got an exception while mapping cache file");
+			if (logger) logger("Got an exception while creating cache file");
 			return false;
 		}
 
-		_cache._file.reset(pNewMf);
+		return true;
+	}
+
+	/*
+	 *	新建一个容量为newCap的文件,把minDate及以后的条目重新散列进去
+	 *	扩容和压缩都走这里,调用该函数之前,应该保证线程安全了
+	 */
+	bool	rebuild(uint32_t newCap, uint32_t minDate, CacheLogger logger = nullptr)
+	{
+		CacheBlock* cBlock = _block.load(std::memory_order_relaxed);
+		std::string newFile = gen_filename(_filename, newCap);
+		if (!create_file(newFile.c_str(), newCap, logger))
+			return false;
+
+		BoostMFPtr mf = map_file(newFile.c_str(), logger);
+		if (mf == NULL)
+			return false;
+
+		CacheBlock* nBlock = (CacheBlock*)mf->addr();
+		nBlock->_capacity = newCap;
+		nBlock->_size = 0;
+		nBlock->_date = cBlock->_date;
+		memcpy(nBlock->_days, cBlock->_days, sizeof(nBlock->_days));
+		for (uint32_t i = 0; i < cBlock->_capacity; i++)
+		{
+			CacheSlot& slot = cBlock->_slots[i];
+			uint64_t h = slot._hash.load(std::memory_order_acquire);
+			if (h == 0 || slot._date < minDate)
+				continue;
+
+			insert_slot(nBlock, slot._key, slot._val, slot._date, h);
+		}
+		//标记最后写入,中途崩溃的文件下次启动的时候会被丢弃
+		memcpy(nBlock->_blk_flag, CACHE_FLAG_V2, FLAG_SIZE);
+		mf->sync();
+
+		_block.store(nBlock, std::memory_order_release);
+		if (_file)
+			_retired.emplace_back(_file);
+		_file = mf;
+
+		//windows下被映射的文件不能替换,留给下次启动的时候处理
+		try
+		{
+			boost::filesystem::rename(newFile, _filename);
+		}
+		catch (std::exception&)
+		{
+			if (logger) logger("Cache file will be replaced on next start");
+		}
 
-		_cache._block = (CacheBlock*)_cache._file->addr();
-		_cache._block->_capacity = newCap;
 		return true;
 	}
 
-public:
-	bool	init(const char* filename, uint32_t uDate, CacheLogger logger = nullptr)
+	/*
+	 *	上次扩容的时候如果没能替换原文件,以最大的那个有效文件为准
+	 */
+	void	adopt_gen_files(CacheLogger logger)
 	{
-		bool isNew = false;
-		if (!BoostFile::exists(filename))
+		std::string adopted;
+		for (uint32_t cap = KV_INIT_CAPACITY; cap != 0 && cap <= 0x80000000; cap <<= 1)
 		{
-			uint64_t uSize = sizeof(CacheBlock) + sizeof(CacheItem) * SIZE_STEP;
-			BoostFile bf;
-			bf.create_new_file(filename);
-			bf.truncate_file((uint32_t)uSize);
-			bf.close_file();
+			std::string genFile = gen_filename(_filename, cap);
+			if (!BoostFile::exists(genFile.c_str()))
+				continue;
+
+			bool bValid = false;
+			{
+				BoostMFPtr mf = map_file(genFile.c_str(), logger);
+				if (mf && mf->size() == file_size(cap))
+					bValid = (memcmp(((CacheBlock*)mf->addr())->_blk_flag, CACHE_FLAG_V2, FLAG_SIZE) == 0);
+			}
 
-			isNew = true;
+			if (bValid)
+			{
+				if (!adopted.empty())
+					BoostFile::delete_file(adopted.c_str());
+				adopted = genFile;
+			}
+			else
+			{
+				BoostFile::delete_file(genFile.c_str());
+			}
 		}
 
-		_cache._file.reset(new BoostMappingFile);
-		if (!_cache._file->map(filename))
+		if (adopted.empty())
+			return;
+
+		try
+		{
+			boost::filesystem::rename(adopted, _filename);
+			if (logger) logger("Cache file replaced by the resized one");
+		}
+		catch (std::exception&)
 		{
-			_cache._file.reset();
-			if (logger) logger("Mapping cache file failed");
+			if (logger) logger("Replacing cache file failed");
+		}
+	}
+
+	/*
+	 *	老版本的缓存文件转换成哈希表,不是同一个交易日的直接丢弃
+	 */
+	bool	upgrade_v1(uint32_t uDate, CacheLogger logger)
+	{
+		std::vector<CacheItemV1> items;
+		{
+			BoostMFPtr mf = map_file(_filename.c_str(), logger);
+			if (mf == NULL)
+				return false;
+
+			CacheBlockV1* oBlock = (CacheBlockV1*)mf->addr();
+			uint64_t realCap = (mf->size() - sizeof(CacheBlockV1)) / sizeof(CacheItemV1);
+			uint32_t oSize = (uint32_t)(std::min<uint64_t>)(oBlock->_size, realCap);
+			if (oBlock->_date == uDate)
+				items.assign(oBlock->_items, oBlock->_items + oSize);
+		}
+
+		uint32_t cap = KV_INIT_CAPACITY;
+		while ((uint64_t)items.size() * 4 >= (uint64_t)cap * 3)
+			cap <<= 1;
+
+		BoostFile::delete_file(_filename.c_str());
+		if (!create_file(_filename.c_str(), cap, logger))
+			return false;
+
+		BoostMFPtr mf = map_file(_filename.c_str(), logger);
+		if (mf == NULL)
 			return false;
+
+		CacheBlock* nBlock = (CacheBlock*)mf->addr();
+		nBlock->_capacity = cap;
+		nBlock->_date = uDate;
+		nBlock->_days[0] = uDate;
+		for (CacheItemV1& item : items)
+		{
+			item._key[63] = '\0';
+			item._val[63] = '\0';
+			insert_slot(nBlock, item._key, item._val, uDate, hash_key(item._key));
+		}
+		memcpy(nBlock->_blk_flag, CACHE_FLAG_V2, FLAG_SIZE);
+
+		if (logger) logger("Cache file upgraded to hash table");
+		return true;
+	}
+
+public:
+	/*
+	 *	初始化
+	 *	filename	缓存文件
+	 *	uDate		当前交易日
+	 *	keepDays	保留最近几个交易日的条目,默认只保留当天的
+	 */
+	bool	init(const char* filename, uint32_t uDate, CacheLogger logger = nullptr, uint32_t keepDays = 1)
+	{
+		_filename = filename;
+		_keep_days = (std::max<uint32_t>)(1, (std::min<uint32_t>)(keepDays, KV_MAX_DAYS));
+		_retired.clear();
+		_file.reset();
+		_block = NULL;
+
+		adopt_gen_files(logger);
+
+		if (BoostFile::exists(filename))
+		{
+			char flag[FLAG_SIZE] = { 0 };
+			{
+				BoostFile bf;
+				if (bf.open_existing_file(filename))
+					bf.read_file(flag, FLAG_SIZE);
+			}
+
+			if (memcmp(flag, CACHE_FLAG, FLAG_SIZE - 1) == 0)
+			{
+				if (!upgrade_v1(uDate, logger))
+					return false;
+			}
+			else if (memcmp(flag, CACHE_FLAG_V2, FLAG_SIZE) != 0)
+			{
+				//文件损坏,重新创建
+				BoostFile::delete_file(filename);
+				if (logger) logger("Invalid cache file removed");
+			}
 		}
-		_cache._block = (CacheBlock*)_cache._file->addr();
 
-		if (!isNew &&  _cache._block->_date != uDate)
+		if (!BoostFile::exists(filename))
 		{
-			 _cache._block->_size = 0;
-			 _cache._block->_date = uDate;
+			if (!create_file(filename, KV_INIT_CAPACITY, logger))
+				return false;
 
-			memset(& _cache._block->_items, 0, sizeof(CacheItem)* _cache._block->_capacity);
+			BoostMFPtr mf = map_file(filename, logger);
+			if (mf == NULL)
+				return false;
 
-			if (logger) logger("Cache file reset due to a different date");
+			CacheBlock* cBlock = (CacheBlock*)mf->addr();
+			cBlock->_capacity = KV_INIT_CAPACITY;
+			cBlock->_date = uDate;
+			cBlock->_days[0] = uDate;
+			memcpy(cBlock->_blk_flag, CACHE_FLAG_V2, FLAG_SIZE);
 		}
 
-		if (isNew)
+		_file = map_file(filename, logger);
+		if (_file == NULL)
+			return false;
+
+		CacheBlock* cBlock = (CacheBlock*)_file->addr();
+		if (_file->size() != file_size(cBlock->_capacity) || (cBlock->_capacity & (cBlock->_capacity - 1)) != 0)
 		{
-			 _cache._block->_capacity = SIZE_STEP;
-			 _cache._block->_size = 0;
-			 _cache._block->_date = uDate;
-			strcpy( _cache._block->_blk_flag, CACHE_FLAG);
+			//哈希表的容量不对就没法定位了,只能重建
+			_file.reset();
+			BoostFile::delete_file(filename);
+			if (logger) logger("Cache file size mismatch, rebuilding");
+			return init(filename, uDate, logger, keepDays);
 		}
-		else
+		_block = cBlock;
+
+		if (cBlock->_date != uDate)
 		{
-			//检查缓存文件是否有问题,要自动恢复
-			do
+			uint32_t minDate = uDate;
+			if (uDate > cBlock->_date)
+			{
+				memmove(cBlock->_days + 1, cBlock->_days, sizeof(uint32_t)*(KV_MAX_DAYS - 1));
+				cBlock->_days[0] = uDate;
+				minDate = cBlock->_days[_keep_days - 1];
+			}
+			else
+			{
+				//交易日往回走了,只能全部清掉
+				memset(cBlock->_days, 0, sizeof(cBlock->_days));
+				cBlock->_days[0] = uDate;
+			}
+			cBlock->_date = uDate;
+
+			if (minDate == uDate)
 			{
-				uint64_t uSize = sizeof(CacheBlock) + sizeof(CacheItem) *  _cache._block->_capacity;
-				uint64_t realSz =  _cache._file->size();
-				if (realSz != uSize)
+				reset_slots(cBlock);
+				cBlock->_size = 0;
+				if (logger) logger("Cache file reset due to a different date");
+			}
+			else
+			{
+				//剩下的条目重新散列到一个合适大小的表里
+				uint32_t remains = 0;
+				for (uint32_t i = 0; i < cBlock->_capacity; i++)
 				{
-					uint32_t realCap = (uint32_t)((realSz - sizeof(CacheBlock)) / sizeof(CacheItem));
-					uint32_t markedCap =  _cache._block->_capacity;
-					//文件大小不匹配,一般是因为capacity改了,但是实际没扩容
-					//这是做一次扩容即可
-					 _cache._block->_capacity = realCap;
-					 _cache._block->_size = (realCap < markedCap) ? realCap : markedCap;
+					CacheSlot& slot = cBlock->_slots[i];
+					if (slot._hash != 0 && slot._date >= minDate)
+						remains++;
 				}
 
-			} while (false);
-		}
+				uint32_t newCap = KV_INIT_CAPACITY;
+				while ((uint64_t)remains * 4 >= (uint64_t)newCap * 3)
+					newCap <<= 1;
 
-		//这里把索引加到hashmap中
-		for (uint32_t i = 0; i < _cache._block->_size; i++)
-			_indice[_cache._block->_items[i]._key] = i;
+				if (remains != cBlock->_size)
+				{
+					if (!rebuild(newCap, minDate, logger))
+						return false;
+
+					_retired.clear();
+					if (logger) logger("Cache file compacted, expired items removed");
+				}
+			}
+		}
 
 		return true;
 	}
 
 	inline void clear()
 	{
-		_lock.lock();
-
-		if (_cache._block == NULL)
+		CacheBlock* cBlock = _block.load(std::memory_order_acquire);
+		if (cBlock == NULL)
 			return;
 
-		_indice.clear();
-
-		memset(_cache._block->_items, 0, sizeof(CacheItem)*_cache._block->_capacity);
-		_cache._block->_size = 0;
-
+		_lock.lock();
+		reset_slots(cBlock);
+		cBlock->_size = 0;
 		_lock.unlock();
 	}
 
+	/*
+	 *	读取key对应的值
+	 *	写入方可能同时在覆盖这个值,所以拷贝到当前线程的缓冲区里再返回
+	 *	返回的地址在当前线程下一次get之前有效
+	 */
 	inline const char*	get(const char* key) const
 	{
-		auto it = _indice.find(key);
-		if (it == _indice.end())
+		CacheBlock* cBlock = _block.load(std::memory_order_acquire);
+		if (cBlock == NULL || !valid_key(key))
+			return "";
+
+		CacheSlot* slot = find_slot(cBlock, key, hash_key(key));
+		if (slot == NULL || slot->_hash.load(std::memory_order_acquire) == 0)
 			return "";
 
-		return _cache._block->_items[it->second]._val;
+		thread_local static char buf[sizeof(slot->_val)];
+		for (;;)
+		{
+			uint32_t seq = slot->_seq.load(std::memory_order_acquire);
+			if (seq & 1)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			memcpy(buf, slot->_val, sizeof(buf));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot->_seq.load(std::memory_order_relaxed) == seq)
+				break;
+		}
+		buf[sizeof(buf) - 1] = '\0';
+		return buf;
 	}
 
+	/*
+	 *	写入key对应的值
+	 *	key超过63个字符的不写入,截断以后不同的key会混在一起
+	 */
 	void	put(const char* key, const char*val, std::size_t len = 0, CacheLogger logger = nullptr)
 	{
-		auto it = _indice.find(key);
-		if (it != _indice.end())
+		if (!valid_key(key))
 		{
-			wt_strcpy(_cache._block->_items[it->second]._val, val, len);
+			if (logger) logger("Key too long, ignored");
+			return;
 		}
-		else
-		{
-			_lock.lock();
-			if(_cache._block->_size == _cache._block->_capacity)
-				resize(_cache._block->_capacity*2, logger);
 
-			_indice[key] = _cache._block->_size;
-			wt_strcpy(_cache._block->_items[_cache._block->_size]._key, key);
-			wt_strcpy(_cache._block->_items[_cache._block->_size]._val, val, len);
-			_cache._block->_size += 1;
+		uint64_t h = hash_key(key);
+
+		_lock.lock();
+		CacheBlock* cBlock = _block.load(std::memory_order_relaxed);
+		if (cBlock == NULL)
+		{
 			_lock.unlock();
+			return;
+		}
+
+		//新的key负载超过3/4就扩容
+		CacheSlot* slot = find_slot(cBlock, key, h);
+		bool isNew = (slot == NULL || slot->_hash.load(std::memory_order_relaxed) == 0);
+		if (isNew && (uint64_t)(cBlock->_size + 1) * 4 > (uint64_t)cBlock->_capacity * 3)
+		{
+			if (rebuild(cBlock->_capacity * 2, 0, logger))
+				cBlock = _block.load(std::memory_order_relaxed);
+		}
+
+		if (!insert_slot(cBlock, key, val, cBlock->_date, h, len))
+		{
+			if (logger) logger("Cache is full");
 		}
+		_lock.unlock();
 	}
 
-	inline bool	has(const char* key) const 
+	inline bool	has(const char* key) const
 	{
-		return (_indice.find(key) != _indice.end());
+		CacheBlock* cBlock = _block.load(std::memory_order_acquire);
+		if (cBlock == NULL || !valid_key(key))
+			return false;
+
+		CacheSlot* slot = find_slot(cBlock, key, hash_key(key));
+		return (slot != NULL && slot->_hash.load(std::memory_order_acquire) != 0);
 	}
 
 	inline uint32_t size() const
 	{
-		if (_cache._block == 0)
+		CacheBlock* cBlock = _block.load(std::memory_order_acquire);
+		if (cBlock == NULL)
 			return 0;
 
-		return _cache._block->_size;
+		return cBlock->_size;
 	}
 
 	inline uint32_t capacity() const
 	{
-		if (_cache._block == 0)
+		CacheBlock* cBlock = _block.load(std::memory_order_acquire);
+		if (cBlock == NULL)
 			return 0;
 
-		return _cache._block->_capacity;
+		return cBlock->_capacity;
 	}
 };
 
-NS_WTP_END
\ No newline at end of file
+NS_WTP_END
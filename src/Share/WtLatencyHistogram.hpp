@@ -0,0 +1,153 @@
+﻿/*!
+ * \file WtLatencyHistogram.hpp
+ * \project	WonderTrader
+ *
+ * \brief 耗时统计直方图
+ */
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include "../Includes/WTSMarcos.h"
+#include "fmtlib.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+NS_WTP_BEGIN
+
+/*
+ *	对数-线性分桶的直方图,思路和HdrHistogram一样
+ *	每个2的幂次区间再细分成8个子桶,相对误差在12.5%以内
+ *	记录只有一次位运算和一次自增,不分配内存,可以直接放在热路径上
+ *	不是线程安全的,每个线程/每个模块各自持有一个,需要汇总的时候再merge
+ */
+class WtLatencyHistogram
+{
+public:
+	static const uint32_t SUB_BITS = 3;
+	static const uint32_t SUB_COUNT = 1 << SUB_BITS;
+	static const uint32_t BUCKET_COUNT = 64 * SUB_COUNT;
+
+public:
+	WtLatencyHistogram() { reset(); }
+
+	inline void reset()
+	{
+		memset(_buckets, 0, sizeof(_buckets));
+		_count = 0;
+		_total = 0;
+		_max = 0;
+		_min = UINT64_MAX;
+	}
+
+	inline void record(uint64_t val)
+	{
+		_buckets[index_of(val)]++;
+		_count++;
+		_total += val;
+		if (val > _max) _max = val;
+		if (val < _min) _min = val;
+	}
+
+	inline void merge(const WtLatencyHistogram& other)
+	{
+		for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+			_buckets[i] += other._buckets[i];
+
+		_count += other._count;
+		_total += other._total;
+		if (other._max > _max) _max = other._max;
+		if (other._min < _min) _min = other._min;
+	}
+
+	inline uint64_t count() const { return _count; }
+	inline uint64_t max() const { return _max; }
+	inline uint64_t min() const { return _count == 0 ? 0 : _min; }
+	inline double	mean() const { return _count == 0 ? 0.0 : (double)_total / _count; }
+
+	/*
+	 *	分位数,返回所在桶的上界
+	 *	pct	百分比,如99.9
+	 */
+	inline uint64_t percentile(double pct) const
+	{
+		if (_count == 0)
+			return 0;
+
+		uint64_t target = (uint64_t)(_count * pct / 100.0 + 0.5);
+		if (target == 0) target = 1;
+		uint64_t acc = 0;
+		for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+		{
+			acc += _buckets[i];
+			if (acc >= target)
+			{
+				uint64_t upper = upper_of(i);
+				return upper > _max ? _max : upper;
+			}
+		}
+
+		return _max;
+	}
+
+	/*
+	 *	输出摘要,用于写日志
+	 */
+	inline std::string summary() const
+	{
+		return fmt::format("count: {}, mean: {:.1f}, min: {}, p50: {}, p90: {}, p99: {}, p99.9: {}, max: {}",
+			_count, mean(), min(), percentile(50), percentile(90), percentile(99), percentile(99.9), _max);
+	}
+
+	inline const uint64_t* buckets() const { return _buckets; }
+
+	/*
+	 *	桶i的上界(包含)
+	 */
+	static inline uint64_t upper_of(uint32_t idx)
+	{
+		uint32_t exp = idx >> SUB_BITS;
+		uint32_t sub = idx & (SUB_COUNT - 1);
+		if (exp == 0)
+			return sub;
+
+		//exp对应的区间是[2^(exp+SUB_BITS-1), 2^(exp+SUB_BITS))
+		uint32_t shift = exp - 1;
+		uint64_t base = (uint64_t)(SUB_COUNT | sub) << shift;
+		return base + ((uint64_t)1 << shift) - 1;
+	}
+
+	static inline uint32_t index_of(uint64_t val)
+	{
+		if (val < SUB_COUNT)
+			return (uint32_t)val;
+
+		uint32_t msb = 63 - clz64(val);
+		uint32_t shift = msb - SUB_BITS;
+		uint32_t sub = (uint32_t)(val >> shift) & (SUB_COUNT - 1);
+		return ((shift + 1) << SUB_BITS) | sub;
+	}
+
+private:
+	static inline uint32_t clz64(uint64_t val)
+	{
+#ifdef _MSC_VER
+		unsigned long idx = 0;
+		_BitScanReverse64(&idx, val);
+		return 63 - idx;
+#else
+		return (uint32_t)__builtin_clzll(val);
+#endif
+	}
+
+private:
+	uint64_t	_buckets[BUCKET_COUNT];
+	uint64_t	_count;
+	uint64_t	_total;
+	uint64_t	_max;
+	uint64_t	_min;
+};
+
+NS_WTP_END
@@ -0,0 +1,156 @@
+﻿/*!
+ * \file WtMpscRing.hpp
+ * \project	WonderTrader
+ *
+ * \brief 多生产者单消费者的定长环形队列
+ */
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include "../Includes/WTSMarcos.h"
+
+NS_WTP_BEGIN
+
+/*
+ *	多生产者单消费者的定长环形队列
+ *	每个槽位带一个序号,生产者用CAS抢占写入位置,写完以后再发布序号,消费者按序号判断槽位是否可读
+ *	槽位在构造的时候一次性分配好,数据直接在槽位里原地填写,入队和出队都不会分配内存
+ *	队列满的时候不等待,直接丢弃并计数,调用方不会被消费者拖慢
+ *	T需要可以默认构造
+ */
+template<typename T>
+class WtMpscRing
+{
+private:
+	typedef struct _Cell
+	{
+		std::atomic<uint64_t>	_seq;
+		T						_data;
+	} Cell;
+
+public:
+	/*
+	 *	capacity	容量,会向上取整到2的幂
+	 */
+	WtMpscRing(uint32_t capacity = 8192) :_cells(NULL), _mask(0), _tail(0)
+	{
+		uint32_t cap = 2;
+		while (cap < capacity)
+			cap <<= 1;
+
+		_mask = cap - 1;
+		_cells.reset(new Cell[cap]);
+		for (uint32_t i = 0; i < cap; i++)
+			_cells[i]._seq.store(i, std::memory_order_relaxed);
+
+		_head.store(0, std::memory_order_relaxed);
+		_dropped.store(0, std::memory_order_relaxed);
+	}
+
+	WtMpscRing(const WtMpscRing&) = delete;
+	WtMpscRing& operator=(const WtMpscRing&) = delete;
+
+	inline uint32_t capacity() const { return _mask + 1; }
+	inline uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+	/*
+	 *	入队,可以在任意线程调用
+	 *	fill	填写数据的回调,形如void(T& data),直接写到槽位里
+	 *
+	 *	返回值	队列满了返回false,计入丢弃的条数
+	 */
+	template<typename FuncFill>
+	inline bool push(FuncFill fill)
+	{
+		if (try_push(fill))
+			return true;
+
+		_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	/*
+	 *	尝试入队,和push一样,只是队列满了不计入丢弃,由调用方决定是等待还是放弃
+	 */
+	template<typename FuncFill>
+	inline bool try_push(FuncFill& fill)
+	{
+		Cell* cell;
+		uint64_t pos = _head.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			cell = &_cells[pos & _mask];
+			uint64_t seq = cell->_seq.load(std::memory_order_acquire);
+			int64_t diff = (int64_t)seq - (int64_t)pos;
+			if (diff == 0)
+			{
+				if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = _head.load(std::memory_order_relaxed);
+			}
+		}
+
+		fill(cell->_data);
+		cell->_seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 *	出队,只能在消费线程调用
+	 *	cb	处理数据的回调,形如void(T& data),回调返回以后槽位才会被复用
+	 *
+	 *	返回值	队列为空返回false
+	 */
+	template<typename FuncConsume>
+	inline bool pop(FuncConsume cb)
+	{
+		Cell* cell = &_cells[_tail & _mask];
+		if (cell->_seq.load(std::memory_order_acquire) != _tail + 1)
+			return false;
+
+		cb(cell->_data);
+		cell->_seq.store(_tail + _mask + 1, std::memory_order_release);
+		_tail++;
+		return true;
+	}
+
+	/*
+	 *	批量出队,只能在消费线程调用
+	 *	maxCnt	最多处理的条数
+	 *
+	 *	返回值	处理的条数
+	 */
+	template<typename FuncConsume>
+	inline uint32_t drain(FuncConsume cb, uint32_t maxCnt = UINT32_MAX)
+	{
+		uint32_t cnt = 0;
+		while (cnt < maxCnt && pop(cb))
+			cnt++;
+		return cnt;
+	}
+
+	/*
+	 *	是否为空,只在消费线程里是准确的
+	 */
+	inline bool empty() const
+	{
+		return _cells[_tail & _mask]._seq.load(std::memory_order_acquire) != _tail + 1;
+	}
+
+private:
+	std::unique_ptr<Cell[]>	_cells;
+	uint64_t				_mask;
+	alignas(64) std::atomic<uint64_t>	_head;		//生产者抢占的写入位置
+	alignas(64) std::atomic<uint64_t>	_dropped;	//队列满了丢弃的条数
+	alignas(64) uint64_t				_tail;		//消费者的读取位置
+};
+
+NS_WTP_END
@@ -0,0 +1,368 @@
+﻿/*!
+ * \file WtPreTradeRisk.hpp
+ * \project	WonderTrader
+ *
+ * \brief 事前风控模块
+ */
+#pragma once
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include <string>
+#include "../Includes/FasterDefs.h"
+#include "WtRateLimiter.hpp"
+#include "WtLatencyHistogram.hpp"
+#include "SpinMutex.hpp"
+
+NS_WTP_BEGIN
+
+typedef enum tagPreTradeResult
+{
+	PTR_PASS = 0,		//通过
+	PTR_ORDER_RATE,		//账户下单频率超限
+	PTR_ORDER_QTY,		//单笔数量超限
+	PTR_NOTIONAL,		//单笔金额超限
+	PTR_POSITION,		//净头寸超限
+	PTR_ACCT_NOTIONAL,	//账户挂单金额超限
+	PTR_PRICE_BAND,		//价格偏离超限
+	PTR_SELF_MATCH		//可能自成交
+} PreTradeResult;
+
+/*
+ *	单个代码的事前风控参数,值为0表示不限制
+ */
+typedef struct _PreTradeLimits
+{
+	double	_max_order_qty;			//单笔最大数量
+	double	_max_order_notional;	//单笔最大金额
+	double	_max_net_pos;			//最大净头寸(含挂单)
+	double	_price_band;			//委托价相对参考价的最大偏离比例
+	bool	_check_selfmatch;		//是否拦截可能自成交的委托
+
+	_PreTradeLimits()
+	{
+		memset(this, 0, sizeof(_PreTradeLimits));
+	}
+} PreTradeLimits;
+
+/*
+ *	事前风控原来散落在TraderAdapter::buy/sell、checkSelfMatch、ActionPolicyMgr和WtSimpleRiskMon里
+ *	这里统一成一个独立的检查环节,放在TraderAdapter::doEntrust里,在调用ITraderApi::orderInsert之前执行
+ *	每个代码一个槽位,存放在连续的vector里,代码到槽位的映射只在第一次访问时建立
+ *	持仓、挂单等状态由订单回报和成交回报增量更新,检查的时候不再做任何查找和内存分配
+ *	WtCore和WtUftCore的TraderAdapter共用这一套逻辑,策略层不需要关心
+ *	检查和回报在不同的线程,所有状态都在一把自旋锁下访问
+ */
+class WtPreTradeRisk
+{
+private:
+	typedef struct _WorkingOrder
+	{
+		uint32_t	_localid;
+		bool		_isBuy;
+		double		_price;
+		double		_left;
+	} WorkingOrder;
+
+	typedef struct _CodeSlot
+	{
+		const PreTradeLimits*	_limits;
+		double		_volscale;
+		double		_net_pos;		//净头寸,多为正,空为负
+		double		_undone_buy;	//未成交买入数量
+		double		_undone_sell;	//未成交卖出数量
+		double		_ref_price;		//参考价,取最近一笔成交价
+		std::vector<WorkingOrder>	_working;
+
+		_CodeSlot() :_limits(NULL), _volscale(1), _net_pos(0), _undone_buy(0), _undone_sell(0), _ref_price(0) {}
+	} CodeSlot;
+
+public:
+	WtPreTradeRisk() :_active(false), _stat_latency(true), _max_working_notional(0), _working_notional(0) {}
+
+	inline bool	is_active() const { return _active; }
+	inline void	set_active(bool bActive) { _active = bActive; }
+
+	inline void	enable_latency_stat(bool bEnabled) { _stat_latency = bEnabled; }
+
+	/*
+	 *	设置账户级别的限制
+	 *	maxWorkingNotional	账户挂单总金额上限
+	 *	orderBoundary		时间窗口内的下单次数上限
+	 *	orderSpan			时间窗口长度(毫秒)
+	 */
+	inline void	set_account_limits(double maxWorkingNotional, uint32_t orderBoundary, uint64_t orderSpan)
+	{
+		_max_working_notional = maxWorkingNotional;
+		if (orderBoundary != 0)
+			_acct_limiter.init(orderBoundary, orderSpan);
+	}
+
+	/*
+	 *	添加风控规则
+	 *	key可以是标准代码,也可以是品种代码(如SHFE.rb),default为默认规则
+	 *	需要在第一次调用slot_of之前设置好
+	 */
+	inline void	add_limits(const char* key, const PreTradeLimits& limits)
+	{
+		_limits_map[key] = limits;
+	}
+
+	/*
+	 *	获取代码对应的槽位,调用方可以把返回值缓存下来
+	 */
+	inline uint32_t slot_of(const char* stdCode, const char* stdCommID, double volscale)
+	{
+		SpinLock lock(_mutex);
+		auto it = _slot_idx.find(stdCode);
+		if (it != _slot_idx.end())
+			return it->second;
+
+		uint32_t idx = (uint32_t)_slots.size();
+		_slots.emplace_back();
+		CodeSlot& slot = _slots.back();
+		slot._volscale = (volscale == 0) ? 1 : volscale;
+		slot._limits = find_limits(stdCode, stdCommID);
+		_slot_idx[stdCode] = idx;
+		return idx;
+	}
+
+	/*
+	 *	检查委托
+	 *	price为0表示市价单,金额按参考价计算
+	 */
+	inline PreTradeResult check(uint32_t idx, bool isBuy, double price, double qty, uint64_t now)
+	{
+		if (!_active)
+			return PTR_PASS;
+
+		SpinLock lock(_mutex);
+		if (!_stat_latency)
+			return do_check(idx, isBuy, price, qty, now);
+
+		auto t0 = std::chrono::steady_clock::now();
+		PreTradeResult ret = do_check(idx, isBuy, price, qty, now);
+		auto t1 = std::chrono::steady_clock::now();
+		_latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+		return ret;
+	}
+
+	/*
+	 *	委托已经发出
+	 */
+	inline void on_entrust(uint32_t idx, uint32_t localid, bool isBuy, double price, double qty, uint64_t now)
+	{
+		if (!_active)
+			return;
+
+		SpinLock lock(_mutex);
+		CodeSlot& slot = _slots[idx];
+		slot._working.emplace_back(WorkingOrder{ localid, isBuy, price, qty });
+		if (isBuy)
+			slot._undone_buy += qty;
+		else
+			slot._undone_sell += qty;
+
+		_working_notional += notional_of(slot, price, qty);
+		_acct_limiter.record(now);
+	}
+
+	/*
+	 *	订单回报,left为剩余未成交数量,订单结束时传0
+	 */
+	inline void on_order(uint32_t idx, uint32_t localid, double left)
+	{
+		if (!_active)
+			return;
+
+		SpinLock lock(_mutex);
+		CodeSlot& slot = _slots[idx];
+		auto& working = slot._working;
+		for (std::size_t i = 0; i < working.size(); i++)
+		{
+			WorkingOrder& wo = working[i];
+			if (wo._localid != localid)
+				continue;
+
+			double diff = wo._left - left;
+			if (diff > 0)
+			{
+				if (wo._isBuy)
+					slot._undone_buy = max_zero(slot._undone_buy - diff);
+				else
+					slot._undone_sell = max_zero(slot._undone_sell - diff);
+
+				_working_notional = max_zero(_working_notional - notional_of(slot, wo._price, diff));
+				wo._left = left;
+			}
+
+			if (left <= 0)
+			{
+				//订单结束了,和最后一个交换以后移除,挂单顺序不影响检查结果
+				working[i] = working.back();
+				working.pop_back();
+			}
+			break;
+		}
+	}
+
+	/*
+	 *	成交回报,不管是不是本系统发出的订单都要更新
+	 */
+	inline void on_trade(uint32_t idx, bool isBuy, double qty, double price)
+	{
+		if (!_active)
+			return;
+
+		SpinLock lock(_mutex);
+		CodeSlot& slot = _slots[idx];
+		slot._net_pos += isBuy ? qty : -qty;
+		if (price > 0)
+			slot._ref_price = price;
+	}
+
+	/*
+	 *	持仓查询以后同步净头寸
+	 */
+	inline void on_position(uint32_t idx, double netPos)
+	{
+		if (!_active)
+			return;
+
+		SpinLock lock(_mutex);
+		_slots[idx]._net_pos = netPos;
+	}
+
+	/*
+	 *	外部行情更新参考价,没有行情的模块可以不调用,会用成交价作为参考价
+	 */
+	inline void on_quote(uint32_t idx, double price)
+	{
+		if (!_active || price <= 0)
+			return;
+
+		SpinLock lock(_mutex);
+		_slots[idx]._ref_price = price;
+	}
+
+	inline const WtLatencyHistogram& latency() const { return _latency; }
+	inline void	reset_latency() { _latency.reset(); }
+
+	static inline const char* result_name(PreTradeResult ret)
+	{
+		switch (ret)
+		{
+		case PTR_PASS: return "pass";
+		case PTR_ORDER_RATE: return "order rate of account beyond boundary";
+		case PTR_ORDER_QTY: return "order qty beyond boundary";
+		case PTR_NOTIONAL: return "order notional beyond boundary";
+		case PTR_POSITION: return "net position beyond boundary";
+		case PTR_ACCT_NOTIONAL: return "working notional of account beyond boundary";
+		case PTR_PRICE_BAND: return "price out of band";
+		case PTR_SELF_MATCH: return "may match with own order";
+		default: return "unknown";
+		}
+	}
+
+private:
+	static inline double max_zero(double v) { return v < 0 ? 0 : v; }
+
+	inline double notional_of(const CodeSlot& slot, double price, double qty) const
+	{
+		if (price == 0)
+			price = slot._ref_price;
+		return price * qty * slot._volscale;
+	}
+
+	inline const PreTradeLimits* find_limits(const char* stdCode, const char* stdCommID) const
+	{
+		auto it = _limits_map.find(stdCode);
+		if (it != _limits_map.end())
+			return &it->second;
+
+		if (stdCommID != NULL)
+		{
+			it = _limits_map.find(stdCommID);
+			if (it != _limits_map.end())
+				return &it->second;
+		}
+
+		it = _limits_map.find("default");
+		if (it != _limits_map.end())
+			return &it->second;
+
+		return NULL;
+	}
+
+	inline PreTradeResult do_check(uint32_t idx, bool isBuy, double price, double qty, uint64_t now) const
+	{
+		//账户级别的检查
+		if (_acct_limiter.would_exceed(now))
+			return PTR_ORDER_RATE;
+
+		const CodeSlot& slot = _slots[idx];
+		double notional = notional_of(slot, price, qty);
+		if (_max_working_notional != 0 && _working_notional + notional > _max_working_notional)
+			return PTR_ACCT_NOTIONAL;
+
+		const PreTradeLimits* limits = slot._limits;
+		if (limits == NULL)
+			return PTR_PASS;
+
+		if (limits->_max_order_qty != 0 && qty > limits->_max_order_qty)
+			return PTR_ORDER_QTY;
+
+		if (limits->_max_order_notional != 0 && notional > limits->_max_order_notional)
+			return PTR_NOTIONAL;
+
+		if (limits->_max_net_pos != 0)
+		{
+			double worst = isBuy ? (slot._net_pos + slot._undone_buy + qty) : (slot._net_pos - slot._undone_sell - qty);
+			if (fabs(worst) > limits->_max_net_pos)
+				return PTR_POSITION;
+		}
+
+		if (limits->_price_band != 0 && price != 0 && slot._ref_price != 0)
+		{
+			if (fabs(price - slot._ref_price) > slot._ref_price * limits->_price_band)
+				return PTR_PRICE_BAND;
+		}
+
+		if (limits->_check_selfmatch)
+		{
+			for (const WorkingOrder& wo : slot._working)
+			{
+				if (wo._isBuy == isBuy)
+					continue;
+
+				//市价单或者价格交叉,都可能和自己的挂单成交
+				if (price == 0 || wo._price == 0)
+					return PTR_SELF_MATCH;
+
+				if (isBuy ? (price >= wo._price) : (price <= wo._price))
+					return PTR_SELF_MATCH;
+			}
+		}
+
+		return PTR_PASS;
+	}
+
+private:
+	bool	_active;
+	bool	_stat_latency;
+
+	wt_hashmap<std::string, PreTradeLimits>	_limits_map;
+	wt_hashmap<std::string, uint32_t>		_slot_idx;
+	std::vector<CodeSlot>	_slots;
+
+	double			_max_working_notional;
+	double			_working_notional;
+	WtRateLimiter	_acct_limiter;
+
+	WtLatencyHistogram	_latency;
+
+	//策略线程下单检查,交易通道的回调线程更新挂单和持仓,槽位和计数器都要加锁
+	SpinMutex		_mutex;
+};
+
+NS_WTP_END
@@ -0,0 +1,135 @@
+﻿/*!
+ * \file WtRateLimiter.hpp
+ * \project	WonderTrader
+ *
+ * \brief 基于环形缓冲区的滑动窗口流量控制器
+ */
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "../Includes/WTSMarcos.h"
+
+NS_WTP_BEGIN
+
+/*
+ *	原来的流控是每个代码一个std::vector<uint64_t>,每次检查要lower_bound,再从头部erase
+ *	做市账户一分钟几千笔的时候,erase的内存搬移就很明显了
+ *	这里改成定长的环形缓冲区,只保留最近boundary+2笔的时间戳
+ *	只要最早的一笔还在时间窗口内,就说明窗口内的次数超过了boundary,和原来的判断逻辑一致
+ *	检查和记录都是O(1)
+ */
+class WtRateLimiter
+{
+public:
+	WtRateLimiter() :_boundary(0), _span(0), _head(0), _size(0), _capacity(0) {}
+
+	/*
+	 *	初始化
+	 *	boundary	时间窗口内允许的最大次数
+	 *	span		时间窗口长度,单位和时间戳保持一致
+	 */
+	inline void init(uint32_t boundary, uint64_t span)
+	{
+		_boundary = boundary;
+		_span = span;
+		_capacity = boundary + 2;
+		_slots.assign(_capacity, 0);
+		_head = 0;
+		_size = 0;
+	}
+
+	inline bool	is_inited() const { return _capacity != 0; }
+
+	/*
+	 *	记录一次操作
+	 */
+	inline void record(uint64_t now)
+	{
+		if (_capacity == 0)
+			return;
+
+		_slots[_head] = now;
+		_head++;
+		if (_head == _capacity)
+			_head = 0;
+
+		if (_size < _capacity)
+			_size++;
+	}
+
+	/*
+	 *	检查是否超限
+	 *	以最后一笔的时间为窗口的结束时间,缓冲区满了且最早的一笔还在窗口内,即为超限
+	 */
+	inline bool exceeded() const
+	{
+		if (_size < _capacity)
+			return false;
+
+		//缓冲区满的时候,_head指向的就是最早的一笔
+		uint64_t sTime = _slots[_head];
+		uint64_t eTime = last();
+		return sTime + _span >= eTime;
+	}
+
+	/*
+	 *	如果在now再记录一笔,是否会超限
+	 *	用于发单之前的预检查,不修改状态
+	 */
+	inline bool would_exceed(uint64_t now) const
+	{
+		if (_capacity == 0 || _size + 1 < _capacity)
+			return false;
+
+		//加上本次以后窗口满了,最早的一笔就是倒数第capacity-1笔
+		uint32_t idx = (_head + 1) % _capacity;
+		if (_size < _capacity)
+			idx = 0;
+		return _slots[idx] + _span >= now;
+	}
+
+	/*
+	 *	时间窗口内的次数(不含最后一笔),只在输出日志的时候用
+	 */
+	inline uint32_t times() const
+	{
+		if (_size == 0)
+			return 0;
+
+		uint64_t eTime = last();
+		uint32_t cnt = 0;
+		for (uint32_t i = 0; i < _size; i++)
+		{
+			if (_slots[i] + _span >= eTime)
+				cnt++;
+		}
+		return cnt - 1;
+	}
+
+	inline uint64_t last() const
+	{
+		if (_size == 0)
+			return 0;
+
+		return _slots[(_head == 0) ? _capacity - 1 : _head - 1];
+	}
+
+	inline uint32_t size() const { return _size; }
+
+	inline void clear()
+	{
+		_head = 0;
+		_size = 0;
+	}
+
+private:
+	uint32_t	_boundary;
+	uint64_t	_span;
+
+	uint32_t	_head;
+	uint32_t	_size;
+	uint32_t	_capacity;
+	std::vector<uint64_t>	_slots;
+};
+
+NS_WTP_END
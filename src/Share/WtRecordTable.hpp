@@ -0,0 +1,283 @@
+﻿/*!
+ * \file WtRecordTable.hpp
+ * \project	WonderTrader
+ *
+ * \brief 定长记录的内存映射表
+ *
+ * 文件头里记录了每一列的名称、numpy类型描述和在记录中的偏移
+ * 外部可以直接按文件头构造dtype,用numpy.memmap从WT_RECTABLE_HEADER_SIZE开始映射,不需要解析
+ */
+#pragma once
+#include "BoostFile.hpp"
+#include "BoostMappingFile.hpp"
+#include "../Includes/WTSMarcos.h"
+
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
+#define WT_RECTABLE_FLAG		"WTRECTB"
+#define WT_RECTABLE_VERSION		1
+#define WT_RECTABLE_HEADER_SIZE	4096
+#define WT_RECTABLE_MAX_COLS	64
+
+typedef std::shared_ptr<BoostMappingFile> BoostMFPtr;
+
+NS_WTP_BEGIN
+
+#pragma pack(push, 8)
+/*
+ *	列定义
+ *	_dtype为numpy的类型描述,如<f8、<u8、<u4、|u1、|S32
+ */
+typedef struct _WtRecColumn
+{
+	char		_name[24];
+	char		_dtype[8];
+	uint32_t	_offset;
+	uint32_t	_size;
+} WtRecColumn;
+
+typedef struct _WtRecTableHeader
+{
+	char		_flag[8];
+	uint32_t	_version;
+	uint32_t	_header_size;	//数据区的偏移,固定为WT_RECTABLE_HEADER_SIZE
+	uint32_t	_rec_size;		//每条记录的大小
+	uint32_t	_col_count;
+	uint64_t	_capacity;		//预分配的记录数
+	uint64_t	_size;			//已写入的记录数
+	char		_name[16];		//表名
+	char		_flavor[16];	//表的来源,同名的表不同来源格式可能不同
+	WtRecColumn	_columns[WT_RECTABLE_MAX_COLS];
+} WtRecTableHeader;
+#pragma pack(pop)
+
+static_assert(sizeof(WtRecTableHeader) <= WT_RECTABLE_HEADER_SIZE, "header of record table is too large");
+
+class WtRecordTable
+{
+public:
+	WtRecordTable() :_header(NULL), _data(NULL), _rec_size(0), _writable(false) {}
+	WtRecordTable(const WtRecordTable&) = delete;
+	WtRecordTable& operator=(const WtRecordTable&) = delete;
+
+	~WtRecordTable()
+	{
+		close();
+	}
+
+private:
+	bool	map_file(const char* filename, bool bWritable)
+	{
+		BoostMappingFile* pMf = new BoostMappingFile();
+		try
+		{
+			boost::interprocess::mode_t mode = bWritable ? boost::interprocess::read_write : boost::interprocess::read_only;
+			if (!pMf->map(filename, mode, mode))
+			{
+				delete pMf;
+				return false;
+			}
+		}
+		catch (std::exception&)
+		{
+			delete pMf;
+			return false;
+		}
+
+		_file.reset(pMf);
+		_header = (WtRecTableHeader*)_file->addr();
+		_data = (char*)_file->addr() + WT_RECTABLE_HEADER_SIZE;
+		_writable = bWritable;
+		return true;
+	}
+
+	/*
+	 *	扩容,先解除映射再扩大文件,这样windows下也不会失败
+	 *	调用之前要先拿到锁
+	 */
+	bool	expand(uint64_t newCap)
+	{
+		if (_header->_capacity >= newCap)
+			return true;
+
+		std::string filename = _file->filename();
+		_header->_capacity = newCap;
+		_file->sync();
+		_file.reset();
+		_header = NULL;
+		_data = NULL;
+		_writable = false;
+
+		BoostFile f;
+		if (!f.open_existing_file(filename.c_str()))
+			return false;
+		f.truncate_file((std::size_t)(WT_RECTABLE_HEADER_SIZE + _rec_size*newCap));
+		f.close_file();
+
+		return map_file(filename.c_str(), true);
+	}
+
+public:
+	/*
+	 *	创建新表,已有的文件会被覆盖
+	 *	initCap为预分配的记录数,写满以后按两倍扩容
+	 */
+	bool	create(const char* filename, const char* name, const char* flavor, const WtRecColumn* cols, uint32_t colCnt, uint32_t recSize, uint64_t initCap = 1024)
+	{
+		close();
+
+		if (colCnt > WT_RECTABLE_MAX_COLS || recSize == 0)
+			return false;
+
+		if (initCap == 0)
+			initCap = 1;
+
+		WtRecTableHeader header;
+		memset(&header, 0, sizeof(header));
+		wt_strcpy(header._flag, WT_RECTABLE_FLAG, std::min(strlen(WT_RECTABLE_FLAG), sizeof(header._flag) - 1));
+		wt_strcpy(header._name, name, std::min(strlen(name), sizeof(header._name) - 1));
+		wt_strcpy(header._flavor, flavor, std::min(strlen(flavor), sizeof(header._flavor) - 1));
+		header._version = WT_RECTABLE_VERSION;
+		header._header_size = WT_RECTABLE_HEADER_SIZE;
+		header._rec_size = recSize;
+		header._col_count = colCnt;
+		header._capacity = initCap;
+		header._size = 0;
+		memcpy(header._columns, cols, sizeof(WtRecColumn)*colCnt);
+
+		BoostFile f;
+		if (!f.create_new_file(filename))
+			return false;
+		f.write_file(&header, sizeof(header));
+		f.truncate_file((std::size_t)(WT_RECTABLE_HEADER_SIZE + recSize*initCap));
+		f.close_file();
+
+		_rec_size = recSize;
+		return map_file(filename, true);
+	}
+
+	/*
+	 *	只读打开已有的表,读取转换的时候用
+	 */
+	bool	open(const char* filename)
+	{
+		close();
+
+		if (!BoostFile::exists(filename) || BoostFile::get_file_size(filename) < WT_RECTABLE_HEADER_SIZE)
+			return false;
+
+		if (!map_file(filename, false))
+			return false;
+
+		if (strcmp(_header->_flag, WT_RECTABLE_FLAG) != 0 || _header->_header_size != WT_RECTABLE_HEADER_SIZE
+			|| _file->size() < WT_RECTABLE_HEADER_SIZE + _header->_rec_size*_header->_size)
+		{
+			close();
+			return false;
+		}
+
+		_rec_size = _header->_rec_size;
+		return true;
+	}
+
+	/*
+	 *	关闭表,写入的表会把多余的预分配空间截掉
+	 */
+	void	close()
+	{
+		if (!_file)
+			return;
+
+		std::string filename = _file->filename();
+		bool bShrink = _writable;
+		uint64_t realSize = WT_RECTABLE_HEADER_SIZE + _rec_size*_header->_size;
+		if (_writable)
+		{
+			_header->_capacity = _header->_size;
+			_file->sync();
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(_mtx);
+			_file.reset();
+			_header = NULL;
+			_data = NULL;
+			_writable = false;
+		}
+
+		if (bShrink)
+		{
+			BoostFile f;
+			if (f.open_existing_file(filename.c_str()))
+			{
+				f.truncate_file((std::size_t)realSize);
+				f.close_file();
+			}
+		}
+	}
+
+	/*
+	 *	追加一条记录,rec的长度必须是创建时指定的recSize
+	 *	只能在一个线程里写,扩容的时候才加锁,和sync互斥
+	 *	扩容失败以后表就不能再写了
+	 */
+	inline bool	append(const void* rec)
+	{
+		if (!_writable)
+			return false;
+
+		if (_header->_size == _header->_capacity)
+		{
+			std::unique_lock<std::mutex> lock(_mtx);
+			if (!expand(_header->_capacity * 2))
+				return false;
+		}
+
+		memcpy(_data + _rec_size*_header->_size, rec, _rec_size);
+		_header->_size++;
+		return true;
+	}
+
+	/*
+	 *	把映射的内容刷到磁盘,可以在别的线程调用
+	 */
+	inline void	sync()
+	{
+		std::unique_lock<std::mutex> lock(_mtx);
+		if (_file && _writable)
+			_file->sync();
+	}
+
+	inline bool		valid() const { return _header != NULL; }
+	inline uint64_t	size() const { return _header ? _header->_size : 0; }
+	inline uint64_t	capacity() const { return _header ? _header->_capacity : 0; }
+	inline uint32_t	rec_size() const { return _rec_size; }
+
+	inline const WtRecTableHeader*	header() const { return _header; }
+	inline const char*	data() const { return _data; }
+
+	inline const char*	at(uint64_t idx) const
+	{
+		if (_header == NULL || idx >= _header->_size)
+			return NULL;
+
+		return _data + _rec_size*idx;
+	}
+
+	template<typename T>
+	inline const T*	at(uint64_t idx) const { return (const T*)at(idx); }
+
+private:
+	BoostMFPtr			_file;
+	WtRecTableHeader*	_header;
+	char*				_data;
+	uint32_t			_rec_size;
+	bool				_writable;
+	std::mutex			_mtx;
+};
+
+NS_WTP_END
@@ -0,0 +1,151 @@
+﻿/*!
+ * \file WtSpscRing.hpp
+ * \project	WonderTrader
+ *
+ * \brief 单生产者单消费者的定长环形队列
+ */
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include "../Includes/WTSMarcos.h"
+
+NS_WTP_BEGIN
+
+/*
+ *	单生产者单消费者的定长环形队列
+ *	读写位置各自只有一个线程修改,不需要CAS,两边各缓存一份对方的位置,只有缓存的位置不够用的时候才去读对方的原子变量
+ *	写入分成申请和提交两步,数据直接在槽位里原地填写,填写失败可以不提交
+ *	T需要可以默认构造,构造的时候就把整块内存写一遍
+ */
+template<typename T>
+class WtSpscRing
+{
+public:
+	/*
+	 *	capacity	容量,会向上取整到2的幂
+	 */
+	WtSpscRing(uint32_t capacity = 1024) :_slots(NULL), _mask(0), _tail_cache(0), _head_cache(0)
+	{
+		uint32_t cap = 2;
+		while (cap < capacity)
+			cap <<= 1;
+
+		_mask = cap - 1;
+		_slots.reset(new T[cap]());	//初始化一遍,避免用的时候才缺页
+		_head.store(0, std::memory_order_relaxed);
+		_tail.store(0, std::memory_order_relaxed);
+	}
+
+	WtSpscRing(const WtSpscRing&) = delete;
+	WtSpscRing& operator=(const WtSpscRing&) = delete;
+
+	inline uint32_t capacity() const { return (uint32_t)(_mask + 1); }
+
+	/*
+	 *	当前的数据条数,只是一个近似值
+	 */
+	inline uint32_t size() const
+	{
+		return (uint32_t)(_head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire));
+	}
+
+	/*
+	 *	申请一个槽位,只能在生产线程调用
+	 *
+	 *	返回值	队列满了返回NULL
+	 */
+	inline T* alloc()
+	{
+		uint64_t head = _head.load(std::memory_order_relaxed);
+		if (head - _tail_cache > _mask)
+		{
+			_tail_cache = _tail.load(std::memory_order_acquire);
+			if (head - _tail_cache > _mask)
+				return NULL;
+		}
+
+		return &_slots[head & _mask];
+	}
+
+	/*
+	 *	提交alloc申请到的槽位
+	 */
+	inline void commit()
+	{
+		_head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/*
+	 *	入队,只能在生产线程调用
+	 *	fill	填写数据的回调,形如void(T& data)
+	 *
+	 *	返回值	队列满了返回false
+	 */
+	template<typename FuncFill>
+	inline bool push(FuncFill fill)
+	{
+		T* slot = alloc();
+		if (slot == NULL)
+			return false;
+
+		fill(*slot);
+		commit();
+		return true;
+	}
+
+	/*
+	 *	出队,只能在消费线程调用
+	 *	cb	处理数据的回调,形如void(T& data),回调返回以后槽位才会被复用
+	 *
+	 *	返回值	队列为空返回false
+	 */
+	template<typename FuncConsume>
+	inline bool pop(FuncConsume cb)
+	{
+		uint64_t tail = _tail.load(std::memory_order_relaxed);
+		if (tail == _head_cache)
+		{
+			_head_cache = _head.load(std::memory_order_acquire);
+			if (tail == _head_cache)
+				return false;
+		}
+
+		cb(_slots[tail & _mask]);
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 *	批量出队,只能在消费线程调用
+	 *	maxCnt	最多处理的条数
+	 *
+	 *	返回值	处理的条数
+	 */
+	template<typename FuncConsume>
+	inline uint32_t drain(FuncConsume cb, uint32_t maxCnt = UINT32_MAX)
+	{
+		uint32_t cnt = 0;
+		while (cnt < maxCnt && pop(cb))
+			cnt++;
+		return cnt;
+	}
+
+	/*
+	 *	是否为空,只在消费线程里是准确的
+	 */
+	inline bool empty() const
+	{
+		return _tail.load(std::memory_order_relaxed) == _head.load(std::memory_order_acquire);
+	}
+
+private:
+	std::unique_ptr<T[]>	_slots;
+	uint64_t				_mask;
+	alignas(64) std::atomic<uint64_t>	_head;			//生产者的写入位置
+	uint64_t							_tail_cache;	//生产者缓存的读取位置
+	alignas(64) std::atomic<uint64_t>	_tail;			//消费者的读取位置
+	uint64_t							_head_cache;	//消费者缓存的写入位置
+};
+
+NS_WTP_END
@@ -0,0 +1,185 @@
+﻿/*!
+ * \file WtSubBitset.hpp
+ * \project	WonderTrader
+ *
+ * \brief 按索引存储的订阅位图
+ *
+ * 合约加载的时候已经分配了全局索引(WTSContractInfo::getTotalIndex)
+ * 订阅状态按索引存成一位,行情回调里过滤只需要测试一位,不用再做字符串查找
+ * 位图按页分配,页指针和每个字都是原子变量,运行中增减订阅不需要加锁
+ * 页一旦分配就不再释放,读线程拿到的页指针始终有效
+ */
+#pragma once
+#include <stdint.h>
+#include <limits.h>
+#include <atomic>
+
+#include "../Includes/WTSMarcos.h"
+
+NS_WTP_BEGIN
+
+class WtSubBitset
+{
+public:
+	static const uint32_t PAGE_WORDS = 1024;				//每页1024个字,即65536位
+	static const uint32_t PAGE_BITS = PAGE_WORDS * 64;
+	static const uint32_t MAX_PAGES = 2048;					//最多支持128M个索引,8位数字的证券代码也可以直接作为索引
+	static const uint32_t MAX_INDEX = PAGE_BITS * MAX_PAGES;
+
+	typedef std::atomic<uint64_t>	Word;
+
+public:
+	WtSubBitset() :_count(0)
+	{
+		for (uint32_t i = 0; i < MAX_PAGES; i++)
+			_pages[i].store(NULL, std::memory_order_relaxed);
+	}
+
+	~WtSubBitset()
+	{
+		for (uint32_t i = 0; i < MAX_PAGES; i++)
+			delete[] _pages[i].load(std::memory_order_relaxed);
+	}
+
+	WtSubBitset(const WtSubBitset&) = delete;
+	WtSubBitset& operator=(const WtSubBitset&) = delete;
+
+public:
+	static inline bool is_valid(uint32_t idx) { return idx < MAX_INDEX; }
+
+	/*
+	 *	纯数字的证券代码直接转成索引,如600000,10004567
+	 *	不用查合约就能测试订阅位,适合全市场推送的股票行情
+	 *	不是纯数字或者超过8位的返回UINT_MAX
+	 */
+	static inline uint32_t numeric_index(const char* code)
+	{
+		uint32_t ret = 0;
+		int i = 0;
+		for (; code[i] != '\0'; i++)
+		{
+			if (i >= 8 || code[i] < '0' || code[i] > '9')
+				return UINT_MAX;
+
+			ret = ret * 10 + (code[i] - '0');
+		}
+		return (i == 0) ? UINT_MAX : ret;
+	}
+
+	/*
+	 *	设置一位
+	 *	@idx	索引,超出范围(如没有分配索引的合约UINT_MAX)返回false
+	 *	返回这一位是否是新设置的
+	 */
+	inline bool set(uint32_t idx)
+	{
+		if (!is_valid(idx))
+			return false;
+
+		Word* page = get_page(idx / PAGE_BITS, true);
+		uint64_t mask = 1ULL << (idx & 63);
+		uint64_t old = page[(idx % PAGE_BITS) >> 6].fetch_or(mask, std::memory_order_relaxed);
+		if (old & mask)
+			return false;
+
+		_count.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/*
+	 *	清除一位,返回这一位之前是否已设置
+	 */
+	inline bool reset(uint32_t idx)
+	{
+		if (!is_valid(idx))
+			return false;
+
+		Word* page = get_page(idx / PAGE_BITS, false);
+		if (page == NULL)
+			return false;
+
+		uint64_t mask = 1ULL << (idx & 63);
+		uint64_t old = page[(idx % PAGE_BITS) >> 6].fetch_and(~mask, std::memory_order_relaxed);
+		if ((old & mask) == 0)
+			return false;
+
+		_count.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/*
+	 *	测试一位,行情回调里调用
+	 *	只有两次原子读,没有分配也没有锁
+	 */
+	inline bool test(uint32_t idx) const
+	{
+		if (!is_valid(idx))
+			return false;
+
+		Word* page = _pages[idx / PAGE_BITS].load(std::memory_order_acquire);
+		if (page == NULL)
+			return false;
+
+		return ((page[(idx % PAGE_BITS) >> 6].load(std::memory_order_relaxed) >> (idx & 63)) & 1) != 0;
+	}
+
+	/*
+	 *	清除全部,页保留
+	 */
+	inline void clear()
+	{
+		for (uint32_t i = 0; i < MAX_PAGES; i++)
+		{
+			Word* page = _pages[i].load(std::memory_order_acquire);
+			if (page == NULL)
+				continue;
+
+			for (uint32_t j = 0; j < PAGE_WORDS; j++)
+			{
+				uint64_t old = page[j].exchange(0, std::memory_order_relaxed);
+				if (old != 0)
+					_count.fetch_sub(popcount(old), std::memory_order_relaxed);
+			}
+		}
+	}
+
+	inline uint32_t count() const { return _count.load(std::memory_order_relaxed); }
+
+	inline bool empty() const { return count() == 0; }
+
+private:
+	static inline uint32_t popcount(uint64_t v)
+	{
+		uint32_t cnt = 0;
+		for (; v != 0; v &= v - 1)
+			cnt++;
+		return cnt;
+	}
+
+	/*
+	 *	获取页,不存在的时候按需分配
+	 *	多个线程同时分配同一页,只有一个能装上去,其他的释放掉
+	 */
+	inline Word* get_page(uint32_t pageIdx, bool bAlloc)
+	{
+		Word* page = _pages[pageIdx].load(std::memory_order_acquire);
+		if (page != NULL || !bAlloc)
+			return page;
+
+		Word* newPage = new Word[PAGE_WORDS];
+		for (uint32_t i = 0; i < PAGE_WORDS; i++)
+			newPage[i].store(0, std::memory_order_relaxed);
+
+		if (_pages[pageIdx].compare_exchange_strong(page, newPage, std::memory_order_acq_rel, std::memory_order_acquire))
+			return newPage;
+
+		delete[] newPage;
+		return page;
+	}
+
+private:
+	std::atomic<Word*>		_pages[MAX_PAGES];
+	std::atomic<uint32_t>	_count;
+};
+
+NS_WTP_END
@@ -0,0 +1,575 @@
+﻿/*!
+ * \file WtTickJournal.hpp
+ * \project	WonderTrader
+ *
+ * \brief tick流水日志
+ *
+ * 落地程序原来每个tick都格式化成一行csv,用std::endl写到文件,每笔都要刷一次盘
+ * 流水日志直接记录原始的tick结构体,写入线程只是把数据放到无锁队列里
+ * 后台线程批量拷贝到按交易日预分配的内存映射文件中,按配置的间隔刷盘
+ * 需要csv的时候再用离线工具转换,格式和原来的csv一致
+ */
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "BoostFile.hpp"
+#include "BoostMappingFile.hpp"
+#include "TimeUtils.hpp"
+#include "WtMpscRing.hpp"
+#include "fmtlib.h"
+#include "../Includes/WTSStruct.h"
+#include "../Includes/WTSTypes.h"
+
+#include <boost/filesystem.hpp>
+
+NS_WTP_BEGIN
+
+#define JOURNAL_FILE_FLAG		"WTJNL"
+#define JOURNAL_FILE_VERSION	1
+
+#pragma pack(push, 8)
+typedef struct _JournalHeader
+{
+	char		_flag[8];		//文件标记
+	uint32_t	_version;		//版本号
+	uint32_t	_date;			//交易日
+	uint32_t	_rec_size;		//每条记录的大小,结构体改过以后旧文件就不能直接读了
+	uint32_t	_reserve;
+	uint64_t	_capacity;		//文件可以容纳的记录数
+	uint64_t	_size;			//已经写入的记录数,数据拷贝完以后才更新
+} JournalHeader;
+
+typedef struct _JournalRecord
+{
+	uint64_t		_local_time;	//写入流水的本地时间,毫秒
+	WTSTickStruct	_tick;
+} JournalRecord;
+#pragma pack(pop)
+
+/*
+ *	按原来csv日志的格式输出一行
+ *	代码,交易日,日期,时间,本地时间,最新价,总成交量,持仓量,总成交额,成交量,增仓,成交额
+ */
+inline void journal_to_csv(const JournalRecord& rec, std::ostream& os)
+{
+	const WTSTickStruct& ts = rec._tick;
+	TimeUtils::Time32 tNow(rec._local_time);
+	uint32_t uTime = tNow.time();
+
+	os << ts.code << ","
+		<< ts.trading_date << ","
+		<< ts.action_date << ","
+		<< ts.action_time << ","
+		<< fmt::format("{:02d}:{:02d}:{:02d}", uTime / 10000, uTime % 10000 / 100, uTime % 100) << ","
+		<< ts.price << ","
+		<< ts.total_volume << ","
+		<< ts.open_interest << ","
+		<< (uint64_t)ts.total_turnover << ","
+		<< ts.volume << ","
+		<< ts.diff_interest << ","
+		<< (uint64_t)ts.turn_over << "\n";
+}
+
+class WtTickJournal
+{
+private:
+	static const uint64_t PAGE_BYTES = 4096;
+	static const uint64_t PREFAULT_BYTES = 8 * 1024 * 1024;	//提前写8M,大约1.6万条
+
+	/*
+	 *	一个交易日的流水文件
+	 */
+	typedef struct _JournalFile
+	{
+		std::shared_ptr<BoostMappingFile>	_mf;
+		JournalHeader*	_header = NULL;
+		uint32_t		_date = 0;
+		uint64_t		_written = 0;
+		uint64_t		_synced = 0;
+		uint64_t		_faulted = 0;	//已经预先写过的位置
+		uint64_t		_last_write = 0;//最后一次写入的本地时间
+
+		inline bool is_open() const { return _header != NULL; }
+	} JournalFile;
+
+public:
+	typedef std::function<void(WTSLogLevel, const std::string&)>	JournalLogger;
+
+	/*
+	 *	folder		流水文件目录,文件名为ticks.交易日.jnl
+	 *	capacity	每个文件初始预分配的记录数,写满了以后翻倍
+	 *	syncSpan	刷盘间隔,毫秒,0为不主动刷盘,由操作系统决定
+	 *	queueSize	队列长度
+	 *	dropOnFull	后台线程来不及写、队列满了的时候是否直接丢弃,默认不丢,写入线程等到有空位为止
+	 */
+	WtTickJournal(const char* folder, uint32_t capacity = 256 * 1024, uint32_t syncSpan = 1000, uint32_t queueSize = 64 * 1024, bool dropOnFull = false)
+		: _folder(folder), _init_cap(capacity == 0 ? 1024 : capacity), _sync_span(syncSpan)
+		, _ring(queueSize), _drop_on_full(dropOnFull), _stopped(true), _written(0), _discarded(0), _waited(0)
+		, _last_sync(0), _last_dropped(0), _last_waited(0)
+	{
+		if (!_folder.empty() && _folder.back() != '/' && _folder.back() != '\\')
+			_folder += "/";
+	}
+
+	~WtTickJournal() { stop(); }
+
+	WtTickJournal(const WtTickJournal&) = delete;
+	WtTickJournal& operator=(const WtTickJournal&) = delete;
+
+	inline void set_logger(JournalLogger logger) { _logger = logger; }
+
+	inline void start()
+	{
+		if (!_stopped)
+			return;
+
+		//目录建不出来的时候不抛异常,后面打开文件失败的记录都算丢弃
+		boost::system::error_code ec;
+		boost::filesystem::create_directories(_folder, ec);
+		if (ec)
+			log(LL_ERROR, fmt::format("Creating tick journal folder {} failed: {}", _folder, ec.message()));
+
+		_stopped = false;
+		_thrd_flush.reset(new std::thread([this]() { flush_loop(); }));
+	}
+
+	/*
+	 *	停止后台线程,队列里剩余的数据会全部写完再刷盘
+	 */
+	inline void stop()
+	{
+		if (_stopped)
+			return;
+
+		_stopped = true;
+		if (_thrd_flush)
+		{
+			_thrd_flush->join();
+			_thrd_flush.reset();
+		}
+		close_file(_prev);
+		close_file(_cur);
+	}
+
+	/*
+	 *	追加一条tick,可以在任意线程调用
+	 *	只是放到队列里,不做格式化也不碰文件
+	 *	队列满了的时候,没有设置dropOnFull就让出时间片等后台线程腾出空位,后台线程没在运行的才丢弃
+	 *
+	 *	返回值	丢弃了返回false
+	 */
+	inline bool append(const WTSTickStruct& ts)
+	{
+		auto fill = [&ts](JournalRecord& rec) {
+			rec._local_time = TimeUtils::getLocalTimeNow();
+			memcpy(&rec._tick, &ts, sizeof(WTSTickStruct));
+		};
+
+		if (_drop_on_full)
+			return _ring.push(fill);
+
+		if (_ring.try_push(fill))
+			return true;
+
+		_waited.fetch_add(1, std::memory_order_relaxed);
+		for (;;)
+		{
+			if (_stopped)
+			{
+				_discarded.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			std::this_thread::yield();
+			if (_ring.try_push(fill))
+				return true;
+		}
+	}
+
+	inline uint64_t written() const { return _written.load(std::memory_order_relaxed); }
+
+	/*
+	 *	丢弃的记录数,包括队列满了丢掉的,和文件打开或者扩容失败以后写不进去的
+	 */
+	inline uint64_t dropped() const { return _ring.dropped() + _discarded.load(std::memory_order_relaxed); }
+
+	/*
+	 *	队列满了写入线程等待的次数
+	 */
+	inline uint64_t waited() const { return _waited.load(std::memory_order_relaxed); }
+
+	static inline std::string filename(const std::string& folder, uint32_t uDate)
+	{
+		return folder + "ticks." + std::to_string(uDate) + ".jnl";
+	}
+
+private:
+	inline void log(WTSLogLevel ll, const std::string& msg)
+	{
+		if (_logger)
+			_logger(ll, msg);
+	}
+
+	void flush_loop()
+	{
+		for (;;)
+		{
+			//先取一下标记,停止以后还要把剩下的数据写完
+			bool bStopped = _stopped;
+			uint32_t cnt = _ring.drain([this](JournalRecord& rec) { write_record(rec); }, 4096);
+			if (cnt > 0)
+			{
+				//数据拷贝完了再更新条数,转换工具只读到这里
+				std::atomic_thread_fence(std::memory_order_release);
+				if (_cur.is_open())
+					_cur._header->_size = _cur._written;
+				if (_prev.is_open())
+					_prev._header->_size = _prev._written;
+			}
+
+			//行情一直不断的时候也要按时刷盘和报告丢弃
+			check_sync(bStopped && cnt == 0);
+			check_dropped();
+
+			if (cnt > 0)
+				continue;
+
+			if (bStopped)
+				break;
+
+			retire_prev();
+			prefault();
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	inline void write_record(const JournalRecord& rec)
+	{
+		uint32_t tDate = rec._tick.trading_date;
+		JournalFile* jf = NULL;
+		if (_cur.is_open() && tDate == _cur._date)
+			jf = &_cur;
+		else if (_prev.is_open() && tDate == _prev._date)
+			jf = &_prev;
+		else
+			jf = switch_file(tDate);
+
+		if (jf == NULL || (jf->_written >= jf->_header->_capacity && !expand_file(*jf)))
+		{
+			_discarded.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		JournalRecord* recs = (JournalRecord*)((char*)jf->_header + sizeof(JournalHeader));
+		memcpy(&recs[jf->_written], &rec, sizeof(JournalRecord));
+		jf->_written++;
+		jf->_last_write = rec._local_time;
+		_written.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/*
+	 *	遇到新的交易日,原来的文件不关,留着接收换日前后晚到的数据
+	 *	新的交易日作为当前文件,比当前文件还旧的作为上一个文件
+	 *	同时最多保留两个文件,第三个交易日出现的时候才关掉最旧的
+	 */
+	inline JournalFile* switch_file(uint32_t tDate)
+	{
+		if (!_cur.is_open())
+			return open_file(_cur, tDate) ? &_cur : NULL;
+
+		close_file(_prev);
+		if (tDate < _cur._date)
+			return open_file(_prev, tDate) ? &_prev : NULL;
+
+		std::swap(_prev, _cur);
+		return open_file(_cur, tDate) ? &_cur : NULL;
+	}
+
+	inline void sync_file(JournalFile& jf, uint64_t now, bool bForce)
+	{
+		if (!jf.is_open() || jf._synced == jf._written)
+			return;
+
+		if (!bForce && (_sync_span == 0 || now - _last_sync < _sync_span))
+			return;
+
+		jf._mf->sync(false);
+		jf._synced = jf._written;
+	}
+
+	inline void check_sync(bool bForce)
+	{
+		uint64_t now = TimeUtils::getLocalTimeNow();
+		sync_file(_cur, now, bForce);
+		sync_file(_prev, now, bForce);
+		if (bForce || (_sync_span != 0 && now - _last_sync >= _sync_span))
+			_last_sync = now;
+	}
+
+	/*
+	 *	上一个交易日的文件一分钟没有新数据就关掉,只在空闲的时候做
+	 */
+	inline void retire_prev()
+	{
+		if (!_prev.is_open() || TimeUtils::getLocalTimeNow() - _prev._last_write < 60000)
+			return;
+
+		log(LL_INFO, fmt::format("Tick journal of {} closed, {} records written", _prev._date, _prev._written));
+		close_file(_prev);
+	}
+
+	/*
+	 *	空闲的时候先把后面的页写一遍,行情集中到来的时候少一些缺页中断
+	 *	每次最多处理256页,不影响停止和刷盘
+	 */
+	inline void prefault()
+	{
+		if (!_cur.is_open())
+			return;
+
+		uint64_t uEnd = sizeof(JournalHeader) + sizeof(JournalRecord)*_cur._header->_capacity;
+		uint64_t uPos = sizeof(JournalHeader) + sizeof(JournalRecord)*_cur._written;
+		uint64_t uTarget = std::min(uEnd, uPos + PREFAULT_BYTES);
+		//从下一个完整的页开始,已经写了数据的页不能动
+		uint64_t uPage = std::max(_cur._faulted, (uPos + PAGE_BYTES - 1) / PAGE_BYTES * PAGE_BYTES);
+		volatile char* base = (volatile char*)_cur._header;
+		for (uint32_t cnt = 0; uPage < uTarget && cnt < 256; uPage += PAGE_BYTES, cnt++)
+			base[uPage] = 0;
+		_cur._faulted = uPage;
+	}
+
+	inline void check_dropped()
+	{
+		uint64_t waited = this->waited();
+		if (waited != _last_waited)
+		{
+			log(LL_WARN, fmt::format("Tick journal queue was full {} times since last check, writers waited for free slots", waited - _last_waited));
+			_last_waited = waited;
+		}
+
+		uint64_t dropped = this->dropped();
+		if (dropped == _last_dropped)
+			return;
+
+		log(LL_WARN, fmt::format("{} tick journal records dropped since last check, consider enlarging the queue or checking the disk", dropped - _last_dropped));
+		_last_dropped = dropped;
+	}
+
+	/*
+	 *	打开交易日对应的文件,已经存在的接着往后写
+	 */
+	bool open_file(JournalFile& jf, uint32_t tDate)
+	{
+		close_file(jf);
+
+		std::string path = filename(_folder, tDate);
+		if (BoostFile::exists(path.c_str()))
+		{
+			BoostMappingFile* mf = new BoostMappingFile;
+			if (mf->map(path.c_str()) && mf->size() >= sizeof(JournalHeader))
+			{
+				JournalHeader* header = (JournalHeader*)mf->addr();
+				if (strcmp(header->_flag, JOURNAL_FILE_FLAG) == 0 && header->_version == JOURNAL_FILE_VERSION
+					&& header->_rec_size == sizeof(JournalRecord) && header->_date == tDate
+					&& mf->size() >= sizeof(JournalHeader) + sizeof(JournalRecord)*header->_capacity)
+				{
+					jf._mf.reset(mf);
+					jf._header = header;
+					jf._date = tDate;
+					jf._written = header->_size;
+					jf._synced = jf._written;
+					jf._faulted = 0;
+					jf._last_write = TimeUtils::getLocalTimeNow();
+					log(LL_INFO, fmt::format("Tick journal {} reopened, {} records already written", path, jf._written));
+					return true;
+				}
+			}
+			delete mf;
+
+			//文件格式不对,改名留着,重新建一个
+			std::string badFile = path + "." + std::to_string(TimeUtils::getLocalTimeNow()) + ".bad";
+			boost::system::error_code ec;
+			boost::filesystem::rename(path, badFile, ec);
+			log(LL_ERROR, fmt::format("Tick journal {} is invalid, renamed to {}", path, badFile));
+		}
+
+		uint64_t uSize = sizeof(JournalHeader) + sizeof(JournalRecord)*_init_cap;
+		{
+			BoostFile bf;
+			if (!bf.create_new_file(path.c_str()))
+			{
+				log(LL_ERROR, fmt::format("Creating tick journal {} failed", path));
+				return false;
+			}
+
+			JournalHeader header;
+			memset(&header, 0, sizeof(header));
+			strcpy(header._flag, JOURNAL_FILE_FLAG);
+			header._version = JOURNAL_FILE_VERSION;
+			header._date = tDate;
+			header._rec_size = sizeof(JournalRecord);
+			header._capacity = _init_cap;
+			bf.write_file(&header, sizeof(header));
+			bf.close_file();
+		}
+
+		//预分配空间,稀疏文件不会真的占用磁盘
+		boost::system::error_code ec;
+		boost::filesystem::resize_file(path, uSize, ec);
+		if (ec)
+		{
+			log(LL_ERROR, fmt::format("Preallocating tick journal {} to {} bytes failed: {}", path, uSize, ec.message()));
+			return false;
+		}
+
+		jf._mf.reset(new BoostMappingFile);
+		if (!jf._mf->map(path.c_str()))
+		{
+			log(LL_ERROR, fmt::format("Mapping tick journal {} failed", path));
+			jf._mf.reset();
+			return false;
+		}
+
+		jf._header = (JournalHeader*)jf._mf->addr();
+		jf._date = tDate;
+		jf._written = 0;
+		jf._synced = 0;
+		jf._faulted = 0;
+		jf._last_write = TimeUtils::getLocalTimeNow();
+		log(LL_INFO, fmt::format("Tick journal {} created with capacity {}", path, _init_cap));
+		return true;
+	}
+
+	/*
+	 *	文件写满了,容量翻倍再重新映射,只在后台线程里调用
+	 */
+	bool expand_file(JournalFile& jf)
+	{
+		std::string path = jf._mf->filename();
+		uint64_t newCap = jf._header->_capacity * 2;
+		jf._header->_size = jf._written;
+		jf._mf->sync();
+		jf._mf.reset();
+		jf._header = NULL;
+
+		boost::system::error_code ec;
+		boost::filesystem::resize_file(path, sizeof(JournalHeader) + sizeof(JournalRecord)*newCap, ec);
+
+		jf._mf.reset(new BoostMappingFile);
+		if (!jf._mf->map(path.c_str()))
+		{
+			log(LL_ERROR, fmt::format("Remapping tick journal {} failed", path));
+			jf._mf.reset();
+			jf._date = 0;
+			return false;
+		}
+
+		jf._header = (JournalHeader*)jf._mf->addr();
+		jf._faulted = 0;
+		if (!ec)
+			jf._header->_capacity = newCap;
+		else
+			log(LL_ERROR, fmt::format("Expanding tick journal {} failed: {}", path, ec.message()));
+
+		if (jf._written >= jf._header->_capacity)
+			return false;
+
+		log(LL_DEBUG, fmt::format("Tick journal {} expanded to {}", path, jf._header->_capacity));
+		return true;
+	}
+
+	void close_file(JournalFile& jf)
+	{
+		if (jf._header)
+		{
+			jf._header->_size = jf._written;
+			jf._mf->sync(false);
+		}
+
+		jf._mf.reset();
+		jf._header = NULL;
+		jf._date = 0;
+	}
+
+private:
+	std::string		_folder;
+	uint64_t		_init_cap;
+	uint32_t		_sync_span;
+	JournalLogger	_logger;
+
+	WtMpscRing<JournalRecord>	_ring;
+	bool			_drop_on_full;
+
+	//以下只在后台线程里访问
+	JournalFile		_cur;	//最新交易日的文件
+	JournalFile		_prev;	//换日以后还留着的上一个交易日的文件
+
+	std::atomic<bool>		_stopped;
+	std::atomic<uint64_t>	_written;
+	std::atomic<uint64_t>	_discarded;	//文件打不开或者扩容失败丢掉的
+	std::atomic<uint64_t>	_waited;
+	uint64_t		_last_sync;
+	uint64_t		_last_dropped;
+	uint64_t		_last_waited;
+
+	std::shared_ptr<std::thread>	_thrd_flush;
+};
+
+/*
+ *	流水文件的读取,离线转换用
+ */
+class WtTickJournalReader
+{
+public:
+	WtTickJournalReader() :_header(NULL) {}
+
+	inline bool open(const char* filename)
+	{
+		_header = NULL;
+		_mf.reset(new BoostMappingFile);
+		if (!BoostFile::exists(filename) || !_mf->map(filename, boost::interprocess::read_only, boost::interprocess::read_only))
+		{
+			_mf.reset();
+			return false;
+		}
+
+		if (_mf->size() < sizeof(JournalHeader))
+			return false;
+
+		JournalHeader* header = (JournalHeader*)_mf->addr();
+		if (strcmp(header->_flag, JOURNAL_FILE_FLAG) != 0 || header->_version != JOURNAL_FILE_VERSION || header->_rec_size != sizeof(JournalRecord))
+			return false;
+
+		if (_mf->size() < sizeof(JournalHeader) + sizeof(JournalRecord)*header->_size)
+			return false;
+
+		_header = header;
+		return true;
+	}
+
+	inline uint32_t date() const { return _header ? _header->_date : 0; }
+
+	inline uint64_t size() const { return _header ? _header->_size : 0; }
+
+	inline const JournalRecord& at(uint64_t idx) const
+	{
+		return ((const JournalRecord*)((const char*)_header + sizeof(JournalHeader)))[idx];
+	}
+
+private:
+	std::shared_ptr<BoostMappingFile>	_mf;
+	const JournalHeader*	_header;
+};
+
+NS_WTP_END
@@ -0,0 +1,286 @@
+﻿/*!
+ * \file WtTickTrace.hpp
+ * \project	WonderTrader
+ *
+ * \brief tick到下单的全链路耗时跟踪
+ */
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "../Includes/WTSMarcos.h"
+
+NS_WTP_BEGIN
+
+/*
+ *	跟踪的环节,按照先后顺序排列
+ */
+typedef enum tagTickTraceStage
+{
+	TTS_PARSER_RECV = 0,	//解析模块收到行情
+	TTS_PARSER_ADAPTER,		//ParserAdapter::handleQuote
+	TTS_ENGINE_DISPATCH,	//引擎开始分发
+	TTS_STRA_ENTER,			//进入策略回调
+	TTS_RISK_CHECK,			//TraderAdapter开始事前风控
+	TTS_API_SEND,			//调用ITraderApi::orderInsert
+	TTS_API_RETURN,			//orderInsert返回
+	TTS_STRA_EXIT,			//策略回调返回
+	TTS_COUNT
+} TickTraceStage;
+
+/*
+ *	一笔tick在各个环节的时间戳,单位为TSC周期,0表示没有经过这个环节
+ */
+typedef struct _TickTrace
+{
+	uint64_t	_stamps[TTS_COUNT];
+
+	inline void reset() { memset(_stamps, 0, sizeof(_stamps)); }
+} TickTrace;
+
+NS_WTP_END
+
+/*
+ *	编译的时候定义了WT_TICK_TRACE才会开启,否则下面的宏都是空的,WTSTickData里也不会多出时间戳
+ *	开启以后所有模块都要重新编译,因为WTSTickData的内存布局变了
+ *	解析模块只往tick上打时间戳,提交和汇总都在引擎所在的模块里完成
+ */
+#ifdef WT_TICK_TRACE
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "StdUtils.hpp"
+#include "WtLatencyHistogram.hpp"
+#include "WtSpscRing.hpp"
+#include "fmtlib.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define WT_TRACE_HAS_TSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define WT_TRACE_HAS_TSC 1
+#endif
+
+NS_WTP_BEGIN
+
+class TickTracer
+{
+private:
+	typedef struct _TraceQueue
+	{
+		WtSpscRing<TickTrace>	_ring;
+		std::atomic<uint64_t>	_dropped;
+
+		_TraceQueue() :_ring(4096), _dropped(0) {}
+	} TraceQueue;
+	typedef std::shared_ptr<TraceQueue> TraceQueuePtr;
+
+	/*
+	 *	汇总的口径,from到to两个环节之间的耗时
+	 */
+	typedef struct _TraceSpan
+	{
+		TickTraceStage	_from;
+		TickTraceStage	_to;
+		const char*		_name;
+	} TraceSpan;
+
+	static const uint32_t SPAN_COUNT = 8;
+
+	static inline const TraceSpan* spans()
+	{
+		static const TraceSpan SPANS[SPAN_COUNT] = {
+			{ TTS_PARSER_RECV,		TTS_PARSER_ADAPTER,		"parser->adapter" },
+			{ TTS_PARSER_ADAPTER,	TTS_ENGINE_DISPATCH,	"adapter->engine" },
+			{ TTS_ENGINE_DISPATCH,	TTS_STRA_ENTER,			"engine->strategy" },
+			{ TTS_STRA_ENTER,		TTS_STRA_EXIT,			"strategy callback" },
+			{ TTS_STRA_ENTER,		TTS_RISK_CHECK,			"strategy->risk check" },
+			{ TTS_RISK_CHECK,		TTS_API_SEND,			"risk check->api" },
+			{ TTS_API_SEND,			TTS_API_RETURN,			"api orderInsert" },
+			{ TTS_PARSER_RECV,		TTS_API_SEND,			"tick->order" }
+		};
+		return SPANS;
+	}
+
+	typedef struct _TracerState
+	{
+		StdUniqueMutex				_mtx;
+		std::vector<TraceQueuePtr>	_queues;
+		WtLatencyHistogram			_hists[SPAN_COUNT];
+		uint64_t					_dropped;
+		uint64_t					_start_tsc;
+		int64_t						_start_ns;
+
+		_TracerState() :_dropped(0)
+		{
+			_start_tsc = now();
+			_start_ns = steady_ns();
+		}
+	} TracerState;
+
+	static inline TracerState& state()
+	{
+		static TracerState _state;
+		return _state;
+	}
+
+	static inline TickTrace*& current()
+	{
+		static thread_local TickTrace* _current = NULL;
+		return _current;
+	}
+
+	/*
+	 *	同一笔tick可能同时推给多个线程上的策略,tick上的时间戳只读
+	 *	进入策略以后的时间戳记在当前线程自己的副本上
+	 */
+	static inline TickTrace& local_trace()
+	{
+		static thread_local TickTrace _trace;
+		return _trace;
+	}
+
+	static inline TraceQueue* local_queue()
+	{
+		static thread_local TraceQueuePtr _queue;
+		if (!_queue)
+		{
+			_queue.reset(new TraceQueue);
+			TracerState& st = state();
+			StdUniqueLock lock(st._mtx);
+			st._queues.emplace_back(_queue);
+		}
+		return _queue.get();
+	}
+
+	static inline int64_t steady_ns()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+public:
+	static inline uint64_t now()
+	{
+#ifdef WT_TRACE_HAS_TSC
+		return __rdtsc();
+#else
+		return (uint64_t)steady_ns();
+#endif
+	}
+
+	/*
+	 *	进入策略回调,拷贝tick上分发之前的时间戳,后面下单的时间戳都记在副本上
+	 */
+	static inline void enter(const TickTrace& trace)
+	{
+		//同一笔tick会推给多个策略,每个策略单独一条记录
+		TickTrace& cur = local_trace();
+		memcpy(cur._stamps, trace._stamps, sizeof(uint64_t)*TTS_STRA_ENTER);
+		cur._stamps[TTS_STRA_ENTER] = now();
+		cur._stamps[TTS_RISK_CHECK] = 0;
+		cur._stamps[TTS_API_SEND] = 0;
+		cur._stamps[TTS_API_RETURN] = 0;
+		cur._stamps[TTS_STRA_EXIT] = 0;
+		current() = &cur;
+	}
+
+	/*
+	 *	给当前线程正在处理的tick打时间戳,只记第一笔订单
+	 */
+	static inline void stamp_current(TickTraceStage stage)
+	{
+		TickTrace* trace = current();
+		if (trace != NULL && trace->_stamps[stage] == 0)
+			trace->_stamps[stage] = now();
+	}
+
+	/*
+	 *	策略回调返回,把这笔记录放到当前线程的队列里
+	 */
+	static inline void leave()
+	{
+		TickTrace* trace = current();
+		if (trace == NULL)
+			return;
+
+		trace->_stamps[TTS_STRA_EXIT] = now();
+		current() = NULL;
+
+		TraceQueue* queue = local_queue();
+		if (!queue->_ring.push([trace](TickTrace& item) { item = *trace; }))
+			queue->_dropped++;
+	}
+
+	/*
+	 *	汇总各个线程队列里的记录,输出各环节的耗时分布,单位为纳秒
+	 *	@bReset	输出以后是否清空
+	 */
+	static std::string dump(bool bReset = false)
+	{
+		TracerState& st = state();
+		StdUniqueLock lock(st._mtx);
+
+		//用开始到现在的时间校准TSC的频率
+		int64_t elapsed = steady_ns() - st._start_ns;
+		if (elapsed < 10000000)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			elapsed = steady_ns() - st._start_ns;
+		}
+		double nsPerTick = (double)elapsed / (double)(now() - st._start_tsc);
+
+		const TraceSpan* sp = spans();
+		for (TraceQueuePtr& queue : st._queues)
+		{
+			queue->_ring.drain([&st, sp, nsPerTick](TickTrace& item) {
+				for (uint32_t i = 0; i < SPAN_COUNT; i++)
+				{
+					uint64_t from = item._stamps[sp[i]._from];
+					uint64_t to = item._stamps[sp[i]._to];
+					if (from == 0 || to < from)
+						continue;
+
+					st._hists[i].record((uint64_t)((to - from) * nsPerTick));
+				}
+			});
+			st._dropped += queue->_dropped.exchange(0);
+		}
+
+		std::string ret = fmt::format("tick-to-order latency(ns), {} records dropped", st._dropped);
+		for (uint32_t i = 0; i < SPAN_COUNT; i++)
+			fmt::format_to(std::back_inserter(ret), "\n{:<22}{}", sp[i]._name, st._hists[i].summary());
+
+		if (bReset)
+		{
+			for (uint32_t i = 0; i < SPAN_COUNT; i++)
+				st._hists[i].reset();
+			st._dropped = 0;
+		}
+
+		return ret;
+	}
+};
+
+NS_WTP_END
+
+#define WT_TRACE_NOW(var)				uint64_t var = wtp::TickTracer::now()
+#define WT_TRACE_SET(tick, stage, var)	(tick)->trace()._stamps[stage] = (var)
+#define WT_TRACE_STAMP(tick, stage)		(tick)->trace()._stamps[stage] = wtp::TickTracer::now()
+#define WT_TRACE_ENTER(tick)			wtp::TickTracer::enter((tick)->trace())
+#define WT_TRACE_LEAVE()				wtp::TickTracer::leave()
+#define WT_TRACE_STAMP_CUR(stage)		wtp::TickTracer::stamp_current(stage)
+
+#else
+
+#define WT_TRACE_NOW(var)
+#define WT_TRACE_SET(tick, stage, var)
+#define WT_TRACE_STAMP(tick, stage)
+#define WT_TRACE_ENTER(tick)
+#define WT_TRACE_LEAVE()
+#define WT_TRACE_STAMP_CUR(stage)
+
+#endif
@@ -0,0 +1,247 @@
+﻿/*!
+ * \file WtTimerWheel.hpp
+ * \project	WonderTrader
+ *
+ * \brief 分层时间轮
+ */
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "../Includes/WTSMarcos.h"
+
+NS_WTP_BEGIN
+
+/*
+ *	分层时间轮,和linux内核的定时器是一个思路
+ *	4层,每层64个槽,最小刻度由resolution决定,刻度为10ms时,一圈可以覆盖46个小时
+ *	超过覆盖范围的定时器先放在最外层,转到的时候再重新计算位置
+ *	注册和撤销都是O(1),推进的时候只处理到期的定时器和需要下移的槽,和定时器总数无关
+ *	定时器只会晚触发,不会早触发,最大延迟为一个刻度
+ *	不是线程安全的,调用方自己加锁
+ */
+class WtTimerWheel
+{
+public:
+	static const uint32_t LEVELS = 4;
+	static const uint32_t SLOT_BITS = 6;
+	static const uint32_t SLOTS = 1 << SLOT_BITS;
+	static const uint32_t SLOT_MASK = SLOTS - 1;
+	static const uint64_t MAX_SPAN = ((uint64_t)1 << (SLOT_BITS*LEVELS)) - 1;
+	static const uint32_t NIL = UINT32_MAX;
+
+private:
+	typedef struct _TimerNode
+	{
+		uint64_t	_expire;	//到期刻度
+		uint64_t	_data;		//用户数据
+		uint32_t	_prev;
+		uint32_t	_next;
+		uint32_t	_slot;		//所在的槽,NIL表示空闲
+		uint32_t	_gen;		//代数,节点复用以后旧的id就失效了
+	} TimerNode;
+
+public:
+	WtTimerWheel(uint32_t resolution = 10) :_resolution(resolution == 0 ? 1 : resolution), _cur_tick(0), _free_head(NIL), _count(0)
+	{
+		for (uint32_t i = 0; i < LEVELS*SLOTS; i++)
+			_heads[i] = NIL;
+	}
+
+	/*
+	 *	初始化
+	 *	now			当前时间,单位毫秒
+	 *	resolution	刻度,单位毫秒
+	 */
+	inline void init(uint64_t now, uint32_t resolution)
+	{
+		_resolution = (resolution == 0) ? 1 : resolution;
+		_cur_tick = now / _resolution;
+	}
+
+	inline uint32_t resolution() const { return _resolution; }
+	inline uint32_t size() const { return _count; }
+
+	/*
+	 *	注册定时器
+	 *	deadline	到期时间,单位毫秒
+	 *	data		用户数据,到期时原样回调
+	 *
+	 *	返回值		定时器id,不会为0
+	 */
+	inline uint64_t schedule(uint64_t deadline, uint64_t data)
+	{
+		uint32_t idx;
+		if (_free_head != NIL)
+		{
+			idx = _free_head;
+			_free_head = _nodes[idx]._next;
+		}
+		else
+		{
+			idx = (uint32_t)_nodes.size();
+			_nodes.emplace_back();
+			_nodes.back()._gen = 0;
+		}
+
+		TimerNode& node = _nodes[idx];
+		//向上取整,保证不会早触发
+		node._expire = (deadline + _resolution - 1) / _resolution;
+		node._data = data;
+		insert(idx);
+		_count++;
+		return ((uint64_t)node._gen << 32) | (idx + 1);
+	}
+
+	/*
+	 *	撤销定时器
+	 *	返回值	定时器是否还在等待中
+	 */
+	inline bool cancel(uint64_t timerid)
+	{
+		uint32_t idx = (uint32_t)(timerid & 0xFFFFFFFF);
+		if (idx == 0 || idx > _nodes.size())
+			return false;
+
+		idx--;
+		TimerNode& node = _nodes[idx];
+		if (node._slot == NIL || node._gen != (uint32_t)(timerid >> 32))
+			return false;
+
+		unlink(idx);
+		release(idx);
+		return true;
+	}
+
+	/*
+	 *	推进到指定时间,依次回调到期的定时器
+	 *	now	当前时间,单位毫秒
+	 *	cb	回调函数,形如void(uint64_t timerid, uint64_t data)
+	 *		回调里可以注册新的定时器,已经到期的会在下一次推进的时候触发
+	 *
+	 *	返回值	触发的定时器个数
+	 */
+	template<typename FuncTimerCallback>
+	inline uint32_t advance(uint64_t now, FuncTimerCallback cb)
+	{
+		uint64_t target = now / _resolution;
+		uint32_t fired = 0;
+		while (_cur_tick <= target)
+		{
+			uint64_t tick = _cur_tick;
+			uint32_t idx0 = (uint32_t)(tick & SLOT_MASK);
+			if (idx0 == 0)
+				cascade(1, tick);
+
+			//先把当前槽摘下来,再推进刻度,这样回调里注册的定时器不会落到正在处理的槽里
+			uint32_t cur = _heads[idx0];
+			_heads[idx0] = NIL;
+			_cur_tick++;
+
+			while (cur != NIL)
+			{
+				TimerNode& node = _nodes[cur];
+				uint32_t next = node._next;
+				uint64_t timerid = ((uint64_t)node._gen << 32) | (cur + 1);
+				uint64_t data = node._data;
+				node._slot = NIL;
+				release(cur);
+				fired++;
+				cb(timerid, data);
+				cur = next;
+			}
+
+			//没有定时器的时候直接跳到目标刻度,避免空转
+			if (_count == 0 && _cur_tick <= target)
+				_cur_tick = target + 1;
+		}
+
+		return fired;
+	}
+
+private:
+	inline void insert(uint32_t idx)
+	{
+		TimerNode& node = _nodes[idx];
+		if (node._expire < _cur_tick)
+			node._expire = _cur_tick;
+
+		uint64_t expire = node._expire;
+		uint64_t delta = expire - _cur_tick;
+		if (delta > MAX_SPAN)
+		{
+			//超出覆盖范围的,先放在最外层,转到的时候再重新计算
+			expire = _cur_tick + MAX_SPAN;
+			delta = MAX_SPAN;
+		}
+
+		uint32_t level = 0;
+		while (level < LEVELS - 1 && delta >= ((uint64_t)1 << (SLOT_BITS*(level + 1))))
+			level++;
+
+		uint32_t slot = level * SLOTS + (uint32_t)((expire >> (SLOT_BITS*level)) & SLOT_MASK);
+		node._slot = slot;
+		node._prev = NIL;
+		node._next = _heads[slot];
+		if (node._next != NIL)
+			_nodes[node._next]._prev = idx;
+		_heads[slot] = idx;
+	}
+
+	inline void unlink(uint32_t idx)
+	{
+		TimerNode& node = _nodes[idx];
+		if (node._prev != NIL)
+			_nodes[node._prev]._next = node._next;
+		else
+			_heads[node._slot] = node._next;
+
+		if (node._next != NIL)
+			_nodes[node._next]._prev = node._prev;
+
+		node._slot = NIL;
+	}
+
+	inline void release(uint32_t idx)
+	{
+		TimerNode& node = _nodes[idx];
+		node._slot = NIL;
+		node._gen++;
+		node._next = _free_head;
+		_free_head = idx;
+		_count--;
+	}
+
+	/*
+	 *	把上层槽里的定时器下移
+	 *	先处理上层,上层下移的定时器才能落到正确的位置
+	 */
+	inline void cascade(uint32_t level, uint64_t tick)
+	{
+		if (level >= LEVELS)
+			return;
+
+		uint32_t idx = (uint32_t)((tick >> (SLOT_BITS*level)) & SLOT_MASK);
+		if (idx == 0)
+			cascade(level + 1, tick);
+
+		uint32_t slot = level * SLOTS + idx;
+		uint32_t cur = _heads[slot];
+		_heads[slot] = NIL;
+		while (cur != NIL)
+		{
+			uint32_t next = _nodes[cur]._next;
+			insert(cur);
+			cur = next;
+		}
+	}
+
+private:
+	uint32_t	_resolution;
+	uint64_t	_cur_tick;		//下一个要处理的刻度
+	uint32_t	_heads[LEVELS*SLOTS];
+	std::vector<TimerNode>	_nodes;
+	uint32_t	_free_head;
+	uint32_t	_count;
+};
+
+NS_WTP_END
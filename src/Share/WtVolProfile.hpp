@@ -0,0 +1,378 @@
+﻿/*!
+ * \file WtVolProfile.hpp
+ * \project	WonderTrader
+ *
+ * \brief 日内成交量分布曲线的生成和存储
+ */
+#pragma once
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "BoostFile.hpp"
+#include "BoostMappingFile.hpp"
+#include "StdUtils.hpp"
+#include "../Includes/FasterDefs.h"
+#include "../Includes/WTSStruct.h"
+#include "../Includes/WTSSessionInfo.hpp"
+
+NS_WTP_BEGIN
+
+#define VOL_PROFILE_FLAG	"WTVPROF"
+#define VOL_PROFILE_VERSION	1
+
+#pragma pack(push, 8)
+/*
+ *	文件结构: 文件头 + 按代码排序的索引 + 曲线数据
+ *	每条曲线有bins+1个float,第i个值表示开盘以后i分钟累计成交量的占比,第0个为0,最后一个为1
+ */
+typedef struct _VolProfileHeader
+{
+	char		_flag[8];		//文件标记
+	uint32_t	_version;		//版本号
+	uint32_t	_bins;			//每条曲线的分钟数
+	uint32_t	_count;			//曲线条数
+	uint32_t	_end_date;		//统计的截止日期
+	uint32_t	_days;			//统计的天数
+	uint32_t	_reserved;
+} VolProfileHeader;
+
+typedef struct _VolProfileEntry
+{
+	char		_code[32];		//代码,可以是标准代码,也可以是品种代码
+	uint32_t	_days;			//实际参与统计的天数
+	uint32_t	_reserved;
+} VolProfileEntry;
+#pragma pack(pop)
+
+/*
+ *	成交量分布曲线生成器
+ *	从分钟线历史数据里按交易日切分,每天按分钟归一化以后累加,最后取平均值再算累计占比
+ *	分钟到槽位的映射按交易时间模板预先算成一张表,逐根K线只需要查表累加
+ *	归一化和累加都是对连续数组的简单循环,编译器可以直接向量化
+ */
+class WtVolProfileBuilder
+{
+private:
+	typedef struct _ProfileItem
+	{
+		std::string			_code;
+		std::vector<double>	_acc;		//每分钟占比的累加值
+		uint32_t			_days;
+	} ProfileItem;
+
+public:
+	WtVolProfileBuilder(uint32_t bins = 240) :_bins(bins), _day_vols(bins, 0.0) {}
+
+	inline uint32_t bins() const { return _bins; }
+	inline std::size_t size() const { return _items.size(); }
+
+	/*
+	 *	添加一个交易日的分钟成交量
+	 *	vols	长度为bins的数组
+	 *
+	 *	返回值	当天成交量为0的不参与统计,返回false
+	 */
+	inline bool add_day(const char* stdCode, const double* vols)
+	{
+		double total = 0;
+		for (uint32_t i = 0; i < _bins; i++)
+			total += vols[i];
+
+		if (total <= 0)
+			return false;
+
+		ProfileItem& item = get_item(stdCode);
+		double* acc = item._acc.data();
+		double scale = 1.0 / total;
+		for (uint32_t i = 0; i < _bins; i++)
+			acc[i] += vols[i] * scale;
+
+		item._days++;
+		return true;
+	}
+
+	/*
+	 *	添加一个代码的历史分钟线
+	 *	bars必须按时间排序,按交易日切分以后逐日统计
+	 *	sInfo为交易时间模板,用于把K线时间映射到开盘以后的第几分钟
+	 *
+	 *	返回值	参与统计的天数
+	 */
+	inline uint32_t add_bars(const char* stdCode, const WTSBarStruct* bars, uint32_t count, WTSSessionInfo* sInfo)
+	{
+		if (bars == NULL || count == 0 || sInfo == NULL)
+			return 0;
+
+		const uint32_t* table = bin_table(sInfo);
+		uint32_t days = 0;
+		uint32_t curDate = 0;
+		double* vols = _day_vols.data();
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const WTSBarStruct& bar = bars[i];
+			if (bar.date != curDate)
+			{
+				if (curDate != 0 && add_day(stdCode, vols))
+					days++;
+
+				curDate = bar.date;
+				memset(vols, 0, sizeof(double)*_bins);
+			}
+
+			uint32_t bin = table[bar.time % 10000];
+			if (bin != INVALID_UINT32)
+				vols[bin] += bar.vol;
+		}
+
+		if (curDate != 0 && add_day(stdCode, vols))
+			days++;
+
+		return days;
+	}
+
+	/*
+	 *	保存到文件
+	 *	先写临时文件再替换,正在使用旧文件的进程不受影响
+	 */
+	inline bool save(const char* filename, uint32_t endDate, uint32_t days)
+	{
+		std::vector<const ProfileItem*> items;
+		items.reserve(_items.size());
+		for (const ProfileItem& item : _items)
+		{
+			if (item._days > 0)
+				items.emplace_back(&item);
+		}
+		std::sort(items.begin(), items.end(), [](const ProfileItem* a, const ProfileItem* b) {
+			return strcmp(a->_code.c_str(), b->_code.c_str()) < 0;
+		});
+
+		uint32_t cnt = (uint32_t)items.size();
+		std::string buffer;
+		buffer.resize(sizeof(VolProfileHeader) + sizeof(VolProfileEntry)*cnt + sizeof(float)*(_bins + 1)*cnt, 0);
+
+		VolProfileHeader* header = (VolProfileHeader*)buffer.data();
+		strcpy(header->_flag, VOL_PROFILE_FLAG);
+		header->_version = VOL_PROFILE_VERSION;
+		header->_bins = _bins;
+		header->_count = cnt;
+		header->_end_date = endDate;
+		header->_days = days;
+
+		VolProfileEntry* entries = (VolProfileEntry*)(header + 1);
+		float* curves = (float*)(entries + cnt);
+		for (uint32_t idx = 0; idx < cnt; idx++)
+		{
+			const ProfileItem& item = *items[idx];
+			VolProfileEntry& entry = entries[idx];
+			wt_strcpy(entry._code, item._code.c_str(), std::min(item._code.size(), sizeof(entry._code) - 1));
+			entry._days = item._days;
+
+			float* curve = curves + (std::size_t)idx*(_bins + 1);
+			const double* acc = item._acc.data();
+			double cum = 0;
+			double scale = 1.0 / item._days;
+			curve[0] = 0;
+			for (uint32_t i = 0; i < _bins; i++)
+			{
+				cum += acc[i] * scale;
+				curve[i + 1] = (float)cum;
+			}
+			//消除累加误差
+			curve[_bins] = 1.0f;
+		}
+
+		std::string tmpfile = filename;
+		tmpfile += ".tmp";
+		if (!BoostFile::write_file_contents(tmpfile.c_str(), buffer.data(), (uint32_t)buffer.size()))
+			return false;
+
+		if (BoostFile::exists(filename))
+			BoostFile::delete_file(filename);
+
+		boost::system::error_code ec;
+		boost::filesystem::rename(tmpfile, filename, ec);
+		return !ec;
+	}
+
+private:
+	inline ProfileItem& get_item(const char* stdCode)
+	{
+		auto it = _code_idx.find(stdCode);
+		if (it != _code_idx.end())
+			return _items[it->second];
+
+		_code_idx[stdCode] = (uint32_t)_items.size();
+		_items.emplace_back();
+		ProfileItem& item = _items.back();
+		item._code = stdCode;
+		item._acc.resize(_bins, 0.0);
+		item._days = 0;
+		return item;
+	}
+
+	/*
+	 *	HHMM到槽位的映射表,K线时间是分钟结束的时间,所以开盘后第1分钟的K线落在第0个槽位
+	 */
+	inline const uint32_t* bin_table(WTSSessionInfo* sInfo)
+	{
+		std::vector<uint32_t>& table = _bin_tables[sInfo->id()];
+		if (!table.empty())
+			return table.data();
+
+		table.resize(2400, INVALID_UINT32);
+		for (uint32_t hh = 0; hh < 24; hh++)
+		{
+			for (uint32_t mm = 0; mm < 60; mm++)
+			{
+				uint32_t hhmm = hh * 100 + mm;
+				uint32_t mins = sInfo->timeToMinutes(hhmm);
+				if (mins == INVALID_UINT32 || mins == 0)
+					continue;
+
+				table[hhmm] = std::min(mins - 1, _bins - 1);
+			}
+		}
+		return table.data();
+	}
+
+private:
+	uint32_t	_bins;
+	std::vector<ProfileItem>			_items;
+	wt_hashmap<std::string, uint32_t>	_code_idx;
+	wt_hashmap<std::string, std::vector<uint32_t>>	_bin_tables;
+	std::vector<double>	_day_vols;
+};
+
+/*
+ *	成交量分布曲线的存储,直接映射文件,按代码二分查找
+ *	同一个文件在进程里只映射一次,所有执行单元共用
+ */
+class WtVolProfileStore
+{
+public:
+	WtVolProfileStore() :_header(NULL), _entries(NULL), _curves(NULL) {}
+
+	inline bool load(const char* filename)
+	{
+		std::shared_ptr<BoostMappingFile> mf(new BoostMappingFile);
+		if (!mf->map(filename, boost::interprocess::read_only, boost::interprocess::read_only))
+			return false;
+
+		if (mf->size() < sizeof(VolProfileHeader))
+			return false;
+
+		VolProfileHeader* header = (VolProfileHeader*)mf->addr();
+		if (strcmp(header->_flag, VOL_PROFILE_FLAG) != 0 || header->_version != VOL_PROFILE_VERSION)
+			return false;
+
+		std::size_t expected = sizeof(VolProfileHeader) + (sizeof(VolProfileEntry) + sizeof(float)*(header->_bins + 1))*header->_count;
+		if (mf->size() < expected)
+			return false;
+
+		_file = mf;
+		_header = header;
+		_entries = (VolProfileEntry*)(header + 1);
+		_curves = (float*)(_entries + header->_count);
+		return true;
+	}
+
+	inline bool		is_loaded() const { return _header != NULL; }
+	inline uint32_t	bins() const { return _header ? _header->_bins : 0; }
+	inline uint32_t	count() const { return _header ? _header->_count : 0; }
+	inline uint32_t	end_date() const { return _header ? _header->_end_date : 0; }
+
+	/*
+	 *	获取代码对应的曲线
+	 *	返回值	bins+1个累计占比,找不到返回NULL
+	 */
+	inline const float* get(const char* stdCode, uint32_t* days = NULL) const
+	{
+		if (_header == NULL)
+			return NULL;
+
+		const VolProfileEntry* first = _entries;
+		const VolProfileEntry* last = _entries + _header->_count;
+		auto it = std::lower_bound(first, last, stdCode, [](const VolProfileEntry& entry, const char* code) {
+			return strcmp(entry._code, code) < 0;
+		});
+		if (it == last || strcmp(it->_code, stdCode) != 0)
+			return NULL;
+
+		if (days)
+			*days = it->_days;
+
+		return _curves + (std::size_t)(it - first)*(_header->_bins + 1);
+	}
+
+	/*
+	 *	执行时段内截止到nowTime应完成的比例
+	 *	beginTime/endTime/nowTime均为HHMM,和生成曲线时一样用timeToMinutes换算成开盘以后的分钟数
+	 *	开盘前按第0分钟,收盘后按最后一分钟处理
+	 */
+	static inline double window_ratio(const float* curve, uint32_t bins, WTSSessionInfo* sInfo, uint32_t beginTime, uint32_t endTime, uint32_t nowTime)
+	{
+		auto to_bin = [sInfo, bins](uint32_t hhmm) {
+			uint32_t mins = sInfo->timeToMinutes(hhmm, true);
+			return (mins == INVALID_UINT32) ? bins : std::min(mins, bins);
+		};
+
+		uint32_t idxNow = to_bin(nowTime);
+		uint32_t idxBegin = to_bin(beginTime);
+		uint32_t idxEnd = to_bin(endTime);
+		if (idxNow >= idxEnd)
+			return 1.0;
+
+		if (idxNow <= idxBegin)
+			return 0.0;
+
+		double base = curve[idxBegin];
+		double range = curve[idxEnd] - base;
+		if (range <= 0)
+			return 1.0;
+
+		return std::min(1.0, std::max(0.0, (curve[idxNow] - base) / range));
+	}
+
+	/*
+	 *	获取进程内共享的存储
+	 *	文件重新生成以后,新创建的执行单元会读到新的数据
+	 */
+	static inline std::shared_ptr<WtVolProfileStore> shared(const char* filename)
+	{
+		static StdUniqueMutex mtx;
+		static wt_hashmap<std::string, std::shared_ptr<WtVolProfileStore>> stores;
+		static wt_hashmap<std::string, uint64_t> mtimes;
+
+		StdUniqueLock lock(mtx);
+		boost::system::error_code ec;
+		uint64_t mtime = (uint64_t)boost::filesystem::last_write_time(filename, ec);
+		if (ec)
+			return std::shared_ptr<WtVolProfileStore>();
+
+		auto it = stores.find(filename);
+		if (it != stores.end() && mtimes[filename] == mtime)
+			return it->second;
+
+		std::shared_ptr<WtVolProfileStore> store(new WtVolProfileStore);
+		if (!store->load(filename))
+			return std::shared_ptr<WtVolProfileStore>();
+
+		stores[filename] = store;
+		mtimes[filename] = mtime;
+		return store;
+	}
+
+private:
+	std::shared_ptr<BoostMappingFile>	_file;
+	const VolProfileHeader*	_header;
+	const VolProfileEntry*	_entries;
+	const float*			_curves;
+};
+
+typedef std::shared_ptr<WtVolProfileStore> WtVolProfileStorePtr;
+
+NS_WTP_END
@@ -0,0 +1,108 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../Share/WtCheckpoint.hpp"
+#include "../Includes/WTSStruct.h"
+
+USING_NS_WTP;
+
+TEST(test_checkpoint, test_roundtrip)
+{
+	std::vector<WTSBarStruct> bars(3);
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		bars[i].date = 20231120 + i;
+		bars[i].close = 100.5 + i;
+	}
+
+	WtCkptWriter writer;
+	writer.begin_block("replayer");
+	writer.put((uint32_t)20231124);
+	writer.put(3.25);
+	writer.put_str("SHFE.rb.HOT#m#1");
+	writer.put_str("");
+	writer.put_vec(bars);
+	writer.begin_block("inner");
+	writer.put((uint64_t)123456789);
+	writer.end_block();
+	writer.end_block();
+
+	writer.begin_block("sink");
+	writer.put((bool)true);
+	writer.end_block();
+
+	std::string filename = "./test_checkpoint.ckpt";
+	ASSERT_TRUE(writer.save(filename.c_str(), 20231124));
+	EXPECT_FALSE(BoostFile::exists("./test_checkpoint.ckpt.tmp"));
+
+	WtCkptReader reader;
+	ASSERT_TRUE(reader.load(filename.c_str()));
+	EXPECT_EQ(reader.tdate(), 20231124);
+
+	uint32_t uDate = 0;
+	double px = 0;
+	std::string key, empty("x");
+	std::vector<WTSBarStruct> ayBars;
+	uint64_t inner = 0;
+	EXPECT_TRUE(reader.enter_block("replayer"));
+	EXPECT_TRUE(reader.get(uDate));
+	EXPECT_TRUE(reader.get(px));
+	EXPECT_TRUE(reader.get_str(key));
+	EXPECT_TRUE(reader.get_str(empty));
+	EXPECT_TRUE(reader.get_vec(ayBars));
+	EXPECT_TRUE(reader.enter_block("inner"));
+	EXPECT_TRUE(reader.get(inner));
+	EXPECT_TRUE(reader.leave_block());
+	EXPECT_TRUE(reader.leave_block());
+
+	EXPECT_EQ(uDate, 20231124);
+	EXPECT_EQ(px, 3.25);
+	EXPECT_EQ(key, "SHFE.rb.HOT#m#1");
+	EXPECT_TRUE(empty.empty());
+	EXPECT_EQ(inner, 123456789);
+	ASSERT_EQ(ayBars.size(), 3);
+	EXPECT_EQ(ayBars[2].date, 20231122);
+	EXPECT_EQ(ayBars[1].close, 101.5);
+
+	//没读的字段跳过
+	bool bFlag = false;
+	EXPECT_TRUE(reader.enter_block("sink"));
+	EXPECT_TRUE(reader.leave_block());
+	EXPECT_FALSE(bFlag);
+	EXPECT_TRUE(reader.good());
+
+	BoostFile::delete_file(filename.c_str());
+}
+
+TEST(test_checkpoint, test_corrupted)
+{
+	WtCkptWriter writer;
+	writer.begin_block("replayer");
+	writer.put((uint32_t)1);
+	writer.end_block();
+
+	std::string filename = "./test_checkpoint_bad.ckpt";
+	ASSERT_TRUE(writer.save(filename.c_str(), 20231124));
+
+	//改掉数据区的一个字节,摘要校验不过
+	std::string content;
+	BoostFile::read_file_contents(filename.c_str(), content);
+	content[content.size() - 1] ^= 0x5A;
+	BoostFile::write_file_contents(filename.c_str(), content.data(), (uint32_t)content.size());
+
+	WtCkptReader reader;
+	EXPECT_FALSE(reader.load(filename.c_str()));
+	EXPECT_FALSE(reader.load("./not_exists.ckpt"));
+	BoostFile::delete_file(filename.c_str());
+
+	//段名不一致或者越界以后,后面的读取全部失败
+	reader.attach(writer.data().data(), writer.data().size());
+	EXPECT_FALSE(reader.enter_block("sink"));
+	uint32_t val = 0;
+	EXPECT_FALSE(reader.get(val));
+	EXPECT_FALSE(reader.good());
+
+	reader.attach(writer.data().data(), writer.data().size());
+	uint64_t big = 0;
+	EXPECT_TRUE(reader.enter_block("replayer"));
+	EXPECT_FALSE(reader.get(big));
+	EXPECT_FALSE(reader.leave_block());
+}
@@ -0,0 +1,195 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../Share/WtCompactData.hpp"
+
+#include <stdlib.h>
+#include <float.h>
+#include <vector>
+
+USING_NS_WTP;
+
+/*
+ *	价格按文本解析,和从csv或者行情接口拿到的一样
+ */
+static double parse_px(int32_t ticks, const char* fmt)
+{
+	char buf[64];
+	sprintf(buf, fmt, ticks * 0.2);
+	return atof(buf);
+}
+
+static void make_bars(std::vector<WTSBarStruct>& bars, uint32_t count)
+{
+	bars.clear();
+	uint32_t seed = 20231126;
+	int32_t px = 17280;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		px += (int32_t)((seed >> 16) % 11) - 5;
+
+		WTSBarStruct bar;
+		bar.date = 20231101 + i / 240;
+		bar.time = (uint64_t)(bar.date - 19900000) * 10000 + 900 + i % 240;
+		bar.open = parse_px(px, "%.1f");
+		bar.high = parse_px(px + 3, "%.1f");
+		bar.low = parse_px(px - 2, "%.1f");
+		bar.close = parse_px(px + 1, "%.1f");
+		bar.vol = (seed >> 8) % 5000;
+		bar.money = bar.vol * bar.close * 10;
+		bar.hold = 1500000 + (seed >> 12) % 1000;
+		bar.add = (double)((seed >> 4) % 200) - 100;
+		bars.emplace_back(bar);
+	}
+}
+
+static void make_ticks(std::vector<WTSTickStruct>& ticks, uint32_t count)
+{
+	ticks.clear();
+	uint32_t seed = 20231126;
+	int32_t px = 17280;
+	double totalVol = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		px += (int32_t)((seed >> 16) % 3) - 1;
+
+		WTSTickStruct ts;
+		strcpy(ts.exchg, "SHFE");
+		strcpy(ts.code, "rb2401");
+		ts.price = parse_px(px, "%.1f");
+		ts.open = 3456;
+		ts.high = parse_px(px + 10, "%.1f");
+		ts.low = parse_px(px - 10, "%.1f");
+		ts.upper_limit = 3801.6;
+		ts.lower_limit = 3110.4;
+		ts.pre_close = 3455.8;
+		ts.pre_settle = 3456.2;
+		ts.volume = (seed >> 8) % 100;
+		totalVol += ts.volume;
+		ts.total_volume = totalVol;
+		ts.turn_over = ts.volume * ts.price * 10;
+		ts.total_turnover = totalVol * 34560;
+		ts.open_interest = 1500000 + (seed >> 12) % 1000;
+		ts.pre_interest = 1500000;
+		ts.diff_interest = ts.open_interest - ts.pre_interest;
+		ts.trading_date = 20231124;
+		ts.action_date = 20231124;
+		ts.action_time = 90000000 + i * 500;
+		for (int l = 0; l < 10; l++)
+		{
+			ts.bid_prices[l] = parse_px(px - 1 - l, "%.1f");
+			ts.ask_prices[l] = parse_px(px + 1 + l, "%.1f");
+			ts.bid_qty[l] = 10 + l;
+			ts.ask_qty[l] = 20 + l;
+		}
+		ticks.emplace_back(ts);
+	}
+}
+
+TEST(test_compactdata, test_precision)
+{
+	EXPECT_EQ(WtCompactCodec::precision_of(1), 0);
+	EXPECT_EQ(WtCompactCodec::precision_of(0.2), 1);
+	EXPECT_EQ(WtCompactCodec::precision_of(0.01), 2);
+	EXPECT_EQ(WtCompactCodec::precision_of(0.005), 3);
+	EXPECT_EQ(WtCompactCodec::precision_of(0.0001), 4);
+}
+
+TEST(test_compactdata, test_bars_roundtrip)
+{
+	std::vector<WTSBarStruct> bars;
+	make_bars(bars, 2400);
+
+	std::string compact;
+	ASSERT_TRUE(WtCompactCodec::encode_bars(bars.data(), (uint32_t)bars.size(), 1, compact));
+	EXPECT_EQ(compact.size(), sizeof(CompactBlockInfo) + sizeof(WTSBarCompact)*bars.size());
+	EXPECT_LT(compact.size(), sizeof(WTSBarStruct)*bars.size() * 2 / 3);
+
+	//还原以后逐字节一致
+	std::string raw;
+	ASSERT_TRUE(WtCompactCodec::decode_bars(compact.data(), compact.size(), raw));
+	ASSERT_EQ(raw.size(), sizeof(WTSBarStruct)*bars.size());
+	EXPECT_EQ(memcmp(raw.data(), bars.data(), raw.size()), 0);
+
+	//按需读取
+	WtCompactBars view;
+	ASSERT_TRUE(view.attach(compact.data(), compact.size()));
+	ASSERT_EQ(view.size(), bars.size());
+	for (uint32_t i = 0; i < view.size(); i += 97)
+	{
+		EXPECT_EQ(view.close(i), bars[i].close);
+		EXPECT_EQ(view.high(i), bars[i].high);
+		EXPECT_EQ(view.volume(i), bars[i].vol);
+
+		WTSBarStruct bar;
+		view.get_bar(i, bar);
+		EXPECT_EQ(memcmp(&bar, &bars[i], sizeof(WTSBarStruct)), 0);
+	}
+
+	EXPECT_FALSE(view.attach(compact.data(), compact.size() - 1));
+	EXPECT_FALSE(WtCompactCodec::decode_bars(compact.data(), compact.size() - 8, raw));
+}
+
+TEST(test_compactdata, test_bars_fallback)
+{
+	std::vector<WTSBarStruct> bars;
+	make_bars(bars, 10);
+
+	//小数位数不够,自动往上加
+	bars[5].close = 3456.25;
+	std::string compact;
+	ASSERT_TRUE(WtCompactCodec::encode_bars(bars.data(), (uint32_t)bars.size(), 1, compact));
+	EXPECT_EQ(((CompactBlockInfo*)compact.data())->_precision, 2);
+	std::string raw;
+	ASSERT_TRUE(WtCompactCodec::decode_bars(compact.data(), compact.size(), raw));
+	EXPECT_EQ(memcmp(raw.data(), bars.data(), raw.size()), 0);
+
+	//计算出来的价格,没法无损还原
+	bars[5].close = 3456.2 / 3;
+	EXPECT_FALSE(WtCompactCodec::encode_bars(bars.data(), (uint32_t)bars.size(), 1, compact));
+	EXPECT_TRUE(compact.empty());
+
+	//期权的买卖价放在hold/add里
+	make_bars(bars, 10);
+	bars[3].hold = 12.5;
+	EXPECT_FALSE(WtCompactCodec::encode_bars(bars.data(), (uint32_t)bars.size(), 1, compact));
+
+	//成交量不是整数
+	make_bars(bars, 10);
+	bars[3].vol = 0.5;
+	EXPECT_FALSE(WtCompactCodec::encode_bars(bars.data(), (uint32_t)bars.size(), 1, compact));
+
+	make_bars(bars, 10);
+	bars[3].settle = DBL_MAX;
+	EXPECT_FALSE(WtCompactCodec::encode_bars(bars.data(), (uint32_t)bars.size(), 1, compact));
+}
+
+TEST(test_compactdata, test_ticks_roundtrip)
+{
+	std::vector<WTSTickStruct> ticks;
+	make_ticks(ticks, 5000);
+
+	std::string compact;
+	ASSERT_TRUE(WtCompactCodec::encode_ticks(ticks.data(), (uint32_t)ticks.size(), 1, compact));
+	EXPECT_LT(compact.size(), sizeof(WTSTickStruct)*ticks.size() / 2);
+
+	std::string raw;
+	ASSERT_TRUE(WtCompactCodec::decode_ticks(compact.data(), compact.size(), raw));
+	ASSERT_EQ(raw.size(), sizeof(WTSTickStruct)*ticks.size());
+	EXPECT_EQ(memcmp(raw.data(), ticks.data(), raw.size()), 0);
+
+	WtCompactTicks view;
+	ASSERT_TRUE(view.attach(compact.data(), compact.size()));
+	ASSERT_EQ(view.size(), ticks.size());
+	EXPECT_EQ(view.price(100), ticks[100].price);
+	EXPECT_EQ(view.bid_price(100, 3), ticks[100].bid_prices[3]);
+	EXPECT_EQ(view.ask_price(100), ticks[100].ask_prices[0]);
+
+	WTSTickStruct ts;
+	view.get_tick(4999, ts);
+	EXPECT_EQ(memcmp(&ts, &ticks[4999], sizeof(WTSTickStruct)), 0);
+
+	//一个数据块只能有一个代码
+	strcpy(ticks[10].code, "rb2405");
+	EXPECT_FALSE(WtCompactCodec::encode_ticks(ticks.data(), (uint32_t)ticks.size(), 1, compact));
+}
@@ -0,0 +1,115 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../WTSTools/CsvHelper.h"
+#include "../Share/BoostFile.hpp"
+#include "../Share/TimeUtils.hpp"
+#include "../Share/fmtlib.h"
+
+/*
+ *	生成K线的CSV文件,格式和WtDtHelper导出的一样
+ */
+static void make_csv(const char* filename, uint32_t rows)
+{
+	std::string content;
+	content.reserve((std::size_t)rows * 100);
+	content += "\xEF\xBB\xBF<Date>,<Time>,Open,High,Low,Close,Volume,Turnover,Open_Interest,Diff_Interest,Settle\n";
+	uint32_t seed = 20231114;
+	double price = 3800;
+	uint32_t uDate = 20150105;
+	uint32_t uMin = 0;
+	for (uint32_t i = 0; i < rows; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		price += (double)((seed >> 16) % 11) - 5;
+		uint32_t uTime = 901 + uMin / 60 * 100 + uMin % 60;
+		fmt::format_to(std::back_inserter(content), "{}/{}/{},{:02d}:{:02d}:00,{},{},{},{},{},{:.2f},{},{},{}\n",
+			uDate / 10000, uDate % 10000 / 100, uDate % 100, uTime / 100, uTime % 100,
+			price, price + 3, price - 2.5, price + 0.5, (seed >> 8) % 500, price * 10 * ((seed >> 8) % 500) + 0.37,
+			100000 + (seed >> 12) % 3000, (int32_t)((seed >> 4) % 101) - 50, 0);
+
+		if (++uMin == 240)
+		{
+			uMin = 0;
+			uDate = TimeUtils::getNextDate(uDate);
+		}
+	}
+	BoostFile::write_file_contents(filename, content.data(), (uint32_t)content.size());
+}
+
+TEST(test_csvreader, test_usage)
+{
+	std::string filename = "./csv_test.csv";
+	std::string content = "\xEF\xBB\xBF<Date>,Time,\"Open\",'Close',Volume,Code\r\n"
+		"2023/11/14,09:01:00,3801.5,3802,100,rb2401\r\n"
+		"\n"
+		"2023/11/14,09:02:00, -3801.25 ,1e3,+18446744073709551615,rb2401\r\n"
+		"2023/11/14,09:03:00,0.1234567890123456789,,-1\n"
+		"2023/11/14,09:04:00,12345678901234567,abc,4294967296,rb2405";
+	BoostFile::write_file_contents(filename.c_str(), content.c_str(), (uint32_t)content.size());
+
+	CsvReader oldReader;
+	ASSERT_TRUE(oldReader.load_from_file(filename.c_str()));
+	CsvMmapReader reader;
+	ASSERT_TRUE(reader.load_from_file(filename.c_str()));
+
+	EXPECT_EQ(reader.col_count(), 6);
+	EXPECT_STREQ(reader.fields(), "date,time,open,close,volume,code");
+	EXPECT_EQ(reader.get_col("close"), 3);
+	EXPECT_EQ(reader.get_col("settle"), INT_MAX);
+
+	//数值和原来的读取器逐个比较
+	uint32_t rows = 0;
+	while (reader.next_row())
+	{
+		ASSERT_TRUE(oldReader.next_row());
+		rows++;
+		for (int32_t col = 0; col < 5; col++)
+		{
+			double expected = oldReader.get_double(col);
+			double actual = reader.get_double(col);
+			EXPECT_EQ(memcmp(&expected, &actual, sizeof(double)), 0) << rows << "," << col;
+		}
+		EXPECT_EQ(reader.get_int32("volume"), oldReader.get_int32("volume"));
+		EXPECT_EQ(reader.get_uint32("volume"), oldReader.get_uint32("volume"));
+		EXPECT_EQ(reader.get_int64("volume"), oldReader.get_int64("volume"));
+		EXPECT_EQ(reader.get_uint64("volume"), oldReader.get_uint64("volume"));
+		EXPECT_STREQ(reader.get_string("date"), oldReader.get_string("date"));
+	}
+	EXPECT_EQ(rows, 4);
+
+	//不存在的字段和列
+	EXPECT_EQ(reader.get_double("settle"), 0);
+	EXPECT_STREQ(reader.get_string(10), "");
+	BoostFile::delete_file(filename.c_str());
+
+	//没有行长度限制
+	std::string longCell(5000, 'x');
+	content = "code,remark\nrb2401," + longCell + "\n";
+	BoostFile::write_file_contents(filename.c_str(), content.c_str(), (uint32_t)content.size());
+	ASSERT_TRUE(reader.load_from_file(filename.c_str()));
+	ASSERT_TRUE(reader.next_row());
+	EXPECT_EQ(reader.get_view(1).size(), 5000);
+	EXPECT_FALSE(reader.next_row());
+	BoostFile::delete_file(filename.c_str());
+
+	//分块以后拼起来和顺序读取一样
+	make_csv(filename.c_str(), 10000);
+	ASSERT_TRUE(reader.load_from_file(filename.c_str()));
+	std::vector<double> seqCloses;
+	while (reader.next_row())
+		seqCloses.emplace_back(reader.get_double("close"));
+
+	int32_t colClose = reader.get_col("close");
+	std::vector<std::vector<double>> chunks(7);
+	uint32_t cnt = reader.parallel_for(7, [&chunks, colClose](uint32_t chunkIdx, CsvCursor& cursor) {
+		while (cursor.next_row())
+			chunks[chunkIdx].emplace_back(cursor.get_double(colClose));
+	});
+	EXPECT_EQ(cnt, 7);
+
+	std::vector<double> parCloses;
+	for (auto& item : chunks)
+		parCloses.insert(parCloses.end(), item.begin(), item.end());
+	EXPECT_EQ(seqCloses.size(), 10000);
+	EXPECT_TRUE(seqCloses == parCloses);
+	BoostFile::delete_file(filename.c_str());
+}
@@ -0,0 +1,199 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../WTSTools/WTSHotMgr.h"
+#include "../Share/BoostFile.hpp"
+#include "../Share/TimeUtils.hpp"
+#include "../Share/fmtlib.h"
+
+#include <map>
+
+/*
+ *	生成换月规则文件,每个品种count次换月,返回每个品种的切换记录
+ */
+typedef struct _SwitchRec
+{
+	uint32_t	_date;
+	std::string	_to;
+	double		_factor;
+} SwitchRec;
+typedef std::map<std::string, std::map<uint32_t, SwitchRec>>	SwitchRecords;
+
+static void make_rules(const char* filename, uint32_t products, uint32_t count, SwitchRecords& records)
+{
+	std::string content = "{\"SHFE\":{";
+	for (uint32_t p = 0; p < products; p++)
+	{
+		std::string pid = fmt::format("p{}", p);
+		auto& recs = records["SHFE." + pid];
+		content += fmt::format("{}\"{}\":[", p == 0 ? "" : ",", pid);
+		uint32_t date = 20100104 + p % 20;
+		std::string from;
+		double factor = 1.0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t month = (date / 100 % 100) % 12 + 1;
+			std::string to = fmt::format("{}{:02d}{:02d}", pid, (date / 10000 + (month == 1 ? 1 : 0)) % 100, month);
+			double oldclose = 3000 + i * 10 + p;
+			double newclose = oldclose + 5 + i % 7;
+			factor *= oldclose / newclose;
+			content += fmt::format("{}{{\"date\":{},\"from\":\"{}\",\"to\":\"{}\",\"oldclose\":{},\"newclose\":{}}}",
+				i == 0 ? "" : ",", date, from, to, oldclose, newclose);
+			recs[date] = { date, to, factor };
+			from = to;
+			date = TimeUtils::getNextDate(date, 25 + (i * 7 + p) % 60);
+		}
+		content += "]";
+	}
+	content += "}}";
+	BoostFile::write_file_contents(filename, content.c_str(), (uint32_t)content.size());
+}
+
+TEST(test_hotmgr, test_usage)
+{
+	std::string filename = "./hots_test.json";
+	std::string content = "{\"SHFE\":{\"rb\":["
+		"{\"date\":20231016,\"from\":\"\",\"to\":\"rb2401\",\"oldclose\":0,\"newclose\":3700},"
+		"{\"date\":20231229,\"from\":\"rb2401\",\"to\":\"rb2405\",\"oldclose\":3800,\"newclose\":4000},"
+		"{\"date\":20240301,\"from\":\"rb2405\",\"to\":\"rb2410\",\"oldclose\":3600,\"newclose\":3500}"
+		"]}}";
+	BoostFile::write_file_contents(filename.c_str(), content.c_str(), (uint32_t)content.size());
+
+	WTSHotMgr hotMgr;
+	ASSERT_TRUE(hotMgr.loadHots(filename.c_str()));
+
+	//第一次切换之前没有主力
+	EXPECT_STREQ(hotMgr.getRawCode("SHFE", "rb", 20231013), "");
+	EXPECT_STREQ(hotMgr.getRawCode("SHFE", "rb", 20231016), "rb2401");
+	EXPECT_STREQ(hotMgr.getRawCode("SHFE", "rb", 20231228), "rb2401");
+	//跨年的时候按日历天连续计算
+	EXPECT_STREQ(hotMgr.getRawCode("SHFE", "rb", 20231229), "rb2405");
+	EXPECT_STREQ(hotMgr.getRawCode("SHFE", "rb", 20240229), "rb2405");
+	EXPECT_STREQ(hotMgr.getRawCode("SHFE", "rb", 20240301), "rb2410");
+	EXPECT_STREQ(hotMgr.getRawCode("SHFE", "rb", 20250101), "rb2410");
+	EXPECT_STREQ(hotMgr.getRawCode("SHFE", "hc", 20240101), "");
+
+	EXPECT_STREQ(hotMgr.getPrevRawCode("SHFE", "rb", 20231020), "");
+	EXPECT_STREQ(hotMgr.getPrevRawCode("SHFE", "rb", 20240105), "rb2401");
+	EXPECT_STREQ(hotMgr.getPrevRawCode("SHFE", "rb", 20250101), "rb2405");
+
+	EXPECT_TRUE(hotMgr.isHot("SHFE", "rb2405", 20240105));
+	EXPECT_FALSE(hotMgr.isHot("SHFE", "rb2401", 20240105));
+	EXPECT_FALSE(hotMgr.isHot("SHFE", "rb2401", 20231013));
+	EXPECT_TRUE(hotMgr.isHot("SHFE", "rb2410", 0));
+	EXPECT_FALSE(hotMgr.isHot("SHFE", "rb2405", 0));
+
+	EXPECT_DOUBLE_EQ(hotMgr.getRuleFactor("HOT", "SHFE.rb", 20231013), 1.0);
+	EXPECT_DOUBLE_EQ(hotMgr.getRuleFactor("HOT", "SHFE.rb", 20231020), 1.0);
+	EXPECT_DOUBLE_EQ(hotMgr.getRuleFactor("HOT", "SHFE.rb", 20240105), 0.95);
+	EXPECT_DOUBLE_EQ(hotMgr.getRuleFactor("HOT", "SHFE.rb", 20240301), 0.95 * 3600 / 3500);
+	EXPECT_DOUBLE_EQ(hotMgr.getRuleFactor("HOT", "SHFE.rb"), 0.95 * 3600 / 3500);
+
+	//整数接口
+	uint32_t ruleIdx = hotMgr.getRuleIndex("HOT", "SHFE.rb");
+	ASSERT_NE(ruleIdx, INVALID_UINT32);
+	EXPECT_EQ(hotMgr.getRuleIndex("HOT", "SHFE.hc"), INVALID_UINT32);
+	const HotSegment* seg = hotMgr.getSegment(ruleIdx, 20240105);
+	ASSERT_TRUE(seg != NULL);
+	EXPECT_EQ(seg->_code, "rb2405");
+	EXPECT_EQ(seg->_prev, "rb2401");
+	EXPECT_EQ(seg->_date, 20231229);
+
+	hotMgr.release();
+	BoostFile::delete_file(filename.c_str());
+}
+
+TEST(test_hotmgr, test_perform)
+{
+	//100个品种,每个品种100次换月,逐日查询主力合约和复权因子
+	std::string filename = "./hots_perf.json";
+	SwitchRecords records;
+	make_rules(filename.c_str(), 100, 100, records);
+
+	WTSHotMgr hotMgr;
+	ASSERT_TRUE(hotMgr.loadHots(filename.c_str()));
+
+	std::vector<uint32_t> dates;
+	for (uint32_t dt = 20100101; dt < 20250101; dt = TimeUtils::getNextDate(dt))
+		dates.emplace_back(dt);
+
+	//参照:按品种全称找到按日期排序的map,再用upper_bound查找
+	uint32_t mismatch = 0;
+	uint64_t calls = 0;
+	double checksum1 = 0;
+	char fullPid[64] = { 0 };
+	TimeUtils::Ticker ticker;
+	for (uint32_t p = 0; p < 100; p++)
+	{
+		for (uint32_t dt : dates)
+		{
+			fmtutil::format_to(fullPid, "SHFE.p{}", p);
+			const auto& recs = records[fullPid];
+			auto it = recs.upper_bound(dt);
+			if (it == recs.begin())
+				continue;
+
+			it--;
+			checksum1 += it->second._factor + it->second._to.size();
+			calls++;
+		}
+	}
+	uint64_t tMap = ticker.nano_seconds();
+
+	double checksum2 = 0;
+	char pid[16] = { 0 };
+	ticker.reset();
+	for (uint32_t p = 0; p < 100; p++)
+	{
+		fmtutil::format_to(pid, "p{}", p);
+		fmtutil::format_to(fullPid, "SHFE.p{}", p);
+		for (uint32_t dt : dates)
+		{
+			const char* code = hotMgr.getRawCode("SHFE", pid, dt);
+			if (code[0] == '\0')
+				continue;
+
+			checksum2 += hotMgr.getRuleFactor("HOT", fullPid, dt) + strlen(code);
+		}
+	}
+	uint64_t tStr = ticker.nano_seconds();
+
+	double checksum3 = 0;
+	ticker.reset();
+	for (uint32_t p = 0; p < 100; p++)
+	{
+		fmtutil::format_to(fullPid, "SHFE.p{}", p);
+		uint32_t ruleIdx = hotMgr.getRuleIndex("HOT", fullPid);
+		for (uint32_t dt : dates)
+		{
+			const HotSegment* seg = hotMgr.getSegment(ruleIdx, dt);
+			if (seg == NULL)
+				continue;
+
+			checksum3 += seg->_factor + seg->_code.size();
+		}
+	}
+	uint64_t tIdx = ticker.nano_seconds();
+
+	//逐条核对
+	for (uint32_t p = 0; p < 100; p++)
+	{
+		fmtutil::format_to(fullPid, "SHFE.p{}", p);
+		fmtutil::format_to(pid, "p{}", p);
+		const auto& recs = records[fullPid];
+		for (uint32_t dt : dates)
+		{
+			auto it = recs.upper_bound(dt);
+			const char* expected = (it == recs.begin()) ? "" : std::prev(it)->second._to.c_str();
+			if (strcmp(expected, hotMgr.getRawCode("SHFE", pid, dt)) != 0)
+				mismatch++;
+		}
+	}
+
+	EXPECT_EQ(mismatch, 0);
+	EXPECT_NEAR(checksum1, checksum2, 1e-6);
+	EXPECT_NEAR(checksum1, checksum3, 1e-6);
+	fmt::print("{} lookups - reference map: {:.1f}ns, string api: {:.1f}ns, index api: {:.1f}ns\n",
+		calls, tMap*1.0 / calls, tStr*1.0 / calls, tIdx*1.0 / calls);
+
+	hotMgr.release();
+	BoostFile::delete_file(filename.c_str());
+}
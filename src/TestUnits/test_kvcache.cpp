@@ -38,6 +38,180 @@ TEST(test_kvcache, test_usage)
 	}
 }
 
+/*
+ *	一个线程不停覆盖同一个key,另一个线程读,不能读到写了一半的值
+ */
+TEST(test_kvcache, test_overwrite_concurrent)
+{
+	const char* filename = "./kvcache_overwrite.dat";
+	BoostFile::delete_file(filename);
+
+	WtKVCache cache;
+	EXPECT_TRUE(cache.init(filename, 20231117));
+
+	std::string valA(63, 'A');
+	std::string valB(63, 'B');
+	cache.put("key", valA.c_str());
+
+	std::atomic<bool> stopped(false);
+	std::thread writer([&]() {
+		for (uint32_t i = 0; i < 200000; i++)
+			cache.put("key", (i % 2 == 0) ? valB.c_str() : valA.c_str());
+		stopped = true;
+	});
+
+	uint32_t torn = 0;
+	uint32_t reads = 0;
+	while (!stopped || reads < 1000)
+	{
+		const char* val = cache.get("key");
+		if (strcmp(val, valA.c_str()) != 0 && strcmp(val, valB.c_str()) != 0)
+			torn++;
+		reads++;
+	}
+	writer.join();
+
+	EXPECT_EQ(torn, 0);
+	EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(test_kvcache, test_grow_reopen)
+{
+	const char* filename = "./kvcache_grow.dat";
+	BoostFile::delete_file(filename);
+
+	char key[32] = { 0 };
+	{
+		WtKVCache cache;
+		EXPECT_TRUE(cache.init(filename, 20231117));
+		EXPECT_EQ(cache.capacity(), KV_INIT_CAPACITY);
+
+		//超过负载以后要扩容,扩容前拿到的值不受影响
+		cache.put("first", "value0");
+		const char* first = cache.get("first");
+		for (uint32_t i = 0; i < 10000; i++)
+		{
+			char* s = fmt::format_to(key, "order.{}", i);
+			s[0] = '\0';
+			cache.put(key, key);
+		}
+		EXPECT_STREQ(first, "value0");
+		EXPECT_EQ(cache.size(), 10001);
+		EXPECT_EQ(cache.capacity(), 16384);
+
+		cache.put("first", "value1");
+		EXPECT_EQ(cache.size(), 10001);
+	}
+
+	//重新打开直接就能用,不需要重建索引
+	WtKVCache cache;
+	EXPECT_TRUE(cache.init(filename, 20231117));
+	EXPECT_EQ(cache.size(), 10001);
+	EXPECT_EQ(cache.capacity(), 16384);
+	EXPECT_STREQ(cache.get("first"), "value1");
+	for (uint32_t i = 0; i < 10000; i++)
+	{
+		char* s = fmt::format_to(key, "order.{}", i);
+		s[0] = '\0';
+		EXPECT_STREQ(cache.get(key), key);
+	}
+	EXPECT_FALSE(cache.has("order.10000"));
+}
+
+TEST(test_kvcache, test_expire)
+{
+	const char* filename = "./kvcache_expire.dat";
+	BoostFile::delete_file(filename);
+
+	char key[32] = { 0 };
+	{
+		WtKVCache cache;
+		EXPECT_TRUE(cache.init(filename, 20231116, nullptr, 2));
+		for (uint32_t i = 0; i < 2000; i++)
+		{
+			char* s = fmt::format_to(key, "d1.{}", i);
+			s[0] = '\0';
+			cache.put(key, "1");
+		}
+		EXPECT_EQ(cache.capacity(), 4096);
+	}
+
+	{
+		//保留两个交易日,前一天的还在
+		WtKVCache cache;
+		EXPECT_TRUE(cache.init(filename, 20231117, nullptr, 2));
+		EXPECT_EQ(cache.size(), 2000);
+		cache.put("d2.0", "2");
+	}
+
+	{
+		//第三天只剩下前一天写入的,文件也压缩了
+		WtKVCache cache;
+		EXPECT_TRUE(cache.init(filename, 20231120, nullptr, 2));
+		EXPECT_EQ(cache.size(), 1);
+		EXPECT_EQ(cache.capacity(), KV_INIT_CAPACITY);
+		EXPECT_STREQ(cache.get("d2.0"), "2");
+		EXPECT_STREQ(cache.get("d1.0"), "");
+	}
+
+	//默认只保留当天
+	WtKVCache cache;
+	EXPECT_TRUE(cache.init(filename, 20231121));
+	EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(test_kvcache, test_long_key)
+{
+	const char* filename = "./kvcache_longkey.dat";
+	BoostFile::delete_file(filename);
+
+	WtKVCache cache;
+	EXPECT_TRUE(cache.init(filename, 20231117));
+
+	//前63个字符相同的两个key,截断以后会混在一起,所以都不写入
+	std::string prefix(63, 'k');
+	std::string key1 = prefix + "1";
+	std::string key2 = prefix + "2";
+	uint32_t rejected = 0;
+	cache.put(key1.c_str(), "v1", 0, [&rejected](const char* msg) { rejected++; });
+	cache.put(key2.c_str(), "v2", 0, [&rejected](const char* msg) { rejected++; });
+	EXPECT_EQ(rejected, 2);
+	EXPECT_EQ(cache.size(), 0);
+	EXPECT_FALSE(cache.has(key1.c_str()));
+	EXPECT_STREQ(cache.get(key2.c_str()), "");
+
+	//63个字符正好放得下
+	cache.put(prefix.c_str(), "v0");
+	EXPECT_STREQ(cache.get(prefix.c_str()), "v0");
+
+	cache.clear();
+	EXPECT_EQ(cache.size(), 0);
+	EXPECT_FALSE(cache.has(prefix.c_str()));
+	cache.put("k", "v");
+	EXPECT_STREQ(cache.get("k"), "v");
+}
+
+TEST(test_kvcache, test_upgrade)
+{
+	//老版本顺序存储的文件
+	const char* filename = "./kvcache_v1.dat";
+	std::string content(20 + 128 * 200, '\0');
+	memcpy((char*)content.data(), CACHE_FLAG, FLAG_SIZE);
+	uint32_t header[3] = { 2, 200, 20231117 };
+	memcpy((char*)content.data() + 8, header, sizeof(header));
+	strcpy((char*)content.data() + 20, "eid1");
+	strcpy((char*)content.data() + 20 + 64, "tag1");
+	strcpy((char*)content.data() + 20 + 128, "eid2");
+	strcpy((char*)content.data() + 20 + 192, "tag2");
+	BoostFile::write_file_contents(filename, content.c_str(), (uint32_t)content.size());
+
+	WtKVCache cache;
+	EXPECT_TRUE(cache.init(filename, 20231117));
+	EXPECT_EQ(cache.size(), 2);
+	EXPECT_STREQ(cache.get("eid1"), "tag1");
+	EXPECT_STREQ(cache.get("eid2"), "tag2");
+}
+
 TEST(test_kvcache, test_perform)
 {
 	WtKVCache cache;
@@ -0,0 +1,196 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../WTSUtils/WtLMDBBatch.hpp"
+#include "../Share/BoostFile.hpp"
+#include "../Share/TimeUtils.hpp"
+#include "../Share/fmtlib.h"
+
+#include <boost/filesystem.hpp>
+
+USING_NS_WTP;
+
+#pragma pack(push, 1)
+typedef struct _TestKey
+{
+	char		_code[16];
+	uint32_t	_time;	//大端,和LMDBKeys里的一样保证按时间排序
+
+	_TestKey(const char* code, uint32_t t)
+	{
+		memset(this, 0, sizeof(_TestKey));
+		strcpy(_code, code);
+		_time = ((t & 0xFF) << 24) | ((t & 0xFF00) << 8) | ((t & 0xFF0000) >> 8) | ((t >> 24) & 0xFF);
+	}
+} TestKey;
+#pragma pack(pop)
+
+typedef struct _TestValue
+{
+	uint32_t	_seq;
+	char		_data[508];	//和tick差不多大
+} TestValue;
+
+static WtLMDBPtr open_db(const char* path)
+{
+	boost::filesystem::remove_all(path);
+	boost::filesystem::create_directories(path);
+	WtLMDBPtr db(new WtLMDB(false));
+	db->open(path, 256 * 1024 * 1024);
+	return db;
+}
+
+static std::size_t count_db(WtLMDB& db, std::map<std::string, uint32_t>& result)
+{
+	WtLMDBQuery query(db);
+	query.get_range(std::string(sizeof(TestKey), '\0'), std::string(sizeof(TestKey), '\xFF'), [&result](const ValueArray& ayKeys, const ValueArray& ayVals) {
+		for (std::size_t i = 0; i < ayKeys.size(); i++)
+			result[ayKeys[i]] = ((const TestValue*)ayVals[i].data())->_seq;
+	});
+	return result.size();
+}
+
+TEST(test_lmdb_batch, test_usage)
+{
+	WtLMDBPtr tickDB = open_db("./lmdb_batch_t");
+	WtLMDBPtr barDB = open_db("./lmdb_batch_k");
+
+	std::map<std::string, uint32_t> tickExpected, barExpected;
+	{
+		WtLMDBBatchWriter writer;
+		writer.start(100, 10, true, 20);
+
+		TestValue val;
+		memset(&val, 0, sizeof(val));
+		const char* codes[] = { "rb2401", "hc2401", "au2312" };
+		for (uint32_t i = 0; i < 3000; i++)
+		{
+			val._seq = i;
+
+			//tick库key递增,中间插一条乱序的,要退回到普通写入
+			uint32_t t = (i == 1500) ? 5 : 90000000 + i;
+			TestKey tKey("rb2401", t);
+			writer.put(tickDB, &tKey, sizeof(tKey), &val, sizeof(val), true);
+			tickExpected[std::string((const char*)&tKey, sizeof(tKey))] = i;
+
+			//K线库多个合约交错写入,同一个key重复写,以最后一次为准
+			TestKey kKey(codes[i % 3], 1000 + i / 30);
+			writer.put(barDB, &kKey, sizeof(kKey), &val, sizeof(val), false);
+			barExpected[std::string((const char*)&kKey, sizeof(kKey))] = i;
+		}
+		writer.stop();
+
+		EXPECT_EQ(writer.records(), 6000);
+		EXPECT_LT(writer.commits(), 6000);
+	}
+
+	std::map<std::string, uint32_t> tickResult, barResult;
+	EXPECT_EQ(count_db(*tickDB, tickResult), 3000);
+	EXPECT_TRUE(tickResult == tickExpected);
+	EXPECT_EQ(count_db(*barDB, barResult), 300);
+	EXPECT_TRUE(barResult == barExpected);
+
+	//批量导入,一个事务写完
+	WtLMDBBatch batch;
+	TestValue val;
+	memset(&val, 0, sizeof(val));
+	for (uint32_t i = 0; i < 1000; i++)
+	{
+		val._seq = 10000 + i;
+		TestKey key("ag2312", 1000 - i);
+		batch.add(&key, sizeof(key), &val, sizeof(val));
+	}
+	batch.sort();
+	EXPECT_TRUE(batch.write(*barDB, true));
+	barResult.clear();
+	EXPECT_EQ(count_db(*barDB, barResult), 1300);
+
+	tickDB.reset();
+	barDB.reset();
+	boost::filesystem::remove_all("./lmdb_batch_t");
+	boost::filesystem::remove_all("./lmdb_batch_k");
+}
+
+TEST(test_lmdb_batch, test_retry)
+{
+	WtLMDBPtr db = open_db("./lmdb_batch_r");
+
+	uint32_t lost = 0;
+	{
+		WtLMDBBatchWriter writer;
+		writer.set_error_callback([&lost](WtLMDB* db, uint32_t count) {
+			lost += count;
+		});
+		writer.start(100, 10, false, 1000);
+
+		TestValue val;
+		memset(&val, 0, sizeof(val));
+		for (uint32_t i = 0; i < 50; i++)
+		{
+			val._seq = i;
+			TestKey key("rb2401", 1000 + i);
+			writer.put(db, &key, sizeof(key), &val, sizeof(val), true);
+
+			//超过LMDB最大长度的key写不进去,整批提交会失败
+			if (i == 25)
+			{
+				std::string badKey(1024, 'x');
+				writer.put(db, badKey.data(), badKey.size(), &val, sizeof(val), true);
+			}
+		}
+		writer.stop();
+
+		EXPECT_EQ(writer.records(), 50);
+	}
+
+	//只丢掉出错的那一条
+	EXPECT_EQ(lost, 1);
+	std::map<std::string, uint32_t> result;
+	EXPECT_EQ(count_db(*db, result), 50);
+
+	db.reset();
+	boost::filesystem::remove_all("./lmdb_batch_r");
+}
+
+TEST(test_lmdb_batch, test_perform)
+{
+	TestValue val;
+	memset(&val, 0, sizeof(val));
+
+	//每笔数据一个事务
+	const uint32_t singleCnt = 2000;
+	WtLMDBPtr db = open_db("./lmdb_batch_perf");
+	TimeUtils::Ticker ticker;
+	for (uint32_t i = 0; i < singleCnt; i++)
+	{
+		TestKey key("rb2401", i);
+		val._seq = i;
+		WtLMDBQuery query(*db);
+		query.put_and_commit(&key, sizeof(key), &val, sizeof(val));
+	}
+	double rateSingle = singleCnt * 1e9 / ticker.nano_seconds();
+	db.reset();
+
+	//分组提交,计时包括停止时把剩下的数据提交完
+	const uint32_t batchCnt = 100000;
+	auto run_batch = [&val, batchCnt](bool bNoSync) {
+		WtLMDBPtr db = open_db("./lmdb_batch_perf");
+		WtLMDBBatchWriter writer;
+		writer.start(1024, 50, bNoSync, 1000);
+		TimeUtils::Ticker ticker;
+		for (uint32_t i = 0; i < batchCnt; i++)
+		{
+			TestKey key("rb2401", i);
+			val._seq = i;
+			writer.put(db, &key, sizeof(key), &val, sizeof(val), true);
+		}
+		writer.stop();
+		return batchCnt * 1e9 / ticker.nano_seconds();
+	};
+
+	double rateSync = run_batch(false);
+	double rateNoSync = run_batch(true);
+
+	fmt::print("lmdb write throughput - per record commit: {:.0f}/s, group commit(sync): {:.0f}/s, group commit(nosync): {:.0f}/s\n",
+		rateSingle, rateSync, rateNoSync);
+
+	boost::filesystem::remove_all("./lmdb_batch_perf");
+}
@@ -0,0 +1,95 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../WTSUtils/WtLMDBPool.hpp"
+
+#include <boost/filesystem.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+USING_NS_WTP;
+
+static void make_db(const char* path, const char* val)
+{
+	boost::filesystem::remove_all(path);
+	boost::filesystem::create_directories(path);
+	WtLMDB db(false);
+	db.open(path, 16 * 1024 * 1024);
+	WtLMDBQuery query(db);
+	query.put("data", val);
+}
+
+static std::string read_db(WtLMDB& db)
+{
+	WtLMDBQuery query(db);
+	return query.get("data");
+}
+
+/*
+ *	同一个交易所下的两个合约,要各自打开各自的数据库
+ *	再次获取的时候拿到的还是同一个,缓存不能被取走
+ */
+TEST(test_lmdb_pool, test_same_exchg)
+{
+	make_db("./lmdb_pool/ticks/SSE/600000", "600000");
+	make_db("./lmdb_pool/ticks/SSE/600001", "600001");
+
+	WtLMDBPool pool;
+	std::string errmsg;
+	bool bOpened = false;
+
+	WtLMDBPool::WtLMDBPtr db1 = pool.get("SSE.600000", "./lmdb_pool/ticks/SSE/600000", errmsg, bOpened);
+	ASSERT_TRUE(db1 != NULL);
+	EXPECT_TRUE(bOpened);
+	WtLMDBPool::WtLMDBPtr db2 = pool.get("SSE.600001", "./lmdb_pool/ticks/SSE/600001", errmsg, bOpened);
+	ASSERT_TRUE(db2 != NULL);
+	EXPECT_TRUE(bOpened);
+	EXPECT_NE(db1, db2);
+	EXPECT_EQ(read_db(*db1), "600000");
+	EXPECT_EQ(read_db(*db2), "600001");
+
+	WtLMDBPool::WtLMDBPtr again = pool.get("SSE.600000", "./lmdb_pool/ticks/SSE/600000", errmsg, bOpened);
+	EXPECT_FALSE(bOpened);
+	EXPECT_EQ(again, db1);
+	again = pool.get("SSE.600000", "./lmdb_pool/ticks/SSE/600000", errmsg, bOpened);
+	EXPECT_EQ(again, db1);
+	EXPECT_EQ(pool.size(), 2);
+
+	WtLMDBPool::WtLMDBPtr none = pool.get("SSE.600002", "./lmdb_pool/ticks/SSE/600002", errmsg, bOpened);
+	EXPECT_TRUE(none == NULL);
+	EXPECT_TRUE(errmsg.empty());
+	EXPECT_EQ(pool.size(), 2);
+}
+
+/*
+ *	预读线程和回放线程同时获取
+ */
+TEST(test_lmdb_pool, test_concurrent)
+{
+	make_db("./lmdb_pool/ticks/SSE/600000", "600000");
+	make_db("./lmdb_pool/ticks/SSE/600001", "600001");
+
+	WtLMDBPool pool;
+	std::vector<std::thread> workers;
+	std::atomic<uint32_t> failed(0);
+	for (uint32_t t = 0; t < 4; t++)
+	{
+		workers.emplace_back([&pool, &failed, t]() {
+			for (uint32_t i = 0; i < 200; i++)
+			{
+				const char* code = (i + t) % 2 == 0 ? "600000" : "600001";
+				std::string key = std::string("SSE.") + code;
+				std::string path = std::string("./lmdb_pool/ticks/SSE/") + code;
+				std::string errmsg;
+				bool bOpened = false;
+				WtLMDBPool::WtLMDBPtr db = pool.get(key, path, errmsg, bOpened);
+				if (db == NULL || read_db(*db) != code)
+					failed++;
+			}
+		});
+	}
+	for (auto& thrd : workers)
+		thrd.join();
+
+	EXPECT_EQ(failed.load(), 0);
+	EXPECT_EQ(pool.size(), 2);
+}
@@ -0,0 +1,170 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../WTSTools/WTSLogger.h"
+#include "../Share/BoostFile.hpp"
+#include "../Share/StdUtils.hpp"
+#include "../Share/StrUtil.hpp"
+#include "../Share/TimeUtils.hpp"
+
+#include <algorithm>
+
+static const char* LOG_FILE = "./logs/test_logger.log";
+
+/*
+ *	日志模块是全局的,只初始化一次
+ *	只输出消息本身,方便比较同步和延迟格式化的结果
+ */
+static void init_logger()
+{
+	static bool bInited = false;
+	if (bInited)
+		return;
+
+	std::string cfg = fmt::format("{{\"root\":{{\"async\":false,\"level\":\"debug\",\"sinks\":[{{\"type\":\"basic_file_sink\",\"filename\":\"{}\",\"pattern\":\"%v\",\"truncate\":true}}]}}}}", LOG_FILE);
+	BoostFile::write_file_contents("./logcfg_test.json", cfg.c_str(), (uint32_t)cfg.size());
+	WTSLogger::init("./logcfg_test.json");
+	BoostFile::delete_file("./logcfg_test.json");
+	bInited = true;
+}
+
+static StringVector read_log_lines()
+{
+	spdlog::get("root")->flush();
+	std::string content;
+	BoostFile::read_file_contents(LOG_FILE, content);
+	StrUtil::replace(content, "\r", "");
+	StringVector ret = StrUtil::split(content, "\n");
+	if (!ret.empty() && ret.back().empty())
+		ret.pop_back();
+	return ret;
+}
+
+static void write_logs(uint32_t round)
+{
+	std::string strCode = "SHFE.rb.2401";
+	char buf[64] = "buffer used as format";
+	const char* msg = "全部成交";
+	WTSLogger::info("[{}] order {} of {} {:.2f}@{} {}", round, 1001u, strCode, 3801.5, 12, msg);
+	WTSLogger::debug("signal {} {} {} {}", true, 'x', (int64_t)-9876543210, 1e-7);
+	WTSLogger::warn("{:>10}|{:<8}|{:08.3f}", "right", "left", -3.14159);
+	WTSLogger::error(buf);
+	WTSLogger::fatal("no args");
+	WTSLogger::log(LL_INFO, "level {} by arg", (uint32_t)LL_INFO);
+	WTSLogger::log_raw(LL_WARN, "raw message {}");
+	//太长的参数放不下,退回到同步流程
+	WTSLogger::info("long {}", std::string(1000, 'L'));
+}
+
+TEST(test_logger, test_usage)
+{
+	init_logger();
+
+	//同步输出和延迟格式化输出的内容要一样
+	write_logs(0);
+	StringVector syncLines = read_log_lines();
+
+	WTSLogger::enableDeferred(true, 1024, true);
+	write_logs(0);
+	WTSLogger::enableDeferred(false);
+	StringVector allLines = read_log_lines();
+
+	//退回同步流程的日志会比队列里的先输出,所以排序以后再比较
+	ASSERT_EQ(allLines.size(), syncLines.size() * 2);
+	StringVector deferredLines(allLines.begin() + syncLines.size(), allLines.end());
+	std::sort(deferredLines.begin(), deferredLines.end());
+	StringVector sortedLines = syncLines;
+	std::sort(sortedLines.begin(), sortedLines.end());
+	EXPECT_TRUE(deferredLines == sortedLines);
+	EXPECT_EQ(syncLines[0], "[0] order 1001 of SHFE.rb.2401 3801.50@12 全部成交");
+	EXPECT_EQ(syncLines[3], "buffer used as format");
+	EXPECT_EQ(syncLines.size(), 8);
+
+	//多个线程同时写,每个线程的日志按顺序,一条不丢
+	std::size_t base = allLines.size();
+	WTSLogger::enableDeferred(true, 64, true);
+	std::vector<StdThreadPtr> threads;
+	for (uint32_t t = 0; t < 4; t++)
+	{
+		threads.emplace_back(new StdThread([t]() {
+			for (uint32_t i = 0; i < 5000; i++)
+				WTSLogger::info("thread {} seq {}", t, i);
+		}));
+	}
+	for (auto& thrd : threads)
+		thrd->join();
+	WTSLogger::enableDeferred(false);
+	EXPECT_EQ(WTSLogger::getDroppedCount(), 0);
+
+	allLines = read_log_lines();
+	ASSERT_EQ(allLines.size(), base + 20000);
+	std::vector<uint32_t> nexts(4, 0);
+	bool ordered = true;
+	for (std::size_t i = base; i < allLines.size(); i++)
+	{
+		uint32_t t = 0, seq = 0;
+		sscanf(allLines[i].c_str(), "thread %u seq %u", &t, &seq);
+		if (t >= 4 || seq != nexts[t])
+			ordered = false;
+		else
+			nexts[t]++;
+	}
+	EXPECT_TRUE(ordered);
+}
+
+/*
+ *	没有调用stop就退出进程,后台线程要正常结束,队列里的日志都要输出
+ *	在子进程里执行,父进程检查退出码和日志文件
+ */
+TEST(test_logger, test_exit_without_stop)
+{
+	init_logger();
+
+	//子进程重新启动再执行,不带父进程里其他线程的状态
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	EXPECT_EXIT({
+		WTSLogger::enableDeferred(true, 4096, false);
+		for (uint32_t i = 0; i < 1000; i++)
+			WTSLogger::info("exit seq {}", i);
+		std::exit(0);
+	}, ::testing::ExitedWithCode(0), "");
+
+	//子进程重新初始化的时候会清空日志文件
+	StringVector allLines = read_log_lines();
+	ASSERT_EQ(allLines.size(), 1000);
+	EXPECT_EQ(allLines.front(), "exit seq 0");
+	EXPECT_EQ(allLines.back(), "exit seq 999");
+}
+
+TEST(test_logger, test_perform)
+{
+	init_logger();
+
+	//交易线程上每条日志调用的耗时,队列足够大,不丢日志
+	const uint32_t times = 50000;
+	std::vector<uint64_t> costs(times);
+	std::string strCode = "SHFE.rb.2401";
+	auto run = [&costs, &strCode, times]() {
+		for (uint32_t i = 0; i < times; i++)
+		{
+			TimeUtils::Ticker ticker;
+			WTSLogger::info("order {} of {} traded {:.2f}@{}, left {}", 100000 + i, strCode, 3801.5 + i % 10, i % 7 + 1, i % 3);
+			costs[i] = ticker.nano_seconds();
+		}
+		std::sort(costs.begin(), costs.end());
+	};
+
+	run();
+	uint64_t p50Sync = costs[times / 2];
+	uint64_t p99Sync = costs[times * 99 / 100];
+
+	WTSLogger::enableDeferred(true, 65536, false);
+	run();
+	WTSLogger::enableDeferred(false);
+	uint64_t p50Defer = costs[times / 2];
+	uint64_t p99Defer = costs[times * 99 / 100];
+
+	fmt::print("log call latency of {} calls - sync p50: {}ns, p99: {}ns; deferred p50: {}ns, p99: {}ns, dropped: {}\n",
+		times, p50Sync, p99Sync, p50Defer, p99Defer, WTSLogger::getDroppedCount());
+
+	BoostFile::delete_file(LOG_FILE);
+}
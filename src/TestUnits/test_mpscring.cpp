@@ -0,0 +1,167 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../Share/WtMpscRing.hpp"
+#include "../Share/StdUtils.hpp"
+#include "../Share/TimeUtils.hpp"
+#include "../Share/fmtlib.h"
+
+#include <deque>
+#include <functional>
+
+USING_NS_WTP;
+
+typedef struct _TestEvent
+{
+	uint32_t	_producer;
+	uint32_t	_seq;
+	double		_price;
+	char		_code[64];
+	char		_msg[256];
+} TestEvent;
+
+TEST(test_mpscring, test_usage)
+{
+	//容量向上取整到2的幂
+	WtMpscRing<TestEvent> ring(5);
+	EXPECT_EQ(ring.capacity(), 8);
+	EXPECT_TRUE(ring.empty());
+
+	uint32_t seq = 0;
+	auto fill = [&seq](TestEvent& evt) {
+		evt._seq = seq++;
+	};
+	for (uint32_t i = 0; i < 8; i++)
+		EXPECT_TRUE(ring.push(fill));
+
+	//满了以后丢弃并计数
+	EXPECT_FALSE(ring.push(fill));
+	EXPECT_EQ(ring.dropped(), 1);
+
+	uint32_t expected = 0;
+	auto check = [&expected](TestEvent& evt) {
+		EXPECT_EQ(evt._seq, expected);
+		expected++;
+	};
+	EXPECT_EQ(ring.drain(check, 3), 3);
+
+	//读出来的槽位可以马上复用
+	seq = 8;
+	for (uint32_t i = 0; i < 3; i++)
+		EXPECT_TRUE(ring.push(fill));
+	EXPECT_FALSE(ring.push(fill));
+
+	EXPECT_EQ(ring.drain(check), 8);
+	EXPECT_EQ(expected, 11);
+	EXPECT_TRUE(ring.empty());
+	EXPECT_FALSE(ring.pop(check));
+}
+
+TEST(test_mpscring, test_multi_producer)
+{
+	//多个线程同时写,每个线程自己的消息必须按顺序收到,一条不丢
+	const uint32_t producers = 4;
+	const uint32_t count = 100000;
+	WtMpscRing<TestEvent> ring(1024);
+
+	std::vector<StdThreadPtr> threads;
+	for (uint32_t p = 0; p < producers; p++)
+	{
+		threads.emplace_back(new StdThread([&ring, p, count]() {
+			for (uint32_t i = 0; i < count; i++)
+			{
+				//测试里不能丢,满了就重试
+				while (!ring.push([p, i](TestEvent& evt) {
+					evt._producer = p;
+					evt._seq = i;
+				}))
+					std::this_thread::yield();
+			}
+		}));
+	}
+
+	std::vector<uint32_t> nexts(producers, 0);
+	uint32_t total = 0;
+	bool ordered = true;
+	while (total < producers * count)
+	{
+		total += ring.drain([&nexts, &ordered](TestEvent& evt) {
+			if (evt._seq != nexts[evt._producer])
+				ordered = false;
+			nexts[evt._producer] = evt._seq + 1;
+		});
+	}
+
+	for (auto& t : threads)
+		t->join();
+
+	EXPECT_TRUE(ordered);
+	EXPECT_TRUE(ring.empty());
+	for (uint32_t p = 0; p < producers; p++)
+		EXPECT_EQ(nexts[p], count);
+}
+
+TEST(test_mpscring, test_perform)
+{
+	//对比交易线程上的开销:原来每条通知要拷贝几个字符串,再投递一个闭包到加锁的队列里
+	const uint32_t times = 1000000;
+	const char* code = "SHFE.rb.2401";
+	const char* msg = "全部成交";
+
+	std::deque<std::function<void()>> queue;
+	StdUniqueMutex mtx;
+	uint64_t checksum = 0;
+	uint64_t tPost = 0;
+	TimeUtils::Ticker ticker;
+	for (uint32_t i = 0; i < times; i++)
+	{
+		std::string strCode = code;
+		std::string strMsg = msg;
+		double price = 3800 + i % 10;
+		{
+			StdUniqueLock lock(mtx);
+			queue.emplace_back([strCode, strMsg, price, &checksum]() {
+				checksum += strCode.size() + strMsg.size();
+			});
+		}
+
+		//消费线程的工作不计入
+		if (queue.size() >= 1024)
+		{
+			tPost += ticker.nano_seconds();
+			for (auto& f : queue)
+				f();
+			queue.clear();
+			ticker.reset();
+		}
+	}
+	tPost += ticker.nano_seconds();
+	uint64_t checksum1 = checksum;
+
+	WtMpscRing<TestEvent> ring(1024);
+	checksum = 0;
+	uint64_t tRing = 0;
+	ticker.reset();
+	for (uint32_t i = 0; i < times; i++)
+	{
+		ring.push([code, msg, i](TestEvent& evt) {
+			evt._seq = i;
+			evt._price = 3800 + i % 10;
+			wt_strcpy(evt._code, code);
+			wt_strcpy(evt._msg, msg);
+		});
+
+		if ((i & 1023) == 1023)
+		{
+			tRing += ticker.nano_seconds();
+			ring.drain([&checksum](TestEvent& evt) {
+				checksum += strlen(evt._code) + strlen(evt._msg);
+			});
+			ticker.reset();
+		}
+	}
+	tRing += ticker.nano_seconds();
+
+	EXPECT_EQ(checksum, checksum1);
+	EXPECT_EQ(ring.dropped(), 0);
+	fmt::print("notify on hot thread - string copy + locked post: {:.1f}ns, ring buffer: {:.1f}ns\n",
+		tPost*1.0 / times, tRing*1.0 / times);
+}
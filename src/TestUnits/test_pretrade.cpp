@@ -0,0 +1,182 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../Share/WtPreTradeRisk.hpp"
+#include "../Share/TimeUtils.hpp"
+#include "../Share/fmtlib.h"
+
+#include <thread>
+
+USING_NS_WTP;
+
+TEST(test_pretrade, test_rules)
+{
+	WtPreTradeRisk risk;
+	risk.set_active(true);
+	risk.enable_latency_stat(false);
+
+	PreTradeLimits limits;
+	limits._max_order_qty = 10;
+	limits._max_net_pos = 20;
+	limits._max_order_notional = 200000;
+	limits._price_band = 0.05;
+	limits._check_selfmatch = true;
+	risk.add_limits("SHFE.rb", limits);
+
+	uint32_t idx = risk.slot_of("SHFE.rb.2401", "SHFE.rb", 10);
+	EXPECT_EQ(risk.slot_of("SHFE.rb.2401", "SHFE.rb", 10), idx);
+
+	uint64_t now = 1000000;
+	EXPECT_EQ(risk.check(idx, true, 3800, 11, now), PTR_ORDER_QTY);
+	EXPECT_EQ(risk.check(idx, true, 3800, 5, now), PTR_PASS);
+	EXPECT_EQ(risk.check(idx, true, 3800, 3, now), PTR_PASS);
+	EXPECT_EQ(risk.check(idx, true, 4100, 5, now), PTR_NOTIONAL);
+
+	//挂单和持仓一起算净头寸
+	risk.on_entrust(idx, 1, true, 3800, 8, now);
+	risk.on_trade(idx, true, 8, 3800);
+	risk.on_order(idx, 1, 0);
+	risk.on_entrust(idx, 2, true, 3790, 8, now);
+	EXPECT_EQ(risk.check(idx, true, 3790, 5, now), PTR_POSITION);
+
+	//参考价取最近一笔成交价
+	EXPECT_EQ(risk.check(idx, false, 3500, 1, now), PTR_PRICE_BAND);
+
+	//卖价低于自己的买单挂单价,可能自成交
+	EXPECT_EQ(risk.check(idx, false, 3785, 1, now), PTR_SELF_MATCH);
+	EXPECT_EQ(risk.check(idx, false, 3795, 1, now), PTR_PASS);
+
+	//买单撤了以后就可以卖了
+	risk.on_order(idx, 2, 0);
+	EXPECT_EQ(risk.check(idx, false, 3785, 1, now), PTR_PASS);
+
+	//没有规则的代码直接通过
+	uint32_t other = risk.slot_of("SHFE.hc.2401", "SHFE.hc", 10);
+	EXPECT_EQ(risk.check(other, true, 3800, 1000, now), PTR_PASS);
+}
+
+TEST(test_pretrade, test_account)
+{
+	WtPreTradeRisk risk;
+	risk.set_active(true);
+	risk.set_account_limits(50000, 3, 1000);
+
+	uint32_t idx = risk.slot_of("CFFEX.IF.2312", "CFFEX.IF", 1);
+	uint64_t now = 1000000;
+	for (uint32_t i = 1; i <= 4; i++)
+	{
+		EXPECT_EQ(risk.check(idx, true, 100, 1, now + i), PTR_PASS);
+		risk.on_entrust(idx, i, true, 100, 1, now + i);
+	}
+
+	//窗口内已经有4笔了,再来一笔就超过了
+	EXPECT_EQ(risk.check(idx, true, 100, 1, now + 10), PTR_ORDER_RATE);
+	EXPECT_EQ(risk.check(idx, true, 100, 1, now + 2000), PTR_PASS);
+
+	EXPECT_EQ(risk.check(idx, true, 100, 500, now + 2000), PTR_ACCT_NOTIONAL);
+}
+
+/*
+ *	策略线程下单检查,回报线程更新挂单,同时还有新代码分配槽位
+ *	所有订单结束以后挂单数量要回到0
+ */
+TEST(test_pretrade, test_concurrent)
+{
+	WtPreTradeRisk risk;
+	risk.set_active(true);
+	risk.enable_latency_stat(false);
+
+	const uint32_t count = 20000;
+	PreTradeLimits limits;
+	limits._max_net_pos = count + 1;
+	risk.add_limits("SHFE.rb.2401", limits);
+
+	uint32_t idx = risk.slot_of("SHFE.rb.2401", "SHFE.rb", 10);
+	std::atomic<uint32_t> sent(0);
+
+	std::thread trader([&risk, &sent, idx]() {
+		for (uint32_t localid = 1; localid <= count; localid++)
+		{
+			while (sent.load(std::memory_order_acquire) < localid)
+				std::this_thread::yield();
+
+			risk.on_order(idx, localid, 0);
+			risk.on_trade(idx, true, 1, 3800);
+		}
+	});
+
+	for (uint32_t localid = 1; localid <= count; localid++)
+	{
+		risk.check(idx, true, 3800, 1, localid);
+		risk.on_entrust(idx, localid, true, 3800, 1, localid);
+		sent.store(localid, std::memory_order_release);
+
+		//其他代码第一次下单,槽位扩容
+		if (localid % 100 == 0)
+			risk.slot_of(fmt::format("SHFE.rb.{}", localid).c_str(), "SHFE.rb", 10);
+	}
+	trader.join();
+
+	//挂单全部释放,净头寸是成交的总和,再买1手正好到上限
+	EXPECT_EQ(risk.check(idx, true, 3800, 1, count + 1), PTR_PASS);
+	EXPECT_EQ(risk.check(idx, true, 3800, 2, count + 1), PTR_POSITION);
+}
+
+TEST(test_pretrade, test_histogram)
+{
+	WtLatencyHistogram hist;
+	for (uint64_t i = 1; i <= 1000; i++)
+		hist.record(i);
+
+	EXPECT_EQ(hist.count(), 1000);
+	EXPECT_EQ(hist.min(), 1);
+	EXPECT_EQ(hist.max(), 1000);
+
+	//分桶的相对误差在12.5%以内
+	uint64_t p50 = hist.percentile(50);
+	EXPECT_GE(p50, 500);
+	EXPECT_LE(p50, 563);
+	EXPECT_EQ(hist.percentile(100), 1000);
+
+	uint64_t vals[] = { 0, 7, 8, 100, 123456789, UINT64_MAX };
+	for (uint64_t v : vals)
+	{
+		uint32_t idx = WtLatencyHistogram::index_of(v);
+		EXPECT_LT(idx, WtLatencyHistogram::BUCKET_COUNT);
+		EXPECT_GE(WtLatencyHistogram::upper_of(idx), v);
+	}
+}
+
+TEST(test_pretrade, test_perform)
+{
+	WtPreTradeRisk risk;
+	risk.set_active(true);
+	risk.set_account_limits(0, 1000, 1000);
+
+	PreTradeLimits limits;
+	limits._max_order_qty = 100;
+	limits._max_net_pos = 1000000;
+	limits._max_order_notional = 1e12;
+	limits._price_band = 0.1;
+	limits._check_selfmatch = true;
+	risk.add_limits("default", limits);
+
+	char buffer[32] = { 0 };
+	std::vector<uint32_t> slots;
+	for (uint32_t i = 0; i < 100; i++)
+	{
+		fmtutil::format_to(buffer, "SSE.{}", 600000 + i);
+		slots.emplace_back(risk.slot_of(buffer, NULL, 100));
+		risk.on_trade(slots.back(), true, 100, 10.0);
+	}
+
+	uint32_t times = 1000000;
+	uint32_t passed = 0;
+	for (uint32_t i = 0; i < times; i++)
+	{
+		uint32_t idx = slots[i % 100];
+		if (risk.check(idx, (i & 1) == 0, 10.0 + (i % 10)*0.01, 1, i) == PTR_PASS)
+			passed++;
+	}
+
+	fmt::print("pre-trade check latency(ns) - {}\n", risk.latency().summary());
+	EXPECT_EQ(passed, times);
+}
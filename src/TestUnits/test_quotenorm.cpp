@@ -0,0 +1,250 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../Share/CodeHelper.hpp"
+#include "../Share/TimeUtils.hpp"
+#include "../Share/fmtlib.h"
+#include "../Includes/FasterDefs.h"
+#include "../Includes/WTSStruct.h"
+#include "../Includes/WTSContractInfo.hpp"
+#include "../API/CTP6.3.15/ThostFtdcUserApiStruct.h"
+
+#include <float.h>
+
+USING_NS_WTP;
+
+//原来ParserCTP里的时间解析
+static uint32_t old_str_to_time(const char* strTime)
+{
+	char str[10] = { 0 };
+	int idx = 0;
+	auto len = strlen(strTime);
+	for (std::size_t i = 0; i < len; i++)
+	{
+		if (strTime[i] != ':')
+		{
+			str[idx] = strTime[i];
+			idx++;
+		}
+	}
+	str[idx] = '\0';
+
+	return strtoul(str, NULL, 10);
+}
+
+TEST(test_quotenorm, test_parse)
+{
+	const char* times[] = { "00:00:00", "09:30:01", "13:05:59", "21:00:00", "23:59:59" };
+	for (const char* t : times)
+		EXPECT_EQ(TimeUtils::parseHMS(t), old_str_to_time(t)) << t;
+
+	//格式不对的交给调用方处理
+	EXPECT_EQ(TimeUtils::parseHMS(""), INVALID_UINT32);
+	EXPECT_EQ(TimeUtils::parseHMS("9:30:01"), INVALID_UINT32);
+	EXPECT_EQ(TimeUtils::parseHMS("093001"), INVALID_UINT32);
+	EXPECT_EQ(TimeUtils::parseHMS("09:3a:01"), INVALID_UINT32);
+
+	EXPECT_EQ(TimeUtils::parseYMD("20231112"), 20231112);
+	EXPECT_EQ(TimeUtils::parseYMD(""), 0);
+	EXPECT_EQ(TimeUtils::parseYMD("2023111"), 0);
+	EXPECT_EQ(TimeUtils::parseYMD("2023-11-12"), 0);
+}
+
+/*
+ *	行情回放测试用的合约,模拟加载合约时算好标准代码
+ */
+typedef struct _ReplayContracts
+{
+	std::vector<WTSCommodityInfo*>	_comms;
+	std::vector<WTSContractInfo*>	_contracts;
+	//基础数据按交易所和代码两级查找
+	wt_hashmap<std::string, wt_hashmap<std::string, WTSContractInfo*>>	_by_exchg;
+
+	~_ReplayContracts()
+	{
+		for (auto c : _contracts)
+			c->release();
+		for (auto c : _comms)
+			c->release();
+	}
+
+	WTSContractInfo* get(const char* code, const char* exchg)
+	{
+		auto it = _by_exchg.find(std::string(exchg));
+		if (it == _by_exchg.end())
+			return NULL;
+
+		auto cit = it->second.find(std::string(code));
+		if (cit == it->second.end())
+			return NULL;
+
+		return cit->second;
+	}
+} ReplayContracts;
+
+static void make_contracts(ReplayContracts& rc)
+{
+	const char* exchgs[] = { "SHFE", "DCE", "CZCE", "CFFEX" };
+	const char* pids[][5] = {
+		{ "rb", "hc", "cu", "al", "ag" },
+		{ "m", "y", "p", "i", "j" },
+		{ "MA", "TA", "SR", "CF", "FG" },
+		{ "IF", "IH", "IC", "IM", "T" }
+	};
+
+	uint32_t idx = 0;
+	for (uint32_t e = 0; e < 4; e++)
+	{
+		for (uint32_t p = 0; p < 5; p++)
+		{
+			WTSCommodityInfo* commInfo = WTSCommodityInfo::create(pids[e][p], pids[e][p], exchgs[e], "FD0900", "CHINA");
+			commInfo->setVolScale(e == 2 ? 10 : 5);
+			commInfo->setCategory(CC_Future);
+			rc._comms.emplace_back(commInfo);
+
+			for (uint32_t m = 1; m <= 12; m++)
+			{
+				std::string code = (e == 2) ? fmt::format("{}4{:02d}", pids[e][p], m) : fmt::format("{}24{:02d}", pids[e][p], m);
+				WTSContractInfo* cInfo = WTSContractInfo::create(code.c_str(), code.c_str(), exchgs[e], pids[e][p]);
+				cInfo->setCommInfo(commInfo);
+				cInfo->setTotalIndex(idx++);
+				cInfo->setStdCode(CodeHelper::rawMonthCodeToStdCode(cInfo->getCode(), cInfo->getExchg()).c_str());
+				rc._contracts.emplace_back(cInfo);
+				rc._by_exchg[exchgs[e]][code] = cInfo;
+			}
+		}
+	}
+}
+
+static void fill_tick(WTSTickStruct& quote, const CThostFtdcDepthMarketDataField* md)
+{
+	quote.price = md->LastPrice;
+	quote.open = md->OpenPrice;
+	quote.high = md->HighestPrice;
+	quote.low = md->LowestPrice;
+	quote.total_volume = md->Volume;
+	quote.open_interest = md->OpenInterest;
+	quote.ask_prices[0] = md->AskPrice1;
+	quote.bid_prices[0] = md->BidPrice1;
+	quote.ask_qty[0] = md->AskVolume1;
+	quote.bid_qty[0] = md->BidVolume1;
+}
+
+TEST(test_quotenorm, test_perform)
+{
+	ReplayContracts rc;
+	make_contracts(rc);
+
+	//录制的行情,CTP行情里的交易所代码一般都有
+	const uint32_t times = 1000000;
+	std::vector<CThostFtdcDepthMarketDataField> records(times);
+	uint32_t seed = 20231112;
+	for (uint32_t i = 0; i < times; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		WTSContractInfo* cInfo = rc._contracts[(seed >> 8) % rc._contracts.size()];
+		CThostFtdcDepthMarketDataField& md = records[i];
+		memset(&md, 0, sizeof(md));
+		wt_strcpy(md.InstrumentID, cInfo->getCode());
+		wt_strcpy(md.ExchangeID, cInfo->getExchg());
+		wt_strcpy(md.ActionDay, "20231112");
+		uint32_t secs = 9 * 3600 + i / 4;
+		fmtutil::format_to(md.UpdateTime, "{:02d}:{:02d}:{:02d}", secs / 3600, secs % 3600 / 60, secs % 60);
+		md.UpdateMillisec = (i % 2) * 500;
+		md.LastPrice = 3800 + (seed >> 16) % 100;
+		md.Turnover = md.LastPrice * 100;
+		md.Volume = i;
+		md.AskPrice1 = md.LastPrice + 1;
+		md.BidPrice1 = md.LastPrice - 1;
+	}
+
+	wt_hashset<std::string> exchgFilter;
+	exchgFilter.insert("SHFE");
+	exchgFilter.insert("DCE");
+	exchgFilter.insert("CZCE");
+	exchgFilter.insert("CFFEX");
+
+	//原来的流程:按字符串查合约,strtoul和拼接解析时间,比较交易所,查过滤集合,再拼一次标准代码
+	WTSTickStruct quote;
+	double checksum1 = 0;
+	TimeUtils::Ticker ticker;
+	for (const CThostFtdcDepthMarketDataField& md : records)
+	{
+		WTSContractInfo* contract = rc.get(md.InstrumentID, md.ExchangeID);
+		if (contract == NULL)
+			continue;
+
+		uint32_t actDate = strtoul(md.ActionDay, NULL, 10);
+		uint32_t actTime = old_str_to_time(md.UpdateTime) * 1000 + md.UpdateMillisec;
+		WTSCommodityInfo* pCommInfo = contract->getCommInfo();
+		strcpy(quote.exchg, pCommInfo->getExchg());
+		quote.action_date = actDate;
+		quote.action_time = actTime;
+		fill_tick(quote, &md);
+		if (strcmp(quote.exchg, "CZCE") == 0)
+			quote.total_turnover = md.Turnover*pCommInfo->getVolScale();
+		else if (md.Turnover != DBL_MAX)
+			quote.total_turnover = md.Turnover;
+
+		if (exchgFilter.find(quote.exchg) == exchgFilter.end())
+			continue;
+
+		std::string stdCode = CodeHelper::rawMonthCodeToStdCode(contract->getCode(), contract->getExchg());
+		wt_strcpy(quote.code, stdCode.c_str(), stdCode.size());
+		checksum1 += quote.total_turnover + quote.action_time + strlen(quote.code);
+	}
+	uint64_t tOld = ticker.nano_seconds();
+
+	//新的流程:合约的规范化信息缓存起来,时间按固定格式解析,过滤结果按合约索引缓存,标准代码直接用
+	typedef struct _CodeMeta
+	{
+		WTSContractInfo*	_contract;
+		double				_turnover_scale;
+		bool				_scale_turnover;
+	} CodeMeta;
+	wt_hashmap<std::string, CodeMeta> metas;
+	std::vector<uint8_t> verdicts;
+	double checksum2 = 0;
+	ticker.reset();
+	for (const CThostFtdcDepthMarketDataField& md : records)
+	{
+		auto it = metas.find(md.InstrumentID);
+		if (it == metas.end())
+		{
+			CodeMeta& meta = metas[md.InstrumentID];
+			meta._contract = rc.get(md.InstrumentID, md.ExchangeID);
+			meta._scale_turnover = (meta._contract && strcmp(meta._contract->getExchg(), "CZCE") == 0);
+			meta._turnover_scale = meta._scale_turnover ? meta._contract->getCommInfo()->getVolScale() : 1.0;
+			it = metas.find(md.InstrumentID);
+		}
+		const CodeMeta& meta = it->second;
+		WTSContractInfo* contract = meta._contract;
+		if (contract == NULL)
+			continue;
+
+		uint32_t actDate = TimeUtils::parseYMD(md.ActionDay);
+		uint32_t actTime = TimeUtils::parseHMS(md.UpdateTime) * 1000 + md.UpdateMillisec;
+		strcpy(quote.exchg, contract->getCommInfo()->getExchg());
+		quote.action_date = actDate;
+		quote.action_time = actTime;
+		fill_tick(quote, &md);
+		if (meta._scale_turnover)
+			quote.total_turnover = md.Turnover*meta._turnover_scale;
+		else if (md.Turnover != DBL_MAX)
+			quote.total_turnover = md.Turnover;
+
+		uint32_t idx = contract->getTotalIndex();
+		if (idx >= verdicts.size())
+			verdicts.resize(idx + 1, 0);
+		if (verdicts[idx] == 0)
+			verdicts[idx] = (exchgFilter.find(contract->getExchg()) != exchgFilter.end()) ? 1 : 2;
+		if (verdicts[idx] != 1)
+			continue;
+
+		wt_strcpy(quote.code, contract->getStdCode());
+		checksum2 += quote.total_turnover + quote.action_time + strlen(quote.code);
+	}
+	uint64_t tNew = ticker.nano_seconds();
+
+	EXPECT_DOUBLE_EQ(checksum1, checksum2);
+	fmt::print("CTP tick normalization replay of {} ticks - original: {:.1f}ns/tick, cached: {:.1f}ns/tick\n",
+		times, tOld*1.0 / times, tNew*1.0 / times);
+}
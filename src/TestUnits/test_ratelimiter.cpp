@@ -0,0 +1,112 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../Share/WtRateLimiter.hpp"
+#include "../Share/TimeUtils.hpp"
+#include "../Share/fmtlib.h"
+
+#include <algorithm>
+
+USING_NS_WTP;
+
+/*
+ *	原来TraderAdapter里的流控逻辑,用来做对比
+ */
+static bool legacy_exceeded(std::vector<uint64_t>& cache, uint32_t boundary, uint64_t span)
+{
+	uint32_t cnt = (uint32_t)cache.size();
+	if (cnt < boundary || cnt == 0)
+		return false;
+
+	uint64_t eTime = cache[cnt - 1];
+	uint64_t sTime = (eTime > span) ? eTime - span : 0;
+	auto tit = std::lower_bound(cache.begin(), cache.end(), sTime);
+	auto sIdx = tit - cache.begin();
+	auto times = cnt - sIdx - 1;
+	if (times > boundary)
+		return true;
+
+	if (tit != cache.begin())
+		cache.erase(cache.begin(), tit);
+
+	return false;
+}
+
+TEST(test_ratelimiter, test_usage)
+{
+	WtRateLimiter limiter;
+	limiter.init(3, 1000);
+	EXPECT_FALSE(limiter.exceeded());
+
+	limiter.record(1000);
+	limiter.record(1100);
+	limiter.record(1200);
+	limiter.record(1300);
+	EXPECT_FALSE(limiter.exceeded());
+
+	//窗口内第5笔,除去最后一笔有4笔,超过了3笔的限制
+	limiter.record(1400);
+	EXPECT_TRUE(limiter.exceeded());
+	EXPECT_EQ(limiter.times(), 4);
+
+	//时间推移以后,最早的几笔移出了窗口
+	limiter.record(2150);
+	EXPECT_FALSE(limiter.exceeded());
+	EXPECT_EQ(limiter.last(), 2150);
+}
+
+TEST(test_ratelimiter, test_compare)
+{
+	uint32_t boundary = 5;
+	uint64_t span = 1000;
+
+	WtRateLimiter limiter;
+	limiter.init(boundary, span);
+	std::vector<uint64_t> cache;
+
+	uint64_t now = 100000;
+	uint32_t seed = 20231106;
+	for (uint32_t i = 0; i < 100000; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		now += (seed >> 16) % 400;
+
+		limiter.record(now);
+		cache.emplace_back(now);
+
+		bool bLegacy = legacy_exceeded(cache, boundary, span);
+		ASSERT_EQ(limiter.exceeded(), bLegacy) << "mismatch at " << i;
+	}
+}
+
+TEST(test_ratelimiter, test_perform)
+{
+	uint32_t times = 1000000;
+	uint32_t boundary = 500;
+	uint64_t span = 60000;
+
+	WtRateLimiter limiter;
+	limiter.init(boundary, span);
+	std::vector<uint64_t> cache;
+
+	TimeUtils::Ticker ticker;
+	uint32_t hits = 0;
+	for (uint32_t i = 0; i < times; i++)
+	{
+		limiter.record(i * 100);
+		if (limiter.exceeded())
+			hits++;
+	}
+	uint64_t t1 = ticker.nano_seconds();
+
+	ticker.reset();
+	uint32_t hits2 = 0;
+	for (uint32_t i = 0; i < times; i++)
+	{
+		cache.emplace_back(i * 100);
+		if (legacy_exceeded(cache, boundary, span))
+			hits2++;
+	}
+	uint64_t t2 = ticker.nano_seconds();
+
+	EXPECT_EQ(hits, hits2);
+	fmt::print("ringbuffer: {:.1f}ns/check - vector: {:.1f}ns/check\n", t1*1.0 / times, t2*1.0 / times);
+}
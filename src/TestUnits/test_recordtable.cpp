@@ -0,0 +1,83 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../Share/WtRecordTable.hpp"
+#include "../WtBtCore/BtOutputDefs.h"
+
+USING_NS_WTP;
+
+TEST(test_recordtable, test_append_reopen)
+{
+	const char* filename = "./rectable_trades.bin";
+	{
+		WtRecordTable table;
+		EXPECT_TRUE(table.create(filename, BT_TABLE_TRADES, BT_FLAVOR_CTA, BT_TRADE_COLUMNS, BT_COLUMN_COUNT(BT_TRADE_COLUMNS), sizeof(BtTradeRecord), 16));
+		EXPECT_EQ(table.capacity(), 16);
+
+		//写满以后要能自动扩容
+		for (uint32_t i = 0; i < 100; i++)
+		{
+			BtTradeRecord rec;
+			memset(&rec, 0, sizeof(rec));
+			strcpy(rec.code, "SHFE.rb.2401");
+			rec.time = 202311170930000ULL + i;
+			rec.price = 3500 + i;
+			rec.qty = 1;
+			rec.barno = i;
+			rec.direct = i % 2;
+			rec.action = i % 2;
+			EXPECT_TRUE(table.append(&rec));
+		}
+		EXPECT_EQ(table.size(), 100);
+		EXPECT_EQ(table.capacity(), 128);
+		table.close();
+	}
+
+	//关闭以后预分配的空间要截掉
+	EXPECT_EQ(BoostFile::get_file_size(filename), WT_RECTABLE_HEADER_SIZE + 100 * sizeof(BtTradeRecord));
+
+	WtRecordTable table;
+	EXPECT_TRUE(table.open(filename));
+	EXPECT_EQ(table.size(), 100);
+	EXPECT_EQ(table.rec_size(), sizeof(BtTradeRecord));
+
+	const WtRecTableHeader* header = table.header();
+	EXPECT_STREQ(header->_name, BT_TABLE_TRADES);
+	EXPECT_STREQ(header->_flavor, BT_FLAVOR_CTA);
+	EXPECT_EQ(header->_col_count, BT_COLUMN_COUNT(BT_TRADE_COLUMNS));
+	EXPECT_STREQ(header->_columns[2]._name, "price");
+	EXPECT_STREQ(header->_columns[2]._dtype, "<f8");
+	EXPECT_EQ(header->_columns[2]._offset, offsetof(BtTradeRecord, price));
+
+	for (uint32_t i = 0; i < 100; i++)
+	{
+		const BtTradeRecord* rec = table.at<BtTradeRecord>(i);
+		EXPECT_STREQ(rec->code, "SHFE.rb.2401");
+		EXPECT_EQ(rec->time, 202311170930000ULL + i);
+		EXPECT_DOUBLE_EQ(rec->price, 3500 + i);
+		EXPECT_EQ(rec->barno, i);
+	}
+	EXPECT_EQ(table.at(100), (const char*)NULL);
+
+	//只读打开的表不能写入
+	BtTradeRecord rec;
+	memset(&rec, 0, sizeof(rec));
+	EXPECT_FALSE(table.append(&rec));
+	table.close();
+
+	BoostFile::delete_file(filename);
+}
+
+TEST(test_recordtable, test_invalid)
+{
+	const char* filename = "./rectable_invalid.bin";
+	BoostFile f;
+	f.create_new_file(filename);
+	f.write_file(std::string(WT_RECTABLE_HEADER_SIZE, 'x'));
+	f.close_file();
+
+	WtRecordTable table;
+	EXPECT_FALSE(table.open(filename));
+	EXPECT_FALSE(table.open("./rectable_notexists.bin"));
+	EXPECT_FALSE(table.valid());
+
+	BoostFile::delete_file(filename);
+}
@@ -0,0 +1,322 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../WTSTools/WTSDataFactory.h"
+#include "../Includes/WTSDataDef.hpp"
+#include "../Includes/WTSSessionInfo.hpp"
+#include "../Share/TimeUtils.hpp"
+#include "../Share/fmtlib.h"
+
+#include <algorithm>
+
+USING_NS_WTP;
+
+/*
+ *	原来WTSDataFactory里逐根计算的分钟线重采样,作为参照
+ *	baseMins为1的时候对应extractMin1Data,为5的时候对应extractMin5Data
+ */
+static WTSKlineData* ref_extract_min(WTSKlineSlice* baseKline, uint32_t baseMins, uint32_t times, WTSSessionInfo* sInfo, bool bIncludeOpen, bool bAlignSec)
+{
+	uint32_t steplen = baseMins*times;
+	auto secMins = sInfo->getSecMinList();
+
+	WTSKlineData* ret = WTSKlineData::create(baseKline->code(), 0);
+	ret->setPeriod(baseMins == 1 ? KP_Minute1 : KP_Minute5, times);
+
+	for (auto i = 0; i < baseKline->size(); i++)
+	{
+		const WTSBarStruct& curBar = *baseKline->at(i);
+
+		uint32_t uTradingDate = curBar.date;
+		uint32_t uDate = TimeUtils::minBarToDate(curBar.time);
+		if (uDate == 19900000)
+			uDate = uTradingDate;
+		uint32_t uTime = TimeUtils::minBarToTime(curBar.time);
+		uint32_t uMinute = sInfo->timeToMinutes(uTime);
+		uint32_t uBarMin = 0;
+		if (bAlignSec)
+		{
+			auto it = std::lower_bound(secMins.begin(), secMins.end(), uMinute);
+			auto secIdx = it - secMins.begin();
+			if (secIdx == 0)
+			{
+				uMinute -= baseMins;
+				uBarMin = (uMinute / steplen)*steplen + steplen;
+				if (uBarMin > secMins[secIdx])
+					uBarMin = secMins[secIdx];
+			}
+			else
+			{
+				uMinute -= secMins[secIdx - 1];
+				uBarMin = secMins[secIdx - 1] + (uMinute / steplen)*steplen + steplen;
+				if (uBarMin > secMins[secIdx])
+					uBarMin = secMins[secIdx];
+			}
+		}
+		else
+		{
+			uMinute -= baseMins;
+			uBarMin = (uMinute / steplen)*steplen + steplen;
+		}
+
+		uint64_t uBarTime = sInfo->minuteToTime(uBarMin);
+		if (uBarTime < uTime)
+			uDate = TimeUtils::getNextDate(uDate, 1);
+		uBarTime = TimeUtils::timeToMinBar(uDate, (uint32_t)uBarTime);
+
+		WTSBarStruct* lastBar = NULL;
+		if (ret->size() > 0)
+			lastBar = ret->at(ret->size() - 1);
+
+		if (lastBar == NULL || lastBar->time != uBarTime)
+		{
+			WTSBarStruct newBar;
+			memcpy(&newBar, &curBar, sizeof(WTSBarStruct));
+			newBar.date = (baseMins == 1) ? uDate : uTradingDate;
+			newBar.time = uBarTime;
+			ret->appendBar(newBar);
+		}
+		else
+		{
+			lastBar->high = std::max(lastBar->high, curBar.high);
+			lastBar->low = std::min(lastBar->low, curBar.low);
+			lastBar->close = curBar.close;
+			lastBar->settle = curBar.settle;
+
+			lastBar->vol += curBar.vol;
+			lastBar->money += curBar.money;
+			lastBar->add += curBar.add;
+			lastBar->hold = curBar.hold;
+		}
+	}
+
+	WTSBarStruct* lastRawBar = baseKline->at(-1);
+	WTSBarStruct* lastDesBar = ret->at(-1);
+	if (lastDesBar->date > lastRawBar->date || lastDesBar->time > lastRawBar->time)
+	{
+		if (!bIncludeOpen)
+			ret->getDataRef().resize(ret->size() - 1);
+		else
+			ret->setClosed(false);
+	}
+
+	return ret;
+}
+
+static WTSKlineData* ref_extract_day(WTSKlineSlice* baseKline, uint32_t times)
+{
+	WTSKlineData* ret = WTSKlineData::create(baseKline->code(), 0);
+	ret->setPeriod(KP_DAY, times);
+
+	uint32_t count = 0;
+	for (auto i = 0; i < baseKline->size(); i++, count++)
+	{
+		const WTSBarStruct& curBar = *baseKline->at(i);
+		WTSBarStruct* lastBar = NULL;
+		if (ret->size() > 0)
+			lastBar = ret->at(ret->size() - 1);
+
+		if (lastBar == NULL || count == times)
+		{
+			WTSBarStruct newBar;
+			memcpy(&newBar, &curBar, sizeof(WTSBarStruct));
+			newBar.time = 0;
+			ret->appendBar(newBar);
+			count = 0;
+		}
+		else
+		{
+			lastBar->high = std::max(lastBar->high, curBar.high);
+			lastBar->low = std::min(lastBar->low, curBar.low);
+			lastBar->close = curBar.close;
+			lastBar->settle = curBar.settle;
+
+			lastBar->vol += curBar.vol;
+			lastBar->money += curBar.money;
+			lastBar->add = curBar.add;
+			lastBar->hold = curBar.hold;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ *	带夜盘的交易时间模板,夜盘跨零点
+ */
+static WTSSessionInfo* make_session()
+{
+	WTSSessionInfo* sInfo = WTSSessionInfo::create("FN0230", "FN0230", 300);
+	sInfo->setAuctionTime(2059, 2100);
+	sInfo->addTradingSection(2100, 230);
+	sInfo->addTradingSection(900, 1015);
+	sInfo->addTradingSection(1030, 1130);
+	sInfo->addTradingSection(1330, 1500);
+	return sInfo;
+}
+
+/*
+ *	按交易时间模板生成逐分钟或逐5分钟的K线
+ *	夜盘的日期是上一个交易日的夜里,过了零点要再加一天
+ */
+static void make_bars(WTSSessionInfo* sInfo, uint32_t baseMins, uint32_t days, std::vector<WTSBarStruct>& bars)
+{
+	uint32_t totalMins = sInfo->getTradingMins();
+	uint32_t prevDate = 20180102;
+	uint32_t curDate = TimeUtils::getNextDate(prevDate);
+	uint32_t seed = 20231114;
+	double price = 3000;
+	double hold = 100000;
+	for (uint32_t d = 0; d < days; d++)
+	{
+		for (uint32_t m = baseMins; m <= totalMins; m += baseMins)
+		{
+			uint32_t hhmm = sInfo->minuteToTime(m);
+			uint32_t actDate = curDate;
+			if (hhmm >= 2100)
+				actDate = prevDate;
+			else if (hhmm <= 230)
+				actDate = TimeUtils::getNextDate(prevDate);
+
+			seed = seed * 1103515245 + 12345;
+			WTSBarStruct bar;
+			bar.date = curDate;
+			bar.time = TimeUtils::timeToMinBar(actDate, hhmm);
+			bar.open = price;
+			price += (double)((seed >> 16) % 21) - 10;
+			bar.close = price;
+			bar.high = std::max(bar.open, bar.close) + (seed >> 8) % 5;
+			bar.low = std::min(bar.open, bar.close) - (seed >> 12) % 5;
+			bar.settle = 0;
+			bar.vol = (seed >> 4) % 1000 + 1;
+			bar.money = bar.vol * price * 10;
+			bar.add = (double)((seed >> 10) % 201) - 100;
+			hold += bar.add;
+			bar.hold = hold;
+			bars.emplace_back(bar);
+		}
+
+		prevDate = curDate;
+		curDate = TimeUtils::getNextDate(curDate, (curDate % 7 == 5) ? 3 : 1);
+	}
+}
+
+static bool same_kline(WTSKlineData* a, WTSKlineData* b)
+{
+	if (a->size() != b->size() || a->isClosed() != b->isClosed())
+		return false;
+
+	return memcmp(a->getDataRef().data(), b->getDataRef().data(), sizeof(WTSBarStruct)*a->size()) == 0;
+}
+
+TEST(test_resample, test_usage)
+{
+	WTSSessionInfo* sInfo = make_session();
+	WTSDataFactory fact;
+
+	std::vector<WTSBarStruct> m1Bars, m5Bars;
+	make_bars(sInfo, 1, 20, m1Bars);
+	make_bars(sInfo, 5, 20, m5Bars);
+
+	//分两块,有的目标K线会跨块
+	uint32_t half = (uint32_t)m1Bars.size() / 2 + 3;
+	WTSKlineSlice* m1Slice = WTSKlineSlice::create("SHFE.rb.HOT", KP_Minute1, 1, m1Bars.data(), half);
+	m1Slice->appendBlock(m1Bars.data() + half, (uint32_t)m1Bars.size() - half);
+	WTSKlineSlice* m5Slice = WTSKlineSlice::create("SHFE.rb.HOT", KP_Minute5, 1, m5Bars.data(), (int32_t)m5Bars.size());
+
+	uint32_t m1Times[] = { 2, 3, 7, 13, 15, 30, 60, 100 };
+	uint32_t m5Times[] = { 2, 3, 6, 12, 48 };
+	for (uint32_t flags = 0; flags < 4; flags++)
+	{
+		bool bIncludeOpen = (flags & 1) != 0;
+		bool bAlignSec = (flags & 2) != 0;
+		for (uint32_t times : m1Times)
+		{
+			WTSKlineData* expected = ref_extract_min(m1Slice, 1, times, sInfo, bIncludeOpen, bAlignSec);
+			WTSKlineData* actual = fact.extractKlineData(m1Slice, KP_Minute1, times, sInfo, bIncludeOpen, bAlignSec);
+			ASSERT_TRUE(actual != NULL);
+			EXPECT_TRUE(same_kline(expected, actual)) << "m" << times << " flags " << flags;
+			expected->release();
+			actual->release();
+		}
+
+		for (uint32_t times : m5Times)
+		{
+			WTSKlineData* expected = ref_extract_min(m5Slice, 5, times, sInfo, bIncludeOpen, bAlignSec);
+			WTSKlineData* actual = fact.extractKlineData(m5Slice, KP_Minute5, times, sInfo, bIncludeOpen, bAlignSec);
+			ASSERT_TRUE(actual != NULL);
+			EXPECT_TRUE(same_kline(expected, actual)) << "m5x" << times << " flags " << flags;
+			expected->release();
+			actual->release();
+		}
+	}
+
+	//最后一根没有闭合
+	WTSKlineSlice* openSlice = WTSKlineSlice::create("SHFE.rb.HOT", KP_Minute1, 1, m1Bars.data(), (int32_t)m1Bars.size() - 2);
+	for (uint32_t flags = 0; flags < 4; flags++)
+	{
+		WTSKlineData* expected = ref_extract_min(openSlice, 1, 7, sInfo, (flags & 1) != 0, (flags & 2) != 0);
+		WTSKlineData* actual = fact.extractKlineData(openSlice, KP_Minute1, 7, sInfo, (flags & 1) != 0, (flags & 2) != 0);
+		EXPECT_TRUE(same_kline(expected, actual)) << "open bar flags " << flags;
+		expected->release();
+		actual->release();
+	}
+
+	//日线,每天取一根
+	std::vector<WTSBarStruct> dayBars;
+	for (uint32_t i = 0; i < m5Bars.size(); i += sInfo->getTradingMins() / 5)
+	{
+		WTSBarStruct bar = m5Bars[i];
+		bar.time = 0;
+		dayBars.emplace_back(bar);
+	}
+	WTSKlineSlice* daySlice = WTSKlineSlice::create("SHFE.rb.HOT", KP_DAY, 1, dayBars.data(), (int32_t)dayBars.size());
+	for (uint32_t times : { 2, 3, 5 })
+	{
+		WTSKlineData* expected = ref_extract_day(daySlice, times);
+		WTSKlineData* actual = fact.extractKlineData(daySlice, KP_DAY, times, sInfo);
+		EXPECT_TRUE(same_kline(expected, actual)) << "d" << times;
+		expected->release();
+		actual->release();
+	}
+
+	m1Slice->release();
+	m5Slice->release();
+	openSlice->release();
+	daySlice->release();
+	sInfo->release();
+}
+
+TEST(test_resample, test_perform)
+{
+	//3年的分钟线重采样成7、13、60分钟
+	WTSSessionInfo* sInfo = make_session();
+	WTSDataFactory fact;
+
+	std::vector<WTSBarStruct> m1Bars;
+	make_bars(sInfo, 1, 750, m1Bars);
+	WTSKlineSlice* slice = WTSKlineSlice::create("SHFE.rb.HOT", KP_Minute1, 1, m1Bars.data(), (int32_t)m1Bars.size());
+
+	uint32_t periods[] = { 7, 13, 60 };
+	uint64_t tRef = 0;
+	uint64_t tNew = 0;
+	for (uint32_t times : periods)
+	{
+		TimeUtils::Ticker ticker;
+		WTSKlineData* expected = ref_extract_min(slice, 1, times, sInfo, true, true);
+		tRef += ticker.nano_seconds();
+
+		ticker.reset();
+		WTSKlineData* actual = fact.extractKlineData(slice, KP_Minute1, times, sInfo, true, true);
+		tNew += ticker.nano_seconds();
+
+		EXPECT_TRUE(same_kline(expected, actual)) << "m" << times;
+		expected->release();
+		actual->release();
+	}
+
+	uint64_t total = m1Bars.size() * 3;
+	fmt::print("resample {} m1 bars into m7/m13/m60 - original: {:.1f}ns/bar, bucket table: {:.1f}ns/bar\n",
+		m1Bars.size(), tRef*1.0 / total, tNew*1.0 / total);
+
+	slice->release();
+	sInfo->release();
+}
@@ -0,0 +1,92 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../Share/WtSubBitset.hpp"
+
+#include <thread>
+#include <vector>
+
+USING_NS_WTP;
+
+TEST(test_subbitset, test_set_reset)
+{
+	WtSubBitset bits;
+	EXPECT_TRUE(bits.empty());
+	EXPECT_FALSE(bits.test(0));
+	EXPECT_FALSE(bits.test(123456));
+
+	EXPECT_TRUE(bits.set(0));
+	EXPECT_TRUE(bits.set(63));
+	EXPECT_TRUE(bits.set(64));
+	EXPECT_TRUE(bits.set(WtSubBitset::PAGE_BITS + 5));
+	EXPECT_FALSE(bits.set(64));
+	EXPECT_EQ(bits.count(), 4);
+
+	EXPECT_TRUE(bits.test(0));
+	EXPECT_TRUE(bits.test(63));
+	EXPECT_TRUE(bits.test(64));
+	EXPECT_FALSE(bits.test(65));
+	EXPECT_TRUE(bits.test(WtSubBitset::PAGE_BITS + 5));
+	EXPECT_FALSE(bits.test(WtSubBitset::PAGE_BITS + 6));
+
+	EXPECT_TRUE(bits.reset(63));
+	EXPECT_FALSE(bits.reset(63));
+	EXPECT_FALSE(bits.reset(WtSubBitset::PAGE_BITS * 3));
+	EXPECT_FALSE(bits.test(63));
+	EXPECT_EQ(bits.count(), 3);
+
+	//没有分配索引的合约
+	EXPECT_FALSE(bits.set(UINT_MAX));
+	EXPECT_FALSE(bits.test(UINT_MAX));
+	EXPECT_FALSE(bits.reset(UINT_MAX));
+
+	bits.clear();
+	EXPECT_TRUE(bits.empty());
+	EXPECT_FALSE(bits.test(0));
+	EXPECT_FALSE(bits.test(WtSubBitset::PAGE_BITS + 5));
+}
+
+TEST(test_subbitset, test_numeric_index)
+{
+	EXPECT_EQ(WtSubBitset::numeric_index("600000"), 600000);
+	EXPECT_EQ(WtSubBitset::numeric_index("000001"), 1);
+	EXPECT_EQ(WtSubBitset::numeric_index("10004567"), 10004567);
+	EXPECT_EQ(WtSubBitset::numeric_index("90000123"), 90000123);
+	EXPECT_TRUE(WtSubBitset::is_valid(WtSubBitset::numeric_index("99999999")));
+
+	EXPECT_EQ(WtSubBitset::numeric_index(""), UINT_MAX);
+	EXPECT_EQ(WtSubBitset::numeric_index("rb2401"), UINT_MAX);
+	EXPECT_EQ(WtSubBitset::numeric_index("123456789"), UINT_MAX);
+}
+
+/*
+ *	一个线程不停地订阅和退订,另一个线程一直测试
+ *	常驻的订阅不能丢,计数最后要对得上
+ */
+TEST(test_subbitset, test_concurrent)
+{
+	WtSubBitset bits;
+	for (uint32_t i = 0; i < 5000; i += 100)
+		bits.set(i);
+
+	std::atomic<bool> stopped(false);
+	std::thread writer([&bits, &stopped]() {
+		for (uint32_t round = 0; round < 200; round++)
+		{
+			for (uint32_t i = 1; i < 5000; i += 100)
+				bits.set(i + round % 50);
+			for (uint32_t i = 1; i < 5000; i += 100)
+				bits.reset(i + round % 50);
+		}
+		stopped = true;
+	});
+
+	uint64_t missed = 0;
+	while (!stopped)
+	{
+		for (uint32_t i = 0; i < 5000; i += 100)
+			missed += bits.test(i) ? 0 : 1;
+	}
+	writer.join();
+
+	EXPECT_EQ(missed, 0);
+	EXPECT_EQ(bits.count(), 50);
+}
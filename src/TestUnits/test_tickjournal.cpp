@@ -0,0 +1,254 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../Share/WtTickJournal.hpp"
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+USING_NS_WTP;
+
+static void make_tick(WTSTickStruct& ts, const char* code, uint32_t tDate, uint32_t seq)
+{
+	ts = WTSTickStruct();
+	strcpy(ts.exchg, "SHFE");
+	strcpy(ts.code, code);
+	ts.trading_date = tDate;
+	ts.action_date = tDate;
+	ts.action_time = 90000000 + seq;
+	ts.price = 3800.0 + seq % 10;
+	ts.total_volume = seq;
+}
+
+static void wait_written(const WtTickJournal& jnl, uint64_t cnt)
+{
+	for (uint32_t i = 0; i < 5000 && jnl.written() < cnt; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+/*
+ *	多个线程同时写,容量很小,要翻倍扩容几次
+ *	队列也很小,写入线程要等后台线程腾出空位,一条都不能丢
+ */
+TEST(test_tickjournal, test_multi_writer)
+{
+	std::string folder = "./test_tickjournal/";
+	BoostFile::delete_file(WtTickJournal::filename(folder, 20231128).c_str());
+
+	uint64_t dropped = 0;
+	{
+		WtTickJournal jnl(folder.c_str(), 100, 10, 64);
+		jnl.start();
+
+		std::vector<std::thread> writers;
+		for (uint32_t t = 0; t < 4; t++)
+		{
+			writers.emplace_back([&jnl, t]() {
+				WTSTickStruct ts;
+				for (uint32_t i = 0; i < 2500; i++)
+				{
+					make_tick(ts, t % 2 == 0 ? "rb2401" : "hc2401", 20231128, t * 10000 + i);
+					jnl.append(ts);
+				}
+			});
+		}
+		for (auto& thrd : writers)
+			thrd.join();
+
+		jnl.stop();
+		dropped = jnl.dropped();
+		EXPECT_EQ(dropped, 0);
+		EXPECT_EQ(jnl.written(), 10000);
+	}
+
+	WtTickJournalReader reader;
+	ASSERT_TRUE(reader.open(WtTickJournal::filename(folder, 20231128).c_str()));
+	EXPECT_EQ(reader.date(), 20231128);
+	EXPECT_EQ(reader.size() + dropped, 10000);
+
+	//每个线程自己写的数据顺序不能乱
+	uint32_t last[4] = { 0 };
+	for (uint64_t i = 0; i < reader.size(); i++)
+	{
+		const WTSTickStruct& ts = reader.at(i)._tick;
+		uint32_t seq = ts.action_time - 90000000;
+		uint32_t t = seq / 10000;
+		ASSERT_LT(t, 4);
+		EXPECT_GE(seq + 1, last[t]);
+		last[t] = seq + 1;
+		EXPECT_STREQ(ts.code, t % 2 == 0 ? "rb2401" : "hc2401");
+	}
+}
+
+/*
+ *	重启以后接着往后写,换了交易日要换文件
+ */
+TEST(test_tickjournal, test_reopen)
+{
+	std::string folder = "./test_tickjournal/";
+	BoostFile::delete_file(WtTickJournal::filename(folder, 20231129).c_str());
+	BoostFile::delete_file(WtTickJournal::filename(folder, 20231130).c_str());
+
+	WTSTickStruct ts;
+	{
+		WtTickJournal jnl(folder.c_str(), 16);
+		jnl.start();
+		for (uint32_t i = 0; i < 10; i++)
+		{
+			make_tick(ts, "rb2401", 20231129, i);
+			jnl.append(ts);
+		}
+		wait_written(jnl, 10);
+	}
+
+	{
+		WtTickJournal jnl(folder.c_str(), 16);
+		jnl.start();
+		for (uint32_t i = 10; i < 30; i++)
+		{
+			make_tick(ts, "rb2401", 20231129, i);
+			jnl.append(ts);
+		}
+		make_tick(ts, "rb2401", 20231130, 0);
+		jnl.append(ts);
+		wait_written(jnl, 21);
+		jnl.stop();
+		EXPECT_EQ(jnl.dropped(), 0);
+	}
+
+	WtTickJournalReader reader;
+	ASSERT_TRUE(reader.open(WtTickJournal::filename(folder, 20231129).c_str()));
+	ASSERT_EQ(reader.size(), 30);
+	for (uint32_t i = 0; i < 30; i++)
+		EXPECT_EQ(reader.at(i)._tick.action_time, 90000000 + i);
+
+	ASSERT_TRUE(reader.open(WtTickJournal::filename(folder, 20231130).c_str()));
+	EXPECT_EQ(reader.size(), 1);
+
+	EXPECT_FALSE(reader.open("./test_tickjournal/not_exists.jnl"));
+}
+
+/*
+ *	换日前后两个交易日的数据交替到来,两个文件都开着,不能来回关闭重开
+ */
+TEST(test_tickjournal, test_date_switch)
+{
+	std::string folder = "./test_tickjournal/";
+	BoostFile::delete_file(WtTickJournal::filename(folder, 20231201).c_str());
+	BoostFile::delete_file(WtTickJournal::filename(folder, 20231204).c_str());
+
+	std::vector<std::string> logs;
+	{
+		WtTickJournal jnl(folder.c_str(), 16);
+		jnl.set_logger([&logs](WTSLogLevel ll, const std::string& msg) { logs.emplace_back(msg); });
+		jnl.start();
+
+		WTSTickStruct ts;
+		for (uint32_t i = 0; i < 100; i++)
+		{
+			make_tick(ts, "rb2401", i % 2 == 0 ? 20231201 : 20231204, i);
+			jnl.append(ts);
+		}
+		wait_written(jnl, 100);
+		jnl.stop();
+		EXPECT_EQ(jnl.dropped(), 0);
+	}
+
+	std::size_t opened = 0;
+	for (const std::string& msg : logs)
+	{
+		if (msg.find("created") != std::string::npos || msg.find("reopened") != std::string::npos)
+			opened++;
+	}
+	EXPECT_EQ(opened, 2);
+
+	WtTickJournalReader reader;
+	ASSERT_TRUE(reader.open(WtTickJournal::filename(folder, 20231201).c_str()));
+	ASSERT_EQ(reader.size(), 50);
+	for (uint32_t i = 0; i < 50; i++)
+		EXPECT_EQ(reader.at(i)._tick.action_time, 90000000 + i * 2);
+
+	ASSERT_TRUE(reader.open(WtTickJournal::filename(folder, 20231204).c_str()));
+	ASSERT_EQ(reader.size(), 50);
+	EXPECT_EQ(reader.at(0)._tick.action_time, 90000001);
+}
+
+/*
+ *	文件建不出来的时候,写不进去的记录也要算到丢弃里
+ */
+TEST(test_tickjournal, test_discard)
+{
+	//目录的位置被一个普通文件占了
+	std::string blocker = "./test_tickjournal/blocker";
+	BoostFile::create_directories("./test_tickjournal/");
+	BoostFile::write_file_contents(blocker.c_str(), "x", 1);
+
+	WtTickJournal jnl(blocker.c_str(), 16);
+	jnl.start();
+	WTSTickStruct ts;
+	for (uint32_t i = 0; i < 10; i++)
+	{
+		make_tick(ts, "rb2401", 20231205, i);
+		jnl.append(ts);
+	}
+	for (uint32_t i = 0; i < 5000 && jnl.dropped() < 10; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	jnl.stop();
+
+	EXPECT_EQ(jnl.written(), 0);
+	EXPECT_EQ(jnl.dropped(), 10);
+	BoostFile::delete_file(blocker.c_str());
+}
+
+/*
+ *	队列满了默认等待,后台线程没在运行的才丢弃,配置了dropOnFull的直接丢弃
+ */
+TEST(test_tickjournal, test_queue_full)
+{
+	std::string folder = "./test_tickjournal/";
+	WTSTickStruct ts;
+	make_tick(ts, "rb2401", 20231206, 0);
+	{
+		//没有启动,队列满了也等不到空位
+		WtTickJournal jnl(folder.c_str(), 16, 10, 4);
+		for (uint32_t i = 0; i < 10; i++)
+			jnl.append(ts);
+		EXPECT_EQ(jnl.dropped(), 6);
+		EXPECT_EQ(jnl.waited(), 6);
+	}
+
+	{
+		WtTickJournal jnl(folder.c_str(), 16, 10, 4, true);
+		uint32_t accepted = 0;
+		for (uint32_t i = 0; i < 10; i++)
+			accepted += jnl.append(ts) ? 1 : 0;
+		EXPECT_EQ(accepted, 4);
+		EXPECT_EQ(jnl.dropped(), 6);
+		EXPECT_EQ(jnl.waited(), 0);
+	}
+	BoostFile::delete_file(WtTickJournal::filename(folder, 20231206).c_str());
+}
+
+TEST(test_tickjournal, test_csv_line)
+{
+	JournalRecord rec = JournalRecord();
+	strcpy(rec._tick.code, "rb2401");
+	rec._tick.trading_date = 20231128;
+	rec._tick.action_date = 20231127;
+	rec._tick.action_time = 210000500;
+	rec._tick.price = 3801.5;
+	rec._tick.total_volume = 12345;
+	rec._tick.open_interest = 180000;
+	rec._tick.total_turnover = 469000000.6;
+	rec._tick.volume = 12;
+	rec._tick.diff_interest = -3;
+	rec._tick.turn_over = 456180.0;
+
+	time_t now = time(NULL);
+	rec._local_time = (uint64_t)now * 1000 + 123;
+	TimeUtils::Time32 tNow(now);
+	std::string localTime = fmt::format("{:02d}:{:02d}:{:02d}", tNow.time() / 10000, tNow.time() % 10000 / 100, tNow.time() % 100);
+
+	std::stringstream ss;
+	journal_to_csv(rec, ss);
+	EXPECT_EQ(ss.str(), "rb2401,20231128,20231127,210000500," + localTime + ",3801.5,12345,180000,469000000,12,-3,456180\n");
+}
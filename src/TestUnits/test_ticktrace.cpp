@@ -0,0 +1,137 @@
+﻿//跟踪默认是关闭的,这里单独打开,只测试跟踪器本身
+#define WT_TICK_TRACE
+#include "gtest/gtest/gtest.h"
+#include "../Share/WtTickTrace.hpp"
+#include "../Share/TimeUtils.hpp"
+
+USING_NS_WTP;
+
+//模拟WTSTickData上的时间戳
+class TraceTick
+{
+public:
+	TraceTick() { _trace.reset(); }
+	inline TickTrace& trace() { return _trace; }
+
+private:
+	TickTrace _trace;
+};
+
+static void send_order()
+{
+	WT_TRACE_STAMP_CUR(TTS_RISK_CHECK);
+	WT_TRACE_STAMP_CUR(TTS_API_SEND);
+	WT_TRACE_STAMP_CUR(TTS_API_RETURN);
+}
+
+TEST(test_ticktrace, test_usage)
+{
+	TickTracer::dump(true);
+
+	TraceTick tick;
+	for (uint32_t i = 0; i < 100; i++)
+	{
+		WT_TRACE_NOW(tsRecv);
+		WT_TRACE_SET(&tick, TTS_PARSER_RECV, tsRecv);
+		WT_TRACE_STAMP(&tick, TTS_PARSER_ADAPTER);
+		WT_TRACE_STAMP(&tick, TTS_ENGINE_DISPATCH);
+
+		//同一笔tick推给两个策略,只有一个下单,每个策略各一条记录
+		WT_TRACE_ENTER(&tick);
+		send_order();
+		send_order();
+		WT_TRACE_LEAVE();
+
+		WT_TRACE_ENTER(&tick);
+		WT_TRACE_LEAVE();
+	}
+
+	//不在策略回调里下单不记录
+	send_order();
+
+	//时间戳是按顺序的,策略里的时间戳不写到tick上
+	const uint64_t* stamps = tick.trace()._stamps;
+	EXPECT_LE(stamps[TTS_PARSER_RECV], stamps[TTS_PARSER_ADAPTER]);
+	EXPECT_LE(stamps[TTS_PARSER_ADAPTER], stamps[TTS_ENGINE_DISPATCH]);
+	EXPECT_EQ(stamps[TTS_STRA_ENTER], 0);
+	EXPECT_EQ(stamps[TTS_API_SEND], 0);
+
+	std::string result = TickTracer::dump(true);
+	printf("%s\n", result.c_str());
+	EXPECT_NE(result.find("strategy callback     count: 200,"), std::string::npos);
+	EXPECT_NE(result.find("tick->order           count: 100,"), std::string::npos);
+	EXPECT_NE(result.find("api orderInsert       count: 100,"), std::string::npos);
+	EXPECT_NE(result.find("0 records dropped"), std::string::npos);
+
+	//队列满了丢弃并计数
+	for (uint32_t i = 0; i < 5000; i++)
+	{
+		WT_TRACE_ENTER(&tick);
+		WT_TRACE_LEAVE();
+	}
+	result = TickTracer::dump(true);
+	EXPECT_NE(result.find("904 records dropped"), std::string::npos);
+	EXPECT_NE(result.find("strategy callback     count: 4096,"), std::string::npos);
+}
+
+/*
+ *	同一笔tick同时推给两个线程上的策略,只有一个下单
+ *	每个线程的记录不能串到另一个线程上
+ */
+TEST(test_ticktrace, test_multi_worker)
+{
+	TickTracer::dump(true);
+
+	TraceTick tick;
+	WT_TRACE_STAMP(&tick, TTS_PARSER_ADAPTER);
+	WT_TRACE_STAMP(&tick, TTS_ENGINE_DISPATCH);
+
+	const uint32_t times = 2000;
+	auto run = [&tick, times](bool bOrder) {
+		for (uint32_t i = 0; i < times; i++)
+		{
+			WT_TRACE_ENTER(&tick);
+			if (bOrder)
+				send_order();
+			WT_TRACE_LEAVE();
+		}
+	};
+	std::thread t1(run, true);
+	std::thread t2(run, false);
+	t1.join();
+	t2.join();
+
+	std::string result = TickTracer::dump(true);
+	EXPECT_NE(result.find("strategy callback     count: 4000,"), std::string::npos);
+	EXPECT_NE(result.find("api orderInsert       count: 2000,"), std::string::npos);
+	EXPECT_NE(result.find("engine->strategy      count: 4000,"), std::string::npos);
+	EXPECT_NE(result.find("0 records dropped"), std::string::npos);
+}
+
+TEST(test_ticktrace, test_perform)
+{
+	TraceTick tick;
+	const uint32_t times = 1000000;
+	TimeUtils::Ticker ticker;
+	for (uint32_t i = 0; i < times; i++)
+	{
+		WT_TRACE_STAMP(&tick, TTS_PARSER_ADAPTER);
+	}
+	uint64_t tStamp = ticker.nano_seconds();
+
+	ticker.reset();
+	for (uint32_t i = 0; i < times; i++)
+	{
+		WT_TRACE_STAMP(&tick, TTS_ENGINE_DISPATCH);
+		WT_TRACE_ENTER(&tick);
+		send_order();
+		WT_TRACE_LEAVE();
+
+		//模拟后台定期汇总
+		if (i % 4000 == 0)
+			TickTracer::dump(true);
+	}
+	uint64_t tFlow = ticker.nano_seconds();
+
+	fmt::print("tick trace cost - one stamp: {:.1f}ns, whole tick-to-order flow: {:.1f}ns\n", tStamp*1.0 / times, tFlow*1.0 / times);
+}
@@ -0,0 +1,194 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../Share/WtTimerWheel.hpp"
+#include "../Share/TimeUtils.hpp"
+#include "../Share/fmtlib.h"
+
+#include <map>
+
+USING_NS_WTP;
+
+TEST(test_timerwheel, test_usage)
+{
+	WtTimerWheel wheel;
+	wheel.init(1000000, 10);
+
+	std::vector<uint64_t> fired;
+	auto cb = [&fired](uint64_t timerid, uint64_t data) {
+		fired.emplace_back(data);
+	};
+
+	uint64_t t1 = wheel.schedule(1000105, 1);
+	uint64_t t2 = wheel.schedule(1000050, 2);
+	uint64_t t3 = wheel.schedule(1000050 + 3600 * 1000, 3);
+	EXPECT_NE(t1, 0);
+	EXPECT_EQ(wheel.size(), 3);
+
+	//没到时间的不触发,向上取整到刻度,不会早触发
+	EXPECT_EQ(wheel.advance(1000049, cb), 0);
+	EXPECT_EQ(wheel.advance(1000050, cb), 1);
+	EXPECT_EQ(wheel.advance(1000105, cb), 0);
+	EXPECT_EQ(wheel.advance(1000110, cb), 1);
+	ASSERT_EQ(fired.size(), 2);
+	EXPECT_EQ(fired[0], 2);
+	EXPECT_EQ(fired[1], 1);
+
+	//已经触发的和撤销过的都不能再撤销
+	EXPECT_FALSE(wheel.cancel(t1));
+	EXPECT_FALSE(wheel.cancel(t2));
+	EXPECT_TRUE(wheel.cancel(t3));
+	EXPECT_FALSE(wheel.cancel(t3));
+	EXPECT_EQ(wheel.size(), 0);
+
+	//节点复用以后,旧的id也不能撤销新的定时器
+	uint64_t t4 = wheel.schedule(1000200, 4);
+	EXPECT_NE(t4, t3);
+	EXPECT_FALSE(wheel.cancel(t3));
+
+	//回调里注册的定时器,下一次推进的时候触发
+	fired.clear();
+	wheel.advance(1000200, [&wheel, &fired](uint64_t timerid, uint64_t data) {
+		fired.emplace_back(data);
+		wheel.schedule(0, data + 1);
+	});
+	EXPECT_EQ(fired.size(), 1);
+	EXPECT_EQ(wheel.size(), 1);
+	wheel.advance(1000210, cb);
+	ASSERT_EQ(fired.size(), 2);
+	EXPECT_EQ(fired[1], 5);
+}
+
+TEST(test_timerwheel, test_compare)
+{
+	//和按时间排序的map对比,每一个定时器都必须在到期后的第一个刻度触发
+	uint32_t res = 10;
+	uint64_t now = 1700000000000;
+	WtTimerWheel wheel;
+	wheel.init(now, res);
+
+	std::multimap<uint64_t, uint64_t> expected;
+	std::map<uint64_t, uint64_t> ids;
+	uint32_t seed = 20231109;
+	uint64_t data = 0;
+	for (uint32_t step = 0; step < 20000; step++)
+	{
+		for (uint32_t i = 0; i < 5; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			uint32_t r = seed >> 8;
+			uint64_t delay;
+			switch (r % 4)
+			{
+			case 0: delay = r % 1000; break;
+			case 1: delay = r % 100000; break;
+			case 2: delay = r % 10000000; break;
+			default: delay = (uint64_t)r * 50; break;	//超出一圈的范围
+			}
+
+			uint64_t deadline = now + delay;
+			data++;
+			ids[data] = wheel.schedule(deadline, data);
+			expected.emplace((deadline + res - 1) / res, data);
+		}
+
+		//随机撤销一个
+		seed = seed * 1103515245 + 12345;
+		if ((seed >> 16) % 3 == 0 && !ids.empty())
+		{
+			auto it = ids.lower_bound((seed >> 8) % (data + 1));
+			if (it != ids.end())
+			{
+				EXPECT_TRUE(wheel.cancel(it->second));
+				for (auto eit = expected.begin(); eit != expected.end(); eit++)
+				{
+					if (eit->second == it->first)
+					{
+						expected.erase(eit);
+						break;
+					}
+				}
+				ids.erase(it);
+			}
+		}
+
+		seed = seed * 1103515245 + 12345;
+		now += (seed >> 16) % 5000;
+		if (step % 1000 == 999)
+			now += 24 * 3600 * 1000;
+
+		uint64_t tick = now / res;
+		wheel.advance(now, [&](uint64_t timerid, uint64_t d) {
+			auto it = expected.begin();
+			ASSERT_TRUE(it != expected.end());
+			ASSERT_LE(it->first, tick);
+			//同一刻度内的顺序不保证,在同一刻度里找
+			auto eit = it;
+			while (eit != expected.end() && eit->second != d && eit->first == it->first)
+				eit++;
+			ASSERT_TRUE(eit != expected.end() && eit->second == d) << "timer " << d << " fired out of order";
+			expected.erase(eit);
+			ids.erase(d);
+		});
+
+		if (!expected.empty())
+		{
+			ASSERT_GT(expected.begin()->first, tick);
+		}
+	}
+
+	EXPECT_EQ(wheel.size(), expected.size());
+}
+
+TEST(test_timerwheel, test_perform)
+{
+	//每个执行单元挂3笔单,每笔单一个超时,再加一个下次发单的时间
+	//轮询的做法,每笔tick都要检查全部执行单元,时间轮只处理到期的定时器
+	uint32_t basket[] = { 10, 100, 1000, 5000 };
+	for (uint32_t units : basket)
+	{
+		uint64_t now = 1700000000000;
+		uint32_t ticks = 200000;
+
+		std::vector<uint64_t> deadlines(units * 4);
+		for (uint32_t i = 0; i < deadlines.size(); i++)
+			deadlines[i] = now + 1000 + (i * 7919) % 60000;
+
+		TimeUtils::Ticker ticker;
+		uint64_t t = now;
+		uint32_t hits = 0;
+		for (uint32_t i = 0; i < ticks; i++)
+		{
+			t += 1;
+			for (uint64_t& dl : deadlines)
+			{
+				if (dl <= t)
+				{
+					hits++;
+					dl = t + 60000;
+				}
+			}
+		}
+		uint64_t t1 = ticker.nano_seconds();
+
+		WtTimerWheel wheel;
+		wheel.init(now, 10);
+		for (uint32_t i = 0; i < deadlines.size(); i++)
+			wheel.schedule(now + 1000 + (i * 7919) % 60000, i);
+
+		ticker.reset();
+		t = now;
+		uint32_t hits2 = 0;
+		for (uint32_t i = 0; i < ticks; i++)
+		{
+			t += 1;
+			wheel.advance(t, [&wheel, &hits2, t](uint64_t timerid, uint64_t data) {
+				hits2++;
+				wheel.schedule(t + 60000, data);
+			});
+		}
+		uint64_t t2 = ticker.nano_seconds();
+
+		fmt::print("{} units - polling: {:.1f}ns/tick, timerwheel: {:.1f}ns/tick, fired: {}/{}\n",
+			units, t1*1.0 / ticks, t2*1.0 / ticks, hits, hits2);
+		EXPECT_EQ(wheel.size(), units * 4);
+	}
+}
@@ -0,0 +1,197 @@
+﻿#include "gtest/gtest/gtest.h"
+#include "../Share/WtVolProfile.hpp"
+#include "../Share/TimeUtils.hpp"
+#include "../Share/fmtlib.h"
+
+#include <sstream>
+
+USING_NS_WTP;
+
+static WTSSessionInfo* make_stock_session()
+{
+	WTSSessionInfo* sInfo = WTSSessionInfo::create("SD0930", "股票白盘", 0);
+	sInfo->addTradingSection(930, 1130);
+	sInfo->addTradingSection(1300, 1500);
+	return sInfo;
+}
+
+/*
+ *	生成一个代码若干天的分钟线,成交量呈U型分布
+ */
+static void make_bars(std::vector<WTSBarStruct>& bars, WTSSessionInfo* sInfo, uint32_t days, uint32_t seed)
+{
+	uint32_t date = 20231001;
+	for (uint32_t d = 0; d < days; d++, date++)
+	{
+		for (uint32_t m = 1; m <= 240; m++)
+		{
+			seed = seed * 1103515245 + 12345;
+			WTSBarStruct bar;
+			bar.date = date;
+			bar.time = (uint64_t)(date - 19900000) * 10000 + sInfo->minuteToTime(m);
+			double dist = (m < 120) ? (120.0 - m) : (m - 120.0);
+			bar.vol = 100 + dist * dist / 10 + (seed >> 16) % 50;
+			bars.emplace_back(bar);
+		}
+	}
+}
+
+TEST(test_volprofile, test_usage)
+{
+	WTSSessionInfo* sInfo = make_stock_session();
+	std::vector<WTSBarStruct> bars;
+	make_bars(bars, sInfo, 5, 20231110);
+
+	WtVolProfileBuilder builder(sInfo->getTradingMins());
+	EXPECT_EQ(builder.add_bars("SSE.STK.600000", bars.data(), (uint32_t)bars.size(), sInfo), 5);
+
+	//用逐根调用timeToMinutes的方式算一遍做对比
+	std::vector<double> expected(241, 0.0);
+	for (uint32_t d = 0; d < 5; d++)
+	{
+		double total = 0;
+		for (uint32_t i = 0; i < 240; i++)
+			total += bars[d * 240 + i].vol;
+
+		for (uint32_t i = 0; i < 240; i++)
+		{
+			const WTSBarStruct& bar = bars[d * 240 + i];
+			uint32_t mins = sInfo->timeToMinutes(bar.time % 10000);
+			expected[mins] += bar.vol / total / 5;
+		}
+	}
+	for (uint32_t i = 1; i <= 240; i++)
+		expected[i] += expected[i - 1];
+
+	//成交量为0的天数不参与统计
+	double zeros[240] = { 0 };
+	EXPECT_FALSE(builder.add_day("SSE.STK.600000", zeros));
+
+	std::string filename = "./vol_profile_test.bin";
+	ASSERT_TRUE(builder.save(filename.c_str(), 20231005, 5));
+
+	WtVolProfileStorePtr store = WtVolProfileStore::shared(filename.c_str());
+	ASSERT_TRUE(store != NULL);
+	EXPECT_EQ(store->bins(), 240);
+	EXPECT_EQ(store->count(), 1);
+	EXPECT_EQ(store->end_date(), 20231005);
+	EXPECT_EQ(WtVolProfileStore::shared(filename.c_str()), store);
+
+	uint32_t days = 0;
+	const float* curve = store->get("SSE.STK.600000", &days);
+	ASSERT_TRUE(curve != NULL);
+	EXPECT_EQ(days, 5);
+	EXPECT_FLOAT_EQ(curve[0], 0);
+	EXPECT_FLOAT_EQ(curve[240], 1);
+	for (uint32_t i = 0; i <= 240; i++)
+		EXPECT_NEAR(curve[i], expected[i], 1e-5) << "minute " << i;
+
+	EXPECT_TRUE(store->get("SSE.STK.600001") == NULL);
+
+	store.reset();
+	BoostFile::delete_file(filename.c_str());
+	sInfo->release();
+}
+
+/*
+ *	执行时段内的完成比例,时间都是HHMM,按交易时间模板换算成开盘以后的分钟数
+ *	用均匀分布的曲线,比例就是时段内已经过去的分钟数占比
+ */
+TEST(test_volprofile, test_window_ratio)
+{
+	WTSSessionInfo* sInfo = make_stock_session();
+	std::vector<float> curve(241);
+	for (uint32_t i = 0; i <= 240; i++)
+		curve[i] = i / 240.0f;
+
+	//全天执行,上午10点过了30分钟,下午14点过了180分钟
+	double ratio = WtVolProfileStore::window_ratio(curve.data(), 240, sInfo, 930, 1500, 1000);
+	EXPECT_GT(ratio, 0.0);
+	EXPECT_LT(ratio, 1.0);
+	EXPECT_NEAR(ratio, 30.0 / 240, 1e-6);
+	EXPECT_NEAR(WtVolProfileStore::window_ratio(curve.data(), 240, sInfo, 930, 1500, 1400), 180.0 / 240, 1e-6);
+
+	//午休的时候停在上午收盘
+	EXPECT_NEAR(WtVolProfileStore::window_ratio(curve.data(), 240, sInfo, 930, 1500, 1200), 0.5, 1e-6);
+
+	//10:00到14:00执行,一共150分钟,11:00走了60分钟
+	ratio = WtVolProfileStore::window_ratio(curve.data(), 240, sInfo, 1000, 1400, 1100);
+	EXPECT_GT(ratio, 0.0);
+	EXPECT_LT(ratio, 1.0);
+	EXPECT_NEAR(ratio, 60.0 / 150, 1e-6);
+
+	//开始之前和结束以后
+	EXPECT_EQ(WtVolProfileStore::window_ratio(curve.data(), 240, sInfo, 1000, 1400, 915), 0.0);
+	EXPECT_EQ(WtVolProfileStore::window_ratio(curve.data(), 240, sInfo, 1000, 1400, 1000), 0.0);
+	EXPECT_EQ(WtVolProfileStore::window_ratio(curve.data(), 240, sInfo, 1000, 1400, 1400), 1.0);
+	EXPECT_EQ(WtVolProfileStore::window_ratio(curve.data(), 240, sInfo, 1000, 1400, 1530), 1.0);
+
+	sInfo->release();
+}
+
+TEST(test_volprofile, test_perform)
+{
+	//3000个股票20天的分钟线,生成曲线文件,再对比加载文件和逐行解析文本的耗时
+	uint32_t codes = 3000;
+	uint32_t days = 20;
+	WTSSessionInfo* sInfo = make_stock_session();
+	std::vector<WTSBarStruct> bars;
+	make_bars(bars, sInfo, days, 1);
+
+	char buffer[32] = { 0 };
+	TimeUtils::Ticker ticker;
+	WtVolProfileBuilder builder(240);
+	for (uint32_t i = 0; i < codes; i++)
+	{
+		fmtutil::format_to(buffer, "SSE.STK.{}", 600000 + i);
+		builder.add_bars(buffer, bars.data(), (uint32_t)bars.size(), sInfo);
+	}
+	std::string filename = "./vol_profile_perf.bin";
+	ASSERT_TRUE(builder.save(filename.c_str(), 20231020, days));
+	uint64_t tBuild = ticker.micro_seconds();
+
+	ticker.reset();
+	WtVolProfileStorePtr store = WtVolProfileStore::shared(filename.c_str());
+	ASSERT_TRUE(store != NULL);
+	double checksum = 0;
+	for (uint32_t i = 0; i < codes; i++)
+	{
+		fmtutil::format_to(buffer, "SSE.STK.{}", 600000 + i);
+		const float* curve = store->get(buffer);
+		checksum += curve[120];
+	}
+	uint64_t tLoad = ticker.micro_seconds();
+
+	//原来的做法,每个执行单元逐行解析一个文本文件
+	std::string text;
+	{
+		const float* curve = store->get("SSE.STK.600000");
+		for (uint32_t i = 0; i <= 240; i++)
+			text += fmt::format("{}{}", i == 0 ? "" : ",", curve[i] * 10000);
+		text += "\n";
+	}
+	ticker.reset();
+	double checksum2 = 0;
+	for (uint32_t i = 0; i < codes; i++)
+	{
+		std::vector<double> aims;
+		std::stringstream ss(text);
+		std::string line;
+		while (std::getline(ss, line))
+		{
+			std::stringstream s(line);
+			std::string prz;
+			while (std::getline(s, prz, ','))
+				aims.push_back(std::stod(prz));
+		}
+		checksum2 += aims[120] / 10000;
+	}
+	uint64_t tParse = ticker.micro_seconds();
+
+	EXPECT_NEAR(checksum, checksum2, 0.01);
+	fmt::print("{} codes x {} days - build: {}us, mmap load: {}us, text parse(in memory): {}us\n", codes, days, tBuild, tLoad, tParse);
+
+	store.reset();
+	BoostFile::delete_file(filename.c_str());
+	sInfo->release();
+}
@@ -35,20 +35,38 @@ inline void write_log(ITraderSpi* sink, WTSLogLevel ll, const char* format, cons
 	sink->handleTraderLog(ll, buffer);
 }
 
-uint32_t strToTime(const char* strTime)
+//HH:MM:SS直接转成HHMMSS,不用先拷贝一个去掉冒号的字符串
+inline uint32_t strToTime(const char* strTime)
 {
-	std::string str;
-	const char *pos = strTime;
-	while (strlen(pos) > 0)
+	uint32_t ret = 0;
+	for (const char* pos = strTime; *pos != '\0'; pos++)
 	{
-		if (pos[0] != ':')
-		{
-			str.append(pos, 1);
-		}
-		pos++;
+		if (*pos == ':')
+			continue;
+
+		if (*pos < '0' || *pos > '9')
+			break;
+
+		ret = ret * 10 + (*pos - '0');
 	}
 
-	return strtoul(str.c_str(), NULL, 10);
+	return ret;
+}
+
+//OrderSysID前面会补空格,去掉首尾空格以后拷贝到缓冲区
+inline void trimOrderID(const char* src, char* dest, std::size_t maxLen)
+{
+	while (*src == ' ')
+		src++;
+
+	std::size_t len = strlen(src);
+	while (len > 0 && src[len - 1] == ' ')
+		len--;
+
+	if (len > maxLen - 1)
+		len = maxLen - 1;
+	memcpy(dest, src, len);
+	dest[len] = '\0';
 }
 
 extern "C"
@@ -358,6 +376,17 @@ int TraderCTP::orderInsert(WTSEntrust* entrust)
 		extractEntrustID(entrust->getEntrustID(), fid, sid, orderref);
 		///报单引用
 		fmt::format_to(req.OrderRef, "{}", orderref);
+
+		//登记报单引用槽位,回报的时候直接用
+		OrderRefSlot& slot = m_ordSlots[orderref & (CTP_ORDER_SLOTS - 1)];
+		slot._order_ref.store(0, std::memory_order_release);
+		slot._front_id = fid;
+		slot._session_id = sid;
+		slot._contract = entrust->getContractInfo();
+		wt_strcpy(slot._usertag, entrust->getUserTag());
+		slot._order_id[0] = '\0';
+		slot._oid_saved = false;
+		slot._order_ref.store(orderref, std::memory_order_release);
 	}
 
 	if (strlen(entrust->getUserTag()) > 0)
@@ -1181,7 +1210,12 @@ int TraderCTP::wrapActionFlag(WTSActionFlag actionFlag)
 
 WTSOrderInfo* TraderCTP::makeOrderInfo(CThostFtdcOrderField* orderField)
 {
-	WTSContractInfo* contract = m_bdMgr->getContract(orderField->InstrumentID, orderField->ExchangeID);
+	uint32_t orderRef = strtoul(orderField->OrderRef, NULL, 10);
+	OrderRefSlot* slot = getOrderSlot(orderField->FrontID, orderField->SessionID, orderRef);
+
+	WTSContractInfo* contract = (slot != NULL) ? slot->_contract : NULL;
+	if (contract == NULL)
+		contract = m_bdMgr->getContract(orderField->InstrumentID, orderField->ExchangeID);
 	if (contract == NULL)
 		return NULL;
 
@@ -1212,9 +1246,7 @@ WTSOrderInfo* TraderCTP::makeOrderInfo(CThostFtdcOrderField* orderField)
 	pRet->setExchange(contract->getExchg());
 
 	uint32_t uDate = strtoul(orderField->InsertDate, NULL, 10);
-	std::string strTime = orderField->InsertTime;
-	StrUtil::replace(strTime, ":", "");
-	uint32_t uTime = strtoul(strTime.c_str(), NULL, 10);
+	uint32_t uTime = strToTime(orderField->InsertTime);
 	if (uTime >= 210000 && uDate == m_lDate)
 	{
 		uDate = TimeUtils::getNextDate(uDate, -1);
@@ -1227,12 +1259,30 @@ WTSOrderInfo* TraderCTP::makeOrderInfo(CThostFtdcOrderField* orderField)
 	if (orderField->OrderSubmitStatus >= THOST_FTDC_OSS_InsertRejected)
 		pRet->setError(true);		
 
-	generateEntrustID(pRet->getEntrustID(), orderField->FrontID, orderField->SessionID, atoi(orderField->OrderRef));
+	generateEntrustID(pRet->getEntrustID(), orderField->FrontID, orderField->SessionID, orderRef);
 	pRet->setOrderID(orderField->OrderSysID);
 
 	pRet->setStateMsg(orderField->StatusMsg);
 
 
+	//槽位命中的话,用户标记直接从槽位里拿,订单号也只需要写一次缓存
+	if (slot != NULL)
+	{
+		pRet->setUserTag(slot->_usertag);
+		if (!slot->_oid_saved && strlen(pRet->getOrderID()) > 0)
+		{
+			trimOrderID(pRet->getOrderID(), slot->_order_id, sizeof(slot->_order_id));
+			m_oidCache.put(slot->_order_id, slot->_usertag, 0, [this](const char* message) {
+				write_log(m_sink, LL_ERROR, message);
+			});
+			slot->_oid_saved = true;
+		}
+
+		//拷贝期间被新订单覆盖了,就退回到缓存查找
+		if (slot->_order_ref.load(std::memory_order_acquire) == orderRef)
+			return pRet;
+	}
+
 	const char* usertag = m_eidCache.get(pRet->getEntrustID());
 	if(strlen(usertag) == 0)
 	{
@@ -1315,7 +1365,17 @@ WTSError* TraderCTP::makeError(CThostFtdcRspInfoField* rspInfo, WTSErroCode ec /
 
 WTSTradeInfo* TraderCTP::makeTradeInfo(CThostFtdcTradeField *tradeField)
 {
-	WTSContractInfo* contract = m_bdMgr->getContract(tradeField->InstrumentID, tradeField->ExchangeID);
+	//成交回报里没有前置和会话编号,槽位要用报单引用加订单号一起确认
+	char orderID[24];
+	trimOrderID(tradeField->OrderSysID, orderID, sizeof(orderID));
+	uint32_t orderRef = strtoul(tradeField->OrderRef, NULL, 10);
+	OrderRefSlot* slot = (orderRef == 0) ? NULL : &m_ordSlots[orderRef & (CTP_ORDER_SLOTS - 1)];
+	if (slot != NULL && (slot->_order_ref.load(std::memory_order_acquire) != orderRef || !slot->_oid_saved || strcmp(slot->_order_id, orderID) != 0))
+		slot = NULL;
+
+	WTSContractInfo* contract = (slot != NULL) ? slot->_contract : NULL;
+	if (contract == NULL)
+		contract = m_bdMgr->getContract(tradeField->InstrumentID, tradeField->ExchangeID);
 	if (contract == NULL)
 		return NULL;
 
@@ -1325,9 +1385,7 @@ WTSTradeInfo* TraderCTP::makeTradeInfo(CThostFtdcTradeField *tradeField)
 	pRet->setTradeID(tradeField->TradeID);
 	pRet->setContractInfo(contract);
 
-	std::string strTime = tradeField->TradeTime;
-	StrUtil::replace(strTime, ":", "");
-	uint32_t uTime = strtoul(strTime.c_str(), NULL, 10);
+	uint32_t uTime = strToTime(tradeField->TradeTime);
 	uint32_t uDate = strtoul(tradeField->TradeDate, NULL, 10);
 	
 	//如果是夜盘时间，并且成交日期等于交易日，说明成交日期是需要修正
@@ -1351,7 +1409,16 @@ WTSTradeInfo* TraderCTP::makeTradeInfo(CThostFtdcTradeField *tradeField)
 	double amount = contract->getCommInfo()->getVolScale()*tradeField->Volume*pRet->getPrice();
 	pRet->setAmount(amount);
 
-	const char* usertag = m_oidCache.get(StrUtil::trim(pRet->getRefOrder()).c_str());
+	if (slot != NULL)
+	{
+		pRet->setUserTag(slot->_usertag);
+		if (slot->_order_ref.load(std::memory_order_acquire) == orderRef)
+			return pRet;
+
+		pRet->setUserTag("");
+	}
+
+	const char* usertag = m_oidCache.get(orderID);
 	if (strlen(usertag))
 		pRet->setUserTag(usertag);
 
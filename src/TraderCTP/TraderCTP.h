@@ -11,6 +11,7 @@
 
 #include <string>
 #include <queue>
+#include <atomic>
 #include <stdint.h>
 
 #include "../Includes/WTSTypes.h"
@@ -23,6 +24,9 @@
 #include "../Share/DLLHelper.hpp"
 #include "../Share/WtKVCache.hpp"
 
+//报单引用槽位的数量,必须是2的幂
+#define CTP_ORDER_SLOTS	4096
+
 USING_NS_WTP;
 
 class TraderCTP : public ITraderApi, public CThostFtdcTraderSpi
@@ -164,6 +168,37 @@ private:
 
 	uint32_t		genRequestID();
 
+	/*
+	 *	报单引用的槽位,下单的时候按报单引用取模登记合约和用户标记
+	 *	回报的时候直接定位,不用再按代码查合约、按委托编号查缓存
+	 *	槽位被后面的订单覆盖了,就退回到原来的查找方式
+	 */
+	typedef struct _OrderRefSlot
+	{
+		std::atomic<uint32_t>	_order_ref;
+		uint32_t				_front_id;
+		uint32_t				_session_id;
+		WTSContractInfo*		_contract;
+		char					_usertag[64];	//和WTSEntrust的用户标记一样长
+		char					_order_id[24];	//去掉空格以后的OrderSysID
+		bool					_oid_saved;		//订单号是否已经写入了m_oidCache
+
+		_OrderRefSlot() :_order_ref(0), _front_id(0), _session_id(0), _contract(NULL), _oid_saved(false)
+		{
+			_usertag[0] = '\0';
+			_order_id[0] = '\0';
+		}
+	} OrderRefSlot;
+
+	inline OrderRefSlot* getOrderSlot(uint32_t frontid, uint32_t sessionid, uint32_t orderRef)
+	{
+		OrderRefSlot& slot = m_ordSlots[orderRef & (CTP_ORDER_SLOTS - 1)];
+		if (orderRef == 0 || slot._order_ref.load(std::memory_order_acquire) != orderRef || slot._front_id != frontid || slot._session_id != sessionid)
+			return NULL;
+
+		return &slot;
+	}
+
 protected:
 	std::string		m_strBroker;
 	std::vector<std::string> m_strFront;
@@ -224,5 +259,7 @@ protected:
 	WtKVCache		m_eidCache;
 	//订单标记缓存器
 	WtKVCache		m_oidCache;
+
+	OrderRefSlot	m_ordSlots[CTP_ORDER_SLOTS];
 };
 
@@ -0,0 +1,647 @@
+﻿/*!
+ * \file MockExchange.cpp
+ * \project	WonderTrader
+ *
+ * \brief
+ */
+#include "MockExchange.h"
+
+#include <string.h>
+#include <thread>
+
+//////////////////////////////////////////////////////////////////////////
+//MockMatcher
+MockMatcher::~MockMatcher()
+{
+	clear();
+}
+
+void MockMatcher::clear()
+{
+	//簿里的订单都在档位里,已经撤销但还没出队的也在,统一从档位里释放
+	for (auto& v : _books)
+	{
+		OrderBook& book = *v.second;
+		for (auto& item : book._bids)
+			for (MockOrder* order : item.second._orders)
+				delete order;
+
+		for (auto& item : book._asks)
+			for (MockOrder* order : item.second._orders)
+				delete order;
+	}
+
+	_books.clear();
+	_orders.clear();
+	_trade_no = 0;
+	_trades = 0;
+	_digest = 14695981039346656037ULL;
+}
+
+MockMatcher::OrderBook& MockMatcher::get_book(const char* code)
+{
+	OrderBookPtr& book = _books[code];
+	if (!book)
+		book.reset(new OrderBook);
+
+	return *book;
+}
+
+void MockMatcher::apply(const MockEvent& evt, const SinkGetter& getSink)
+{
+	switch (evt._type)
+	{
+	case MET_Order:
+		if (evt._reject != MRT_None)
+		{
+			IMockAccountSink* sink = getSink(evt._account);
+			if (sink)
+				sink->on_mock_rejected(evt._ref, evt._reject);
+		}
+		else
+		{
+			on_order(get_book(evt._code), evt, getSink);
+		}
+		break;
+	case MET_Cancel:
+		on_cancel(evt, getSink);
+		break;
+	case MET_Quote:
+		on_quote(get_book(evt._code), evt, getSink);
+		break;
+	default:
+		break;
+	}
+}
+
+void MockMatcher::fill(MockOrder* ordA, MockOrder* ordB, int64_t level, double qty, const SinkGetter& getSink)
+{
+	uint64_t tradeNo = ++_trade_no;
+	double price = to_price(level);
+
+	ordA->_left -= qty;
+	IMockAccountSink* sink = getSink(ordA->_account);
+	if (sink)
+		sink->on_mock_traded(ordA->_ref, price, qty, tradeNo);
+
+	//外部行情作为对手盘的时候,ordB为空
+	if (ordB)
+	{
+		ordB->_left -= qty;
+		sink = getSink(ordB->_account);
+		if (sink)
+			sink->on_mock_traded(ordB->_ref, price, qty, tradeNo);
+	}
+
+	//摘要只和成交序列有关,同样的事件序列得到同样的摘要
+	uint64_t items[5] = { order_key(ordA->_account, ordA->_ref), ordB ? order_key(ordB->_account, ordB->_ref) : UINT64_MAX,
+		(uint64_t)level, (uint64_t)std::llround(qty * MOCK_PRICE_SCALE), tradeNo };
+	const unsigned char* p = (const unsigned char*)items;
+	for (std::size_t i = 0; i < sizeof(items); i++)
+	{
+		_digest ^= p[i];
+		_digest *= 1099511628211ULL;
+	}
+	_trades++;
+}
+
+template<typename Levels>
+void MockMatcher::remove_order(Levels& levels, MockOrder* order)
+{
+	auto it = levels.find(order->_price);
+	if (it == levels.end())
+		return;
+
+	PriceLevel& pLevel = it->second;
+	order->_canceled = true;
+	pLevel._live--;
+	if (pLevel._live == 0)
+	{
+		for (MockOrder* item : pLevel._orders)
+			delete item;
+		levels.erase(it);
+	}
+}
+
+void MockMatcher::on_order(OrderBook& book, const MockEvent& evt, const SinkGetter& getSink)
+{
+	IMockAccountSink* sink = getSink(evt._account);
+	if (sink)
+		sink->on_mock_accepted(evt._ref);
+
+	MockOrder* order = new MockOrder;
+	order->_account = evt._account;
+	order->_ref = evt._ref;
+	order->_is_buy = (evt._is_buy != 0);
+	order->_left = evt._qty;
+	order->_canceled = false;
+
+	//价格为0的是市价单,能成交的部分成交,剩余的撤销
+	bool isMarket = (evt._price <= 0);
+	if (isMarket)
+		order->_price = order->_is_buy ? INT64_MAX : 0;
+	else
+		order->_price = to_level(evt._price);
+
+	//先和簿里的对手盘撮合,价格优先、时间优先,成交价为被动方的价格
+	auto match_levels = [this, order, &getSink](auto& levels, auto crossed) {
+		while (order->_left > 0 && !levels.empty())
+		{
+			auto it = levels.begin();
+			if (!crossed(it->first))
+				break;
+
+			PriceLevel& pLevel = it->second;
+			while (order->_left > 0 && !pLevel._orders.empty())
+			{
+				MockOrder* passive = pLevel._orders.front();
+				if (passive->_canceled)
+				{
+					pLevel._orders.pop_front();
+					delete passive;
+					continue;
+				}
+
+				double qty = std::min(order->_left, passive->_left);
+				fill(order, passive, it->first, qty, getSink);
+				if (passive->_left <= 0)
+				{
+					pLevel._orders.pop_front();
+					pLevel._live--;
+					_orders.erase(order_key(passive->_account, passive->_ref));
+					delete passive;
+				}
+			}
+
+			if (pLevel._live == 0)
+			{
+				for (MockOrder* item : pLevel._orders)
+					delete item;
+				levels.erase(it);
+			}
+		}
+	};
+
+	if (order->_is_buy)
+		match_levels(book._asks, [order](int64_t level) { return level <= order->_price; });
+	else
+		match_levels(book._bids, [order](int64_t level) { return level >= order->_price; });
+
+	//簿里的对手盘不够,再看外部行情
+	if (order->_left > 0)
+	{
+		if (order->_is_buy && book._ext_ask > 0 && book._ext_ask <= order->_price && book._ext_ask_qty > 0)
+		{
+			double qty = std::min(order->_left, book._ext_ask_qty);
+			book._ext_ask_qty -= qty;
+			fill(order, NULL, book._ext_ask, qty, getSink);
+		}
+		else if (!order->_is_buy && book._ext_bid > 0 && book._ext_bid >= order->_price && book._ext_bid_qty > 0)
+		{
+			double qty = std::min(order->_left, book._ext_bid_qty);
+			book._ext_bid_qty -= qty;
+			fill(order, NULL, book._ext_bid, qty, getSink);
+		}
+	}
+
+	if (order->_left <= 0)
+	{
+		delete order;
+		return;
+	}
+
+	if (isMarket)
+	{
+		if (sink)
+			sink->on_mock_canceled(order->_ref, true);
+		delete order;
+		return;
+	}
+
+	//剩余的挂在簿里
+	PriceLevel* pLevel = NULL;
+	if (order->_is_buy)
+		pLevel = &book._bids[order->_price];
+	else
+		pLevel = &book._asks[order->_price];
+
+	pLevel->_orders.emplace_back(order);
+	pLevel->_live++;
+	_orders[order_key(order->_account, order->_ref)] = order;
+}
+
+void MockMatcher::on_cancel(const MockEvent& evt, const SinkGetter& getSink)
+{
+	IMockAccountSink* sink = getSink(evt._account);
+
+	auto it = _orders.find(order_key(evt._account, evt._ref));
+	if (it == _orders.end())
+	{
+		//已经成交或者撤销了,或者委托还没生效
+		if (sink)
+			sink->on_mock_canceled(evt._ref, false);
+		return;
+	}
+
+	MockOrder* order = it->second;
+	_orders.erase(it);
+
+	uint64_t ref = order->_ref;
+	OrderBook& book = get_book(evt._code);
+	if (order->_is_buy)
+		remove_order(book._bids, order);
+	else
+		remove_order(book._asks, order);
+
+	if (sink)
+		sink->on_mock_canceled(ref, true);
+}
+
+void MockMatcher::on_quote(OrderBook& book, const MockEvent& evt, const SinkGetter& getSink)
+{
+	if (evt._ref <= book._ext_time)
+		return;
+
+	book._ext_time = evt._ref;
+	book._ext_bid = to_level(evt._bid_px);
+	book._ext_bid_qty = evt._bid_qty;
+	book._ext_ask = to_level(evt._ask_px);
+	book._ext_ask_qty = evt._ask_qty;
+
+	match_external(book, getSink);
+}
+
+void MockMatcher::match_external(OrderBook& book, const SinkGetter& getSink)
+{
+	auto match_levels = [this, &getSink](auto& levels, int64_t extPx, double& extQty, auto crossed) {
+		while (extQty > 0 && !levels.empty())
+		{
+			auto it = levels.begin();
+			if (!crossed(it->first))
+				break;
+
+			PriceLevel& pLevel = it->second;
+			while (extQty > 0 && !pLevel._orders.empty())
+			{
+				MockOrder* order = pLevel._orders.front();
+				if (order->_canceled)
+				{
+					pLevel._orders.pop_front();
+					delete order;
+					continue;
+				}
+
+				//挂单被外部行情穿过,按外部行情的价格成交
+				double qty = std::min(order->_left, extQty);
+				extQty -= qty;
+				fill(order, NULL, extPx, qty, getSink);
+				if (order->_left <= 0)
+				{
+					pLevel._orders.pop_front();
+					pLevel._live--;
+					_orders.erase(order_key(order->_account, order->_ref));
+					delete order;
+				}
+			}
+
+			if (pLevel._live == 0)
+			{
+				for (MockOrder* item : pLevel._orders)
+					delete item;
+				levels.erase(it);
+			}
+		}
+	};
+
+	if (book._ext_ask > 0)
+		match_levels(book._bids, book._ext_ask, book._ext_ask_qty, [&book](int64_t level) { return level >= book._ext_ask; });
+
+	if (book._ext_bid > 0)
+		match_levels(book._asks, book._ext_bid, book._ext_bid_qty, [&book](int64_t level) { return level <= book._ext_bid; });
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//MockExchange
+MockExchange::MockExchange()
+	: _live_accts(0)
+	, _seq(0)
+	, _uniform(0.0, 1.0)
+	, _normal(0.0, 1.0)
+	, _jcount(0)
+	, _stopped(true)
+{
+}
+
+MockExchange::~MockExchange()
+{
+	stop();
+}
+
+MockExchange& MockExchange::instance()
+{
+	static MockExchange exchg;
+	return exchg;
+}
+
+uint32_t MockExchange::add_account(IMockAccountSink* sink, const MockExchgParams& params)
+{
+	StdUniqueLock lock(_mtx_accts);
+	if (_live_accts == 0)
+		start(params);
+
+	SpinLock qLock(_mtx_queue);
+	_accounts.emplace_back(sink);
+	_limiters.emplace_back(WtRateLimiter());
+	if (_params._throttle_count > 0)
+		_limiters.back().init(_params._throttle_count, (uint64_t)_params._throttle_span * 1000000);
+	_last_due.emplace_back(0);
+	_live_accts++;
+
+	return (uint32_t)_accounts.size() - 1;
+}
+
+void MockExchange::remove_account(uint32_t account)
+{
+	bool bStop = false;
+	{
+		StdUniqueLock lock(_mtx_accts);
+		if (account >= _accounts.size() || _accounts[account] == NULL)
+			return;
+
+		_accounts[account] = NULL;
+		_live_accts--;
+		bStop = (_live_accts == 0);
+	}
+
+	if (bStop)
+		stop();
+}
+
+void MockExchange::start(const MockExchgParams& params)
+{
+	_params = params;
+	_start = std::chrono::steady_clock::now();
+	_rng.seed(params._seed);
+	_seq = 0;
+	_accounts.clear();
+	_limiters.clear();
+	_last_due.clear();
+
+	if (!params._journal.empty())
+	{
+		if (_journal.create_new_file(params._journal.c_str()))
+		{
+			MockJournalHeader header;
+			memset(&header, 0, sizeof(header));
+			strcpy(header._flag, MOCK_JOURNAL_FLAG);
+			header._version = MOCK_JOURNAL_VERSION;
+			header._rec_size = sizeof(MockEvent);
+			header._seed = params._seed;
+			_journal.write_file(&header, sizeof(header));
+			_jcount = 0;
+		}
+	}
+
+	_stopped = false;
+	_thrd.reset(new StdThread([this]() {
+		run_loop();
+	}));
+}
+
+void MockExchange::stop()
+{
+	if (_stopped)
+		return;
+
+	_stopped = true;
+	if (_thrd)
+	{
+		_thrd->join();
+		_thrd.reset();
+	}
+
+	if (_journal.valid())
+	{
+		flush_journal(true);
+		_journal.close_file();
+	}
+
+	//撮合核心的状态不跨会话保留
+	_matcher.clear();
+}
+
+uint64_t MockExchange::sample_latency()
+{
+	double lat = _params._lat_mean;
+	switch (_params._lat_mode)
+	{
+	case 1:
+		lat += (_uniform(_rng) * 2 - 1) * _params._lat_jitter;
+		break;
+	case 2:
+		lat += _normal(_rng) * _params._lat_jitter;
+		break;
+	default:
+		break;
+	}
+
+	if (lat < 0)
+		lat = 0;
+
+	return (uint64_t)(lat * 1000);
+}
+
+void MockExchange::submit(MockEvent& evt, bool bThrottle)
+{
+	SpinLock lock(_mtx_queue);
+	if (_stopped)
+		return;
+
+	evt._seq = ++_seq;
+	evt._recv_ns = now_ns();
+	evt._reject = MRT_None;
+
+	if (evt._type == MET_Quote)
+	{
+		//外部行情到达即生效
+		evt._due_ns = evt._recv_ns;
+		_queue.push(evt);
+		return;
+	}
+
+	if (bThrottle && evt._account < _limiters.size())
+	{
+		WtRateLimiter& limiter = _limiters[evt._account];
+		if (limiter.is_inited() && limiter.would_exceed(evt._recv_ns))
+			evt._reject = MRT_Throttle;
+		else
+			limiter.record(evt._recv_ns);
+	}
+
+	//随机数每笔委托都取一次,不管有没有被流控,保证同样的委托序列抽到同样的随机数
+	if (bThrottle)
+	{
+		double r = _uniform(_rng);
+		if (evt._reject == MRT_None && r < _params._reject_ratio)
+			evt._reject = MRT_Random;
+	}
+
+	evt._due_ns = evt._recv_ns + sample_latency();
+	if (evt._account < _last_due.size())
+	{
+		uint64_t& lastDue = _last_due[evt._account];
+		if (evt._due_ns < lastDue)
+			evt._due_ns = lastDue;
+		lastDue = evt._due_ns;
+	}
+
+	_queue.push(evt);
+}
+
+void MockExchange::submit_order(uint32_t account, uint64_t ref, const char* code, bool isBuy, double price, double qty)
+{
+	MockEvent evt;
+	memset(&evt, 0, sizeof(evt));
+	evt._type = MET_Order;
+	evt._account = account;
+	evt._ref = ref;
+	strncpy(evt._code, code, MAX_INSTRUMENT_LENGTH - 1);
+	evt._is_buy = isBuy ? 1 : 0;
+	evt._price = price;
+	evt._qty = qty;
+	submit(evt, true);
+}
+
+void MockExchange::submit_cancel(uint32_t account, uint64_t ref, const char* code)
+{
+	MockEvent evt;
+	memset(&evt, 0, sizeof(evt));
+	evt._type = MET_Cancel;
+	evt._account = account;
+	evt._ref = ref;
+	strncpy(evt._code, code, MAX_INSTRUMENT_LENGTH - 1);
+	submit(evt, false);
+}
+
+void MockExchange::submit_quote(const char* code, uint64_t quoteTime, double bidPx, double bidQty, double askPx, double askQty)
+{
+	MockEvent evt;
+	memset(&evt, 0, sizeof(evt));
+	evt._type = MET_Quote;
+	evt._account = UINT32_MAX;
+	evt._ref = quoteTime;
+	strncpy(evt._code, code, MAX_INSTRUMENT_LENGTH - 1);
+	evt._bid_px = bidPx;
+	evt._bid_qty = bidQty;
+	evt._ask_px = askPx;
+	evt._ask_qty = askQty;
+	submit(evt, false);
+}
+
+void MockExchange::run_loop()
+{
+	MockMatcher::SinkGetter getSink = [this](uint32_t account) -> IMockAccountSink* {
+		if (account >= _accounts.size())
+			return NULL;
+		return _accounts[account];
+	};
+
+	std::vector<MockEvent> dues;
+	uint32_t idles = 0;
+	while (!_stopped)
+	{
+		//取出已经到期的事件,撮合的时候不占着队列的锁
+		{
+			uint64_t now = now_ns();
+			SpinLock lock(_mtx_queue);
+			while (!_queue.empty() && _queue.top()._due_ns <= now)
+			{
+				dues.emplace_back(_queue.top());
+				_queue.pop();
+			}
+		}
+
+		if (dues.empty())
+		{
+			if (!_jbuffer.empty())
+				flush_journal(false);
+
+			//撮合延迟一般是微秒级的,先空转一会儿,长时间没有事件再让出cpu
+			if (++idles > 1000)
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			continue;
+		}
+
+		idles = 0;
+		{
+			StdUniqueLock lock(_mtx_accts);
+			for (const MockEvent& evt : dues)
+			{
+				write_journal(evt);
+				_matcher.apply(evt, getSink);
+			}
+		}
+		dues.clear();
+	}
+}
+
+void MockExchange::write_journal(const MockEvent& evt)
+{
+	if (!_journal.valid())
+		return;
+
+	_jbuffer.append((const char*)&evt, sizeof(MockEvent));
+	_jcount++;
+	if (_jbuffer.size() >= 64 * 1024)
+		flush_journal(false);
+}
+
+void MockExchange::flush_journal(bool bHeader)
+{
+	if (!_jbuffer.empty())
+	{
+		_journal.seek_to_end();
+		_journal.write_file(_jbuffer.data(), _jbuffer.size());
+		_jbuffer.clear();
+	}
+
+	if (bHeader)
+	{
+		MockJournalHeader header;
+		_journal.seek_to_begin();
+		_journal.read_file(&header, sizeof(header));
+		header._count = _jcount;
+		header._trades = _matcher.trades();
+		header._digest = _matcher.digest();
+		_journal.seek_to_begin();
+		_journal.write_file(&header, sizeof(header));
+	}
+}
+
+bool MockExchange::replay(const char* filename, uint64_t& trades, uint64_t& digest)
+{
+	trades = 0;
+	digest = 0;
+
+	std::string content;
+	if (!BoostFile::read_file_contents(filename, content) || content.size() < sizeof(MockJournalHeader))
+		return false;
+
+	const MockJournalHeader* header = (const MockJournalHeader*)content.data();
+	if (strcmp(header->_flag, MOCK_JOURNAL_FLAG) != 0 || header->_rec_size != sizeof(MockEvent))
+		return false;
+
+	//最后没有写完整的记录忽略掉
+	std::size_t count = (content.size() - sizeof(MockJournalHeader)) / sizeof(MockEvent);
+	const MockEvent* events = (const MockEvent*)(content.data() + sizeof(MockJournalHeader));
+
+	MockMatcher matcher;
+	MockMatcher::SinkGetter getSink = [](uint32_t) -> IMockAccountSink* { return NULL; };
+	for (std::size_t i = 0; i < count; i++)
+		matcher.apply(events[i], getSink);
+
+	trades = matcher.trades();
+	digest = matcher.digest();
+	return (header->_count == count && header->_trades == trades && header->_digest == digest);
+}
@@ -0,0 +1,308 @@
+﻿/*!
+ * \file MockExchange.h
+ * \project	WonderTrader
+ *
+ * \brief 本地仿真撮合所
+ *
+ * 同一个进程里的多个TraderMocker实例(即多个账户)共享一个撮合所
+ * 每个合约一个价格优先、时间优先的订单簿,账户之间的委托直接撮合,UDP行情只作为外部对手盘
+ * 委托和撤单到达撮合所以后,按配置的延迟分布推迟生效,拒单和流控在到达时判定
+ * 所有生效的事件按顺序记录到事件日志里,用MockExchange::replay回放,撮合结果完全一致
+ */
+#pragma once
+#include <map>
+#include <cmath>
+#include <chrono>
+#include <functional>
+#include <deque>
+#include <queue>
+#include <vector>
+#include <atomic>
+#include <random>
+#include <string>
+
+#include "../Includes/FasterDefs.h"
+#include "../Share/StdUtils.hpp"
+#include "../Share/SpinMutex.hpp"
+#include "../Share/BoostFile.hpp"
+#include "../Share/WtRateLimiter.hpp"
+
+USING_NS_WTP;
+
+//价格转成定点整数作为价格档位的键,避免浮点数比较
+#define MOCK_PRICE_SCALE	1000000
+
+#define MOCK_JOURNAL_FLAG		"WTMOCKJ"
+#define MOCK_JOURNAL_VERSION	1
+
+typedef enum tagMockEvtType
+{
+	MET_Order = 0,	//委托
+	MET_Cancel,		//撤单
+	MET_Quote		//外部行情,只更新盘口
+} MockEvtType;
+
+typedef enum tagMockRejectType
+{
+	MRT_None = 0,
+	MRT_Random,		//按比例随机拒单
+	MRT_Throttle	//流控拒单
+} MockRejectType;
+
+#pragma pack(push, 8)
+/*
+ *	撮合所的入站事件,也是事件日志的记录格式
+ *	拒单在到达时就判定了,结果记录在事件里,回放的时候不需要再用随机数
+ */
+typedef struct _MockEvent
+{
+	uint64_t	_seq;		//到达撮合所的序号
+	uint64_t	_recv_ns;	//到达时间,相对撮合所启动的纳秒数
+	uint64_t	_due_ns;	//生效时间,到达时间加上撮合延迟
+	uint32_t	_type;
+	uint32_t	_account;	//账户序号
+	uint64_t	_ref;		//账户内的订单编号,外部行情为行情时间
+	char		_code[MAX_INSTRUMENT_LENGTH];	//exchg.code
+	uint8_t		_is_buy;
+	uint8_t		_reject;
+	uint8_t		_reserved[6];
+	double		_price;
+	double		_qty;
+	double		_bid_px;	//外部行情的买一卖一
+	double		_bid_qty;
+	double		_ask_px;
+	double		_ask_qty;
+} MockEvent;
+
+typedef struct _MockJournalHeader
+{
+	char		_flag[8];
+	uint32_t	_version;
+	uint32_t	_rec_size;
+	uint64_t	_seed;
+	uint64_t	_count;		//事件数
+	uint64_t	_trades;	//成交笔数
+	uint64_t	_digest;	//成交序列的摘要,回放的时候用来校验
+} MockJournalHeader;
+#pragma pack(pop)
+
+/*
+ *	撮合结果的回调,撮合线程里调用
+ */
+class IMockAccountSink
+{
+public:
+	virtual void on_mock_accepted(uint64_t ref) = 0;
+	virtual void on_mock_rejected(uint64_t ref, uint32_t rType) = 0;
+	virtual void on_mock_traded(uint64_t ref, double price, double qty, uint64_t tradeNo) = 0;
+	virtual void on_mock_canceled(uint64_t ref, bool bSuccess) = 0;
+};
+
+/*
+ *	撮合核心
+ *	只负责按顺序处理事件,不涉及线程、时钟和随机数,实盘撮合和日志回放用的是同一套逻辑
+ */
+class MockMatcher
+{
+public:
+	MockMatcher() :_trade_no(0), _trades(0), _digest(14695981039346656037ULL) {}
+	~MockMatcher();
+
+	typedef std::function<IMockAccountSink*(uint32_t)> SinkGetter;
+
+	void	apply(const MockEvent& evt, const SinkGetter& getSink);
+
+	/*
+	 *	清空订单簿和成交统计
+	 */
+	void	clear();
+
+	inline uint64_t	trades() const { return _trades; }
+	inline uint64_t	digest() const { return _digest; }
+
+private:
+	typedef struct _MockOrder
+	{
+		uint32_t	_account;
+		uint64_t	_ref;
+		bool		_is_buy;
+		int64_t		_price;
+		double		_left;
+		bool		_canceled;
+	} MockOrder;
+
+	typedef struct _PriceLevel
+	{
+		std::deque<MockOrder*>	_orders;
+		uint32_t				_live;	//未撤销的订单数,撤单只打标记,为0的时候整档删除
+
+		_PriceLevel() :_live(0) {}
+	} PriceLevel;
+
+	typedef std::map<int64_t, PriceLevel, std::greater<int64_t>>	BidLevels;
+	typedef std::map<int64_t, PriceLevel>	AskLevels;
+
+	typedef struct _OrderBook
+	{
+		BidLevels	_bids;
+		AskLevels	_asks;
+
+		//外部行情,每个新的行情到来以后重置可成交数量
+		//多个账户收到的是同一份UDP行情,时间不比上一笔新的丢掉,避免重复成交
+		uint64_t	_ext_time;
+		int64_t		_ext_bid;
+		double		_ext_bid_qty;
+		int64_t		_ext_ask;
+		double		_ext_ask_qty;
+
+		_OrderBook() :_ext_time(0), _ext_bid(0), _ext_bid_qty(0), _ext_ask(0), _ext_ask_qty(0) {}
+	} OrderBook;
+	typedef std::shared_ptr<OrderBook> OrderBookPtr;
+
+	static inline uint64_t order_key(uint32_t account, uint64_t ref)
+	{
+		return ((uint64_t)account << 40) | (ref & 0xFFFFFFFFFFULL);
+	}
+
+	static inline int64_t to_level(double price)
+	{
+		return (int64_t)std::llround(price * MOCK_PRICE_SCALE);
+	}
+
+	static inline double to_price(int64_t level)
+	{
+		return (double)level / MOCK_PRICE_SCALE;
+	}
+
+	OrderBook&	get_book(const char* code);
+
+	void	on_order(OrderBook& book, const MockEvent& evt, const SinkGetter& getSink);
+	void	on_cancel(const MockEvent& evt, const SinkGetter& getSink);
+	void	on_quote(OrderBook& book, const MockEvent& evt, const SinkGetter& getSink);
+
+	/*
+	 *	用外部行情撮合簿里的订单
+	 */
+	void	match_external(OrderBook& book, const SinkGetter& getSink);
+
+	void	fill(MockOrder* ordA, MockOrder* ordB, int64_t level, double qty, const SinkGetter& getSink);
+
+	template<typename Levels>
+	void	remove_order(Levels& levels, MockOrder* order);
+
+private:
+	wt_hashmap<std::string, OrderBookPtr>	_books;
+	wt_hashmap<uint64_t, MockOrder*>		_orders;
+
+	uint64_t	_trade_no;
+	uint64_t	_trades;
+	uint64_t	_digest;	//FNV-1a
+};
+
+/*
+ *	撮合所的行为参数
+ */
+typedef struct _MockExchgParams
+{
+	uint32_t	_lat_mode;		//延迟分布,0-固定,1-均匀,2-正态
+	uint32_t	_lat_mean;		//平均延迟,微秒
+	uint32_t	_lat_jitter;	//抖动,均匀分布为半宽,正态分布为标准差,微秒
+	double		_reject_ratio;	//随机拒单的比例
+	uint32_t	_throttle_count;//每个账户流控窗口内允许的最大委托笔数,0为不限制
+	uint32_t	_throttle_span;	//流控窗口,毫秒
+	uint64_t	_seed;			//随机数种子
+	std::string	_journal;		//事件日志文件,为空则不记录
+
+	_MockExchgParams() :_lat_mode(0), _lat_mean(0), _lat_jitter(0), _reject_ratio(0)
+		, _throttle_count(0), _throttle_span(1000), _seed(20231124) {}
+} MockExchgParams;
+
+class MockExchange
+{
+private:
+	MockExchange();
+	~MockExchange();
+
+public:
+	static MockExchange& instance();
+
+	/*
+	 *	添加账户,第一个账户用自己的参数启动撮合所,后面的账户共享
+	 *
+	 *	返回值	账户序号
+	 */
+	uint32_t	add_account(IMockAccountSink* sink, const MockExchgParams& params);
+
+	/*
+	 *	移除账户,最后一个账户移除以后撮合所停止并关闭事件日志
+	 */
+	void		remove_account(uint32_t account);
+
+	void		submit_order(uint32_t account, uint64_t ref, const char* code, bool isBuy, double price, double qty);
+	void		submit_cancel(uint32_t account, uint64_t ref, const char* code);
+	void		submit_quote(const char* code, uint64_t quoteTime, double bidPx, double bidQty, double askPx, double askQty);
+
+	/*
+	 *	回放事件日志
+	 *	trades和digest是回放得到的成交笔数和摘要
+	 *
+	 *	返回值	和日志里记录的是否一致
+	 */
+	static bool	replay(const char* filename, uint64_t& trades, uint64_t& digest);
+
+private:
+	void	start(const MockExchgParams& params);
+	void	stop();
+
+	void	submit(MockEvent& evt, bool bThrottle);
+
+	uint64_t	sample_latency();
+
+	void	run_loop();
+
+	void	write_journal(const MockEvent& evt);
+	void	flush_journal(bool bHeader);
+
+	inline uint64_t	now_ns() const
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count();
+	}
+
+private:
+	MockExchgParams	_params;
+	std::chrono::steady_clock::time_point	_start;
+
+	StdUniqueMutex	_mtx_accts;		//账户的增删和撮合线程的回调互斥
+	std::vector<IMockAccountSink*>	_accounts;
+	std::vector<WtRateLimiter>		_limiters;
+	std::vector<uint64_t>			_last_due;	//同一个账户的事件按到达顺序生效,抖动不会让后到的委托先生效
+	uint32_t		_live_accts;
+
+	typedef struct _EvtLater
+	{
+		bool operator()(const MockEvent& a, const MockEvent& b) const
+		{
+			if (a._due_ns != b._due_ns)
+				return a._due_ns > b._due_ns;
+			return a._seq > b._seq;
+		}
+	} EvtLater;
+
+	//入站事件按生效时间排序,生效时间相同的按到达顺序
+	//到达时的判定要用到账户的流控器,所以账户增删也要锁这个
+	SpinMutex		_mtx_queue;
+	std::priority_queue<MockEvent, std::vector<MockEvent>, EvtLater>	_queue;
+	uint64_t		_seq;
+	std::mt19937_64	_rng;
+	std::uniform_real_distribution<double>	_uniform;
+	std::normal_distribution<double>		_normal;
+
+	MockMatcher		_matcher;
+
+	BoostFile		_journal;
+	std::string		_jbuffer;
+	uint64_t		_jcount;
+
+	StdThreadPtr	_thrd;
+	std::atomic<bool>	_stopped;
+};
@@ -47,6 +47,18 @@ extern "C"
 			trader = NULL;
 		}
 	}
+
+	/*
+	 *	回放撮合所的事件日志,校验撮合结果是否和日志里记录的一致
+	 */
+	EXPORT_FLAG bool replayMockJournal(const char* filename, uint64_t* trades, uint64_t* digest)
+	{
+		uint64_t cnt = 0, sum = 0;
+		bool bMatched = MockExchange::replay(filename, cnt, sum);
+		if (trades) *trades = cnt;
+		if (digest) *digest = sum;
+		return bMatched;
+	}
 }
 
 std::vector<uint32_t> splitVolume(uint32_t vol, uint32_t minQty = 1, uint32_t maxQty = 100)
@@ -88,6 +100,9 @@ TraderMocker::TraderMocker()
 	, _b_socket(NULL)
 	, _max_tick_time(0)
 	, _last_match_time(0)
+	, _exchg_mode(false)
+	, _exchg_acct(0)
+	, _pos_dirty(false)
 {
 	_auto_order_id = (uint32_t)((TimeUtils::getLocalTimeNow() - TimeUtils::makeTime(20200101, 0)) / 1000 * 100);
 	_auto_trade_id = (uint32_t)((TimeUtils::getLocalTimeNow() - TimeUtils::makeTime(20200101, 0)) / 1000 * 300);
@@ -145,6 +160,10 @@ int TraderMocker::orderInsert(WTSEntrust* entrust)
 	entrust->retain();
 	_io_service.post([this, entrust](){
 		StdUniqueLock lock(_mutex_api);
+		//撮合所模式下持仓和待撮合订单会在撮合线程里更新,要一起锁住
+		StdUniqueLock lckAwaits(_mtx_awaits, std::defer_lock);
+		if (_exchg_mode)
+			lckAwaits.lock();
 
 		WTSContractInfo* ct = entrust->getContractInfo();
 		if(ct == NULL) 
@@ -275,8 +294,9 @@ int TraderMocker::orderInsert(WTSEntrust* entrust)
 			ordInfo->setOffsetType(entrust->getOffsetType());
 			ordInfo->setUserTag(entrust->getUserTag());
 			ordInfo->setPrice(entrust->getPrice());
+			uint32_t ordNo = makeOrderID();
 			thread_local static char str[64];
-			fmtutil::format_to(str, "mo.{}.{}", _mocker_id, makeOrderID());
+			fmtutil::format_to(str, "mo.{}.{}", _mocker_id, ordNo);
 			ordInfo->setOrderID(str);
 			ordInfo->setStateMsg(msg.c_str());
 			ordInfo->setOrderState(WOS_NotTraded_Queuing);
@@ -286,6 +306,29 @@ int TraderMocker::orderInsert(WTSEntrust* entrust)
 			ordInfo->setPriceType(entrust->getPriceType());
 			ordInfo->setOrderFlag(entrust->getOrderFlag());
 
+			if (_exchg_mode)
+			{
+				//下单应答和原来一样马上返回,撮合所确认以后才推送订单回报,延迟和拒单都由撮合所决定
+				ordInfo->setOrderState(WOS_Submitting);
+				if (_listener != NULL)
+					_listener->onRspEntrust(entrust, NULL);
+
+				if (_orders == NULL)
+					_orders = WTSArray::create();
+				_orders->append(ordInfo, true);
+
+				if (_awaits == NULL)
+					_awaits = OrderCache::create();
+				_awaits->add(ordInfo->getOrderID(), ordInfo, false);
+
+				bool isBuy = (ordInfo->getDirection() == WDT_LONG && ordInfo->getOffsetType() == WOT_OPEN) || (ordInfo->getDirection() != WDT_LONG && ordInfo->getOffsetType() != WOT_OPEN);
+				double price = (entrust->getPriceType() == WPT_ANYPRICE) ? 0 : entrust->getPrice();
+				MockExchange::instance().submit_order(_exchg_acct, ordNo, ct->getFullCode(), isBuy, price, entrust->getVolume());
+				_pos_dirty = true;
+				entrust->release();
+				return;
+			}
+
 			if (_listener != NULL)
 			{
 				_listener->onRspEntrust(entrust, NULL);
@@ -345,8 +388,6 @@ int32_t TraderMocker::match_once()
 		if (ct == NULL)
 			continue;
 
-		WTSCommodityInfo* commInfo = ct->getCommInfo();
-
 		WTSTickData* curTick = (WTSTickData*)_ticks->grab(fullcode);
 		if (curTick && strcmp(curTick->code(), ct->getCode())==0)
 		{
@@ -400,79 +441,9 @@ int32_t TraderMocker::match_once()
 					std::vector<uint32_t> ayVol = splitVolume((uint32_t)maxVolume, (uint32_t)_min_qty, (uint32_t)_max_qty);
 					for (uint32_t curVol : ayVol)
 					{
-
-						WTSTradeInfo* trade = WTSTradeInfo::create(curTick->code(), curTick->exchg());
-						trade->setDirection(ordInfo->getDirection());
-						trade->setOffsetType(ordInfo->getOffsetType());
-						trade->setContractInfo(ct);
-
-						trade->setPrice(uPrice);
-						trade->setVolume(curVol);
-
-						trade->setRefOrder(ordInfo->getOrderID());
-
-						char str[64];
-						fmtutil::format_to(str, "mt.{}.{}", _mocker_id, makeTradeID());
-						trade->setTradeID(str);
-
-						trade->setTradeTime(TimeUtils::getLocalTimeNow());
-						trade->setUserTag(ordInfo->getUserTag());
-
-						//更新订单数据
-						ordInfo->setVolLeft(ordInfo->getVolLeft() - curVol);
-						ordInfo->setVolTraded(ordInfo->getVolTraded() - curVol);
-						if (decimal::eq(ordInfo->getVolLeft(), 0))
-						{
-							ordInfo->setOrderState(WOS_AllTraded);
-							ordInfo->setStateMsg("AllTrd");
+						WTSTradeInfo* trade = make_trade(ct, ordInfo, uPrice, curVol);
+						if (apply_trade(ct, ordInfo, curVol))
 							to_erase.emplace_back(ordInfo->getOrderID());
-						}
-						else
-						{
-							ordInfo->setOrderState(WOS_PartTraded_Queuing);
-							ordInfo->setStateMsg("PartTrd");
-						}
-
-						PosItem& pItem = _positions[ct->getFullCode()];
-						//第一次的话要给代码和交易所赋值
-						if(strlen(pItem._code) == 0)
-						{
-							strcpy(pItem._code, ct->getCode());
-							strcpy(pItem._exchg, ct->getExchg());
-						}
-
-						if(commInfo->getCoverMode() == CM_None)
-						{
-
-						}
-						else
-						{
-							if (ordInfo->getDirection() == WDT_LONG)
-							{
-								if (ordInfo->getOffsetType() == WOT_OPEN)
-								{
-									pItem._long._volume += curVol;
-								}
-								else
-								{
-									pItem._long._volume -= curVol;
-									pItem._long._frozen -= curVol;
-								}
-							}
-							else
-							{
-								if (ordInfo->getOffsetType() == WOT_OPEN)
-								{
-									pItem._short._volume += curVol;
-								}
-								else
-								{
-									pItem._short._volume -= curVol;
-									pItem._short._frozen -= curVol;
-								}
-							}
-						}
-						
 
 						if (_listener)
 						{
@@ -513,6 +484,242 @@ int32_t TraderMocker::match_once()
 	return count;
 }
 
+WTSTradeInfo* TraderMocker::make_trade(WTSContractInfo* ct, WTSOrderInfo* ordInfo, double price, double qty)
+{
+	WTSTradeInfo* trade = WTSTradeInfo::create(ct->getCode(), ct->getExchg());
+	trade->setDirection(ordInfo->getDirection());
+	trade->setOffsetType(ordInfo->getOffsetType());
+	trade->setContractInfo(ct);
+
+	trade->setPrice(price);
+	trade->setVolume(qty);
+
+	trade->setRefOrder(ordInfo->getOrderID());
+
+	char str[64];
+	fmtutil::format_to(str, "mt.{}.{}", _mocker_id, makeTradeID());
+	trade->setTradeID(str);
+
+	trade->setTradeTime(TimeUtils::getLocalTimeNow());
+	trade->setUserTag(ordInfo->getUserTag());
+
+	return trade;
+}
+
+bool TraderMocker::apply_trade(WTSContractInfo* ct, WTSOrderInfo* ordInfo, double qty)
+{
+	//更新订单数据
+	bool bAllTraded = false;
+	ordInfo->setVolLeft(ordInfo->getVolLeft() - qty);
+	ordInfo->setVolTraded(ordInfo->getVolTraded() + qty);
+	if (decimal::eq(ordInfo->getVolLeft(), 0))
+	{
+		ordInfo->setOrderState(WOS_AllTraded);
+		ordInfo->setStateMsg("AllTrd");
+		bAllTraded = true;
+	}
+	else
+	{
+		ordInfo->setOrderState(WOS_PartTraded_Queuing);
+		ordInfo->setStateMsg("PartTrd");
+	}
+
+	PosItem& pItem = _positions[ct->getFullCode()];
+	//第一次的话要给代码和交易所赋值
+	if (strlen(pItem._code) == 0)
+	{
+		strcpy(pItem._code, ct->getCode());
+		strcpy(pItem._exchg, ct->getExchg());
+	}
+
+	if (ct->getCommInfo()->getCoverMode() == CM_None)
+		return bAllTraded;
+
+	PosUnit& pUnit = (ordInfo->getDirection() == WDT_LONG) ? pItem._long : pItem._short;
+	if (ordInfo->getOffsetType() == WOT_OPEN)
+	{
+		pUnit._volume += qty;
+	}
+	else
+	{
+		pUnit._volume -= qty;
+		pUnit._frozen -= qty;
+	}
+
+	return bAllTraded;
+}
+
+void TraderMocker::unfreeze_position(WTSOrderInfo* ordInfo)
+{
+	//开仓委托和不区分开平的,没有冻结持仓
+	if (ordInfo->getOffsetType() == WOT_OPEN)
+		return;
+
+	WTSContractInfo* ct = ordInfo->getContractInfo();
+	if (ct->getCommInfo()->getCoverMode() == CM_None)
+		return;
+
+	PosItem& pItem = _positions[ct->getFullCode()];
+	if (ordInfo->getDirection() == WDT_LONG)
+		pItem._long._frozen -= ordInfo->getVolLeft();
+	else
+		pItem._short._frozen -= ordInfo->getVolLeft();
+}
+
+//////////////////////////////////////////////////////////////////////////
+//撮合所模式
+bool TraderMocker::init_exchange(WTSVariant* cfg)
+{
+	MockExchgParams params;
+
+	WTSVariant* cfgLat = cfg->get("latency");
+	if (cfgLat)
+	{
+		std::string mode = cfgLat->getCString("mode");
+		if (mode == "uniform")
+			params._lat_mode = 1;
+		else if (mode == "normal")
+			params._lat_mode = 2;
+		else
+			params._lat_mode = 0;
+
+		params._lat_mean = cfgLat->getUInt32("mean");
+		params._lat_jitter = cfgLat->getUInt32("jitter");
+	}
+
+	params._reject_ratio = cfg->getDouble("reject_ratio");
+
+	WTSVariant* cfgThrottle = cfg->get("throttle");
+	if (cfgThrottle)
+	{
+		params._throttle_count = cfgThrottle->getUInt32("count");
+		if (cfgThrottle->has("span"))
+			params._throttle_span = cfgThrottle->getUInt32("span");
+	}
+
+	if (cfg->has("seed"))
+		params._seed = cfg->getUInt64("seed");
+
+	params._journal = cfg->getCString("journal");
+
+	_exchg_acct = MockExchange::instance().add_account(this, params);
+	_exchg_mode = true;
+	return true;
+}
+
+WTSOrderInfo* TraderMocker::grab_order(uint64_t ref)
+{
+	if (_awaits == NULL)
+		return NULL;
+
+	thread_local static char str[64];
+	fmtutil::format_to(str, "mo.{}.{}", _mocker_id, ref);
+	return (WTSOrderInfo*)_awaits->grab(str);
+}
+
+void TraderMocker::close_order(uint64_t ref, const char* msg, bool bError /* = false */)
+{
+	WTSOrderInfo* ordInfo = NULL;
+	{
+		StdUniqueLock lck(_mtx_awaits);
+		ordInfo = grab_order(ref);
+		if (ordInfo == NULL)
+			return;
+
+		unfreeze_position(ordInfo);
+		ordInfo->setStateMsg(msg);
+		ordInfo->setOrderState(WOS_Canceled);
+		ordInfo->setError(bError);
+		_awaits->remove(ordInfo->getOrderID());
+		_pos_dirty = true;
+	}
+
+	if (_listener)
+	{
+		StdUniqueLock lock(_mutex_api);
+		_listener->onPushOrder(ordInfo);
+	}
+
+	ordInfo->release();
+}
+
+void TraderMocker::on_mock_accepted(uint64_t ref)
+{
+	WTSOrderInfo* ordInfo = NULL;
+	{
+		StdUniqueLock lck(_mtx_awaits);
+		ordInfo = grab_order(ref);
+		if (ordInfo == NULL)
+			return;
+
+		ordInfo->setOrderState(WOS_NotTraded_Queuing);
+	}
+
+	if (_listener)
+	{
+		StdUniqueLock lock(_mutex_api);
+		_listener->onPushOrder(ordInfo);
+	}
+
+	ordInfo->release();
+}
+
+void TraderMocker::on_mock_rejected(uint64_t ref, uint32_t rType)
+{
+	//拒单要标记为错单,和撤单区分开
+	close_order(ref, (rType == MRT_Throttle) ? "委托过于频繁" : "撮合所拒单", true);
+}
+
+void TraderMocker::on_mock_traded(uint64_t ref, double price, double qty, uint64_t tradeNo)
+{
+	WTSOrderInfo* ordInfo = NULL;
+	WTSTradeInfo* trade = NULL;
+	{
+		StdUniqueLock lck(_mtx_awaits);
+		ordInfo = grab_order(ref);
+		if (ordInfo == NULL)
+			return;
+
+		WTSContractInfo* ct = ordInfo->getContractInfo();
+		trade = make_trade(ct, ordInfo, price, qty);
+		if (apply_trade(ct, ordInfo, qty))
+			_awaits->remove(ordInfo->getOrderID());
+		_pos_dirty = true;
+	}
+
+	if (_listener)
+	{
+		StdUniqueLock lock(_mutex_api);
+		_listener->onPushOrder(ordInfo);
+		_listener->onPushTrade(trade);
+
+		if (_trades == NULL)
+			_trades = WTSArray::create();
+		_trades->append(trade, true);
+	}
+
+	trade->release();
+	ordInfo->release();
+}
+
+void TraderMocker::on_mock_canceled(uint64_t ref, bool bSuccess)
+{
+	if (bSuccess)
+	{
+		close_order(ref, "撤单成功");
+		return;
+	}
+
+	write_log(_listener, LL_ERROR, "订单mo.{}.{}不存在或者已完成", _mocker_id, ref);
+	WTSError* err = WTSError::create(WEC_ORDERCANCEL, "订单不存在或者处于不可撤销状态");
+	if (_listener)
+	{
+		StdUniqueLock lock(_mutex_api);
+		_listener->onTraderError(err);
+	}
+	err->release();
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 bool TraderMocker::init(WTSVariant *params)
@@ -543,6 +750,11 @@ bool TraderMocker::init(WTSVariant *params)
 	_pos_file = path;
 	_pos_file += "positions.json";
 
+	//配置了撮合所,委托就送到本地撮合所里撮合
+	WTSVariant* cfgExchg = params->get("exchange");
+	if (cfgExchg)
+		init_exchange(cfgExchg);
+
 	return true;
 }
 
@@ -639,20 +851,27 @@ void TraderMocker::save_positions()
 
 void TraderMocker::release()
 {
-	if (_terminated)
-		return;
-
+	//先断开过的,撮合线程已经停了,工作线程和撮合所里的账户还要在这里清理
 	_terminated = true;
 
 	if (_thrd_match)
 	{
 		_thrd_match->join();
+		_thrd_match.reset();
 	}
 
 	if (_thrd_worker)
 	{
 		_io_service.stop();
 		_thrd_worker->join();
+		_thrd_worker.reset();
+	}
+
+	//撮合所里的账户只在这里移除,断开以后还可能重新登录,账户要一直保留
+	if (_exchg_mode)
+	{
+		MockExchange::instance().remove_account(_exchg_acct);
+		_exchg_mode = false;
 	}
 }
 
@@ -660,7 +879,9 @@ void TraderMocker::registerSpi(ITraderSpi *listener)
 {
 	_listener = listener;
 
-	_bd_mgr = listener->getBaseDataMgr();
+	//TraderAdapter释放的时候会先注销回调
+	if (_listener)
+		_bd_mgr = listener->getBaseDataMgr();
 }
 
 void TraderMocker::reconn_udp()
@@ -712,6 +933,7 @@ void TraderMocker::disconnect()
 	if (_thrd_match)
 	{
 		_thrd_match->join();
+		_thrd_match.reset();
 	}
 }
 
@@ -722,10 +944,21 @@ bool TraderMocker::isConnected()
 
 int TraderMocker::login(const char* user, const char* pass, const char* productInfo)
 {
+	//断开以后重新登录,线程要重新跑起来
+	_terminated = false;
 	_thrd_match.reset(new StdThread([this]() {
 		while (!_terminated)
 		{
-			match_once();
+			//撮合所模式下撮合在撮合所的线程里,这里只定时保存持仓
+			if (!_exchg_mode)
+			{
+				match_once();
+			}
+			else if (_pos_dirty.exchange(false))
+			{
+				StdUniqueLock lck(_mtx_awaits);
+				save_positions();
+			}
 
 			//等待5毫秒
 			std::this_thread::sleep_for(std::chrono::milliseconds(5));
@@ -771,40 +1004,18 @@ int TraderMocker::orderAction(WTSEntrustAction* action)
 			return;
 		}
 
-		WTSContractInfo* ct = ordInfo->getContractInfo();
-		WTSCommodityInfo* commInfo = ct->getCommInfo();
-
-		bool bPass = false;
-		do 
+		if (_exchg_mode)
 		{
-			//开仓委托直接撤单
-			if (ordInfo->getOffsetType() == WOT_OPEN)
-			{
-				bPass = true;
-				break;
-			}
-			
-			//不区分开平的,也直接撤销
-			if (commInfo->getCoverMode() == CM_None)
-			{
-				bPass = true;
-				break;
-			}
-
-			//释放冻结持仓
-			PosItem& pItem = _positions[ct->getFullCode()];
-			bool isLong = ordInfo->getDirection() == WDT_LONG;
-			if(isLong)
-			{
-				pItem._long._frozen -= ordInfo->getVolLeft();
-			}
-			else
-			{
-				pItem._short._frozen -= ordInfo->getVolLeft();
-			}
-			bPass = true;
+			//撤单也要送到撮合所,撤单结果在回报里处理
+			const char* oid = ordInfo->getOrderID();
+			uint64_t ref = strtoull(strrchr(oid, '.') + 1, NULL, 10);
+			MockExchange::instance().submit_cancel(_exchg_acct, ref, ordInfo->getContractInfo()->getFullCode());
+			ordInfo->release();
+			action->release();
+			return;
+		}
 
-		} while (false);
+		unfreeze_position(ordInfo);
 
 		ordInfo->setStateMsg("撤单成功");
 		ordInfo->setOrderState(WOS_Canceled);
@@ -995,6 +1206,15 @@ void TraderMocker::extract_buffer(uint32_t length, bool isBroad /* = true */)
 		if (it == _codes.end())
 			return;
 
+		if (_exchg_mode)
+		{
+			//UDP行情只作为撮合所的外部对手盘
+			const WTSTickStruct& ts = packet->_data;
+			uint64_t quoteTime = (uint64_t)ts.action_date * 1000000000 + ts.action_time;
+			MockExchange::instance().submit_quote(fullcode, quoteTime, ts.bid_prices[0], ts.bid_qty[0], ts.ask_prices[0], ts.ask_qty[0]);
+			return;
+		}
+
 		WTSTickData* curTick = WTSTickData::create(packet->_data);
 		
 		if (_ticks == NULL)
@@ -10,17 +10,24 @@
 #include "../Share/StdUtils.hpp"
 #include "../Includes/WTSCollection.hpp"
 
+#include "MockExchange.h"
+
 
 NS_WTP_BEGIN
 	class WTSTickData;
+	class WTSOrderInfo;
+	class WTSTradeInfo;
+	class WTSContractInfo;
 NS_WTP_END
 
 USING_NS_WTP;
 
 /*
  *	仿真交易器
+ *	配置了exchange以后,委托不再直接对UDP行情撮合,而是送到进程内共享的本地撮合所
+ *	每个TraderMocker实例是撮合所的一个账户
  */
-class TraderMocker : public ITraderApi
+class TraderMocker : public ITraderApi, public IMockAccountSink
 {
 public:
 	TraderMocker();
@@ -38,6 +45,36 @@ private:
 	void		load_positions();
 	void		save_positions();
 
+	/*
+	 *	生成成交回报
+	 */
+	WTSTradeInfo*	make_trade(WTSContractInfo* ct, WTSOrderInfo* ordInfo, double price, double qty);
+
+	/*
+	 *	按成交更新订单和持仓
+	 *
+	 *	返回值	订单是否全部成交
+	 */
+	bool		apply_trade(WTSContractInfo* ct, WTSOrderInfo* ordInfo, double qty);
+
+	/*
+	 *	释放平仓委托冻结的持仓
+	 */
+	void		unfreeze_position(WTSOrderInfo* ordInfo);
+
+	/*
+	 *	撮合所模式下按订单编号取出待撮合订单,引用计数加1
+	 */
+	WTSOrderInfo*	grab_order(uint64_t ref);
+
+	/*
+	 *	撮合所模式下撤销或拒绝订单
+	 *	bError	是否为拒单,拒单的订单回报会标记为错单
+	 */
+	void		close_order(uint64_t ref, const char* msg, bool bError = false);
+
+	bool		init_exchange(WTSVariant* cfg);
+
 
 private:
 	StdThreadPtr	_thrd_match;
@@ -97,6 +134,11 @@ private:
 	wt_hashmap<std::string, PosItem> _positions;
 	std::string		_pos_file;
 
+	//撮合所模式
+	bool			_exchg_mode;
+	uint32_t		_exchg_acct;
+	std::atomic<bool>	_pos_dirty;	//撮合所模式下持仓不再每笔委托都落地,由撮合线程定时保存
+
 private:
 	int			_udp_port;
 
@@ -145,4 +187,15 @@ public:
 	virtual int queryOrders() override;
 
 	virtual int queryTrades() override;
+
+//////////////////////////////////////////////////////////////////////////
+//IMockAccountSink
+public:
+	virtual void on_mock_accepted(uint64_t ref) override;
+
+	virtual void on_mock_rejected(uint64_t ref, uint32_t rType) override;
+
+	virtual void on_mock_traded(uint64_t ref, double price, double qty, uint64_t tradeNo) override;
+
+	virtual void on_mock_canceled(uint64_t ref, bool bSuccess) override;
 };
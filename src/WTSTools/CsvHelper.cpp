@@ -1,9 +1,13 @@
 #include "CsvHelper.h"
 
 #include <limits.h>
+#include <charconv>
+#include <algorithm>
 
 #include "../Share/StdUtils.hpp"
 #include "../Share/StrUtil.hpp"
+#include "../Share/BoostFile.hpp"
+#include "../Share/BoostMappingFile.hpp"
 
 CsvReader::CsvReader(const char* item_splitter /* = "," */)
 	: _item_splitter(item_splitter)
@@ -175,4 +179,271 @@ int32_t CsvReader::get_col_by_filed(const char* field)
 		return INT_MAX;
 
 	return it->second;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//CsvCursor
+static const double POW10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+	1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool is_blank(char ch)
+{
+	return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+/*
+ *	超出快速路径的交给C库,拷一份带结尾的字符串
+ */
+template<typename T, typename FuncConv>
+static inline T conv_by_crt(std::string_view sv, FuncConv conv)
+{
+	char buf[64];
+	if (sv.size() < sizeof(buf))
+	{
+		memcpy(buf, sv.data(), sv.size());
+		buf[sv.size()] = '\0';
+		return (T)conv(buf);
+	}
+
+	std::string s(sv);
+	return (T)conv(s.c_str());
+}
+
+template<typename T, typename FuncConv>
+static inline T parse_integer(std::string_view sv, FuncConv conv)
+{
+	const char* p = sv.data();
+	const char* e = p + sv.size();
+	while (p < e && is_blank(*p))
+		p++;
+
+	T val = 0;
+	auto res = std::from_chars(p, e, val);
+	if (res.ec == std::errc())
+		return val;
+
+	//前面带+号、负数转无符号、溢出和空串,都按原来的处理
+	return conv_by_crt<T>(sv, conv);
+}
+
+/*
+ *	十进制写法、有效数字不超过15位的,尾数和10的幂次都能精确表示,一次除法的结果和strtod一样
+ *	其他情况交给strtod
+ */
+static inline double parse_double(std::string_view sv)
+{
+	const char* p = sv.data();
+	const char* e = p + sv.size();
+	while (p < e && is_blank(*p))
+		p++;
+	while (e > p && is_blank(e[-1]))
+		e--;
+
+	bool bNeg = false;
+	if (p < e && (*p == '-' || *p == '+'))
+	{
+		bNeg = (*p == '-');
+		p++;
+	}
+
+	uint64_t mant = 0;
+	uint32_t digits = 0;
+	uint32_t fracs = 0;
+	for (; p < e && *p >= '0' && *p <= '9'; p++, digits++)
+		mant = mant * 10 + (*p - '0');
+
+	if (p < e && *p == '.')
+	{
+		for (p++; p < e && *p >= '0' && *p <= '9'; p++, digits++, fracs++)
+			mant = mant * 10 + (*p - '0');
+	}
+
+	if (p != e || digits == 0 || digits > 15)
+		return conv_by_crt<double>(sv, [](const char* s) { return strtod(s, NULL); });
+
+	double ret = (double)mant;
+	if (fracs > 0)
+		ret /= POW10[fracs];
+	return bNeg ? -ret : ret;
+}
+
+bool CsvCursor::next_row()
+{
+	while (_cur < _end)
+	{
+		const char* s = _cur;
+		const char* e = (const char*)memchr(s, '\n', _end - s);
+		if (e == NULL)
+			e = _end;
+		_cur = (e < _end) ? e + 1 : _end;
+
+		if (e > s && e[-1] == '\r')
+			e--;
+
+		if (e == s)
+			continue;
+
+		_cells.clear();
+		for (;;)
+		{
+			const char* p = (const char*)memchr(s, _item_splitter, e - s);
+			if (p == NULL)
+			{
+				_cells.emplace_back(s, e - s);
+				break;
+			}
+
+			_cells.emplace_back(s, p - s);
+			s = p + 1;
+		}
+		return true;
+	}
+
+	return false;
+}
+
+int32_t CsvCursor::get_int32(int32_t col) const
+{
+	return parse_integer<int32_t>(get_view(col), [](const char* s) { return strtol(s, NULL, 10); });
+}
+
+uint32_t CsvCursor::get_uint32(int32_t col) const
+{
+	return parse_integer<uint32_t>(get_view(col), [](const char* s) { return strtoul(s, NULL, 10); });
+}
+
+int64_t CsvCursor::get_int64(int32_t col) const
+{
+	return parse_integer<int64_t>(get_view(col), [](const char* s) { return strtoll(s, NULL, 10); });
+}
+
+uint64_t CsvCursor::get_uint64(int32_t col) const
+{
+	return parse_integer<uint64_t>(get_view(col), [](const char* s) { return strtoull(s, NULL, 10); });
+}
+
+double CsvCursor::get_double(int32_t col) const
+{
+	return parse_double(get_view(col));
+}
+
+const char* CsvCursor::get_string(int32_t col)
+{
+	std::string_view sv = get_view(col);
+	_buffer.assign(sv.data(), sv.size());
+	return _buffer.c_str();
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//CsvMmapReader
+CsvMmapReader::CsvMmapReader(char item_splitter /* = ',' */)
+	: _item_splitter(item_splitter)
+	, _data_start(NULL)
+	, _data_end(NULL)
+{
+
+}
+
+bool CsvMmapReader::load_from_file(const char* filename)
+{
+	if (!StdFile::exists(filename))
+		return false;
+
+	_fields_map.clear();
+	_fields.clear();
+	_data_start = _data_end = NULL;
+	_cursor = CsvCursor();
+
+	//空文件映射不了,当成没有数据
+	if (BoostFile::get_file_size(filename) == 0)
+		return true;
+
+	_file.reset(new BoostMappingFile);
+	if (!_file->map(filename, boost::interprocess::read_only, boost::interprocess::read_only))
+	{
+		_file.reset();
+		return false;
+	}
+
+	const char* start = (const char*)_file->addr();
+	const char* end = start + _file->size();
+
+	//判断是不是UTF-8BOM 编码
+	static char flag[] = { (char)0xEF, (char)0xBB, (char)0xBF };
+	if (end - start >= 3 && memcmp(start, flag, sizeof(char) * 3) == 0)
+		start += 3;
+
+	const char* lineEnd = (const char*)memchr(start, '\n', end - start);
+	if (lineEnd == NULL)
+		lineEnd = end;
+	std::string row(start, lineEnd);
+
+	//替换掉一些字段的特殊符号
+	StrUtil::replace(row, "<", "");
+	StrUtil::replace(row, ">", "");
+	StrUtil::replace(row, "\"", "");
+	StrUtil::replace(row, "'", "");
+
+	//将字段名转成小写
+	StrUtil::toLowerCase(row);
+
+	char splitter[2] = { _item_splitter, '\0' };
+	StringVector fields = StrUtil::split(row, splitter);
+	for (uint32_t i = 0; i < fields.size(); i++)
+	{
+		StrUtil::trim(fields[i], " ");
+		StrUtil::trim(fields[i], "\n");
+		StrUtil::trim(fields[i], "\t");
+		StrUtil::trim(fields[i], "\r");
+		if (fields[i].empty())
+			break;
+
+		_fields_map[fields[i]] = i;
+		if (!_fields.empty())
+			_fields += ",";
+		_fields += fields[i];
+	}
+
+	_data_start = (lineEnd < end) ? lineEnd + 1 : end;
+	_data_end = end;
+	_cursor = CsvCursor(_data_start, _data_end, _item_splitter);
+	return true;
+}
+
+int32_t CsvMmapReader::get_col(const char* field) const
+{
+	auto it = _fields_map.find(field);
+	if (it == _fields_map.end())
+		return INT_MAX;
+
+	return it->second;
+}
+
+void CsvMmapReader::split(uint32_t count, std::vector<CsvCursor>& cursors) const
+{
+	cursors.clear();
+	if (_data_start == _data_end)
+		return;
+
+	if (count == 0)
+		count = 1;
+
+	std::size_t chunk = (data_size() + count - 1) / count;
+	const char* s = _data_start;
+	while (s < _data_end)
+	{
+		const char* e = s + std::min(chunk, (std::size_t)(_data_end - s));
+		if (e < _data_end)
+		{
+			//每一块都在换行符之后结束
+			const char* p = (const char*)memchr(e, '\n', _data_end - e);
+			e = (p == NULL) ? _data_end : p + 1;
+		}
+
+		cursors.emplace_back(s, e, _item_splitter);
+		s = e;
+	}
 }
\ No newline at end of file
@@ -6,6 +6,11 @@
 #include <fstream>
 #include <vector>
 #include <sstream>
+#include <string_view>
+#include <memory>
+#include <thread>
+
+class BoostMappingFile;
 
 class CsvReader
 {
@@ -68,3 +73,148 @@ private:
 	std::unordered_map<std::string, int32_t> _fields_map;
 	std::vector<std::string> _current_cells;
 };
+
+/*
+ *	CSV数据区上的游标
+ *	单元格用string_view直接指向映射区,不拷贝也不分配内存,没有行长度限制
+ *	每个游标只遍历自己的范围,不同的游标可以在不同的线程里使用
+ */
+class CsvCursor
+{
+public:
+	CsvCursor(const char* start = NULL, const char* end = NULL, char item_splitter = ',')
+		: _cur(start), _end(end), _item_splitter(item_splitter) {}
+
+public:
+	/*
+	 *	读取下一行,空行直接跳过
+	 */
+	bool		next_row();
+
+	inline uint32_t	cell_count() const { return (uint32_t)_cells.size(); }
+
+	/*
+	 *	获取单元格的原始内容,不包含分隔符和行尾的\r
+	 */
+	inline std::string_view get_view(int32_t col) const
+	{
+		if (col < 0 || col >= (int32_t)_cells.size())
+			return std::string_view();
+
+		return _cells[col];
+	}
+
+	int32_t		get_int32(int32_t col) const;
+	uint32_t	get_uint32(int32_t col) const;
+
+	int64_t		get_int64(int32_t col) const;
+	uint64_t	get_uint64(int32_t col) const;
+
+	double		get_double(int32_t col) const;
+
+	/*
+	 *	单元格拷贝到内部缓冲区以后返回,下一次调用之前有效
+	 */
+	const char*	get_string(int32_t col);
+
+private:
+	const char*	_cur;
+	const char*	_end;
+	char		_item_splitter;
+	std::vector<std::string_view>	_cells;
+	std::string	_buffer;
+};
+
+/*
+ *	基于内存映射的CSV读取器
+ *	整个文件映射到内存里,按行原地切分,换行符和分隔符都用memchr查找,主流的CRT里memchr都是向量化实现的
+ *	整数用std::from_chars解析,浮点数先走快速路径,不是普通十进制写法的再交给strtod,结果和CsvReader一致
+ *	可以按换行符把数据区切成若干块,每块用单独的游标在不同线程里解析
+ */
+class CsvMmapReader
+{
+public:
+	CsvMmapReader(char item_splitter = ',');
+
+public:
+	bool	load_from_file(const char* filename);
+
+public:
+	inline uint32_t	col_count() const { return (uint32_t)_fields_map.size(); }
+
+	/*
+	 *	字段名对应的列号,找不到返回INT_MAX
+	 *	逐行读取的时候最好先把列号查好
+	 */
+	int32_t		get_col(const char* field) const;
+
+	inline bool	next_row() { return _cursor.next_row(); }
+
+	inline std::string_view	get_view(int32_t col) const { return _cursor.get_view(col); }
+
+	inline int32_t	get_int32(int32_t col) const { return _cursor.get_int32(col); }
+	inline uint32_t	get_uint32(int32_t col) const { return _cursor.get_uint32(col); }
+	inline int64_t	get_int64(int32_t col) const { return _cursor.get_int64(col); }
+	inline uint64_t	get_uint64(int32_t col) const { return _cursor.get_uint64(col); }
+	inline double	get_double(int32_t col) const { return _cursor.get_double(col); }
+	inline const char*	get_string(int32_t col) { return _cursor.get_string(col); }
+
+	inline int32_t	get_int32(const char* field) const { return _cursor.get_int32(get_col(field)); }
+	inline uint32_t	get_uint32(const char* field) const { return _cursor.get_uint32(get_col(field)); }
+	inline int64_t	get_int64(const char* field) const { return _cursor.get_int64(get_col(field)); }
+	inline uint64_t	get_uint64(const char* field) const { return _cursor.get_uint64(get_col(field)); }
+	inline double	get_double(const char* field) const { return _cursor.get_double(get_col(field)); }
+	inline const char*	get_string(const char* field) { return _cursor.get_string(get_col(field)); }
+
+	const char* fields() const { return _fields.c_str(); }
+
+	/*
+	 *	数据区的字节数,不包括表头
+	 */
+	inline std::size_t	data_size() const { return _data_end - _data_start; }
+
+	/*
+	 *	按换行符把数据区切成最多count块,每块一个游标
+	 */
+	void		split(uint32_t count, std::vector<CsvCursor>& cursors) const;
+
+	/*
+	 *	分块并行解析
+	 *	cb	形如void(uint32_t chunkIdx, CsvCursor& cursor),每块在单独的线程里回调
+	 *
+	 *	返回值	实际的块数
+	 */
+	template<typename FuncChunk>
+	uint32_t	parallel_for(uint32_t threads, FuncChunk cb) const
+	{
+		std::vector<CsvCursor> cursors;
+		split(threads, cursors);
+		uint32_t cnt = (uint32_t)cursors.size();
+		if (cnt <= 1)
+		{
+			if (cnt == 1)
+				cb(0, cursors[0]);
+			return cnt;
+		}
+
+		std::vector<std::thread> workers;
+		workers.reserve(cnt);
+		for (uint32_t i = 0; i < cnt; i++)
+			workers.emplace_back([&cb, &cursors, i]() { cb(i, cursors[i]); });
+
+		for (auto& t : workers)
+			t.join();
+
+		return cnt;
+	}
+
+private:
+	char		_item_splitter;
+	std::shared_ptr<BoostMappingFile>	_file;
+	const char*	_data_start;
+	const char*	_data_end;
+	CsvCursor	_cursor;
+
+	std::unordered_map<std::string, int32_t> _fields_map;
+	std::string	_fields;
+};
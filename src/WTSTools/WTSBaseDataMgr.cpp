@@ -17,6 +17,7 @@
 
 #include "../Share/StrUtil.hpp"
 #include "../Share/StdUtils.hpp"
+#include "../Share/CodeHelper.hpp"
 
 const char* DEFAULT_HOLIDAY_TPL = "CHINA";
 
@@ -25,6 +26,7 @@ WTSBaseDataMgr::WTSBaseDataMgr()
 	, m_mapSessions(NULL)
 	, m_mapCommodities(NULL)
 	, m_mapContracts(NULL)
+	, m_uContractCnt(0)
 {
 	m_mapExchgContract = WTSExchgContract::create();
 	m_mapSessions = WTSSessionMap::create();
@@ -497,6 +499,18 @@ bool WTSBaseDataMgr::loadContracts(const char* filename)
 
 			cInfo->setCommInfo(commInfo);
 
+			/*
+			 *	合约全局索引和标准代码在加载的时候就确定下来
+			 *	行情接入的时候按索引缓存过滤结果,直接使用标准代码,不用再逐笔计算
+			 */
+			cInfo->setTotalIndex(m_uContractCnt++);
+			if (commInfo->getCategoty() == CC_FutOption || commInfo->getCategoty() == CC_SpotOption)
+				cInfo->setStdCode(CodeHelper::rawFutOptCodeToStdCode(cInfo->getCode(), cInfo->getExchg()).c_str());
+			else if (CodeHelper::isMonthlyCode(cInfo->getCode()))
+				cInfo->setStdCode(CodeHelper::rawMonthCodeToStdCode(cInfo->getCode(), cInfo->getExchg()).c_str());
+			else
+				cInfo->setStdCode(CodeHelper::rawFlatCodeToStdCode(cInfo->getCode(), cInfo->getExchg(), cInfo->getProduct()).c_str());
+
 			uint32_t maxMktQty = 1000000;
 			uint32_t maxLmtQty = 1000000;
 			uint32_t minMktQty = 1;
@@ -76,5 +76,6 @@ private:
 	WTSSessionMap*		m_mapSessions;
 	WTSCommodityMap*	m_mapCommodities;
 	WTSContractMap*		m_mapContracts;
+	uint32_t			m_uContractCnt;	//已加载的合约数,用于分配合约全局索引
 };
 
@@ -12,6 +12,9 @@
 #include "../Includes/WTSContractInfo.hpp"
 #include "../Includes/WTSSessionInfo.hpp"
 #include "../Share/TimeUtils.hpp"
+#include "../Share/fmtlib.h"
+
+#include <algorithm>
 
 using namespace std;
 
@@ -633,237 +636,207 @@ WTSKlineData* WTSDataFactory::extractKlineData(WTSKlineSlice* baseKline, WTSKlin
 	return NULL;
 }
 
-WTSKlineData* WTSDataFactory::extractMin1Data(WTSKlineSlice* baseKline, uint32_t times, WTSSessionInfo* sInfo, bool bIncludeOpen /* = true */, bool bAlignSec /* = false */)
+/*
+ *	计算基础K线对应的目标K线的时间(HHMM),和原来逐根计算的逻辑一样
+ *	baseMins为基础周期的分钟数,m1为1,m5为5
+ */
+static uint32_t calc_bar_time(WTSSessionInfo* sInfo, const std::vector<uint32_t>& secMins, uint32_t uTime, uint32_t steplen, uint32_t baseMins, bool bAlignSec)
 {
-	//根据合约代码获取市场信息
-	if(sInfo == NULL)
-		return NULL;
-
-	//计算时间步长
-	uint32_t steplen = times;
+	uint32_t uMinute = sInfo->timeToMinutes(uTime);
+	uint32_t uBarMin = 0;
 
 	/*
 	 *	By Wesley @ 2023.05.31
-	 *	要增加一个按照小节对齐的重采样方式
-	 *	一般逻辑就是每个小节开始重新计算条数，然后在小节结束时，强制对齐
+	 *	这里是按小节对齐的核心逻辑
+	 *	1、先增加一个基础分钟数，如果不按小节对齐，就固定为0
+	 *	2、如果按小节对齐，则判断当前分钟处于哪个小节，然后以上个小节结束的分钟数做基础分钟数
+	 *	3、然后根据基础分钟数的差量计算新的对齐分钟数
+	 *	4、最终得到bar的时间戳
 	 */
-	auto secMins = sInfo->getSecMinList();
-
-	WTSKlineData* ret = WTSKlineData::create(baseKline->code(), 0);
-	ret->setPeriod(KP_Minute1, times);
-
-	for (auto i = 0; i < baseKline->size(); i++)
+	if (bAlignSec && !secMins.empty())
 	{
-		const WTSBarStruct& curBar = *baseKline->at(i);
-
-		uint32_t uTradingDate = curBar.date;
-		uint32_t uDate = TimeUtils::minBarToDate(curBar.time);
-		if(uDate == 19900000)
-			uDate = uTradingDate;
-		uint32_t uTime = TimeUtils::minBarToTime(curBar.time);
-		uint32_t uMinute = sInfo->timeToMinutes(uTime);
-		uint32_t uBarMin = 0;
-
-		/*
-		 *	By Wesley @ 2023.05.31
-		 *	这里是按小节对齐的核心逻辑
-		 *	1、先增加一个基础分钟数，如果不按小节对齐，就固定为0
-		 *	2、如果按小节对齐，则判断当前分钟处于哪个小节，然后以上个小节结束的分钟数做基础分钟数
-		 *	3、然后根据基础分钟数的差量计算新的对齐分钟数
-		 *	4、最终得到bar的时间戳
-		 */
-		if(bAlignSec)
-		{
-			auto it = std::lower_bound(secMins.begin(), secMins.end(), uMinute);
-			auto secIdx = it - secMins.begin();
-			if(secIdx == 0)
-			{
-				uMinute -= 1;
-				uBarMin = (uMinute / steplen)*steplen + steplen;
-				if (uBarMin > secMins[secIdx])
-					uBarMin = secMins[secIdx];
-			}
-			else
-			{
-				uMinute -= secMins[secIdx - 1];
-				uBarMin = secMins[secIdx - 1] + (uMinute / steplen)*steplen + steplen;
-				if (uBarMin > secMins[secIdx])
-					uBarMin = secMins[secIdx];
-			}
-		}
-		else
+		auto it = std::lower_bound(secMins.begin(), secMins.end(), uMinute);
+		auto secIdx = it - secMins.begin();
+		if (secIdx == 0)
 		{
-			uMinute -= 1;
+			uMinute -= baseMins;
 			uBarMin = (uMinute / steplen)*steplen + steplen;
+			if (uBarMin > secMins[secIdx])
+				uBarMin = secMins[secIdx];
 		}
-
-		uint64_t uBarTime = sInfo->minuteToTime(uBarMin);
-		if (uBarTime < uTime)
-			uDate = TimeUtils::getNextDate(uDate, 1);
-		uBarTime = TimeUtils::timeToMinBar(uDate, (uint32_t)uBarTime);
-
-		WTSBarStruct* lastBar = NULL;
-		if(ret->size() > 0)
+		else
 		{
-			lastBar = ret->at(ret->size()-1);
+			uMinute -= secMins[secIdx - 1];
+			uBarMin = secMins[secIdx - 1] + (uMinute / steplen)*steplen + steplen;
+			if (secIdx < (int64_t)secMins.size() && uBarMin > secMins[secIdx])
+				uBarMin = secMins[secIdx];
 		}
+	}
+	else
+	{
+		uMinute -= baseMins;
+		uBarMin = (uMinute / steplen)*steplen + steplen;
+	}
 
-		bool bNewBar = false;
-		if(lastBar == NULL || lastBar->time != uBarTime)
-		{
-			//只要日期和时间都不符,则认为已经是一条新的bar了
-			lastBar = new WTSBarStruct();
-			bNewBar = true;
+	return sInfo->minuteToTime(uBarMin);
+}
 
-			memcpy(lastBar, &curBar, sizeof(WTSBarStruct));
-			lastBar->date = uDate;
-			lastBar->time = uBarTime;
-		}
-		else
+/*
+ *	按目标K线的时间把基础K线分段合并
+ *	keys为每根基础K线对应的目标K线标识,连续相同的为一段
+ *	先数出目标K线的条数一次分配好,再逐段合并,段内的高低价和成交量是对连续内存的简单循环
+ *	init用于设置新K线的日期和时间,形如void(WTSBarStruct& newBar, uint32_t idx)
+ */
+template<typename FuncInit>
+static void merge_bars(WTSKlineSlice* baseKline, const uint64_t* keys, WTSKlineData::WTSBarList& desBars, bool bSumAdd, FuncInit init)
+{
+	uint32_t total = (uint32_t)baseKline->size();
+	uint32_t cnt = 1;
+	for (uint32_t i = 1; i < total; i++)
+		cnt += (keys[i] != keys[i - 1]) ? 1 : 0;
+
+	desBars.resize(cnt);
+	WTSBarStruct* des = NULL;
+	uint32_t idx = 0;
+	for (std::size_t blkIdx = 0; blkIdx < baseKline->get_block_counts(); blkIdx++)
+	{
+		const WTSBarStruct* bars = baseKline->get_block_addr(blkIdx);
+		uint32_t count = baseKline->get_block_size(blkIdx);
+		const uint64_t* blkKeys = keys + idx;
+		uint32_t i = 0;
+		while (i < count)
 		{
-			bNewBar = false;
+			uint32_t s = i;
+			uint32_t e = i + 1;
+			while (e < count && blkKeys[e] == blkKeys[s])
+				e++;
 
-			lastBar->high = max(lastBar->high, curBar.high);
-			lastBar->low = min(lastBar->low, curBar.low);
-			lastBar->close = curBar.close;
-			lastBar->settle = curBar.settle;
+			//段的开头和上一根目标K线不是同一个标识,就是一条新K线
+			if (des == NULL || blkKeys[s] != keys[idx + s - 1])
+			{
+				des = (des == NULL) ? desBars.data() : des + 1;
+				memcpy(des, &bars[s], sizeof(WTSBarStruct));
+				init(*des, idx + s);
+				s++;
+			}
 
-			lastBar->vol += curBar.vol;
-			lastBar->money += curBar.money;
-			lastBar->add += curBar.add;
-			lastBar->hold = curBar.hold;
-		}
+			if (s < e)
+			{
+				double high = des->high;
+				double low = des->low;
+				double vol = des->vol;
+				double money = des->money;
+				double add = des->add;
+				for (uint32_t k = s; k < e; k++)
+				{
+					const WTSBarStruct& curBar = bars[k];
+					high = max(high, curBar.high);
+					low = min(low, curBar.low);
+					vol += curBar.vol;
+					money += curBar.money;
+					add += curBar.add;
+				}
+
+				const WTSBarStruct& lastBar = bars[e - 1];
+				des->high = high;
+				des->low = low;
+				des->close = lastBar.close;
+				des->settle = lastBar.settle;
+				des->vol = vol;
+				des->money = money;
+				des->add = bSumAdd ? add : lastBar.add;
+				des->hold = lastBar.hold;
+			}
 
-		if(bNewBar)
-		{
-			ret->appendBar(*lastBar);
-			delete lastBar;
+			i = e;
 		}
+		idx += count;
 	}
+}
 
-	//检查最后一条数据
-	{
-		WTSBarStruct* lastRawBar = baseKline->at(-1);
-		WTSBarStruct* lastDesBar = ret->at(-1);
-		//如果目标K线的最后一条数据的日期或者时间大于原始K线最后一条的日期或时间
-		if ( lastDesBar->date > lastRawBar->date || lastDesBar->time > lastRawBar->time)
-		{
-			if (!bIncludeOpen)
-				ret->getDataRef().resize(ret->size() - 1);
-			else
-				ret->setClosed(false);
-		}
-	}
-	
+const uint32_t* WTSDataFactory::getBarTimeTable(WTSSessionInfo* sInfo, uint32_t steplen, uint32_t baseMins, bool bAlignSec)
+{
+	static thread_local char key[128] = { 0 };
+	fmtutil::format_to(key, "{}.{}.{}.{}", sInfo->id(), steplen, baseMins, bAlignSec ? 1 : 0);
 
-	return ret;
+	StdUniqueLock lock(m_mtxTables);
+	//vector移动的时候内存不变,返回的指针在工厂的生命周期内一直有效
+	std::vector<uint32_t>& table = m_mapTimeTables[key];
+	if (!table.empty())
+		return table.data();
+
+	const std::vector<uint32_t>& secMins = sInfo->getSecMinList();
+	table.resize(2400);
+	for (uint32_t uTime = 0; uTime < 2400; uTime++)
+		table[uTime] = calc_bar_time(sInfo, secMins, uTime, steplen, baseMins, bAlignSec);
+
+	return table.data();
 }
 
-WTSKlineData* WTSDataFactory::extractMin5Data(WTSKlineSlice* baseKline, uint32_t times, WTSSessionInfo* sInfo, bool bIncludeOpen /* = true */, bool bAlignSec /* = false */)
+/*
+ *	分钟线重采样
+ *	目标K线的时间只取决于基础K线的HHMM,所以按(交易时间模板,步长,基础周期,是否按小节对齐)预先算好0000~2359的映射表
+ *	逐根K线只需要查表,再按段合并
+ */
+WTSKlineData* WTSDataFactory::extractMinData(WTSKlineSlice* baseKline, WTSKlinePeriod period, uint32_t times, WTSSessionInfo* sInfo, bool bIncludeOpen, bool bAlignSec)
 {
 	if(sInfo == NULL)
 		return NULL;
 
+	uint32_t baseMins = (period == KP_Minute5) ? 5 : 1;
 	//计算时间步长
-	uint32_t steplen = 5*times;
-	/*
-	 *	By Wesley @ 2023.05.31
-	 *	要增加一个按照小节对齐的重采样方式
-	 *	一般逻辑就是每个小节开始重新计算条数，然后在小节结束时，强制对齐
-	 */
-	auto secMins = sInfo->getSecMinList();
+	uint32_t steplen = baseMins*times;
+	const uint32_t* table = getBarTimeTable(sInfo, steplen, baseMins, bAlignSec);
+	const std::vector<uint32_t>& secMins = sInfo->getSecMinList();
 
 	WTSKlineData* ret = WTSKlineData::create(baseKline->code(), 0);
-	ret->setPeriod(KP_Minute5, times);
-
-	for (auto i = 0; i < baseKline->size(); i++)
+	ret->setPeriod(period, times);
+
+	//m1重采样的新K线日期用自然日,m5的用交易日,保持原来的处理
+	bool bActionDate = (period == KP_Minute1);
+	uint32_t total = (uint32_t)baseKline->size();
+	std::vector<uint64_t> barTimes(total);
+	std::vector<uint32_t> barDates(bActionDate ? total : 0);
+	uint32_t lastDate = 0;
+	uint32_t nextDate = 0;
+	uint32_t idx = 0;
+	for (std::size_t blkIdx = 0; blkIdx < baseKline->get_block_counts(); blkIdx++)
 	{
-		const WTSBarStruct& curBar = *baseKline->at(i);
-
-		uint32_t uTradingDate = curBar.date;
-		uint32_t uDate = TimeUtils::minBarToDate(curBar.time);
-		if(uDate == 19900000)
-			uDate = uTradingDate;
-		uint32_t uTime = TimeUtils::minBarToTime(curBar.time);
-		uint32_t uMinute = sInfo->timeToMinutes(uTime);
-		uint32_t uBarMin = 0;
-		/*
-		 *	By Wesley @ 2023.05.31
-		 *	这里是按小节对齐的核心逻辑
-		 *	1、先增加一个基础分钟数，如果不按小节对齐，就固定为0
-		 *	2、如果按小节对齐，则判断当前分钟处于哪个小节，然后以上个小节结束的分钟数做基础分钟数
-		 *	3、然后根据基础分钟数的差量计算新的对齐分钟数
-		 *	4、最终得到bar的时间戳
-		 */
-		if (bAlignSec)
+		const WTSBarStruct* bars = baseKline->get_block_addr(blkIdx);
+		uint32_t count = baseKline->get_block_size(blkIdx);
+		for (uint32_t i = 0; i < count; i++, idx++)
 		{
-			auto it = std::lower_bound(secMins.begin(), secMins.end(), uMinute);
-			auto secIdx = it - secMins.begin();
-			if (secIdx == 0)
+			const WTSBarStruct& curBar = bars[i];
+			uint32_t uDate = TimeUtils::minBarToDate(curBar.time);
+			if (uDate == 19900000)
+				uDate = curBar.date;
+			uint32_t uTime = TimeUtils::minBarToTime(curBar.time);
+			uint32_t uBarTime = (uTime < 2400) ? table[uTime] : calc_bar_time(sInfo, secMins, uTime, steplen, baseMins, bAlignSec);
+			if (uBarTime < uTime)
 			{
-				uMinute -= 5;
-				uBarMin = (uMinute / steplen)*steplen + steplen;
-				if (uBarMin > secMins[secIdx])
-					uBarMin = secMins[secIdx];
+				//K线是按时间排序的,下一日缓存起来
+				if (uDate != lastDate)
+				{
+					lastDate = uDate;
+					nextDate = TimeUtils::getNextDate(uDate, 1);
+				}
+				uDate = nextDate;
 			}
-			else
-			{
-				uMinute -= secMins[secIdx - 1];
-				uBarMin = secMins[secIdx - 1] + (uMinute / steplen)*steplen + steplen;
-				if (uBarMin > secMins[secIdx])
-					uBarMin = secMins[secIdx];
-			}
-		}
-		else
-		{
-			uMinute -= 5;
-			uBarMin = (uMinute / steplen)*steplen + steplen;
-		}
-
-		uint64_t uBarTime = sInfo->minuteToTime(uBarMin);
-		if (uBarTime < uTime)
-			uDate = TimeUtils::getNextDate(uDate, 1);
-		uBarTime = TimeUtils::timeToMinBar(uDate, (uint32_t)uBarTime);
 
-		WTSBarStruct* lastBar = NULL;
-		if(ret->size() > 0)
-		{
-			lastBar = ret->at(ret->size()-1);
-		}
-
-		bool bNewBar = false;
-		if(lastBar == NULL || lastBar->time != uBarTime)
-		{
-			//只要日期和时间都不符,则认为已经是一条新的bar了
-			lastBar = new WTSBarStruct();
-			bNewBar = true;
-
-			memcpy(lastBar, &curBar, sizeof(WTSBarStruct));
-			lastBar->date = uTradingDate;
-			lastBar->time = uBarTime;
-		}
-		else
-		{
-			bNewBar = false;
-
-			lastBar->high = max(lastBar->high, curBar.high);
-			lastBar->low = min(lastBar->low, curBar.low);
-			lastBar->close = curBar.close;
-			lastBar->settle = curBar.settle;
-
-			lastBar->vol += curBar.vol;
-			lastBar->money += curBar.money;
-			lastBar->add += curBar.add;
-			lastBar->hold = curBar.hold;
-		}
-
-		if(bNewBar)
-		{
-			ret->appendBar(*lastBar);
-			delete lastBar;
+			barTimes[idx] = TimeUtils::timeToMinBar(uDate, uBarTime);
+			if (bActionDate)
+				barDates[idx] = uDate;
 		}
 	}
 
+	const uint64_t* keys = barTimes.data();
+	const uint32_t* dates = barDates.data();
+	merge_bars(baseKline, keys, ret->getDataRef(), true, [keys, dates, bActionDate](WTSBarStruct& newBar, uint32_t i) {
+		if (bActionDate)
+			newBar.date = dates[i];
+		newBar.time = keys[i];
+	});
+
 	//检查最后一条数据
 	{
 		WTSBarStruct* lastRawBar = baseKline->at(-1);
@@ -881,6 +854,21 @@ WTSKlineData* WTSDataFactory::extractMin5Data(WTSKlineSlice* baseKline, uint32_t
 	return ret;
 }
 
+WTSKlineData* WTSDataFactory::extractMin1Data(WTSKlineSlice* baseKline, uint32_t times, WTSSessionInfo* sInfo, bool bIncludeOpen /* = true */, bool bAlignSec /* = false */)
+{
+	/*
+	 *	By Wesley @ 2023.05.31
+	 *	要增加一个按照小节对齐的重采样方式
+	 *	一般逻辑就是每个小节开始重新计算条数，然后在小节结束时，强制对齐
+	 */
+	return extractMinData(baseKline, KP_Minute1, times, sInfo, bIncludeOpen, bAlignSec);
+}
+
+WTSKlineData* WTSDataFactory::extractMin5Data(WTSKlineSlice* baseKline, uint32_t times, WTSSessionInfo* sInfo, bool bIncludeOpen /* = true */, bool bAlignSec /* = false */)
+{
+	return extractMinData(baseKline, KP_Minute5, times, sInfo, bIncludeOpen, bAlignSec);
+}
+
 WTSKlineData* WTSDataFactory::extractDayData(WTSKlineSlice* baseKline, uint32_t times, bool bIncludeOpen /* = true */)
 {
 	//计算时间步长
@@ -889,55 +877,16 @@ WTSKlineData* WTSDataFactory::extractDayData(WTSKlineSlice* baseKline, uint32_t
 	WTSKlineData* ret = WTSKlineData::create(baseKline->code(), 0);
 	ret->setPeriod(KP_DAY, times);
 
-	uint32_t count = 0;
-	//WTSKlineData::WTSBarList& bars = baseKline->getDataRef();
-	//WTSKlineData::WTSBarList::const_iterator it = bars.begin();
-	//for(; it != bars.end(); it++,count++)
-	for (auto i = 0; i < baseKline->size(); i++, count++)
-	{
-		const WTSBarStruct& curBar = *baseKline->at(i);
-
-		uint32_t uDate = curBar.date;
-
-		WTSBarStruct* lastBar = NULL;
-		if(ret->size() > 0)
-		{
-			lastBar = ret->at(ret->size()-1);
-		}
-
-		bool bNewBar = false;
-		if(lastBar == NULL || count == steplen)
-		{
-			//只要日期和时间都不符,则认为已经是一条新的bar了
-			lastBar = new WTSBarStruct();
-			bNewBar = true;
+	//每steplen根日线合并成一根
+	uint32_t total = (uint32_t)baseKline->size();
+	std::vector<uint64_t> groups(total);
+	for (uint32_t i = 0; i < total; i++)
+		groups[i] = i / steplen;
 
-			memcpy(lastBar, &curBar, sizeof(WTSBarStruct));
-			lastBar->date = uDate;
-			lastBar->time = 0;
-			count = 0;
-		}
-		else
-		{
-			bNewBar = false;
-
-			lastBar->high = max(lastBar->high, curBar.high);
-			lastBar->low = min(lastBar->low, curBar.low);
-			lastBar->close = curBar.close;
-			lastBar->settle = curBar.settle;
-
-			lastBar->vol += curBar.vol;
-			lastBar->money += curBar.money;
-			lastBar->add = curBar.add;
-			lastBar->hold = curBar.hold;
-		}
-
-		if(bNewBar)
-		{
-			ret->appendBar(*lastBar);
-			delete lastBar;
-		}
-	}
+	//日线的增仓取最后一根的
+	merge_bars(baseKline, groups.data(), ret->getDataRef(), false, [](WTSBarStruct& newBar, uint32_t i) {
+		newBar.time = 0;
+	});
 
 	return ret;
 }
@@ -9,6 +9,10 @@
  */
 #pragma once
 #include "../Includes/IDataFactory.h"
+#include "../Includes/FasterDefs.h"
+#include "../Share/StdUtils.hpp"
+
+#include <vector>
 
 USING_NS_WTP;
 
@@ -72,7 +76,23 @@ protected:
 	WTSKlineData* extractMin5Data(WTSKlineSlice* baseKline, uint32_t times, WTSSessionInfo* sInfo, bool bIncludeOpen = true, bool bAlignSec = false);
 	WTSKlineData* extractDayData(WTSKlineSlice* baseKline, uint32_t times, bool bIncludeOpen = true);
 
+	/*
+	 *	m1和m5重采样的公共实现
+	 *	@period	基础周期,m1或m5
+	 */
+	WTSKlineData* extractMinData(WTSKlineSlice* baseKline, WTSKlinePeriod period, uint32_t times, WTSSessionInfo* sInfo, bool bIncludeOpen, bool bAlignSec);
+
+	/*
+	 *	获取基础K线时间(HHMM)到目标K线时间(HHMM)的映射表
+	 *	每个(交易时间模板,步长,基础周期,是否按小节对齐)的组合只算一次
+	 */
+	const uint32_t* getBarTimeTable(WTSSessionInfo* sInfo, uint32_t steplen, uint32_t baseMins, bool bAlignSec);
+
 protected:
 	static uint32_t getPrevMinute(uint32_t curMinute, int period = 1);
+
+private:
+	StdUniqueMutex	m_mtxTables;
+	wt_hashmap<std::string, std::vector<uint32_t>>	m_mapTimeTables;
 };
 
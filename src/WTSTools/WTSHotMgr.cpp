@@ -60,57 +60,12 @@ const char* WTSHotMgr::getRuleTag(const char* stdCode)
 
 double WTSHotMgr::getRuleFactor(const char* ruleTag, const char* fullPid, uint32_t uDate /* = 0 */ )
 {
-	if (m_mapCustRules == NULL)
-		return 1.0;
-
-	WTSProductHotMap* prodMap = (WTSProductHotMap*)m_mapCustRules->get(ruleTag);
-	if (prodMap == NULL)
-		return 1.0;
-
-	WTSDateHotMap* dtMap = STATIC_CONVERT(prodMap->get(fullPid), WTSDateHotMap*);
-	if (dtMap == NULL)
+	//第一次切换之前的复权因子为1.0
+	const HotSegment* seg = findSegment(ruleTag, fullPid, uDate);
+	if (seg == NULL)
 		return 1.0;
 
-	if(uDate == 0)
-	{
-		WTSSwitchItem* pItem = STATIC_CONVERT(dtMap->rbegin()->second, WTSSwitchItem*);
-		return pItem->get_factor();
-	}
-
-	auto it = dtMap->lower_bound(uDate);
-	if(it == dtMap->end())
-	{
-		//找不到，说明记录的日期都比传入的日期小，所以返回最后一条的复权因子
-		WTSSwitchItem* pItem = STATIC_CONVERT(dtMap->rbegin()->second, WTSSwitchItem*);
-		return pItem->get_factor();
-	}
-	else
-	{
-		//找到了，就要看切换日期是否等于传入日期
-		//如果相等，说明刚好切换，那么就直接返回复权因子
-		WTSSwitchItem* pItem = STATIC_CONVERT(it->second, WTSSwitchItem*);
-		if (pItem->switch_date() == uDate)
-		{
-			return pItem->get_factor();
-		}
-		else
-		{
-			//如果切换日期大于传入日期，则要看前一个阶段
-			//如果已经是第一个了，则直接返回1.0
-			if (it == dtMap->begin())
-			{
-				return 1.0;
-			}
-			else
-			{
-				//如果不是第一个，则回退一个，再返回即可
-				it--;
-				WTSSwitchItem* pItem = STATIC_CONVERT(it->second, WTSSwitchItem*);
-				return pItem->get_factor();
-			}
-		}
-	}
-
+	return seg->_factor;
 }
 
 #pragma region "次主力接口"
@@ -126,7 +81,11 @@ const char* WTSHotMgr::getPrevRawCode(const char* exchg, const char* pid, uint32
 	static thread_local char fullPid[64] = { 0 };
 	fmtutil::format_to(fullPid, "{}.{}", exchg, pid);
 
-	return getPrevCustomRawCode("HOT", fullPid, dt);
+	if (dt == 0)
+		dt = TimeUtils::getCurDate();
+
+	const HotSegment* seg = findSegment("HOT", fullPid, dt);
+	return (seg == NULL) ? "" : seg->_prev.c_str();
 }
 
 const char* WTSHotMgr::getRawCode(const char* exchg, const char* pid, uint32_t dt)
@@ -134,7 +93,11 @@ const char* WTSHotMgr::getRawCode(const char* exchg, const char* pid, uint32_t d
 	static thread_local char fullPid[64] = { 0 };
 	fmtutil::format_to(fullPid, "{}.{}", exchg, pid);
 
-	return getCustomRawCode("HOT", fullPid, dt);
+	if (dt == 0)
+		dt = TimeUtils::getCurDate();
+
+	const HotSegment* seg = findSegment("HOT", fullPid, dt);
+	return (seg == NULL) ? "" : seg->_code.c_str();
 }
 
 bool WTSHotMgr::isHot(const char* exchg, const char* rawCode, uint32_t dt)
@@ -165,7 +128,11 @@ const char* WTSHotMgr::getPrevSecondRawCode(const char* exchg, const char* pid,
 	static thread_local char fullPid[64] = { 0 };
 	fmtutil::format_to(fullPid, "{}.{}", exchg, pid);
 
-	return getPrevCustomRawCode("2ND", fullPid, dt);
+	if (dt == 0)
+		dt = TimeUtils::getCurDate();
+
+	const HotSegment* seg = findSegment("2ND", fullPid, dt);
+	return (seg == NULL) ? "" : seg->_prev.c_str();
 }
 
 const char* WTSHotMgr::getSecondRawCode(const char* exchg, const char* pid, uint32_t dt)
@@ -173,7 +140,11 @@ const char* WTSHotMgr::getSecondRawCode(const char* exchg, const char* pid, uint
 	static thread_local char fullPid[64] = { 0 };
 	fmtutil::format_to(fullPid, "{}.{}", exchg, pid);
 
-	return getCustomRawCode("2ND", fullPid, dt);
+	if (dt == 0)
+		dt = TimeUtils::getCurDate();
+
+	const HotSegment* seg = findSegment("2ND", fullPid, dt);
+	return (seg == NULL) ? "" : seg->_code.c_str();
 }
 
 bool WTSHotMgr::isSecond(const char* exchg, const char* rawCode, uint32_t dt)
@@ -181,7 +152,7 @@ bool WTSHotMgr::isSecond(const char* exchg, const char* rawCode, uint32_t dt)
 	static thread_local char fullCode[64] = { 0 };
 	fmtutil::format_to(fullCode, "{}.{}", exchg, rawCode);
 
-	return isCustomHot("2NDT", fullCode, dt);
+	return isCustomHot("2ND", fullCode, dt);
 }
 
 bool WTSHotMgr::splitSecondSecions(const char* exchg, const char* pid, uint32_t sDt, uint32_t eDt, HotSections& sections)
@@ -228,7 +199,6 @@ bool WTSHotMgr::loadCustomRules(const char* tag, const char* filename)
 			WTSDateHotMap* dateMap = WTSDateHotMap::create();
 			prodMap->add(fullPid.c_str(), dateMap, false);
 
-			std::string lastCode;
 			double factor = 1.0;
 			for (uint32_t i = 0; i < jProduct->size(); i++)
 			{
@@ -244,11 +214,10 @@ bool WTSHotMgr::loadCustomRules(const char* tag, const char* filename)
 				factor *= (decimal::eq(oldclose, 0.0) ? 1.0 : (oldclose/ newclose));
 				pItem->set_factor(factor);
 				dateMap->add(pItem->switch_date(), pItem, false);
-				lastCode = jHotItem->getCString("to");
 			}
 
-			std::string fullCode = fmt::format("{}.{}", exchg.c_str(), lastCode.c_str());
-			m_mapCustCodes[tag].insert(fullCode);
+			//加载的时候就编译成按日期索引的数组
+			compileRule(tag, fullPid.c_str(), dateMap);
 		}
 	}
 
@@ -256,145 +225,143 @@ bool WTSHotMgr::loadCustomRules(const char* tag, const char* filename)
 	return true;
 }
 
-const char* WTSHotMgr::getPrevCustomRawCode(const char* tag, const char* fullPid, uint32_t dt /* = 0 */)
+/*
+ *	日期转成日序号,按公历连续编号,相邻两天的序号差1
+ */
+static inline uint32_t date_to_days(uint32_t uDate)
 {
-	if (m_mapCustRules == NULL)
-		return "";
+	uint32_t y = uDate / 10000;
+	uint32_t m = uDate % 10000 / 100;
+	uint32_t d = uDate % 100;
+	if (m <= 2)
+		y--;
+
+	uint32_t era = y / 400;
+	uint32_t yoe = y - era * 400;
+	uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+	uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe;
+}
 
-	if (dt == 0)
-		dt = TimeUtils::getCurDate();
+void WTSHotMgr::compileRule(const char* tag, const char* fullPid, WTSDateHotMap* dtMap)
+{
+	std::unique_ptr<CompiledHotRule> rule(new CompiledHotRule);
+	auto& segments = rule->_segments;
+	for (auto it = dtMap->begin(); it != dtMap->end(); it++)
+	{
+		WTSSwitchItem* pItem = STATIC_CONVERT(it->second, WTSSwitchItem*);
+		HotSegment seg;
+		seg._date = pItem->switch_date();
+		seg._code = pItem->to();
+		seg._prev = segments.empty() ? "" : segments.back()._code;
+		seg._factor = pItem->get_factor();
+		segments.emplace_back(seg);
+	}
 
-	if (m_mapCustRules == NULL)
-		return "";
+	rule->_first_day = 0;
+	if (!segments.empty() && segments.size() <= UINT16_MAX)
+	{
+		//每一段从自己的切换日期开始,到下一段的切换日期前一天为止
+		rule->_first_day = date_to_days(segments.front()._date);
+		uint32_t lastDay = date_to_days(segments.back()._date);
+		rule->_day_index.resize(lastDay - rule->_first_day + 1, 0);
+		for (std::size_t i = 0; i < segments.size(); i++)
+		{
+			uint32_t from = date_to_days(segments[i]._date) - rule->_first_day;
+			uint32_t to = (i == segments.size() - 1) ? (uint32_t)rule->_day_index.size() : (date_to_days(segments[i + 1]._date) - rule->_first_day);
+			for (uint32_t day = from; day < to; day++)
+				rule->_day_index[day] = (uint16_t)i;
+		}
+	}
 
-	WTSProductHotMap* prodMap = (WTSProductHotMap*)m_mapCustRules->get(tag);
-	if (prodMap == NULL)
-		return "";
+	uint32_t ruleIdx = (uint32_t)m_vecRules.size();
+	HotRuleIndex& ruleIndex = m_mapRuleIdx[tag];
+	ruleIndex._pids[fullPid] = ruleIdx;
 
-	WTSDateHotMap* dtMap = STATIC_CONVERT(prodMap->get(fullPid), WTSDateHotMap*);
-	if (dtMap == NULL)
-		return "";
+	auto pos = StrUtil::findFirst(fullPid, '.');
+	std::string exchg(fullPid, pos);
+	for (const HotSegment& seg : segments)
+		ruleIndex._codes[fmt::format("{}.{}", exchg, seg._code)] = ruleIdx;
 
-	WTSDateHotMap::ConstIterator cit = dtMap->lower_bound(dt);
-	if (cit != dtMap->end())
-	{
-		if (dt < cit->first)
-			cit--;
+	m_vecRules.emplace_back(std::move(rule));
+}
 
-		if (cit == dtMap->end() || cit == dtMap->begin())
-			return "";
+uint32_t WTSHotMgr::getRuleIndex(const char* tag, const char* fullPid) const
+{
+	auto it = m_mapRuleIdx.find(tag);
+	if (it == m_mapRuleIdx.end())
+		return INVALID_UINT32;
 
-		cit--;
+	const auto& pids = it->second._pids;
+	auto pit = pids.find(fullPid);
+	if (pit == pids.end())
+		return INVALID_UINT32;
 
-		WTSSwitchItem* pItem = STATIC_CONVERT(cit->second, WTSSwitchItem*);
-		return pItem->to();
-	}
-	else
-	{
-		cit--;
+	return pit->second;
+}
 
-		if (cit == dtMap->end() || cit == dtMap->begin())
-			return "";
+const HotSegment* WTSHotMgr::getSegment(uint32_t ruleIdx, uint32_t dt) const
+{
+	if (ruleIdx >= m_vecRules.size())
+		return NULL;
 
-		cit--;
+	const CompiledHotRule& rule = *m_vecRules[ruleIdx];
+	const auto& segments = rule._segments;
+	if (segments.empty())
+		return NULL;
 
-		WTSSwitchItem* pItem = STATIC_CONVERT(cit->second, WTSSwitchItem*);
-		return pItem->to();
-	}
+	if (dt == 0 || rule._day_index.empty())
+		return &segments.back();
 
-	return "";
+	uint32_t day = date_to_days(dt);
+	if (day < rule._first_day)
+		return NULL;
+
+	uint32_t offset = day - rule._first_day;
+	if (offset >= rule._day_index.size())
+		return &segments.back();
+
+	return &segments[rule._day_index[offset]];
 }
 
-const char* WTSHotMgr::getCustomRawCode(const char* tag, const char* fullPid, uint32_t dt /* = 0 */)
+const char* WTSHotMgr::getPrevCustomRawCode(const char* tag, const char* fullPid, uint32_t dt /* = 0 */)
 {
-	if (m_mapCustRules == NULL)
-		return "";
-
 	if (dt == 0)
 		dt = TimeUtils::getCurDate();
 
-	WTSProductHotMap* prodMap = (WTSProductHotMap*)m_mapCustRules->get(tag);
-	if (prodMap == NULL)
-		return "";
-
-	WTSDateHotMap* dtMap = STATIC_CONVERT(prodMap->get(fullPid), WTSDateHotMap*);
-	if (dtMap == NULL)
-		return "";
-
-	WTSDateHotMap::ConstIterator cit = dtMap->lower_bound(dt);
-	if (cit != dtMap->end())
-	{
-		if (dt < cit->first)
-			cit--;
-
-		if (cit == dtMap->end())
-			return "";
+	const HotSegment* seg = findSegment(tag, fullPid, dt);
+	return (seg == NULL) ? "" : seg->_prev.c_str();
+}
 
-		WTSSwitchItem* pItem = STATIC_CONVERT(cit->second, WTSSwitchItem*);
-		return pItem->to();
-	}
-	else
-	{
-		WTSSwitchItem* pItem = STATIC_CONVERT(dtMap->last(), WTSSwitchItem*);
-		return pItem->to();
-	}
+const char* WTSHotMgr::getCustomRawCode(const char* tag, const char* fullPid, uint32_t dt /* = 0 */)
+{
+	if (dt == 0)
+		dt = TimeUtils::getCurDate();
 
-	return "";
+	const HotSegment* seg = findSegment(tag, fullPid, dt);
+	return (seg == NULL) ? "" : seg->_code.c_str();
 }
 
 bool WTSHotMgr::isCustomHot(const char* tag, const char* fullCode, uint32_t dt /* = 0 */)
 {
-	if (m_mapCustRules == NULL)
+	auto it = m_mapRuleIdx.find(tag);
+	if (it == m_mapRuleIdx.end())
 		return false;
 
-	const auto& curHotCodes = m_mapCustCodes[tag];
-	if (curHotCodes.empty())
+	//规则里出现过的合约才需要判断
+	const auto& codes = it->second._codes;
+	auto cit = codes.find(fullCode);
+	if (cit == codes.end())
 		return false;
 
-	if (dt == 0)
-	{
-		auto it = curHotCodes.find(fullCode);
-		if (it == curHotCodes.end())
-			return false;
-		else
-			return true;
-	}
+	//dt为0的时候取最后一段,即当前的主力
+	const HotSegment* seg = getSegment(cit->second, dt);
+	if (seg == NULL)
+		return false;
 
 	auto idx = StrUtil::findFirst(fullCode, '.');
 	const char* rawCode = fullCode + idx + 1;
-	std::string fullPid(fullCode, idx);
-	fullPid += ".";
-	fullPid += CodeHelper::rawMonthCodeToRawCommID(rawCode);
-
-	WTSProductHotMap* prodMap = (WTSProductHotMap*)m_mapCustRules->get(tag);
-	if (prodMap == NULL)
-		return "";
-
-	WTSDateHotMap* dtMap = STATIC_CONVERT(prodMap->get(fullPid), WTSDateHotMap*);
-	if (dtMap == NULL)
-		return "";
-
-	WTSDateHotMap::ConstIterator cit = dtMap->lower_bound(dt);
-	if (cit != dtMap->end())
-	{
-		WTSSwitchItem* pItem = STATIC_CONVERT(cit->second, WTSSwitchItem*);
-		//因为登记的换月日期是开始生效的交易日，如果是下午盘后确定主力的话
-		//那么dt就会是第二天，所以，dt必须大于等于切换日期
-		if (pItem->switch_date() > dt)
-			cit--;
-
-		pItem = STATIC_CONVERT(cit->second, WTSSwitchItem*);
-		if (strcmp(pItem->to(), rawCode) == 0)
-			return true;
-	}
-	else if (dtMap->size() > 0)
-	{
-		WTSSwitchItem* pItem = (WTSSwitchItem*)dtMap->last();
-		if (strcmp(pItem->to(), rawCode) == 0)
-			return true;
-	}
-
-	return false;
+	return strcmp(seg->_code.c_str(), rawCode) == 0;
 }
 
 bool WTSHotMgr::splitCustomSections(const char* tag, const char* fullPid, uint32_t sDt, uint32_t eDt, HotSections& sections)
@@ -12,6 +12,8 @@
 #include "../Includes/FasterDefs.h"
 #include "../Includes/WTSCollection.hpp"
 #include <string>
+#include <vector>
+#include <memory>
 
 NS_WTP_BEGIN
 	class WTSSwitchItem;
@@ -29,6 +31,25 @@ typedef WTSHashMap<std::string>		WTSExchgHotMap;
 //自定义切换规则映射
 typedef WTSHashMap<std::string>		WTSCustomSwitchMap;
 
+/*
+ *	编译好的换月规则
+ *	规则加载的时候按品种展开成按日序号索引的数组,查询的时候直接用日期算下标
+ */
+typedef struct _HotSegment
+{
+	uint32_t	_date;		//开始生效的日期
+	std::string	_code;		//当期的分月合约
+	std::string	_prev;		//上一期的分月合约
+	double		_factor;	//累计复权因子
+} HotSegment;
+
+typedef struct _CompiledHotRule
+{
+	std::vector<HotSegment>	_segments;
+	uint32_t				_first_day;		//第一个切换日期的日序号
+	std::vector<uint16_t>	_day_index;		//从第一个切换日期到最后一个切换日期,每一天对应的段号
+} CompiledHotRule;
+
 class WTSHotMgr : public IHotMgr
 {
 public:
@@ -79,6 +100,37 @@ public:
 
 	virtual bool		splitCustomSections(const char* tag, const char* fullPid, uint32_t sDt, uint32_t eDt, HotSections& sections) override;
 
+	//////////////////////////////////////////////////////////////////////////
+	//整数接口,先取一次规则索引,后面按日期直接查
+	/*
+	 *	获取规则索引
+	 *	tag		规则标签,如HOT、2ND
+	 *	fullPid	品种全称,如SHFE.rb
+	 *
+	 *	返回值	找不到返回INVALID_UINT32
+	 */
+	uint32_t	getRuleIndex(const char* tag, const char* fullPid) const;
+
+	/*
+	 *	获取指定日期生效的规则段
+	 *	dt	日期,为0则取最后一段
+	 *
+	 *	返回值	日期在第一次切换之前返回NULL
+	 */
+	const HotSegment*	getSegment(uint32_t ruleIdx, uint32_t dt) const;
+
+	/*
+	 *	按规则标签和品种获取指定日期生效的规则段,只查一次的时候用
+	 *	反复查同一个品种的,先用getRuleIndex取索引再用getSegment
+	 */
+	inline const HotSegment* findSegment(const char* tag, const char* fullPid, uint32_t dt) const
+	{
+		return getSegment(getRuleIndex(tag, fullPid), dt);
+	}
+
+private:
+	void		compileRule(const char* tag, const char* fullPid, WTSDateHotMap* dtMap);
+
 
 private:
 	//WTSExchgHotMap*	m_pExchgHotMap;
@@ -88,7 +140,13 @@ private:
 	bool			m_bInitialized;
 
 	WTSCustomSwitchMap*	m_mapCustRules;
-	typedef wt_hashmap<std::string, wt_hashset<std::string>>	CustomSwitchCodes;
-	CustomSwitchCodes	m_mapCustCodes;
+
+	std::vector<std::unique_ptr<CompiledHotRule>>	m_vecRules;
+	typedef struct _HotRuleIndex
+	{
+		wt_hashmap<std::string, uint32_t>	_pids;	//exchg.pid到规则索引
+		wt_hashmap<std::string, uint32_t>	_codes;	//exchg.code到规则索引
+	} HotRuleIndex;
+	wt_hashmap<std::string, HotRuleIndex>	m_mapRuleIdx;	//按规则标签分组
 };
 
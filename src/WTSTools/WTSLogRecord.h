@@ -0,0 +1,189 @@
+﻿/*!
+ * \file WTSLogRecord.h
+ * \project	WonderTrader
+ *
+ * \brief 延迟格式化的日志记录定义
+ */
+#pragma once
+#include "../Includes/WTSTypes.h"
+#include "../Share/fmtlib.h"
+
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+NS_WTP_BEGIN
+
+#define LOG_RECORD_PAYLOAD	480
+
+/*
+ *	格式化函数,每种参数组合实例化一个
+ *	data为编码以后的参数
+ */
+typedef void(*LogFormatter)(fmt::memory_buffer& buf, fmt::string_view format, const char* data);
+
+typedef enum tagLogRecordType
+{
+	LRT_FORMAT = 0,	//延迟格式化,payload里是格式串和编码以后的参数
+	LRT_RAW,		//已经格式化好的消息
+	LRT_RAW_CAT,	//分类输出,payload里是分类名和消息
+	LRT_RAW_DYN		//动态分类输出,payload里是模板名、分类名和消息
+} LogRecordType;
+
+/*
+ *	日志记录,固定512字节,放在每个线程自己的环形队列里
+ */
+typedef struct _LogRecord
+{
+	uint8_t			_type;
+	uint8_t			_level;
+	uint16_t		_len;		//payload的有效长度
+	uint32_t		_reserved;
+	int64_t			_time;		//调用的时间,system_clock的纳秒数
+	LogFormatter	_formatter;
+	char			_reserved2[8];
+	char			_payload[LOG_RECORD_PAYLOAD];
+} LogRecord;
+
+namespace logfmt
+{
+	/*
+	 *	参数的编解码
+	 *	数值、枚举直接拷贝内存,字符串拷贝内容,解码成string_view
+	 *	其他类型不支持,整条日志退回到调用线程上直接格式化
+	 */
+	template<typename T, typename Enable = void>
+	struct ArgCodec
+	{
+		static constexpr bool supported = false;
+	};
+
+	template<typename T>
+	struct ArgCodec<T, typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type>
+	{
+		static constexpr bool supported = true;
+		typedef T value_type;
+
+		static inline bool encode(char*& p, const char* end, const T& v)
+		{
+			if (p + sizeof(T) > end)
+				return false;
+
+			memcpy(p, &v, sizeof(T));
+			p += sizeof(T);
+			return true;
+		}
+
+		static inline T decode(const char*& p)
+		{
+			T v;
+			memcpy(&v, p, sizeof(T));
+			p += sizeof(T);
+			return v;
+		}
+	};
+
+	struct StrCodec
+	{
+		static constexpr bool supported = true;
+		typedef fmt::string_view value_type;
+
+		static inline bool encode_str(char*& p, const char* end, const char* s, std::size_t len)
+		{
+			if (len > UINT16_MAX || p + sizeof(uint16_t) + len > end)
+				return false;
+
+			uint16_t l = (uint16_t)len;
+			memcpy(p, &l, sizeof(uint16_t));
+			memcpy(p + sizeof(uint16_t), s, len);
+			p += sizeof(uint16_t) + len;
+			return true;
+		}
+
+		static inline fmt::string_view decode(const char*& p)
+		{
+			uint16_t l;
+			memcpy(&l, p, sizeof(uint16_t));
+			fmt::string_view ret(p + sizeof(uint16_t), l);
+			p += sizeof(uint16_t) + l;
+			return ret;
+		}
+	};
+
+	template<>
+	struct ArgCodec<const char*> : public StrCodec
+	{
+		//空指针交给原来的流程处理
+		static inline bool encode(char*& p, const char* end, const char* s)
+		{
+			return s != NULL && encode_str(p, end, s, strlen(s));
+		}
+	};
+
+	template<>
+	struct ArgCodec<char*> : public ArgCodec<const char*> {};
+
+	template<>
+	struct ArgCodec<std::string> : public StrCodec
+	{
+		static inline bool encode(char*& p, const char* end, const std::string& s)
+		{
+			return encode_str(p, end, s.data(), s.size());
+		}
+	};
+
+	template<>
+	struct ArgCodec<std::string_view> : public StrCodec
+	{
+		static inline bool encode(char*& p, const char* end, const std::string_view& s)
+		{
+			return encode_str(p, end, s.data(), s.size());
+		}
+	};
+
+	template<typename T>
+	using Codec = ArgCodec<typename std::decay<T>::type>;
+
+	template<typename... Args>
+	struct Supported
+	{
+		static constexpr bool value = (Codec<Args>::supported && ...);
+	};
+
+	/*
+	 *	编码格式串和参数
+	 *	格式串也要拷贝,有的调用方会把缓冲区直接当格式串传进来
+	 *
+	 *	返回值	放不下返回false
+	 */
+	template<typename... Args>
+	inline bool encode(LogRecord& rec, const char* format, const Args& ...args)
+	{
+		char* p = rec._payload;
+		const char* end = p + LOG_RECORD_PAYLOAD;
+		if (!StrCodec::encode_str(p, end, format, strlen(format)))
+			return false;
+
+		if (!(Codec<Args>::encode(p, end, args) && ...))
+			return false;
+
+		rec._len = (uint16_t)(p - rec._payload);
+		return true;
+	}
+
+	template<typename... Args>
+	void format(fmt::memory_buffer& buf, fmt::string_view format, const char* data)
+	{
+		//花括号初始化保证按从左到右的顺序解码
+		const char* p = data;
+		std::tuple<typename Codec<Args>::value_type...> vals{ Codec<Args>::decode(p)... };
+		(void)p;
+		std::apply([&buf, format](const auto& ...v) {
+			fmt::format_to(std::back_inserter(buf), fmt::runtime(format), v...);
+		}, vals);
+	}
+}
+
+NS_WTP_END
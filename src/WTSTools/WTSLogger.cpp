@@ -23,6 +23,7 @@
 #include "../Share/StdUtils.hpp"
 #include "../Share/StrUtil.hpp"
 #include "../Share/TimeUtils.hpp"
+#include "../Share/WtSpscRing.hpp"
 
 #include <boost/filesystem.hpp>
 
@@ -32,11 +33,17 @@
 #include <spdlog/sinks/ostream_sink.h>
 #include <spdlog/async.h>
 
+#include <atomic>
+#include <cstdlib>
+#include <vector>
+
 const char* DYN_PATTERN = "dyn_pattern";
+const char* DEFERRED_CFG = "deferred";
 
 ILogHandler*		WTSLogger::m_logHandler	= NULL;
 WTSLogLevel			WTSLogger::m_logLevel	= LL_NONE;
 bool				WTSLogger::m_bStopped = false;
+std::atomic<bool>	WTSLogger::m_bDeferred(false);
 bool				WTSLogger::m_bInited = false;
 bool				WTSLogger::m_bTpInited = false;
 SpdLoggerPtr		WTSLogger::m_rootLogger = NULL;
@@ -100,6 +107,26 @@ inline WTSLogLevel str_to_ll(const char* slvl)
 	}
 }
 
+inline WTSLogLevel level_to_ll(spdlog::level::level_enum lvl)
+{
+	switch (lvl)
+	{
+	case spdlog::level::trace:
+	case spdlog::level::debug:
+		return LL_DEBUG;
+	case spdlog::level::info:
+		return LL_INFO;
+	case spdlog::level::warn:
+		return LL_WARN;
+	case spdlog::level::err:
+		return LL_ERROR;
+	case spdlog::level::critical:
+		return LL_FATAL;
+	default:
+		return LL_NONE;
+	}
+}
+
 inline void checkDirs(const char* filename)
 {
 	std::string s = StrUtil::standardisePath(filename, false);
@@ -229,6 +256,10 @@ void WTSLogger::init(const char* propFile /* = "logcfg.json" */, bool isFile /*
 			}
 			continue;
 		}
+		else if (key == DEFERRED_CFG)
+		{
+			continue;
+		}
 
 		initLogger(key.c_str(), cfgItem);
 	}
@@ -244,6 +275,21 @@ void WTSLogger::init(const char* propFile /* = "logcfg.json" */, bool isFile /*
 	m_logHandler = handler;
 
 	m_bInited = true;
+
+	/*
+	 *	延迟格式化模式,配置如下
+	 *	"deferred":{"active":true, "queue_size":4096, "overflow":"drop"}
+	 *	overflow为block的时候,队列满了调用线程会等待
+	 */
+	WTSVariant* cfgDeferred = cfg->get(DEFERRED_CFG);
+	if (cfgDeferred && cfgDeferred->getBoolean("active"))
+	{
+		uint32_t queueSize = cfgDeferred->getUInt32("queue_size");
+		if (queueSize == 0)
+			queueSize = 4096;
+		bool bBlock = wt_stricmp(cfgDeferred->getCString("overflow"), "block") == 0;
+		enableDeferred(true, queueSize, bBlock);
+	}
 }
 
 void WTSLogger::registerHandler(ILogHandler* handler /* = NULL */)
@@ -253,6 +299,8 @@ void WTSLogger::registerHandler(ILogHandler* handler /* = NULL */)
 
 void WTSLogger::stop()
 {
+	//先把队列里的日志都输出完
+	enableDeferred(false);
 	m_bStopped = true;
 	if (m_mapPatterns)
 		m_mapPatterns->release();
@@ -330,6 +378,9 @@ void WTSLogger::log_raw(WTSLogLevel ll, const char* message)
 		return;
 	}
 
+	if (m_bDeferred && post_raw(LRT_RAW, ll, message))
+		return;
+
 	auto logger = m_rootLogger;
 
 	if (logger)
@@ -357,6 +408,10 @@ void WTSLogger::log_raw_by_cat(const char* catName, WTSLogLevel ll, const char*
 	if (m_logLevel > ll || m_bStopped)
 		return;
 
+	//分类的日志对象也在后台线程里获取
+	if (m_bDeferred && post_raw(LRT_RAW_CAT, ll, message, catName))
+		return;
+
 	auto logger = getLogger(catName);
 	if (logger == NULL)
 		logger = m_rootLogger;
@@ -399,6 +454,9 @@ void WTSLogger::log_dyn_raw(const char* patttern, const char* catName, WTSLogLev
 	if (m_logLevel > ll || m_bStopped)
 		return;
 
+	if (m_bDeferred && post_raw(LRT_RAW_DYN, ll, message, catName, patttern))
+		return;
+
 	auto logger = getLogger(catName, patttern);
 	if (logger == NULL)
 		logger = m_rootLogger;
@@ -434,6 +492,19 @@ void WTSLogger::log_dyn_raw(const char* patttern, const char* catName, WTSLogLev
 }
 
 
+WTSLogLevel WTSLogger::get_dyn_level(const char* patttern, const char* catName)
+{
+	if (m_bStopped)
+		return LL_NONE;
+
+	auto logger = getLogger(catName, patttern);
+	if (logger == NULL)
+		return m_logLevel;
+
+	WTSLogLevel ll = level_to_ll(logger->level());
+	return (ll > m_logLevel) ? ll : m_logLevel;
+}
+
 SpdLoggerPtr WTSLogger::getLogger(const char* logger, const char* pattern /* = "" */)
 {
 	SpdLoggerPtr ret = spdlog::get(logger);
@@ -467,4 +538,316 @@ void WTSLogger::freeAllDynLoggers()
 
 		spdlog::drop(logger);
 	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//延迟格式化模式
+/*
+ *	每个线程一个队列,线程退出以后标记为孤儿,后台线程处理完剩下的数据再移除
+ *	关闭延迟模式的时候所有队列都作废,再次打开以后按新的容量重新创建
+ */
+typedef struct _LogQueue
+{
+	WtSpscRing<LogRecord>	_ring;
+	std::atomic<uint64_t>	_dropped;
+	std::atomic<bool>		_orphan;
+	uint32_t				_generation;
+
+	_LogQueue(uint32_t capacity, uint32_t generation) :_ring(capacity), _dropped(0), _orphan(false), _generation(generation) {}
+} LogQueue;
+typedef std::shared_ptr<LogQueue> LogQueuePtr;
+
+typedef struct _LogQueueHolder
+{
+	LogQueuePtr	_queue;
+
+	~_LogQueueHolder()
+	{
+		if (_queue)
+			_queue->_orphan = true;
+	}
+} LogQueueHolder;
+
+static thread_local LogQueueHolder	g_tlsQueue;
+static StdUniqueMutex			g_mtxQueues;
+static std::vector<LogQueuePtr>	g_allQueues;
+static std::atomic<uint32_t>	g_uQueueVer(0);
+static std::atomic<uint32_t>	g_uGeneration(0);
+static std::atomic<uint64_t>	g_uDropped(0);
+static StdThreadPtr				g_thrdDeferred;
+static std::atomic<bool>		g_bDeferredStop(false);
+static uint32_t					g_uQueueSize = 4096;
+static bool						g_bBlockWhenFull = false;
+static bool						g_bExitHooked = false;
+
+/*
+ *	没有调用stop就退出的时候,后台线程还在运行
+ *	静态变量析构的时候线程还是joinable的会直接terminate,队列里的日志也丢了
+ *	所以第一次开启的时候注册一个退出回调,把队列处理完再结束线程
+ */
+static void on_process_exit()
+{
+	WTSLogger::enableDeferred(false);
+}
+
+inline spdlog::level::level_enum ll_to_level(WTSLogLevel ll)
+{
+	switch (ll)
+	{
+	case LL_DEBUG: return spdlog::level::debug;
+	case LL_INFO: return spdlog::level::info;
+	case LL_WARN: return spdlog::level::warn;
+	case LL_ERROR: return spdlog::level::err;
+	case LL_FATAL: return spdlog::level::critical;
+	default: return spdlog::level::off;
+	}
+}
+
+LogRecord* WTSLogger::alloc_record()
+{
+	LogQueue* queue = g_tlsQueue._queue.get();
+	if (queue == NULL || queue->_generation != g_uGeneration)
+	{
+		g_tlsQueue._queue.reset(new LogQueue(g_uQueueSize, g_uGeneration));
+		queue = g_tlsQueue._queue.get();
+
+		StdUniqueLock lock(g_mtxQueues);
+		g_allQueues.emplace_back(g_tlsQueue._queue);
+		g_uQueueVer++;
+	}
+
+	LogRecord* rec = queue->_ring.alloc();
+	while (rec == NULL)
+	{
+		if (!g_bBlockWhenFull || !m_bDeferred)
+		{
+			queue->_dropped++;
+			return NULL;
+		}
+
+		std::this_thread::yield();
+		rec = queue->_ring.alloc();
+	}
+
+	rec->_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	return rec;
+}
+
+void WTSLogger::commit_record()
+{
+	g_tlsQueue._queue->_ring.commit();
+}
+
+bool WTSLogger::post_raw(LogRecordType rt, WTSLogLevel ll, const char* message, const char* catName /* = "" */, const char* pattern /* = "" */)
+{
+	std::size_t lenMsg = strlen(message);
+	std::size_t lenCat = strlen(catName);
+	std::size_t lenPat = strlen(pattern);
+	std::size_t total = lenMsg;
+	if (rt == LRT_RAW_CAT)
+		total += sizeof(uint16_t) + lenCat;
+	else if (rt == LRT_RAW_DYN)
+		total += sizeof(uint16_t) * 2 + lenCat + lenPat;
+
+	//放不下的走同步流程
+	if (total > LOG_RECORD_PAYLOAD)
+		return false;
+
+	LogRecord* rec = alloc_record();
+	if (rec == NULL)
+		return true;
+
+	char* p = rec->_payload;
+	const char* end = p + LOG_RECORD_PAYLOAD;
+	if (rt == LRT_RAW_DYN)
+		logfmt::StrCodec::encode_str(p, end, pattern, lenPat);
+	if (rt == LRT_RAW_CAT || rt == LRT_RAW_DYN)
+		logfmt::StrCodec::encode_str(p, end, catName, lenCat);
+	memcpy(p, message, lenMsg);
+	p += lenMsg;
+
+	rec->_type = (uint8_t)rt;
+	rec->_level = (uint8_t)ll;
+	rec->_len = (uint16_t)(p - rec->_payload);
+	commit_record();
+	return true;
+}
+
+void WTSLogger::log_imp(SpdLoggerPtr logger, WTSLogLevel ll, const char* message, int64_t ts)
+{
+	//用调用时的时间输出
+	spdlog::log_clock::time_point tp(std::chrono::duration_cast<spdlog::log_clock::duration>(std::chrono::nanoseconds(ts)));
+	spdlog::level::level_enum lvl = ll_to_level(ll);
+	if (logger)
+		logger->log(tp, spdlog::source_loc{}, lvl, message);
+
+	if (logger != m_rootLogger)
+		m_rootLogger->log(tp, spdlog::source_loc{}, lvl, message);
+
+	if (m_logHandler)
+		m_logHandler->handleLogAppend(ll, message);
+}
+
+void WTSLogger::dispatch_record(LogRecord& rec, fmt::memory_buffer& buf)
+{
+	buf.clear();
+	const char* p = rec._payload;
+	const char* end = p + rec._len;
+	SpdLoggerPtr logger = m_rootLogger;
+	switch (rec._type)
+	{
+	case LRT_FORMAT:
+		{
+			fmt::string_view format = logfmt::StrCodec::decode(p);
+			try
+			{
+				rec._formatter(buf, format, p);
+			}
+			catch (const std::exception& e)
+			{
+				//格式串有问题,原样输出,同步模式下会直接抛出异常
+				buf.clear();
+				fmt::format_to(std::back_inserter(buf), "{} [format error: {}]", format, e.what());
+			}
+		}
+		break;
+	case LRT_RAW_DYN:
+		{
+			fmt::string_view pat = logfmt::StrCodec::decode(p);
+			fmt::string_view cat = logfmt::StrCodec::decode(p);
+			logger = getLogger(std::string(cat.data(), cat.size()).c_str(), std::string(pat.data(), pat.size()).c_str());
+			buf.append(p, end);
+		}
+		break;
+	case LRT_RAW_CAT:
+		{
+			fmt::string_view cat = logfmt::StrCodec::decode(p);
+			logger = getLogger(std::string(cat.data(), cat.size()).c_str());
+			buf.append(p, end);
+		}
+		break;
+	default:
+		buf.append(p, end);
+		break;
+	}
+
+	if (logger == NULL)
+		logger = m_rootLogger;
+
+	buf.push_back('\0');
+	log_imp(logger, (WTSLogLevel)rec._level, buf.data(), rec._time);
+}
+
+void WTSLogger::deferred_loop()
+{
+	fmt::memory_buffer buf;
+	std::vector<LogQueuePtr> queues;
+	uint32_t queueVer = UINT32_MAX;
+	uint64_t lastDropped = 0;
+	for (;;)
+	{
+		if (queueVer != g_uQueueVer)
+		{
+			StdUniqueLock lock(g_mtxQueues);
+			queueVer = g_uQueueVer;
+			queues = g_allQueues;
+		}
+
+		uint32_t cnt = 0;
+		bool bHasOrphan = false;
+		for (LogQueuePtr& queue : queues)
+		{
+			cnt += queue->_ring.drain([&buf](LogRecord& rec) {
+				dispatch_record(rec, buf);
+			}, 1024);
+
+			if (queue->_orphan && queue->_ring.empty())
+				bHasOrphan = true;
+		}
+
+		//退出的线程的队列处理完了就移除
+		if (bHasOrphan)
+		{
+			StdUniqueLock lock(g_mtxQueues);
+			for (auto it = g_allQueues.begin(); it != g_allQueues.end();)
+			{
+				LogQueuePtr& queue = *it;
+				if (queue->_orphan && queue->_ring.empty())
+				{
+					g_uDropped += queue->_dropped;
+					it = g_allQueues.erase(it);
+				}
+				else
+					it++;
+			}
+			g_uQueueVer++;
+		}
+
+		uint64_t dropped = getDroppedCount();
+		if (dropped != lastDropped)
+		{
+			fmt::format_to(std::back_inserter(buf), "{} log records dropped because of full queues", dropped - lastDropped);
+			buf.push_back('\0');
+			log_imp(m_rootLogger, LL_WARN, buf.data(), std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+			buf.clear();
+			lastDropped = dropped;
+		}
+
+		if (cnt == 0)
+		{
+			//停止的时候要把队列里的都处理完
+			if (g_bDeferredStop)
+				break;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+void WTSLogger::enableDeferred(bool bEnabled, uint32_t queueSize /* = 4096 */, bool bBlockWhenFull /* = false */)
+{
+	if (bEnabled)
+	{
+		if (!m_bInited || m_bStopped || g_thrdDeferred)
+			return;
+
+		g_uQueueSize = queueSize;
+		g_bBlockWhenFull = bBlockWhenFull;
+		g_bDeferredStop = false;
+		g_thrdDeferred.reset(new StdThread(deferred_loop));
+		m_bDeferred = true;
+
+		//spdlog的注册表这时已经构造好了,退出回调会在它析构之前执行
+		if (!g_bExitHooked)
+		{
+			std::atexit(on_process_exit);
+			g_bExitHooked = true;
+		}
+	}
+	else
+	{
+		if (!g_thrdDeferred)
+			return;
+
+		m_bDeferred = false;
+		g_bDeferredStop = true;
+		g_thrdDeferred->join();
+		g_thrdDeferred.reset();
+
+		StdUniqueLock lock(g_mtxQueues);
+		for (const LogQueuePtr& queue : g_allQueues)
+			g_uDropped += queue->_dropped;
+		g_allQueues.clear();
+		g_uQueueVer++;
+		g_uGeneration++;
+	}
+}
+
+uint64_t WTSLogger::getDroppedCount()
+{
+	StdUniqueLock lock(g_mtxQueues);
+	uint64_t ret = g_uDropped;
+	for (const LogQueuePtr& queue : g_allQueues)
+		ret += queue->_dropped;
+	return ret;
 }
\ No newline at end of file
@@ -11,7 +11,9 @@
 #include "../Includes/WTSTypes.h"
 #include "../Includes/WTSCollection.hpp"
 #include "../Share/fmtlib.h"
+#include "WTSLogRecord.h"
 
+#include <atomic>
 #include <memory>
 #include <sstream>
 #include <thread>
@@ -48,6 +50,46 @@ private:
 
 	static void print_message(const char* buffer);
 
+	/*
+	 *	延迟格式化模式
+	 *	调用线程只把格式串和参数的原始字节写到自己的单生产者环形队列里,格式化和输出都在后台线程完成
+	 *	队列满了按配置丢弃并计数,或者等待后台线程腾出空间
+	 *	有不支持编码的参数,或者编码以后放不下的,退回到原来的同步流程
+	 */
+	template<typename... Args>
+	static bool post_format(WTSLogLevel ll, const char* format, const Args& ...args)
+	{
+		if constexpr (!logfmt::Supported<Args...>::value)
+		{
+			return false;
+		}
+		else
+		{
+			LogRecord* rec = alloc_record();
+			//队列满了并且配置为丢弃,已经计数了
+			if (rec == NULL)
+				return true;
+
+			if (!logfmt::encode(*rec, format, args...))
+				return false;
+
+			rec->_type = LRT_FORMAT;
+			rec->_level = (uint8_t)ll;
+			rec->_formatter = &logfmt::format<Args...>;
+			commit_record();
+			return true;
+		}
+	}
+
+	static bool post_raw(LogRecordType rt, WTSLogLevel ll, const char* message, const char* catName = "", const char* pattern = "");
+
+	static LogRecord* alloc_record();
+	static void commit_record();
+
+	static void deferred_loop();
+	static void dispatch_record(LogRecord& rec, fmt::memory_buffer& buf);
+	static void log_imp(SpdLoggerPtr logger, WTSLogLevel ll, const char* message, int64_t ts);
+
 public:
 	/*
 	 *	直接输出
@@ -64,6 +106,12 @@ public:
 	 */
 	static void log_dyn_raw(const char* patttern, const char* catName, WTSLogLevel ll, const char* message);
 
+	/*
+	 *	动态分类实际生效的日志级别
+	 *	log_dyn只检查了全局级别,热点路径上可以先用这个判断,避免格式化以后又被丢弃
+	 */
+	static WTSLogLevel get_dyn_level(const char* patttern, const char* catName);
+
 
 //////////////////////////////////////////////////////////////////////////
 //fmt::format风格接口
@@ -74,6 +122,9 @@ public:
 		if (m_logLevel > LL_DEBUG || m_bStopped)
 			return;
 
+		if (m_bDeferred && post_format(LL_DEBUG, format, args...))
+			return;
+
 		fmtutil::format_to(m_buffer, format, args...);
 
 		if (!m_bInited)
@@ -89,6 +140,9 @@ public:
 	static void info(const char* format, const Args& ...args)
 	{
 		if (m_logLevel > LL_INFO || m_bStopped)
+			return;
+
+		if (m_bDeferred && post_format(LL_INFO, format, args...))
 			return;
 
 		fmtutil::format_to(m_buffer, format, args...);
@@ -108,6 +162,9 @@ public:
 		if (m_logLevel > LL_WARN || m_bStopped)
 			return;
 
+		if (m_bDeferred && post_format(LL_WARN, format, args...))
+			return;
+
 		fmtutil::format_to(m_buffer, format, args...);
 
 		if (!m_bInited)
@@ -123,6 +180,9 @@ public:
 	static void error(const char* format, const Args& ...args)
 	{
 		if (m_logLevel > LL_ERROR || m_bStopped)
+			return;
+
+		if (m_bDeferred && post_format(LL_ERROR, format, args...))
 			return;
 
 		fmtutil::format_to(m_buffer, format, args...);
@@ -142,6 +202,9 @@ public:
 		if (m_logLevel > LL_FATAL || m_bStopped)
 			return;
 
+		if (m_bDeferred && post_format(LL_FATAL, format, args...))
+			return;
+
 		fmtutil::format_to(m_buffer, format, args...);
 
 		if (!m_bInited)
@@ -157,6 +220,9 @@ public:
 	static void log(WTSLogLevel ll, const char* format, const Args& ...args)
 	{
 		if (m_logLevel > ll || m_bStopped)
+			return;
+
+		if (m_bDeferred && post_format(ll, format, args...))
 			return;
 
 		fmtutil::format_to(m_buffer, format, args...);
@@ -224,10 +290,25 @@ public:
 
 	static void freeAllDynLoggers();
 
+	/*
+	 *	开启或关闭延迟格式化模式
+	 *	调用线程只把参数拷贝到自己的队列里,由后台线程格式化和输出
+	 *	参数不支持或者放不下的日志仍然在调用线程上直接输出,所以可能比队列里更早的日志先输出
+	 *	@queueSize		每个线程的队列长度,重新开启以后生效
+	 *	@bBlockWhenFull	队列满了是否等待,否则丢弃并计数
+	 */
+	static void enableDeferred(bool bEnabled, uint32_t queueSize = 4096, bool bBlockWhenFull = false);
+
+	/*
+	 *	延迟格式化模式下因为队列满了丢弃的日志条数
+	 */
+	static uint64_t getDroppedCount();
+
 private:
 	static bool					m_bInited;
 	static bool					m_bTpInited;
 	static bool					m_bStopped;
+	static std::atomic<bool>	m_bDeferred;
 	static ILogHandler*			m_logHandler;
 	static WTSLogLevel			m_logLevel;
 
@@ -87,6 +87,8 @@ public:
 
 	inline bool has_error() const { return _errno != MDB_SUCCESS; }
 
+	inline int last_error() const { return _errno; }
+
 	inline bool is_readonly() const { return _readonly; }
 
 	inline const char* errmsg()
@@ -151,7 +153,11 @@ public:
 		return put_and_commit((void*)key.data(), key.size(), (void*)val.data(), val.size());
 	}
 
-	bool put(void* key, std::size_t klen, void* val, std::size_t vlen)
+	/*
+	 *	写入数据
+	 *	@flags	mdb_put的标记,如MDB_APPEND,key比库里已有的都大的时候可以直接追加到末尾
+	 */
+	bool put(void* key, std::size_t klen, void* val, std::size_t vlen, unsigned int flags = 0)
 	{
 		MDB_val mKey, mData;
 		mKey.mv_data = key;
@@ -159,7 +165,7 @@ public:
 
 		mData.mv_data = val;
 		mData.mv_size = vlen;
-		int _errno = mdb_put(_txn, _dbi, &mKey, &mData, 0);
+		int _errno = mdb_put(_txn, _dbi, &mKey, &mData, flags);
 		_db.update_errno(_errno);
 		return (_errno == MDB_SUCCESS);
 	}
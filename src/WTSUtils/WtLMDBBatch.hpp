@@ -0,0 +1,416 @@
+﻿/*!
+ * \file WtLMDBBatch.hpp
+ * \project	WonderTrader
+ *
+ * \brief LMDB批量写入
+ */
+#pragma once
+#include "WtLMDB.hpp"
+#include "../Share/StdUtils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+
+NS_WTP_BEGIN
+
+/*
+ *	一批待写入的数据
+ *	key和value依次拼接在一块连续的缓存里,避免每条记录单独分配内存
+ */
+class WtLMDBBatch
+{
+private:
+	typedef struct _RecHeader
+	{
+		uint32_t	_klen;
+		uint32_t	_vlen;
+	} RecHeader;
+
+public:
+	inline void add(const void* key, std::size_t klen, const void* val, std::size_t vlen)
+	{
+		_offsets.emplace_back((uint32_t)_buffer.size());
+		RecHeader header = { (uint32_t)klen, (uint32_t)vlen };
+		_buffer.append((const char*)&header, sizeof(RecHeader));
+		_buffer.append((const char*)key, klen);
+		_buffer.append((const char*)val, vlen);
+	}
+
+	inline std::size_t size() const { return _offsets.size(); }
+	inline bool empty() const { return _offsets.empty(); }
+	inline std::size_t bytes() const { return _buffer.size(); }
+
+	inline void clear()
+	{
+		_buffer.clear();
+		_offsets.clear();
+	}
+
+	inline void swap(WtLMDBBatch& right)
+	{
+		_buffer.swap(right._buffer);
+		_offsets.swap(right._offsets);
+	}
+
+	/*
+	 *	按照LMDB默认的key顺序排序
+	 *	稳定排序,同一个key后写入的还是在后面,写入以后的结果和不排序一样
+	 */
+	inline void sort()
+	{
+		const char* base = _buffer.data();
+		std::stable_sort(_offsets.begin(), _offsets.end(), [base](uint32_t a, uint32_t b) {
+			const RecHeader* ha = (const RecHeader*)(base + a);
+			const RecHeader* hb = (const RecHeader*)(base + b);
+			int ret = memcmp(ha + 1, hb + 1, std::min(ha->_klen, hb->_klen));
+			return ret < 0 || (ret == 0 && ha->_klen < hb->_klen);
+		});
+	}
+
+	/*
+	 *	在一个事务里写入整批数据
+	 *	@bAppend	key是否递增,递增的用MDB_APPEND直接追加,不满足追加条件的记录退回到普通写入
+	 *
+	 *	返回值	全部写入并提交成功返回true,失败则整批回滚,错误信息从db里获取
+	 */
+	bool write(WtLMDB& db, bool bAppend = false)
+	{
+		if (empty())
+			return true;
+
+		WtLMDBQuery query(db);
+		if (db.has_error())
+			return false;
+
+		char* base = (char*)_buffer.data();
+		for (uint32_t offset : _offsets)
+		{
+			if (!put_record(query, db, base + offset, bAppend))
+			{
+				int error = db.last_error();
+				query.rollback();
+				db.update_errno(error);
+				return false;
+			}
+		}
+
+		query.commit();
+		return !db.has_error();
+	}
+
+	/*
+	 *	逐条写入,每条记录一个事务
+	 *	整批提交失败以后用来重试,这样只有出错的记录会丢掉
+	 *
+	 *	返回值	写入失败的记录条数,最后一次的错误信息从db里获取
+	 */
+	uint32_t write_each(WtLMDB& db, bool bAppend = false)
+	{
+		uint32_t failed = 0;
+		int lastError = MDB_SUCCESS;
+		char* base = (char*)_buffer.data();
+		for (uint32_t offset : _offsets)
+		{
+			WtLMDBQuery query(db);
+			if (db.has_error())
+			{
+				lastError = db.last_error();
+				failed++;
+				continue;
+			}
+
+			if (!put_record(query, db, base + offset, bAppend))
+			{
+				lastError = db.last_error();
+				query.rollback();
+				failed++;
+				continue;
+			}
+
+			query.commit();
+			if (db.has_error())
+			{
+				lastError = db.last_error();
+				failed++;
+			}
+		}
+
+		db.update_errno(lastError);
+		return failed;
+	}
+
+private:
+	inline static bool put_record(WtLMDBQuery& query, WtLMDB& db, char* rec, bool bAppend)
+	{
+		RecHeader* header = (RecHeader*)rec;
+		char* key = (char*)(header + 1);
+		char* val = key + header->_klen;
+		bool bSucc = query.put(key, header->_klen, val, header->_vlen, bAppend ? MDB_APPEND : 0);
+		if (!bSucc && bAppend && db.last_error() == MDB_KEYEXIST)
+			bSucc = query.put(key, header->_klen, val, header->_vlen);
+		return bSucc;
+	}
+
+private:
+	std::string				_buffer;
+	std::vector<uint32_t>	_offsets;
+};
+
+typedef std::shared_ptr<WtLMDB> WtLMDBPtr;
+
+/*
+ *	LMDB的分组提交
+ *	每个库一个写入队列,调用线程只把数据拷贝到队列里,由写线程把攒下来的数据放在一个事务里提交
+ *	攒够batchSize条或者最早的一条等待超过maxDelay毫秒就提交一次
+ *	持久化有两种模式:
+ *	sync	每次提交都落盘,和原来一样,只是落盘次数变少了
+ *	nosync	提交不落盘,由写线程每隔syncInterval毫秒统一落盘一次,进程崩溃不丢数据,机器掉电最多丢一个间隔
+ */
+class WtLMDBBatchWriter
+{
+public:
+	/*
+	 *	写入失败的回调,db为出错的库,count为最终没有写进去的记录条数,错误信息用db->errmsg()获取
+	 */
+	typedef std::function<void(WtLMDB* db, uint32_t count)> ErrorCallback;
+
+private:
+	typedef struct _DBQueue
+	{
+		WtLMDBPtr		_db;
+		bool			_append;	//key是否递增
+		StdUniqueMutex	_mtx;
+		WtLMDBBatch		_pending;	//待提交的,调用线程写入
+		WtLMDBBatch		_writing;	//正在提交的,只有写线程访问
+		int64_t			_first_time;//最早一条待提交数据的时间
+		bool			_dirty;		//nosync模式下提交以后还没有落盘
+
+		_DBQueue() :_append(false), _first_time(0), _dirty(false) {}
+	} DBQueue;
+	typedef std::shared_ptr<DBQueue> DBQueuePtr;
+
+	static inline int64_t now_ms()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+public:
+	WtLMDBBatchWriter()
+		: _batch_size(1024)
+		, _max_delay(50)
+		, _no_sync(false)
+		, _sync_interval(1000)
+		, _stopped(true)
+		, _notified(false)
+		, _commits(0)
+		, _records(0)
+	{}
+
+	~WtLMDBBatchWriter()
+	{
+		stop();
+	}
+
+public:
+	/*
+	 *	启动写线程
+	 *	@batchSize		每批最多的记录条数
+	 *	@maxDelay		数据最长等待的毫秒数
+	 *	@bNoSync		是否用nosync模式
+	 *	@syncInterval	nosync模式下落盘的间隔毫秒数
+	 */
+	void start(uint32_t batchSize = 1024, uint32_t maxDelay = 50, bool bNoSync = false, uint32_t syncInterval = 1000)
+	{
+		if (_worker)
+			return;
+
+		_batch_size = std::max(batchSize, 1U);
+		_max_delay = std::max(maxDelay, 1U);
+		_no_sync = bNoSync;
+		_sync_interval = std::max(syncInterval, 1U);
+		_stopped = false;
+		_worker.reset(new StdThread([this]() { run(); }));
+	}
+
+	/*
+	 *	停止写线程,队列里剩下的数据都会提交并落盘
+	 */
+	void stop()
+	{
+		if (!_worker)
+			return;
+
+		{
+			StdUniqueLock lock(_mtx_signal);
+			_stopped = true;
+			_notified = true;
+		}
+		_cond.notify_all();
+		_worker->join();
+		_worker.reset();
+	}
+
+	inline void set_error_callback(ErrorCallback cb) { _err_cb = cb; }
+
+	inline bool is_running() const { return _worker != NULL; }
+
+	/*
+	 *	写入一条数据,只是放入队列
+	 *	@bAppend	这个库的key是否递增,以第一次写入时为准
+	 */
+	void put(const WtLMDBPtr& db, const void* key, std::size_t klen, const void* val, std::size_t vlen, bool bAppend = false)
+	{
+		DBQueue* queue = get_queue(db, bAppend);
+
+		bool bFull = false;
+		{
+			StdUniqueLock lock(queue->_mtx);
+			if (queue->_pending.empty())
+				queue->_first_time = now_ms();
+			queue->_pending.add(key, klen, val, vlen);
+			bFull = (queue->_pending.size() == _batch_size);
+		}
+
+		if (bFull)
+		{
+			StdUniqueLock lock(_mtx_signal);
+			_notified = true;
+			_cond.notify_all();
+		}
+	}
+
+	/*
+	 *	已经提交的事务数和记录数
+	 */
+	inline uint64_t commits() const { return _commits; }
+	inline uint64_t records() const { return _records; }
+
+private:
+	DBQueue* get_queue(const WtLMDBPtr& db, bool bAppend)
+	{
+		StdUniqueLock lock(_mtx_queues);
+		auto it = _queue_map.find(db.get());
+		if (it != _queue_map.end())
+			return it->second.get();
+
+		DBQueuePtr queue(new DBQueue);
+		queue->_db = db;
+		queue->_append = bAppend;
+		if (_no_sync)
+			mdb_env_set_flags(db->env(), MDB_NOSYNC, 1);
+
+		_queue_map[db.get()] = queue;
+		_queues.emplace_back(queue);
+		return queue.get();
+	}
+
+	void flush(DBQueue& queue)
+	{
+		{
+			StdUniqueLock lock(queue._mtx);
+			queue._writing.swap(queue._pending);
+		}
+
+		if (queue._writing.empty())
+			return;
+
+		//多个合约共用的库key不是递增的,排序以后再写,B树的页面访问更集中
+		if (!queue._append)
+			queue._writing.sort();
+
+		uint32_t cnt = (uint32_t)queue._writing.size();
+		if (queue._writing.write(*queue._db, queue._append))
+		{
+			_commits++;
+			_records += cnt;
+			queue._dirty = _no_sync;
+		}
+		else
+		{
+			//整批回滚了,逐条重试,只丢掉写不进去的那几条
+			uint32_t failed = queue._writing.write_each(*queue._db, queue._append);
+			_commits += cnt - failed;
+			_records += cnt - failed;
+			queue._dirty = _no_sync;
+			if (failed > 0 && _err_cb)
+				_err_cb(queue._db.get(), failed);
+		}
+		queue._writing.clear();
+	}
+
+	void run()
+	{
+		std::vector<DBQueuePtr> queues;
+		int64_t lastSync = now_ms();
+		for (;;)
+		{
+			bool bStopped = false;
+			{
+				StdUniqueLock lock(_mtx_signal);
+				if (!_notified)
+					_cond.wait_for(lock, std::chrono::milliseconds(std::min(_max_delay, _sync_interval)));
+				_notified = false;
+				bStopped = _stopped;
+			}
+
+			{
+				StdUniqueLock lock(_mtx_queues);
+				queues = _queues;
+			}
+
+			int64_t now = now_ms();
+			for (DBQueuePtr& queue : queues)
+			{
+				bool bReady = false;
+				{
+					StdUniqueLock lock(queue->_mtx);
+					std::size_t cnt = queue->_pending.size();
+					bReady = (cnt > 0) && (bStopped || cnt >= _batch_size || now - queue->_first_time >= _max_delay);
+				}
+
+				if (bReady)
+					flush(*queue);
+			}
+
+			if (_no_sync && (bStopped || now - lastSync >= _sync_interval))
+			{
+				for (DBQueuePtr& queue : queues)
+				{
+					if (!queue->_dirty)
+						continue;
+
+					mdb_env_sync(queue->_db->env(), 1);
+					queue->_dirty = false;
+				}
+				lastSync = now;
+			}
+
+			if (bStopped)
+				break;
+		}
+	}
+
+private:
+	uint32_t		_batch_size;
+	uint32_t		_max_delay;
+	bool			_no_sync;
+	uint32_t		_sync_interval;
+	ErrorCallback	_err_cb;
+
+	StdUniqueMutex	_mtx_queues;
+	std::vector<DBQueuePtr>	_queues;
+	std::unordered_map<WtLMDB*, DBQueuePtr>	_queue_map;
+
+	StdThreadPtr	_worker;
+	StdUniqueMutex	_mtx_signal;
+	StdCondVariable	_cond;
+	bool			_stopped;
+	bool			_notified;
+
+	std::atomic<uint64_t>	_commits;
+	std::atomic<uint64_t>	_records;
+};
+
+NS_WTP_END
@@ -0,0 +1,68 @@
+﻿/*!
+ * \file WtLMDBPool.hpp
+ * \project	WonderTrader
+ *
+ * \brief 按key缓存打开的LMDB数据库
+ */
+#pragma once
+#include "WtLMDB.hpp"
+#include "../Includes/FasterDefs.h"
+#include "../Share/StdUtils.hpp"
+
+#include <memory>
+
+NS_WTP_BEGIN
+
+/*
+ *	读取模块按交易所或者合约打开数据库,打开以后缓存起来
+ *	回测的时候预读线程和回放线程会同时读取,缓存的查找和插入都在锁里
+ *	返回的是共享指针的拷贝,缓存里的不会被移走
+ */
+class WtLMDBPool
+{
+public:
+	typedef std::shared_ptr<WtLMDB> WtLMDBPtr;
+
+	WtLMDBPool(bool bReadOnly = true) :_readonly(bReadOnly) {}
+
+	/*
+	 *	获取key对应的数据库,第一次获取的时候打开path
+	 *	path不存在或者打开失败返回空指针,打开失败的原因放在errmsg里
+	 *	bOpened	这一次是否新打开了数据库,调用方用来输出日志
+	 */
+	inline WtLMDBPtr get(const std::string& key, const std::string& path, std::string& errmsg, bool& bOpened)
+	{
+		bOpened = false;
+		StdUniqueLock lock(_mtx);
+		auto it = _dbs.find(key);
+		if (it != _dbs.end())
+			return it->second;
+
+		if (!StdFile::exists(path.c_str()))
+			return WtLMDBPtr();
+
+		WtLMDBPtr dbPtr(new WtLMDB(_readonly));
+		if (!dbPtr->open(path.c_str()))
+		{
+			errmsg = dbPtr->errmsg();
+			return WtLMDBPtr();
+		}
+
+		_dbs[key] = dbPtr;
+		bOpened = true;
+		return dbPtr;
+	}
+
+	inline std::size_t size()
+	{
+		StdUniqueLock lock(_mtx);
+		return _dbs.size();
+	}
+
+private:
+	bool			_readonly;
+	StdUniqueMutex	_mtx;
+	wt_hashmap<std::string, WtLMDBPtr>	_dbs;
+};
+
+NS_WTP_END
@@ -0,0 +1,145 @@
+﻿/*!
+ * \file BenchData.hpp
+ * \project	WonderTrader
+ *
+ * \brief 基准测试用的合成数据,固定随机种子,每次生成的数据都一样
+ */
+#pragma once
+#include "../Includes/WTSDataDef.hpp"
+#include "../Includes/WTSSessionInfo.hpp"
+#include "../Share/TimeUtils.hpp"
+
+#include <vector>
+#include <algorithm>
+
+USING_NS_WTP;
+
+namespace benchdata
+{
+	/*
+	 *	线性同余随机数,跨平台结果一致
+	 */
+	class BenchRandom
+	{
+	public:
+		BenchRandom(uint32_t seed = 20231117) :_seed(seed) {}
+
+		inline uint32_t next()
+		{
+			_seed = _seed * 1103515245 + 12345;
+			return _seed >> 8;
+		}
+
+	private:
+		uint32_t _seed;
+	};
+
+	/*
+	 *	带夜盘的交易时间模板,夜盘跨零点,和螺纹钢一样
+	 */
+	inline WTSSessionInfo* make_session()
+	{
+		WTSSessionInfo* sInfo = WTSSessionInfo::create("FN0230", "FN0230", 300);
+		sInfo->setAuctionTime(2059, 2100);
+		sInfo->addTradingSection(2100, 230);
+		sInfo->addTradingSection(900, 1015);
+		sInfo->addTradingSection(1030, 1130);
+		sInfo->addTradingSection(1330, 1500);
+		return sInfo;
+	}
+
+	/*
+	 *	下一个交易日,只跳过周末
+	 */
+	inline uint32_t next_tdate(uint32_t uDate)
+	{
+		uint32_t wd = TimeUtils::getWeekDay(uDate);
+		return TimeUtils::getNextDate(uDate, (wd == 5) ? 3 : ((wd == 6) ? 2 : 1));
+	}
+
+	/*
+	 *	按交易时间模板生成分钟线
+	 *	夜盘的日期是上一个交易日的夜里,过了零点要再加一天
+	 */
+	inline void make_bars(WTSSessionInfo* sInfo, uint32_t startDate, uint32_t days, std::vector<WTSBarStruct>& bars)
+	{
+		BenchRandom rnd;
+		uint32_t totalMins = sInfo->getTradingMins();
+		uint32_t prevDate = startDate;
+		uint32_t curDate = next_tdate(prevDate);
+		double price = 3000;
+		double hold = 100000;
+		for (uint32_t d = 0; d < days; d++)
+		{
+			for (uint32_t m = 1; m <= totalMins; m++)
+			{
+				uint32_t hhmm = sInfo->minuteToTime(m);
+				uint32_t actDate = curDate;
+				if (hhmm >= 2100)
+					actDate = prevDate;
+				else if (hhmm <= 230)
+					actDate = TimeUtils::getNextDate(prevDate);
+
+				uint32_t r = rnd.next();
+				WTSBarStruct bar;
+				bar.date = curDate;
+				bar.time = TimeUtils::timeToMinBar(actDate, hhmm);
+				bar.open = price;
+				price += (double)(r % 21) - 10;
+				bar.close = price;
+				bar.high = std::max(bar.open, bar.close) + (r >> 5) % 5;
+				bar.low = std::min(bar.open, bar.close) - (r >> 8) % 5;
+				bar.settle = 0;
+				bar.vol = (r >> 4) % 1000 + 1;
+				bar.money = bar.vol * price * 10;
+				bar.add = (double)((r >> 10) % 201) - 100;
+				hold += bar.add;
+				bar.hold = hold;
+				bars.emplace_back(bar);
+			}
+
+			prevDate = curDate;
+			curDate = next_tdate(curDate);
+		}
+	}
+
+	/*
+	 *	生成一个交易日白盘的tick,每500毫秒一笔,带5档盘口,价格随机游走
+	 */
+	inline void make_ticks(const char* stdCode, uint32_t uDate, uint32_t count, std::vector<WTSTickStruct>& ticks)
+	{
+		BenchRandom rnd;
+		double price = 3000;
+		double volume = 0;
+		uint32_t secs = 9 * 3600;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t r = rnd.next();
+			price += (double)(r % 5) - 2;
+			double vol = (r >> 4) % 50 + 1;
+			volume += vol;
+
+			WTSTickStruct tick;
+			strcpy(tick.code, stdCode);
+			tick.trading_date = uDate;
+			tick.action_date = uDate;
+			uint32_t curSecs = secs + i / 2;
+			tick.action_time = (curSecs / 3600 * 10000 + curSecs % 3600 / 60 * 100 + curSecs % 60) * 1000 + (i % 2) * 500;
+			tick.price = price;
+			tick.open = 3000;
+			tick.low = (i == 0) ? price : std::min(ticks.back().low, price);
+			tick.high = (i == 0) ? price : std::max(ticks.back().high, price);
+			tick.volume = vol;
+			tick.total_volume = volume;
+			tick.open_interest = 100000;
+			for (uint32_t j = 0; j < 5; j++)
+			{
+				tick.bid_prices[j] = price - 1 - j;
+				tick.ask_prices[j] = price + 1 + j;
+				tick.bid_qty[j] = (r >> (j + 2)) % 100 + 1;
+				tick.ask_qty[j] = (r >> (j + 7)) % 100 + 1;
+			}
+			ticks.emplace_back(tick);
+		}
+	}
+}
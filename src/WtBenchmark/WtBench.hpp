@@ -0,0 +1,656 @@
+﻿/*!
+ * \file WtBench.hpp
+ * \project	WonderTrader
+ *
+ * \brief 微基准测试的框架,用法和google benchmark一致
+ *
+ *	WT_BENCHMARK(bm_xxx)->arg(1024)->threads(4);
+ *	static void bm_xxx(BenchState& state)
+ *	{
+ *		//准备数据,不计时
+ *		for (auto _ : state)
+ *		{
+ *			//被测试的代码
+ *		}
+ *		state.set_items_processed(state.iterations());
+ *	}
+ *
+ *	迭代次数自动校准,每个用例重复多次取中位数
+ *	结果可以输出成json,字段和google benchmark保持一致,可以直接用它的compare.py比较两次构建的结果
+ *	也可以用--baseline指定上一次输出的json,直接打印耗时的变化
+ */
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Share/fmtlib.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//循环变量_没有用到,不加的话gcc会报警告
+#if defined(__GNUC__) || defined(__clang__)
+#define WT_BENCH_UNUSED __attribute__((unused))
+#else
+#define WT_BENCH_UNUSED
+#endif
+
+namespace wtbench
+{
+	/*
+	 *	防止编译器把被测试的代码优化掉
+	 */
+	template<typename T>
+	inline void do_not_optimize(T const& value)
+	{
+#ifdef _MSC_VER
+		static const void* volatile _sink;
+		_sink = &value;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "r,m"(value) : "memory");
+#endif
+	}
+
+	inline void clobber_memory()
+	{
+#ifdef _MSC_VER
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : : "memory");
+#endif
+	}
+
+	inline int64_t now_ns()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/*
+	 *	多线程用例的起跑线,所有线程都准备好了以后一起开始计时
+	 */
+	class BenchBarrier
+	{
+	public:
+		BenchBarrier(uint32_t cnt) :_count(cnt), _arrived(0) {}
+
+		inline void wait()
+		{
+			_arrived++;
+			while (_arrived.load(std::memory_order_acquire) < _count)
+				std::this_thread::yield();
+		}
+
+	private:
+		uint32_t				_count;
+		std::atomic<uint32_t>	_arrived;
+	};
+
+	class BenchState
+	{
+	public:
+		struct WT_BENCH_UNUSED Value {};
+
+		/*
+		 *	for(auto _ : state)用的迭代器,循环结束的时候停止计时
+		 */
+		class Iterator
+		{
+		public:
+			Iterator(BenchState* state, uint64_t left) :_state(state), _left(left) {}
+
+			inline bool operator!=(const Iterator&)
+			{
+				if (_left != 0)
+					return true;
+
+				_state->finish();
+				return false;
+			}
+
+			inline Iterator& operator++() { --_left; return *this; }
+			inline Value operator*() const { return Value(); }
+
+		private:
+			BenchState*	_state;
+			uint64_t	_left;
+		};
+
+	public:
+		BenchState(uint64_t iters, int64_t arg, uint32_t threads, uint32_t idx, BenchBarrier* barrier)
+			: _iterations(iters), _arg(arg), _threads(threads), _thread_idx(idx), _barrier(barrier)
+			, _start(0), _elapsed(0), _items(0), _bytes(0), _finished(false)
+		{}
+
+		inline Iterator begin()
+		{
+			if (_barrier)
+				_barrier->wait();
+			_start = now_ns();
+			return Iterator(this, _iterations);
+		}
+
+		inline Iterator end() { return Iterator(this, 0); }
+
+		/*
+		 *	暂停计时,循环体里每次迭代要重新准备数据的时候用
+		 */
+		inline void pause_timing() { _elapsed += now_ns() - _start; }
+		inline void resume_timing() { _start = now_ns(); }
+
+		inline uint64_t iterations() const { return _iterations; }
+		inline int64_t	arg() const { return _arg; }
+		inline uint32_t threads() const { return _threads; }
+		inline uint32_t thread_index() const { return _thread_idx; }
+
+		inline void set_items_processed(uint64_t items) { _items = items; }
+		inline void set_bytes_processed(uint64_t bytes) { _bytes = bytes; }
+		inline void set_label(const std::string& label) { _label = label; }
+
+		/*
+		 *	准备数据失败的时候调用,用例会被标记为出错,不用再进入循环
+		 *	多线程的时候也要到起跑线报到,不然其他线程会一直等着
+		 */
+		inline void skip_with_error(const std::string& msg)
+		{
+			_error = msg;
+			if (_barrier)
+				_barrier->wait();
+		}
+
+		inline int64_t elapsed() const { return _elapsed; }
+		inline uint64_t items() const { return _items; }
+		inline uint64_t bytes() const { return _bytes; }
+		inline const std::string& label() const { return _label; }
+		inline const std::string& error() const { return _error; }
+		inline bool	finished() const { return _finished; }
+
+	private:
+		inline void finish()
+		{
+			_elapsed += now_ns() - _start;
+			_finished = true;
+		}
+
+	private:
+		uint64_t		_iterations;
+		int64_t			_arg;
+		uint32_t		_threads;
+		uint32_t		_thread_idx;
+		BenchBarrier*	_barrier;
+
+		int64_t			_start;
+		int64_t			_elapsed;
+		uint64_t		_items;
+		uint64_t		_bytes;
+		std::string		_label;
+		std::string		_error;
+		bool			_finished;
+	};
+
+	typedef std::function<void(BenchState&)> BenchFunc;
+
+	class BenchCase
+	{
+	public:
+		BenchCase(const char* name, BenchFunc func) :_name(name), _func(func), _iterations(0), _min_time(0) {}
+
+		/*
+		 *	每个参数单独跑一次,用例里用state.arg()获取
+		 */
+		inline BenchCase* arg(int64_t a) { _args.emplace_back(a); return this; }
+
+		/*
+		 *	用多少个线程同时跑,每个线程数单独跑一次
+		 */
+		inline BenchCase* threads(uint32_t n) { _threads.emplace_back(std::max(n, 1U)); return this; }
+
+		/*
+		 *	固定迭代次数,不做校准,单次迭代很慢的用例用
+		 */
+		inline BenchCase* iterations(uint64_t n) { _iterations = n; return this; }
+
+		/*
+		 *	校准时每次运行的最短时间,单位秒,不设置就用命令行的参数
+		 */
+		inline BenchCase* min_time(double secs) { _min_time = secs; return this; }
+
+	public:
+		std::string				_name;
+		BenchFunc				_func;
+		std::vector<int64_t>	_args;
+		std::vector<uint32_t>	_threads;
+		uint64_t				_iterations;
+		double					_min_time;
+	};
+
+	typedef std::shared_ptr<BenchCase> BenchCasePtr;
+
+	/*
+	 *	一个用例一组参数的运行结果,重复多次取中位数
+	 */
+	typedef struct _BenchResult
+	{
+		std::string	_name;
+		uint32_t	_threads;
+		uint32_t	_repetitions;
+		uint64_t	_iterations;
+		double		_real_time;	//每次迭代的耗时,纳秒
+		double		_cpu_time;	//每次迭代占用的CPU时间,纳秒,多线程的时候是所有线程的合计
+		double		_min_time;
+		double		_max_time;
+		double		_items_rate;//每秒处理的条数,没有设置为0
+		double		_bytes_rate;//每秒处理的字节数,没有设置为0
+		std::string	_label;
+		std::string	_error;
+	} BenchResult;
+
+	typedef struct _BenchOptions
+	{
+		std::string	_filter;
+		std::string	_json;
+		std::string	_baseline;
+		double		_min_time;
+		uint32_t	_repetitions;
+		bool		_list;
+
+		_BenchOptions() :_min_time(0.5), _repetitions(3), _list(false) {}
+	} BenchOptions;
+
+	class BenchRegistry
+	{
+	private:
+		static std::vector<BenchCasePtr>& cases()
+		{
+			static std::vector<BenchCasePtr> _cases;
+			return _cases;
+		}
+
+		typedef struct _RunOnce
+		{
+			int64_t		_real;
+			int64_t		_cpu;
+			uint64_t	_items;
+			uint64_t	_bytes;
+			std::string	_label;
+			std::string	_error;
+		} RunOnce;
+
+		static RunOnce run_once(BenchCase& bc, uint64_t iters, int64_t arg, uint32_t threads)
+		{
+			RunOnce ret = { 0, 0, 0, 0, "", "" };
+
+			std::vector<std::unique_ptr<BenchState>> states;
+			std::unique_ptr<BenchBarrier> barrier(threads > 1 ? new BenchBarrier(threads) : NULL);
+			for (uint32_t i = 0; i < threads; i++)
+				states.emplace_back(new BenchState(iters, arg, threads, i, barrier.get()));
+
+			std::clock_t cpuStart = std::clock();
+			if (threads == 1)
+			{
+				bc._func(*states[0]);
+			}
+			else
+			{
+				std::vector<std::thread> workers;
+				for (uint32_t i = 0; i < threads; i++)
+				{
+					BenchState* state = states[i].get();
+					workers.emplace_back([&bc, state]() { bc._func(*state); });
+				}
+				for (std::thread& t : workers)
+					t.join();
+			}
+			ret._cpu = (int64_t)((std::clock() - cpuStart) * (1e9 / CLOCKS_PER_SEC));
+
+			for (auto& state : states)
+			{
+				if (!state->error().empty())
+				{
+					ret._error = state->error();
+					break;
+				}
+
+				if (!state->finished())
+				{
+					ret._error = "benchmark loop not finished";
+					break;
+				}
+
+				ret._real = std::max(ret._real, state->elapsed());
+				ret._items += state->items();
+				ret._bytes += state->bytes();
+				if (ret._label.empty())
+					ret._label = state->label();
+			}
+
+			return ret;
+		}
+
+		static BenchResult run_case(BenchCase& bc, const std::string& name, int64_t arg, uint32_t threads, const BenchOptions& opts)
+		{
+			BenchResult ret;
+			ret._name = name;
+			ret._threads = threads;
+			ret._repetitions = 0;
+			ret._iterations = 0;
+			ret._real_time = ret._cpu_time = ret._min_time = ret._max_time = 0;
+			ret._items_rate = ret._bytes_rate = 0;
+
+			//校准迭代次数,让一次运行至少跑够minTime
+			uint64_t iters = bc._iterations;
+			if (iters == 0)
+			{
+				double minTime = (bc._min_time > 0 ? bc._min_time : opts._min_time) * 1e9;
+				iters = 1;
+				for (;;)
+				{
+					RunOnce r = run_once(bc, iters, arg, threads);
+					if (!r._error.empty())
+					{
+						ret._error = r._error;
+						return ret;
+					}
+
+					if (r._real >= minTime || iters >= 1000000000)
+						break;
+
+					double multiplier = minTime * 1.4 / std::max(r._real, (int64_t)1);
+					multiplier = std::min(std::max(multiplier, 2.0), 10.0);
+					iters = (uint64_t)(iters * multiplier);
+				}
+			}
+
+			std::vector<RunOnce> runs;
+			for (uint32_t i = 0; i < opts._repetitions; i++)
+			{
+				RunOnce r = run_once(bc, iters, arg, threads);
+				if (!r._error.empty())
+				{
+					ret._error = r._error;
+					return ret;
+				}
+				runs.emplace_back(r);
+			}
+
+			std::sort(runs.begin(), runs.end(), [](const RunOnce& a, const RunOnce& b) { return a._real < b._real; });
+			const RunOnce& median = runs[runs.size() / 2];
+			ret._repetitions = (uint32_t)runs.size();
+			ret._iterations = iters;
+			ret._real_time = (double)median._real / iters;
+			ret._cpu_time = (double)median._cpu / iters;
+			ret._min_time = (double)runs.front()._real / iters;
+			ret._max_time = (double)runs.back()._real / iters;
+			if (median._real > 0)
+			{
+				ret._items_rate = median._items * 1e9 / median._real;
+				ret._bytes_rate = median._bytes * 1e9 / median._real;
+			}
+			ret._label = median._label;
+			return ret;
+		}
+
+		static std::string json_escape(const std::string& s)
+		{
+			std::string ret;
+			for (char c : s)
+			{
+				switch (c)
+				{
+				case '"': ret += "\\\""; break;
+				case '\\': ret += "\\\\"; break;
+				case '\n': ret += "\\n"; break;
+				case '\t': ret += "\\t"; break;
+				default:
+					if ((unsigned char)c < 0x20)
+						ret += fmt::format("\\u{:04x}", (int)c);
+					else
+						ret += c;
+					break;
+				}
+			}
+			return ret;
+		}
+
+		/*
+		 *	输出成json,一个用例一行,方便直接diff
+		 */
+		static bool write_json(const char* filename, const char* exe, const BenchOptions& opts, const std::vector<BenchResult>& results)
+		{
+			FILE* f = fopen(filename, "w");
+			if (f == NULL)
+				return false;
+
+			char date[64];
+			time_t now = time(NULL);
+			strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+#ifdef NDEBUG
+			const char* buildType = "release";
+#else
+			const char* buildType = "debug";
+#endif
+
+			fmt::print(f, "{{\n  \"context\": {{\"date\": \"{}\", \"executable\": \"{}\", \"num_cpus\": {}, \"library_build_type\": \"{}\", \"min_time\": {}, \"repetitions\": {}}},\n  \"benchmarks\": [\n",
+				date, json_escape(exe), std::thread::hardware_concurrency(), buildType, opts._min_time, opts._repetitions);
+
+			for (std::size_t i = 0; i < results.size(); i++)
+			{
+				const BenchResult& r = results[i];
+				std::string line = fmt::format("    {{\"name\": \"{0}\", \"run_name\": \"{0}\", \"run_type\": \"aggregate\", \"aggregate_name\": \"median\", \"repetitions\": {1}, \"threads\": {2}, \"iterations\": {3}, "
+					"\"real_time\": {4:.3f}, \"cpu_time\": {5:.3f}, \"time_unit\": \"ns\", \"min_time\": {6:.3f}, \"max_time\": {7:.3f}",
+					json_escape(r._name), r._repetitions, r._threads, r._iterations, r._real_time, r._cpu_time, r._min_time, r._max_time);
+				if (r._items_rate > 0)
+					line += fmt::format(", \"items_per_second\": {:.3f}", r._items_rate);
+				if (r._bytes_rate > 0)
+					line += fmt::format(", \"bytes_per_second\": {:.3f}", r._bytes_rate);
+				if (!r._label.empty())
+					line += fmt::format(", \"label\": \"{}\"", json_escape(r._label));
+				if (!r._error.empty())
+					line += fmt::format(", \"error_occurred\": true, \"error_message\": \"{}\"", json_escape(r._error));
+				line += (i + 1 < results.size()) ? "},\n" : "}\n";
+				fputs(line.c_str(), f);
+			}
+
+			fputs("  ]\n}\n", f);
+			fclose(f);
+			return true;
+		}
+
+		static std::string human_rate(double rate, const char* unit)
+		{
+			const char* prefixes[] = { "", "k", "M", "G", "T" };
+			uint32_t idx = 0;
+			while (rate >= 1000 && idx < 4)
+			{
+				rate /= 1000;
+				idx++;
+			}
+			return fmt::format("{:.2f}{}{}/s", rate, prefixes[idx], unit);
+		}
+
+		/*
+		 *	读取之前输出的json,只取每个用例的耗时,用来和这次的结果对比
+		 *	输出的时候一个用例一行,这里按行匹配就可以了,不用引入json库
+		 */
+		static bool load_baseline(const char* filename, std::map<std::string, double>& baseline)
+		{
+			FILE* f = fopen(filename, "r");
+			if (f == NULL)
+				return false;
+
+			std::regex pattern("\"name\": \"([^\"]+)\".*\"real_time\": ([0-9.eE+-]+)");
+			char line[4096];
+			while (fgets(line, sizeof(line), f) != NULL)
+			{
+				std::cmatch m;
+				if (std::regex_search(line, m, pattern))
+					baseline[m[1].str()] = atof(m[2].str().c_str());
+			}
+			fclose(f);
+			return true;
+		}
+
+		static void print_usage(const char* exe)
+		{
+			fmt::print("usage: {} [--filter=<regex>] [--min_time=<secs>] [--repetitions=<n>] [--json=<file>] [--baseline=<file>] [--list]\n", exe);
+		}
+
+		static bool parse_options(int argc, char* argv[], BenchOptions& opts)
+		{
+			for (int i = 1; i < argc; i++)
+			{
+				std::string arg = argv[i];
+				auto value = [&arg](const char* key) -> const char* {
+					std::size_t len = strlen(key);
+					if (arg.compare(0, len, key) == 0 && arg.size() > len && arg[len] == '=')
+						return arg.c_str() + len + 1;
+					return NULL;
+				};
+
+				const char* v = NULL;
+				if ((v = value("--filter")) != NULL)
+					opts._filter = v;
+				else if ((v = value("--json")) != NULL)
+					opts._json = v;
+				else if ((v = value("--baseline")) != NULL)
+					opts._baseline = v;
+				else if ((v = value("--min_time")) != NULL)
+					opts._min_time = std::max(atof(v), 0.001);
+				else if ((v = value("--repetitions")) != NULL)
+					opts._repetitions = std::max(atoi(v), 1);
+				else if (arg == "--list")
+					opts._list = true;
+				else
+					return false;
+			}
+			return true;
+		}
+
+	public:
+		static BenchCase* add(const char* name, BenchFunc func)
+		{
+			BenchCasePtr bc(new BenchCase(name, func));
+			cases().emplace_back(bc);
+			return bc.get();
+		}
+
+		/*
+		 *	运行所有匹配的用例,有用例出错返回1
+		 */
+		static int run(int argc, char* argv[])
+		{
+			BenchOptions opts;
+			if (!parse_options(argc, argv, opts))
+			{
+				print_usage(argv[0]);
+				return 1;
+			}
+
+			std::regex filter(opts._filter.empty() ? ".*" : opts._filter);
+
+			std::map<std::string, double> baseline;
+			if (!opts._baseline.empty() && !load_baseline(opts._baseline.c_str(), baseline))
+			{
+				fmt::print("loading baseline {} failed\n", opts._baseline);
+				return 1;
+			}
+
+			std::vector<BenchResult> results;
+			bool bHeader = false;
+			for (BenchCasePtr& bc : cases())
+			{
+				std::vector<int64_t> args = bc->_args;
+				if (args.empty())
+					args.emplace_back(0);
+				std::vector<uint32_t> threads = bc->_threads;
+				if (threads.empty())
+					threads.emplace_back(1);
+
+				for (int64_t arg : args)
+				{
+					for (uint32_t n : threads)
+					{
+						std::string name = bc->_name;
+						if (!bc->_args.empty())
+							name += fmt::format("/{}", arg);
+						if (!bc->_threads.empty())
+							name += fmt::format("/threads:{}", n);
+
+						if (!std::regex_search(name, filter))
+							continue;
+
+						if (opts._list)
+						{
+							fmt::print("{}\n", name);
+							continue;
+						}
+
+						if (!bHeader)
+						{
+							fmt::print("{:<52}{:>14}{:>14}{:>14}  {}\n", "Benchmark", "Time(ns)", "CPU(ns)", "Iterations", "Details");
+							fmt::print("{}\n", std::string(110, '-'));
+							bHeader = true;
+						}
+
+						BenchResult r = run_case(*bc, name, arg, n, opts);
+						if (!r._error.empty())
+						{
+							fmt::print("{:<52}ERROR: {}\n", name, r._error);
+						}
+						else
+						{
+							std::string extra;
+							auto it = baseline.find(name);
+							if (it != baseline.end() && it->second > 0)
+								extra += fmt::format("{:+.1f}% ", (r._real_time / it->second - 1) * 100);
+							if (r._items_rate > 0)
+								extra += human_rate(r._items_rate, " items") + " ";
+							if (r._bytes_rate > 0)
+								extra += human_rate(r._bytes_rate, "B") + " ";
+							extra += r._label;
+							fmt::print("{:<52}{:>14.1f}{:>14.1f}{:>14}  {}\n", name, r._real_time, r._cpu_time, r._iterations, extra);
+						}
+						fflush(stdout);
+						results.emplace_back(r);
+					}
+				}
+			}
+
+			if (!opts._json.empty() && !opts._list)
+			{
+				if (write_json(opts._json.c_str(), argv[0], opts, results))
+					fmt::print("results written to {}\n", opts._json);
+				else
+					fmt::print("writing results to {} failed\n", opts._json);
+			}
+
+			for (const BenchResult& r : results)
+			{
+				if (!r._error.empty())
+					return 1;
+			}
+			return 0;
+		}
+	};
+}
+
+#define WT_BENCH_CONCAT_IMP(a, b)	a##b
+#define WT_BENCH_CONCAT(a, b)		WT_BENCH_CONCAT_IMP(a, b)
+
+/*
+ *	注册一个用例,返回的BenchCase*可以链式设置参数
+ */
+#define WT_BENCHMARK(func)	static wtbench::BenchCase* WT_BENCH_CONCAT(_wt_bench_, __LINE__) = wtbench::BenchRegistry::add(#func, func)
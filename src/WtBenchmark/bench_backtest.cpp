@@ -0,0 +1,403 @@
+﻿#include "WtBench.hpp"
+#include "BenchData.hpp"
+#include "../WtBtCore/MatchEngine.h"
+#include "../WtBtCore/HisDataReplayer.h"
+#include "../WtBtCore/HisDataMgr.h"
+#include "../WtDataStorage/DataDefine.h"
+#include "../Includes/WTSVariant.hpp"
+#include "../WTSUtils/WTSCmpHelper.hpp"
+#include "../Share/StdUtils.hpp"
+#include "../Share/StrUtil.hpp"
+
+#include <boost/filesystem.hpp>
+#include <atomic>
+#include <thread>
+
+USING_NS_WTP;
+using namespace wtbench;
+
+class BenchMatchSink : public IMatchSink
+{
+public:
+	BenchMatchSink() :_trades(0), _orders(0), _entrusts(0) {}
+
+	virtual void handle_trade(uint32_t localid, const char* stdCode, bool isBuy, double vol, double fireprice, double price, uint64_t ordTime) override { _trades++; }
+	virtual void handle_order(uint32_t localid, const char* stdCode, bool isBuy, double leftover, double price, bool isCanceled, uint64_t ordTime) override { _orders++; }
+	virtual void handle_entrust(uint32_t localid, const char* stdCode, bool bSuccess, const char* message, uint64_t ordTime) override { _entrusts++; }
+
+public:
+	uint64_t	_trades;
+	uint64_t	_orders;
+	uint64_t	_entrusts;
+};
+
+/*
+ *	撮合引擎,每笔tick下一笔单
+ *	四笔里三笔是对手价的主动单,下一笔tick就成交,一笔是挂在最新价上排队的被动单
+ */
+static void bm_match_engine(BenchState& state)
+{
+	const char* stdCode = "SHFE.rb.2401";
+	std::vector<WTSTickStruct> ticks;
+	benchdata::make_ticks(stdCode, 20231117, 20000, ticks);
+	std::vector<WTSTickData*> tickObjs;
+	for (WTSTickStruct& t : ticks)
+		tickObjs.emplace_back(WTSTickData::create(t));
+
+	BenchMatchSink sink;
+	MatchEngine engine;
+	engine.regisSink(&sink);
+
+	std::size_t idx = 0;
+	uint64_t seq = 0;
+	for (auto _ : state)
+	{
+		WTSTickData* curTick = tickObjs[idx];
+		engine.handle_tick(stdCode, curTick);
+
+		bool isBuy = (seq & 1) == 0;
+		double price;
+		if ((seq & 3) == 3)
+			price = curTick->price();
+		else
+			price = isBuy ? curTick->askprice(0) + 5 : curTick->bidprice(0) - 5;
+		uint64_t curTime = (uint64_t)curTick->actiondate() * 1000000000 + curTick->actiontime();
+		if (isBuy)
+			engine.buy(stdCode, price, 1 + seq % 3, curTime);
+		else
+			engine.sell(stdCode, price, 1 + seq % 3, curTime);
+
+		seq++;
+		idx = (idx + 1 == tickObjs.size()) ? 0 : idx + 1;
+	}
+	state.set_items_processed(state.iterations());
+	state.set_label(fmt::format("{} trades", sink._trades));
+
+	engine.clear();
+	for (WTSTickData* t : tickObjs)
+		t->release();
+}
+WT_BENCHMARK(bm_match_engine);
+
+/*
+ *	回测数据从内存里读取合成的分钟线,不转储成dsb,排除磁盘的影响
+ */
+class BenchBarLoader : public IBtDataLoader
+{
+public:
+	BenchBarLoader(uint32_t days)
+	{
+		WTSSessionInfo* sInfo = benchdata::make_session();
+		benchdata::make_bars(sInfo, 20230103, days, _bars);
+		sInfo->release();
+	}
+
+	virtual bool loadFinalHisBars(void* obj, const char* stdCode, WTSKlinePeriod period, FuncReadBars cb) override
+	{
+		if (period != KP_Minute1)
+			return false;
+
+		cb(obj, _bars.data(), (uint32_t)_bars.size());
+		return true;
+	}
+
+	virtual bool loadRawHisBars(void* obj, const char* stdCode, WTSKlinePeriod period, FuncReadBars cb) override { return false; }
+	virtual bool loadAllAdjFactors(void* obj, FuncReadFactors cb) override { return false; }
+	virtual bool loadAdjFactors(void* obj, const char* stdCode, FuncReadFactors cb) override { return false; }
+	virtual bool loadRawHisTicks(void* obj, const char* stdCode, uint32_t uDate, FuncReadTicks cb) override { return false; }
+	virtual bool isAutoTrans() override { return false; }
+
+	inline std::size_t size() const { return _bars.size(); }
+
+private:
+	std::vector<WTSBarStruct>	_bars;
+};
+
+/*
+ *	模拟一个只订阅K线的CTA策略,统计回放的数据量
+ */
+class BenchReplaySink : public IDataSink
+{
+public:
+	BenchReplaySink(HisDataReplayer& replayer) :_replayer(replayer), _ticks(0), _bars(0), _schedules(0) {}
+
+	virtual void handle_tick(const char* stdCode, WTSTickData* curTick, uint32_t pxType) override { _ticks++; }
+	virtual void handle_bar_close(const char* stdCode, const char* period, uint32_t times, WTSBarStruct* newBar) override { _bars++; }
+	virtual void handle_schedule(uint32_t uDate, uint32_t uTime) override { _schedules++; }
+
+	virtual void handle_init() override
+	{
+		WTSKlineSlice* slice = _replayer.get_kline_slice("SHFE.rb.2401", "m", 50, 1, true);
+		if (slice)
+			slice->release();
+		slice = _replayer.get_kline_slice("SHFE.rb.2401", "m", 50, 3, false);
+		if (slice)
+			slice->release();
+	}
+
+	virtual void handle_session_begin(uint32_t curTDate) override {}
+	virtual void handle_session_end(uint32_t curTDate) override {}
+
+public:
+	HisDataReplayer&	_replayer;
+	uint64_t			_ticks;
+	uint64_t			_bars;
+	uint64_t			_schedules;
+};
+
+static const char* BENCH_CONTRACTS[] = { "rb2401", "rb2402", "rb2403", "rb2404" };
+
+/*
+ *	回测要用的基础数据文件,只有螺纹钢一个品种
+ */
+static std::string write_basefiles(const char* folder)
+{
+	boost::filesystem::create_directories(folder);
+	std::string path = StrUtil::standardisePath(folder);
+
+	StdFile::write_file_content((path + "sessions.json").c_str(),
+		"{\"FN0230\":{\"name\":\"FN0230\",\"offset\":300,\"auction\":{\"from\":2059,\"to\":2100},"
+		"\"sections\":[{\"from\":2100,\"to\":230},{\"from\":900,\"to\":1015},{\"from\":1030,\"to\":1130},{\"from\":1330,\"to\":1500}]}}");
+	StdFile::write_file_content((path + "commodities.json").c_str(),
+		"{\"SHFE\":{\"rb\":{\"covermode\":1,\"pricemode\":0,\"category\":1,\"precision\":0,\"pricetick\":1,\"volscale\":10,"
+		"\"name\":\"rb\",\"exchg\":\"SHFE\",\"session\":\"FN0230\",\"holiday\":\"CHINA\"}}}");
+	std::string contracts;
+	for (const char* code : BENCH_CONTRACTS)
+	{
+		contracts += contracts.empty() ? "{\"SHFE\":{" : ",";
+		contracts += fmt::format("\"{0}\":{{\"name\":\"{0}\",\"code\":\"{0}\",\"exchg\":\"SHFE\",\"product\":\"rb\",\"maxlimitqty\":500,\"maxmarketqty\":30}}", code);
+	}
+	contracts += "}}";
+	StdFile::write_file_content((path + "contracts.json").c_str(), contracts);
+	StdFile::write_file_content((path + "holidays.json").c_str(), "{\"CHINA\":[\"20230101\"]}");
+	return path;
+}
+
+/*
+ *	回放器的配置,数据都放在path下面
+ */
+static WTSVariant* make_replayer_cfg(const std::string& path, const char* mode, bool bTick)
+{
+	WTSVariant* cfg = WTSVariant::createObject();
+	cfg->append("mode", mode);
+	cfg->append("path", path.c_str());
+	cfg->append("tick", bTick);
+	cfg->append("stime", (uint64_t)202301010900);
+	cfg->append("etime", (uint64_t)203012311500);
+	WTSVariant* cfgBF = WTSVariant::createObject();
+	cfgBF->append("session", (path + "sessions.json").c_str());
+	cfgBF->append("commodity", (path + "commodities.json").c_str());
+	cfgBF->append("contract", (path + "contracts.json").c_str());
+	cfgBF->append("holiday", (path + "holidays.json").c_str());
+	cfg->append("basefiles", cfgBF, false);
+	return cfg;
+}
+
+/*
+ *	回放arg天的分钟线,同时订阅1分钟和3分钟,用分钟线模拟tick
+ *	数据只在第一次回放的时候加载,后面每次回放都用缓存,测的是回放本身的开销
+ */
+static void bm_replay_bars(BenchState& state)
+{
+	std::string path = write_basefiles("./bench_replay/");
+	BenchBarLoader loader((uint32_t)state.arg());
+
+	WTSVariant* cfg = make_replayer_cfg(path, "csv", false);
+
+	HisDataReplayer replayer;
+	BenchReplaySink sink(replayer);
+	replayer.init(cfg, NULL, &loader);
+	replayer.register_sink(&sink, "bench");
+	cfg->release();
+
+	for (auto _ : state)
+	{
+		if (replayer.prepare())
+			replayer.run();
+	}
+
+	if (sink._bars == 0)
+		state.skip_with_error("no bars replayed");
+
+	state.set_items_processed(state.iterations() * loader.size());
+	state.set_label(fmt::format("{} bars closed, {} ticks simulated per run", sink._bars / state.iterations(), sink._ticks / state.iterations()));
+	boost::filesystem::remove_all("./bench_replay/");
+}
+WT_BENCHMARK(bm_replay_bars)->arg(20)->arg(120)->iterations(5);
+
+/*
+ *	tick回放,只订阅tick,策略什么都不做
+ */
+class BenchTickSink : public IDataSink
+{
+public:
+	BenchTickSink(HisDataReplayer& replayer) :_replayer(replayer), _ticks(0), _days(0) {}
+
+	virtual void handle_tick(const char* stdCode, WTSTickData* curTick, uint32_t pxType) override { _ticks++; }
+	virtual void handle_bar_close(const char* stdCode, const char* period, uint32_t times, WTSBarStruct* newBar) override {}
+	virtual void handle_schedule(uint32_t uDate, uint32_t uTime) override {}
+
+	virtual void handle_init() override
+	{
+		for (const char* code : BENCH_CONTRACTS)
+			_replayer.sub_tick(1, fmt::format("SHFE.rb.{}", code + 2).c_str());
+	}
+
+	virtual void handle_session_begin(uint32_t curTDate) override { _days++; }
+	virtual void handle_session_end(uint32_t curTDate) override {}
+
+public:
+	HisDataReplayer&	_replayer;
+	uint64_t			_ticks;
+	uint32_t			_days;
+};
+
+/*
+ *	按存储模块的格式写tick的dsb文件,压缩方式和转储的时候一样
+ */
+static void write_tick_dsbs(const std::string& path, uint32_t startDate, uint32_t days, uint32_t count)
+{
+	uint32_t curDate = startDate;
+	for (uint32_t i = 0; i < days; i++)
+	{
+		std::string folder = fmt::format("{}his/ticks/SHFE/{}/", path, curDate);
+		boost::filesystem::create_directories(folder);
+		for (const char* code : BENCH_CONTRACTS)
+		{
+			std::vector<WTSTickStruct> ticks;
+			benchdata::make_ticks(code, curDate, count, ticks);
+			for (WTSTickStruct& t : ticks)
+				wt_strcpy(t.exchg, "SHFE");
+
+			std::string cmpData = WTSCmpHelper::compress_data(ticks.data(), sizeof(WTSTickStruct)*ticks.size(), 1);
+			BlockHeaderV2 header;
+			memset(&header, 0, sizeof(header));
+			memcpy(header._blk_flag, BLK_FLAG, FLAG_SIZE);
+			header._type = BT_HIS_Ticks;
+			header._version = BLOCK_VERSION_CMP_V2;
+			header._size = cmpData.size();
+
+			std::string content((const char*)&header, sizeof(header));
+			content.append(cmpData);
+			StdFile::write_file_content((folder + code + ".dsb").c_str(), content);
+		}
+		curDate = benchdata::next_tdate(curDate);
+	}
+}
+
+/*
+ *	从dsb文件回放tick,arg为预读线程数,0为不预读
+ *	每次回放都重新创建回放器,这样每个交易日的数据都要重新读取和解压
+ *	对比arg为0和非0的结果,就是预读能省下来的换日开销,这个需要多核才能体现出来
+ *	bCompact为true的时候预读的tick按紧凑格式缓存,对比的是编码和还原的开销
+ */
+static void replay_ticks(BenchState& state, bool bCompact)
+{
+	std::string path = write_basefiles("./bench_replay_ticks/");
+	const uint32_t days = 10;
+	write_tick_dsbs(path, 20230103, days, 10000);
+
+	uint64_t ticks = 0;
+	for (auto _ : state)
+	{
+		state.pause_timing();
+		WTSVariant* cfg = make_replayer_cfg(path, "bin", true);
+		cfg->append("prefetch_threads", (uint32_t)state.arg());
+		cfg->append("prefetch_compact", bCompact);
+		HisDataReplayer* replayer = new HisDataReplayer;
+		BenchTickSink sink(*replayer);
+		replayer->init(cfg, NULL, NULL);
+		replayer->register_sink(&sink, "bench");
+		cfg->release();
+		state.resume_timing();
+
+		if (replayer->prepare())
+			replayer->run();
+
+		state.pause_timing();
+		ticks = sink._ticks;
+		delete replayer;
+		state.resume_timing();
+	}
+
+	if (ticks == 0)
+		state.skip_with_error("no ticks replayed, check if WtDataStorage module is in the same folder");
+
+	state.set_items_processed(state.iterations() * ticks);
+	state.set_label(fmt::format("{} ticks of {} days per run", ticks, days));
+	boost::filesystem::remove_all("./bench_replay_ticks/");
+}
+
+static void bm_replay_ticks(BenchState& state)
+{
+	replay_ticks(state, false);
+}
+WT_BENCHMARK(bm_replay_ticks)->arg(0)->arg(2)->arg(4)->iterations(3);
+
+static void bm_replay_ticks_compact(BenchState& state)
+{
+	replay_ticks(state, true);
+}
+WT_BENCHMARK(bm_replay_ticks_compact)->arg(2)->arg(4)->iterations(3);
+
+/*
+ *	arg个线程同时通过HisDataMgr读取tick的dsb文件,和预读线程的读法一样
+ *	dsb的读取模块是可重入的,读取不用排队,线程数增加的时候吞吐量应该跟着增加
+ *	如果各个arg的结果差不多,说明读取被串行化了,预读省不下时间
+ */
+static void bm_load_ticks(BenchState& state)
+{
+	std::string path = write_basefiles("./bench_load_ticks/");
+	const uint32_t days = 16;
+	write_tick_dsbs(path, 20230103, days, 10000);
+
+	std::vector<uint32_t> dates;
+	uint32_t curDate = 20230103;
+	for (uint32_t i = 0; i < days; i++)
+	{
+		dates.emplace_back(curDate);
+		curDate = benchdata::next_tdate(curDate);
+	}
+
+	WTSVariant* cfg = WTSVariant::createObject();
+	cfg->append("path", path.c_str());
+	HisDataMgr dataMgr;
+	bool bInited = dataMgr.init(cfg);
+	cfg->release();
+	if (!bInited)
+	{
+		state.skip_with_error("loading backtest data reader failed, check if WtDataStorage module is in the same folder");
+		boost::filesystem::remove_all("./bench_load_ticks/");
+		return;
+	}
+
+	uint32_t threads = (uint32_t)state.arg();
+	uint32_t total = days * (uint32_t)(sizeof(BENCH_CONTRACTS) / sizeof(const char*));
+	std::atomic<uint64_t> ticks(0);
+	for (auto _ : state)
+	{
+		std::atomic<uint32_t> next(0);
+		std::vector<std::thread> workers;
+		for (uint32_t t = 0; t < threads; t++)
+		{
+			workers.emplace_back([&dataMgr, &dates, &next, &ticks, total]() {
+				for (uint32_t idx = next++; idx < total; idx = next++)
+				{
+					dataMgr.load_raw_ticks("SHFE", BENCH_CONTRACTS[idx % 4], dates[idx / 4], [&ticks](std::string& data) {
+						ticks += data.size() / sizeof(WTSTickStruct);
+					});
+				}
+			});
+		}
+		for (auto& thrd : workers)
+			thrd.join();
+	}
+
+	if (ticks == 0)
+		state.skip_with_error("no ticks loaded");
+
+	state.set_items_processed(ticks.load());
+	state.set_label(fmt::format("{} files per run, {} threads", total, threads));
+	boost::filesystem::remove_all("./bench_load_ticks/");
+}
+WT_BENCHMARK(bm_load_ticks)->arg(1)->arg(2)->arg(4)->iterations(5);
@@ -0,0 +1,256 @@
+﻿#include "WtBench.hpp"
+#include "../Share/WtKVCache.hpp"
+#include "../Share/BoostFile.hpp"
+#include "../WtShareHelper/WtShareHelper.h"
+
+USING_NS_WTP;
+using namespace wtbench;
+
+/*
+ *	WtKVCache是文件映射的,同样条目数的用例共用一个文件,进程退出的时候删掉
+ *	1000万条的文件有2G多,生成一次要几秒钟
+ */
+class KVCacheFiles
+{
+public:
+	~KVCacheFiles()
+	{
+		for (auto& item : _files)
+			BoostFile::delete_file(item.second.c_str());
+	}
+
+	const char* prepare(uint32_t count)
+	{
+		auto it = _files.find(count);
+		if (it != _files.end())
+			return it->second.c_str();
+
+		std::string filename = fmt::format("./bench_kvcache_{}.dat", count);
+		BoostFile::delete_file(filename.c_str());
+		{
+			WtKVCache cache;
+			if (!cache.init(filename.c_str(), 20231117))
+				return NULL;
+
+			char key[64] = { 0 };
+			for (uint32_t i = 0; i < count; i++)
+			{
+				kv_key(key, i);
+				cache.put(key, "100000");
+			}
+		}
+
+		_files[count] = filename;
+		return _files[count].c_str();
+	}
+
+	static inline void kv_key(char* buffer, uint32_t i)
+	{
+		char* s = fmt::format_to(buffer, "SHFE.rb.{}.{}", 2300 + i % 12, i);
+		s[0] = '\0';
+	}
+
+private:
+	std::map<uint32_t, std::string> _files;
+};
+
+static KVCacheFiles g_kv_files;
+
+static void bm_kvcache_get(BenchState& state)
+{
+	uint32_t count = (uint32_t)state.arg();
+	const char* filename = g_kv_files.prepare(count);
+	WtKVCache cache;
+	if (filename == NULL || !cache.init(filename, 20231117))
+	{
+		state.skip_with_error("init kvcache failed");
+		return;
+	}
+
+	//key提前生成好,1000万条的时候只取其中一部分,避免key本身的内存太大
+	uint32_t keyCnt = std::min<uint32_t>(count, 1 << 20);
+	uint32_t step = count / keyCnt;
+	std::vector<std::string> keys;
+	char key[64] = { 0 };
+	for (uint32_t i = 0; i < keyCnt; i++)
+	{
+		KVCacheFiles::kv_key(key, i * step);
+		keys.emplace_back(key);
+	}
+
+	uint32_t idx = 0;
+	for (auto _ : state)
+	{
+		do_not_optimize(cache.get(keys[idx].c_str()));
+		idx = (idx + 1 == keyCnt) ? 0 : idx + 1;
+	}
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_kvcache_get)->arg(256)->arg(4096)->arg(10000000);
+
+/*
+ *	更新已有的key,实盘里更新订单号映射就是这种情况
+ */
+static void bm_kvcache_put(BenchState& state)
+{
+	uint32_t count = (uint32_t)state.arg();
+	const char* filename = g_kv_files.prepare(count);
+	WtKVCache cache;
+	if (filename == NULL || !cache.init(filename, 20231117))
+	{
+		state.skip_with_error("init kvcache failed");
+		return;
+	}
+
+	uint32_t keyCnt = std::min<uint32_t>(count, 1 << 20);
+	uint32_t step = count / keyCnt;
+	std::vector<std::string> keys;
+	char key[64] = { 0 };
+	for (uint32_t i = 0; i < keyCnt; i++)
+	{
+		KVCacheFiles::kv_key(key, i * step);
+		keys.emplace_back(key);
+	}
+
+	uint32_t idx = 0;
+	for (auto _ : state)
+	{
+		cache.put(keys[idx].c_str(), "200000");
+		idx = (idx + 1 == keyCnt) ? 0 : idx + 1;
+	}
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_kvcache_put)->arg(256)->arg(4096)->arg(10000000);
+
+/*
+ *	写入新的key,包含扩容的开销,每次从空文件开始写arg条
+ */
+static void bm_kvcache_insert(BenchState& state)
+{
+	const char* filename = "./bench_kvcache_insert.dat";
+	uint32_t count = (uint32_t)state.arg();
+	char key[64] = { 0 };
+	for (auto _ : state)
+	{
+		state.pause_timing();
+		BoostFile::delete_file(filename);
+		WtKVCache cache;
+		cache.init(filename, 20231117);
+		state.resume_timing();
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			KVCacheFiles::kv_key(key, i);
+			cache.put(key, "100000");
+		}
+	}
+	BoostFile::delete_file(filename);
+	state.set_items_processed(state.iterations() * count);
+}
+WT_BENCHMARK(bm_kvcache_insert)->arg(4096)->arg(10000000)->iterations(1);
+
+/*
+ *	加载已有的缓存文件,文件就是哈希表,不需要重建索引
+ */
+static void bm_kvcache_startup(BenchState& state)
+{
+	uint32_t count = (uint32_t)state.arg();
+	const char* filename = g_kv_files.prepare(count);
+	if (filename == NULL)
+	{
+		state.skip_with_error("init kvcache failed");
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		WtKVCache cache;
+		cache.init(filename, 20231117);
+		do_not_optimize(cache.get("SHFE.rb.2300.0"));
+	}
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_kvcache_startup)->arg(4096)->arg(10000000);
+
+/*
+ *	共享内存块的读写,外部进程监控策略状态用的
+ */
+static bool prepare_shareblocks(const char* domain, const char* filename)
+{
+	static bool bInited = false;
+	if (bInited)
+		return true;
+
+	BoostFile::delete_file(filename);
+	if (!init_master(domain, filename))
+		return false;
+
+	for (uint32_t i = 0; i < 32; i++)
+	{
+		std::string key = fmt::format("key{}", i);
+		set_double(domain, "bench", key.c_str(), i);
+		set_string(domain, "bench", fmt::format("str{}", i).c_str(), "SHFE.rb.2401");
+	}
+	commit_section(domain, "bench");
+	bInited = true;
+	return true;
+}
+
+static void bm_shareblocks_set_double(BenchState& state)
+{
+	if (!prepare_shareblocks("bench", "./bench_shareblocks.membin"))
+	{
+		state.skip_with_error("init shareblocks failed");
+		return;
+	}
+
+	const char* keys[] = { "key0", "key7", "key15", "key31" };
+	uint32_t idx = 0;
+	for (auto _ : state)
+	{
+		set_double("bench", "bench", keys[idx & 3], idx);
+		idx++;
+	}
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_shareblocks_set_double);
+
+static void bm_shareblocks_get_double(BenchState& state)
+{
+	if (!prepare_shareblocks("bench", "./bench_shareblocks.membin"))
+	{
+		state.skip_with_error("init shareblocks failed");
+		return;
+	}
+
+	const char* keys[] = { "key0", "key7", "key15", "key31" };
+	uint32_t idx = 0;
+	double total = 0;
+	for (auto _ : state)
+	{
+		total += get_double("bench", "bench", keys[idx & 3]);
+		idx++;
+	}
+	do_not_optimize(total);
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_shareblocks_get_double);
+
+static void bm_shareblocks_get_string(BenchState& state)
+{
+	if (!prepare_shareblocks("bench", "./bench_shareblocks.membin"))
+	{
+		state.skip_with_error("init shareblocks failed");
+		return;
+	}
+
+	const char* keys[] = { "str0", "str7", "str15", "str31" };
+	uint32_t idx = 0;
+	for (auto _ : state)
+	{
+		do_not_optimize(get_string("bench", "bench", keys[idx & 3]));
+		idx++;
+	}
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_shareblocks_get_string);
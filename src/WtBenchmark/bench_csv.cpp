@@ -0,0 +1,141 @@
+﻿#include "WtBench.hpp"
+#include "../WTSTools/CsvHelper.h"
+#include "../Share/BoostFile.hpp"
+#include "../Share/TimeUtils.hpp"
+
+using namespace wtbench;
+
+/*
+ *	按WtDtHelper转换K线时的读法读取CSV的所有字段
+ *	arg为行数,100万行大约100M,文件每轮重新生成,测完删掉
+ */
+static const char* BENCH_CSV = "./bench_csv.csv";
+static const char* BAR_FIELDS[] = { "open", "high", "low", "close", "volume", "turnover", "open_interest", "diff_interest", "settle" };
+
+/*
+ *	生成K线的CSV文件,格式和WtDtHelper导出的一样
+ */
+static void make_csv(const char* filename, uint32_t rows)
+{
+	std::string content;
+	content.reserve((std::size_t)rows * 100);
+	content += "\xEF\xBB\xBF<Date>,<Time>,Open,High,Low,Close,Volume,Turnover,Open_Interest,Diff_Interest,Settle\n";
+	uint32_t seed = 20231114;
+	double price = 3800;
+	uint32_t uDate = 20150105;
+	uint32_t uMin = 0;
+	for (uint32_t i = 0; i < rows; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		price += (double)((seed >> 16) % 11) - 5;
+		uint32_t uTime = 901 + uMin / 60 * 100 + uMin % 60;
+		fmt::format_to(std::back_inserter(content), "{}/{}/{},{:02d}:{:02d}:00,{},{},{},{},{},{:.2f},{},{},{}\n",
+			uDate / 10000, uDate % 10000 / 100, uDate % 100, uTime / 100, uTime % 100,
+			price, price + 3, price - 2.5, price + 0.5, (seed >> 8) % 500, price * 10 * ((seed >> 8) % 500) + 0.37,
+			100000 + (seed >> 12) % 3000, (int32_t)((seed >> 4) % 101) - 50, 0);
+
+		if (++uMin == 240)
+		{
+			uMin = 0;
+			uDate = TimeUtils::getNextDate(uDate);
+		}
+	}
+	BoostFile::write_file_contents(filename, content.data(), (uint32_t)content.size());
+}
+
+/*
+ *	原来的读取器,按字段名取值
+ */
+static void bm_csv_reader(BenchState& state)
+{
+	uint32_t rows = (uint32_t)state.arg();
+	make_csv(BENCH_CSV, rows);
+
+	double checksum = 0;
+	for (auto _ : state)
+	{
+		CsvReader reader;
+		reader.load_from_file(BENCH_CSV);
+		while (reader.next_row())
+		{
+			checksum += strlen(reader.get_string("date")) + strlen(reader.get_string("time"));
+			for (const char* field : BAR_FIELDS)
+				checksum += reader.get_double(field);
+		}
+	}
+	do_not_optimize(checksum);
+
+	BoostFile::delete_file(BENCH_CSV);
+	state.set_items_processed(state.iterations() * rows);
+}
+WT_BENCHMARK(bm_csv_reader)->arg(1000000)->iterations(3);
+
+/*
+ *	内存映射的读取器,先取列号再按列取值
+ */
+static void bm_csv_mmap_reader(BenchState& state)
+{
+	uint32_t rows = (uint32_t)state.arg();
+	make_csv(BENCH_CSV, rows);
+
+	double checksum = 0;
+	for (auto _ : state)
+	{
+		CsvMmapReader reader;
+		reader.load_from_file(BENCH_CSV);
+		int32_t cols[9];
+		for (uint32_t i = 0; i < 9; i++)
+			cols[i] = reader.get_col(BAR_FIELDS[i]);
+		int32_t colDate = reader.get_col("date");
+		int32_t colTime = reader.get_col("time");
+		while (reader.next_row())
+		{
+			checksum += reader.get_view(colDate).size() + reader.get_view(colTime).size();
+			for (int32_t col : cols)
+				checksum += reader.get_double(col);
+		}
+	}
+	do_not_optimize(checksum);
+
+	BoostFile::delete_file(BENCH_CSV);
+	state.set_items_processed(state.iterations() * rows);
+}
+WT_BENCHMARK(bm_csv_mmap_reader)->arg(1000000)->iterations(3);
+
+/*
+ *	内存映射的读取器按行切块,每个线程读一块
+ */
+static void bm_csv_parallel(BenchState& state)
+{
+	uint32_t rows = (uint32_t)state.arg();
+	make_csv(BENCH_CSV, rows);
+
+	uint32_t threads = std::max(std::thread::hardware_concurrency(), 1U);
+	std::vector<double> sums(threads, 0);
+	for (auto _ : state)
+	{
+		CsvMmapReader reader;
+		reader.load_from_file(BENCH_CSV);
+		int32_t cols[9];
+		for (uint32_t i = 0; i < 9; i++)
+			cols[i] = reader.get_col(BAR_FIELDS[i]);
+		int32_t colDate = reader.get_col("date");
+		int32_t colTime = reader.get_col("time");
+		reader.parallel_for(threads, [&sums, &cols, colDate, colTime](uint32_t chunkIdx, CsvCursor& cursor) {
+			double sum = 0;
+			while (cursor.next_row())
+			{
+				sum += cursor.get_view(colDate).size() + cursor.get_view(colTime).size();
+				for (int32_t col : cols)
+					sum += cursor.get_double(col);
+			}
+			sums[chunkIdx] += sum;
+		});
+	}
+	do_not_optimize(sums.data());
+
+	BoostFile::delete_file(BENCH_CSV);
+	state.set_items_processed(state.iterations() * rows);
+	state.set_label(fmt::format("{} threads", threads));
+}
+WT_BENCHMARK(bm_csv_parallel)->arg(1000000)->iterations(3);
@@ -0,0 +1,402 @@
+﻿#include "WtBench.hpp"
+#include "BenchData.hpp"
+#include "../WTSTools/WTSDataFactory.h"
+#include "../WTSUtils/WTSCmpHelper.hpp"
+#include "../Share/WtCompactData.hpp"
+
+USING_NS_WTP;
+using namespace wtbench;
+
+/*
+ *	一年的分钟线,所有重采样的用例共用
+ */
+static WTSKlineSlice* get_m1_slice(WTSSessionInfo*& sInfo)
+{
+	static WTSSessionInfo* _session = benchdata::make_session();
+	static std::vector<WTSBarStruct> _bars;
+	static WTSKlineSlice* _slice = NULL;
+	if (_slice == NULL)
+	{
+		benchdata::make_bars(_session, 20230103, 250, _bars);
+		_slice = WTSKlineSlice::create("SHFE.rb.HOT", KP_Minute1, 1, _bars.data(), (int32_t)_bars.size());
+	}
+
+	sInfo = _session;
+	return _slice;
+}
+
+/*
+ *	分钟线重采样成arg分钟,按小节对齐
+ */
+static void bm_resample_minute(BenchState& state)
+{
+	WTSSessionInfo* sInfo = NULL;
+	WTSKlineSlice* slice = get_m1_slice(sInfo);
+	WTSDataFactory fact;
+	for (auto _ : state)
+	{
+		WTSKlineData* kline = fact.extractKlineData(slice, KP_Minute1, (uint32_t)state.arg(), sInfo, true, true);
+		do_not_optimize(kline);
+		kline->release();
+	}
+	state.set_items_processed(state.iterations() * slice->size());
+}
+WT_BENCHMARK(bm_resample_minute)->arg(5)->arg(15)->arg(60)->min_time(1.0);
+
+/*
+ *	分钟线先汇总成日线,再合成周期为arg天的K线
+ */
+static void bm_resample_day(BenchState& state)
+{
+	WTSSessionInfo* sInfo = NULL;
+	WTSKlineSlice* slice = get_m1_slice(sInfo);
+	std::vector<WTSBarStruct> dayBars;
+	for (int32_t i = 0; i < slice->size(); i++)
+	{
+		const WTSBarStruct& bar = *slice->at(i);
+		if (dayBars.empty() || dayBars.back().date != bar.date)
+		{
+			dayBars.emplace_back(bar);
+			dayBars.back().time = 0;
+			continue;
+		}
+
+		WTSBarStruct& dayBar = dayBars.back();
+		dayBar.high = std::max(dayBar.high, bar.high);
+		dayBar.low = std::min(dayBar.low, bar.low);
+		dayBar.close = bar.close;
+		dayBar.vol += bar.vol;
+		dayBar.money += bar.money;
+		dayBar.hold = bar.hold;
+	}
+
+	WTSDataFactory fact;
+	WTSKlineSlice* daySlice = WTSKlineSlice::create("SHFE.rb.HOT", KP_DAY, 1, dayBars.data(), (int32_t)dayBars.size());
+
+	for (auto _ : state)
+	{
+		WTSKlineData* kline = fact.extractKlineData(daySlice, KP_DAY, (uint32_t)state.arg(), sInfo, true, false);
+		do_not_optimize(kline);
+		kline->release();
+	}
+	state.set_items_processed(state.iterations() * daySlice->size());
+	daySlice->release();
+}
+WT_BENCHMARK(bm_resample_day)->arg(5);
+
+/*
+ *	实时行情逐笔更新分钟K线
+ */
+static void bm_kline_update_by_tick(BenchState& state)
+{
+	WTSSessionInfo* sInfo = benchdata::make_session();
+	std::vector<WTSTickStruct> ticks;
+	benchdata::make_ticks("SHFE.rb.2401", 20231117, 16000, ticks);
+	std::vector<WTSTickData*> tickObjs;
+	for (WTSTickStruct& t : ticks)
+		tickObjs.emplace_back(WTSTickData::create(t));
+
+	WTSDataFactory fact;
+	WTSKlineData* kline = WTSKlineData::create("SHFE.rb.2401", 0);
+	kline->setPeriod(KP_Minute1, (uint32_t)state.arg());
+
+	std::size_t idx = 0;
+	for (auto _ : state)
+	{
+		do_not_optimize(fact.updateKlineData(kline, tickObjs[idx], sInfo));
+		if (++idx == tickObjs.size())
+		{
+			//一天的tick用完了,从头再来,K线清空,不计时
+			state.pause_timing();
+			kline->getDataRef().clear();
+			idx = 0;
+			state.resume_timing();
+		}
+	}
+	state.set_items_processed(state.iterations());
+
+	kline->release();
+	for (WTSTickData* t : tickObjs)
+		t->release();
+	sInfo->release();
+}
+WT_BENCHMARK(bm_kline_update_by_tick)->arg(1)->arg(5);
+
+/*
+ *	数据文件压缩,arg为压缩级别,和转储dsb的时候一样
+ */
+static void bm_zstd_compress_bars(BenchState& state)
+{
+	WTSSessionInfo* sInfo = NULL;
+	WTSKlineSlice* slice = get_m1_slice(sInfo);
+	const WTSBarStruct* bars = slice->at(0);
+	std::size_t len = sizeof(WTSBarStruct) * 20000;
+
+	std::size_t cmpLen = 0;
+	for (auto _ : state)
+	{
+		std::string data = WTSCmpHelper::compress_data(bars, len, (uint32_t)state.arg());
+		cmpLen = data.size();
+		do_not_optimize(data);
+	}
+	state.set_bytes_processed(state.iterations() * len);
+	state.set_label(fmt::format("ratio {:.1f}%", cmpLen * 100.0 / len));
+}
+WT_BENCHMARK(bm_zstd_compress_bars)->arg(1)->arg(3)->arg(9);
+
+static void bm_zstd_uncompress_bars(BenchState& state)
+{
+	WTSSessionInfo* sInfo = NULL;
+	WTSKlineSlice* slice = get_m1_slice(sInfo);
+	const WTSBarStruct* bars = slice->at(0);
+	std::size_t len = sizeof(WTSBarStruct) * 20000;
+	std::string cmpData = WTSCmpHelper::compress_data(bars, len, 1);
+
+	for (auto _ : state)
+	{
+		std::string data = WTSCmpHelper::uncompress_data(cmpData.data(), cmpData.size());
+		do_not_optimize(data);
+	}
+	state.set_bytes_processed(state.iterations() * len);
+}
+WT_BENCHMARK(bm_zstd_uncompress_bars);
+
+static void bm_zstd_compress_ticks(BenchState& state)
+{
+	std::vector<WTSTickStruct> ticks;
+	benchdata::make_ticks("SHFE.rb.2401", 20231117, 20000, ticks);
+	std::size_t len = sizeof(WTSTickStruct) * ticks.size();
+
+	std::size_t cmpLen = 0;
+	for (auto _ : state)
+	{
+		std::string data = WTSCmpHelper::compress_data(ticks.data(), len, 1);
+		cmpLen = data.size();
+		do_not_optimize(data);
+	}
+	state.set_bytes_processed(state.iterations() * len);
+	state.set_label(fmt::format("ratio {:.1f}%", cmpLen * 100.0 / len));
+}
+WT_BENCHMARK(bm_zstd_compress_ticks);
+
+/*
+ *	交易时间换算,K线合成和回测里每根K线都要调用好几次
+ *	时间取一个交易日里的每一分钟,包括夜盘跨零点的部分
+ */
+static std::vector<uint32_t> all_trading_times(WTSSessionInfo* sInfo)
+{
+	std::vector<uint32_t> ret;
+	uint32_t totalMins = sInfo->getTradingMins();
+	for (uint32_t m = 1; m <= totalMins; m++)
+		ret.emplace_back(sInfo->minuteToTime(m));
+	return ret;
+}
+
+static void bm_session_time_to_minutes(BenchState& state)
+{
+	WTSSessionInfo* sInfo = benchdata::make_session();
+	std::vector<uint32_t> times = all_trading_times(sInfo);
+	std::size_t idx = 0;
+	uint64_t total = 0;
+	for (auto _ : state)
+	{
+		total += sInfo->timeToMinutes(times[idx]);
+		idx = (idx + 1 == times.size()) ? 0 : idx + 1;
+	}
+	do_not_optimize(total);
+	state.set_items_processed(state.iterations());
+	sInfo->release();
+}
+WT_BENCHMARK(bm_session_time_to_minutes);
+
+static void bm_session_minute_to_time(BenchState& state)
+{
+	WTSSessionInfo* sInfo = benchdata::make_session();
+	uint32_t totalMins = sInfo->getTradingMins();
+	uint32_t m = 0;
+	uint64_t total = 0;
+	for (auto _ : state)
+	{
+		total += sInfo->minuteToTime(m);
+		m = (m == totalMins) ? 0 : m + 1;
+	}
+	do_not_optimize(total);
+	state.set_items_processed(state.iterations());
+	sInfo->release();
+}
+WT_BENCHMARK(bm_session_minute_to_time);
+
+static void bm_session_time_to_seconds(BenchState& state)
+{
+	WTSSessionInfo* sInfo = benchdata::make_session();
+	std::vector<uint32_t> times = all_trading_times(sInfo);
+	for (uint32_t& t : times)
+		t = t * 100 + 30;
+	std::size_t idx = 0;
+	uint64_t total = 0;
+	for (auto _ : state)
+	{
+		total += sInfo->timeToSeconds(times[idx]);
+		idx = (idx + 1 == times.size()) ? 0 : idx + 1;
+	}
+	do_not_optimize(total);
+	state.set_items_processed(state.iterations());
+	sInfo->release();
+}
+WT_BENCHMARK(bm_session_time_to_seconds);
+
+static void bm_session_offset_time(BenchState& state)
+{
+	WTSSessionInfo* sInfo = benchdata::make_session();
+	std::vector<uint32_t> times = all_trading_times(sInfo);
+	std::size_t idx = 0;
+	uint64_t total = 0;
+	for (auto _ : state)
+	{
+		uint32_t t = times[idx];
+		total += sInfo->offsetTime(t, true) + sInfo->isInTradingTime(t);
+		idx = (idx + 1 == times.size()) ? 0 : idx + 1;
+	}
+	do_not_optimize(total);
+	state.set_items_processed(state.iterations());
+	sInfo->release();
+}
+WT_BENCHMARK(bm_session_offset_time);
+
+/*
+ *	定点紧凑存储,三年的分钟线
+ *	扫描的用例取收盘价和成交量,模拟指标计算只用少数几个字段的场景
+ */
+static const std::vector<WTSBarStruct>& get_m1_bars_3y()
+{
+	static std::vector<WTSBarStruct> _bars;
+	if (_bars.empty())
+	{
+		WTSSessionInfo* sInfo = benchdata::make_session();
+		benchdata::make_bars(sInfo, 20210104, 750, _bars);
+		sInfo->release();
+	}
+	return _bars;
+}
+
+static const std::string& get_m1_compact_3y()
+{
+	static std::string _compact;
+	if (_compact.empty())
+	{
+		const std::vector<WTSBarStruct>& bars = get_m1_bars_3y();
+		WtCompactCodec::encode_bars(bars.data(), (uint32_t)bars.size(), 0, _compact);
+	}
+	return _compact;
+}
+
+static void bm_compact_encode_bars(BenchState& state)
+{
+	const std::vector<WTSBarStruct>& bars = get_m1_bars_3y();
+	std::string compact;
+	for (auto _ : state)
+	{
+		WtCompactCodec::encode_bars(bars.data(), (uint32_t)bars.size(), 0, compact);
+		do_not_optimize(compact);
+	}
+	state.set_items_processed(state.iterations() * bars.size());
+	state.set_label(fmt::format("{:.1f}MB -> {:.1f}MB", sizeof(WTSBarStruct)*bars.size() / 1048576.0, compact.size() / 1048576.0));
+}
+WT_BENCHMARK(bm_compact_encode_bars);
+
+static void bm_compact_decode_bars(BenchState& state)
+{
+	const std::string& compact = get_m1_compact_3y();
+	std::string raw;
+	for (auto _ : state)
+	{
+		WtCompactCodec::decode_bars(compact.data(), compact.size(), raw);
+		do_not_optimize(raw);
+	}
+	state.set_items_processed(state.iterations() * get_m1_bars_3y().size());
+}
+WT_BENCHMARK(bm_compact_decode_bars);
+
+/*
+ *	落盘大小,紧凑格式再用zstd压缩,和原来直接压缩结构体比较
+ */
+static void bm_compact_zstd_bars(BenchState& state)
+{
+	const std::vector<WTSBarStruct>& bars = get_m1_bars_3y();
+	const std::string& compact = get_m1_compact_3y();
+	std::size_t rawLen = WTSCmpHelper::compress_data(bars.data(), sizeof(WTSBarStruct)*bars.size(), 1).size();
+
+	std::size_t cmpLen = 0;
+	for (auto _ : state)
+	{
+		std::string data = WTSCmpHelper::compress_data(compact.data(), compact.size(), 1);
+		cmpLen = data.size();
+		do_not_optimize(data);
+	}
+	state.set_bytes_processed(state.iterations() * compact.size());
+	state.set_label(fmt::format("{:.2f}MB vs {:.2f}MB", cmpLen / 1048576.0, rawLen / 1048576.0));
+}
+WT_BENCHMARK(bm_compact_zstd_bars);
+
+static void bm_scan_bars_struct(BenchState& state)
+{
+	const std::vector<WTSBarStruct>& bars = get_m1_bars_3y();
+	for (auto _ : state)
+	{
+		double maxPx = 0;
+		double totalVol = 0;
+		for (const WTSBarStruct& bar : bars)
+		{
+			maxPx = std::max(maxPx, bar.close);
+			totalVol += bar.vol;
+		}
+		do_not_optimize(maxPx);
+		do_not_optimize(totalVol);
+	}
+	state.set_items_processed(state.iterations() * bars.size());
+	state.set_bytes_processed(state.iterations() * sizeof(WTSBarStruct) * bars.size());
+}
+WT_BENCHMARK(bm_scan_bars_struct);
+
+static void bm_scan_bars_compact(BenchState& state)
+{
+	const std::string& compact = get_m1_compact_3y();
+	WtCompactBars view;
+	view.attach(compact.data(), compact.size());
+	for (auto _ : state)
+	{
+		//在定点上比较,最后再换算成价格
+		int32_t maxPx = INT32_MIN;
+		uint64_t totalVol = 0;
+		for (uint32_t i = 0; i < view.size(); i++)
+		{
+			const WTSBarCompact& item = view.at(i);
+			maxPx = std::max(maxPx, item.close);
+			totalVol += item.vol;
+		}
+		double px = WtCompactCodec::to_price(maxPx, view.scale());
+		do_not_optimize(px);
+		do_not_optimize(totalVol);
+	}
+	state.set_items_processed(state.iterations() * view.size());
+	state.set_bytes_processed(state.iterations() * compact.size());
+}
+WT_BENCHMARK(bm_scan_bars_compact);
+
+static void bm_compact_decode_ticks(BenchState& state)
+{
+	std::vector<WTSTickStruct> ticks;
+	benchdata::make_ticks("SHFE.rb.2401", 20231117, 20000, ticks);
+	std::string compact;
+	WtCompactCodec::encode_ticks(ticks.data(), (uint32_t)ticks.size(), 0, compact);
+
+	std::string raw;
+	for (auto _ : state)
+	{
+		WtCompactCodec::decode_ticks(compact.data(), compact.size(), raw);
+		do_not_optimize(raw);
+	}
+	state.set_items_processed(state.iterations() * ticks.size());
+	state.set_label(fmt::format("{:.1f}MB -> {:.1f}MB", sizeof(WTSTickStruct)*ticks.size() / 1048576.0, compact.size() / 1048576.0));
+}
+WT_BENCHMARK(bm_compact_decode_ticks);
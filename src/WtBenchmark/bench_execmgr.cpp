@@ -0,0 +1,171 @@
+﻿#include "WtBench.hpp"
+#include "../WtCore/WtExecMgr.h"
+#include "../Includes/WTSDataDef.hpp"
+#include "../Share/CodeHelper.hpp"
+
+USING_NS_WTP;
+using namespace wtbench;
+
+/*
+ *	执行器管理器的基准测试
+ *	参数为 执行器数量*100000 + 合约数量,合约平均分给各个执行器
+ */
+namespace
+{
+	class BenchExecuter : public IExecCommand
+	{
+	public:
+		BenchExecuter(const char* name, bool bIndexed, bool bDiff)
+			: IExecCommand(name), _diff(bDiff)
+		{
+			_code_indexed = bIndexed;
+		}
+
+		void add_unit(const std::string& stdCode)
+		{
+			_units[stdCode] = 0;
+			indexCode(stdCode.c_str());
+		}
+
+	public:
+		virtual void on_tick(const char* stdCode, WTSTickData* newTick) override
+		{
+			//和执行器里的getUnit(stdCode, false)一样,先按代码查执行单元
+			auto it = _units.find(stdCode);
+			if (it != _units.end())
+				it->second++;
+		}
+
+		virtual void set_position(const wt_hashmap<std::string, double>& targets) override
+		{
+			for (auto& v : targets)
+				apply_target(v.first, v.second);
+		}
+
+		virtual bool set_position_diff(const wt_hashmap<std::string, double>& changes) override
+		{
+			if (!_diff)
+				return false;
+
+			for (auto& v : changes)
+				apply_target(v.first, v.second);
+			return true;
+		}
+
+	private:
+		//和WtLocalExecuter::getUnit一样,每个合约都要先解析代码、确定品种,再更新目标
+		inline void apply_target(const std::string& stdCode, double qty)
+		{
+			CodeHelper::CodeInfo codeInfo = CodeHelper::extractStdCode(stdCode.c_str(), NULL);
+			std::string commID = codeInfo.stdCommID();
+			do_not_optimize(commID);
+
+			_targets[stdCode] = qty;
+		}
+
+	private:
+		bool	_diff;
+		wt_hashmap<std::string, uint64_t>	_units;
+		wt_hashmap<std::string, double>		_targets;
+	};
+
+	typedef struct _MgrFixture
+	{
+		WtExecuterMgr				_mgr;
+		std::vector<std::string>	_codes;
+		std::vector<std::shared_ptr<BenchExecuter>>	_executers;
+
+		_MgrFixture(int64_t arg, bool bIndexed, bool bDiff)
+		{
+			uint32_t cntExecs = (uint32_t)(arg / 100000);
+			uint32_t cntCodes = (uint32_t)(arg % 100000);
+			for (uint32_t i = 0; i < cntCodes; i++)
+				_codes.emplace_back(fmt::format("SSE.STK.{}", 600000 + i));
+
+			for (uint32_t i = 0; i < cntExecs; i++)
+			{
+				std::shared_ptr<BenchExecuter> executer(new BenchExecuter(fmt::format("exec{}", i).c_str(), bIndexed, bDiff));
+				_mgr.add_executer(executer);
+				_executers.emplace_back(executer);
+			}
+
+			for (uint32_t i = 0; i < cntCodes; i++)
+				_executers[i % cntExecs]->add_unit(_codes[i]);
+		}
+	} MgrFixture;
+}
+
+static void run_ticks(BenchState& state, bool bIndexed)
+{
+	MgrFixture fixture(state.arg(), bIndexed, true);
+	WTSTickData* tick = WTSTickData::create("SSE.STK.600000");
+
+	std::size_t idx = 0;
+	std::size_t cnt = fixture._codes.size();
+	for (auto _ : state)
+	{
+		fixture._mgr.handle_tick(fixture._codes[idx].c_str(), tick);
+		if (++idx == cnt)
+			idx = 0;
+	}
+	state.set_items_processed(state.iterations());
+	tick->release();
+}
+
+/*
+ *	原来的方式,每笔行情都推给全部执行器
+ */
+static void bm_execmgr_tick_broadcast(BenchState& state)
+{
+	run_ticks(state, false);
+}
+WT_BENCHMARK(bm_execmgr_tick_broadcast)->arg(4 * 100000 + 1000)->arg(32 * 100000 + 4000)->arg(64 * 100000 + 4000);
+
+/*
+ *	按代码索引推送
+ */
+static void bm_execmgr_tick_routed(BenchState& state)
+{
+	run_ticks(state, true);
+}
+WT_BENCHMARK(bm_execmgr_tick_routed)->arg(4 * 100000 + 1000)->arg(32 * 100000 + 4000)->arg(64 * 100000 + 4000);
+
+/*
+ *	每次调度1%的合约目标仓位变化
+ */
+static void run_targets(BenchState& state, bool bDiff)
+{
+	MgrFixture fixture(state.arg(), true, bDiff);
+
+	wt_hashmap<std::string, double> targets;
+	for (const std::string& stdCode : fixture._codes)
+		targets[stdCode] = 100;
+
+	std::size_t step = std::max<std::size_t>(fixture._codes.size() / 100, 1);
+	std::size_t idx = 0;
+	double qty = 100;
+	for (auto _ : state)
+	{
+		qty += 100;
+		for (std::size_t i = 0; i < step; i++)
+		{
+			targets[fixture._codes[idx]] = qty;
+			idx = (idx + 1) % fixture._codes.size();
+		}
+
+		fixture._mgr.set_positions(targets);
+	}
+	state.set_items_processed(state.iterations());
+}
+
+static void bm_execmgr_targets_full(BenchState& state)
+{
+	run_targets(state, false);
+}
+WT_BENCHMARK(bm_execmgr_targets_full)->arg(4 * 100000 + 1000)->arg(32 * 100000 + 4000);
+
+static void bm_execmgr_targets_diff(BenchState& state)
+{
+	run_targets(state, true);
+}
+WT_BENCHMARK(bm_execmgr_targets_diff)->arg(4 * 100000 + 1000)->arg(32 * 100000 + 4000);
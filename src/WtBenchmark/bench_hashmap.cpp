@@ -0,0 +1,132 @@
+﻿#include "WtBench.hpp"
+#include "BenchData.hpp"
+#include "../Includes/FasterDefs.h"
+
+#include <unordered_map>
+
+USING_NS_WTP;
+using namespace wtbench;
+
+/*
+ *	生成和标准合约代码差不多的key,比如SHFE.rb.2401
+ */
+static std::vector<std::string> make_codes(uint32_t count, uint32_t seed)
+{
+	static const char* exchgs[] = { "SHFE", "DCE", "CZCE", "CFFEX", "INE", "GFEX", "SSE", "SZSE" };
+	benchdata::BenchRandom rnd(seed);
+	std::vector<std::string> ret;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t r = rnd.next();
+		char pid[3] = { (char)('a' + r % 26), (char)('a' + (r >> 5) % 26), 0 };
+		ret.emplace_back(fmt::format("{}.{}.{}", exchgs[i % 8], pid, 2300 + i));
+	}
+	return ret;
+}
+
+/*
+ *	在arg个合约里查找,查询顺序打乱,避免一直命中同一个缓存行
+ */
+template<typename MapType>
+static void bench_find(BenchState& state, bool bHit)
+{
+	uint32_t count = (uint32_t)state.arg();
+	std::vector<std::string> codes = make_codes(count, 20231117);
+	MapType m;
+	for (uint32_t i = 0; i < count; i++)
+		m[codes[i]] = i;
+
+	std::vector<std::string> keys = bHit ? codes : make_codes(count, 20231118);
+	std::vector<uint32_t> order(count);
+	benchdata::BenchRandom rnd;
+	for (uint32_t i = 0; i < count; i++)
+		order[i] = rnd.next() % count;
+
+	uint32_t idx = 0;
+	uint64_t found = 0;
+	for (auto _ : state)
+	{
+		auto it = m.find(keys[order[idx]]);
+		found += (it != m.end());
+		idx = (idx + 1 == count) ? 0 : idx + 1;
+	}
+	do_not_optimize(found);
+	state.set_items_processed(state.iterations());
+}
+
+static void bm_wt_hashmap_find_hit(BenchState& state)
+{
+	bench_find<wt_hashmap<std::string, uint32_t>>(state, true);
+}
+WT_BENCHMARK(bm_wt_hashmap_find_hit)->arg(64)->arg(1024)->arg(65536);
+
+static void bm_wt_hashmap_find_miss(BenchState& state)
+{
+	bench_find<wt_hashmap<std::string, uint32_t>>(state, false);
+}
+WT_BENCHMARK(bm_wt_hashmap_find_miss)->arg(64)->arg(1024)->arg(65536);
+
+/*
+ *	tsl::robin_map和std::unordered_map作为对照,更换FasterDefs.h里的实现之前先比较一下
+ */
+static void bm_robin_map_find_hit(BenchState& state)
+{
+	bench_find<tsl::robin_map<std::string, uint32_t>>(state, true);
+}
+WT_BENCHMARK(bm_robin_map_find_hit)->arg(64)->arg(1024)->arg(65536);
+
+static void bm_std_unordered_map_find_hit(BenchState& state)
+{
+	bench_find<std::unordered_map<std::string, uint32_t>>(state, true);
+}
+WT_BENCHMARK(bm_std_unordered_map_find_hit)->arg(64)->arg(1024)->arg(65536);
+
+/*
+ *	回调里拿到的合约代码都是const char*,查找的时候要先构造std::string,这里把构造的开销也算进去
+ */
+static void bm_wt_hashmap_find_cstr(BenchState& state)
+{
+	uint32_t count = (uint32_t)state.arg();
+	std::vector<std::string> codes = make_codes(count, 20231117);
+	wt_hashmap<std::string, uint32_t> m;
+	for (uint32_t i = 0; i < count; i++)
+		m[codes[i]] = i;
+
+	uint32_t idx = 0;
+	uint64_t found = 0;
+	for (auto _ : state)
+	{
+		const char* code = codes[idx].c_str();
+		auto it = m.find(code);
+		found += (it != m.end());
+		idx = (idx + 1 == count) ? 0 : idx + 1;
+	}
+	do_not_optimize(found);
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_wt_hashmap_find_cstr)->arg(1024);
+
+/*
+ *	插入和删除,订单表这样频繁增删的场景
+ */
+static void bm_wt_hashmap_insert_erase(BenchState& state)
+{
+	uint32_t count = (uint32_t)state.arg();
+	std::vector<std::string> codes = make_codes(count, 20231117);
+	wt_hashmap<std::string, uint32_t> m;
+	for (uint32_t i = 0; i < count; i += 2)
+		m[codes[i]] = i;
+
+	uint32_t idx = 1;
+	for (auto _ : state)
+	{
+		m[codes[idx]] = idx;
+		m.erase(codes[idx]);
+		idx += 2;
+		if (idx >= count)
+			idx = 1;
+	}
+	do_not_optimize(m.size());
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_wt_hashmap_insert_erase)->arg(1024);
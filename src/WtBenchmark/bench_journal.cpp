@@ -0,0 +1,119 @@
+﻿#include "WtBench.hpp"
+#include "BenchData.hpp"
+#include "../Share/BoostFile.hpp"
+#include "../Share/WtTickJournal.hpp"
+
+#include <fstream>
+
+USING_NS_WTP;
+using namespace wtbench;
+
+/*
+ *	模拟WtDataWriter::pipeToTicks的热路径
+ *	每个tick先拷贝到实时数据块,打开savelog的时候再写日志
+ *	迭代次数固定,日志文件每轮删掉,避免把磁盘写满
+ */
+static const uint32_t TICK_COUNT = 4096;
+static const uint64_t ITER_COUNT = 200000;
+static const char* BENCH_FOLDER = "./bench_journal/";
+
+static const std::vector<WTSTickStruct>& get_ticks()
+{
+	static std::vector<WTSTickStruct> _ticks;
+	if (_ticks.empty())
+		benchdata::make_ticks("rb2401", 20231128, TICK_COUNT, _ticks);
+	return _ticks;
+}
+
+/*
+ *	不写日志,只拷贝到实时数据块
+ */
+static void bm_tick_log_off(BenchState& state)
+{
+	const std::vector<WTSTickStruct>& ticks = get_ticks();
+	std::vector<WTSTickStruct> block(TICK_COUNT);
+
+	uint32_t idx = 0;
+	for (auto _ : state)
+	{
+		memcpy(&block[idx], &ticks[idx], sizeof(WTSTickStruct));
+		idx = (idx + 1 == TICK_COUNT) ? 0 : idx + 1;
+	}
+	do_not_optimize(block.data());
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_tick_log_off)->iterations(ITER_COUNT);
+
+/*
+ *	原来的做法,每个tick格式化一行csv,用std::endl写到文件
+ */
+static void bm_tick_log_csv(BenchState& state)
+{
+	const std::vector<WTSTickStruct>& ticks = get_ticks();
+	std::vector<WTSTickStruct> block(TICK_COUNT);
+
+	BoostFile::create_directories(BENCH_FOLDER);
+	std::string filename = std::string(BENCH_FOLDER) + "rb2401.20231128.csv";
+	BoostFile::delete_file(filename.c_str());
+	std::ofstream ofs(filename.c_str(), std::ios_base::app);
+
+	uint32_t idx = 0;
+	for (auto _ : state)
+	{
+		const WTSTickStruct& ts = ticks[idx];
+		memcpy(&block[idx], &ts, sizeof(WTSTickStruct));
+		ofs << ts.code << ","
+			<< ts.trading_date << ","
+			<< ts.action_date << ","
+			<< ts.action_time << ","
+			<< TimeUtils::getLocalTime(false) << ","
+			<< ts.price << ","
+			<< ts.total_volume << ","
+			<< ts.open_interest << ","
+			<< (uint64_t)ts.total_turnover << ","
+			<< ts.volume << ","
+			<< ts.diff_interest << ","
+			<< (uint64_t)ts.turn_over << std::endl;
+		idx = (idx + 1 == TICK_COUNT) ? 0 : idx + 1;
+	}
+	ofs.close();
+	BoostFile::delete_file(filename.c_str());
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_tick_log_csv)->iterations(ITER_COUNT);
+
+/*
+ *	流水日志,写入线程只入队,后台线程写内存映射文件,每秒刷一次盘
+ *	arg为队列长度,后台线程跟不上的时候会丢数据,丢了多少记在label里
+ */
+static void bm_tick_log_journal(BenchState& state)
+{
+	const std::vector<WTSTickStruct>& ticks = get_ticks();
+	std::vector<WTSTickStruct> block(TICK_COUNT);
+
+	std::string filename = WtTickJournal::filename(BENCH_FOLDER, 20231128);
+	BoostFile::delete_file(filename.c_str());
+
+	WtTickJournal jnl(BENCH_FOLDER, 256 * 1024, 1000, (uint32_t)state.arg());
+	jnl.start();
+
+	//和运行中的落地程序一样,先让文件打开,后面的页也预先写好
+	jnl.append(ticks[0]);
+	while (jnl.written() == 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	uint32_t idx = 0;
+	for (auto _ : state)
+	{
+		memcpy(&block[idx], &ticks[idx], sizeof(WTSTickStruct));
+		jnl.append(ticks[idx]);
+		idx = (idx + 1 == TICK_COUNT) ? 0 : idx + 1;
+	}
+
+	jnl.stop();
+	state.set_label(fmt::format("dropped: {}, waited: {}", jnl.dropped(), jnl.waited()));
+	BoostFile::delete_file(filename.c_str());
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_tick_log_journal)->arg(8192)->arg(65536)->iterations(ITER_COUNT);
@@ -0,0 +1,80 @@
+﻿#include "WtBench.hpp"
+#include "../Includes/WTSCollection.hpp"
+#include "../Includes/WTSDataDef.hpp"
+#include "../Share/WtSpscRing.hpp"
+
+USING_NS_WTP;
+using namespace wtbench;
+
+/*
+ *	普通的WTSObject,每次都走new/delete
+ */
+static void bm_object_create_release(BenchState& state)
+{
+	for (auto _ : state)
+	{
+		WTSArray* ay = WTSArray::create();
+		do_not_optimize(ay);
+		ay->release();
+	}
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_object_create_release)->threads(1)->threads(4);
+
+/*
+ *	对象池里的tick,同一个线程分配和释放
+ */
+static void bm_tick_create_release(BenchState& state)
+{
+	for (auto _ : state)
+	{
+		WTSTickData* tick = WTSTickData::create("SHFE.rb.2401");
+		do_not_optimize(tick);
+		tick->release();
+	}
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_tick_create_release)->threads(1)->threads(2)->threads(4)->threads(8);
+
+/*
+ *	行情线程分配,策略线程释放,和实盘里tick的生命周期一样
+ */
+static void bm_tick_cross_thread_release(BenchState& state)
+{
+	static WtSpscRing<WTSTickData*> ring(4096);
+
+	if (state.thread_index() == 0)
+	{
+		for (auto _ : state)
+		{
+			WTSTickData* tick = WTSTickData::create("SHFE.rb.2401");
+			while (!ring.push([tick](WTSTickData*& item) { item = tick; }))
+				std::this_thread::yield();
+		}
+	}
+	else
+	{
+		for (auto _ : state)
+		{
+			while (!ring.pop([](WTSTickData*& item) { item->release(); }))
+				std::this_thread::yield();
+		}
+		state.set_items_processed(state.iterations());
+	}
+}
+WT_BENCHMARK(bm_tick_cross_thread_release)->threads(2);
+
+/*
+ *	tick引用计数,引擎把同一笔tick推给多个策略的时候用
+ */
+static void bm_tick_retain_release(BenchState& state)
+{
+	static WTSTickData* tick = WTSTickData::create("SHFE.rb.2401");
+	for (auto _ : state)
+	{
+		tick->retain();
+		tick->release();
+	}
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_tick_retain_release)->threads(1)->threads(4);
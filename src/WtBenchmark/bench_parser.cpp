@@ -0,0 +1,197 @@
+﻿#include "WtBench.hpp"
+#include "BenchData.hpp"
+#include "../Includes/FasterDefs.h"
+#include "../Includes/WTSStruct.h"
+#include "../Share/WtSubBitset.hpp"
+
+USING_NS_WTP;
+using namespace wtbench;
+
+/*
+ *	模拟沪深全市场的逐笔推送,5000只股票,沪深各一半
+ *	成交在股票之间随机分布,和实盘一样,订阅的只是其中很少一部分
+ */
+static const uint32_t MARKET_SIZE = 5000;
+static const uint32_t FEED_SIZE = 64 * 1024;
+
+static void make_market(std::vector<std::pair<std::string, std::string>>& market)
+{
+	market.clear();
+	for (uint32_t i = 0; i < MARKET_SIZE; i++)
+	{
+		if (i % 2 == 0)
+			market.emplace_back("SSE", fmt::format("{:06d}", 600000 + i / 2));
+		else
+			market.emplace_back("SZSE", fmt::format("{:06d}", 1 + i / 2));
+	}
+}
+
+static void make_feed(const std::vector<std::pair<std::string, std::string>>& market, std::vector<WTSTransStruct>& feed)
+{
+	benchdata::BenchRandom rnd(20231127);
+	feed.resize(FEED_SIZE);
+	for (uint32_t i = 0; i < FEED_SIZE; i++)
+	{
+		uint32_t pos = rnd.next() % MARKET_SIZE;
+		const auto& item = market[pos];
+		WTSTransStruct& ts = feed[i];
+		strcpy(ts.exchg, item.first.c_str());
+		strcpy(ts.code, item.second.c_str());
+		ts.index = pos;	//在全市场里的序号,当作合约索引用
+		ts.price = 10.01;
+		ts.volume = 100;
+	}
+}
+
+/*
+ *	订阅arg只股票,均匀地从全市场里挑
+ */
+static void make_subs(const std::vector<std::pair<std::string, std::string>>& market, uint32_t count, CodeSet& subs)
+{
+	uint32_t step = MARKET_SIZE / count;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const auto& item = market[i * step];
+		subs.insert(fmt::format("{}.{}", item.first, item.second));
+	}
+}
+
+/*
+ *	原来的做法,每笔数据拼全代码,再到订阅集合里查
+ */
+static void bm_parser_filter_codeset(BenchState& state)
+{
+	std::vector<std::pair<std::string, std::string>> market;
+	std::vector<WTSTransStruct> feed;
+	make_market(market);
+	make_feed(market, feed);
+
+	CodeSet subs;
+	make_subs(market, (uint32_t)state.arg(), subs);
+
+	uint32_t idx = 0;
+	uint64_t passed = 0;
+	for (auto _ : state)
+	{
+		const WTSTransStruct& ts = feed[idx];
+		const char* fullCode = fmtutil::format("{}.{}", ts.exchg, ts.code);
+		passed += (subs.find(fullCode) != subs.end());
+		idx = (idx + 1 == FEED_SIZE) ? 0 : idx + 1;
+	}
+	do_not_optimize(passed);
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_parser_filter_codeset)->arg(20)->arg(500);
+
+/*
+ *	ParserShm和ParserUDP的做法,先按交易所和代码查合约,再测试合约索引对应的位
+ *	合约查询下游本来也要做,查到的合约会带给ParserAdapter,这里模拟基础数据按交易所分组的两级查找
+ */
+static void bm_parser_filter_contract_bits(BenchState& state)
+{
+	std::vector<std::pair<std::string, std::string>> market;
+	std::vector<WTSTransStruct> feed;
+	make_market(market);
+	make_feed(market, feed);
+
+	wt_hashmap<std::string, wt_hashmap<std::string, uint32_t>> contracts;
+	for (uint32_t i = 0; i < MARKET_SIZE; i++)
+		contracts[market[i].first][market[i].second] = i;
+
+	WtSubBitset bits;
+	uint32_t step = MARKET_SIZE / (uint32_t)state.arg();
+	for (uint32_t i = 0; i < (uint32_t)state.arg(); i++)
+		bits.set(i * step);
+
+	uint32_t idx = 0;
+	uint64_t passed = 0;
+	for (auto _ : state)
+	{
+		const WTSTransStruct& ts = feed[idx];
+		auto it = contracts.find(ts.exchg);
+		if (it != contracts.end())
+		{
+			auto cit = it->second.find(ts.code);
+			if (cit != it->second.end())
+				passed += bits.test(cit->second);
+		}
+		idx = (idx + 1 == FEED_SIZE) ? 0 : idx + 1;
+	}
+	do_not_optimize(passed);
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_parser_filter_contract_bits)->arg(20)->arg(500);
+
+/*
+ *	ParserXTP的做法,数字代码直接作为索引,不用查合约
+ */
+static void bm_parser_filter_ticker_bits(BenchState& state)
+{
+	std::vector<std::pair<std::string, std::string>> market;
+	std::vector<WTSTransStruct> feed;
+	make_market(market);
+	make_feed(market, feed);
+
+	WtSubBitset bitsSH, bitsSZ;
+	uint32_t step = MARKET_SIZE / (uint32_t)state.arg();
+	for (uint32_t i = 0; i < (uint32_t)state.arg(); i++)
+	{
+		const auto& item = market[i * step];
+		WtSubBitset& bits = (item.first == "SSE") ? bitsSH : bitsSZ;
+		bits.set(WtSubBitset::numeric_index(item.second.c_str()));
+	}
+
+	uint32_t idx = 0;
+	uint64_t passed = 0;
+	for (auto _ : state)
+	{
+		const WTSTransStruct& ts = feed[idx];
+		const WtSubBitset& bits = (ts.exchg[1] == 'S') ? bitsSH : bitsSZ;
+		passed += bits.test(WtSubBitset::numeric_index(ts.code));
+		idx = (idx + 1 == FEED_SIZE) ? 0 : idx + 1;
+	}
+	do_not_optimize(passed);
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_parser_filter_ticker_bits)->arg(20)->arg(500);
+
+/*
+ *	运行中增减订阅,一个线程接收行情测试订阅位,另一个线程不停地订阅和退订
+ *	看看接收线程有没有受到影响
+ */
+static WtSubBitset g_resub_bits;
+static void bm_parser_filter_resubscribe(BenchState& state)
+{
+	std::vector<std::pair<std::string, std::string>> market;
+	std::vector<WTSTransStruct> feed;
+	make_market(market);
+	make_feed(market, feed);
+
+	uint32_t step = MARKET_SIZE / 20;
+	for (uint32_t i = 0; i < 20; i++)
+		g_resub_bits.set(i * step);
+
+	uint32_t idx = 0;
+	uint64_t passed = 0;
+	if (state.thread_index() == 0)
+	{
+		for (auto _ : state)
+		{
+			passed += g_resub_bits.test((uint32_t)feed[idx].index);
+			idx = (idx + 1 == FEED_SIZE) ? 0 : idx + 1;
+		}
+	}
+	else
+	{
+		for (auto _ : state)
+		{
+			uint32_t code = idx * step + 1;
+			g_resub_bits.set(code);
+			g_resub_bits.reset(code);
+			idx = (idx + 1 == 20) ? 0 : idx + 1;
+		}
+	}
+	do_not_optimize(passed);
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_parser_filter_resubscribe)->threads(2);
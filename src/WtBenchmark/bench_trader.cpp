@@ -0,0 +1,210 @@
+﻿#include "WtBench.hpp"
+#include "BenchData.hpp"
+#include "../Includes/WTSContractInfo.hpp"
+#include "../Includes/WTSCollection.hpp"
+#include "../Includes/WTSRiskDef.hpp"
+#include "../Includes/FasterDefs.h"
+#include "../Share/CodeHelper.hpp"
+#include "../Share/StrUtil.hpp"
+
+#include <atomic>
+
+USING_NS_WTP;
+using namespace wtbench;
+using namespace benchdata;
+
+/*
+ *	交易通道回报路径的基准测试
+ *	回放一组合成的订单回报,比较每次回报都转换标准代码、查统计数据
+ *	和下单时登记槽位、回报时直接定位两种方式的开销
+ */
+namespace
+{
+	typedef WTSHashMap<std::string> TradeStatMap;
+
+	class TraderFixture
+	{
+	public:
+		TraderFixture(uint32_t cntCodes)
+		{
+			_comm = WTSCommodityInfo::create("rb", "螺纹钢", "SHFE", "FN2300", "CHINA");
+			_comm->setCategory(CC_Future);
+
+			for (uint32_t i = 0; i < cntCodes; i++)
+			{
+				std::string code = fmt::format("rb{}", 2401 + i);
+				WTSContractInfo* cInfo = WTSContractInfo::create(code.c_str(), code.c_str(), "SHFE", "rb");
+				cInfo->setCommInfo(_comm);
+				_contracts.emplace_back(cInfo);
+			}
+
+			_stats = TradeStatMap::create();
+
+			//合成的回报序列,本地订单号递增,合约随机
+			BenchRandom rnd;
+			for (uint32_t i = 0; i < 4096; i++)
+			{
+				uint32_t localid = i + 1;
+				_returns.emplace_back(localid, _contracts[rnd.next() % cntCodes]);
+				_usertags.emplace_back(fmt::format("otp.bench.{}", localid));
+			}
+		}
+
+		~TraderFixture()
+		{
+			for (WTSContractInfo* cInfo : _contracts)
+				cInfo->release();
+			_comm->release();
+			_stats->release();
+		}
+
+	public:
+		WTSCommodityInfo*				_comm;
+		std::vector<WTSContractInfo*>	_contracts;
+		TradeStatMap*					_stats;
+		std::vector<std::pair<uint32_t, WTSContractInfo*>>	_returns;
+		std::vector<std::string>		_usertags;
+	};
+
+	inline uint32_t parse_localid(const std::string& usertag, const std::string& pattern)
+	{
+		if (!StrUtil::startsWith(usertag.c_str(), pattern.c_str(), true))
+			return 0;
+
+		return strtoul(usertag.c_str() + pattern.size() + 1, NULL, 10);
+	}
+
+	typedef struct _CodeSlot
+	{
+		std::string			_std_code;
+		WTSTradeStateInfo*	_stat;
+	} CodeSlot;
+
+	typedef struct _OrdSlot
+	{
+		std::atomic<uint32_t>	_localid;
+		std::atomic<CodeSlot*>	_code;
+
+		_OrdSlot() :_localid(0), _code(NULL) {}
+	} OrdSlot;
+}
+
+/*
+ *	原来的方式:每笔回报都转换标准代码,再按标准代码查统计数据
+ */
+static void bm_order_return_by_code(BenchState& state)
+{
+	TraderFixture fixture((uint32_t)state.arg());
+	std::string pattern = "otp.bench";
+
+	std::size_t idx = 0;
+	for (auto _ : state)
+	{
+		const auto& item = fixture._returns[idx];
+		uint32_t localid = parse_localid(fixture._usertags[idx], pattern);
+		WTSContractInfo* cInfo = item.second;
+
+		std::string stdCode;
+		if (CodeHelper::isMonthlyCode(cInfo->getCode()))
+			stdCode = CodeHelper::rawMonthCodeToStdCode(cInfo->getCode(), cInfo->getExchg());
+		else
+			stdCode = CodeHelper::rawFlatCodeToStdCode(cInfo->getCode(), cInfo->getExchg(), cInfo->getProduct());
+
+		WTSTradeStateInfo* statInfo = (WTSTradeStateInfo*)fixture._stats->get(stdCode);
+		if (statInfo == NULL)
+		{
+			statInfo = WTSTradeStateInfo::create(stdCode.c_str());
+			fixture._stats->add(stdCode, statInfo, false);
+		}
+		statInfo->statInfo().b_orders++;
+		do_not_optimize(localid);
+
+		idx = (idx + 1) & 4095;
+	}
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_order_return_by_code)->arg(8)->arg(256);
+
+/*
+ *	槽位的方式:下单时登记,回报按本地订单号直接定位
+ */
+static void bm_order_return_by_slot(BenchState& state)
+{
+	TraderFixture fixture((uint32_t)state.arg());
+	std::string pattern = "otp.bench";
+
+	wt_hashmap<WTSContractInfo*, std::shared_ptr<CodeSlot>> codeSlots;
+	std::vector<OrdSlot> ordSlots(4096);
+	for (const auto& item : fixture._returns)
+	{
+		WTSContractInfo* cInfo = item.second;
+		auto& slot = codeSlots[cInfo];
+		if (!slot)
+		{
+			slot.reset(new CodeSlot);
+			slot->_std_code = CodeHelper::rawMonthCodeToStdCode(cInfo->getCode(), cInfo->getExchg());
+			slot->_stat = WTSTradeStateInfo::create(slot->_std_code.c_str());
+			fixture._stats->add(slot->_std_code, slot->_stat, false);
+		}
+
+		OrdSlot& oSlot = ordSlots[item.first & 4095];
+		oSlot._code.store(slot.get(), std::memory_order_release);
+		oSlot._localid.store(item.first, std::memory_order_release);
+	}
+
+	std::size_t idx = 0;
+	for (auto _ : state)
+	{
+		uint32_t localid = parse_localid(fixture._usertags[idx], pattern);
+
+		OrdSlot& oSlot = ordSlots[localid & 4095];
+		CodeSlot* slot = NULL;
+		if (oSlot._localid.load(std::memory_order_acquire) == localid)
+			slot = oSlot._code.load(std::memory_order_acquire);
+
+		slot->_stat->statInfo().b_orders++;
+		do_not_optimize(slot->_std_code);
+
+		idx = (idx + 1) & 4095;
+	}
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_order_return_by_slot)->arg(8)->arg(256);
+
+/*
+ *	CTP回报里的时间转换,原来先拷贝再去掉冒号
+ */
+static void bm_ctp_time_replace(BenchState& state)
+{
+	const char* times[] = { "09:30:01", "14:59:59", "21:00:00", "23:15:42" };
+	uint32_t idx = 0;
+	for (auto _ : state)
+	{
+		std::string strTime = times[idx++ & 3];
+		StrUtil::replace(strTime, ":", "");
+		uint32_t uTime = strtoul(strTime.c_str(), NULL, 10);
+		do_not_optimize(uTime);
+	}
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_ctp_time_replace);
+
+static void bm_ctp_time_inplace(BenchState& state)
+{
+	const char* times[] = { "09:30:01", "14:59:59", "21:00:00", "23:15:42" };
+	uint32_t idx = 0;
+	for (auto _ : state)
+	{
+		uint32_t uTime = 0;
+		for (const char* pos = times[idx++ & 3]; *pos != '\0'; pos++)
+		{
+			if (*pos == ':')
+				continue;
+
+			uTime = uTime * 10 + (*pos - '0');
+		}
+		do_not_optimize(uTime);
+	}
+	state.set_items_processed(state.iterations());
+}
+WT_BENCHMARK(bm_ctp_time_inplace);
@@ -0,0 +1,20 @@
+﻿#include "WtBench.hpp"
+#include "../WtBtCore/WtHelper.h"
+#include "../WTSTools/WTSLogger.h"
+#include "../Share/StrUtil.hpp"
+
+#include <boost/filesystem.hpp>
+
+int main(int argc, char* argv[])
+{
+	//回测和撮合里有不少日志,只输出错误,不然会影响结果
+	WTSLogger::init("{\"root\":{\"async\":false,\"level\":\"error\",\"sinks\":[{\"type\":\"console_sink\",\"pattern\":\"[%m.%d %H:%M:%S - %^%-5l%$] %v\"}]}}", false);
+
+	//回放器按模块目录加载WtDataStorage,和回测程序一样放在可执行文件的目录下
+	boost::filesystem::path binDir = boost::filesystem::system_complete(argv[0]).parent_path();
+	WtHelper::setInstDir(StrUtil::standardisePath(binDir.string()).c_str());
+
+	int ret = wtbench::BenchRegistry::run(argc, argv);
+	WTSLogger::stop();
+	return ret;
+}
@@ -0,0 +1,200 @@
+﻿/*!
+ * \file BtOutputDefs.h
+ * \project	WonderTrader
+ *
+ * \brief 回测输出的二进制表结构定义
+ *
+ * 每张表一个文件,文件格式见WtRecordTable
+ * 回测引擎写入,WtDtHelper负责转换成csv和给python读取,两边共用这里的定义
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "../Includes/WTSMarcos.h"
+#include "../Share/WtRecordTable.hpp"
+
+#define BT_TAG_LENGTH	64
+
+//表名,同时也是文件名
+#define BT_TABLE_TRADES		"trades"
+#define BT_TABLE_CLOSES		"closes"
+#define BT_TABLE_FUNDS		"funds"
+#define BT_TABLE_POSITIONS	"positions"
+#define BT_TABLE_SIGNALS	"signals"
+
+#define BT_TABLE_FILE_EXT	".bin"
+
+//表的来源,同名的表不同引擎的格式可能不同
+#define BT_FLAVOR_CTA	"cta"
+#define BT_FLAVOR_HFT	"hft"
+#define BT_FLAVOR_UFT	"uft"
+
+NS_WTP_BEGIN
+
+#pragma pack(push, 8)
+/*
+ *	成交记录
+ *	action: 0-开仓,1-平仓,2-平今,CTA和HFT只有开平
+ */
+typedef struct _BtTradeRecord
+{
+	char		code[MAX_INSTRUMENT_LENGTH];
+	uint64_t	time;
+	double		price;
+	double		qty;
+	double		fee;
+	uint32_t	barno;
+	uint8_t		direct;		//1-多,0-空
+	uint8_t		action;
+	char		usertag[BT_TAG_LENGTH];
+} BtTradeRecord;
+
+/*
+ *	平仓记录
+ */
+typedef struct _BtCloseRecord
+{
+	char		code[MAX_INSTRUMENT_LENGTH];
+	uint64_t	opentime;
+	double		openprice;
+	uint64_t	closetime;
+	double		closeprice;
+	double		qty;
+	double		profit;
+	double		maxprofit;
+	double		maxloss;
+	double		totalprofit;
+	uint32_t	openbarno;
+	uint32_t	closebarno;
+	uint8_t		direct;
+	char		entertag[BT_TAG_LENGTH];
+	char		exittag[BT_TAG_LENGTH];
+} BtCloseRecord;
+
+/*
+ *	每日资金
+ */
+typedef struct _BtFundRecord
+{
+	uint32_t	date;
+	double		closeprofit;
+	double		positionprofit;
+	double		dynbalance;
+	double		fee;
+} BtFundRecord;
+
+/*
+ *	每日持仓
+ *	UFT分多空记录,direct有效,其他引擎的volume带符号
+ */
+typedef struct _BtPositionRecord
+{
+	uint32_t	date;
+	uint8_t		direct;
+	char		code[MAX_INSTRUMENT_LENGTH];
+	double		volume;
+	double		closeprofit;
+	double		dynprofit;
+} BtPositionRecord;
+
+/*
+ *	CTA的信号记录
+ */
+typedef struct _BtSignalRecord
+{
+	char		code[MAX_INSTRUMENT_LENGTH];
+	double		target;
+	double		sigprice;
+	uint64_t	gentime;
+	char		usertag[BT_TAG_LENGTH];
+} BtSignalRecord;
+
+/*
+ *	HFT的信号记录,实际是每一笔成交以后的仓位
+ *	qty带符号,正数为买,负数为卖
+ */
+typedef struct _BtHftSignalRecord
+{
+	uint32_t	date;
+	uint32_t	time;
+	uint32_t	secs;
+	double		qty;
+	double		position;
+	double		price;
+} BtHftSignalRecord;
+#pragma pack(pop)
+
+#define BT_COLUMN(type, field, dtype) { #field, dtype, (uint32_t)offsetof(type, field), (uint32_t)sizeof(((type*)0)->field) }
+#define BT_COLUMN_COUNT(cols) (uint32_t)(sizeof(cols)/sizeof(WtRecColumn))
+
+static const WtRecColumn BT_TRADE_COLUMNS[] =
+{
+	BT_COLUMN(BtTradeRecord, code, "|S32"),
+	BT_COLUMN(BtTradeRecord, time, "<u8"),
+	BT_COLUMN(BtTradeRecord, price, "<f8"),
+	BT_COLUMN(BtTradeRecord, qty, "<f8"),
+	BT_COLUMN(BtTradeRecord, fee, "<f8"),
+	BT_COLUMN(BtTradeRecord, barno, "<u4"),
+	BT_COLUMN(BtTradeRecord, direct, "|u1"),
+	BT_COLUMN(BtTradeRecord, action, "|u1"),
+	BT_COLUMN(BtTradeRecord, usertag, "|S64")
+};
+
+static const WtRecColumn BT_CLOSE_COLUMNS[] =
+{
+	BT_COLUMN(BtCloseRecord, code, "|S32"),
+	BT_COLUMN(BtCloseRecord, opentime, "<u8"),
+	BT_COLUMN(BtCloseRecord, openprice, "<f8"),
+	BT_COLUMN(BtCloseRecord, closetime, "<u8"),
+	BT_COLUMN(BtCloseRecord, closeprice, "<f8"),
+	BT_COLUMN(BtCloseRecord, qty, "<f8"),
+	BT_COLUMN(BtCloseRecord, profit, "<f8"),
+	BT_COLUMN(BtCloseRecord, maxprofit, "<f8"),
+	BT_COLUMN(BtCloseRecord, maxloss, "<f8"),
+	BT_COLUMN(BtCloseRecord, totalprofit, "<f8"),
+	BT_COLUMN(BtCloseRecord, openbarno, "<u4"),
+	BT_COLUMN(BtCloseRecord, closebarno, "<u4"),
+	BT_COLUMN(BtCloseRecord, direct, "|u1"),
+	BT_COLUMN(BtCloseRecord, entertag, "|S64"),
+	BT_COLUMN(BtCloseRecord, exittag, "|S64")
+};
+
+static const WtRecColumn BT_FUND_COLUMNS[] =
+{
+	BT_COLUMN(BtFundRecord, date, "<u4"),
+	BT_COLUMN(BtFundRecord, closeprofit, "<f8"),
+	BT_COLUMN(BtFundRecord, positionprofit, "<f8"),
+	BT_COLUMN(BtFundRecord, dynbalance, "<f8"),
+	BT_COLUMN(BtFundRecord, fee, "<f8")
+};
+
+static const WtRecColumn BT_POSITION_COLUMNS[] =
+{
+	BT_COLUMN(BtPositionRecord, date, "<u4"),
+	BT_COLUMN(BtPositionRecord, direct, "|u1"),
+	BT_COLUMN(BtPositionRecord, code, "|S32"),
+	BT_COLUMN(BtPositionRecord, volume, "<f8"),
+	BT_COLUMN(BtPositionRecord, closeprofit, "<f8"),
+	BT_COLUMN(BtPositionRecord, dynprofit, "<f8")
+};
+
+static const WtRecColumn BT_SIGNAL_COLUMNS[] =
+{
+	BT_COLUMN(BtSignalRecord, code, "|S32"),
+	BT_COLUMN(BtSignalRecord, target, "<f8"),
+	BT_COLUMN(BtSignalRecord, sigprice, "<f8"),
+	BT_COLUMN(BtSignalRecord, gentime, "<u8"),
+	BT_COLUMN(BtSignalRecord, usertag, "|S64")
+};
+
+static const WtRecColumn BT_HFT_SIGNAL_COLUMNS[] =
+{
+	BT_COLUMN(BtHftSignalRecord, date, "<u4"),
+	BT_COLUMN(BtHftSignalRecord, time, "<u4"),
+	BT_COLUMN(BtHftSignalRecord, secs, "<u4"),
+	BT_COLUMN(BtHftSignalRecord, qty, "<f8"),
+	BT_COLUMN(BtHftSignalRecord, position, "<f8"),
+	BT_COLUMN(BtHftSignalRecord, price, "<f8")
+};
+
+NS_WTP_END
@@ -0,0 +1,218 @@
+﻿/*!
+ * \file BtOutputStore.cpp
+ * \project	WonderTrader
+ *
+ * \brief
+ */
+#include "BtOutputStore.h"
+
+#include "../Share/StrUtil.hpp"
+#include "../WTSTools/WTSLogger.h"
+
+#include <boost/filesystem.hpp>
+
+USING_NS_WTP;
+
+inline void copy_str(char* dest, const char* src, std::size_t maxLen)
+{
+	if (src == NULL)
+		return;
+
+	strncpy(dest, src, maxLen - 1);
+}
+
+BtOutputStore::BtOutputStore()
+	: _ready(false)
+	, _stopped(false)
+	, _flush_span(0)
+{
+}
+
+BtOutputStore::~BtOutputStore()
+{
+	close();
+}
+
+bool BtOutputStore::create_table(WtRecordTable& table, const char* name, const WtRecColumn* cols, uint32_t colCnt, uint32_t recSize)
+{
+	std::string filename = _folder + name + BT_TABLE_FILE_EXT;
+	if (!table.create(filename.c_str(), name, _flavor.c_str(), cols, colCnt, recSize))
+	{
+		WTSLogger::error("Creating backtest output table {} failed", filename);
+		return false;
+	}
+
+	return true;
+}
+
+bool BtOutputStore::init(const char* folder, const char* flavor, uint32_t flushSpan /* = 1000 */)
+{
+	close();
+
+	_folder = StrUtil::standardisePath(folder);
+	_flavor = flavor;
+	boost::filesystem::create_directories(_folder.c_str());
+
+	bool bSucc = create_table(_trades, BT_TABLE_TRADES, BT_TRADE_COLUMNS, BT_COLUMN_COUNT(BT_TRADE_COLUMNS), sizeof(BtTradeRecord));
+	bSucc = bSucc && create_table(_closes, BT_TABLE_CLOSES, BT_CLOSE_COLUMNS, BT_COLUMN_COUNT(BT_CLOSE_COLUMNS), sizeof(BtCloseRecord));
+	bSucc = bSucc && create_table(_funds, BT_TABLE_FUNDS, BT_FUND_COLUMNS, BT_COLUMN_COUNT(BT_FUND_COLUMNS), sizeof(BtFundRecord));
+	bSucc = bSucc && create_table(_positions, BT_TABLE_POSITIONS, BT_POSITION_COLUMNS, BT_COLUMN_COUNT(BT_POSITION_COLUMNS), sizeof(BtPositionRecord));
+
+	//UFT没有信号,HFT的信号是成交以后的仓位,格式和CTA不同
+	if (bSucc && _flavor == BT_FLAVOR_CTA)
+		bSucc = create_table(_signals, BT_TABLE_SIGNALS, BT_SIGNAL_COLUMNS, BT_COLUMN_COUNT(BT_SIGNAL_COLUMNS), sizeof(BtSignalRecord));
+	else if (bSucc && _flavor == BT_FLAVOR_HFT)
+		bSucc = create_table(_signals, BT_TABLE_SIGNALS, BT_HFT_SIGNAL_COLUMNS, BT_COLUMN_COUNT(BT_HFT_SIGNAL_COLUMNS), sizeof(BtHftSignalRecord));
+
+	if (!bSucc)
+	{
+		close();
+		return false;
+	}
+
+	_ready = true;
+	_stopped = false;
+	_flush_span = flushSpan;
+	if (_flush_span > 0)
+	{
+		_flush_thrd.reset(new StdThread([this]() {
+			while (!_stopped)
+			{
+				{
+					StdUniqueLock lock(_flush_mtx);
+					_flush_cond.wait_for(lock, std::chrono::milliseconds(_flush_span));
+				}
+
+				if (_stopped)
+					break;
+
+				flush_all();
+			}
+		}));
+	}
+
+	WTSLogger::info("Backtest outputs will be written into binary tables in {}", _folder);
+	return true;
+}
+
+void BtOutputStore::flush_all()
+{
+	_trades.sync();
+	_closes.sync();
+	_funds.sync();
+	_positions.sync();
+	_signals.sync();
+}
+
+void BtOutputStore::close()
+{
+	if (_flush_thrd)
+	{
+		{
+			StdUniqueLock lock(_flush_mtx);
+			_stopped = true;
+			_flush_cond.notify_all();
+		}
+		_flush_thrd->join();
+		_flush_thrd.reset();
+	}
+
+	_trades.close();
+	_closes.close();
+	_funds.close();
+	_positions.close();
+	_signals.close();
+
+	_ready = false;
+}
+
+void BtOutputStore::log_trade(const char* stdCode, bool isLong, uint8_t action, uint64_t curTime, double price, double qty,
+	double fee, const char* userTag /* = "" */, uint32_t barNo /* = 0 */)
+{
+	BtTradeRecord rec;
+	memset(&rec, 0, sizeof(rec));
+	copy_str(rec.code, stdCode, sizeof(rec.code));
+	rec.time = curTime;
+	rec.price = price;
+	rec.qty = qty;
+	rec.fee = fee;
+	rec.barno = barNo;
+	rec.direct = isLong ? 1 : 0;
+	rec.action = action;
+	copy_str(rec.usertag, userTag, sizeof(rec.usertag));
+	_trades.append(&rec);
+}
+
+void BtOutputStore::log_close(const char* stdCode, bool isLong, uint64_t openTime, double openpx, uint64_t closeTime, double closepx, double qty,
+	double profit, double maxprofit, double maxloss, double totalprofit /* = 0 */, const char* enterTag /* = "" */, const char* exitTag /* = "" */,
+	uint32_t openBarNo /* = 0 */, uint32_t closeBarNo /* = 0 */)
+{
+	BtCloseRecord rec;
+	memset(&rec, 0, sizeof(rec));
+	copy_str(rec.code, stdCode, sizeof(rec.code));
+	rec.opentime = openTime;
+	rec.openprice = openpx;
+	rec.closetime = closeTime;
+	rec.closeprice = closepx;
+	rec.qty = qty;
+	rec.profit = profit;
+	rec.maxprofit = maxprofit;
+	rec.maxloss = maxloss;
+	rec.totalprofit = totalprofit;
+	rec.openbarno = openBarNo;
+	rec.closebarno = closeBarNo;
+	rec.direct = isLong ? 1 : 0;
+	copy_str(rec.entertag, enterTag, sizeof(rec.entertag));
+	copy_str(rec.exittag, exitTag, sizeof(rec.exittag));
+	_closes.append(&rec);
+}
+
+void BtOutputStore::log_fund(uint32_t curDate, double closeprofit, double positionprofit, double dynbalance, double fee)
+{
+	BtFundRecord rec;
+	memset(&rec, 0, sizeof(rec));
+	rec.date = curDate;
+	rec.closeprofit = closeprofit;
+	rec.positionprofit = positionprofit;
+	rec.dynbalance = dynbalance;
+	rec.fee = fee;
+	_funds.append(&rec);
+}
+
+void BtOutputStore::log_position(uint32_t curDate, const char* stdCode, bool isLong, double volume, double closeprofit, double dynprofit)
+{
+	BtPositionRecord rec;
+	memset(&rec, 0, sizeof(rec));
+	rec.date = curDate;
+	rec.direct = isLong ? 1 : 0;
+	copy_str(rec.code, stdCode, sizeof(rec.code));
+	rec.volume = volume;
+	rec.closeprofit = closeprofit;
+	rec.dynprofit = dynprofit;
+	_positions.append(&rec);
+}
+
+void BtOutputStore::log_signal(const char* stdCode, double target, double price, uint64_t gentime, const char* usertag /* = "" */)
+{
+	BtSignalRecord rec;
+	memset(&rec, 0, sizeof(rec));
+	copy_str(rec.code, stdCode, sizeof(rec.code));
+	rec.target = target;
+	rec.sigprice = price;
+	rec.gentime = gentime;
+	copy_str(rec.usertag, usertag, sizeof(rec.usertag));
+	_signals.append(&rec);
+}
+
+void BtOutputStore::log_hft_signal(uint32_t curDate, uint32_t curTime, uint32_t curSecs, double qty, double position, double price)
+{
+	BtHftSignalRecord rec;
+	memset(&rec, 0, sizeof(rec));
+	rec.date = curDate;
+	rec.time = curTime;
+	rec.secs = curSecs;
+	rec.qty = qty;
+	rec.position = position;
+	rec.price = price;
+	_signals.append(&rec);
+}
@@ -0,0 +1,84 @@
+﻿/*!
+ * \file BtOutputStore.h
+ * \project	WonderTrader
+ *
+ * \brief 回测结果的二进制输出
+ *
+ * 回测过程中直接写入内存映射的表,不再先拼到stringstream里最后再一次性写csv
+ * 后台线程定时把映射的内容刷到磁盘,回测中途也能读到已经产生的结果
+ */
+#pragma once
+#include "BtOutputDefs.h"
+#include "../Share/StdUtils.hpp"
+
+#include <atomic>
+
+NS_WTP_BEGIN
+
+class BtOutputStore
+{
+public:
+	BtOutputStore();
+	~BtOutputStore();
+
+public:
+	/*
+	 *	初始化
+	 *	folder		输出目录
+	 *	flavor		cta/hft/uft,决定signals表的格式
+	 *	flushSpan	刷盘间隔,单位毫秒,0为不启动后台刷盘
+	 */
+	bool	init(const char* folder, const char* flavor, uint32_t flushSpan = 1000);
+
+	/*
+	 *	关闭所有表,会截掉多余的预分配空间
+	 */
+	void	close();
+
+	inline bool	is_ready() const { return _ready; }
+
+public:
+	/*
+	 *	action: 0-开仓,1-平仓,2-平今
+	 */
+	void	log_trade(const char* stdCode, bool isLong, uint8_t action, uint64_t curTime, double price, double qty,
+		double fee, const char* userTag = "", uint32_t barNo = 0);
+
+	void	log_close(const char* stdCode, bool isLong, uint64_t openTime, double openpx, uint64_t closeTime, double closepx, double qty,
+		double profit, double maxprofit, double maxloss, double totalprofit = 0, const char* enterTag = "", const char* exitTag = "",
+		uint32_t openBarNo = 0, uint32_t closeBarNo = 0);
+
+	void	log_fund(uint32_t curDate, double closeprofit, double positionprofit, double dynbalance, double fee);
+
+	void	log_position(uint32_t curDate, const char* stdCode, bool isLong, double volume, double closeprofit, double dynprofit);
+
+	void	log_signal(const char* stdCode, double target, double price, uint64_t gentime, const char* usertag = "");
+
+	void	log_hft_signal(uint32_t curDate, uint32_t curTime, uint32_t curSecs, double qty, double position, double price);
+
+private:
+	bool	create_table(WtRecordTable& table, const char* name, const WtRecColumn* cols, uint32_t colCnt, uint32_t recSize);
+
+	void	flush_all();
+
+private:
+	std::string		_folder;
+	std::string		_flavor;
+	bool			_ready;
+
+	WtRecordTable	_trades;
+	WtRecordTable	_closes;
+	WtRecordTable	_funds;
+	WtRecordTable	_positions;
+	WtRecordTable	_signals;
+
+	StdThreadPtr		_flush_thrd;
+	StdUniqueMutex		_flush_mtx;
+	StdCondVariable		_flush_cond;
+	std::atomic<bool>	_stopped;
+	uint32_t			_flush_span;
+};
+
+typedef std::shared_ptr<BtOutputStore> BtOutputStorePtr;
+
+NS_WTP_END
@@ -74,6 +74,7 @@ CtaMocker::CtaMocker(HisDataReplayer* replayer, const char* name, int32_t slippa
 	, _wait_calc(false)
 	, _in_backtest(false)
 	, _persist_data(persistData)
+	, _bin_output(false)
 {
 	_context_id = makeCtxId();
 }
@@ -346,30 +347,41 @@ void CtaMocker::dump_outputs()
 	folder += "/";
 	boost::filesystem::create_directories(folder.c_str());
 
-	std::string filename = folder + "trades.csv";
-	std::string content = "code,time,direct,action,price,qty,tag,fee,barno\n";
-	if(!_trade_logs.str().empty()) content += _trade_logs.str();
-	StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
+	std::string filename;
+	std::string content;
+	if (_out_store)
+	{
+		//二进制输出的时候数据已经在表里了,关闭即可
+		_out_store->close();
+		_out_store.reset();
+	}
+	else
+	{
+		filename = folder + "trades.csv";
+		content = "code,time,direct,action,price,qty,tag,fee,barno\n";
+		if(!_trade_logs.str().empty()) content += _trade_logs.str();
+		StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
 
-	filename = folder + "closes.csv";
-	content = "code,direct,opentime,openprice,closetime,closeprice,qty,profit,maxprofit,maxloss,totalprofit,entertag,exittag,openbarno,closebarno\n";
-	if (!_close_logs.str().empty()) content += _close_logs.str();
-	StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
+		filename = folder + "closes.csv";
+		content = "code,direct,opentime,openprice,closetime,closeprice,qty,profit,maxprofit,maxloss,totalprofit,entertag,exittag,openbarno,closebarno\n";
+		if (!_close_logs.str().empty()) content += _close_logs.str();
+		StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
 
-	filename = folder + "funds.csv";
-	content = "date,closeprofit,positionprofit,dynbalance,fee\n";
-	if (!_fund_logs.str().empty()) content += _fund_logs.str();
-	StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
+		filename = folder + "funds.csv";
+		content = "date,closeprofit,positionprofit,dynbalance,fee\n";
+		if (!_fund_logs.str().empty()) content += _fund_logs.str();
+		StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
 
-	filename = folder + "signals.csv";
-	content = "code,target,sigprice,gentime,usertag\n";
-	if (!_sig_logs.str().empty()) content += _sig_logs.str();
-	StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
+		filename = folder + "signals.csv";
+		content = "code,target,sigprice,gentime,usertag\n";
+		if (!_sig_logs.str().empty()) content += _sig_logs.str();
+		StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
 
-	filename = folder + "positions.csv";
-	content = "date,code,volume,closeprofit,dynprofit\n";
-	if (!_pos_logs.str().empty()) content += _pos_logs.str();
-	StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
+		filename = folder + "positions.csv";
+		content = "date,code,volume,closeprofit,dynprofit\n";
+		if (!_pos_logs.str().empty()) content += _pos_logs.str();
+		StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
+	}
 
 	{
 		rj::Document root(rj::kObjectType);
@@ -393,11 +405,23 @@ void CtaMocker::dump_outputs()
 
 void CtaMocker::log_signal(const char* stdCode, double target, double price, uint64_t gentime, const char* usertag /* = "" */)
 {
+	if (_out_store)
+	{
+		_out_store->log_signal(stdCode, target, price, gentime, usertag);
+		return;
+	}
+
 	_sig_logs << stdCode << "," << target << "," << price << "," << gentime << "," << usertag << "\n";
 }
 
 void CtaMocker::log_trade(const char* stdCode, bool isLong, bool isOpen, uint64_t curTime, double price, double qty, const char* userTag, double fee, uint32_t barNo)
 {
+	if (_out_store)
+	{
+		_out_store->log_trade(stdCode, isLong, isOpen ? 0 : 1, curTime, price, qty, fee, userTag, barNo);
+		return;
+	}
+
 	_trade_logs << stdCode << "," << curTime << "," << (isLong ? "LONG" : "SHORT") << "," << (isOpen ? "OPEN" : "CLOSE") 
 		<< "," << price << "," << qty << "," << userTag << "," << fee << "," << barNo << "\n";
 }
@@ -405,6 +429,13 @@ void CtaMocker::log_trade(const char* stdCode, bool isLong, bool isOpen, uint64_
 void CtaMocker::log_close(const char* stdCode, bool isLong, uint64_t openTime, double openpx, uint64_t closeTime, double closepx, double qty, double profit, double maxprofit, double maxloss, 
 	double totalprofit /* = 0 */, const char* enterTag /* = "" */, const char* exitTag /* = "" */, uint32_t openBarNo /* = 0 */, uint32_t closeBarNo /* = 0 */)
 {
+	if (_out_store)
+	{
+		_out_store->log_close(stdCode, isLong, openTime, openpx, closeTime, closepx, qty, profit, maxprofit, maxloss,
+			totalprofit, enterTag, exitTag, openBarNo, closeBarNo);
+		return;
+	}
+
 	_close_logs << stdCode << "," << (isLong ? "LONG" : "SHORT") << "," << openTime << "," << openpx
 		<< "," << closeTime << "," << closepx << "," << qty << "," << profit << "," << maxprofit << "," << maxloss << ","
 		<< totalprofit << "," << enterTag << "," << exitTag << "," << openBarNo << "," << closeBarNo << "\n";
@@ -456,6 +487,13 @@ void CtaMocker::load_incremental_data(const char* incremental_backtest_base)
 	folder += "/";
 	WTSLogger::info("loading incremental data from: {}", folder);
 
+	//增量回测是把上一次的csv读回来拼在一起,二进制输出不支持
+	if (_bin_output)
+	{
+		WTSLogger::warn("Binary outputs are not supported by incremental backtest, csv outputs will be used");
+		_bin_output = false;
+	}
+
 	std::string tradesFilename = folder + "trades.csv";
 	if (boost::filesystem::exists(tradesFilename))
 	{
@@ -690,6 +728,220 @@ void CtaMocker::handle_replay_done()
 	this->on_bactest_end();
 }
 
+bool CtaMocker::handle_checkpoint(WtCkptWriter& writer)
+{
+	//二进制输出的结果已经写到表里了,不在断点里
+	if (_out_store)
+	{
+		WTSLogger::warn("Checkpoint is not supported with binary outputs");
+		return false;
+	}
+
+	writer.put(_total_calc_time);
+	writer.put(_emit_times);
+	writer.put(_schedule_times);
+	writer.put(_cur_tdate);
+	writer.put(_cur_bartime);
+	writer.put(_last_cond_min);
+	writer.put(_total_closeprofit);
+	writer.put(_fund_info);
+	writer.put(_ud_modified);
+
+	writer.put((uint32_t)_kline_tags.size());
+	for (auto& v : _kline_tags)
+	{
+		writer.put_str(v.first);
+		writer.put(v.second);
+	}
+
+	writer.put((uint32_t)_price_map.size());
+	for (auto& v : _price_map)
+	{
+		writer.put_str(v.first);
+		writer.put(v.second);
+	}
+
+	writer.put((uint32_t)_pos_map.size());
+	for (auto& v : _pos_map)
+	{
+		const PosInfo& pInfo = v.second;
+		writer.put_str(v.first);
+		writer.put(pInfo._volume);
+		writer.put(pInfo._closeprofit);
+		writer.put(pInfo._dynprofit);
+		writer.put(pInfo._last_entertime);
+		writer.put(pInfo._last_exittime);
+		writer.put(pInfo._frozen);
+		writer.put_vec(pInfo._details);
+	}
+
+	writer.put((uint32_t)_sig_map.size());
+	for (auto& v : _sig_map)
+	{
+		const SigInfo& sInfo = v.second;
+		writer.put_str(v.first);
+		writer.put(sInfo._volume);
+		writer.put_str(sInfo._usertag);
+		writer.put(sInfo._sigprice);
+		writer.put(sInfo._desprice);
+		writer.put(sInfo._sigtype);
+		writer.put(sInfo._gentime);
+	}
+
+	writer.put((uint32_t)_condtions.size());
+	for (auto& v : _condtions)
+	{
+		writer.put_str(v.first);
+		writer.put_vec(v.second);
+	}
+
+	writer.put((uint32_t)_user_datas.size());
+	for (auto& v : _user_datas)
+	{
+		writer.put_str(v.first);
+		writer.put_str(v.second);
+	}
+
+	writer.put((uint32_t)_tick_subs.size());
+	for (const std::string& stdCode : _tick_subs)
+		writer.put_str(stdCode);
+
+	writer.put((uint32_t)_ticks.size());
+	for (auto& v : _ticks)
+	{
+		writer.put_str(v.first);
+		writer.put(v.second);
+	}
+
+	writer.put_str(_trade_logs.str());
+	writer.put_str(_close_logs.str());
+	writer.put_str(_fund_logs.str());
+	writer.put_str(_sig_logs.str());
+	writer.put_str(_pos_logs.str());
+	writer.put_str(_index_logs.str());
+	writer.put_str(_mark_logs.str());
+	return true;
+}
+
+bool CtaMocker::handle_restore(WtCkptReader& reader)
+{
+	if (_out_store)
+	{
+		WTSLogger::error("Restoring from checkpoint is not supported with binary outputs");
+		return false;
+	}
+
+	reader.get(_total_calc_time);
+	reader.get(_emit_times);
+	reader.get(_schedule_times);
+	reader.get(_cur_tdate);
+	reader.get(_cur_bartime);
+	reader.get(_last_cond_min);
+	reader.get(_total_closeprofit);
+	reader.get(_fund_info);
+	reader.get(_ud_modified);
+
+	//按保存时的顺序插入,容器的遍历顺序和不中断的回测一致
+	uint32_t cnt = 0;
+	_kline_tags.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string key;
+		reader.get_str(key);
+		reader.get(_kline_tags[key]);
+	}
+
+	_price_map.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		reader.get(_price_map[stdCode]);
+	}
+
+	_pos_map.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		PosInfo& pInfo = _pos_map[stdCode];
+		reader.get(pInfo._volume);
+		reader.get(pInfo._closeprofit);
+		reader.get(pInfo._dynprofit);
+		reader.get(pInfo._last_entertime);
+		reader.get(pInfo._last_exittime);
+		reader.get(pInfo._frozen);
+		reader.get_vec(pInfo._details);
+	}
+
+	_sig_map.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		SigInfo& sInfo = _sig_map[stdCode];
+		reader.get(sInfo._volume);
+		reader.get_str(sInfo._usertag);
+		reader.get(sInfo._sigprice);
+		reader.get(sInfo._desprice);
+		reader.get(sInfo._sigtype);
+		reader.get(sInfo._gentime);
+	}
+
+	_condtions.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		reader.get_vec(_condtions[stdCode]);
+	}
+
+	_user_datas.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string key;
+		reader.get_str(key);
+		reader.get_str(_user_datas[key]);
+	}
+
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		_tick_subs.insert(stdCode);
+	}
+
+	_ticks.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		reader.get(_ticks[stdCode]);
+	}
+
+	reader.get_str(_trade_logs);
+	reader.get_str(_close_logs);
+	reader.get_str(_fund_logs);
+	reader.get_str(_sig_logs);
+	reader.get_str(_pos_logs);
+	reader.get_str(_index_logs);
+	reader.get_str(_mark_logs);
+
+	if (!reader.good())
+		return false;
+
+	WTSLogger::info("Strategy {} restored from checkpoint, {} positions, {} signals, {} user datas", _name, _pos_map.size(), _sig_map.size(), _user_datas.size());
+	return true;
+}
+
 void CtaMocker::proc_tick(const char* stdCode, double last_px, double cur_px)
 {
 	{
@@ -962,6 +1214,16 @@ void CtaMocker::on_init()
 {
 	_ticks.clear();
 	_in_backtest = true;
+
+	if (_bin_output && _persist_data)
+	{
+		std::string folder = WtHelper::getOutputDir();
+		folder += _name;
+		folder += "/";
+		_out_store.reset(new BtOutputStore());
+		if (!_out_store->init(folder.c_str(), BT_FLAVOR_CTA))
+			_out_store.reset();
+	}
 	if (_strategy)
 		_strategy->on_init(this);
 
@@ -1279,13 +1541,20 @@ void CtaMocker::on_session_end(uint32_t curTDate)
 		if(decimal::eq(pInfo._volume, 0.0))
 			continue;
 
-		_pos_logs << fmt::format("{},{},{},{:.2f},{:.2f}\n", curDate, stdCode,
-			pInfo._volume, pInfo._closeprofit, pInfo._dynprofit);
+		if (_out_store)
+			_out_store->log_position(curDate, stdCode, pInfo._volume > 0, pInfo._volume, pInfo._closeprofit, pInfo._dynprofit);
+		else
+			_pos_logs << fmt::format("{},{},{},{:.2f},{:.2f}\n", curDate, stdCode,
+				pInfo._volume, pInfo._closeprofit, pInfo._dynprofit);
 	}
 
-	_fund_logs << fmt::format("{},{:.2f},{:.2f},{:.2f},{:.2f}\n", curDate,
-		_fund_info._total_profit, _fund_info._total_dynprofit,
-		_fund_info._total_profit + _fund_info._total_dynprofit - _fund_info._total_fees, _fund_info._total_fees);
+	if (_out_store)
+		_out_store->log_fund(curDate, _fund_info._total_profit, _fund_info._total_dynprofit,
+			_fund_info._total_profit + _fund_info._total_dynprofit - _fund_info._total_fees, _fund_info._total_fees);
+	else
+		_fund_logs << fmt::format("{},{:.2f},{:.2f},{:.2f},{:.2f}\n", curDate,
+			_fund_info._total_profit, _fund_info._total_dynprofit,
+			_fund_info._total_profit + _fund_info._total_dynprofit - _fund_info._total_fees, _fund_info._total_fees);
 	
 	if (_notifier)
 		_notifier->notifyFund("BT_FUND", curDate, _fund_info._total_profit, _fund_info._total_dynprofit,
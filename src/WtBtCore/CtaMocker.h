@@ -12,6 +12,7 @@
 #include <atomic>
 #include <unordered_map>
 #include "HisDataReplayer.h"
+#include "BtOutputStore.h"
 
 #include "../Includes/FasterDefs.h"
 #include "../Includes/ICtaStraCtx.h"
@@ -90,6 +91,9 @@ private:
 public:
 	bool	init_cta_factory(WTSVariant* cfg);
 	void	load_incremental_data(const char* lastBacktestName);
+
+	//回测结果写成二进制表,默认还是写csv
+	inline void	set_bin_output(bool bBinary) { _bin_output = bBinary; }
 	void	install_hook();
 	void	enable_hook(bool bEnabled = true);
 	bool	step_calc();
@@ -109,6 +113,9 @@ public:
 
 	virtual void	handle_replay_done() override;
 
+	virtual bool	handle_checkpoint(WtCkptWriter& writer) override;
+	virtual bool	handle_restore(WtCkptReader& reader) override;
+
 	//////////////////////////////////////////////////////////////////////////
 	//ICtaStraCtx
 	virtual uint32_t id() { return _context_id; }
@@ -345,6 +352,10 @@ protected:
 	std::stringstream	_index_logs;
 	std::stringstream	_mark_logs;
 
+	//二进制输出,为空则按原来的方式写csv
+	bool				_bin_output;
+	BtOutputStorePtr	_out_store;
+
 	CondEntrustMap		_condtions;
 
 	//是否处于调度中的标记
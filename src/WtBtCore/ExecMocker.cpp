@@ -362,4 +362,62 @@ void ExecMocker::handle_replay_done()
 	ss << folder << "trades_" << _id << ".csv";
 	std::string filename = ss.str();
 	StdFile::write_file_content(filename.c_str(), _trade_logs.str());
-}
\ No newline at end of file
+}
+
+bool ExecMocker::handle_checkpoint(WtCkptWriter& writer)
+{
+	writer.put(_target);
+	writer.put(_position);
+	writer.put(_undone);
+	writer.put(_sig_px);
+	writer.put(_sig_time);
+	writer.put(_ord_cnt);
+	writer.put(_ord_qty);
+	writer.put(_cacl_cnt);
+	writer.put(_cacl_qty);
+	writer.put(_sig_cnt);
+
+	writer.put((bool)(_last_tick != NULL));
+	if (_last_tick)
+		writer.put(_last_tick->getTickStruct());
+
+	writer.put_str(_trade_logs.str());
+
+	_matcher.save(writer);
+	return true;
+}
+
+bool ExecMocker::handle_restore(WtCkptReader& reader)
+{
+	reader.get(_target);
+	reader.get(_position);
+	reader.get(_undone);
+	reader.get(_sig_px);
+	reader.get(_sig_time);
+	reader.get(_ord_cnt);
+	reader.get(_ord_qty);
+	reader.get(_cacl_cnt);
+	reader.get(_cacl_qty);
+	reader.get(_sig_cnt);
+
+	bool hasTick = false;
+	reader.get(hasTick);
+	if (hasTick)
+	{
+		WTSTickStruct curTS;
+		if (reader.get(curTS))
+		{
+			if (_last_tick)
+				_last_tick->release();
+			_last_tick = WTSTickData::create(curTS);
+		}
+	}
+
+	reader.get_str(_trade_logs);
+
+	if (!_matcher.restore(reader))
+		return false;
+
+	WTSLogger::info("Executer {} restored from checkpoint, target: {}, position: {}", _id, _target, _position);
+	return true;
+}
@@ -45,6 +45,10 @@ public:
 
 	virtual void handle_replay_done() override;
 
+	virtual bool handle_checkpoint(WtCkptWriter& writer) override;
+
+	virtual bool handle_restore(WtCkptReader& reader) override;
+
 	//////////////////////////////////////////////////////////////////////////
 	//ExecuteContext
 	virtual WTSTickSlice* getTicks(const char* stdCode, uint32_t count, uint64_t etime = 0) override;
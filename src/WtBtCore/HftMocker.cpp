@@ -27,9 +27,10 @@
 #include <rapidjson/prettywriter.h>
 namespace rj = rapidjson;
 
+static std::atomic<uint32_t> _auto_order_id{ 0 };
+
 uint32_t makeLocalOrderID()
 {
-	static std::atomic<uint32_t> _auto_order_id{ 0 };
 	if (_auto_order_id == 0)
 	{
 		uint32_t curYear = TimeUtils::getCurDate() / 10000 * 10000 + 101;
@@ -39,6 +40,17 @@ uint32_t makeLocalOrderID()
 	return _auto_order_id.fetch_add(1);
 }
 
+/*
+ *	从断点恢复以后,后面生成的订单号要大于恢复的订单号
+ */
+void skipLocalOrderID(uint32_t lastID)
+{
+	makeLocalOrderID();
+
+	uint32_t curID = _auto_order_id;
+	while (curID <= lastID && !_auto_order_id.compare_exchange_weak(curID, lastID + 1));
+}
+
 std::vector<uint32_t> splitVolume(uint32_t vol)
 {
 	if (vol == 0) return std::move(std::vector<uint32_t>());
@@ -125,6 +137,7 @@ HftMocker::HftMocker(HisDataReplayer* replayer, const char* name)
 	, _has_hook(false)
 	, _hook_valid(true)
 	, _resumed(false)
+	, _bin_output(false)
 {
 	_commodities = CommodityMap::create();
 
@@ -303,6 +316,149 @@ void HftMocker::handle_replay_done()
 	this->on_bactest_end();
 }
 
+bool HftMocker::handle_checkpoint(WtCkptWriter& writer)
+{
+	//二进制输出的结果已经写到表里了,不在断点里
+	if (_out_store)
+	{
+		WTSLogger::warn("Checkpoint is not supported with binary outputs");
+		return false;
+	}
+
+	//收盘以后不应该还有没处理的任务,任务是闭包,没法保存
+	if (!_tasks.empty())
+	{
+		WTSLogger::warn("{} tasks not processed, checkpoint skipped", _tasks.size());
+		return false;
+	}
+
+	writer.put(_fund_info);
+	writer.put(_ud_modified);
+
+	writer.put((uint32_t)_price_map.size());
+	for (auto& v : _price_map)
+	{
+		writer.put_str(v.first);
+		writer.put(v.second);
+	}
+
+	writer.put((uint32_t)_orders.size());
+	for (auto& v : _orders)
+		writer.put_raw(v.second.get(), sizeof(OrderInfo));
+
+	writer.put((uint32_t)_pos_map.size());
+	for (auto& v : _pos_map)
+	{
+		const PosInfo& pInfo = v.second;
+		writer.put_str(v.first);
+		writer.put(pInfo._volume);
+		writer.put(pInfo._closeprofit);
+		writer.put(pInfo._dynprofit);
+		writer.put(pInfo._frozen);
+		writer.put_vec(pInfo._details);
+	}
+
+	writer.put((uint32_t)_user_datas.size());
+	for (auto& v : _user_datas)
+	{
+		writer.put_str(v.first);
+		writer.put_str(v.second);
+	}
+
+	writer.put((uint32_t)_tick_subs.size());
+	for (const std::string& stdCode : _tick_subs)
+		writer.put_str(stdCode);
+
+	writer.put_str(_trade_logs.str());
+	writer.put_str(_close_logs.str());
+	writer.put_str(_fund_logs.str());
+	writer.put_str(_sig_logs.str());
+	writer.put_str(_pos_logs.str());
+	return true;
+}
+
+bool HftMocker::handle_restore(WtCkptReader& reader)
+{
+	if (_out_store)
+	{
+		WTSLogger::error("Restoring from checkpoint is not supported with binary outputs");
+		return false;
+	}
+
+	reader.get(_fund_info);
+	reader.get(_ud_modified);
+
+	//按保存时的顺序插入,容器的遍历顺序和不中断的回测一致
+	uint32_t cnt = 0;
+	_price_map.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		reader.get(_price_map[stdCode]);
+	}
+
+	uint32_t maxID = 0;
+	_orders.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		OrderInfoPtr ordInfo(new OrderInfo);
+		if (!reader.get_raw(ordInfo.get(), sizeof(OrderInfo)))
+			break;
+
+		_orders[ordInfo->_localid] = ordInfo;
+		maxID = std::max(maxID, ordInfo->_localid);
+	}
+	//新的订单号要排在恢复的订单后面
+	if (maxID > 0)
+		skipLocalOrderID(maxID);
+
+	_pos_map.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		PosInfo& pInfo = _pos_map[stdCode];
+		reader.get(pInfo._volume);
+		reader.get(pInfo._closeprofit);
+		reader.get(pInfo._dynprofit);
+		reader.get(pInfo._frozen);
+		reader.get_vec(pInfo._details);
+	}
+
+	_user_datas.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string key;
+		reader.get_str(key);
+		reader.get_str(_user_datas[key]);
+	}
+
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		_tick_subs.insert(stdCode);
+	}
+
+	reader.get_str(_trade_logs);
+	reader.get_str(_close_logs);
+	reader.get_str(_fund_logs);
+	reader.get_str(_sig_logs);
+	reader.get_str(_pos_logs);
+
+	if (!reader.good())
+		return false;
+
+	WTSLogger::info("Strategy {} restored from checkpoint, {} positions, {} orders, {} user datas", _name, _pos_map.size(), _orders.size(), _user_datas.size());
+	return true;
+}
+
 void HftMocker::on_bar(const char* stdCode, const char* period, uint32_t times, WTSBarStruct* newBar)
 {
 	if (_strategy)
@@ -478,6 +634,16 @@ uint32_t HftMocker::id()
 
 void HftMocker::on_init()
 {
+	if (_bin_output)
+	{
+		std::string folder = WtHelper::getOutputDir();
+		folder += _name;
+		folder += "/";
+		_out_store.reset(new BtOutputStore());
+		if (!_out_store->init(folder.c_str(), BT_FLAVOR_HFT))
+			_out_store.reset();
+	}
+
 	if (_strategy)
 		_strategy->on_init(this);
 }
@@ -517,13 +683,20 @@ void HftMocker::on_session_end(uint32_t curTDate)
 		if (decimal::eq(pInfo._volume, 0.0))
 			continue;
 
-		_pos_logs << fmt::format("{},{},{},{:.2f},{:.2f}\n", curTDate, stdCode,
-			pInfo._volume, pInfo._closeprofit, pInfo._dynprofit);
+		if (_out_store)
+			_out_store->log_position(curTDate, stdCode, pInfo._volume > 0, pInfo._volume, pInfo._closeprofit, pInfo._dynprofit);
+		else
+			_pos_logs << fmt::format("{},{},{},{:.2f},{:.2f}\n", curTDate, stdCode,
+				pInfo._volume, pInfo._closeprofit, pInfo._dynprofit);
 	}
 
-	_fund_logs << fmt::format("{},{:.2f},{:.2f},{:.2f},{:.2f}\n", curTDate,
-		_fund_info._total_profit, _fund_info._total_dynprofit,
-		_fund_info._total_profit + _fund_info._total_dynprofit - _fund_info._total_fees, _fund_info._total_fees);
+	if (_out_store)
+		_out_store->log_fund(curTDate, _fund_info._total_profit, _fund_info._total_dynprofit,
+			_fund_info._total_profit + _fund_info._total_dynprofit - _fund_info._total_fees, _fund_info._total_fees);
+	else
+		_fund_logs << fmt::format("{},{:.2f},{:.2f},{:.2f},{:.2f}\n", curTDate,
+			_fund_info._total_profit, _fund_info._total_dynprofit,
+			_fund_info._total_profit + _fund_info._total_dynprofit - _fund_info._total_fees, _fund_info._total_fees);
 
 	if (_strategy)
 		_strategy->on_session_end(this, curTDate);
@@ -769,8 +942,12 @@ bool HftMocker::procOrder(uint32_t localid)
 
 		double curPos = stra_get_position(ordInfo->_code);
 
-		_sig_logs << _replayer->get_date() << "." << _replayer->get_raw_time() << "." << _replayer->get_secs() << ","
-			<< (ordInfo->_isBuy ? "+" : "-") << curQty << "," << curPos << "," << curPx << std::endl;
+		if (_out_store)
+			_out_store->log_hft_signal(_replayer->get_date(), _replayer->get_raw_time(), _replayer->get_secs(),
+				ordInfo->_isBuy ? curQty : -curQty, curPos, curPx);
+		else
+			_sig_logs << _replayer->get_date() << "." << _replayer->get_raw_time() << "." << _replayer->get_secs() << ","
+				<< (ordInfo->_isBuy ? "+" : "-") << curQty << "," << curPos << "," << curPx << std::endl;
 	}
 
 	//if(ordInfo->_left == 0)
@@ -1024,32 +1201,43 @@ void HftMocker::dump_outputs()
 	folder += "/";
 	boost::filesystem::create_directories(folder.c_str());
 
-	std::string filename = folder + "trades.csv";
-	std::string content = "code,time,direct,action,price,qty,fee,usertag\n";
-	content += _trade_logs.str();
-	StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
+	std::string filename;
+	std::string content;
+	if (_out_store)
+	{
+		//二进制输出的时候数据已经在表里了,关闭即可
+		_out_store->close();
+		_out_store.reset();
+	}
+	else
+	{
+		filename = folder + "trades.csv";
+		content = "code,time,direct,action,price,qty,fee,usertag\n";
+		content += _trade_logs.str();
+		StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
 
-	filename = folder + "closes.csv";
-	content = "code,direct,opentime,openprice,closetime,closeprice,qty,profit,maxprofit,maxloss,totalprofit,entertag,exittag\n";
-	content += _close_logs.str();
-	StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
+		filename = folder + "closes.csv";
+		content = "code,direct,opentime,openprice,closetime,closeprice,qty,profit,maxprofit,maxloss,totalprofit,entertag,exittag\n";
+		content += _close_logs.str();
+		StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
 
 
-	filename = folder + "funds.csv";
-	content = "date,closeprofit,positionprofit,dynbalance,fee\n";
-	content += _fund_logs.str();
-	StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
+		filename = folder + "funds.csv";
+		content = "date,closeprofit,positionprofit,dynbalance,fee\n";
+		content += _fund_logs.str();
+		StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
 
 
-	filename = folder + "signals.csv";
-	content = "time, action, position, price\n";
-	content += _sig_logs.str();
-	StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
+		filename = folder + "signals.csv";
+		content = "time, action, position, price\n";
+		content += _sig_logs.str();
+		StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
 
-	filename = folder + "positions.csv";
-	content = "date,code,volume,closeprofit,dynprofit\n";
-	if (!_pos_logs.str().empty()) content += _pos_logs.str();
-	StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
+		filename = folder + "positions.csv";
+		content = "date,code,volume,closeprofit,dynprofit\n";
+		if (!_pos_logs.str().empty()) content += _pos_logs.str();
+		StdFile::write_file_content(filename.c_str(), (void*)content.c_str(), content.size());
+	}
 
 	{
 		rj::Document root(rj::kObjectType);
@@ -1073,6 +1261,12 @@ void HftMocker::dump_outputs()
 
 void HftMocker::log_trade(const char* stdCode, bool isLong, bool isOpen, uint64_t curTime, double price, double qty, double fee, const char* userTag/* = ""*/)
 {
+	if (_out_store)
+	{
+		_out_store->log_trade(stdCode, isLong, isOpen ? 0 : 1, curTime, price, qty, fee, userTag);
+		return;
+	}
+
 	_trade_logs << stdCode << "," << curTime << "," << (isLong ? "LONG" : "SHORT") << "," << (isOpen ? "OPEN" : "CLOSE")
 		<< "," << price << "," << qty << "," << fee << "," << userTag << "\n";
 }
@@ -1080,6 +1274,13 @@ void HftMocker::log_trade(const char* stdCode, bool isLong, bool isOpen, uint64_
 void HftMocker::log_close(const char* stdCode, bool isLong, uint64_t openTime, double openpx, uint64_t closeTime, double closepx, double qty, double profit, double maxprofit, double maxloss,
 	double totalprofit /* = 0 */, const char* enterTag/* = ""*/, const char* exitTag/* = ""*/)
 {
+	if (_out_store)
+	{
+		_out_store->log_close(stdCode, isLong, openTime, openpx, closeTime, closepx, qty, profit, maxprofit, maxloss,
+			totalprofit, enterTag, exitTag);
+		return;
+	}
+
 	_close_logs << stdCode << "," << (isLong ? "LONG" : "SHORT") << "," << openTime << "," << openpx
 		<< "," << closeTime << "," << closepx << "," << qty << "," << profit << "," << maxprofit << "," << maxloss << ","
 		<< totalprofit << "," << enterTag << "," << exitTag << "\n";
@@ -39,7 +39,13 @@ bool HisDataMgr::init(WTSVariant* cfg)
 
 	}
 
+	if (_reader == NULL)
+		return false;
+
 	_reader->init(cfg, this);
+	_reentrant = _reader->is_reentrant();
+	if (!_reentrant)
+		WTSLogger::debug("Backtest data reader is not reentrant, reading will be serialized");
 
 	return true;
 }
@@ -53,7 +59,9 @@ bool HisDataMgr::load_raw_bars(const char* exchg, const char* code, WTSKlinePeri
 	}
 
 	std::string buffer;
-	bool bSucc = _reader->read_raw_bars(exchg, code, period, buffer);
+	bool bSucc = read_data([this, exchg, code, period, &buffer]() {
+		return _reader->read_raw_bars(exchg, code, period, buffer);
+	});
 	if (bSucc)
 		cb(buffer);
 	return bSucc;
@@ -68,7 +76,9 @@ bool HisDataMgr::load_raw_ticks(const char* exchg, const char* code, uint32_t uD
 	}
 
 	std::string buffer;
-	bool bSucc = _reader->read_raw_ticks(exchg, code, uDate, buffer);
+	bool bSucc = read_data([this, exchg, code, uDate, &buffer]() {
+		return _reader->read_raw_ticks(exchg, code, uDate, buffer);
+	});
 	if (bSucc)
 		cb(buffer);
 	return bSucc;
@@ -83,7 +93,9 @@ bool HisDataMgr::load_raw_trans(const char* exchg, const char* code, uint32_t uD
 	}
 
 	std::string buffer;
-	bool bSucc = _reader->read_raw_transactions(exchg, code, uDate, buffer);
+	bool bSucc = read_data([this, exchg, code, uDate, &buffer]() {
+		return _reader->read_raw_transactions(exchg, code, uDate, buffer);
+	});
 	if (bSucc)
 		cb(buffer);
 	return bSucc;
@@ -98,7 +110,9 @@ bool HisDataMgr::load_raw_ordque(const char* exchg, const char* code, uint32_t u
 	}
 
 	std::string buffer;
-	bool bSucc = _reader->read_raw_order_queues(exchg, code, uDate, buffer);
+	bool bSucc = read_data([this, exchg, code, uDate, &buffer]() {
+		return _reader->read_raw_order_queues(exchg, code, uDate, buffer);
+	});
 	if (bSucc)
 		cb(buffer);
 	return bSucc;
@@ -113,7 +127,9 @@ bool HisDataMgr::load_raw_orddtl(const char* exchg, const char* code, uint32_t u
 	}
 
 	std::string buffer;
-	bool bSucc = _reader->read_raw_order_details(exchg, code, uDate, buffer);
+	bool bSucc = read_data([this, exchg, code, uDate, &buffer]() {
+		return _reader->read_raw_order_details(exchg, code, uDate, buffer);
+	});
 	if (bSucc)
 		cb(buffer);
 	return bSucc;
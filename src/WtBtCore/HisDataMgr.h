@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include <functional>
 #include "../Includes/IBtDtReader.h"
+#include "../Share/StdUtils.hpp"
 
 typedef std::function<void(std::string&)> FuncLoadDataCallback;
 
@@ -13,7 +14,7 @@ USING_NS_WTP;
 class HisDataMgr : public IBtDtReaderSink
 {
 public:
-	HisDataMgr() :_reader(NULL) {}
+	HisDataMgr() :_reader(NULL), _reentrant(false) {}
 	~HisDataMgr(){}
 
 public:
@@ -32,7 +33,24 @@ public:
 
 	bool	load_raw_trans(const char* exchg, const char* code, uint32_t uDate, FuncLoadDataCallback cb);
 
+private:
+	/*
+	 *	调用读取模块,预读线程和回放线程都会调用
+	 *	读取模块不可重入的时候(如LMDB的读取模块)要加锁排队,可重入的直接调用
+	 */
+	template<typename Func>
+	inline bool read_data(Func func)
+	{
+		if (_reentrant)
+			return func();
+
+		StdUniqueLock lock(_mtx_reader);
+		return func();
+	}
+
 private:
 	IBtDtReader*	_reader;
+	bool			_reentrant;
+	StdUniqueMutex	_mtx_reader;
 };
 
@@ -87,6 +87,20 @@ bool proc_block_data(const char* tag, std::string& content, bool isBar, bool bKe
 		}
 	}
 
+	//定点紧凑格式,解压以后还原成标准结构体
+	if (header->is_compact())
+	{
+		std::string rawData;
+		bool bSucc = isBar ? WtCompactCodec::decode_bars(buffer.data(), buffer.size(), rawData) : WtCompactCodec::decode_ticks(buffer.data(), buffer.size(), rawData);
+		if (!bSucc)
+		{
+			WTSLogger::error("Decoding compact {} data of {} failed", isBar ? "bar" : "tick", tag);
+			return false;
+		}
+
+		buffer.swap(rawData);
+	}
+
 	if (bOldVer)
 	{
 		if (isBar)
@@ -157,12 +171,21 @@ HisDataReplayer::HisDataReplayer()
 	, _min_period("d")
 	, _cache_clear_days(0)
 	, _align_by_section(false)
+	, _prefetch_mem_cap(0)
+	, _prefetch_mem_used(0)
+	, _prefetch_compact(false)
+	, _ckpt_days(0)
+	, _ckpt_passed(0)
+	, _ckpt_tdate(0)
+	, _resumed(false)
 {
 }
 
 
 HisDataReplayer::~HisDataReplayer()
 {
+	if (_prefetch_pool)
+		_prefetch_pool->wait();
 }
 
 
@@ -225,6 +248,38 @@ bool HisDataReplayer::init(WTSVariant* cfg, EventNotifier* notifier /* = NULL */
 	_nosim_if_notrade = cfg->getBoolean("dont_simtick_if_notrade");
 	WTSLogger::info("nosim_if_notrade is {}", _nosim_if_notrade);
 
+	/*
+	 *	高频数据预读，只对从dsb文件读取的数据有效
+	 *	prefetch_threads为0则不预读，prefetch_mem_cap单位为MB，默认1024
+	 *	prefetch_compact为true则预读的tick按定点紧凑格式缓存，内存大约减半，换日取用的时候再还原，默认不开启
+	 */
+	uint32_t prefetchThreads = cfg->getUInt32("prefetch_threads");
+	uint32_t memCap = cfg->has("prefetch_mem_cap") ? cfg->getUInt32("prefetch_mem_cap") : 1024;
+	_prefetch_mem_cap = (std::size_t)memCap * 1024 * 1024;
+	_prefetch_compact = cfg->getBoolean("prefetch_compact");
+	if (prefetchThreads > 0 && (_mode == "storage" || _mode == "bin" || _mode == "wtp"))
+	{
+		_prefetch_pool.reset(new boost::threadpool::pool(prefetchThreads));
+		WTSLogger::info("HFT data of next trading day will be prefetched by {} threads, memory cap: {}MB, compact: {}", prefetchThreads, memCap, _prefetch_compact ? "yes" : "no");
+	}
+
+	/*
+	 *	断点,checkpoint.days为保存间隔的交易日数,checkpoint.folder为保存目录
+	 *	resume为恢复用的断点文件,已经通过接口设置过的以接口设置的为准
+	 */
+	WTSVariant* cfgCkpt = cfg->get("checkpoint");
+	if (cfgCkpt && _ckpt_days == 0)
+	{
+		_ckpt_days = cfgCkpt->getUInt32("days");
+		_ckpt_folder = cfgCkpt->getCString("folder");
+	}
+
+	if (_resume_file.empty() && cfg->has("resume"))
+		_resume_file = cfg->getCString("resume");
+
+	if (_ckpt_days > 0)
+		WTSLogger::info("Checkpoint will be saved every {} trading days", _ckpt_days);
+
 	//基础数据文件
 	WTSVariant* cfgBF = cfg->get("basefiles");
 	if (cfgBF->get("session"))
@@ -433,6 +488,8 @@ void HisDataReplayer::register_task(uint32_t taskid, uint32_t date, uint32_t tim
 
 void HisDataReplayer::clear_cache()
 {
+	clearPrefetched();
+
 	_ticks_cache.clear();
 	_orddtl_cache.clear();
 	_ordque_cache.clear();
@@ -494,6 +551,8 @@ void HisDataReplayer::reset()
 	_day_cache.clear();
 	_ticker_keys.clear();
 
+	clearPrefetched();
+
 	_tick_sub_map.clear();
 	_ordque_sub_map.clear();
 	_orddtl_sub_map.clear();
@@ -666,6 +725,19 @@ bool HisDataReplayer::prepare()
 
 	_listener->handle_init();
 
+	_resumed = false;
+	_ckpt_passed = 0;
+	_ckpt_tdate = 0;
+	if (!_resume_file.empty())
+	{
+		if (!restore_checkpoint())
+		{
+			_running = false;
+			return false;
+		}
+		_resumed = true;
+	}
+
 	if (!_tick_enabled)
 		checkUnbars();
 
@@ -745,6 +817,7 @@ void HisDataReplayer::run_by_ticks(bool bNeedDump /* = false */)
 
 	while (_cur_tdate <= end_tdate && !_terminated)
 	{
+		bool bReplayed = false;
 		if (checkAllTicks(_cur_tdate))
 		{
 			WTSLogger::info("Start to replay tick data of {}...", _cur_tdate);
@@ -752,9 +825,14 @@ void HisDataReplayer::run_by_ticks(bool bNeedDump /* = false */)
 			check_cache_days();
 			replayHftDatasByDay(_cur_tdate);
 			_listener->handle_session_end(_cur_tdate);
+			bReplayed = true;
 		}
 
+		uint32_t closedTDate = _cur_tdate;
 		_cur_tdate = TimeUtils::getNextDate(_cur_tdate);
+
+		if (bReplayed)
+			check_checkpoint(closedTDate);
 	}
 
 	if (_terminated)
@@ -780,6 +858,9 @@ void HisDataReplayer::run_by_bars(bool bNeedDump /* = false */)
 
 	uint32_t total_barcnt = eIdx - sIdx + 1;
 	uint32_t replayed_barcnt = 0;
+	//从断点恢复的,按游标估算已经回放的条数,只影响进度
+	if (_resumed && barsList->_cursor != UINT_MAX && barsList->_cursor > sIdx + 1)
+		replayed_barcnt = barsList->_cursor - sIdx - 1;
 
 	notify_state(barsList->_code.c_str(), barsList->_period, barsList->_times, _begin_time, _end_time, 0);
 
@@ -899,6 +980,10 @@ void HisDataReplayer::run_by_bars(bool bNeedDump /* = false */)
 				_day_cache.clear();
 			}
 
+			//收盘以后、下一根K线之前是干净的断点,恢复以后从循环的开头继续
+			if (_closed_tdate == _cur_tdate)
+				check_checkpoint(_closed_tdate);
+
 			notify_state(barsList->_code.c_str(), barsList->_period, barsList->_times, _begin_time, _end_time, replayed_barcnt*100.0 / total_barcnt);
 
 			if (barsList->_cursor >= barsList->_bars.size())
@@ -948,12 +1033,14 @@ void HisDataReplayer::run_by_tasks(bool bNeedDump /* = false */)
 	{
 		uint32_t endtime = TimeUtils::getNextMinute(_task->_time, -1);
 		bool bIsPreDay = endtime > _task->_time;
-		if (bIsPreDay)
+		//断点里的日期已经是调整过的
+		if (bIsPreDay && !_resumed)
 			_cur_date = TimeUtils::getNextDate(_cur_date, -1);
 
 		for (; !_terminated;)
 		{
 			bool fired = false;
+			uint32_t closedTDate = 0;
 			//获取上一个交易日的日期
 			uint32_t preTDate = TimeUtils::getNextDate(_cur_tdate, -1);
 			if (_cur_time == endtime)
@@ -1051,6 +1138,7 @@ void HisDataReplayer::run_by_tasks(bool bNeedDump /* = false */)
 					check_cache_days();
 					if (_listener)
 						_listener->handle_session_end(newTDate);
+					closedTDate = newTDate;
 				}
 			}
 			else
@@ -1065,6 +1153,7 @@ void HisDataReplayer::run_by_tasks(bool bNeedDump /* = false */)
 				onMinuteEnd(curDate, curTime, bEndSession ? _cur_tdate : preTDate);
 				if (_listener)
 					_listener->handle_session_end(_cur_tdate);
+				closedTDate = _cur_tdate;
 			}
 
 			_cur_date = TimeUtils::getNextDate(_cur_date);
@@ -1085,14 +1174,21 @@ void HisDataReplayer::run_by_tasks(bool bNeedDump /* = false */)
 
 				break;
 			}
+
+			if (closedTDate != 0)
+				check_checkpoint(closedTDate);
 		}
 	}
 	else
 	{
-		if (_listener)
-			_listener->handle_session_begin(_cur_tdate);
+		//断点是在下一个交易日开始以后保存的,恢复的时候不再通知交易日开始
+		if (!_resumed)
+		{
+			if (_listener)
+				_listener->handle_session_begin(_cur_tdate);
 
-		check_cache_days();
+			check_cache_days();
+		}
 
 		for (; !_terminated;)
 		{
@@ -1106,6 +1202,7 @@ void HisDataReplayer::run_by_tasks(bool bNeedDump /* = false */)
 			}
 
 			bool bNewTDate = false;
+			uint32_t closedTDate = 0;
 			if (mins < sInfo->getTradingMins())
 			{
 				/*
@@ -1145,6 +1242,7 @@ void HisDataReplayer::run_by_tasks(bool bNeedDump /* = false */)
 				}
 				onMinuteEnd(_cur_date, _cur_time, _cur_tdate);
 
+				closedTDate = _cur_tdate;
 				if (_listener)
 					_listener->handle_session_end(_cur_tdate);
 			}
@@ -1215,6 +1313,9 @@ void HisDataReplayer::run_by_tasks(bool bNeedDump /* = false */)
 				}
 				break;
 			}
+
+			if (bNewTDate)
+				check_checkpoint(closedTDate);
 		}
 	}
 }
@@ -2859,13 +2960,28 @@ WTSCommodityInfo* HisDataReplayer::get_commodity_info(const char* stdCode)
 	return _bd_mgr.getCommodity(codeInfo._exchg, codeInfo._product);
 }
 
-std::string HisDataReplayer::get_rawcode(const char* stdCode)
+const HisDataReplayer::HotRuleRef& HisDataReplayer::get_hot_rule(const char* stdCode)
 {
+	auto it = _hot_rules.find(stdCode);
+	if (it != _hot_rules.end())
+		return it->second;
+
 	CodeHelper::CodeInfo cInfo = CodeHelper::extractStdCode(stdCode, &_hot_mgr);
-	if(cInfo.hasRule())
+	HotRuleRef& ref = _hot_rules[stdCode];
+	ref._has_rule = cInfo.hasRule();
+	ref._rule_idx = ref._has_rule ? _hot_mgr.getRuleIndex(cInfo._ruletag, cInfo.stdCommID()) : INVALID_UINT32;
+	ref._exchg = cInfo._exchg;
+	return ref;
+}
+
+std::string HisDataReplayer::get_rawcode(const char* stdCode)
+{
+	const HotRuleRef& ref = get_hot_rule(stdCode);
+	if(ref._has_rule)
 	{
-		std::string code = _hot_mgr.getCustomRawCode(cInfo._ruletag, cInfo.stdCommID(), _cur_tdate);
-		return CodeHelper::rawMonthCodeToStdCode(code.c_str(), cInfo._exchg);
+		uint32_t uDate = (_cur_tdate == 0) ? TimeUtils::getCurDate() : _cur_tdate;
+		const HotSegment* seg = _hot_mgr.getSegment(ref._rule_idx, uDate);
+		return CodeHelper::rawMonthCodeToStdCode((seg == NULL) ? "" : seg->_code.c_str(), ref._exchg.c_str());
 	}
 
 	return "";
@@ -3233,19 +3349,33 @@ uint32_t strToDate(const char* strDate)
 	return strtoul(ss.str().c_str(), NULL, 10);
 }
 
-bool HisDataReplayer::cacheRawTicksFromBin(const std::string& key, const char* stdCode, uint32_t uDate)
+bool HisDataReplayer::loadRawHftData(HftDataType dType, const char* stdCode, uint32_t uDate, std::string& content)
 {
 	CodeHelper::CodeInfo cInfo = CodeHelper::extractStdCode(stdCode, &_hot_mgr);
-	std::string stdPID = StrUtil::printf("%s.%s", cInfo._exchg, cInfo._product);
-	
+	auto cb = [&content](std::string& data) {
+		content.swap(data);
+	};
+
+	switch (dType)
+	{
+	case HDT_OrdDtl:
+		return _his_dt_mgr.load_raw_orddtl(cInfo._exchg, cInfo._code, uDate, cb);
+	case HDT_OrdQue:
+		return _his_dt_mgr.load_raw_ordque(cInfo._exchg, cInfo._code, uDate, cb);
+	case HDT_Trans:
+		return _his_dt_mgr.load_raw_trans(cInfo._exchg, cInfo._code, uDate, cb);
+	default:
+		break;
+	}
+
 	std::string rawCode = cInfo._code;
 	if(strlen(cInfo._ruletag) > 0)
 	{
-		rawCode = _hot_mgr.getCustomRawCode(cInfo._ruletag, cInfo.stdCommID(), uDate);
+		//预读线程也会调用，不能用回放线程的规则缓存
+		const HotSegment* seg = _hot_mgr.findSegment(cInfo._ruletag, cInfo.stdCommID(), uDate);
+		rawCode = (seg == NULL) ? "" : seg->_code;
 	}
 
-
-	std::string content;
 	bool bHit = false;
 	//先检查有没有HOT、SND的主力次主力的tick文件
 	const char* ruleTag = cInfo._ruletag;
@@ -3253,9 +3383,7 @@ bool HisDataReplayer::cacheRawTicksFromBin(const std::string& key, const char* s
 	{
 		const char* hot_flag = ruleTag;
 		std::string wrappCode = StrUtil::printf("%s_%s", cInfo._product, hot_flag);
-		bHit = _his_dt_mgr.load_raw_ticks(cInfo._exchg, wrappCode.c_str(), uDate, [&content](std::string& data) {
-			content.swap(data);
-		});
+		bHit = _his_dt_mgr.load_raw_ticks(cInfo._exchg, wrappCode.c_str(), uDate, cb);
 	}
 
 	//如果没有找到，则读取分月合约
@@ -3265,10 +3393,158 @@ bool HisDataReplayer::cacheRawTicksFromBin(const std::string& key, const char* s
 		 *	By Wesley @ 2022.01.11
 		 *	这里将直接从文件读取，改成从HisDtMgr封装的接口加载
 		 */
-		bHit = _his_dt_mgr.load_raw_ticks(cInfo._exchg, rawCode.c_str(), uDate, [&content](std::string& data) {
-			content.swap(data);
-		});
+		bHit = _his_dt_mgr.load_raw_ticks(cInfo._exchg, rawCode.c_str(), uDate, cb);
+	}
+
+	return bHit;
+}
+
+void HisDataReplayer::prefetchNextDay(HftDataType dType, const char* stdCode, uint32_t uDate, std::size_t sizeHint)
+{
+	if (!_prefetch_pool)
+		return;
+
+	CodeHelper::CodeInfo cInfo = CodeHelper::extractStdCode(stdCode, &_hot_mgr);
+	WTSCommodityInfo* commInfo = _bd_mgr.getCommodity(cInfo._exchg, cInfo._product);
+	if (commInfo == NULL)
+		return;
+
+	uint32_t nextTDate = _bd_mgr.getNextTDate(commInfo->getTradingTpl(), uDate, 1, true);
+	uint32_t endTDate = _bd_mgr.calcTradingDate(DEFAULT_SESSIONID, (uint32_t)(_end_time / 10000), (uint32_t)(_end_time % 10000), true);
+	if (nextTDate > endTDate)
+		return;
+
+	//紧凑格式的tick大约是原来的一半，按编码以后的大小预占额度
+	bool bCompact = _prefetch_compact && dType == HDT_Tick;
+	uint32_t precision = WtCompactCodec::precision_of(commInfo->getPriceTick());
+	if (bCompact)
+		sizeHint = sizeof(CompactBlockInfo) + sizeHint / sizeof(WTSTickStruct) * sizeof(WTSTickCompact);
+
+	std::string key = StrUtil::printf("%u.%s", dType, stdCode);
+	PrefetchItemPtr item;
+	{
+		StdUniqueLock lock(_prefetch_mtx);
+		auto it = _prefetch_items.find(key);
+		if (it != _prefetch_items.end())
+		{
+			PrefetchItemPtr& oldItem = it->second;
+			//已经在预读了，或者上一次的预读还没读完
+			if (oldItem->_date == nextTDate || !oldItem->_ready)
+				return;
+
+			//预读好了但是没有用上，直接丢掉
+			_prefetch_mem_used -= oldItem->_reserved;
+			_prefetch_items.erase(it);
+		}
+
+		/*
+		 *	超过内存上限就不预读了，换日的时候再同步加载
+		 *	预占的额度用当天的数据大小来估计，实际大小在读完以后再修正，所以上限是软的
+		 */
+		if (_prefetch_mem_used + sizeHint > _prefetch_mem_cap)
+		{
+			WTSLogger::debug("Prefetching of {} on {} skipped, memory cap {} bytes reached", stdCode, nextTDate, _prefetch_mem_cap);
+			return;
+		}
+
+		item.reset(new PrefetchItem);
+		item->_date = nextTDate;
+		item->_reserved = sizeHint;
+		_prefetch_mem_used += sizeHint;
+		_prefetch_items[key] = item;
+	}
+
+	std::string code = stdCode;
+	_prefetch_pool->schedule([this, item, dType, code, bCompact, precision]() {
+		std::string content;
+		bool bHit = loadRawHftData(dType, code.c_str(), item->_date, content);
+
+		//编码会逐条校验能否无损还原，还原不了的照原样缓存
+		std::string compact;
+		bool bEncoded = bHit && bCompact && WtCompactCodec::encode_ticks((const WTSTickStruct*)content.data(),
+			(uint32_t)(content.size() / sizeof(WTSTickStruct)), precision, compact);
+		if (bEncoded)
+			content.swap(compact);
+
+		StdUniqueLock lock(_prefetch_mtx);
+		item->_hit = bHit;
+		item->_compact = bEncoded;
+		item->_content.swap(content);
+		_prefetch_mem_used = _prefetch_mem_used - item->_reserved + item->_content.size();
+		item->_reserved = item->_content.size();
+		item->_ready = true;
+		_prefetch_cond.notify_all();
+	});
+}
+
+bool HisDataReplayer::takePrefetched(HftDataType dType, const char* stdCode, uint32_t uDate, std::string& content, bool& bHit)
+{
+	if (!_prefetch_pool)
+		return false;
+
+	std::string key = StrUtil::printf("%u.%s", dType, stdCode);
+	StdUniqueLock lock(_prefetch_mtx);
+	auto it = _prefetch_items.find(key);
+	if (it == _prefetch_items.end())
+		return false;
+
+	PrefetchItemPtr item = it->second;
+	if (item->_date != uDate)
+	{
+		/*
+		 *	按tick回放的时候是逐个自然日检查的，周末和节假日会先于预读的日期到来
+		 *	所以只丢掉已经过期的，没读完的留给prefetchNextDay去处理
+		 */
+		if (item->_ready && item->_date < uDate)
+		{
+			_prefetch_mem_used -= item->_reserved;
+			_prefetch_items.erase(it);
+		}
+		return false;
+	}
+
+	//还没读完就等着，不要再读一遍
+	_prefetch_cond.wait(lock, [&item]() { return item->_ready; });
+
+	bHit = item->_hit;
+	content.swap(item->_content);
+	_prefetch_mem_used -= item->_reserved;
+	_prefetch_items.erase(key);
+	lock.unlock();
+
+	if (!item->_compact)
+		return true;
+
+	//紧凑格式的还原成标准结构体，还原失败就当没有预读，重新读文件
+	std::string rawData;
+	if (!WtCompactCodec::decode_ticks(content.data(), content.size(), rawData))
+	{
+		WTSLogger::error("Decoding prefetched ticks of {} on {} failed", stdCode, uDate);
+		content.clear();
+		return false;
 	}
+	content.swap(rawData);
+	return true;
+}
+
+void HisDataReplayer::clearPrefetched()
+{
+	if (!_prefetch_pool)
+		return;
+
+	_prefetch_pool->wait();
+
+	StdUniqueLock lock(_prefetch_mtx);
+	_prefetch_items.clear();
+	_prefetch_mem_used = 0;
+}
+
+bool HisDataReplayer::cacheRawTicksFromBin(const std::string& key, const char* stdCode, uint32_t uDate)
+{
+	std::string content;
+	bool bHit = false;
+	if (!takePrefetched(HDT_Tick, stdCode, uDate, content, bHit))
+		bHit = loadRawHftData(HDT_Tick, stdCode, uDate, content);
 
 	if(!bHit)
 	{
@@ -3287,17 +3563,17 @@ bool HisDataReplayer::cacheRawTicksFromBin(const std::string& key, const char* s
 	ticksList._date = uDate;
 	ticksList._count = tickcnt;
 
+	prefetchNextDay(HDT_Tick, stdCode, uDate, content.size());
+
 	return true;
 }
 
 bool HisDataReplayer::cacheRawOrdDtlFromBin(const std::string& key, const char* stdCode, uint32_t uDate)
 {
-	CodeHelper::CodeInfo cInfo = CodeHelper::extractStdCode(stdCode, &_hot_mgr);
-
 	std::string content;
-	bool bHit = _his_dt_mgr.load_raw_orddtl(cInfo._exchg, cInfo._code, uDate, [&content](std::string& data) {
-		content.swap(data);
-	});
+	bool bHit = false;
+	if (!takePrefetched(HDT_OrdDtl, stdCode, uDate, content, bHit))
+		bHit = loadRawHftData(HDT_OrdDtl, stdCode, uDate, content);
 
 	if (!bHit)
 	{
@@ -3316,17 +3592,17 @@ bool HisDataReplayer::cacheRawOrdDtlFromBin(const std::string& key, const char*
 	dataList._date = uDate;
 	dataList._count = dataCnt;
 
+	prefetchNextDay(HDT_OrdDtl, stdCode, uDate, content.size());
+
 	return true;
 }
 
 bool HisDataReplayer::cacheRawOrdQueFromBin(const std::string& key, const char* stdCode, uint32_t uDate)
 {
-	CodeHelper::CodeInfo cInfo = CodeHelper::extractStdCode(stdCode, &_hot_mgr);
-
 	std::string content;
-	bool bHit = _his_dt_mgr.load_raw_ordque(cInfo._exchg, cInfo._code, uDate, [&content](std::string& data) {
-		content.swap(data);
-	});
+	bool bHit = false;
+	if (!takePrefetched(HDT_OrdQue, stdCode, uDate, content, bHit))
+		bHit = loadRawHftData(HDT_OrdQue, stdCode, uDate, content);
 
 	if (!bHit)
 	{
@@ -3345,17 +3621,17 @@ bool HisDataReplayer::cacheRawOrdQueFromBin(const std::string& key, const char*
 	dataList._date = uDate;
 	dataList._count = dataCnt;
 
+	prefetchNextDay(HDT_OrdQue, stdCode, uDate, content.size());
+
 	return true;
 }
 
 bool HisDataReplayer::cacheRawTransFromBin(const std::string& key, const char* stdCode, uint32_t uDate)
 {
-	CodeHelper::CodeInfo cInfo = CodeHelper::extractStdCode(stdCode, &_hot_mgr);
-
 	std::string content;
-	bool bHit = _his_dt_mgr.load_raw_trans(cInfo._exchg, cInfo._code, uDate, [&content](std::string& data) {
-		content.swap(data);
-	});
+	bool bHit = false;
+	if (!takePrefetched(HDT_Trans, stdCode, uDate, content, bHit))
+		bHit = loadRawHftData(HDT_Trans, stdCode, uDate, content);
 
 	if (!bHit)
 	{
@@ -3374,6 +3650,8 @@ bool HisDataReplayer::cacheRawTransFromBin(const std::string& key, const char* s
 	dataList._date = uDate;
 	dataList._count = dataCnt;
 
+	prefetchNextDay(HDT_Trans, stdCode, uDate, content.size());
+
 	return true;
 }
 
@@ -3761,7 +4039,7 @@ bool HisDataReplayer::cacheRawBarsFromCSV(const std::string& key, const char* st
 			return false;
 		}
 
-		CsvReader reader;
+		CsvMmapReader reader;
 		reader.load_from_file(csvfile.c_str());
 
 		WTSLogger::info("Reading data from {}, with fields: {}...", csvfile, reader.fields());
@@ -4569,4 +4847,320 @@ void HisDataReplayer::check_cache_days()
 		_bars_cache.erase(key);
 
 	WTSLogger::info("Cached bars of {} cleared due to outdated", codes);
-}
\ No newline at end of file
+}
+
+void HisDataReplayer::check_checkpoint(uint32_t closedTDate)
+{
+	if (_ckpt_days == 0 || _terminated || closedTDate == _ckpt_tdate)
+		return;
+
+	_ckpt_tdate = closedTDate;
+	_ckpt_passed++;
+	if (_ckpt_passed < _ckpt_days)
+		return;
+
+	_ckpt_passed = 0;
+	save_checkpoint(closedTDate);
+}
+
+bool HisDataReplayer::save_checkpoint(uint32_t closedTDate)
+{
+	TimeUtils::Ticker ticker;
+
+	WtCkptWriter writer;
+	writer.begin_block("replayer");
+	writer.put(_begin_time);
+	writer.put(_end_time);
+	writer.put(_cur_date);
+	writer.put(_cur_time);
+	writer.put(_cur_secs);
+	writer.put(_cur_tdate);
+	writer.put(_opened_tdate);
+	writer.put(_closed_tdate);
+	writer.put(_tick_simulated);
+	writer.put_str(_stra_name);
+	writer.put_str(_main_key);
+	writer.put_str(_main_period);
+	writer.put_str(_min_period);
+
+	//K线游标
+	writer.put((uint32_t)_bars_cache.size());
+	for (auto& v : _bars_cache)
+	{
+		const BarsListPtr& barsList = v.second;
+		writer.put_str(v.first);
+		writer.put(barsList->_cursor);
+		writer.put(barsList->_untouch_days);
+	}
+
+	writer.put((uint32_t)_unsubbed_in_need.size());
+	for (const std::string& stdCode : _unsubbed_in_need)
+		writer.put_str(stdCode);
+
+	writer.put((uint32_t)_unbars_cache.size());
+	for (auto& v : _unbars_cache)
+	{
+		writer.put_str(v.first);
+		writer.put(v.second->_cursor);
+	}
+
+	writer.put((uint32_t)_price_map.size());
+	for (auto& v : _price_map)
+	{
+		writer.put_str(v.first);
+		writer.put(v.second);
+	}
+
+	writer.put((uint32_t)_day_cache.size());
+	for (auto& v : _day_cache)
+	{
+		writer.put_str(v.first);
+		writer.put(v.second);
+	}
+
+	//订阅表
+	StraSubMap* subMaps[] = { &_tick_sub_map, &_ordque_sub_map, &_orddtl_sub_map, &_trans_sub_map };
+	for (StraSubMap* subMap : subMaps)
+	{
+		writer.put((uint32_t)subMap->size());
+		for (auto& v : *subMap)
+		{
+			writer.put_str(v.first);
+			writer.put((uint32_t)v.second.size());
+			for (auto& item : v.second)
+			{
+				writer.put(item.first);
+				writer.put(item.second.first);
+				writer.put(item.second.second);
+			}
+		}
+	}
+
+	writer.put(_task ? _task->_last_exe_time : (uint64_t)0);
+	writer.end_block();
+
+	writer.begin_block("sink");
+	bool bSupported = _listener->handle_checkpoint(writer);
+	writer.end_block();
+	if (!bSupported)
+	{
+		WTSLogger::error("Checkpoint is not supported by {}, checkpoints disabled", _stra_name);
+		_ckpt_days = 0;
+		return false;
+	}
+
+	std::string folder;
+	if (_ckpt_folder.empty())
+	{
+		folder = WtHelper::getOutputDir();
+		folder += _stra_name;
+		folder += "/checkpoints/";
+	}
+	else
+	{
+		folder = StrUtil::standardisePath(_ckpt_folder);
+	}
+	boost::filesystem::create_directories(folder.c_str());
+
+	std::string filename = fmt::format("{}{}.ckpt", folder, closedTDate);
+	if (!writer.save(filename.c_str(), closedTDate))
+	{
+		WTSLogger::error("Saving checkpoint to {} failed", filename);
+		return false;
+	}
+
+	WTSLogger::info("Checkpoint of tradingday {} saved to {}, {} bytes, {} us elapsed", closedTDate, filename, writer.data().size(), ticker.micro_seconds());
+	return true;
+}
+
+bool HisDataReplayer::restore_checkpoint()
+{
+	TimeUtils::Ticker ticker;
+
+	WtCkptReader reader;
+	if (!reader.load(_resume_file.c_str()))
+	{
+		WTSLogger::error("Loading checkpoint {} failed", _resume_file);
+		return false;
+	}
+
+	uint64_t stime = 0, etime = 0;
+	uint32_t curDate = 0, curTime = 0, curSecs = 0, curTDate = 0, openedTDate = 0, closedTDate = 0;
+	bool bTickSimulated = true;
+	std::string straName, mainKey, mainPeriod, minPeriod;
+
+	reader.enter_block("replayer");
+	reader.get(stime);
+	reader.get(etime);
+	reader.get(curDate);
+	reader.get(curTime);
+	reader.get(curSecs);
+	reader.get(curTDate);
+	reader.get(openedTDate);
+	reader.get(closedTDate);
+	reader.get(bTickSimulated);
+	reader.get_str(straName);
+	reader.get_str(mainKey);
+	reader.get_str(mainPeriod);
+	reader.get_str(minPeriod);
+	if (!reader.good())
+	{
+		WTSLogger::error("Checkpoint {} is corrupted", _resume_file);
+		return false;
+	}
+
+	uint64_t ckptTime = (uint64_t)curDate * 10000 + curTime;
+	if (ckptTime >= _end_time)
+	{
+		WTSLogger::error("Time {} of checkpoint is beyond ending time {}", ckptTime, _end_time);
+		return false;
+	}
+
+	if (!_main_key.empty() && !mainKey.empty() && _main_key != mainKey)
+	{
+		WTSLogger::error("Main bars {} of checkpoint mismatch with {}", mainKey, _main_key);
+		return false;
+	}
+
+	if (straName != _stra_name)
+		WTSLogger::warn("Checkpoint is saved by {}, forked to {}", straName, _stra_name);
+
+	_cur_date = curDate;
+	_cur_time = curTime;
+	_cur_secs = curSecs;
+	_cur_tdate = curTDate;
+	_opened_tdate = openedTDate;
+	_closed_tdate = closedTDate;
+	_tick_simulated = bTickSimulated;
+	_main_key = mainKey;
+	_main_period = mainPeriod;
+
+	uint32_t cnt = 0;
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string key;
+		uint32_t cursor = 0, untouchDays = 0;
+		reader.get_str(key);
+		reader.get(cursor);
+		reader.get(untouchDays);
+
+		auto it = _bars_cache.find(key);
+		if (it == _bars_cache.end())
+		{
+			//断点之前才用到的K线,先加载进来,这样后面推送的K线才和不中断的回测一致
+			StringVector ay = StrUtil::split(key, "#");
+			if (ay.size() == 3)
+			{
+				WTSKlineSlice* slice = get_kline_slice(ay[0].c_str(), ay[1].c_str(), 1, strtoul(ay[2].c_str(), NULL, 10));
+				if (slice)
+					slice->release();
+			}
+
+			it = _bars_cache.find(key);
+			if (it == _bars_cache.end())
+			{
+				WTSLogger::warn("Bars of {} in checkpoint cannot be loaded", key);
+				continue;
+			}
+		}
+
+		BarsListPtr& barsList = (BarsListPtr&)it->second;
+		barsList->_cursor = cursor;
+		barsList->_untouch_days = untouchDays;
+	}
+	//加载K线的时候会修改最小周期,所以放到后面
+	_min_period = minPeriod;
+
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		_unsubbed_in_need.insert(stdCode);
+	}
+
+	if (!_tick_enabled)
+		checkUnbars();
+
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string key;
+		uint32_t cursor = 0;
+		reader.get_str(key);
+		reader.get(cursor);
+
+		auto it = _unbars_cache.find(key);
+		if (it != _unbars_cache.end())
+			it->second->_cursor = cursor;
+	}
+
+	_price_map.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		double price = 0;
+		reader.get_str(stdCode);
+		reader.get(price);
+		_price_map[stdCode] = price;
+	}
+
+	_day_cache.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		WTSTickStruct curTS;
+		reader.get_str(stdCode);
+		reader.get(curTS);
+		_day_cache[stdCode] = curTS;
+	}
+
+	StraSubMap* subMaps[] = { &_tick_sub_map, &_ordque_sub_map, &_orddtl_sub_map, &_trans_sub_map };
+	for (StraSubMap* subMap : subMaps)
+	{
+		subMap->clear();
+		reader.get(cnt);
+		for (uint32_t i = 0; i < cnt && reader.good(); i++)
+		{
+			std::string stdCode;
+			uint32_t subCnt = 0;
+			reader.get_str(stdCode);
+			reader.get(subCnt);
+			SubList& sids = (*subMap)[stdCode];
+			for (uint32_t j = 0; j < subCnt && reader.good(); j++)
+			{
+				uint32_t sid = 0;
+				SubOpt opt;
+				reader.get(sid);
+				reader.get(opt.first);
+				reader.get(opt.second);
+				sids[sid] = opt;
+			}
+		}
+	}
+
+	uint64_t lastExeTime = 0;
+	reader.get(lastExeTime);
+	if (_task)
+		_task->_last_exe_time = lastExeTime;
+	reader.leave_block();
+
+	bool bRestored = false;
+	if (reader.enter_block("sink"))
+	{
+		bRestored = _listener->handle_restore(reader);
+		reader.leave_block();
+	}
+
+	if (!bRestored || !reader.good())
+	{
+		WTSLogger::error("Restoring from checkpoint {} failed", _resume_file);
+		return false;
+	}
+
+	WTSLogger::info("Backtest resumed from checkpoint {} of tradingday {} at {}, {} us elapsed", _resume_file, reader.tdate(), ckptTime, ticker.micro_seconds());
+	return true;
+}
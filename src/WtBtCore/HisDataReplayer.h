@@ -20,6 +20,10 @@
 #include "../WTSTools/WTSHotMgr.h"
 #include "../WTSTools/WTSBaseDataMgr.h"
 
+#include "../Share/StdUtils.hpp"
+#include "../Share/threadpool.hpp"
+#include "../Share/WtCheckpoint.hpp"
+
 NS_WTP_BEGIN
 class WTSTickData;
 class WTSVariant;
@@ -56,6 +60,14 @@ public:
 	virtual void	handle_replay_done() {}
 
 	virtual void	handle_section_end(uint32_t curTDate, uint32_t curTime) {}
+
+	/*
+	 *	断点的保存和恢复,只在交易日结束以后调用
+	 *	策略对象自己的成员变量不在断点里,需要跨日保留的状态要放到用户数据里
+	 *	返回false表示不支持断点
+	 */
+	virtual bool	handle_checkpoint(WtCkptWriter& writer) { return false; }
+	virtual bool	handle_restore(WtCkptReader& reader) { return false; }
 };
 
 /*
@@ -178,6 +190,33 @@ private:
 	typedef wt_hashmap<std::string, HftDataList<WTSOrdQueStruct>>	OrdQueCache;
 	typedef wt_hashmap<std::string, HftDataList<WTSTransStruct>>	TransCache;
 
+	typedef enum tagHftDataType
+	{
+		HDT_Tick = 0,
+		HDT_OrdDtl,
+		HDT_OrdQue,
+		HDT_Trans
+	} HftDataType;
+
+	/*
+	 *	预读的高频数据
+	 *	_reserved是预占的内存额度，读完以后换成实际大小
+	 *	_compact为true的时候，_content是定点紧凑格式的tick，取出来的时候再还原
+	 */
+	typedef struct _PrefetchItem
+	{
+		uint32_t	_date;
+		bool		_ready;
+		bool		_hit;
+		bool		_compact;
+		std::size_t	_reserved;
+		std::string	_content;
+
+		_PrefetchItem() :_date(0), _ready(false), _hit(false), _compact(false), _reserved(0) {}
+	} PrefetchItem;
+	typedef std::shared_ptr<PrefetchItem>	PrefetchItemPtr;
+	typedef wt_hashmap<std::string, PrefetchItemPtr>	PrefetchMap;
+
 
 	typedef struct _BarsList
 	{
@@ -292,6 +331,39 @@ private:
 	 */
 	bool		cacheRawTicksFromCSV(const std::string& key, const char* stdCode, uint32_t uDate);
 
+	/*
+	 *	从自定义数据文件读取高频数据的原始内容（已解压）
+	 *	预读线程和回放线程都会调用，只能访问初始化以后不再修改的成员
+	 */
+	bool		loadRawHftData(HftDataType dType, const char* stdCode, uint32_t uDate, std::string& content);
+
+	/*
+	 *	在后台线程预读下一个交易日的高频数据
+	 *	sizeHint是当天数据的大小，用来预占内存额度
+	 */
+	void		prefetchNextDay(HftDataType dType, const char* stdCode, uint32_t uDate, std::size_t sizeHint);
+
+	/*
+	 *	带换月规则的代码对应的规则索引
+	 *	策略每根K线都可能查当前的分月合约，第一次查的时候把代码解析和规则索引缓存下来，后面按日期直接取规则段
+	 *	只在回放线程里调用
+	 */
+	typedef struct _HotRuleRef
+	{
+		bool		_has_rule;	//代码是否带换月规则
+		uint32_t	_rule_idx;	//规则索引，没有对应规则的为INVALID_UINT32
+		std::string	_exchg;
+	} HotRuleRef;
+	const HotRuleRef&	get_hot_rule(const char* stdCode);
+
+	/*
+	 *	取走预读好的数据，如果还没读完则等待
+	 *	返回false表示没有这一天的预读，需要同步加载
+	 */
+	bool		takePrefetched(HftDataType dType, const char* stdCode, uint32_t uDate, std::string& content, bool& bHit);
+
+	void		clearPrefetched();
+
 	/*
 	 *	从外部加载器缓存历史数据
 	 */
@@ -376,6 +448,19 @@ private:
 
 	void	check_cache_days();
 
+	/*
+	 *	交易日结束以后调用,到了间隔的天数就保存断点
+	 */
+	void	check_checkpoint(uint32_t closedTDate);
+
+	bool	save_checkpoint(uint32_t closedTDate);
+
+	/*
+	 *	从断点恢复回放的游标和回调对象的状态
+	 *	在handle_init之后调用,策略初始化时订阅的数据已经加载好了
+	 */
+	bool	restore_checkpoint();
+
 public:
 	bool init(WTSVariant* cfg, EventNotifier* notifier = NULL, IBtDataLoader* dataLoader = NULL);
 
@@ -403,6 +488,26 @@ public:
 		_tick_enabled = bEnabled;
 	}
 
+	/*
+	 *	设置断点保存
+	 *	@folder	断点目录,为空则保存到输出目录下策略名对应的checkpoints目录
+	 *	@days	每隔多少个交易日保存一次,为0则不保存
+	 */
+	inline void set_checkpoint(const char* folder, uint32_t days)
+	{
+		_ckpt_folder = folder;
+		_ckpt_days = days;
+	}
+
+	/*
+	 *	设置恢复用的断点文件,回测从断点所在交易日的下一个交易日继续
+	 *	可以换一组策略参数从同一个断点分叉,共用前面的预热区间
+	 */
+	inline void set_resume_file(const char* filename)
+	{
+		_resume_file = filename;
+	}
+
 	inline void register_sink(IDataSink* listener, const char* sinkName) 
 	{
 		_listener = listener; 
@@ -509,6 +614,7 @@ private:
 
 	WTSBaseDataMgr	_bd_mgr;
 	WTSHotMgr		_hot_mgr;
+	wt_hashmap<std::string, HotRuleRef>	_hot_rules;	//代码到换月规则索引的缓存
 
 	std::string		_base_dir;
 	std::string		_mode;
@@ -569,5 +675,30 @@ private:
 	EventNotifier*	_notifier;
 
 	HisDataMgr		_his_dt_mgr;
+
+	/*
+	 *	tick回测的时候，换日要同步读文件和解压，回放线程会卡在每个交易日的开头
+	 *	所以当天的数据加载完以后，就在线程池里按合约并行预读下一个交易日的数据
+	 *	预读只改变读文件的时机，回放的顺序和数据都不变
+	 */
+	typedef std::shared_ptr<boost::threadpool::pool> ThreadPoolPtr;
+	ThreadPoolPtr		_prefetch_pool;
+	StdUniqueMutex		_prefetch_mtx;
+	StdCondVariable		_prefetch_cond;
+	PrefetchMap			_prefetch_items;
+	std::size_t			_prefetch_mem_cap;	//预读数据的内存上限
+	std::size_t			_prefetch_mem_used;	//预读数据占用的内存
+	bool				_prefetch_compact;	//预读的tick是否用紧凑格式缓存，同样的内存上限可以多预读一倍的合约
+
+	/*
+	 *	断点只在交易日结束以后保存,这时候当天的高频数据已经回放完了,下一个交易日会重新加载
+	 *	所以只需要保存时间、K线游标和少量的缓存,加上回调对象自己的状态
+	 */
+	std::string		_ckpt_folder;
+	uint32_t		_ckpt_days;		//保存间隔的交易日数
+	uint32_t		_ckpt_passed;	//上次保存以后结束的交易日数
+	uint32_t		_ckpt_tdate;	//最后一次检查的交易日,防止同一个交易日重复计数
+	std::string		_resume_file;
+	bool			_resumed;		//本次回测是否从断点恢复
 };
 
@@ -4,6 +4,7 @@
 
 #include "../Share/TimeUtils.hpp"
 #include "../Share/decimal.h"
+#include "../Share/WtCheckpoint.hpp"
 #include "../WTSTools/WTSLogger.h"
 
 #define PRICE_DOUBLE_TO_INT_P(x) ((int32_t)((x)*10000.0 + 0.5))
@@ -11,6 +12,7 @@
 #define PRICE_DOUBLE_TO_INT(x) (((x)==DBL_MAX)?0:((x)>0?PRICE_DOUBLE_TO_INT_P(x):PRICE_DOUBLE_TO_INT_N(x)))
 
 extern uint32_t makeLocalOrderID();
+extern void skipLocalOrderID(uint32_t lastID);
 
 void MatchEngine::init(WTSVariant* cfg)
 {
@@ -370,4 +372,99 @@ WTSTickData* MatchEngine::grab_last_tick(const char* stdCode)
 		return NULL;
 
 	return (WTSTickData*)_tick_cache->grab(stdCode);
+}
+
+void MatchEngine::save(WtCkptWriter& writer)
+{
+	writer.put((uint32_t)_orders.size());
+	for (auto& v : _orders)
+	{
+		writer.put(v.first);
+		writer.put(v.second);
+	}
+
+	writer.put((uint32_t)_lmt_ord_books.size());
+	for (auto& v : _lmt_ord_books)
+	{
+		const LmtOrdBook& curBook = v.second;
+		writer.put_str(v.first);
+		writer.put(curBook._cur_px);
+		writer.put(curBook._ask_px);
+		writer.put(curBook._bid_px);
+		writer.put((uint32_t)curBook._items.size());
+		for (auto& item : curBook._items)
+		{
+			writer.put(item.first);
+			writer.put(item.second);
+		}
+	}
+
+	uint32_t cnt = (_tick_cache == NULL) ? 0 : _tick_cache->size();
+	writer.put(cnt);
+	if (cnt > 0)
+	{
+		for (auto it = _tick_cache->begin(); it != _tick_cache->end(); it++)
+		{
+			writer.put_str(it->first);
+			writer.put(((WTSTickData*)it->second)->getTickStruct());
+		}
+	}
+}
+
+bool MatchEngine::restore(WtCkptReader& reader)
+{
+	uint32_t cnt = 0;
+	uint32_t maxID = 0;
+	_orders.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		uint32_t localid = 0;
+		OrderInfo ordInfo;
+		reader.get(localid);
+		if (!reader.get(ordInfo))
+			break;
+
+		_orders[localid] = ordInfo;
+		maxID = std::max(maxID, localid);
+	}
+	if (maxID > 0)
+		skipLocalOrderID(maxID);
+
+	_lmt_ord_books.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		LmtOrdBook& curBook = _lmt_ord_books[stdCode];
+		reader.get(curBook._cur_px);
+		reader.get(curBook._ask_px);
+		reader.get(curBook._bid_px);
+
+		uint32_t itemCnt = 0;
+		reader.get(itemCnt);
+		for (uint32_t j = 0; j < itemCnt && reader.good(); j++)
+		{
+			uint32_t px = 0;
+			reader.get(px);
+			reader.get(curBook._items[px]);
+		}
+	}
+
+	reader.get(cnt);
+	if (cnt > 0 && NULL == _tick_cache)
+		_tick_cache = WTSTickCache::create();
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		WTSTickStruct curTS;
+		reader.get_str(stdCode);
+		if (!reader.get(curTS))
+			break;
+
+		_tick_cache->add(stdCode, WTSTickData::create(curTS), false);
+	}
+
+	return reader.good();
 }
\ No newline at end of file
@@ -12,6 +12,8 @@
 NS_WTP_BEGIN
 class WTSTickData;
 class WTSVariant;
+class WtCkptWriter;
+class WtCkptReader;
 NS_WTP_END
 
 USING_NS_WTP;
@@ -79,6 +81,13 @@ public:
 	double		cancel(uint32_t localid);
 	virtual OrderIDs cancel(const char* stdCode, bool isBuy, double qty, FuncCancelCallback cb);
 
+	/*
+	 *	写入断点/从断点恢复
+	 *	包括未完成订单、价格队列和最新tick
+	 */
+	void	save(WtCkptWriter& writer);
+	bool	restore(WtCkptReader& reader);
+
 private:
 	typedef struct _OrderInfo
 	{
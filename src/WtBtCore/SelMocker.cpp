@@ -309,6 +309,168 @@ void SelMocker::handle_replay_done()
 	this->on_bactest_end();
 }
 
+bool SelMocker::handle_checkpoint(WtCkptWriter& writer)
+{
+	writer.put(_total_calc_time);
+	writer.put(_emit_times);
+	writer.put(_schedule_times);
+	writer.put(_cur_tdate);
+	writer.put(_fund_info);
+	writer.put(_ud_modified);
+
+	writer.put((uint32_t)_kline_tags.size());
+	for (auto& v : _kline_tags)
+	{
+		writer.put_str(v.first);
+		writer.put(v.second);
+	}
+
+	writer.put((uint32_t)_price_map.size());
+	for (auto& v : _price_map)
+	{
+		writer.put_str(v.first);
+		writer.put(v.second.first);
+		writer.put(v.second.second);
+	}
+
+	writer.put((uint32_t)_pos_map.size());
+	for (auto& v : _pos_map)
+	{
+		const PosInfo& pInfo = v.second;
+		writer.put_str(v.first);
+		writer.put(pInfo._volume);
+		writer.put(pInfo._closeprofit);
+		writer.put(pInfo._dynprofit);
+		writer.put(pInfo._last_entertime);
+		writer.put(pInfo._last_exittime);
+		writer.put(pInfo._frozen);
+		writer.put_vec(pInfo._details);
+	}
+
+	writer.put((uint32_t)_sig_map.size());
+	for (auto& v : _sig_map)
+	{
+		const SigInfo& sInfo = v.second;
+		writer.put_str(v.first);
+		writer.put(sInfo._volume);
+		writer.put_str(sInfo._usertag);
+		writer.put(sInfo._sigprice);
+		writer.put(sInfo._desprice);
+		writer.put(sInfo._triggered);
+		writer.put(sInfo._gentime);
+	}
+
+	writer.put((uint32_t)_user_datas.size());
+	for (auto& v : _user_datas)
+	{
+		writer.put_str(v.first);
+		writer.put_str(v.second);
+	}
+
+	writer.put((uint32_t)_tick_subs.size());
+	for (const std::string& stdCode : _tick_subs)
+		writer.put_str(stdCode);
+
+	writer.put_str(_trade_logs.str());
+	writer.put_str(_close_logs.str());
+	writer.put_str(_fund_logs.str());
+	writer.put_str(_sig_logs.str());
+	writer.put_str(_pos_logs.str());
+	return true;
+}
+
+bool SelMocker::handle_restore(WtCkptReader& reader)
+{
+	reader.get(_total_calc_time);
+	reader.get(_emit_times);
+	reader.get(_schedule_times);
+	reader.get(_cur_tdate);
+	reader.get(_fund_info);
+	reader.get(_ud_modified);
+
+	//按保存时的顺序插入,容器的遍历顺序和不中断的回测一致
+	uint32_t cnt = 0;
+	_kline_tags.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string key;
+		reader.get_str(key);
+		reader.get(_kline_tags[key]);
+	}
+
+	_price_map.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		PriceInfo& pxInfo = _price_map[stdCode];
+		reader.get(pxInfo.first);
+		reader.get(pxInfo.second);
+	}
+
+	_pos_map.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		PosInfo& pInfo = _pos_map[stdCode];
+		reader.get(pInfo._volume);
+		reader.get(pInfo._closeprofit);
+		reader.get(pInfo._dynprofit);
+		reader.get(pInfo._last_entertime);
+		reader.get(pInfo._last_exittime);
+		reader.get(pInfo._frozen);
+		reader.get_vec(pInfo._details);
+	}
+
+	_sig_map.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		SigInfo& sInfo = _sig_map[stdCode];
+		reader.get(sInfo._volume);
+		reader.get_str(sInfo._usertag);
+		reader.get(sInfo._sigprice);
+		reader.get(sInfo._desprice);
+		reader.get(sInfo._triggered);
+		reader.get(sInfo._gentime);
+	}
+
+	_user_datas.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string key;
+		reader.get_str(key);
+		reader.get_str(_user_datas[key]);
+	}
+
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		_tick_subs.insert(stdCode);
+	}
+
+	reader.get_str(_trade_logs);
+	reader.get_str(_close_logs);
+	reader.get_str(_fund_logs);
+	reader.get_str(_sig_logs);
+	reader.get_str(_pos_logs);
+
+	if (!reader.good())
+		return false;
+
+	WTSLogger::info("Strategy {} restored from checkpoint, {} positions, {} signals, {} user datas", _name, _pos_map.size(), _sig_map.size(), _user_datas.size());
+	return true;
+}
+
 void SelMocker::handle_tick(const char* stdCode, WTSTickData* newTick, uint32_t pxType)
 {
 	double cur_px = newTick->price();
@@ -82,6 +82,9 @@ public:
 	virtual void	handle_session_end(uint32_t uCurDate) override;
 	virtual void	handle_replay_done() override;
 
+	virtual bool	handle_checkpoint(WtCkptWriter& writer) override;
+	virtual bool	handle_restore(WtCkptReader& reader) override;
+
 	//////////////////////////////////////////////////////////////////////////
 	//ICtaStraCtx
 	virtual uint32_t id() { return _context_id; }
@@ -23,6 +23,7 @@
 #include "../WTSTools/WTSLogger.h"
 
 extern uint32_t makeLocalOrderID();
+extern void skipLocalOrderID(uint32_t lastID);
 
 const char* OFFSET_NAMES[] =
 {
@@ -49,6 +50,7 @@ UftMocker::UftMocker(HisDataReplayer* replayer, const char* name)
 	, _use_newpx(false)
 	, _error_rate(0)
 	, _match_this_tick(false)
+	, _bin_output(false)
 {
 	_context_id = makeUftCtxId();
 }
@@ -217,6 +219,163 @@ void UftMocker::handle_replay_done()
 	this->on_bactest_end();
 }
 
+bool UftMocker::handle_checkpoint(WtCkptWriter& writer)
+{
+	//二进制输出的结果已经写到表里了,不在断点里
+	if (_out_store)
+	{
+		WTSLogger::warn("Checkpoint is not supported with binary outputs");
+		return false;
+	}
+
+	if (!_tasks.empty())
+	{
+		WTSLogger::warn("{} tasks not processed, checkpoint skipped", _tasks.size());
+		return false;
+	}
+
+	auto put_pos_item = [&writer](const PosItem& pItem) {
+		writer.put(pItem._long);
+		writer.put(pItem._closeprofit);
+		writer.put(pItem._dynprofit);
+		writer.put(pItem._prevol);
+		writer.put(pItem._newvol);
+		writer.put(pItem._preavail);
+		writer.put(pItem._newavail);
+		writer.put_vec(pItem._details);
+	};
+
+	writer.put(_fund_info);
+	writer.put(_ud_modified);
+	writer.put(_match_this_tick);
+
+	writer.put((uint32_t)_price_map.size());
+	for (auto& v : _price_map)
+	{
+		writer.put_str(v.first);
+		writer.put(v.second);
+	}
+
+	writer.put((uint32_t)_orders.size());
+	for (auto& v : _orders)
+		writer.put(v.second);
+
+	writer.put((uint32_t)_pos_map.size());
+	for (auto& v : _pos_map)
+	{
+		writer.put_str(v.first);
+		put_pos_item(v.second._long);
+		put_pos_item(v.second._short);
+	}
+
+	writer.put((uint32_t)_user_datas.size());
+	for (auto& v : _user_datas)
+	{
+		writer.put_str(v.first);
+		writer.put_str(v.second);
+	}
+
+	writer.put((uint32_t)_tick_subs.size());
+	for (const std::string& stdCode : _tick_subs)
+		writer.put_str(stdCode);
+
+	writer.put_str(_trade_logs.str());
+	writer.put_str(_close_logs.str());
+	writer.put_str(_fund_logs.str());
+	writer.put_str(_pos_logs.str());
+	return true;
+}
+
+bool UftMocker::handle_restore(WtCkptReader& reader)
+{
+	if (_out_store)
+	{
+		WTSLogger::error("Restoring from checkpoint is not supported with binary outputs");
+		return false;
+	}
+
+	auto get_pos_item = [&reader](PosItem& pItem) {
+		reader.get(pItem._long);
+		reader.get(pItem._closeprofit);
+		reader.get(pItem._dynprofit);
+		reader.get(pItem._prevol);
+		reader.get(pItem._newvol);
+		reader.get(pItem._preavail);
+		reader.get(pItem._newavail);
+		reader.get_vec(pItem._details);
+	};
+
+	reader.get(_fund_info);
+	reader.get(_ud_modified);
+	reader.get(_match_this_tick);
+
+	//按保存时的顺序插入,容器的遍历顺序和不中断的回测一致
+	uint32_t cnt = 0;
+	_price_map.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		reader.get(_price_map[stdCode]);
+	}
+
+	uint32_t maxID = 0;
+	_orders.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		OrderInfo ordInfo;
+		if (!reader.get(ordInfo))
+			break;
+
+		_orders[ordInfo._localid] = ordInfo;
+		maxID = std::max(maxID, ordInfo._localid);
+	}
+	//新的订单号要排在恢复的订单后面
+	if (maxID > 0)
+		skipLocalOrderID(maxID);
+
+	_pos_map.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		PosInfo& pInfo = _pos_map[stdCode];
+		get_pos_item(pInfo._long);
+		get_pos_item(pInfo._short);
+	}
+
+	_user_datas.clear();
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string key;
+		reader.get_str(key);
+		reader.get_str(_user_datas[key]);
+	}
+
+	reader.get(cnt);
+	for (uint32_t i = 0; i < cnt && reader.good(); i++)
+	{
+		std::string stdCode;
+		reader.get_str(stdCode);
+		_tick_subs.insert(stdCode);
+	}
+
+	reader.get_str(_trade_logs);
+	reader.get_str(_close_logs);
+	reader.get_str(_fund_logs);
+	reader.get_str(_pos_logs);
+
+	if (!reader.good())
+		return false;
+
+	WTSLogger::info("Strategy {} restored from checkpoint, {} positions, {} orders, {} user datas", _name, _pos_map.size(), _orders.size(), _user_datas.size());
+	return true;
+}
+
 void UftMocker::on_bar(const char* stdCode, const char* period, uint32_t times, WTSBarStruct* newBar)
 {
 	if (_strategy)
@@ -340,6 +499,16 @@ uint32_t UftMocker::id()
 
 void UftMocker::on_init()
 {
+	if (_bin_output)
+	{
+		std::string folder = WtHelper::getOutputDir();
+		folder += _name;
+		folder += "/";
+		_out_store.reset(new BtOutputStore());
+		if (!_out_store->init(folder.c_str(), BT_FLAVOR_UFT))
+			_out_store.reset();
+	}
+
 	if (_strategy)
 		_strategy->on_init(this);
 }
@@ -382,15 +551,29 @@ void UftMocker::on_session_end(uint32_t curTDate)
 		total_dynprofit += pInfo.dynprofit();
 
 		if (!decimal::eq(pInfo._long.volume(), 0.0))
-			_pos_logs << fmt::format("{},{},LONG,{},{:.2f},{:.2f}\n", curTDate, stdCode, pInfo._long.volume(), pInfo._long._closeprofit, pInfo._long._dynprofit);
+		{
+			if (_out_store)
+				_out_store->log_position(curTDate, stdCode, true, pInfo._long.volume(), pInfo._long._closeprofit, pInfo._long._dynprofit);
+			else
+				_pos_logs << fmt::format("{},{},LONG,{},{:.2f},{:.2f}\n", curTDate, stdCode, pInfo._long.volume(), pInfo._long._closeprofit, pInfo._long._dynprofit);
+		}
 
 		if (!decimal::eq(pInfo._short.volume(), 0.0))
-			_pos_logs << fmt::format("{},{},LONG,{},{:.2f},{:.2f}\n", curTDate, stdCode, pInfo._short.volume(), pInfo._short._closeprofit, pInfo._short._dynprofit);
+		{
+			if (_out_store)
+				_out_store->log_position(curTDate, stdCode, false, pInfo._short.volume(), pInfo._short._closeprofit, pInfo._short._dynprofit);
+			else
+				_pos_logs << fmt::format("{},{},SHORT,{},{:.2f},{:.2f}\n", curTDate, stdCode, pInfo._short.volume(), pInfo._short._closeprofit, pInfo._short._dynprofit);
+		}
 	}
 
-	_fund_logs << fmt::format("{},{:.2f},{:.2f},{:.2f},{:.2f}\n", curDate,
-		_fund_info._total_profit, _fund_info._total_dynprofit,
-		_fund_info._total_profit + _fund_info._total_dynprofit - _fund_info._total_fees, _fund_info._total_fees);
+	if (_out_store)
+		_out_store->log_fund(curDate, _fund_info._total_profit, _fund_info._total_dynprofit,
+			_fund_info._total_profit + _fund_info._total_dynprofit - _fund_info._total_fees, _fund_info._total_fees);
+	else
+		_fund_logs << fmt::format("{},{:.2f},{:.2f},{:.2f},{:.2f}\n", curDate,
+			_fund_info._total_profit, _fund_info._total_dynprofit,
+			_fund_info._total_profit + _fund_info._total_dynprofit - _fund_info._total_fees, _fund_info._total_fees);
 }
 
 double UftMocker::stra_get_undone(const char* stdCode)
@@ -1107,6 +1290,14 @@ void UftMocker::dump_outputs()
 	folder += "/";
 	boost::filesystem::create_directories(folder.c_str());
 
+	if (_out_store)
+	{
+		//二进制输出的时候数据已经在表里了,关闭即可
+		_out_store->close();
+		_out_store.reset();
+		return;
+	}
+
 	std::string filename = folder + "trades.csv";
 	std::string content = "code,time,direct,action,price,qty,fee,usertag\n";
 	content += _trade_logs.str();
@@ -1131,6 +1322,12 @@ void UftMocker::dump_outputs()
 
 void UftMocker::log_trade(const char* stdCode, bool isLong, uint32_t offset, uint64_t curTime, double price, double qty, double fee)
 {
+	if (_out_store)
+	{
+		_out_store->log_trade(stdCode, isLong, (uint8_t)offset, curTime, price, qty, fee);
+		return;
+	}
+
 	_trade_logs << stdCode << "," << curTime << "," << (isLong ? "LONG" : "SHORT") << "," << OFFSET_NAMES[offset]
 		<< "," << price << "," << qty << "," << fee  << "\n";
 }
@@ -1138,6 +1335,12 @@ void UftMocker::log_trade(const char* stdCode, bool isLong, uint32_t offset, uin
 void UftMocker::log_close(const char* stdCode, bool isLong, uint64_t openTime, double openpx, uint64_t closeTime, double closepx, double qty, double profit, double maxprofit, double maxloss,
 	double totalprofit /* = 0 */)
 {
+	if (_out_store)
+	{
+		_out_store->log_close(stdCode, isLong, openTime, openpx, closeTime, closepx, qty, profit, maxprofit, maxloss, totalprofit);
+		return;
+	}
+
 	_close_logs << stdCode << "," << (isLong ? "LONG" : "SHORT") << "," << openTime << "," << openpx
 		<< "," << closeTime << "," << closepx << "," << qty << "," << profit << "," << maxprofit << "," << maxloss << ","
 		<< totalprofit << "\n";
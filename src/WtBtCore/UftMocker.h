@@ -12,6 +12,7 @@
 #include <sstream>
 
 #include "HisDataReplayer.h"
+#include "BtOutputStore.h"
 
 #include "../Includes/FasterDefs.h"
 #include "../Includes/IUftStraCtx.h"
@@ -68,6 +69,9 @@ public:
 
 	virtual void	handle_replay_done() override;
 
+	virtual bool	handle_checkpoint(WtCkptWriter& writer) override;
+	virtual bool	handle_restore(WtCkptReader& reader) override;
+
 	virtual void	on_tick_updated(const char* stdCode, WTSTickData* newTick) override;
 	virtual void	on_ordque_updated(const char* stdCode, WTSOrdQueData* newOrdQue) override;
 	virtual void	on_orddtl_updated(const char* stdCode, WTSOrdDtlData* newOrdDtl) override;
@@ -200,6 +204,9 @@ public:
 public:
 	bool	init_uft_factory(WTSVariant* cfg);
 
+	//回测结果写成二进制表,默认还是写csv
+	inline void	set_bin_output(bool bBinary) { _bin_output = bBinary; }
+
 private:
 	typedef std::function<void()> Task;
 	void	postTask(Task task);
@@ -344,6 +351,10 @@ private:
 	std::stringstream	_fund_logs;
 	std::stringstream	_pos_logs;
 
+	//二进制输出,为空则按原来的方式写csv
+	bool				_bin_output;
+	BtOutputStorePtr	_out_store;
+
 	typedef struct _StraFundInfo
 	{
 		double	_total_profit;
@@ -84,6 +84,7 @@ WtBtRunner::WtBtRunner()
 	, _inited(false)
 	, _running(false)
 	, _async(false)
+	, _bin_output(false)
 {
 	install_signal_hooks([](const char* message) {
 		WTSLogger::error(message);
@@ -275,6 +276,7 @@ uint32_t WtBtRunner::initCtaMocker(const char* name, int32_t slippage /* = 0 */,
 	}
 
 	_cta_mocker = new ExpCtaMocker(&_replayer, name, slippage, persistData, &_notifier, isRatioSlp);
+	_cta_mocker->set_bin_output(_bin_output);
 	if (bIncremental)
 	{
 		_cta_mocker->load_incremental_data(name);
@@ -293,6 +295,7 @@ uint32_t WtBtRunner::initHftMocker(const char* name, bool hook/* = false*/)
 	}
 
 	_hft_mocker = new ExpHftMocker(&_replayer, name);
+	_hft_mocker->set_bin_output(_bin_output);
 	if (hook) _hft_mocker->install_hook();
 	_replayer.register_sink(_hft_mocker, name);
 	return _hft_mocker->id();
@@ -471,11 +474,14 @@ void WtBtRunner::config(const char* cfgFile, bool isFile /* = true */)
 	WTSVariant* cfgEnv = _cfg->get("env");
 	const char* mode = cfgEnv->getCString("mocker");
 	WTSVariant* cfgMode = _cfg->get(mode);
+	//output为bin时回测结果写成二进制表,可以用WtDtHelper转成csv
+	_bin_output = (wt_stricmp(cfgEnv->getCString("output"), "bin") == 0);
 	if (strcmp(mode, "cta") == 0 && cfgMode)
 	{
 		const char* name = cfgMode->getCString("name");
 		int32_t slippage = cfgMode->getInt32("slippage");
 		_cta_mocker = new ExpCtaMocker(&_replayer, name, slippage, &_notifier);
+		_cta_mocker->set_bin_output(_bin_output);
 		_cta_mocker->init_cta_factory(cfgMode);
 		_replayer.register_sink(_cta_mocker, name);
 	}
@@ -483,6 +489,7 @@ void WtBtRunner::config(const char* cfgFile, bool isFile /* = true */)
 	{
 		const char* name = cfgMode->getCString("name");
 		_hft_mocker = new ExpHftMocker(&_replayer, name);
+		_hft_mocker->set_bin_output(_bin_output);
 		_hft_mocker->init_hft_factory(cfgMode);
 		_replayer.register_sink(_hft_mocker, name);
 	}
@@ -522,7 +529,12 @@ void WtBtRunner::run(bool bNeedDump /* = false */, bool bAsync /* = false */)
 	else if (_hft_mocker)
 		_hft_mocker->enable_hook(_async);
 
-	_replayer.prepare();
+	if (!_replayer.prepare())
+	{
+		WTSLogger::error("Preparing backtest failed");
+		return;
+	}
+
 	if (!bAsync)
 	{
 		_replayer.run(bNeedDump);
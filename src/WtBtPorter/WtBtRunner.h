@@ -206,6 +206,7 @@ private:
 
 	StdThreadPtr	_worker;
 	bool			_async;
+	bool			_bin_output;	//回测结果是否写成二进制表
 
 	void*			_feed_obj;
 	FuncReadBars	_feeder_bars;
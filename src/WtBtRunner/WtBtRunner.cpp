@@ -80,9 +80,12 @@ int main(int argc, char* argv[])
 	WTSVariant* cfgEnv = cfg->get("env");
 	const char* mode = cfgEnv->getCString("mocker");
 	int32_t slippage = cfgEnv->getInt32("slippage");
+	//output为bin时回测结果写成二进制表,可以用WtDtHelper转成csv
+	bool bBinOutput = (wt_stricmp(cfgEnv->getCString("output"), "bin") == 0);
 	if (strcmp(mode, "cta") == 0)
 	{
 		CtaMocker* mocker = new CtaMocker(&replayer, "cta", slippage);
+		mocker->set_bin_output(bBinOutput);
 		mocker->init_cta_factory(cfg->get("cta"));
 		const char* stra_id = cfg->get("cta")->get("strategy")->getCString("id");
 		// 加载增量回测的基础历史回测数据
@@ -96,6 +99,7 @@ int main(int argc, char* argv[])
 	else if (strcmp(mode, "hft") == 0)
 	{
 		HftMocker* mocker = new HftMocker(&replayer, "hft");
+		mocker->set_bin_output(bBinOutput);
 		mocker->init_hft_factory(cfg->get("hft"));
 		const char* stra_id = cfg->get("hft")->get("strategy")->getCString("id");
 		replayer.register_sink(mocker, stra_id);
@@ -119,14 +123,14 @@ int main(int argc, char* argv[])
 	else if (strcmp(mode, "uft") == 0)
 	{
 		UftMocker* mocker = new UftMocker(&replayer, "uft");
+		mocker->set_bin_output(bBinOutput);
 		mocker->init_uft_factory(cfg->get("uft"));
 		const char* stra_id = cfg->get("uft")->get("strategy")->getCString("id");
 		replayer.register_sink(mocker, stra_id);
 	}
 
-	replayer.prepare();
-
-	replayer.run(true);
+	if (replayer.prepare())
+		replayer.run(true);
 
 	printf("press enter key to exit\r\n");
 	getchar();
@@ -31,10 +31,55 @@ void on_mq_log(unsigned long id, const char* message, bool bServer)
 
 }
 
+/*
+ *	拷贝字符串到定长缓冲区,超长的截断,不把多字节字符截成半个
+ */
+inline void copy_str(char* des, const char* src, std::size_t cap)
+{
+	if (src == NULL)
+	{
+		des[0] = '\0';
+		return;
+	}
+
+	std::size_t len = strlen(src);
+	if (len >= cap)
+	{
+		len = cap - 1;
+		while (len > 0 && ((uint8_t)src[len] & 0xC0) == 0x80)
+			len--;
+	}
+	memcpy(des, src, len);
+	des[len] = '\0';
+}
+
+void EventNotifier::fill_msg(NotifyEvent& evt, const char* message)
+{
+	copy_str(evt._msg, message, sizeof(evt._msg));
+	if (message == NULL)
+		return;
+
+	std::size_t len = strlen(message);
+	if (len < sizeof(evt._msg))
+		return;
+
+	evt._ext_len = (uint32_t)len;
+	evt._ext_msg = new char[len + 1];
+	memcpy(evt._ext_msg, message, len + 1);
+}
+
+static const char* NOTIFY_TOPICS[] = {
+	"LOG", "GRP_EVENT", "TRD_NOTIFY", "TRD_TRADE", "TRD_ORDER", "CHART_INDEX", "CHART_MARKER", "STRA_TRADE"
+};
+
 EventNotifier::EventNotifier()
 	: _mq_sid(0)
 	, _publisher(NULL)
 	, _stopped(false)
+	, _binary(false)
+	, _last_dropped(0)
+	, _chart_sample(0)
+	, _pending_charts(0)
 {
 	
 }
@@ -46,8 +91,6 @@ EventNotifier::~EventNotifier()
 	if (_worker)
 		_worker->join();
 
-	_asyncio.stop();
-
 	if (_remover && _mq_sid != 0)
 		_remover(_mq_sid);
 }
@@ -84,46 +127,110 @@ bool EventNotifier::init(WTSVariant* cfg)
 	_publisher = (FundPublishMessage)DLLHelper::get_symbol(dllInst, "publish_message");
 	_register = (FuncRegCallbacks)DLLHelper::get_symbol(dllInst, "regiter_callbacks");
 
+	//队列容量,队列满了新的消息会被丢弃
+	uint32_t ringSize = cfg->getUInt32("ring_size");
+	if (ringSize == 0)
+		ringSize = 8192;
+	_ring.reset(new NotifyRing(ringSize));
+	//图表指标的采样周期,单位毫秒
+	_chart_sample = cfg->getUInt32("chart_sample");
+	//直接发布二进制格式,由订阅端自己解析
+	_binary = cfg->getBoolean("binary");
+
 	//注册回调函数
 	_register(on_mq_log);
 	
 	//创建一个MQServer
 	_mq_sid = _creator(_url.c_str());
 
-	WTSLogger::info("EventNotifier initialized with channel {}", _url.c_str());
+	WTSLogger::info("EventNotifier initialized with channel {}, ring size: {}, chart sampling: {}ms, binary: {}", 
+		_url.c_str(), _ring->capacity(), _chart_sample, _binary ? "yes" : "no");
 
 	if (_worker == NULL)
 	{
-		boost::asio::io_service::work work(_asyncio);
 		_worker.reset(new StdThread([this]() {
+			auto dispatch = [this](NotifyEvent& evt) {
+				if (evt._type == NT_CHART_INDEX && _chart_sample > 0)
+					sample_chart_index(evt, TimeUtils::getLocalTimeNow());
+				else
+					publish(evt);
+
+				if (evt._ext_msg != NULL)
+				{
+					delete[] evt._ext_msg;
+					evt._ext_msg = NULL;
+				}
+			};
+
 			while (!_stopped)
 			{
-				std::this_thread::sleep_for(std::chrono::milliseconds(2));
-				_asyncio.run_one();
-				//m_asyncIO.run();
+				uint32_t cnt = _ring->drain(dispatch, 1024);
+				flush_chart_index(TimeUtils::getLocalTimeNow(), false);
+
+				uint64_t dropped = _ring->dropped();
+				if (dropped != _last_dropped)
+				{
+					WTSLogger::warn("EventNotifier queue is full, {} messages dropped", dropped - _last_dropped);
+					_last_dropped = dropped;
+				}
+
+				if (cnt == 0)
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
 			}
+
+			//退出之前把剩下的都发出去
+			_ring->drain(dispatch);
+			flush_chart_index(0, true);
 		}));
 	}
 
 	return true;
 }
 
-void EventNotifier::notify_log(const char* tag, const char* message)
+void EventNotifier::publish(const NotifyEvent& evt)
 {
-	if (_mq_sid == 0)
+	if (_publisher == NULL || evt._type > NT_STRA_TRADE)
+		return;
+
+	const char* topic = NOTIFY_TOPICS[evt._type];
+	if (_binary)
+	{
+		if (evt._ext_msg == NULL)
+		{
+			_publisher(_mq_sid, topic, (const char*)&evt, (unsigned long)sizeof(NotifyEvent));
+			return;
+		}
+
+		//超长的消息接在结构体后面一起发,长度看_ext_len,指针对订阅端没有意义,清掉
+		std::string data((const char*)&evt, sizeof(NotifyEvent));
+		((NotifyEvent*)data.data())->_ext_msg = NULL;
+		data.append(evt._ext_msg, evt._ext_len);
+		_publisher(_mq_sid, topic, data.c_str(), (unsigned long)data.size());
 		return;
+	}
 
-	std::string strTag = tag;
-	std::string strMsg = message;
-	_asyncio.post([this, strTag, strMsg]() {
-		std::string data;
+	std::string data;
+	switch (evt._type)
+	{
+	case NT_TRD_TRADE:
+		tradeToJson(evt, data);
+		break;
+	case NT_TRD_ORDER:
+		orderToJson(evt, data);
+		break;
+	case NT_LOG:
+	case NT_EVENT:
+	case NT_TRD_NOTIFY:
 		{
 			rj::Document root(rj::kObjectType);
 			rj::Document::AllocatorType &allocator = root.GetAllocator();
 
-			root.AddMember("tag", rj::Value(strTag.c_str(), allocator), allocator);
-			root.AddMember("time", TimeUtils::getLocalTimeNow(), allocator);
-			root.AddMember("message", rj::Value(strMsg.c_str(), allocator), allocator);
+			if (evt._type == NT_LOG)
+				root.AddMember("tag", rj::Value(evt._code, allocator), allocator);
+			else if (evt._type == NT_TRD_NOTIFY)
+				root.AddMember("trader", rj::Value(evt._id, allocator), allocator);
+			root.AddMember("time", evt._time, allocator);
+			root.AddMember("message", rj::Value(evt._ext_msg != NULL ? evt._ext_msg : evt._msg, allocator), allocator);
 
 			rj::StringBuffer sb;
 			rj::PrettyWriter<rj::StringBuffer> writer(sb);
@@ -131,26 +238,17 @@ void EventNotifier::notify_log(const char* tag, const char* message)
 
 			data = sb.GetString();
 		}
-
-		if (_publisher)
-			_publisher(_mq_sid, "LOG", data.c_str(), (unsigned long)data.size());
-	});
-}
-
-void EventNotifier::notify_event(const char* message)
-{
-	if (_mq_sid == 0)
-		return;
-
-	std::string strMsg = message;
-	_asyncio.post([this, strMsg]() {
-		std::string data;
+		break;
+	case NT_CHART_INDEX:
 		{
 			rj::Document root(rj::kObjectType);
 			rj::Document::AllocatorType &allocator = root.GetAllocator();
 
-			root.AddMember("time", TimeUtils::getLocalTimeNow(), allocator);
-			root.AddMember("message", rj::Value(strMsg.c_str(), allocator), allocator);
+			root.AddMember("strategy", rj::Value(evt._id, allocator), allocator);
+			root.AddMember("index_name", rj::Value(evt._code, allocator), allocator);
+			root.AddMember("line_name", rj::Value(evt._tag, allocator), allocator);
+			root.AddMember("time", evt._time, allocator);
+			root.AddMember("value", evt._price, allocator);
 
 			rj::StringBuffer sb;
 			rj::PrettyWriter<rj::StringBuffer> writer(sb);
@@ -158,240 +256,293 @@ void EventNotifier::notify_event(const char* message)
 
 			data = sb.GetString();
 		}
-		if (_publisher)
-			_publisher(_mq_sid, "GRP_EVENT", data.c_str(), (unsigned long)data.size());
-	});
-}
+		break;
+	case NT_CHART_MARKER:
+		{
+			rj::Document root(rj::kObjectType);
+			rj::Document::AllocatorType &allocator = root.GetAllocator();
 
-void EventNotifier::notify(const char* trader, const char* message)
-{
-	if (_mq_sid == 0)
-		return;
+			root.AddMember("strategy", rj::Value(evt._id, allocator), allocator);
+			root.AddMember("icon", rj::Value(evt._code, allocator), allocator);
+			root.AddMember("tag", rj::Value(evt._tag, allocator), allocator);
+			root.AddMember("time", evt._time, allocator);
+			root.AddMember("price", evt._price, allocator);
 
-	std::string strTrader = trader;
-	std::string strMsg = message;
-	_asyncio.post([this, strTrader, strMsg]() {
-		std::string data;
+			rj::StringBuffer sb;
+			rj::Writer<rj::StringBuffer> writer(sb);
+			root.Accept(writer);
+
+			data = sb.GetString();
+		}
+		break;
+	case NT_STRA_TRADE:
 		{
 			rj::Document root(rj::kObjectType);
 			rj::Document::AllocatorType &allocator = root.GetAllocator();
 
-			root.AddMember("trader", rj::Value(strTrader.c_str(), allocator), allocator);
-			root.AddMember("time", TimeUtils::getLocalTimeNow(), allocator);
-			root.AddMember("message", rj::Value(strMsg.c_str(), allocator), allocator);
+			root.AddMember("strategy", rj::Value(evt._id, allocator), allocator);
+			root.AddMember("code", rj::Value(evt._code, allocator), allocator);
+			root.AddMember("tag", rj::Value(evt._tag, allocator), allocator);
+			root.AddMember("long", evt._long, allocator);
+			root.AddMember("open", evt._open, allocator);
+			root.AddMember("time", evt._time, allocator);
+			root.AddMember("price", evt._price, allocator);
 
 			rj::StringBuffer sb;
-			rj::PrettyWriter<rj::StringBuffer> writer(sb);
+			rj::Writer<rj::StringBuffer> writer(sb);
 			root.Accept(writer);
 
 			data = sb.GetString();
 		}
-		if (_publisher)
-			_publisher(_mq_sid, "TRD_NOTIFY", data.c_str(), (unsigned long)data.size());
-	});
-}
-
-void EventNotifier::notify(const char* trader, uint32_t localid, const char* stdCode, WTSTradeInfo* trdInfo)
-{
-	if (trdInfo == NULL || _mq_sid == 0)
+		break;
+	default:
 		return;
+	}
 
-	std::string strTrader = trader;
-	std::string strCode = stdCode;
-	trdInfo->retain();
-	_asyncio.post([this, strTrader, strCode, localid, trdInfo]() {
-		std::string data;
-		tradeToJson(strTrader.c_str(), localid, strCode.c_str(), trdInfo, data);
-		if (_publisher)
-			_publisher(_mq_sid, "TRD_TRADE", data.c_str(), (unsigned long)data.size());
-		trdInfo->release();
-	});
+	_publisher(_mq_sid, topic, data.c_str(), (unsigned long)data.size());
 }
 
-void EventNotifier::notify(const char* trader, uint32_t localid, const char* stdCode, WTSOrderInfo* ordInfo)
+void EventNotifier::sample_chart_index(const NotifyEvent& evt, uint64_t now)
 {
-	if (ordInfo == NULL || _mq_sid == 0)
+	std::string key = evt._id;
+	key += "|";
+	key += evt._code;
+	key += "|";
+	key += evt._tag;
+
+	auto it = _chart_samples.find(key);
+	if (it == _chart_samples.end())
+	{
+		ChartSample& sample = _chart_samples[key];
+		sample._has_pending = false;
+		sample._last_time = now;
+		publish(evt);
 		return;
+	}
 
-	std::string strTrader = trader;
-	std::string strCode = stdCode;
-	ordInfo->retain();
-	_asyncio.post([this, strTrader, strCode, localid, ordInfo]() {
-		std::string data;
-		orderToJson(strTrader.c_str(), localid, strCode.c_str(), ordInfo, data);
-		if (_publisher)
-			_publisher(_mq_sid, "TRD_ORDER", data.c_str(), (unsigned long)data.size());
-	});
-
-	
-}
+	ChartSample& sample = it->second;
+	//时间点变了,上一个时间点最后的值要先发出去,不能被新的时间点覆盖掉
+	if (sample._has_pending && sample._pending._time != evt._time)
+	{
+		publish(sample._pending);
+		sample._has_pending = false;
+		_pending_charts--;
+	}
 
-void EventNotifier::tradeToJson(const char* trader, uint32_t localid, const char* stdCode, WTSTradeInfo* trdInfo, std::string& output)
-{
-	if(trdInfo == NULL)
+	if (now - sample._last_time >= _chart_sample)
 	{
-		output = "{}";
+		if (sample._has_pending)
+		{
+			sample._has_pending = false;
+			_pending_charts--;
+		}
+		sample._last_time = now;
+		publish(evt);
 		return;
 	}
 
-	bool isLong = (trdInfo->getDirection() == WDT_LONG);
-	bool isOpen = (trdInfo->getOffsetType() == WOT_OPEN);
-	bool isToday = (trdInfo->getOffsetType() == WOT_CLOSETODAY);
-
+	if (!sample._has_pending)
 	{
-		rj::Document root(rj::kObjectType);
-		rj::Document::AllocatorType &allocator = root.GetAllocator();
+		sample._has_pending = true;
+		_pending_charts++;
+	}
+	sample._pending = evt;
+}
 
-		root.AddMember("trader", rj::Value(trader, allocator), allocator);
-		root.AddMember("time", TimeUtils::getLocalTimeNow(), allocator);
-		root.AddMember("localid", localid, allocator);
-		root.AddMember("code", rj::Value(stdCode, allocator), allocator);
-		root.AddMember("islong", isLong, allocator);
-		root.AddMember("isopen", isOpen, allocator);
-		root.AddMember("istoday", isToday, allocator);
+void EventNotifier::flush_chart_index(uint64_t now, bool bForce)
+{
+	if (_pending_charts == 0)
+		return;
 
-		root.AddMember("volume", trdInfo->getVolume(), allocator);
-		root.AddMember("price", trdInfo->getPrice(), allocator);
+	for (auto& item : _chart_samples)
+	{
+		ChartSample& sample = item.second;
+		if (!sample._has_pending)
+			continue;
 
-		rj::StringBuffer sb;
-		rj::PrettyWriter<rj::StringBuffer> writer(sb);
-		root.Accept(writer);
+		if (!bForce && now - sample._last_time < _chart_sample)
+			continue;
 
-		output = sb.GetString();
+		publish(sample._pending);
+		sample._has_pending = false;
+		sample._last_time = now;
+		_pending_charts--;
 	}
 }
 
-void EventNotifier::orderToJson(const char* trader, uint32_t localid, const char* stdCode, WTSOrderInfo* ordInfo, std::string& output)
+void EventNotifier::notify_log(const char* tag, const char* message)
 {
-	if (ordInfo == NULL)
-	{
-		output = "{}";
+	if (_mq_sid == 0)
 		return;
-	}
-
-	bool isLong = (ordInfo->getDirection() == WDT_LONG);
-	bool isOpen = (ordInfo->getOffsetType() == WOT_OPEN);
-	bool isToday = (ordInfo->getOffsetType() == WOT_CLOSETODAY);
-	bool isCanceled = (ordInfo->getOrderState() == WOS_Canceled);
 
-	{
-		rj::Document root(rj::kObjectType);
-		rj::Document::AllocatorType &allocator = root.GetAllocator();
-
-		root.AddMember("trader", rj::Value(trader, allocator), allocator);
-		root.AddMember("time", TimeUtils::getLocalTimeNow(), allocator);
-		root.AddMember("localid", localid, allocator);
-		root.AddMember("code", rj::Value(stdCode, allocator), allocator);
-		root.AddMember("islong", isLong, allocator);
-		root.AddMember("isopen", isOpen, allocator);
-		root.AddMember("istoday", isToday, allocator);
-		root.AddMember("canceled", isCanceled, allocator);
-
-		root.AddMember("total", ordInfo->getVolume(), allocator);
-		root.AddMember("left", ordInfo->getVolLeft(), allocator);
-		root.AddMember("traded", ordInfo->getVolTraded(), allocator);
-		root.AddMember("price", ordInfo->getPrice(), allocator);
-		root.AddMember("state", rj::Value(ordInfo->getStateMsg(), allocator), allocator);
-
-		rj::StringBuffer sb;
-		rj::PrettyWriter<rj::StringBuffer> writer(sb);
-		root.Accept(writer);
-
-		output = sb.GetString();
-	}
+	push_event([tag, message](NotifyEvent& evt) {
+		evt._type = NT_LOG;
+		evt._time = TimeUtils::getLocalTimeNow();
+		copy_str(evt._code, tag, sizeof(evt._code));
+		fill_msg(evt, message);
+	});
 }
 
-void EventNotifier::notify_chart_index(uint64_t time, const char* straId, const char* idxName, const char* lineName, double val)
+void EventNotifier::notify_event(const char* message)
 {
 	if (_mq_sid == 0)
 		return;
 
-	std::string sid = straId;
-	std::string iname = idxName;
-	std::string lname = lineName;
-	_asyncio.post([this, time, sid, iname, lname, val]() {
-		std::string data;
-		{
-			rj::Document root(rj::kObjectType);
-			rj::Document::AllocatorType &allocator = root.GetAllocator();
+	push_event([message](NotifyEvent& evt) {
+		evt._type = NT_EVENT;
+		evt._time = TimeUtils::getLocalTimeNow();
+		fill_msg(evt, message);
+	});
+}
 
-			root.AddMember("strategy", rj::Value(sid.c_str(), allocator), allocator);
-			root.AddMember("index_name", rj::Value(iname.c_str(), allocator), allocator);
-			root.AddMember("line_name", rj::Value(lname.c_str(), allocator), allocator);
-			root.AddMember("time", time, allocator);
-			root.AddMember("value", val, allocator);
+void EventNotifier::notify(const char* trader, const char* message)
+{
+	if (_mq_sid == 0)
+		return;
 
-			rj::StringBuffer sb;
-			rj::PrettyWriter<rj::StringBuffer> writer(sb);
-			root.Accept(writer);
+	push_event([trader, message](NotifyEvent& evt) {
+		evt._type = NT_TRD_NOTIFY;
+		evt._time = TimeUtils::getLocalTimeNow();
+		copy_str(evt._id, trader, sizeof(evt._id));
+		fill_msg(evt, message);
+	});
+}
 
-			data = sb.GetString();
-		}
-		if (_publisher)
-			_publisher(_mq_sid, "CHART_INDEX", data.c_str(), (unsigned long)data.size());
+void EventNotifier::notify(const char* trader, uint32_t localid, const char* stdCode, WTSTradeInfo* trdInfo)
+{
+	if (trdInfo == NULL || _mq_sid == 0)
+		return;
+
+	push_event([trader, localid, stdCode, trdInfo](NotifyEvent& evt) {
+		evt._type = NT_TRD_TRADE;
+		evt._localid = localid;
+		evt._time = TimeUtils::getLocalTimeNow();
+		evt._long = (trdInfo->getDirection() == WDT_LONG);
+		evt._open = (trdInfo->getOffsetType() == WOT_OPEN);
+		evt._today = (trdInfo->getOffsetType() == WOT_CLOSETODAY);
+		evt._volume = trdInfo->getVolume();
+		evt._price = trdInfo->getPrice();
+		copy_str(evt._id, trader, sizeof(evt._id));
+		copy_str(evt._code, stdCode, sizeof(evt._code));
 	});
 }
 
-void EventNotifier::notify_chart_marker(uint64_t time, const char* straId, double price, const char* icon, const char* tag)
+void EventNotifier::notify(const char* trader, uint32_t localid, const char* stdCode, WTSOrderInfo* ordInfo)
 {
-	if (_mq_sid == 0)
+	if (ordInfo == NULL || _mq_sid == 0)
 		return;
 
-	std::string sid = straId;
-	std::string sIcon = icon;
-	std::string sTag = tag;
-	_asyncio.post([this, time, sid, sIcon, sTag, price]() {
-		std::string data;
-		{
-			rj::Document root(rj::kObjectType);
-			rj::Document::AllocatorType &allocator = root.GetAllocator();
+	push_event([trader, localid, stdCode, ordInfo](NotifyEvent& evt) {
+		evt._type = NT_TRD_ORDER;
+		evt._localid = localid;
+		evt._time = TimeUtils::getLocalTimeNow();
+		evt._long = (ordInfo->getDirection() == WDT_LONG);
+		evt._open = (ordInfo->getOffsetType() == WOT_OPEN);
+		evt._today = (ordInfo->getOffsetType() == WOT_CLOSETODAY);
+		evt._canceled = (ordInfo->getOrderState() == WOS_Canceled);
+		evt._volume = ordInfo->getVolume();
+		evt._left = ordInfo->getVolLeft();
+		evt._traded = ordInfo->getVolTraded();
+		evt._price = ordInfo->getPrice();
+		copy_str(evt._id, trader, sizeof(evt._id));
+		copy_str(evt._code, stdCode, sizeof(evt._code));
+		fill_msg(evt, ordInfo->getStateMsg());
+	});
+}
 
-			root.AddMember("strategy", rj::Value(sid.c_str(), allocator), allocator);
-			root.AddMember("icon", rj::Value(sIcon.c_str(), allocator), allocator);
-			root.AddMember("tag", rj::Value(sTag.c_str(), allocator), allocator);
-			root.AddMember("time", time, allocator);
-			root.AddMember("price", price, allocator);
+void EventNotifier::tradeToJson(const NotifyEvent& evt, std::string& output)
+{
+	rj::Document root(rj::kObjectType);
+	rj::Document::AllocatorType &allocator = root.GetAllocator();
 
-			rj::StringBuffer sb;
-			rj::Writer<rj::StringBuffer> writer(sb);
-			root.Accept(writer);
+	root.AddMember("trader", rj::Value(evt._id, allocator), allocator);
+	root.AddMember("time", evt._time, allocator);
+	root.AddMember("localid", evt._localid, allocator);
+	root.AddMember("code", rj::Value(evt._code, allocator), allocator);
+	root.AddMember("islong", evt._long, allocator);
+	root.AddMember("isopen", evt._open, allocator);
+	root.AddMember("istoday", evt._today, allocator);
 
-			data = sb.GetString();
-		}
-		if (_publisher)
-			_publisher(_mq_sid, "CHART_MARKER", data.c_str(), (unsigned long)data.size());
-	});
+	root.AddMember("volume", evt._volume, allocator);
+	root.AddMember("price", evt._price, allocator);
+
+	rj::StringBuffer sb;
+	rj::PrettyWriter<rj::StringBuffer> writer(sb);
+	root.Accept(writer);
+
+	output = sb.GetString();
 }
 
-void EventNotifier::notify_trade(const char* straId, const char* stdCode, bool isLong, bool isOpen, uint64_t curTime, double price, const char* userTag)
+void EventNotifier::orderToJson(const NotifyEvent& evt, std::string& output)
+{
+	rj::Document root(rj::kObjectType);
+	rj::Document::AllocatorType &allocator = root.GetAllocator();
+
+	root.AddMember("trader", rj::Value(evt._id, allocator), allocator);
+	root.AddMember("time", evt._time, allocator);
+	root.AddMember("localid", evt._localid, allocator);
+	root.AddMember("code", rj::Value(evt._code, allocator), allocator);
+	root.AddMember("islong", evt._long, allocator);
+	root.AddMember("isopen", evt._open, allocator);
+	root.AddMember("istoday", evt._today, allocator);
+	root.AddMember("canceled", evt._canceled, allocator);
+
+	root.AddMember("total", evt._volume, allocator);
+	root.AddMember("left", evt._left, allocator);
+	root.AddMember("traded", evt._traded, allocator);
+	root.AddMember("price", evt._price, allocator);
+	root.AddMember("state", rj::Value(evt._ext_msg != NULL ? evt._ext_msg : evt._msg, allocator), allocator);
+
+	rj::StringBuffer sb;
+	rj::PrettyWriter<rj::StringBuffer> writer(sb);
+	root.Accept(writer);
+
+	output = sb.GetString();
+}
+
+void EventNotifier::notify_chart_index(uint64_t time, const char* straId, const char* idxName, const char* lineName, double val)
 {
 	if (_mq_sid == 0)
 		return;
 
-	std::string sid = straId;
-	std::string code = stdCode;
-	std::string tag = userTag;
-	_asyncio.post([this, sid, code, tag, isLong, isOpen, curTime, price]() {
-		std::string data;
-		{
-			rj::Document root(rj::kObjectType);
-			rj::Document::AllocatorType &allocator = root.GetAllocator();
+	push_event([time, straId, idxName, lineName, val](NotifyEvent& evt) {
+		evt._type = NT_CHART_INDEX;
+		evt._time = time;
+		evt._price = val;
+		copy_str(evt._id, straId, sizeof(evt._id));
+		copy_str(evt._code, idxName, sizeof(evt._code));
+		copy_str(evt._tag, lineName, sizeof(evt._tag));
+	});
+}
 
-			root.AddMember("strategy", rj::Value(sid.c_str(), allocator), allocator);
-			root.AddMember("code", rj::Value(code.c_str(), allocator), allocator);
-			root.AddMember("tag", rj::Value(tag.c_str(), allocator), allocator);
-			root.AddMember("long", isLong, allocator);
-			root.AddMember("open", isOpen, allocator);
-			root.AddMember("time", curTime, allocator);
-			root.AddMember("price", price, allocator);
+void EventNotifier::notify_chart_marker(uint64_t time, const char* straId, double price, const char* icon, const char* tag)
+{
+	if (_mq_sid == 0)
+		return;
 
-			rj::StringBuffer sb;
-			rj::Writer<rj::StringBuffer> writer(sb);
-			root.Accept(writer);
+	push_event([time, straId, price, icon, tag](NotifyEvent& evt) {
+		evt._type = NT_CHART_MARKER;
+		evt._time = time;
+		evt._price = price;
+		copy_str(evt._id, straId, sizeof(evt._id));
+		copy_str(evt._code, icon, sizeof(evt._code));
+		copy_str(evt._tag, tag, sizeof(evt._tag));
+	});
+}
 
-			data = sb.GetString();
-		}
-		if (_publisher)
-			_publisher(_mq_sid, "STRA_TRADE", data.c_str(), (unsigned long)data.size());
+void EventNotifier::notify_trade(const char* straId, const char* stdCode, bool isLong, bool isOpen, uint64_t curTime, double price, const char* userTag)
+{
+	if (_mq_sid == 0)
+		return;
+
+	push_event([straId, stdCode, isLong, isOpen, curTime, price, userTag](NotifyEvent& evt) {
+		evt._type = NT_STRA_TRADE;
+		evt._time = curTime;
+		evt._price = price;
+		evt._long = isLong;
+		evt._open = isOpen;
+		copy_str(evt._id, straId, sizeof(evt._id));
+		copy_str(evt._code, stdCode, sizeof(evt._code));
+		copy_str(evt._tag, userTag, sizeof(evt._tag));
 	});
 }
\ No newline at end of file
@@ -9,11 +9,12 @@
  */
 #pragma once
 
-#include <boost/asio/io_service.hpp>
 
 #include "../Includes/WTSMarcos.h"
 #include "../Includes/WTSObject.hpp"
 #include "../Share/StdUtils.hpp"
+#include "../Share/WtMpscRing.hpp"
+#include "../Includes/FasterDefs.h"
 
 typedef unsigned long(*FuncCreateMQServer)(const char*);
 typedef void(*FuncDestroyMQServer)(unsigned long);
@@ -28,6 +29,45 @@ class WTSTradeInfo;
 class WTSOrderInfo;
 class WTSVariant;
 
+/*
+ *	通知消息的二进制格式
+ *	交易线程只把字段填到预先分配好的环形队列里,转成json和发布都在发布线程里做
+ */
+typedef enum tagNotifyType
+{
+	NT_LOG = 0,			//日志
+	NT_EVENT,			//组合事件
+	NT_TRD_NOTIFY,		//交易通道消息
+	NT_TRD_TRADE,		//成交回报
+	NT_TRD_ORDER,		//订单回报
+	NT_CHART_INDEX,		//图表指标
+	NT_CHART_MARKER,	//图表标记
+	NT_STRA_TRADE		//策略信号成交
+} NotifyType;
+
+#pragma pack(push, 8)
+typedef struct _NotifyEvent
+{
+	uint32_t	_type;		//NotifyType
+	uint32_t	_localid;	//本地订单号
+	uint64_t	_time;		//时间,回报类的为产生时的本地时间,图表类的为策略时间
+	double		_price;		//价格,图表指标为指标值
+	double		_volume;	//成交数量或者委托数量
+	double		_left;		//剩余数量
+	double		_traded;	//已成交数量
+	bool		_long;
+	bool		_open;
+	bool		_today;
+	bool		_canceled;
+	uint32_t	_ext_len;	//超长消息的完整长度,没有超长为0
+	char		_id[64];	//交易通道或者策略名
+	char		_code[64];	//合约代码/指标名/标记图标/日志标签
+	char		_tag[64];	//线名/用户标记
+	char		_msg[256];	//消息内容/订单状态信息
+	char*		_ext_msg;	//超过_msg长度的消息,完整内容放在堆上,发布以后由发布线程释放
+} NotifyEvent;
+#pragma pack(pop)
+
 class EventNotifier
 {
 public:
@@ -36,8 +76,39 @@ public:
 
 
 private:
-	void	tradeToJson(const char* trader, uint32_t localid, const char* stdCode, WTSTradeInfo* trdInfo, std::string& output);
-	void	orderToJson(const char* trader, uint32_t localid, const char* stdCode, WTSOrderInfo* ordInfo, std::string& output);
+	void	tradeToJson(const NotifyEvent& evt, std::string& output);
+	void	orderToJson(const NotifyEvent& evt, std::string& output);
+
+	/*
+	 *	填写消息内容
+	 *	放得下的直接写在槽位里,放不下的另外在堆上拷贝一份完整的,不截断
+	 */
+	static void	fill_msg(NotifyEvent& evt, const char* message);
+
+	/*
+	 *	在发布线程里把一条消息转成json并发布
+	 */
+	void	publish(const NotifyEvent& evt);
+
+	/*
+	 *	图表指标的采样
+	 *	同一个策略同一根线,一个采样周期内只发布最新的值
+	 */
+	void	sample_chart_index(const NotifyEvent& evt, uint64_t now);
+	void	flush_chart_index(uint64_t now, bool bForce);
+
+	/*
+	 *	入队一条消息
+	 *	槽位是循环使用的,先清空再填写,不然没填的字段会带着上一条消息的内容
+	 */
+	template<typename FuncFill>
+	inline void	push_event(FuncFill fill)
+	{
+		_ring->push([&fill](NotifyEvent& evt) {
+			evt = NotifyEvent();
+			fill(evt);
+		});
+	}
 
 public:
 	bool	init(WTSVariant* cfg);
@@ -62,9 +133,23 @@ private:
 	FundPublishMessage	_publisher;
 	FuncRegCallbacks	_register;
 
-	bool			_stopped;
-	boost::asio::io_service		_asyncio;
-	StdThreadPtr				_worker;
+	bool			_stopped;
+	StdThreadPtr	_worker;
+
+	typedef WtMpscRing<NotifyEvent>	NotifyRing;
+	std::unique_ptr<NotifyRing>	_ring;
+	bool			_binary;		//是否直接发布二进制格式
+	uint64_t		_last_dropped;
+
+	typedef struct _ChartSample
+	{
+		NotifyEvent	_pending;
+		bool		_has_pending;
+		uint64_t	_last_time;
+	} ChartSample;
+	uint32_t		_chart_sample;	//图表指标的采样周期,单位毫秒,0为不采样
+	wt_hashmap<std::string, ChartSample>	_chart_samples;
+	uint32_t		_pending_charts;
 };
 
 NS_WTP_END
\ No newline at end of file
@@ -8,6 +8,7 @@
  * \brief
  */
 #include "HftStraContext.h"
+#include "../Share/WtTickTrace.hpp"
 #include "../Includes/HftStrategyDefs.h"
 
 
@@ -54,7 +55,11 @@ void HftStraContext::on_tick(const char* stdCode, WTSTickData* newTick)
 	if (it != _tick_subs.end())
 	{
 		if (_strategy)
+		{
+			WT_TRACE_ENTER(newTick);
 			_strategy->on_tick(this, stdCode, newTick);
+			WT_TRACE_LEAVE();
+		}
 	}
 
 	HftStraBaseCtx::on_tick(stdCode, newTick);
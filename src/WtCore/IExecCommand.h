@@ -18,15 +18,34 @@ public:
 	virtual uint32_t get_trading_day() = 0;
 };
 
+class IExecCommand;
+
+/*
+ *	执行器的代码索引
+ *	执行器创建执行单元以后登记代码,管理器据此只把行情推送给有对应执行单元的执行器
+ */
+class IExecCodeIndex
+{
+public:
+	virtual void on_code_added(IExecCommand* executer, const char* stdCode) = 0;
+};
+
 class IExecCommand
 {
 public:
-	IExecCommand(const char* name) :_stub(NULL), _name(name){}
+	IExecCommand(const char* name) :_stub(NULL), _name(name), _code_index(NULL), _code_indexed(false){}
 	/*
 	 *	设置目标仓位
 	 */
 	virtual void set_position(const wt_hashmap<std::string, double>& targets) {}
 
+	/*
+	 *	按差量设置目标仓位
+	 *	changes里只有目标仓位发生变化的合约,移出目标的合约目标仓位为0
+	 *	返回false表示不支持差量,管理器会改用set_position推送全量目标
+	 */
+	virtual bool set_position_diff(const wt_hashmap<std::string, double>& changes) { return false; }
+
 	/*
 	 *	合约仓位变动
 	 */
@@ -44,8 +63,25 @@ public:
 
 	inline void setName(const char* name) { _name = name; }
 
+	inline void setCodeIndex(IExecCodeIndex* index) { _code_index = index; }
+
+	/*
+	 *	是否会登记执行单元的代码,不登记的执行器会收到全部行情
+	 */
+	inline bool isCodeIndexed() const { return _code_indexed; }
+
+protected:
+	inline void indexCode(const char* stdCode)
+	{
+		if (_code_index)
+			_code_index->on_code_added(this, stdCode);
+	}
+
 protected:
 	IExecuterStub*	_stub;
 	std::string		_name;
+
+	IExecCodeIndex*	_code_index;
+	bool			_code_indexed;
 };
 NS_WTP_END
\ No newline at end of file
@@ -14,6 +14,7 @@
 
 #include "../Share/CodeHelper.hpp"
 #include "../Share/TimeUtils.hpp"
+#include "../Share/WtTickTrace.hpp"
 
 #include "../Includes/WTSContractInfo.hpp"
 #include "../Includes/WTSDataDef.hpp"
@@ -31,6 +32,7 @@ ParserAdapter::ParserAdapter()
 	: _parser_api(NULL)
 	, _remover(NULL)
 	, _stopped(false)
+	, _sub_filtered(false)
 	, _bd_mgr(NULL)
 	, _stub(NULL)
 	, _cfg(NULL)
@@ -171,6 +173,7 @@ bool ParserAdapter::init(const char* id, WTSVariant* cfg, IParserStub* stub, IBa
 		if (_parser_api->init(cfg))
 		{
 			ContractSet contractSet;
+			_sub_filtered = !_code_filter.empty() || !_exchg_filter.empty();
 			if (!_code_filter.empty())//优先判断合约过滤器
 			{
 				ExchgFilter::iterator it = _code_filter.begin();
@@ -193,17 +196,23 @@ bool ParserAdapter::init(const char* id, WTSVariant* cfg, IParserStub* stub, IBa
 					}
 					WTSContractInfo* contract = _bd_mgr->getContract(code.c_str(), exchg.c_str());
 					if(contract)
+					{
 						contractSet.insert(contract->getFullCode());
+						add_sub_bit(contract);
+					}
 					else
 					{
 						//如果是品种ID，则将该品种下全部合约都加到订阅列表
 						WTSCommodityInfo* commInfo = _bd_mgr->getCommodity(exchg.c_str(), code.c_str());
 						if(commInfo)
 						{
+							//品种记下来,后面才加载的合约也能按品种匹配
+							_comm_filter.insert(commInfo->getFullPid());
 							const auto& codes = commInfo->getCodes();
 							for(const auto& c : codes)
 							{
 								contractSet.insert(fmt::format("{}.{}", exchg, c.c_str()));
+								add_sub_bit(_bd_mgr->getContract(c.c_str(), exchg.c_str()));
 							}							
 						}
 					}
@@ -220,6 +229,7 @@ bool ParserAdapter::init(const char* id, WTSVariant* cfg, IParserStub* stub, IBa
 					{
 						WTSContractInfo* contract = STATIC_CONVERT(*it, WTSContractInfo*);
 						contractSet.insert(contract->getFullCode());
+						add_sub_bit(contract);
 					}
 
 					ayContract->release();
@@ -279,6 +289,34 @@ bool ParserAdapter::run()
 	return true;
 }
 
+void ParserAdapter::add_sub_bit(WTSContractInfo* cInfo)
+{
+	if (cInfo == NULL)
+		return;
+
+	if (!WtSubBitset::is_valid(cInfo->getTotalIndex()))
+		WTSLogger::log_dyn("parser", _id.c_str(), LL_WARN, "[{}] Instrument {} has no valid index, will be filtered", _id.c_str(), cInfo->getFullCode());
+	else
+		_sub_bits.set(cInfo->getTotalIndex());
+}
+
+bool ParserAdapter::is_subscribed(WTSContractInfo* cInfo) const
+{
+	if (!_sub_filtered || _sub_bits.test(cInfo->getTotalIndex()))
+		return true;
+
+	//初始化以后才加入基础数据的合约不在位图里,再按合约、品种或者交易所判断一次,符合的补到位图里
+	bool bMatch = false;
+	if (!_code_filter.empty())
+		bMatch = _comm_filter.find(cInfo->getFullPid()) != _comm_filter.end() || _code_filter.find(cInfo->getFullCode()) != _code_filter.end();
+	else
+		bMatch = _exchg_filter.find(cInfo->getExchg()) != _exchg_filter.end();
+
+	if (bMatch)
+		_sub_bits.set(cInfo->getTotalIndex());
+	return bMatch;
+}
+
 //合理毫秒数时间差
 const int RESONABLE_MILLISECS = 60 * 60 * 1000;
 void ParserAdapter::handleQuote(WTSTickData *quote, uint32_t procFlag)
@@ -286,8 +324,7 @@ void ParserAdapter::handleQuote(WTSTickData *quote, uint32_t procFlag)
 	if (quote == NULL || _stopped || quote->actiondate() == 0 || quote->tradingdate() == 0)
 		return;
 
-	if (!_exchg_filter.empty() && (_exchg_filter.find(quote->exchg()) == _exchg_filter.end()))
-		return;
+	WT_TRACE_STAMP(quote, TTS_PARSER_ADAPTER);
 
 	WTSContractInfo* cInfo = quote->getContractInfo();
 	if (cInfo == NULL)
@@ -296,7 +333,7 @@ void ParserAdapter::handleQuote(WTSTickData *quote, uint32_t procFlag)
 		quote->setContractInfo(cInfo);
 	}
 
-	if (cInfo == NULL)
+	if (cInfo == NULL || !is_subscribed(cInfo))
 		return;
 
 	WTSCommodityInfo* commInfo = cInfo->getCommInfo();
@@ -320,6 +357,15 @@ void ParserAdapter::handleQuote(WTSTickData *quote, uint32_t procFlag)
 		}
 	}
 
+	//标准代码在加载合约的时候已经算好了,直接用
+	const char* cachedCode = cInfo->getStdCode();
+	if (cachedCode[0] != '\0')
+	{
+		quote->setCode(cachedCode);
+		_stub->handle_push_quote(quote);
+		return;
+	}
+
 	std::string stdCode;
 	if (commInfo->getCategoty() == CC_FutOption || commInfo->getCategoty() == CC_SpotOption)
 	{
@@ -344,14 +390,14 @@ void ParserAdapter::handleOrderQueue(WTSOrdQueData* ordQueData)
 	if (_stopped)
 		return;
 
-	if (!_exchg_filter.empty() && (_exchg_filter.find(ordQueData->exchg()) == _exchg_filter.end()))
-		return;
-
 	if (ordQueData->actiondate() == 0 || ordQueData->tradingdate() == 0)
 		return;
 
-	WTSContractInfo* cInfo = _bd_mgr->getContract(ordQueData->code(), ordQueData->exchg());
+	//解析器已经带了合约信息的,就不用再查一次了
+	WTSContractInfo* cInfo = ordQueData->getContractInfo();
 	if (cInfo == NULL)
+		cInfo = _bd_mgr->getContract(ordQueData->code(), ordQueData->exchg());
+	if (cInfo == NULL || !is_subscribed(cInfo))
 		return;
 
 	WTSCommodityInfo* commInfo = cInfo->getCommInfo();
@@ -367,14 +413,14 @@ void ParserAdapter::handleOrderDetail(WTSOrdDtlData* ordDtlData)
 	if (_stopped)
 		return;
 
-	if (!_exchg_filter.empty() && (_exchg_filter.find(ordDtlData->exchg()) == _exchg_filter.end()))
-		return;
-
 	if (ordDtlData->actiondate() == 0 || ordDtlData->tradingdate() == 0)
 		return;
 
-	WTSContractInfo* cInfo = _bd_mgr->getContract(ordDtlData->code(), ordDtlData->exchg());
+	//解析器已经带了合约信息的,就不用再查一次了
+	WTSContractInfo* cInfo = ordDtlData->getContractInfo();
 	if (cInfo == NULL)
+		cInfo = _bd_mgr->getContract(ordDtlData->code(), ordDtlData->exchg());
+	if (cInfo == NULL || !is_subscribed(cInfo))
 		return;
 
 	WTSCommodityInfo* commInfo = cInfo->getCommInfo();
@@ -390,14 +436,14 @@ void ParserAdapter::handleTransaction(WTSTransData* transData)
 	if (_stopped)
 		return;
 
-	if (!_exchg_filter.empty() && (_exchg_filter.find(transData->exchg()) == _exchg_filter.end()))
-		return;
-
 	if (transData->actiondate() == 0 || transData->tradingdate() == 0)
 		return;
 
-	WTSContractInfo* cInfo = _bd_mgr->getContract(transData->code(), transData->exchg());
+	//解析器已经带了合约信息的,就不用再查一次了
+	WTSContractInfo* cInfo = transData->getContractInfo();
 	if (cInfo == NULL)
+		cInfo = _bd_mgr->getContract(transData->code(), transData->exchg());
+	if (cInfo == NULL || !is_subscribed(cInfo))
 		return;
 
 	WTSCommodityInfo* commInfo = cInfo->getCommInfo();
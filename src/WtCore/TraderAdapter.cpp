@@ -31,6 +31,7 @@
 #include "../Share/decimal.h"
 #include "../Share/TimeUtils.hpp"
 #include "../Share/CodeHelper.hpp"
+#include "../Share/WtTickTrace.hpp"
 
 #include <exception>
 #include <rapidjson/document.h>
@@ -83,6 +84,7 @@ TraderAdapter::TraderAdapter(EventNotifier* caster /* = NULL */)
 	, _save_data(false)
 	, _notifier(caster)
 	, _ignore_sefmatch(false)
+	, _log_level(LL_INFO)
 {
 }
 
@@ -101,6 +103,7 @@ bool TraderAdapter::init(const char* id, WTSVariant* params, IBaseDataMgr* bdMgr
 	_policy_mgr = policyMgr;
 	_bd_mgr = bdMgr;
 	_id = id;
+	_log_level = WTSLogger::get_dyn_level("trader", id);
 
 	_order_pattern = fmt::format("otp.{}", id);
 
@@ -157,6 +160,8 @@ bool TraderAdapter::init(const char* id, WTSVariant* params, IBaseDataMgr* bdMgr
 		WTSLogger::log_dyn("trader", _id.c_str(), LL_WARN, "[{}] No risk control rule setup of trading channel", _id.c_str());
 	}
 
+	initPreTrade(params->get("pretrade"));
+
 	if (params->getString("module").empty())
 		return false;
 
@@ -211,6 +216,7 @@ bool TraderAdapter::initExt(const char* id, ITraderApi* api, IBaseDataMgr* bdMgr
 	_policy_mgr = policyMgr;
 	_bd_mgr = bdMgr;
 	_id = id;
+	_log_level = WTSLogger::get_dyn_level("trader", id);
 
 	_order_pattern = fmt::format("otp.{}", id);
 
@@ -395,7 +401,134 @@ const TraderAdapter::RiskParams* TraderAdapter::getRiskParams(const char* stdCod
 		return &it->second;
 
 	it = _risk_params_map.find("default");
-	return &it->second;
+	if (it != _risk_params_map.end())
+		return &it->second;
+
+	return NULL;
+}
+
+TraderAdapter::CodeRiskSlot* TraderAdapter::getRiskSlot(const char* stdCode)
+{
+	SpinLock lock(_mtx_risk);
+	auto it = _risk_slots.find(stdCode);
+	if (it != _risk_slots.end())
+		return it->second.get();
+
+	CodeRiskSlotPtr slot(new CodeRiskSlot);
+	slot->_params = getRiskParams(stdCode);
+	if (slot->_params != NULL)
+	{
+		slot->_order_limiter.init(slot->_params->_order_times_boundary, slot->_params->_order_stat_timespan * 1000);
+		slot->_cancel_limiter.init(slot->_params->_cancel_times_boundary, slot->_params->_cancel_stat_timespan * 1000);
+	}
+	slot->_excluded = (_exclude_codes.find(stdCode) != _exclude_codes.end());
+	_risk_slots[stdCode] = slot;
+	return slot.get();
+}
+
+void TraderAdapter::initPreTrade(WTSVariant* cfg)
+{
+	if (cfg == NULL || !cfg->getBoolean("active"))
+		return;
+
+	_pretrade.set_active(true);
+	_pretrade.set_account_limits(cfg->getDouble("max_working_notional"), cfg->getUInt32("order_times_boundary"), cfg->getUInt32("order_stat_timespan") * 1000);
+
+	WTSVariant* cfgRules = cfg->get("rules");
+	if (cfgRules)
+	{
+		auto keys = cfgRules->memberNames();
+		for (const std::string& key : keys)
+		{
+			WTSVariant* cfgItem = cfgRules->get(key.c_str());
+			PreTradeLimits limits;
+			limits._max_order_qty = cfgItem->getDouble("max_order_qty");
+			limits._max_order_notional = cfgItem->getDouble("max_order_notional");
+			limits._max_net_pos = cfgItem->getDouble("max_net_pos");
+			limits._price_band = cfgItem->getDouble("price_band");
+			limits._check_selfmatch = cfgItem->getBoolean("check_selfmatch");
+			_pretrade.add_limits(key.c_str(), limits);
+		}
+	}
+
+	WTSLogger::log_dyn("trader", _id.c_str(), LL_INFO, "[{}] Pre-trade risk control of trading channel activated", _id.c_str());
+}
+
+uint32_t TraderAdapter::getPreTradeSlot(const char* stdCode, WTSContractInfo* cInfo)
+{
+	WTSCommodityInfo* commInfo = cInfo->getCommInfo();
+	return _pretrade.slot_of(stdCode, commInfo->getFullPid(), commInfo->getVolScale());
+}
+
+TraderAdapter::ContractSlot* TraderAdapter::getContractSlot(WTSContractInfo* cInfo)
+{
+	SpinLock lock(_mtx_slots);
+	auto it = _contract_slots.find(cInfo);
+	if (it != _contract_slots.end())
+		return it->second.get();
+
+	if (_stat_map == NULL)
+		_stat_map = TradeStatMap::create();
+
+	auto get_stat = [this](const std::string& stdCode) {
+		WTSTradeStateInfo* statInfo = (WTSTradeStateInfo*)_stat_map->get(stdCode);
+		if (statInfo == NULL)
+		{
+			statInfo = WTSTradeStateInfo::create(stdCode.c_str());
+			_stat_map->add(stdCode, statInfo, false);
+		}
+		return statInfo;
+	};
+
+	ContractSlotPtr slot(new ContractSlot);
+	WTSCommodityInfo* commInfo = cInfo->getCommInfo();
+
+	//订单回报的代码转换
+	if (commInfo->getCategoty() == CC_FutOption || commInfo->getCategoty() == CC_SpotOption)
+		slot->_std_code = CodeHelper::rawFutOptCodeToStdCode(cInfo->getCode(), cInfo->getExchg());
+	else if (CodeHelper::isMonthlyCode(cInfo->getCode()))//如果是分月合约
+		slot->_std_code = CodeHelper::rawMonthCodeToStdCode(cInfo->getCode(), cInfo->getExchg());
+	else
+		slot->_std_code = CodeHelper::rawFlatCodeToStdCode(cInfo->getCode(), cInfo->getExchg(), cInfo->getProduct());
+
+	//成交回报的代码转换
+	if (commInfo->getCategoty() == CC_Future)
+		slot->_trd_code = CodeHelper::rawMonthCodeToStdCode(cInfo->getCode(), cInfo->getExchg());
+	else if (commInfo->getCategoty() == CC_FutOption || commInfo->getCategoty() == CC_SpotOption)
+		slot->_trd_code = CodeHelper::rawFutOptCodeToStdCode(cInfo->getCode(), cInfo->getExchg());
+	else if (commInfo->getCategoty() == CC_Stock)
+		slot->_trd_code = CodeHelper::rawFlatCodeToStdCode(cInfo->getCode(), cInfo->getExchg(), cInfo->getProduct());
+	else
+		slot->_trd_code = CodeHelper::rawFlatCodeToStdCode(cInfo->getCode(), cInfo->getExchg(), commInfo->getProduct());
+
+	slot->_stat = get_stat(slot->_std_code);
+	slot->_trd_stat = (slot->_trd_code == slot->_std_code) ? slot->_stat : get_stat(slot->_trd_code);
+
+	if (_pretrade.is_active())
+	{
+		slot->_pt_idx = getPreTradeSlot(slot->_std_code.c_str(), cInfo);
+		slot->_trd_pt_idx = (slot->_trd_code == slot->_std_code) ? slot->_pt_idx : getPreTradeSlot(slot->_trd_code.c_str(), cInfo);
+	}
+
+	_contract_slots[cInfo] = slot;
+	return slot.get();
+}
+
+TraderAdapter::ContractSlot* TraderAdapter::getOrderSlot(uint32_t localid, WTSContractInfo* cInfo)
+{
+	if (localid != 0)
+	{
+		OrderSlot& oSlot = _order_slots[localid & (ORDER_SLOT_COUNT - 1)];
+		if (oSlot._localid.load(std::memory_order_acquire) == localid)
+		{
+			ContractSlot* slot = oSlot._code.load(std::memory_order_acquire);
+			//再检查一次,防止读的过程中被新订单覆盖
+			if (oSlot._localid.load(std::memory_order_acquire) == localid)
+				return slot;
+		}
+	}
+
+	return getContractSlot(cInfo);
 }
 
 bool TraderAdapter::run()
@@ -415,6 +548,9 @@ bool TraderAdapter::run()
 
 void TraderAdapter::release()
 {
+	if (_pretrade.is_active() && _pretrade.latency().count() > 0)
+		WTSLogger::log_dyn("trader", _id.c_str(), LL_INFO, "[{}] Latency of pre-trade risk checks(ns): {}", _id.c_str(), _pretrade.latency().summary());
+
 	if (_trader_api)
 	{
 		_trader_api->registerSpi(NULL);
@@ -488,6 +624,29 @@ uint32_t TraderAdapter::doEntrust(WTSEntrust* entrust)
 	WTSContractInfo* cInfo = entrust->getContractInfo();
 	if (cInfo == NULL) cInfo = getContract(entrust->getCode());
 
+	//流控要按标准代码记录,所以要在替换成原始代码之前先拿到风控槽位
+	CodeRiskSlot* slot = _risk_mon_enabled ? getRiskSlot(entrust->getCode()) : NULL;
+
+	//合约的回报槽位里已经缓存了事前风控的槽位,不用再按代码查找
+	ContractSlot* cSlot = getContractSlot(cInfo);
+
+	//事前风控检查,在发单之前执行
+	uint32_t ptIdx = 0;
+	bool isBuy = (entrust->getDirection() == WDT_LONG && entrust->getOffsetType() == WOT_OPEN) || (entrust->getDirection() == WDT_SHORT && entrust->getOffsetType() != WOT_OPEN);
+	WT_TRACE_STAMP_CUR(TTS_RISK_CHECK);
+	if (_pretrade.is_active())
+	{
+		int64_t now = TimeUtils::getLocalTimeNow();
+		ptIdx = cSlot->_pt_idx;
+		PreTradeResult ptRet = _pretrade.check(ptIdx, isBuy, entrust->getPrice(), entrust->getVolume(), now);
+		if (ptRet != PTR_PASS)
+		{
+			WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] Order of {} rejected by pre-trade risk control: {}", 
+				_id.c_str(), entrust->getCode(), WtPreTradeRisk::result_name(ptRet));
+			return UINT_MAX;
+		}
+	}
+
 	entrust->setCode(cInfo->getCode());
 	entrust->setExchange(cInfo->getExchg());
 
@@ -496,8 +655,18 @@ uint32_t TraderAdapter::doEntrust(WTSEntrust* entrust)
 	wt_strcpy(usertag, _order_pattern.c_str(), _order_pattern.size());
 	usertag[_order_pattern.size()] =  '.';
 	fmtutil::format_to(usertag + _order_pattern.size() + 1, "{}", localid);
+
+	//先登记订单槽位,回报可能在orderInsert返回之前就到了
+	{
+		OrderSlot& oSlot = _order_slots[localid & (ORDER_SLOT_COUNT - 1)];
+		oSlot._localid.store(0, std::memory_order_release);
+		oSlot._code.store(cSlot, std::memory_order_release);
+		oSlot._localid.store(localid, std::memory_order_release);
+	}
 	
+	WT_TRACE_STAMP_CUR(TTS_API_SEND);
 	int32_t ret = _trader_api->orderInsert(entrust);
+	WT_TRACE_STAMP_CUR(TTS_API_RETURN);
 	if(ret < 0)
 	{
 		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] Order placing failed: {}", _id.c_str(), ret);
@@ -506,12 +675,15 @@ uint32_t TraderAdapter::doEntrust(WTSEntrust* entrust)
 	else
 	{
 		int64_t now = TimeUtils::getLocalTimeNow();
-		_order_time_cache[entrust->getCode()].emplace_back(now);
+		if (slot != NULL)
+			slot->_order_limiter.record(now);
+
+		_pretrade.on_entrust(ptIdx, localid, isBuy, entrust->getPrice(), entrust->getVolume(), now);
 	}
 	return localid;
 }
 
-void TraderAdapter::updateUndone(const char* stdCode, double qty, bool bOuput /* = false */)
+void TraderAdapter::updateUndone(const std::string& stdCode, double qty, bool bOuput /* = false */)
 {
 	double& undone = _undone_qty[stdCode];
 	double oldQty = undone;
@@ -538,50 +710,36 @@ bool TraderAdapter::checkCancelLimits(const char* stdCode)
 	if (!_risk_mon_enabled)
 		return true;
 
-	if (_exclude_codes.find(stdCode) != _exclude_codes.end())
+	CodeRiskSlot* slot = getRiskSlot(stdCode);
+	if (slot->_excluded)
 		return false;
 
-	const RiskParams* riskPara = getRiskParams(stdCode);
+	const RiskParams* riskPara = slot->_params;
 	if (riskPara == NULL)
 		return true;
 
-	WTSTradeStateInfo* statInfo = (WTSTradeStateInfo*)_stat_map->get(stdCode);
-	if (statInfo && riskPara->_cancel_total_limits != 0 && statInfo->total_cancels() >= riskPara->_cancel_total_limits )
+	if (slot->_stat == NULL)
+		slot->_stat = (WTSTradeStateInfo*)_stat_map->get(stdCode);
+
+	WTSTradeStateInfo* statInfo = slot->_stat;
+	if (statInfo && riskPara->_cancel_total_limits != 0 && statInfo->total_cancels() >= riskPara->_cancel_total_limits)
 	{
-		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} cancel {} times totaly, beyond boundary {} times, adding to excluding list",
+		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} cancel {} times totally, beyond boundary {} times, adding to excluding list",
 			_id.c_str(), stdCode, statInfo->total_cancels(), riskPara->_cancel_total_limits);
 		_exclude_codes.insert(stdCode);
+		slot->_excluded = true;
 		return false;
 	}
 
-	//撤单频率检查
-	auto it = _cancel_time_cache.find(stdCode);
-	if (it != _cancel_time_cache.end())
+	//撤单频率检查,环形缓冲区里最早的一笔还在时间窗口内,就说明超限了
+	const WtRateLimiter& limiter = slot->_cancel_limiter;
+	if (limiter.exceeded())
 	{
-		TimeCacheList& cache = (TimeCacheList&)it->second;
-		uint32_t cnt = cache.size();
-		if (cnt >= riskPara->_cancel_times_boundary)
-		{
-			uint64_t eTime = cache[cnt - 1];
-			uint64_t sTime = eTime - riskPara->_cancel_stat_timespan * 1000;
-			auto tit = std::lower_bound(cache.begin(), cache.end(), sTime);
-			auto sIdx = tit - cache.begin();
-			auto times = cnt - sIdx - 1;
-			if (times > riskPara->_cancel_times_boundary)
-			{
-				WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} cancel {} times within {} seconds, beyond boundary {} times, adding to excluding list",
-					_id.c_str(), stdCode, times, riskPara->_cancel_stat_timespan, riskPara->_cancel_times_boundary);
-				_exclude_codes.insert(stdCode);
-				return false;
-			}
-
-			//这里必须要清理一下, 没有特别好的办法
-			//不然随着时间推移, vector长度会越来越长
-			if(tit != cache.begin())
-			{
-				cache.erase(cache.begin(), tit);
-			}
-		}
+		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} cancel {} times within {} seconds, beyond boundary {} times, adding to excluding list",
+			_id.c_str(), stdCode, limiter.times(), riskPara->_cancel_stat_timespan, riskPara->_cancel_times_boundary);
+		_exclude_codes.insert(stdCode);
+		slot->_excluded = true;
+		return false;
 	}
 
 	return true;
@@ -603,50 +761,36 @@ bool TraderAdapter::checkOrderLimits(const char* stdCode)
 	if (!_risk_mon_enabled)
 		return true;
 
-	if (_exclude_codes.find(stdCode) != _exclude_codes.end())
+	CodeRiskSlot* slot = getRiskSlot(stdCode);
+	if (slot->_excluded)
 		return false;
 
-	const RiskParams* riskPara = getRiskParams(stdCode);
+	const RiskParams* riskPara = slot->_params;
 	if (riskPara == NULL)
 		return true;
 
-	WTSTradeStateInfo* statInfo = (WTSTradeStateInfo*)_stat_map->get(stdCode);
+	if (slot->_stat == NULL)
+		slot->_stat = (WTSTradeStateInfo*)_stat_map->get(stdCode);
+
+	WTSTradeStateInfo* statInfo = slot->_stat;
 	if (statInfo && riskPara->_order_total_limits != 0 && statInfo->total_orders() >= riskPara->_order_total_limits)
 	{
 		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} entrust {} times totally, beyond boundary {} times, adding to excluding list",
 			_id.c_str(), stdCode, statInfo->total_orders(), riskPara->_order_total_limits);
 		_exclude_codes.insert(stdCode);
+		slot->_excluded = true;
 		return false;
 	}
 
-	//撤单频率检查
-	auto it = _order_time_cache.find(stdCode);
-	if (it != _order_time_cache.end())
+	//下单频率检查,环形缓冲区里最早的一笔还在时间窗口内,就说明超限了
+	const WtRateLimiter& limiter = slot->_order_limiter;
+	if (limiter.exceeded())
 	{
-		TimeCacheList& cache = (TimeCacheList&)it->second;
-		uint32_t cnt = cache.size();
-		if (cnt >= riskPara->_order_times_boundary)
-		{
-			uint64_t eTime = cache[cnt - 1];
-			uint64_t sTime = eTime - riskPara->_order_stat_timespan * 1000;
-			auto tit = std::lower_bound(cache.begin(), cache.end(), sTime);
-			auto sIdx = tit - cache.begin();
-			auto times = cnt - sIdx - 1;
-			if (times > riskPara->_order_times_boundary)
-			{
-				WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} entrust {} times within {} seconds, beyond boundary {} times, adding to excluding list",
-					_id.c_str(), stdCode, times, riskPara->_order_stat_timespan, riskPara->_order_times_boundary);
-				_exclude_codes.insert(stdCode);
-				return false;
-			}
-
-			//这里必须要清理一下, 没有特别好的办法
-			//不然随着时间推移, vector长度会越来越长
-			if (tit != cache.begin())
-			{
-				cache.erase(cache.begin(), tit);
-			}
-		}
+		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} entrust {} times within {} seconds, beyond boundary {} times, adding to excluding list",
+			_id.c_str(), stdCode, limiter.times(), riskPara->_order_stat_timespan, riskPara->_order_times_boundary);
+		_exclude_codes.insert(stdCode);
+		slot->_excluded = true;
+		return false;
 	}
 
 	return true;
@@ -1257,6 +1401,10 @@ bool TraderAdapter::doCancel(WTSOrderInfo* ordInfo)
 	int ret = _trader_api->orderAction(action);
 	bool isSent = (ret >= 0);
 	action->release();
+
+	if (_risk_mon_enabled)
+		getRiskSlot(stdCode.c_str())->_cancel_limiter.record(TimeUtils::getLocalTimeNow());
+
 	return isSent;
 }
 
@@ -1275,8 +1423,6 @@ bool TraderAdapter::cancel(uint32_t localid)
 	
 	bool bRet = doCancel(ordInfo);
 
-	_cancel_time_cache[ordInfo->getCode()].emplace_back(TimeUtils::getLocalTimeNow());
-
 	ordInfo->release();
 
 	return bRet;
@@ -1308,7 +1454,6 @@ OrderIDs TraderAdapter::cancel(const char* stdCode, bool isBuy, double qty /* =
 				{
 					actQty += orderInfo->getVolLeft();
 					ret.emplace_back(it->first);
-					//_cancel_time_cache[orderInfo->getCode()].emplace_back(TimeUtils::getLocalTimeNow());
 				}
 			}
 
@@ -1471,6 +1616,14 @@ void TraderAdapter::onRspEntrust(WTSEntrust* entrust, WTSError *err)
 		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, 
 			"[{}] Order placing failed: {}, instrument: {}, action: {}, qty: {}", _id.c_str(), err->getMessage(), entrust->getCode(), action.c_str(), qty);
 
+		//下单失败的订单要从事前风控的挂单里释放,重复通知的时候已经找不到这笔订单,不会重复扣减
+		//不是本通道发出的订单,本地订单号对不上,不能处理
+		if (_pretrade.is_active() && StrUtil::startsWith(entrust->getUserTag(), _order_pattern.c_str(), true))
+		{
+			uint32_t localid = strtoul(entrust->getUserTag() + _order_pattern.size() + 1, NULL, 10);
+			_pretrade.on_order(getOrderSlot(localid, cInfo)->_pt_idx, localid, 0);
+		}
+
 		//如果下单失败, 要更新未完成数量
 		//实盘中发现错误单有时候会推送两次
 		//所以这里加一个检查未完成单的逻辑
@@ -1575,6 +1728,14 @@ void TraderAdapter::onRspPosition(const WTSArray* ayPositions)
 			const char* stdCode = it->first.c_str();
 			const PosItem& pItem = it->second;
 			printPosition(stdCode, pItem);
+
+			if (_pretrade.is_active())
+			{
+				WTSContractInfo* cInfo = getContract(stdCode);
+				if (cInfo != NULL)
+					_pretrade.on_position(getPreTradeSlot(stdCode, cInfo), pItem.total_pos(true) - pItem.total_pos(false));
+			}
+
 			for (auto sink : _sinks)
 			{
 				sink->on_position(stdCode, true, pItem.l_prevol, pItem.l_preavail, pItem.l_newvol, pItem.l_newavail, _trading_day);
@@ -1721,6 +1882,9 @@ void TraderAdapter::onRspOrders(const WTSArray* ayOrders)
 
 void TraderAdapter::printPosition(const char* code, const PosItem& pItem)
 {
+	if (_log_level > LL_INFO)
+		return;
+
 	WTSLogger::log_dyn("trader", _id.c_str(), LL_INFO, "[{}] {} position updated, long:{}[{}]|{}[{}], short:{}[{}]|{}[{}]",
 		_id.c_str(), code, pItem.l_prevol, pItem.l_preavail, pItem.l_newvol, pItem.l_newavail, 
 		pItem.s_prevol, pItem.s_preavail, pItem.s_newvol, pItem.s_newavail);
@@ -1868,27 +2032,25 @@ void TraderAdapter::onPushOrder(WTSOrderInfo* orderInfo)
 	if (cInfo == NULL)
 		return;
 
-	WTSCommodityInfo* commInfo = cInfo->getCommInfo();
-	std::string stdCode;
-	if (commInfo->getCategoty() == CC_FutOption || commInfo->getCategoty() == CC_SpotOption)
-		stdCode = CodeHelper::rawFutOptCodeToStdCode(cInfo->getCode(), cInfo->getExchg());
-	else if (CodeHelper::isMonthlyCode(cInfo->getCode()))//如果是分月合约
-		stdCode = CodeHelper::rawMonthCodeToStdCode(cInfo->getCode(), cInfo->getExchg());
-	else
-		stdCode = CodeHelper::rawFlatCodeToStdCode(cInfo->getCode(), cInfo->getExchg(), cInfo->getProduct());
+	uint32_t localid = 0;
+
+	//先看看是不是wt发出去的单子
+	if (StrUtil::startsWith(orderInfo->getUserTag(), _order_pattern.c_str(), true))
+	{
+		const char* userTag = orderInfo->getUserTag() + _order_pattern.size() + 1;
+		localid = strtoul(userTag, NULL, 10);
+	}
+
+	//wt发出去的单子直接从订单槽位拿到合约的回报槽位,不用每次都转换标准代码
+	ContractSlot* cSlot = getOrderSlot(localid, cInfo);
+	const std::string& stdCode = cSlot->_std_code;
 
 	bool isBuy = (orderInfo->getDirection() == WDT_LONG && orderInfo->getOffsetType() == WOT_OPEN) || (orderInfo->getDirection() == WDT_SHORT && orderInfo->getOffsetType() != WOT_OPEN);
 	
 	//撤销的话, 要更新统计数据
 	if (orderInfo->getOrderState() == WOS_Canceled)
 	{
-		WTSTradeStateInfo* statInfo = (WTSTradeStateInfo*)_stat_map->get(stdCode.c_str());
-		if (statInfo == NULL)
-		{
-			statInfo = WTSTradeStateInfo::create(stdCode.c_str());
-			_stat_map->add(stdCode, statInfo, false);
-		}
-		TradeStatInfo& statItem = statInfo->statInfo();
+		TradeStatInfo& statItem = cSlot->_stat->statInfo();
 		if(isBuy)
 		{
 			if (orderInfo->isError())//错单要和撤单区分开
@@ -1935,7 +2097,8 @@ void TraderAdapter::onPushOrder(WTSOrderInfo* orderInfo)
 		}
 	}
 
-	WTSLogger::log_dyn("trader", _id.c_str(), LL_DEBUG, "[{}] Order notified, instrument: {}, usertag: {}, state: {}", _id.c_str(), stdCode.c_str(), orderInfo->getUserTag(), stateToName(orderInfo->getOrderState()));
+	if (_log_level <= LL_DEBUG)
+		WTSLogger::log_dyn("trader", _id.c_str(), LL_DEBUG, "[{}] Order notified, instrument: {}, usertag: {}, state: {}", _id.c_str(), stdCode.c_str(), orderInfo->getUserTag(), stateToName(orderInfo->getOrderState()));
 
 	//先检查该订单是不是第一次推送过来
 	//如果是第一次推送过来, 则要根据开平更新可平
@@ -1947,13 +2110,7 @@ void TraderAdapter::onPushOrder(WTSOrderInfo* orderInfo)
 			//先把订单号缓存起来, 防止重复处理
 			_orderids.insert(orderInfo->getOrderID());
 
-			WTSTradeStateInfo* statInfo = (WTSTradeStateInfo*)_stat_map->get(stdCode.c_str());
-			if (statInfo == NULL)
-			{
-				statInfo = WTSTradeStateInfo::create(stdCode.c_str());
-				_stat_map->add(stdCode, statInfo, false);
-			}
-			TradeStatInfo& statItem = statInfo->statInfo();
+			TradeStatInfo& statItem = cSlot->_stat->statInfo();
 			if (isBuy)
 			{
 				statItem.b_orders++;
@@ -2068,18 +2225,9 @@ void TraderAdapter::onPushOrder(WTSOrderInfo* orderInfo)
 		}
 	}
 
-	
-
-	uint32_t localid = 0;
-
-	//先看看是不是wt发出去的单子
-	if (StrUtil::startsWith(orderInfo->getUserTag(), _order_pattern.c_str(), true))
+	//如果订单撤销, 并且是wt的订单, 则要先更新未完成数量
+	if (localid != 0)
 	{
-		char* userTag = (char*)orderInfo->getUserTag();
-		userTag += _order_pattern.size() + 1;
-		localid = strtoul(userTag, NULL, 10);
-
-		//如果订单撤销, 并且是wt的订单, 则要先更新未完成数量
 		if (orderInfo->getOrderState() == WOS_Canceled )
 		{
 			//撤单的时候, 要更新未完成
@@ -2090,7 +2238,7 @@ void TraderAdapter::onPushOrder(WTSOrderInfo* orderInfo)
 
 			bool isBuy = (isLong&&isOpen) || (!isLong && !isOpen);
 
-			updateUndone(stdCode.c_str(), qty*(isBuy ? -1 : 1), true);
+			updateUndone(stdCode, qty*(isBuy ? -1 : 1), true);
 
 			WTSLogger::log_dyn("trader", _id.c_str(), LL_INFO, "[{}] Order {} of {} canceled:{}, action: {}, leftqty: {}",
 				_id.c_str(), orderInfo->getUserTag(), stdCode.c_str(), orderInfo->getStateMsg(),
@@ -2116,6 +2264,9 @@ void TraderAdapter::onPushOrder(WTSOrderInfo* orderInfo)
 			}
 		}
 
+		if (_pretrade.is_active())
+			_pretrade.on_order(cSlot->_pt_idx, localid, orderInfo->isAlive() ? orderInfo->getVolLeft() : 0);
+
 		//通知所有监听接口
 		for (auto sink : _sinks)
 			sink->on_order(localid, stdCode.c_str(), isBuy, orderInfo->getVolume(), orderInfo->getVolLeft(), orderInfo->getPrice(), orderInfo->getOrderState() == WOS_Canceled);
@@ -2142,29 +2293,24 @@ void TraderAdapter::onPushTrade(WTSTradeInfo* tradeRecord)
 	bool isBuy = (tradeRecord->getDirection() == WDT_LONG && tradeRecord->getOffsetType() == WOT_OPEN) || (tradeRecord->getDirection() == WDT_SHORT && tradeRecord->getOffsetType() != WOT_OPEN);
 
 	WTSCommodityInfo* commInfo = cInfo->getCommInfo();
-	std::string stdCode;
-	if (commInfo->getCategoty() == CC_Future)
-		stdCode = CodeHelper::rawMonthCodeToStdCode(cInfo->getCode(), cInfo->getExchg());
-	else if (commInfo->getCategoty() == CC_FutOption || commInfo->getCategoty() == CC_SpotOption)
-		stdCode = CodeHelper::rawFutOptCodeToStdCode(cInfo->getCode(), cInfo->getExchg());
-	else if (commInfo->getCategoty() == CC_Stock)
-		stdCode = CodeHelper::rawFlatCodeToStdCode(cInfo->getCode(), cInfo->getExchg(), cInfo->getProduct());
-	else
-		stdCode = CodeHelper::rawFlatCodeToStdCode(cInfo->getCode(), cInfo->getExchg(), commInfo->getProduct());
+
+	//如果是自己的订单，先解析出本地订单号，再从订单槽位拿合约的回报槽位
+	uint32_t localid = 0;
+	if (StrUtil::startsWith(tradeRecord->getUserTag(), _order_pattern.c_str(), true))
+	{
+		const char* userTag = tradeRecord->getUserTag() + _order_pattern.size() + 1;
+		localid = strtoul(userTag, NULL, 10);
+	}
+
+	ContractSlot* cSlot = getOrderSlot(localid, cInfo);
+	const std::string& stdCode = cSlot->_trd_code;
 
 	WTSLogger::log_dyn("trader", _id.c_str(), LL_INFO, 
 		"[{}] Trade notified, instrument: {}, usertag: {}, trdqty: {}, trdprice: {}", 
 			_id.c_str(), stdCode.c_str(), tradeRecord->getUserTag(), tradeRecord->getVolume(), tradeRecord->getPrice());
 
 	PosItem& pItem = _positions[stdCode];
-	WTSTradeStateInfo* statInfo = (WTSTradeStateInfo*)_stat_map->get(stdCode.c_str());
-	if (statInfo == NULL)
-	{
-		statInfo = WTSTradeStateInfo::create(stdCode.c_str());
-		_stat_map->add(stdCode, statInfo, false);
-	}
-
-	TradeStatInfo& statItem = statInfo->statInfo();
+	TradeStatInfo& statItem = cSlot->_trd_stat->statInfo();
 	double vol = tradeRecord->getVolume();
 	if(isLong)
 	{
@@ -2224,16 +2370,12 @@ void TraderAdapter::onPushTrade(WTSTradeInfo* tradeRecord)
 
 	printPosition(stdCode.c_str(), pItem);
 
-	//如果是自己的订单，则更新未完成单
-	uint32_t localid = 0;
-	if (StrUtil::startsWith(tradeRecord->getUserTag(), _order_pattern.c_str(), true))
-	{
-		char* userTag = (char*)tradeRecord->getUserTag();
-		userTag += _order_pattern.size() + 1;
-		localid = strtoul(userTag, NULL, 10);
+	if (_pretrade.is_active())
+		_pretrade.on_trade(cSlot->_trd_pt_idx, isBuy, vol, tradeRecord->getPrice());
 
-		updateUndone(stdCode.c_str(), vol*(isBuy ? -1 : 1), true);
-	}
+	//如果是自己的订单，则更新未完成单
+	if (localid != 0)
+		updateUndone(stdCode, vol*(isBuy ? -1 : 1), true);
 
 	for (auto sink : _sinks)
 		sink->on_trade(localid, stdCode.c_str(), isBuy, vol, tradeRecord->getPrice());
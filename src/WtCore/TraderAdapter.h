@@ -15,12 +15,21 @@
 #include "../Share/BoostFile.hpp"
 #include "../Share/StdUtils.hpp"
 #include "../Share/SpinMutex.hpp"
+#include "../Share/WtRateLimiter.hpp"
+#include "../Share/WtPreTradeRisk.hpp"
+
+#include <atomic>
+#include <boost/core/noncopyable.hpp>
+
+//本地订单槽位的数量,必须是2的幂
+#define ORDER_SLOT_COUNT	4096
 
 NS_WTP_BEGIN
 class WTSVariant;
 class ActionPolicyMgr;
 class WTSContractInfo;
 class WTSCommodityInfo;
+class WTSTradeStateInfo;
 class WtLocalExecuter;
 class EventNotifier;
 
@@ -131,6 +140,64 @@ private:
 
 	const RiskParams* getRiskParams(const char* stdCode);
 
+	typedef struct _CodeRiskSlot
+	{
+		const RiskParams*	_params;		//风控参数,第一次访问时确定,后面不再查找
+		WTSTradeStateInfo*	_stat;			//交易统计,由_stat_map持有
+		WtRateLimiter		_order_limiter;	//下单流控
+		WtRateLimiter		_cancel_limiter;//撤单流控
+		bool				_excluded;		//是否已被风控排除
+
+		_CodeRiskSlot() :_params(NULL), _stat(NULL), _excluded(false) {}
+	} CodeRiskSlot;
+	typedef std::shared_ptr<CodeRiskSlot> CodeRiskSlotPtr;
+
+	/*
+	 *	获取代码对应的风控槽位
+	 *	一次hash查找拿到风控参数、统计数据和流控器
+	 *	槽位单独分配,返回的指针不会因为后面插入新代码而失效,下单的时候可以跨orderInsert持有
+	 */
+	CodeRiskSlot* getRiskSlot(const char* stdCode);
+
+	/*
+	 *	合约的回报槽位,第一次用到的时候生成
+	 *	标准代码、统计数据和事前风控的槽位只算一次,订单和成交回报直接取用
+	 */
+	typedef struct _ContractSlot
+	{
+		std::string			_std_code;
+		WTSTradeStateInfo*	_stat;		//交易统计,由_stat_map持有
+		uint32_t			_pt_idx;	//事前风控的槽位
+
+		//成交回报的标准代码转换规则和订单回报不完全一样,单独缓存一份
+		std::string			_trd_code;
+		WTSTradeStateInfo*	_trd_stat;
+		uint32_t			_trd_pt_idx;
+
+		_ContractSlot() :_stat(NULL), _pt_idx(0), _trd_stat(NULL), _trd_pt_idx(0) {}
+	} ContractSlot;
+	typedef std::shared_ptr<ContractSlot> ContractSlotPtr;
+
+	/*
+	 *	本地订单的槽位,按本地订单号取模直接定位,下单的时候填好
+	 *	槽位被后面的订单覆盖了,就退回到按合约查找
+	 */
+	typedef struct _OrderSlot
+	{
+		std::atomic<uint32_t>		_localid;
+		std::atomic<ContractSlot*>	_code;
+
+		_OrderSlot() :_localid(0), _code(NULL) {}
+	} OrderSlot;
+
+	ContractSlot*	getContractSlot(WTSContractInfo* cInfo);
+
+	ContractSlot*	getOrderSlot(uint32_t localid, WTSContractInfo* cInfo);
+
+	void	initPreTrade(WTSVariant* cfg);
+
+	inline uint32_t	getPreTradeSlot(const char* stdCode, WTSContractInfo* cInfo);
+
 	void initSaveData();
 
 	inline void	logTrade(uint32_t localid, const char* stdCode, WTSTradeInfo* trdInfo);
@@ -138,7 +205,7 @@ private:
 
 	void	saveData(WTSArray* ayFunds = NULL);
 
-	inline void updateUndone(const char* stdCode, double qty, bool bOuput = true);
+	inline void updateUndone(const std::string& stdCode, double qty, bool bOuput = true);
 
 public:
 	double getPosition(const char* stdCode, bool bValidOnly, int32_t flag = 3);
@@ -171,6 +238,11 @@ public:
 
 	bool	checkSelfMatch(const char* stdCode, WTSTradeInfo* tInfo);
 
+	/*
+	 *	事前风控检查耗时的统计
+	 */
+	inline const WtLatencyHistogram& getPreTradeLatency() const { return _pretrade.latency(); }
+
 	inline	bool isSelfMatched(const char* stdCode)
 	{
 		//如果忽略自成交，则直接返回false
@@ -248,11 +320,16 @@ private:
 	typedef WTSHashMap<std::string>	TradeStatMap;
 	TradeStatMap*	_stat_map;	//统计数据
 
-	//这两个缓存时间内的容器,主要是为了控制瞬间流量而设置的
-	typedef std::vector<uint64_t> TimeCacheList;
-	typedef wt_hashmap<std::string, TimeCacheList> CodeTimeCacheMap;
-	CodeTimeCacheMap	_order_time_cache;	//下单时间缓存
-	CodeTimeCacheMap	_cancel_time_cache;	//撤单时间缓存
+	SpinMutex		_mtx_slots;
+	wt_hashmap<WTSContractInfo*, ContractSlotPtr>	_contract_slots;
+	OrderSlot		_order_slots[ORDER_SLOT_COUNT];
+
+	WTSLogLevel		_log_level;	//trader日志实际生效的级别,回报里的调试日志先判断再格式化
+
+	//每个代码的风控槽位,主要是为了控制瞬间流量而设置的
+	typedef wt_hashmap<std::string, CodeRiskSlotPtr> CodeRiskSlotMap;
+	CodeRiskSlotMap		_risk_slots;
+	SpinMutex			_mtx_risk;
 
 	//如果被风控了,就会进入到排除队列
 	wt_hashset<std::string>	_exclude_codes;
@@ -261,6 +338,8 @@ private:
 	RiskParamsMap	_risk_params_map;
 	bool			_risk_mon_enabled;
 
+	WtPreTradeRisk	_pretrade;		//事前风控
+
 	bool			_save_data;	//是否保存交易日志
 	BoostFilePtr	_trades_log;		//交易数据日志
 	BoostFilePtr	_orders_log;		//订单数据日志
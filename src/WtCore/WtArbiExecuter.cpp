@@ -31,6 +31,7 @@ WtArbiExecuter::WtArbiExecuter(WtExecuterFactory* factory, const char* name, IDa
 	, _auto_clear(true)
 	, _trader(NULL)
 {
+	_code_indexed = true;
 }
 
 
@@ -158,6 +159,7 @@ ExecuteUnitPtr WtArbiExecuter::getUnit(const char* stdCode, bool bAutoCreate /*
 		{
 			_unit_map[stdCode] = unit;
 			unit->self()->init(this, stdCode, cfg);
+			indexCode(stdCode);
 
 			//如果通道已经就绪，则直接通知执行单元
 			if (_channel_ready)
@@ -37,6 +37,7 @@ WtDiffExecuter::WtDiffExecuter(WtExecuterFactory* factory, const char* name, IDa
 	, _trader(NULL)
 	, _bd_mgr(bdMgr)
 {
+	_code_indexed = true;
 }
 
 
@@ -220,6 +221,7 @@ ExecuteUnitPtr WtDiffExecuter::getUnit(const char* stdCode, bool bAutoCreate /*
 		{
 			_unit_map[stdCode] = unit;
 			unit->self()->init(this, stdCode, cfg);
+			indexCode(stdCode);
 
 			//如果通道已经就绪，则直接通知执行单元
 			if (_channel_ready)
@@ -31,6 +31,8 @@ WtDtMgr::WtDtMgr()
 	, _ticks_adjusted(NULL)
 	, _rt_tick_map(NULL)
 	, _force_cache(false)
+	, _defer_notify(false)
+	, _data_guarded(false)
 {
 }
 
@@ -101,9 +103,34 @@ bool WtDtMgr::init(WTSVariant* cfg, WtEngine* engine, bool bForceCache /* = fals
 	return initStore(cfg->get("store"));
 }
 
+void WtDtMgr::on_minute_end(uint32_t uDate, uint32_t uTime, uint32_t endTDate /* = 0 */)
+{
+	if (_reader == NULL)
+		return;
+
+	std::vector<NotifyItem> notifies;
+	{
+		DataLock lock = lock_data();
+		_defer_notify = true;
+		_reader->onMinuteEnd(uDate, uTime, endTDate);
+		_defer_notify = false;
+		notifies.swap(_bar_notifies);
+	}
+
+	if (notifies.empty())
+		return;
+
+	WTSLogger::debug("All bars updated, on_bar will be triggered");
+
+	for (const NotifyItem& item : notifies)
+	{
+		_engine->on_bar(item._code, item._period, item._times, item._newBar);
+	}
+}
+
 void WtDtMgr::on_all_bar_updated(uint32_t updateTime)
 {
-	if (_bar_notifies.empty())
+	if (_defer_notify || _bar_notifies.empty())
 		return;
 
 	WTSLogger::debug("All bars updated, on_bar will be triggered");
@@ -148,6 +175,7 @@ void WtDtMgr::reader_log(WTSLogLevel ll, const char* message)
 
 void WtDtMgr::on_bar(const char* code, WTSKlinePeriod period, WTSBarStruct* newBar)
 {
+	DataLock lock = lock_data();
 	std::string key_pattern = fmt::format("{}-{}", code, period);
 
 	char speriod;
@@ -216,6 +244,7 @@ void WtDtMgr::handle_push_quote(const char* stdCode, WTSTickData* newTick)
 	if (newTick == NULL)
 		return;
 
+	DataLock lock = lock_data();
 	if (_rt_tick_map == NULL)
 		_rt_tick_map = DataCacheMap::create();
 
@@ -236,6 +265,7 @@ void WtDtMgr::handle_push_quote(const char* stdCode, WTSTickData* newTick)
 
 WTSTickData* WtDtMgr::grab_last_tick(const char* code)
 {
+	DataLock lock = lock_data();
 	if (_rt_tick_map == NULL)
 		return NULL;
 
@@ -250,7 +280,10 @@ WTSTickData* WtDtMgr::grab_last_tick(const char* code)
 double WtDtMgr::get_adjusting_factor(const char* stdCode, uint32_t uDate)
 {
 	if (_reader)
+	{
+		DataLock lock = lock_data();
 		return _reader->getAdjFactorByDate(stdCode, uDate);
+	}
 
 	return 1.0;
 }
@@ -274,6 +307,8 @@ WTSTickSlice* WtDtMgr::get_tick_slice(const char* stdCode, uint32_t count, uint6
 	if (_reader == NULL)
 		return NULL;
 
+	DataLock lock = lock_data();
+
 	/*
 	 *	By Wesley @ 2022.02.11
 	 *	这里要重新处理一下
@@ -375,6 +410,7 @@ WTSOrdQueSlice* WtDtMgr::get_order_queue_slice(const char* stdCode, uint32_t cou
 	if (_reader == NULL)
 		return NULL;
 
+	DataLock lock = lock_data();
 	return _reader->readOrdQueSlice(stdCode, count, etime);
 }
 
@@ -383,6 +419,7 @@ WTSOrdDtlSlice* WtDtMgr::get_order_detail_slice(const char* stdCode, uint32_t co
 	if (_reader == NULL)
 		return NULL;
 
+	DataLock lock = lock_data();
 	return _reader->readOrdDtlSlice(stdCode, count, etime);
 }
 
@@ -391,6 +428,7 @@ WTSTransSlice* WtDtMgr::get_transaction_slice(const char* stdCode, uint32_t coun
 	if (_reader == NULL)
 		return NULL;
 
+	DataLock lock = lock_data();
 	return _reader->readTransSlice(stdCode, count, etime);
 }
 
@@ -399,6 +437,7 @@ WTSKlineSlice* WtDtMgr::get_kline_slice(const char* stdCode, WTSKlinePeriod peri
 	if (_reader == NULL)
 		return NULL;
 
+	DataLock lock = lock_data();
 	thread_local static char key[64] = { 0 };
 	fmtutil::format_to(key, "{}-{}", stdCode, (uint32_t)period);
 
@@ -14,6 +14,7 @@
 
 #include "../Includes/FasterDefs.h"
 #include "../Includes/WTSCollection.hpp"
+#include "../Share/StdUtils.hpp"
 
 NS_WTP_BEGIN
 class WTSVariant;
@@ -40,6 +41,21 @@ public:
 
 	void	handle_push_quote(const char* stdCode, WTSTickData* newTick);
 
+	/*
+	 *	分钟结束,驱动底层读取模块更新K线
+	 *	K线更新完以后再在锁外通知交易引擎,引擎向策略工作线程投递的时候不会和等锁的工作线程互相等待
+	 */
+	void	on_minute_end(uint32_t uDate, uint32_t uTime, uint32_t endTDate = 0);
+
+	typedef std::unique_lock<StdRecurMutex> DataLock;
+
+	/*
+	 *	数据锁,HFT策略有独立工作线程的时候才打开
+	 *	没打开的时候所有的读写都在行情和定时线程里,和原来一样不加锁
+	 */
+	inline void		set_data_guarded(bool bGuarded) { _data_guarded = bGuarded; }
+	inline DataLock	lock_data() { return _data_guarded ? DataLock(_mtx_data) : DataLock(_mtx_data, std::defer_lock); }
+
 	//////////////////////////////////////////////////////////////////////////
 	//IDataManager 接口
 	virtual WTSTickSlice* get_tick_slice(const char* stdCode, uint32_t count, uint64_t etime = 0) override;
@@ -101,6 +117,10 @@ private:
 	} NotifyItem;
 
 	std::vector<NotifyItem> _bar_notifies;
+	bool			_defer_notify;	//on_minute_end里K线的通知推迟到锁外
+
+	StdRecurMutex	_mtx_data;
+	bool			_data_guarded;
 };
 
 NS_WTP_END
\ No newline at end of file
@@ -6,10 +6,73 @@
 
 #include "../WTSTools/WTSLogger.h"
 
+#include <algorithm>
+#include <cfloat>
+
 USING_NS_WTP;
 
 //////////////////////////////////////////////////////////////////////////
 #pragma region "WtExecuterMgr"
+void WtExecuterMgr::add_executer(ExecCmdPtr executer)
+{
+	_executers[executer->name()] = executer;
+
+	if (executer->isCodeIndexed())
+		executer->setCodeIndex(this);
+	else
+		_broadcast.emplace_back(executer.get());
+}
+
+void WtExecuterMgr::on_code_added(IExecCommand* executer, const char* stdCode)
+{
+	SpinLock lock(_mtx_index);
+	ExecList& execs = _code_index[stdCode];
+	if (std::find(execs.begin(), execs.end(), executer) == execs.end())
+		execs.emplace_back(executer);
+}
+
+void WtExecuterMgr::push_targets(ExecCmdPtr& executer, const TargetsMap& targets)
+{
+	if (_full_executers.find(executer->name()) != _full_executers.end())
+	{
+		executer->set_position(targets);
+		return;
+	}
+
+	//和上次推送的目标比较,移出目标的合约目标仓位为0
+	TargetsMap& lastTargets = _last_targets[executer->name()];
+	TargetsMap changes;
+	for (auto& v : targets)
+	{
+		auto it = lastTargets.find(v.first);
+		if (it == lastTargets.end() || !decimal::eq(it->second, v.second))
+			changes[v.first] = v.second;
+	}
+
+	for (auto& v : lastTargets)
+	{
+		if (!decimal::eq(v.second, 0) && targets.find(v.first) == targets.end())
+			changes[v.first] = 0;
+	}
+
+	if (!executer->set_position_diff(changes))
+	{
+		_full_executers.insert(executer->name());
+		_last_targets.erase(executer->name());
+		executer->set_position(targets);
+		return;
+	}
+
+	//只把变化的部分更新到上次的目标里,不用整表拷贝
+	for (auto& v : changes)
+	{
+		if (decimal::eq(v.second, 0) && targets.find(v.first) == targets.end())
+			lastTargets.erase(v.first);
+		else
+			lastTargets[v.first] = v.second;
+	}
+}
+
 void WtExecuterMgr::enum_executer(EnumExecuterCb cb)
 {
 	for (auto& v : _executers)
@@ -19,15 +82,17 @@ void WtExecuterMgr::enum_executer(EnumExecuterCb cb)
 	}
 }
 
-void WtExecuterMgr::set_positions(wt_hashmap<std::string, double> target_pos)
+void WtExecuterMgr::set_positions(const wt_hashmap<std::string, double>& targets)
 {
+	//有过滤器的时候才需要拷贝一份过滤以后的目标
+	TargetsMap des_port;
+	const TargetsMap* pTargets = &targets;
 	if(_filter_mgr != NULL)
 	{
-		wt_hashmap<std::string, double> des_port;
-		for(auto& m : target_pos)
+		for(auto& m : targets)
 		{
 			const auto& stdCode = m.first;
-			double& desVol = (double&)m.second;
+			double desVol = m.second;
 			double oldVol = desVol;
 
 			bool isFltd = _filter_mgr->is_filtered_by_code(stdCode.c_str(), desVol);
@@ -48,7 +113,7 @@ void WtExecuterMgr::set_positions(wt_hashmap<std::string, double> target_pos)
 			}
 		}
 
-		des_port.swap(target_pos);
+		pTargets = &des_port;
 	}
 
 	for (auto& v : _executers)
@@ -60,7 +125,7 @@ void WtExecuterMgr::set_positions(wt_hashmap<std::string, double> target_pos)
 			WTSLogger::info("[Filters] Executer {} is filtered, all signals will be ignored", executer->name());
 			continue;
 		}
-		executer->set_position(target_pos);
+		push_targets(executer, *pTargets);
 	}
 }
 
@@ -99,26 +164,39 @@ void WtExecuterMgr::handle_pos_change(const char* stdCode, double targetPos, dou
 		}
 
 		auto it = _routed_executers.find(executer->name());
-		if (it == _routed_executers.end() && strcmp(execid, "ALL") == 0)
-			executer->on_position_changed(stdCode, diffPos);
-		else if(strcmp(executer->name(), execid) == 0)
-			executer->on_position_changed(stdCode, diffPos);
+		bool bHit = (it == _routed_executers.end() && strcmp(execid, "ALL") == 0) || (strcmp(executer->name(), execid) == 0);
+		if (!bHit)
+			continue;
+
+		executer->on_position_changed(stdCode, diffPos);
+
+		//执行器的目标已经变了,下次推送目标的时候这个合约一定要重新下达
+		auto lit = _last_targets.find(executer->name());
+		if (lit != _last_targets.end())
+			lit->second[stdCode] = DBL_MAX;
 	}
 }
 
 void WtExecuterMgr::handle_tick(const char* stdCode, WTSTickData* curTick)
 {
-	//for (auto it = _executers.begin(); it != _executers.end(); it++)
-	//{
-	//	ExecCmdPtr& executer = (*it);
-	//	executer->on_tick(stdCode, curTick);
-	//}
-
-	for (auto& v : _executers)
+	/*
+	 *	只推送给有该合约执行单元的执行器
+	 *	先把执行器拷出来再回调,回调里创建执行单元的时候还要登记索引
+	 */
+	thread_local static ExecList execs;
+	execs.clear();
 	{
-		ExecCmdPtr& executer = (ExecCmdPtr&)v.second;
-		executer->on_tick(stdCode, curTick);
+		SpinLock lock(_mtx_index);
+		auto it = _code_index.find(stdCode);
+		if (it != _code_index.end())
+			execs = it->second;
 	}
+
+	for (IExecCommand* executer : execs)
+		executer->on_tick(stdCode, curTick);
+
+	for (IExecCommand* executer : _broadcast)
+		executer->on_tick(stdCode, curTick);
 }
 
 void WtExecuterMgr::add_target_to_cache(const char* stdCode, double targetPos, const char* execid /* = "ALL" */)
@@ -199,7 +277,7 @@ void WtExecuterMgr::commit_cached_targets(double scale /* = 1.0 */)
 		if (it == _all_cached_targets.end())
 			continue;
 
-		executer->set_position(it->second);
+		push_targets(executer, it->second);
 	}
 
 	//提交完了以后，清理掉全部缓存的目标仓位
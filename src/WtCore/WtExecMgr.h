@@ -7,21 +7,22 @@ class WtFilterMgr;
 
 typedef std::function<void(ExecCmdPtr)> EnumExecuterCb;
 
-class WtExecuterMgr : private boost::noncopyable
+class WtExecuterMgr : private boost::noncopyable, public IExecCodeIndex
 {
 public:
 	WtExecuterMgr():_filter_mgr(NULL){}
 
 	inline void set_filter_mgr(WtFilterMgr* mgr) { _filter_mgr = mgr; }
 
-	inline void	add_executer(ExecCmdPtr executer)
-	{
-		_executers[executer->name()] = executer;
-	}
+	/*
+	 *	添加执行器,只能在启动之前调用
+	 *	登记代码的执行器只收到有执行单元的合约的行情,其他执行器收到全部行情
+	 */
+	void	add_executer(ExecCmdPtr executer);
 
 	void	enum_executer(EnumExecuterCb cb);
 
-	void	set_positions(wt_hashmap<std::string, double> target_pos);
+	void	set_positions(const wt_hashmap<std::string, double>& target_pos);
 	void	handle_pos_change(const char* stdCode, double targetPos, double diffPos, const char* execid = "ALL");
 	void	handle_tick(const char* stdCode, WTSTickData* curTick);
 
@@ -71,14 +72,34 @@ public:
 	 */
 	void	commit_cached_targets(double scale = 1.0);
 
+	//////////////////////////////////////////////////////////////////////////
+	//IExecCodeIndex
+	virtual void on_code_added(IExecCommand* executer, const char* stdCode) override;
+
+private:
+	typedef wt_hashmap<std::string, double> TargetsMap;
+
+	/*
+	 *	向执行器推送目标仓位
+	 *	支持差量的执行器只推送和上次相比有变化的合约,否则推送全量
+	 */
+	void	push_targets(ExecCmdPtr& executer, const TargetsMap& targets);
+
 private:
 	typedef wt_hashmap<std::string, ExecCmdPtr> ExecuterMap;
 	ExecuterMap		_executers;
 	WtFilterMgr*	_filter_mgr;
 
-	typedef wt_hashmap<std::string, double> TargetsMap;
 	wt_hashmap<std::string, TargetsMap>	_all_cached_targets;
 
+	wt_hashmap<std::string, TargetsMap>	_last_targets;		//上次推送给各执行器的目标仓位
+	wt_hashset<std::string>	_full_executers;	//不支持差量的执行器
+
+	typedef std::vector<IExecCommand*> ExecList;
+	SpinMutex		_mtx_index;
+	wt_hashmap<std::string, ExecList>	_code_index;	//代码到执行器的索引
+	ExecList		_broadcast;		//不登记代码的执行器,收到全部行情
+
 	typedef wt_hashset<std::string>	ExecuterSet;
 	wt_hashmap<std::string, ExecuterSet>	_router_rules;
 
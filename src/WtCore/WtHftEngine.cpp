@@ -17,6 +17,7 @@
 
 #include "../Share/decimal.h"
 #include "../Share/CodeHelper.hpp"
+#include "../Share/WtTickTrace.hpp"
 
 #include "../Includes/WTSVariant.hpp"
 #include "../Includes/WTSContractInfo.hpp"
@@ -32,6 +33,7 @@ USING_NS_WTP;
 WtHftEngine::WtHftEngine()
 	: _cfg(NULL)
 	, _tm_ticker(NULL)
+	, _worker_queue(8192)
 {
 }
 
@@ -45,6 +47,9 @@ WtHftEngine::~WtHftEngine()
 		_tm_ticker = NULL;
 	}
 
+	for (WtHftWorkerPtr& worker : _workers)
+		worker->stop();
+
 	if (_cfg)
 		_cfg->release();
 }
@@ -55,6 +60,10 @@ void WtHftEngine::init(WTSVariant* cfg, IBaseDataMgr* bdMgr, WtDtMgr* dataMgr, I
 
 	_cfg = cfg;
 	_cfg->retain();
+
+	uint32_t queueSize = cfg->getUInt32("hft_worker_queue");
+	if (queueSize > 0)
+		_worker_queue = queueSize;
 }
 
 void WtHftEngine::run()
@@ -65,9 +74,14 @@ void WtHftEngine::run()
 		ctx->on_init();
 	}
 
+	//策略初始化完成以后再启动工作线程,有工作线程的时候数据的读写要加锁
+	_data_mgr->set_data_guarded(!_workers.empty());
+	for (WtHftWorkerPtr& worker : _workers)
+		worker->start();
+
 	_tm_ticker = new WtHftRtTicker(this);
 	WTSVariant* cfgProd = _cfg->get("product");
-	_tm_ticker->init(_data_mgr->reader(), cfgProd->getCString("session"));
+	_tm_ticker->init(_data_mgr, cfgProd->getCString("session"));
 
 	//启动之前,先把运行中的策略落地
 	{
@@ -115,70 +129,121 @@ void WtHftEngine::handle_push_quote(WTSTickData* newTick)
 void WtHftEngine::handle_push_order_detail(WTSOrdDtlData* curOrdDtl)
 {
 	const char* stdCode = curOrdDtl->code();
-	auto sit = _orddtl_sub_map.find(stdCode);
-	if (sit != _orddtl_sub_map.end())
+	thread_local static SubSnapshot subs;
+	if (!snapshot_subs(_orddtl_sub_map, stdCode, subs))
+		return;
+
+	bool bHasWorker = !_workers.empty();
+	thread_local static std::vector<uint64_t> masks;
+	if (bHasWorker)
+		masks.assign(_workers.size(), 0);
+
+	for (auto& item : subs)
 	{
-		const SubList& sids = sit->second;
-		for (auto it = sids.begin(); it != sids.end(); it++)
+		//By Wesley @ 2022.02.07
+		//Level2数据一般用于HFT场景，所以不做复权处理
+		//所以不读取订阅标记
+		uint32_t sid = item.first;
+		if (bHasWorker)
 		{
-			//By Wesley @ 2022.02.07
-			//Level2数据一般用于HFT场景，所以不做复权处理
-			//所以不读取订阅标记
-			uint32_t sid = it->first;
-			auto cit = _ctx_map.find(sid);
-			if (cit != _ctx_map.end())
+			auto wit = _ctx_workers.find(sid);
+			if (wit != _ctx_workers.end())
 			{
-				HftContextPtr& ctx = (HftContextPtr&)cit->second;
-				ctx->on_order_detail(stdCode, curOrdDtl);
+				masks[wit->second.first] |= ((uint64_t)1 << wit->second.second);
+				continue;
 			}
 		}
+
+		auto cit = _ctx_map.find(sid);
+		if (cit != _ctx_map.end())
+		{
+			HftContextPtr& ctx = (HftContextPtr&)cit->second;
+			ctx->on_order_detail(stdCode, curOrdDtl);
+		}
 	}
+
+	if (bHasWorker)
+		publish_to_workers(HWE_OrdDtl, stdCode, curOrdDtl, masks);
 }
 
 void WtHftEngine::handle_push_order_queue(WTSOrdQueData* curOrdQue)
 {
 	const char* stdCode = curOrdQue->code();
-	auto sit = _ordque_sub_map.find(stdCode);
-	if (sit != _ordque_sub_map.end())
+	thread_local static SubSnapshot subs;
+	if (!snapshot_subs(_ordque_sub_map, stdCode, subs))
+		return;
+
+	bool bHasWorker = !_workers.empty();
+	thread_local static std::vector<uint64_t> masks;
+	if (bHasWorker)
+		masks.assign(_workers.size(), 0);
+
+	for (auto& item : subs)
 	{
-		const SubList& sids = sit->second;
-		for (auto it = sids.begin(); it != sids.end(); it++)
+		//By Wesley @ 2022.02.07
+		//Level2数据一般用于HFT场景，所以不做复权处理
+		//所以不读取订阅标记
+		uint32_t sid = item.first;
+		if (bHasWorker)
 		{
-			//By Wesley @ 2022.02.07
-			//Level2数据一般用于HFT场景，所以不做复权处理
-			//所以不读取订阅标记
-			uint32_t sid = it->first;
-			auto cit = _ctx_map.find(sid);
-			if (cit != _ctx_map.end())
+			auto wit = _ctx_workers.find(sid);
+			if (wit != _ctx_workers.end())
 			{
-				HftContextPtr& ctx = (HftContextPtr&)cit->second;
-				ctx->on_order_queue(stdCode, curOrdQue);
+				masks[wit->second.first] |= ((uint64_t)1 << wit->second.second);
+				continue;
 			}
 		}
+
+		auto cit = _ctx_map.find(sid);
+		if (cit != _ctx_map.end())
+		{
+			HftContextPtr& ctx = (HftContextPtr&)cit->second;
+			ctx->on_order_queue(stdCode, curOrdQue);
+		}
 	}
+
+	if (bHasWorker)
+		publish_to_workers(HWE_OrdQue, stdCode, curOrdQue, masks);
 }
 
 void WtHftEngine::handle_push_transaction(WTSTransData* curTrans)
 {
 	const char* stdCode = curTrans->code();
-	auto sit = _trans_sub_map.find(stdCode);
-	if (sit != _trans_sub_map.end())
+	thread_local static SubSnapshot subs;
+	if (!snapshot_subs(_trans_sub_map, stdCode, subs))
+		return;
+
+	bool bHasWorker = !_workers.empty();
+	thread_local static std::vector<uint64_t> masks;
+	if (bHasWorker)
+		masks.assign(_workers.size(), 0);
+
+	for (auto& item : subs)
 	{
-		const SubList& sids = sit->second;
-		for (auto it = sids.begin(); it != sids.end(); it++)
+		//By Wesley @ 2022.02.07
+		//Level2数据一般用于HFT场景，所以不做复权处理
+		//所以不读取订阅标记
+		uint32_t sid = item.first;
+		if (bHasWorker)
 		{
-			//By Wesley @ 2022.02.07
-			//Level2数据一般用于HFT场景，所以不做复权处理
-			//所以不读取订阅标记
-			uint32_t sid = it->first;
-			auto cit = _ctx_map.find(sid);
-			if (cit != _ctx_map.end())
+			auto wit = _ctx_workers.find(sid);
+			if (wit != _ctx_workers.end())
 			{
-				HftContextPtr& ctx = (HftContextPtr&)cit->second;
-				ctx->on_transaction(stdCode, curTrans);
+				masks[wit->second.first] |= ((uint64_t)1 << wit->second.second);
+				continue;
 			}
 		}
+
+		auto cit = _ctx_map.find(sid);
+		if (cit != _ctx_map.end())
+		{
+			HftContextPtr& ctx = (HftContextPtr&)cit->second;
+			ctx->on_transaction(stdCode, curTrans);
+		}
 	}
+
+	if (bHasWorker)
+		publish_to_workers(HWE_Trans, stdCode, curTrans, masks);
 }
 
 void WtHftEngine::sub_order_detail(uint32_t sid, const char* stdCode)
@@ -187,6 +252,7 @@ void WtHftEngine::sub_order_detail(uint32_t sid, const char* stdCode)
 	if (stdCode[length - 1] == SUFFIX_QFQ || stdCode[length - 1] == SUFFIX_HFQ)
 		length--;
 
+	WtDtMgr::DataLock lock = _data_mgr->lock_data();
 	SubList& sids = _orddtl_sub_map[std::string(stdCode, length)];
 	sids[sid] = std::make_pair(sid, 0);
 }
@@ -197,6 +263,7 @@ void WtHftEngine::sub_order_queue(uint32_t sid, const char* stdCode)
 	if (stdCode[length - 1] == SUFFIX_QFQ || stdCode[length - 1] == SUFFIX_HFQ)
 		length--;
 
+	WtDtMgr::DataLock lock = _data_mgr->lock_data();
 	SubList& sids = _ordque_sub_map[std::string(stdCode, length)];
 	sids[sid] = std::make_pair(sid, 0);
 }
@@ -207,15 +274,22 @@ void WtHftEngine::sub_transaction(uint32_t sid, const char* stdCode)
 	if (stdCode[length - 1] == SUFFIX_QFQ || stdCode[length - 1] == SUFFIX_HFQ)
 		length--;
 
+	WtDtMgr::DataLock lock = _data_mgr->lock_data();
 	SubList& sids = _trans_sub_map[std::string(stdCode, length)];
 	sids[sid] = std::make_pair(sid, 0);
 }
 
 void WtHftEngine::on_tick(const char* stdCode, WTSTickData* curTick)
 {
-	WtEngine::on_tick(stdCode, curTick);
+	WT_TRACE_STAMP(curTick, TTS_ENGINE_DISPATCH);
 
-	_data_mgr->handle_push_quote(stdCode, curTick);
+	//价格和数据缓存的更新在数据锁里,策略的回调和投递在锁外
+	{
+		WtDtMgr::DataLock lock = _data_mgr->lock_data();
+		WtEngine::on_tick(stdCode, curTick);
+
+		_data_mgr->handle_push_quote(stdCode, curTick);
+	}
 
 	/*
 	 *	By Wesley @ 2022.02.07
@@ -226,23 +300,43 @@ void WtHftEngine::on_tick(const char* stdCode, WTSTickData* curTick)
 	 */
 	if(_ready)
 	{
-		auto sit = _tick_sub_map.find(stdCode);
-		if (sit != _tick_sub_map.end())
+		thread_local static SubSnapshot subs;
+		if (snapshot_subs(_tick_sub_map, stdCode, subs))
 		{
-			const SubList& sids = sit->second;
-			for (auto it = sids.begin(); it != sids.end(); it++)
+			//有独立工作线程的策略,不复权的tick按工作线程合并掩码,每个工作线程只投递一次
+			bool bHasWorker = !_workers.empty();
+			thread_local static std::vector<uint64_t> masks;
+			if (bHasWorker)
+				masks.assign(_workers.size(), 0);
+
+			for (auto& item : subs)
 			{
-				uint32_t sid = it->first;
+				uint32_t sid = item.first;
 
 				auto cit = _ctx_map.find(sid);
 				if (cit != _ctx_map.end())
 				{
 					HftContextPtr& ctx = (HftContextPtr&)cit->second;
-					uint32_t opt = it->second.second;
+					uint32_t opt = item.second;
+
+					WtHftWorker* worker = NULL;
+					uint64_t target = 0;
+					if (bHasWorker)
+					{
+						auto wit = _ctx_workers.find(sid);
+						if (wit != _ctx_workers.end())
+						{
+							worker = _workers[wit->second.first].get();
+							target = ((uint64_t)1 << wit->second.second);
+						}
+					}
 
 					if (opt == 0)
 					{
-						ctx->on_tick(stdCode, curTick);
+						if (worker)
+							masks[worker->index()] |= target;
+						else
+							ctx->on_tick(stdCode, curTick);
 					}
 					else
 					{
@@ -250,7 +344,10 @@ void WtHftEngine::on_tick(const char* stdCode, WTSTickData* curTick)
 						wCode = fmt::format("{}{}", stdCode, opt == 1 ? SUFFIX_QFQ : SUFFIX_HFQ);
 						if (opt == 1)
 						{
-							ctx->on_tick(wCode.c_str(), curTick);
+							if (worker)
+								worker->publish(HWE_Tick, wCode.c_str(), curTick, target);
+							else
+								ctx->on_tick(wCode.c_str(), curTick);
 						}
 						else //(opt == 2)
 						{
@@ -265,32 +362,83 @@ void WtHftEngine::on_tick(const char* stdCode, WTSTickData* curTick)
 							newTS.low *= factor;
 							newTS.price *= factor;
 
-							_price_map[wCode] = newTS.price;
+							{
+								WtDtMgr::DataLock lock = _data_mgr->lock_data();
+								_price_map[wCode] = newTS.price;
+							}
 
-							ctx->on_tick(wCode.c_str(), newTick);
+							if (worker)
+								worker->publish(HWE_Tick, wCode.c_str(), newTick, target);
+							else
+								ctx->on_tick(wCode.c_str(), newTick);
 							newTick->release();
 						}
 					}
 				}
 			}
+
+			if (bHasWorker)
+				publish_to_workers(HWE_Tick, stdCode, curTick, masks);
 		}
 	}
 }
 
+bool WtHftEngine::snapshot_subs(const StraSubMap& subMap, const char* key, SubSnapshot& subs)
+{
+	subs.clear();
+
+	WtDtMgr::DataLock lock = _data_mgr->lock_data();
+	auto sit = subMap.find(key);
+	if (sit == subMap.end())
+		return false;
+
+	const SubList& sids = sit->second;
+	for (auto it = sids.begin(); it != sids.end(); it++)
+		subs.emplace_back(it->first, it->second.second);
+
+	return !subs.empty();
+}
+
+void WtHftEngine::publish_to_workers(HftWorkerEvtType eType, const char* stdCode, WTSObject* data, const std::vector<uint64_t>& masks)
+{
+	for (std::size_t idx = 0; idx < masks.size(); idx++)
+	{
+		if (masks[idx] != 0)
+			_workers[idx]->publish(eType, stdCode, data, masks[idx]);
+	}
+}
+
 void WtHftEngine::on_bar(const char* stdCode, const char* period, uint32_t times, WTSBarStruct* newBar)
 {
 	thread_local static char key[64] = { 0 };
 	fmtutil::format_to(key, "{}-{}-{}", stdCode, period, times);
 
-	const SubList& sids = _bar_sub_map[key];
-	for (auto it = sids.begin(); it != sids.end(); it++)
+	thread_local static SubSnapshot subs;
+	if (!snapshot_subs(_bar_sub_map, key, subs))
+		return;
+
+	for (auto& item : subs)
 	{
-		uint32_t sid = it->first;
+		uint32_t sid = item.first;
 		auto cit = _ctx_map.find(sid);
 		if (cit != _ctx_map.end())
 		{
 			HftContextPtr& ctx = (HftContextPtr&)cit->second;
-			ctx->on_bar(stdCode, period, times, newBar);
+			auto wit = _ctx_workers.find(sid);
+			if (wit != _ctx_workers.end())
+			{
+				//K线投递到工作线程的时候要复制一份
+				std::string code = stdCode;
+				std::string per = period;
+				WTSBarStruct bar = *newBar;
+				_workers[wit->second.first]->post(wit->second.second, [ctx, code, per, times, bar]() mutable {
+					ctx->on_bar(code.c_str(), per.c_str(), times, &bar);
+				});
+			}
+			else
+			{
+				ctx->on_bar(stdCode, period, times, newBar);
+			}
 		}
 	}
 }
@@ -303,7 +451,18 @@ void WtHftEngine::on_session_begin()
 	for (auto it = _ctx_map.begin(); it != _ctx_map.end(); it++)
 	{
 		HftContextPtr& ctx = (HftContextPtr&)it->second;
-		ctx->on_session_begin(_cur_tdate);
+		auto wit = _ctx_workers.find(it->first);
+		if (wit != _ctx_workers.end())
+		{
+			uint32_t tdate = _cur_tdate;
+			_workers[wit->second.first]->post(wit->second.second, [ctx, tdate]() {
+				ctx->on_session_begin(tdate);
+			});
+		}
+		else
+		{
+			ctx->on_session_begin(_cur_tdate);
+		}
 	}
 
 	if (_evt_listener)
@@ -319,9 +478,28 @@ void WtHftEngine::on_session_end()
 	for (auto it = _ctx_map.begin(); it != _ctx_map.end(); it++)
 	{
 		HftContextPtr& ctx = (HftContextPtr&)it->second;
-		ctx->on_session_end(_cur_tdate);
+		auto wit = _ctx_workers.find(it->first);
+		if (wit != _ctx_workers.end())
+		{
+			uint32_t tdate = _cur_tdate;
+			_workers[wit->second.first]->post(wit->second.second, [ctx, tdate]() {
+				ctx->on_session_end(tdate);
+			});
+		}
+		else
+		{
+			ctx->on_session_end(_cur_tdate);
+		}
 	}
 
+	//各工作线程的排队和处理延迟在工作线程里输出
+	for (WtHftWorkerPtr& worker : _workers)
+		worker->post_report();
+
+#ifdef WT_TICK_TRACE
+	WTSLogger::log_raw(LL_INFO, TickTracer::dump(true).c_str());
+#endif
+
 	WTSLogger::info("Trading day {} ended", _cur_tdate);
 	if (_evt_listener)
 		_evt_listener->on_session_event(_cur_tdate, false);
@@ -337,10 +515,69 @@ void WtHftEngine::on_minute_end(uint32_t curDate, uint32_t curTime)
 	//}
 }
 
-void WtHftEngine::addContext(HftContextPtr ctx)
+bool WtHftEngine::addContext(HftContextPtr ctx, int32_t core /* = -1 */, const char* traderid /* = "" */)
 {
 	uint32_t sid = ctx->id();
+
+	//先确定策略实际所在的线程,工作线程满了就留在行情线程里
+	WtHftWorkerPtr worker;
+	if (core >= 0)
+	{
+		for (WtHftWorkerPtr& w : _workers)
+		{
+			if (w->core() == core)
+			{
+				worker = w;
+				break;
+			}
+		}
+
+		if (worker && !worker->has_room())
+		{
+			WTSLogger::warn("HFT worker on core {} is full or running, strategy {} will run in quote thread", core, ctx->name());
+			worker.reset();
+			core = -1;
+		}
+	}
+
+	int32_t thrdIdx = (core < 0) ? -1 : (worker ? (int32_t)worker->index() : (int32_t)_workers.size());
+
+	//同一个交易通道的策略必须在同一个线程里,交易通道的下单撤单不做线程同步
+	if (strlen(traderid) > 0)
+	{
+		auto tit = _trader_threads.find(traderid);
+		if (tit != _trader_threads.end() && tit->second != thrdIdx)
+		{
+			WTSLogger::error("HFT strategy {} rejected: trader {} is already used by strategies on {}, all strategies of one trader must run on the same thread",
+				ctx->name(), traderid, tit->second < 0 ? "quote thread" : fmt::format("worker {}", tit->second));
+			return false;
+		}
+		_trader_threads[traderid] = thrdIdx;
+	}
+
 	_ctx_map[sid] = ctx;
+	if (core < 0)
+		return true;
+
+	if (worker == NULL)
+	{
+		worker.reset(new WtHftWorker((uint32_t)_workers.size(), core, _worker_queue));
+		_workers.emplace_back(worker);
+	}
+
+	int32_t ctxIdx = worker->add_context(ctx);
+	_ctx_workers[sid] = std::make_pair(worker->index(), (uint32_t)ctxIdx);
+	WTSLogger::info("HFT strategy {} assigned to worker {} on core {}", ctx->name(), worker->index(), core);
+	return true;
+}
+
+ITrdNotifySink* WtHftEngine::getTradeSink(uint32_t sid, ITrdNotifySink* sink)
+{
+	auto wit = _ctx_workers.find(sid);
+	if (wit == _ctx_workers.end())
+		return sink;
+
+	return _workers[wit->second.first]->wrap_trade_sink(sink, wit->second.second);
 }
 
 HftContextPtr WtHftEngine::getContext(uint32_t id)
@@ -352,6 +589,36 @@ HftContextPtr WtHftEngine::getContext(uint32_t id)
 	return it->second;
 }
 
+WTSKlineSlice* WtHftEngine::get_kline_slice(uint32_t sid, const char* stdCode, const char* period, uint32_t count, uint32_t times /* = 1 */, uint64_t etime /* = 0 */)
+{
+	WtDtMgr::DataLock lock = _data_mgr->lock_data();
+	return WtEngine::get_kline_slice(sid, stdCode, period, count, times, etime);
+}
+
+WTSTickData* WtHftEngine::get_last_tick(uint32_t sid, const char* stdCode)
+{
+	WtDtMgr::DataLock lock = _data_mgr->lock_data();
+	return WtEngine::get_last_tick(sid, stdCode);
+}
+
+WTSTickSlice* WtHftEngine::get_tick_slice(uint32_t sid, const char* stdCode, uint32_t count)
+{
+	WtDtMgr::DataLock lock = _data_mgr->lock_data();
+	return WtEngine::get_tick_slice(sid, stdCode, count);
+}
+
+double WtHftEngine::get_cur_price(const char* stdCode)
+{
+	WtDtMgr::DataLock lock = _data_mgr->lock_data();
+	return WtEngine::get_cur_price(stdCode);
+}
+
+void WtHftEngine::sub_tick(uint32_t sid, const char* stdCode)
+{
+	WtDtMgr::DataLock lock = _data_mgr->lock_data();
+	WtEngine::sub_tick(sid, stdCode);
+}
+
 WTSOrdQueSlice* WtHftEngine::get_order_queue_slice(uint32_t sid, const char* code, uint32_t count)
 {
 	return _data_mgr->get_order_queue_slice(code, count);
@@ -10,6 +10,7 @@
 #pragma once
 #include "WtEngine.h"
 #include "WtLocalExecuter.h"
+#include "WtHftWorker.h"
 
 #include "../Includes/IHftStraCtx.h"
 
@@ -18,8 +19,6 @@ NS_WTP_BEGIN
 class WTSVariant;
 class WtHftRtTicker;
 
-typedef std::shared_ptr<IHftStraCtx> HftContextPtr;
-
 class WtHftEngine :	public WtEngine
 {
 public:
@@ -46,7 +45,18 @@ public:
 
 	virtual void on_session_end() override;
 
+	virtual WTSKlineSlice*	get_kline_slice(uint32_t sid, const char* stdCode, const char* period, uint32_t count, uint32_t times = 1, uint64_t etime = 0) override;
+
 public:
+	/*
+	 *	策略读取数据的接口
+	 *	有独立工作线程的时候,要和行情线程对价格、订阅表和数据缓存的更新互斥
+	 */
+	WTSTickData*	get_last_tick(uint32_t sid, const char* stdCode);
+	WTSTickSlice*	get_tick_slice(uint32_t sid, const char* stdCode, uint32_t count);
+	double			get_cur_price(const char* stdCode);
+	void			sub_tick(uint32_t sid, const char* stdCode);
+
 	WTSOrdQueSlice* get_order_queue_slice(uint32_t sid, const char* stdCode, uint32_t count);
 	WTSOrdDtlSlice* get_order_detail_slice(uint32_t sid, const char* stdCode, uint32_t count);
 	WTSTransSlice* get_transaction_slice(uint32_t sid, const char* stdCode, uint32_t count);
@@ -54,7 +64,22 @@ public:
 public:
 	void on_minute_end(uint32_t curDate, uint32_t curTime);
 
-	void addContext(HftContextPtr ctx);
+	/*
+	 *	添加策略
+	 *	core		策略工作线程绑定的cpu核,小于0则直接在行情线程里回调
+	 *				同一个核上的策略共用一个工作线程
+	 *	traderid	策略绑定的交易通道
+	 *				交易通道的下单撤单不是线程安全的,同一个通道的策略必须在同一个线程里运行
+	 *
+	 *	返回值	和同通道的其他策略不在一个线程里的时候,拒绝添加,返回false
+	 */
+	bool addContext(HftContextPtr ctx, int32_t core = -1, const char* traderid = "");
+
+	/*
+	 *	获取策略的交易回报接口
+	 *	如果策略有独立的工作线程,返回的是转发器,回报会投递到工作线程里处理
+	 */
+	ITrdNotifySink* getTradeSink(uint32_t sid, ITrdNotifySink* sink);
 
 	HftContextPtr	getContext(uint32_t id);
 
@@ -62,6 +87,19 @@ public:
 	void sub_order_detail(uint32_t sid, const char* stdCode);
 	void sub_transaction(uint32_t sid, const char* stdCode);
 
+private:
+	/*
+	 *	按掩码把数据投递到各个工作线程,每个工作线程只投递一次
+	 */
+	void publish_to_workers(HftWorkerEvtType eType, const char* stdCode, WTSObject* data, const std::vector<uint64_t>& masks);
+
+	/*
+	 *	在数据锁里拷贝一份订阅列表,回调和投递都在锁外进行
+	 *	锁里投递的话,队列满了会和等锁的工作线程互相等待
+	 */
+	typedef std::vector<std::pair<uint32_t, uint32_t>> SubSnapshot;
+	bool snapshot_subs(const StraSubMap& subMap, const char* key, SubSnapshot& subs);
+
 private:
 	typedef wt_hashmap<uint32_t, HftContextPtr> ContextMap;
 	ContextMap		_ctx_map;
@@ -73,6 +111,15 @@ private:
 	StraSubMap		_ordque_sub_map;	//委托队列订阅表
 	StraSubMap		_orddtl_sub_map;	//委托明细订阅表
 	StraSubMap		_trans_sub_map;		//成交明细订阅表
+
+	//策略工作线程,以及策略id到工作线程序号和线程内策略序号的映射
+	std::vector<WtHftWorkerPtr>	_workers;
+	typedef wt_hashmap<uint32_t, std::pair<uint32_t, uint32_t>> CtxWorkerMap;
+	CtxWorkerMap	_ctx_workers;
+	uint32_t		_worker_queue;	//工作线程的队列长度
+
+	//交易通道所在的线程,工作线程序号,行情线程为-1
+	wt_hashmap<std::string, int32_t>	_trader_threads;
 };
 
 NS_WTP_END
\ No newline at end of file
@@ -9,6 +9,7 @@
  */
 #include "WtHftTicker.h"
 #include "WtHftEngine.h"
+#include "WtDtMgr.h"
 #include "../Includes/IDataReader.h"
 
 #include "../Share/TimeUtils.hpp"
@@ -39,7 +40,7 @@ WtHftRtTicker::~WtHftRtTicker()
 {
 }
 
-void WtHftRtTicker::init(IDataReader* store, const char* sessionID)
+void WtHftRtTicker::init(WtDtMgr* store, const char* sessionID)
 {
 	_store = store;
 	_s_info = _engine->get_session_info(sessionID);
@@ -120,7 +121,7 @@ void WtHftRtTicker::on_tick(WTSTickData* curTick)
 
 			WTSLogger::info("Minute Bar {}.{:04d} Closed by data", _date, thisMin);
 			if (_store)
-				_store->onMinuteEnd(_date, thisMin);
+				_store->on_minute_end(_date, thisMin);
 
 			_engine->on_minute_end(_date, thisMin);
 
@@ -201,7 +202,7 @@ void WtHftRtTicker::run()
 
 					WTSLogger::info("Minute bar {}.{:04d} closed automatically", _date, thisMin);
 					if (_store)
-						_store->onMinuteEnd(_date, thisMin);
+						_store->on_minute_end(_date, thisMin);
 
 					_engine->on_minute_end(_date, thisMin);
 
@@ -236,7 +237,7 @@ void WtHftRtTicker::run()
 
 					WTSLogger::info("Minute bar {}.{:04d} closed automatically", _date, thisMin);
 					if (_store)
-						_store->onMinuteEnd(_date, thisMin, _engine->getTradingDate());
+						_store->on_minute_end(_date, thisMin, _engine->getTradingDate());
 
 					_engine->on_session_end();
 
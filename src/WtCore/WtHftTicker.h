@@ -17,7 +17,7 @@
 
 NS_WTP_BEGIN
 class WTSSessionInfo;
-class IDataReader;
+class WtDtMgr;
 class WTSTickData;
 
 class WtHftEngine;
@@ -29,7 +29,7 @@ public:
 	~WtHftRtTicker();
 
 public:
-	void	init(IDataReader* store, const char* sessionID);
+	void	init(WtDtMgr* store, const char* sessionID);
 	void	on_tick(WTSTickData* curTick);
 
 	void	run();
@@ -41,7 +41,7 @@ private:
 private:
 	WTSSessionInfo*	_s_info;
 	WtHftEngine*	_engine;
-	IDataReader*		_store;
+	WtDtMgr*		_store;
 
 	uint32_t	_date;
 	uint32_t	_time;
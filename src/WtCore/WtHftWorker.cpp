@@ -0,0 +1,317 @@
+﻿/*!
+ * \file WtHftWorker.cpp
+ * \project	WonderTrader
+ *
+ * \brief
+ */
+#include "WtHftWorker.h"
+
+#include "../Includes/WTSDataDef.hpp"
+#include "../Share/CpuHelper.hpp"
+#include "../WTSTools/WTSLogger.h"
+
+#include <chrono>
+
+USING_NS_WTP;
+
+inline int64_t steady_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ *	交易回报的转发器
+ *	交易通道的回调线程里只做投递,真正的回调在策略所在的工作线程里执行
+ */
+class HftWorkerTrdSink : public ITrdNotifySink
+{
+public:
+	HftWorkerTrdSink(WtHftWorker* worker, ITrdNotifySink* sink, uint32_t ctxIdx)
+		: _worker(worker), _sink(sink), _ctx_idx(ctxIdx) {}
+
+public:
+	virtual void on_trade(uint32_t localid, const char* stdCode, bool isBuy, double vol, double price) override
+	{
+		std::string code = stdCode;
+		ITrdNotifySink* sink = _sink;
+		_worker->post(_ctx_idx, [sink, localid, code, isBuy, vol, price]() {
+			sink->on_trade(localid, code.c_str(), isBuy, vol, price);
+		});
+	}
+
+	virtual void on_order(uint32_t localid, const char* stdCode, bool isBuy, double totalQty, double leftQty, double price, bool isCanceled = false) override
+	{
+		std::string code = stdCode;
+		ITrdNotifySink* sink = _sink;
+		_worker->post(_ctx_idx, [sink, localid, code, isBuy, totalQty, leftQty, price, isCanceled]() {
+			sink->on_order(localid, code.c_str(), isBuy, totalQty, leftQty, price, isCanceled);
+		});
+	}
+
+	virtual void on_position(const char* stdCode, bool isLong, double prevol, double preavail, double newvol, double newavail, uint32_t tradingday) override
+	{
+		std::string code = stdCode;
+		ITrdNotifySink* sink = _sink;
+		_worker->post(_ctx_idx, [sink, code, isLong, prevol, preavail, newvol, newavail, tradingday]() {
+			sink->on_position(code.c_str(), isLong, prevol, preavail, newvol, newavail, tradingday);
+		});
+	}
+
+	virtual void on_channel_ready() override
+	{
+		ITrdNotifySink* sink = _sink;
+		_worker->post(_ctx_idx, [sink]() {
+			sink->on_channel_ready();
+		});
+	}
+
+	virtual void on_channel_lost() override
+	{
+		ITrdNotifySink* sink = _sink;
+		_worker->post(_ctx_idx, [sink]() {
+			sink->on_channel_lost();
+		});
+	}
+
+	virtual void on_entrust(uint32_t localid, const char* stdCode, bool bSuccess, const char* message) override
+	{
+		std::string code = stdCode;
+		std::string msg = message;
+		ITrdNotifySink* sink = _sink;
+		_worker->post(_ctx_idx, [sink, localid, code, bSuccess, msg]() {
+			sink->on_entrust(localid, code.c_str(), bSuccess, msg.c_str());
+		});
+	}
+
+	virtual void on_account(const char* currency, double prebalance, double balance, double dynbalance, double avaliable, double closeprofit, double dynprofit, double margin, double fee, double deposit, double withdraw) override
+	{
+		std::string curr = currency;
+		ITrdNotifySink* sink = _sink;
+		_worker->post(_ctx_idx, [sink, curr, prebalance, balance, dynbalance, avaliable, closeprofit, dynprofit, margin, fee, deposit, withdraw]() {
+			sink->on_account(curr.c_str(), prebalance, balance, dynbalance, avaliable, closeprofit, dynprofit, margin, fee, deposit, withdraw);
+		});
+	}
+
+private:
+	WtHftWorker*	_worker;
+	ITrdNotifySink*	_sink;
+	uint32_t		_ctx_idx;
+};
+
+
+WtHftWorker::WtHftWorker(uint32_t idx, int32_t core, uint32_t queueSize)
+	: _idx(idx)
+	, _core(core)
+	, _queue(queueSize)
+	, _max_depth(0)
+	, _full_waits(0)
+	, _running(false)
+{
+}
+
+WtHftWorker::~WtHftWorker()
+{
+	stop();
+}
+
+int32_t WtHftWorker::add_context(HftContextPtr ctx)
+{
+	if (_running || _contexts.size() >= MAX_CTX_PER_HFT_WORKER)
+		return -1;
+
+	_contexts.emplace_back(CtxStat());
+	_contexts.back()._ctx = ctx;
+	return (int32_t)_contexts.size() - 1;
+}
+
+ITrdNotifySink* WtHftWorker::wrap_trade_sink(ITrdNotifySink* sink, uint32_t ctxIdx)
+{
+	TrdSinkPtr proxy(new HftWorkerTrdSink(this, sink, ctxIdx));
+	_trd_sinks.emplace_back(proxy);
+	return proxy.get();
+}
+
+void WtHftWorker::start()
+{
+	if (_running)
+		return;
+
+	_running = true;
+	_thrd.reset(new StdThread([this]() {
+		if (_core >= 0)
+		{
+			if (CpuHelper::bind_core(_core))
+				WTSLogger::info("HFT worker {} bound to core {}", _idx, _core);
+			else
+				WTSLogger::warn("Binding HFT worker {} to core {} failed", _idx, _core);
+		}
+
+		run_loop();
+	}));
+
+	WTSLogger::info("HFT worker {} started with {} strategies, queue capacity {}", _idx, _contexts.size(), _queue.capacity());
+}
+
+void WtHftWorker::stop()
+{
+	if (!_running)
+		return;
+
+	_running = false;
+	if (_thrd)
+	{
+		_thrd->join();
+		_thrd.reset();
+	}
+
+	//没处理完的事件也要释放掉
+	_queue.drain([](HftWorkerEvent& evt) {
+		if (evt._data)
+		{
+			evt._data->release();
+			evt._data = NULL;
+		}
+
+		if (evt._task)
+		{
+			delete evt._task;
+			evt._task = NULL;
+		}
+	});
+}
+
+void WtHftWorker::publish(HftWorkerEvtType eType, const char* stdCode, WTSObject* data, uint64_t targets)
+{
+	data->retain();
+	push_event([&](HftWorkerEvent& evt) {
+		evt._type = eType;
+		evt._targets = targets;
+		strncpy(evt._code, stdCode, MAX_INSTRUMENT_LENGTH - 1);
+		evt._code[MAX_INSTRUMENT_LENGTH - 1] = '\0';
+		evt._data = data;
+		evt._task = NULL;
+		evt._pub_ns = steady_ns();
+	});
+}
+
+void WtHftWorker::post(int32_t ctxIdx, HftWorkerTask task)
+{
+	//工作线程自己投递的,比如下单的时候同步返回的回报,直接执行,否则队列满了会等自己
+	if (!_running || (_thrd && std::this_thread::get_id() == _thrd->get_id()))
+	{
+		task();
+		return;
+	}
+
+	HftWorkerTask* pTask = new HftWorkerTask(std::move(task));
+	push_event([&](HftWorkerEvent& evt) {
+		evt._type = HWE_Task;
+		evt._targets = (ctxIdx < 0) ? 0 : ((uint64_t)1 << ctxIdx);
+		evt._code[0] = '\0';
+		evt._data = NULL;
+		evt._task = pTask;
+		evt._pub_ns = steady_ns();
+	});
+}
+
+void WtHftWorker::dispatch(HftWorkerEvent& evt)
+{
+	//不属于具体策略的任务,如输出统计
+	if (evt._type == HWE_Task && evt._targets == 0)
+		(*evt._task)();
+
+	uint64_t targets = evt._targets;
+	while (targets != 0)
+	{
+#ifdef _MSC_VER
+		unsigned long idx = 0;
+		_BitScanForward64(&idx, targets);
+#else
+		uint32_t idx = (uint32_t)__builtin_ctzll(targets);
+#endif
+		targets &= targets - 1;
+
+		CtxStat& stat = _contexts[idx];
+		int64_t start = steady_ns();
+		stat._queue_lat.record((uint64_t)(start - evt._pub_ns));
+
+		switch (evt._type)
+		{
+		case HWE_Tick: stat._ctx->on_tick(evt._code, (WTSTickData*)evt._data); break;
+		case HWE_OrdDtl: stat._ctx->on_order_detail(evt._code, (WTSOrdDtlData*)evt._data); break;
+		case HWE_OrdQue: stat._ctx->on_order_queue(evt._code, (WTSOrdQueData*)evt._data); break;
+		case HWE_Trans: stat._ctx->on_transaction(evt._code, (WTSTransData*)evt._data); break;
+		case HWE_Task: (*evt._task)(); break;
+		default: break;
+		}
+
+		stat._proc_lat.record((uint64_t)(steady_ns() - start));
+		stat._events++;
+	}
+
+	if (evt._data)
+	{
+		evt._data->release();
+		evt._data = NULL;
+	}
+
+	if (evt._task)
+	{
+		delete evt._task;
+		evt._task = NULL;
+	}
+}
+
+void WtHftWorker::run_loop()
+{
+	uint32_t idles = 0;
+	while (_running)
+	{
+		uint32_t depth = _queue.size();
+		if (depth > _max_depth)
+			_max_depth = depth;
+
+		uint32_t cnt = _queue.drain([this](HftWorkerEvent& evt) {
+			dispatch(evt);
+		}, 64);
+
+		if (cnt > 0)
+		{
+			idles = 0;
+			continue;
+		}
+
+		//绑核以后空转的代价不大,但是空转太久还是让出cpu,避免和其他线程抢
+		if (++idles > 1000)
+			std::this_thread::yield();
+	}
+}
+
+void WtHftWorker::post_report()
+{
+	post(-1, [this]() {
+		report(true);
+	});
+}
+
+void WtHftWorker::report(bool bReset /* = true */)
+{
+	WTSLogger::info("HFT worker {}: queue max depth {}, waited {} times on full queue", _idx, _max_depth.load(), _full_waits.load());
+	for (CtxStat& stat : _contexts)
+	{
+		WTSLogger::info("HFT worker {} strategy {}: {} events, queue latency(ns): {}", _idx, stat._ctx->name(), stat._events, stat._queue_lat.summary());
+		WTSLogger::info("HFT worker {} strategy {}: process latency(ns): {}", _idx, stat._ctx->name(), stat._proc_lat.summary());
+	}
+
+	if (bReset)
+	{
+		_max_depth = 0;
+		_full_waits = 0;
+		for (CtxStat& stat : _contexts)
+		{
+			stat._events = 0;
+			stat._queue_lat.reset();
+			stat._proc_lat.reset();
+		}
+	}
+}
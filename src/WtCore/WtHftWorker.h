@@ -0,0 +1,165 @@
+﻿/*!
+ * \file WtHftWorker.h
+ * \project	WonderTrader
+ *
+ * \brief HFT策略的独立工作线程
+ *
+ * 绑定了工作线程的策略不再在行情线程里回调,行情线程只负责把数据指针投递到工作线程的队列里
+ * 行情、session事件和交易回报都走同一个队列,同一个策略看到的事件顺序和原来单线程时一致
+ */
+#pragma once
+#include "ITrdNotifySink.h"
+
+#include "../Includes/IHftStraCtx.h"
+#include "../Share/StdUtils.hpp"
+#include "../Share/SpinMutex.hpp"
+#include "../Share/WtSpscRing.hpp"
+#include "../Share/WtLatencyHistogram.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+
+//一个工作线程最多挂多少个策略,投递的时候用64位的掩码标记目标策略
+#define MAX_CTX_PER_HFT_WORKER	64
+
+NS_WTP_BEGIN
+
+class WTSObject;
+typedef std::shared_ptr<IHftStraCtx> HftContextPtr;
+
+typedef enum tagHftWorkerEvtType
+{
+	HWE_Tick = 0,
+	HWE_OrdDtl,
+	HWE_OrdQue,
+	HWE_Trans,
+	HWE_Task		//其他事件都包装成任务,如session事件、K线、交易回报
+} HftWorkerEvtType;
+
+typedef std::function<void()> HftWorkerTask;
+
+/*
+ *	队列中的事件
+ *	行情数据只投递指针并增加引用计数,工作线程处理完以后释放
+ */
+typedef struct _HftWorkerEvent
+{
+	uint32_t		_type;
+	uint64_t		_targets;	//目标策略的掩码,对应工作线程内的策略序号
+	char			_code[MAX_INSTRUMENT_LENGTH];
+	WTSObject*		_data;
+	HftWorkerTask*	_task;
+	int64_t			_pub_ns;	//投递时间,用于统计排队延迟
+
+	_HftWorkerEvent() :_type(HWE_Tick), _targets(0), _data(NULL), _task(NULL), _pub_ns(0) { _code[0] = '\0'; }
+} HftWorkerEvent;
+
+class WtHftWorker
+{
+public:
+	/*
+	 *	idx			工作线程序号
+	 *	core		绑定的cpu核,小于0则不绑定
+	 *	queueSize	队列长度
+	 */
+	WtHftWorker(uint32_t idx, int32_t core, uint32_t queueSize);
+	~WtHftWorker();
+
+public:
+	/*
+	 *	添加策略,只能在启动之前调用
+	 *
+	 *	返回值	策略在工作线程内的序号,已满返回-1
+	 */
+	int32_t	add_context(HftContextPtr ctx);
+
+	/*
+	 *	包装交易回报接口,回报会被转到工作线程里处理
+	 */
+	ITrdNotifySink*	wrap_trade_sink(ITrdNotifySink* sink, uint32_t ctxIdx);
+
+	void	start();
+	void	stop();
+
+	inline bool		has_room() const { return !_running && _contexts.size() < MAX_CTX_PER_HFT_WORKER; }
+
+	inline uint32_t	index() const { return _idx; }
+	inline int32_t	core() const { return _core; }
+	inline bool		is_running() const { return _running; }
+
+public:
+	/*
+	 *	投递行情数据
+	 *	targets	目标策略的掩码
+	 */
+	void	publish(HftWorkerEvtType eType, const char* stdCode, WTSObject* data, uint64_t targets);
+
+	/*
+	 *	投递任务,可以在任意线程调用
+	 *	ctxIdx	策略在工作线程内的序号,-1为不属于具体策略的任务
+	 */
+	void	post(int32_t ctxIdx, HftWorkerTask task);
+
+	/*
+	 *	在工作线程里输出各策略的排队延迟和处理耗时,并重置统计
+	 */
+	void	post_report();
+
+private:
+	/*
+	 *	写入队列,队列满了就让出cpu等待,不丢数据
+	 */
+	template<typename FuncFill>
+	void	push_event(FuncFill fill)
+	{
+		SpinLock lock(_mtx_push);
+		HftWorkerEvent* evt = _queue.alloc();
+		while (evt == NULL)
+		{
+			_full_waits++;
+			std::this_thread::yield();
+			evt = _queue.alloc();
+		}
+
+		fill(*evt);
+		_queue.commit();
+	}
+
+	void	dispatch(HftWorkerEvent& evt);
+
+	void	report(bool bReset);
+
+	void	run_loop();
+
+private:
+	uint32_t		_idx;
+	int32_t			_core;
+
+	typedef struct _CtxStat
+	{
+		HftContextPtr		_ctx;
+		uint64_t			_events;
+		WtLatencyHistogram	_queue_lat;		//从投递到开始处理的延迟
+		WtLatencyHistogram	_proc_lat;		//回调的处理耗时
+
+		_CtxStat() :_events(0) {}
+	} CtxStat;
+	std::vector<CtxStat>	_contexts;
+
+	typedef std::shared_ptr<ITrdNotifySink> TrdSinkPtr;
+	std::vector<TrdSinkPtr>	_trd_sinks;
+
+	WtSpscRing<HftWorkerEvent>	_queue;
+	SpinMutex				_mtx_push;		//行情线程、定时线程和交易线程都会投递,写入端要互斥
+	std::atomic<uint32_t>	_max_depth;
+	std::atomic<uint64_t>	_full_waits;	//队列满了以后等待的次数
+
+	StdThreadPtr		_thrd;
+	std::atomic<bool>	_running;
+};
+
+typedef std::shared_ptr<WtHftWorker> WtHftWorkerPtr;
+
+NS_WTP_END
@@ -16,6 +16,7 @@
 #include "../Includes/WTSVariant.hpp"
 #include "../Includes/IHotMgr.h"
 #include "../Share/decimal.h"
+#include "../Share/TimeUtils.hpp"
 
 #include "../WTSTools/WTSLogger.h"
 
@@ -30,12 +31,19 @@ WtLocalExecuter::WtLocalExecuter(WtExecuterFactory* factory, const char* name, I
 	, _scale(1.0)
 	, _auto_clear(true)
 	, _trader(NULL)
+	, _timer_span(10)
+	, _timer_stopped(false)
 {
+	_code_indexed = true;
 }
 
 
 WtLocalExecuter::~WtLocalExecuter()
 {
+	_timer_stopped = true;
+	if (_timer_thrd)
+		_timer_thrd->join();
+
 	if (_pool)
 		_pool->wait();
 }
@@ -65,6 +73,15 @@ bool WtLocalExecuter::init(WTSVariant* params)
 		_pool.reset(new boost::threadpool::pool(poolsize));
 	}
 
+	/*
+	 *	时间轮的刻度,默认10毫秒,设置为0则不启用定时器,执行单元会退回到在on_tick里轮询
+	 *	定时器线程在第一次有执行单元注册定时器的时候才启动
+	 */
+	if (params->has("timer_span"))
+		_timer_span = params->getUInt32("timer_span");
+	if (_timer_span > 0)
+		_timers.init(TimeUtils::getLocalTimeNow(), _timer_span);
+
 	/*
 	 *	By Wesley @ 2021.12.14
 	 *	从配置文件中读取自动清理的策略
@@ -124,8 +141,8 @@ bool WtLocalExecuter::init(WTSVariant* params)
 		}
 	}
 
-	WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO, "Local executer inited, scale: {}, auto_clear: {}, strict_sync: {}, thread poolsize: {}, code_groups: {}",
-		_scale, _auto_clear, _strict_sync, poolsize, _groups.size());
+	WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO, "Local executer inited, scale: {}, auto_clear: {}, strict_sync: {}, thread poolsize: {}, code_groups: {}, timer_span: {}ms",
+		_scale, _auto_clear, _strict_sync, poolsize, _groups.size(), _timer_span);
 
 	return true;
 }
@@ -158,10 +175,14 @@ ExecuteUnitPtr WtLocalExecuter::getUnit(const char* stdCode, bool bAutoCreate /*
 		{
 			_unit_map[stdCode] = unit;
 			unit->self()->init(this, stdCode, cfg);
+			indexCode(stdCode);
 
 			//如果通道已经就绪，则直接通知执行单元
 			if (_channel_ready)
+			{
+				StdLocker<StdRecurMutex> lock(_mtx_inline);
 				unit->self()->on_channel_ready();
+			}
 		}
 		return unit;
 	}
@@ -271,6 +292,85 @@ uint64_t WtLocalExecuter::getCurTime()
 	//return TimeUtils::makeTime(_stub->get_date(), _stub->get_raw_time() * 100000 + _stub->get_secs());
 }
 
+uint64_t WtLocalExecuter::scheduleTimer(const char* stdCode, uint32_t delay, uint32_t tag)
+{
+	if (_timer_span == 0)
+		return 0;
+
+	SpinLock lock(_mtx_timers);
+	uint32_t codeIdx;
+	auto it = _timer_code_idx.find(stdCode);
+	if (it != _timer_code_idx.end())
+	{
+		codeIdx = it->second;
+	}
+	else
+	{
+		codeIdx = (uint32_t)_timer_codes.size();
+		_timer_codes.emplace_back(stdCode);
+		_timer_code_idx[stdCode] = codeIdx;
+	}
+
+	if (_timer_thrd == NULL)
+	{
+		_timer_thrd.reset(new StdThread([this]() {
+			fireTimers();
+		}));
+		WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO, "Timer thread of executer started, timer span: {}ms", _timer_span);
+	}
+
+	uint64_t deadline = TimeUtils::getLocalTimeNow() + delay;
+	return _timers.schedule(deadline, ((uint64_t)codeIdx << 32) | tag);
+}
+
+bool WtLocalExecuter::cancelTimer(uint64_t timerid)
+{
+	if (_timer_span == 0)
+		return false;
+
+	SpinLock lock(_mtx_timers);
+	return _timers.cancel(timerid);
+}
+
+void WtLocalExecuter::fireTimers()
+{
+	typedef std::pair<const char*, uint32_t> TimerEvent;
+	std::vector<TimerEvent> events;
+	while (!_timer_stopped)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(_timer_span));
+
+		events.clear();
+		{
+			SpinLock lock(_mtx_timers);
+			_timers.advance(TimeUtils::getLocalTimeNow(), [this, &events](uint64_t timerid, uint64_t data) {
+				events.emplace_back(_timer_codes[(uint32_t)(data >> 32)].c_str(), (uint32_t)data);
+			});
+		}
+
+		for (const TimerEvent& evt : events)
+		{
+			ExecuteUnitPtr unit = getUnit(evt.first, false);
+			if (unit == NULL)
+				continue;
+
+			const char* code = evt.first;
+			uint32_t tag = evt.second;
+			if (_pool)
+			{
+				_pool->schedule([unit, code, tag]() {
+					unit->self()->on_timer(code, tag);
+				});
+			}
+			else
+			{
+				StdLocker<StdRecurMutex> lock(_mtx_inline);
+				unit->self()->on_timer(code, tag);
+			}
+		}
+	}
+}
+
 #pragma endregion Context回调接口
 //ExecuteContext
 //////////////////////////////////////////////////////////////////////////
@@ -300,6 +400,7 @@ void WtLocalExecuter::on_position_changed(const char* stdCode, double diffPos)
 		return;
 	}
 
+	StdLocker<StdRecurMutex> lock(_mtx_inline);
 	unit->self()->set_position(stdCode, traderTarget);
 }
 
@@ -345,39 +446,7 @@ void WtLocalExecuter::set_position(const wt_hashmap<std::string, double>& target
 
 	for (auto it = targets.begin(); it != targets.end(); it++)
 	{
-		const char* stdCode = it->first.c_str();
-		double newVol = it->second;
-		ExecuteUnitPtr unit = getUnit(stdCode);
-		if (unit == NULL)
-			continue;
-
-		double oldVol = _target_pos[stdCode];
-		_target_pos[stdCode] = newVol;
-		// 账户的理论持仓要经过修正
-		double traderTarget = round(newVol * _scale);
-
-		if(!decimal::eq(oldVol, newVol))
-		{
-			WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO, "Target position of {} changed: {} -> {} : {} with scale{}", stdCode, oldVol, newVol, traderTarget, _scale);
-		}
-
-		if (_trader && !_trader->checkOrderLimits(stdCode))
-		{
-			WTSLogger::log_dyn("executer", _name.c_str(), LL_WARN, "{} is disabled due to entrust limit control ", stdCode);
-			continue;
-		}
-
-		if (_pool)
-		{
-			std::string code = stdCode;
-			_pool->schedule([unit, code, traderTarget](){
-				unit->self()->set_position(code.c_str(), traderTarget);
-			});
-		}
-		else
-		{
-			unit->self()->set_position(stdCode, traderTarget);
-		}
+		apply_target(it->first.c_str(), it->second);
 	}
 
 	//在原来的目标头寸中，但是不在新的目标头寸中，则需要自动设置为0
@@ -404,6 +473,7 @@ void WtLocalExecuter::set_position(const wt_hashmap<std::string, double>& target
 		}
 		else
 		{
+			StdLocker<StdRecurMutex> lock(_mtx_inline);
 			unit->self()->set_position(code, 0);
 		}
 
@@ -435,12 +505,82 @@ void WtLocalExecuter::set_position(const wt_hashmap<std::string, double>& target
 			}
 			else
 			{
+				StdLocker<StdRecurMutex> lock(_mtx_inline);
 				unit->self()->set_position(stdCode.c_str(), 0);
 			}
 		}
 	}
 }
 
+bool WtLocalExecuter::apply_target(const char* stdCode, double newVol)
+{
+	ExecuteUnitPtr unit = getUnit(stdCode);
+	if (unit == NULL)
+		return true;
+
+	double oldVol = _target_pos[stdCode];
+	_target_pos[stdCode] = newVol;
+	// 账户的理论持仓要经过修正
+	double traderTarget = round(newVol * _scale);
+
+	if(!decimal::eq(oldVol, newVol))
+	{
+		WTSLogger::log_dyn("executer", _name.c_str(), LL_INFO, "Target position of {} changed: {} -> {} : {} with scale{}", stdCode, oldVol, newVol, traderTarget, _scale);
+	}
+
+	if (_trader && !_trader->checkOrderLimits(stdCode))
+	{
+		WTSLogger::log_dyn("executer", _name.c_str(), LL_WARN, "{} is disabled due to entrust limit control ", stdCode);
+		_deferred_codes.insert(stdCode);
+		return false;
+	}
+
+	_deferred_codes.erase(stdCode);
+
+	if (_pool)
+	{
+		std::string code = stdCode;
+		_pool->schedule([unit, code, traderTarget](){
+			unit->self()->set_position(code.c_str(), traderTarget);
+		});
+	}
+	else
+	{
+		StdLocker<StdRecurMutex> lock(_mtx_inline);
+		unit->self()->set_position(stdCode, traderTarget);
+	}
+
+	return true;
+}
+
+bool WtLocalExecuter::set_position_diff(const wt_hashmap<std::string, double>& changes)
+{
+	//严格同步要用全量目标找出不在管理中的通道持仓
+	if (_strict_sync)
+		return false;
+
+	for (auto it = changes.begin(); it != changes.end(); it++)
+	{
+		apply_target(it->first.c_str(), it->second);
+	}
+
+	//上次被流控拦截的合约,目标没变也要重新下达
+	if (!_deferred_codes.empty())
+	{
+		std::vector<std::string> codes;
+		for (const std::string& stdCode : _deferred_codes)
+		{
+			if (changes.find(stdCode) == changes.end())
+				codes.emplace_back(stdCode);
+		}
+
+		for (const std::string& stdCode : codes)
+			apply_target(stdCode.c_str(), _target_pos[stdCode]);
+	}
+
+	return true;
+}
+
 void WtLocalExecuter::on_tick(const char* stdCode, WTSTickData* newTick)
 {
 	ExecuteUnitPtr unit = getUnit(stdCode, false);
@@ -458,6 +598,7 @@ void WtLocalExecuter::on_tick(const char* stdCode, WTSTickData* newTick)
 	}
 	else
 	{
+		StdLocker<StdRecurMutex> lock(_mtx_inline);
 		unit->self()->on_tick(newTick);
 	}
 }
@@ -478,6 +619,7 @@ void WtLocalExecuter::on_trade(uint32_t localid, const char* stdCode, bool isBuy
 	}
 	else
 	{
+		StdLocker<StdRecurMutex> lock(_mtx_inline);
 		unit->self()->on_trade(localid, stdCode, isBuy, vol, price);
 	}
 }
@@ -498,6 +640,7 @@ void WtLocalExecuter::on_order(uint32_t localid, const char* stdCode, bool isBuy
 	}
 	else
 	{
+		StdLocker<StdRecurMutex> lock(_mtx_inline);
 		unit->self()->on_order(localid, stdCode, isBuy, leftQty, price, isCanceled);
 	}
 }
@@ -519,6 +662,7 @@ void WtLocalExecuter::on_entrust(uint32_t localid, const char* stdCode, bool bSu
 	}
 	else
 	{
+		StdLocker<StdRecurMutex> lock(_mtx_inline);
 		unit->self()->on_entrust(localid, stdCode, bSuccess, message);
 	}
 }
@@ -541,6 +685,7 @@ void WtLocalExecuter::on_channel_ready()
 			}
 			else
 			{
+				StdLocker<StdRecurMutex> lock(_mtx_inline);
 				unitPtr->self()->on_channel_ready();
 			}
 		}
@@ -564,6 +709,7 @@ void WtLocalExecuter::on_channel_lost()
 			}
 			else
 			{
+				StdLocker<StdRecurMutex> lock(_mtx_inline);
 				unitPtr->self()->on_channel_lost();
 			}
 		}
@@ -588,6 +734,7 @@ void WtLocalExecuter::on_account(const char* currency, double prebalance, double
 			}
 			else
 			{
+				StdLocker<StdRecurMutex> lock(_mtx_inline);
 				unitPtr->self()->on_account(currency, prebalance, balance, dynbalance, avaliable, closeprofit, dynprofit, margin, fee, deposit, withdraw);
 			}
 		}
@@ -659,6 +806,7 @@ void WtLocalExecuter::on_position(const char* stdCode, bool isLong, double prevo
 		}
 		else
 		{
+			StdLocker<StdRecurMutex> lock(_mtx_inline);
 			unit->self()->clear_all_position(stdCode);
 		}
 	}
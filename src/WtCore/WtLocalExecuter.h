@@ -14,6 +14,11 @@
 #include "../Includes/ExecuteDefs.h"
 #include "../Share/threadpool.hpp"
 #include "../Share/SpinMutex.hpp"
+#include "../Share/StdUtils.hpp"
+#include "../Share/WtTimerWheel.hpp"
+
+#include <atomic>
+#include <deque>
 
 NS_WTP_BEGIN
 class WTSVariant;
@@ -41,6 +46,11 @@ public:
 private:
 	ExecuteUnitPtr	getUnit(const char* code, bool bAutoCreate = true);
 
+	/*
+	 *	定时器线程,推进时间轮并把到期的事件分发给执行单元
+	 */
+	void	fireTimers();
+
 public:
 	//////////////////////////////////////////////////////////////////////////
 	//ExecuteContext
@@ -63,12 +73,19 @@ public:
 
 	virtual uint64_t	getCurTime() override;
 
+	virtual uint64_t	scheduleTimer(const char* stdCode, uint32_t delay, uint32_t tag) override;
+	virtual bool		cancelTimer(uint64_t timerid) override;
+
 public:
 	/*
 	 *	设置目标仓位
 	 */
 	virtual void set_position(const wt_hashmap<std::string, double>& targets) override;
 
+	/*
+	 *	按差量设置目标仓位,严格同步模式下需要全量目标,返回false
+	 */
+	virtual bool set_position_diff(const wt_hashmap<std::string, double>& changes) override;
 
 	/*
 	 *	合约仓位变动
@@ -116,6 +133,12 @@ public:
 	virtual void on_account(const char* currency, double prebalance, double balance, double dynbalance, 
 		double avaliable, double closeprofit, double dynprofit, double margin, double fee, double deposit, double withdraw) override;
 
+private:
+	/*
+	 *	下达单个合约的目标仓位,被流控拦截返回false
+	 */
+	bool	apply_target(const char* stdCode, double newVol);
+
 private:
 	ExecuteUnitMap		_unit_map;
 	TraderAdapter*		_trader;
@@ -146,9 +169,28 @@ private:
 	wt_hashset<std::string> _channel_holds;		//通道持仓
 
 	wt_hashmap<std::string, double> _target_pos;
+	wt_hashset<std::string>	_deferred_codes;	//因为流控没有下达的合约,差量模式下要在下次重新下达
 
 	typedef std::shared_ptr<boost::threadpool::pool> ThreadPoolPtr;
 	ThreadPoolPtr		_pool;
+
+	/*
+	 *	全部执行单元共用一个时间轮,由独立的线程推进
+	 *	定时器的用户数据高32位是合约代码的序号,低32位是执行单元传入的标记
+	 */
+	WtTimerWheel		_timers;
+	SpinMutex			_mtx_timers;
+	uint32_t			_timer_span;		//时间轮刻度,单位毫秒,为0则不启用
+	StdThreadPtr		_timer_thrd;
+	std::atomic<bool>	_timer_stopped;
+	/*
+	 *	没有线程池的时候,定时器线程和行情线程都会直接回调执行单元
+	 *	执行单元的所有回调都在这个锁里执行,保证同一时刻只有一个回调
+	 *	on_tick里下单可能同步回调回来,所以用递归锁
+	 */
+	StdRecurMutex		_mtx_inline;
+	std::deque<std::string>				_timer_codes;		//用deque,扩容的时候已有元素的地址不变
+	wt_hashmap<std::string, uint32_t>	_timer_code_idx;
 };
 
 typedef std::shared_ptr<IExecCommand> ExecCmdPtr;
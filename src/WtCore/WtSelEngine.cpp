@@ -20,9 +20,15 @@
 namespace rj = rapidjson;
 
 #include <atomic>
+#include <chrono>
 
 USING_NS_WTP;
 
+inline int64_t steady_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 inline uint32_t makeTaskId()
 {
 	static std::atomic<uint32_t> _auto_task_id{ 1 };
@@ -33,18 +39,23 @@ inline uint32_t makeTaskId()
 WtSelEngine::WtSelEngine()
 	: _terminated(false)
 	, _cfg(NULL)
+	, _prefetch_bars(false)
 {
 }
 
 
 WtSelEngine::~WtSelEngine()
 {
+	if (_pool)
+		_pool->wait();
 }
 
 void WtSelEngine::on_session_end()
 {
 	if (_evt_listener)
 		_evt_listener->on_session_event(_cur_tdate, false);
+
+	report_schedules(true);
 }
 
 void WtSelEngine::on_session_begin()
@@ -72,15 +83,29 @@ void WtSelEngine::on_bar(const char* stdCode, const char* period, uint32_t times
 	thread_local static char key[64] = { 0 };
 	fmtutil::format_to(key, "{}-{}-{}", stdCode, period, times);
 
-	const SubList& sids = _bar_sub_map[key];
+	//线程池里的策略取K线的时候会写订阅表,拷贝一份出来,回调的时候不持锁
+	SubList sids;
+	{
+		StdUniqueLock lock(_mtx_data);
+		auto sit = _bar_sub_map.find(key);
+		if (sit != _bar_sub_map.end())
+			sids = sit->second;
+	}
+
+	//回调投递到策略的队列里,和on_schedule串行执行,K线和代码都要拷贝一份
+	std::string code = stdCode;
+	std::string strPeriod = period;
+	WTSBarStruct curBar = *newBar;
 	for (auto it = sids.begin(); it != sids.end(); it++)
 	{
 		uint32_t sid = it->first;
-		auto cit = _ctx_map.find(sid);
-		if (cit != _ctx_map.end())
+		auto cit = _sched_states.find(sid);
+		if (cit != _sched_states.end())
 		{
-			SelContextPtr& ctx = (SelContextPtr&)cit->second;
-			ctx->on_bar(stdCode, period, times, newBar);
+			SelContextPtr ctx = cit->second->_ctx;
+			post_callback(cit->second, [ctx, code, strPeriod, times, curBar]() mutable {
+				ctx->on_bar(code.c_str(), strPeriod.c_str(), times, &curBar);
+			});
 		}
 	}
 
@@ -89,9 +114,20 @@ void WtSelEngine::on_bar(const char* stdCode, const char* period, uint32_t times
 
 void WtSelEngine::on_tick(const char* stdCode, WTSTickData* curTick)
 {
-	WtEngine::on_tick(stdCode, curTick);
+	//线程池里的策略会同时读取数据管理器和价格缓存,订阅表也会被策略修改
+	SubList sids;
+	{
+		StdUniqueLock lock(_mtx_data);
+		WtEngine::on_tick(stdCode, curTick);
+		_data_mgr->handle_push_quote(stdCode, curTick);
 
-	_data_mgr->handle_push_quote(stdCode, curTick);
+		if (_ready)
+		{
+			auto sit = _tick_sub_map.find(stdCode);
+			if (sit != _tick_sub_map.end())
+				sids = sit->second;
+		}
+	}
 
 	//如果是真实代码, 则要传递给执行器
 	{
@@ -123,86 +159,99 @@ void WtSelEngine::on_tick(const char* stdCode, WTSTickData* curTick)
 	 *	第二，如果标记为1，即前复权模式，则将代码转成xxxx-，再触发ontick
 	 *	第三，如果标记为2，即后复权模式，则将代码转成xxxx+，再把tick数据做一个修正，再触发ontick
 	 */
-	if(_ready)
+	/*
+	 *	回调投递到策略的队列里,和on_schedule串行执行
+	 *	tick要retain一下,回调执行完了再释放
+	 */
+	if(!sids.empty())
 	{
-		auto sit = _tick_sub_map.find(stdCode);
-		if (sit != _tick_sub_map.end())
+		uint32_t flag = get_adjusting_flag();
+
+		for (auto it = sids.begin(); it != sids.end(); it++)
 		{
-			uint32_t flag = get_adjusting_flag();
+			uint32_t sid = it->first;
 
-			const SubList& sids = sit->second;
-			for (auto it = sids.begin(); it != sids.end(); it++)
-			{
-				uint32_t sid = it->first;
 
+			auto cit = _sched_states.find(sid);
+			if (cit != _sched_states.end())
+			{
+				SelContextPtr ctx = cit->second->_ctx;
+				uint32_t opt = it->second.second;
 
-				auto cit = _ctx_map.find(sid);
-				if (cit != _ctx_map.end())
+				if (opt == 0)
 				{
-					SelContextPtr& ctx = (SelContextPtr&)cit->second;
-					uint32_t opt = it->second.second;
-
-					if (opt == 0)
+					std::string code = stdCode;
+					curTick->retain();
+					post_callback(cit->second, [ctx, code, curTick]() {
+						ctx->on_tick(code.c_str(), curTick);
+						curTick->release();
+					});
+				}
+				else
+				{
+					std::string wCode = stdCode;
+					wCode = fmt::format("{}{}", stdCode, opt == 1 ? SUFFIX_QFQ : SUFFIX_HFQ);
+					if (opt == 1)
 					{
-						ctx->on_tick(stdCode, curTick);
+						curTick->retain();
+						post_callback(cit->second, [ctx, wCode, curTick]() {
+							ctx->on_tick(wCode.c_str(), curTick);
+							curTick->release();
+						});
 					}
-					else
+					else //(opt == 2)
 					{
-						std::string wCode = stdCode;
-						wCode = fmt::format("{}{}", stdCode, opt == 1 ? SUFFIX_QFQ : SUFFIX_HFQ);
-						if (opt == 1)
+						WTSTickData* newTick = WTSTickData::create(curTick->getTickStruct());
+						WTSTickStruct& newTS = newTick->getTickStruct();
+						newTick->setContractInfo(curTick->getContractInfo());
+
+						//这里做一个复权因子的处理
+						double factor = get_exright_factor(stdCode);
+						newTS.open *= factor;
+						newTS.high *= factor;
+						newTS.low *= factor;
+						newTS.price *= factor;
+
+						/*
+						 *	By Wesley @ 2022.08.15
+						 *	这里对tick的复权做一个完善
+						 */
+						if (flag & 1)
 						{
-							ctx->on_tick(wCode.c_str(), curTick);
+							newTS.total_volume /= factor;
+							newTS.volume /= factor;
+						}
+
+						if (flag & 2)
+						{
+							newTS.total_turnover *= factor;
+							newTS.turn_over *= factor;
 						}
-						else //(opt == 2)
+
+						if (flag & 4)
 						{
-							WTSTickData* newTick = WTSTickData::create(curTick->getTickStruct());
-							WTSTickStruct& newTS = newTick->getTickStruct();
-							newTick->setContractInfo(curTick->getContractInfo());
-
-							//这里做一个复权因子的处理
-							double factor = get_exright_factor(stdCode);
-							newTS.open *= factor;
-							newTS.high *= factor;
-							newTS.low *= factor;
-							newTS.price *= factor;
-
-							/*
-							 *	By Wesley @ 2022.08.15
-							 *	这里对tick的复权做一个完善
-							 */
-							if (flag & 1)
-							{
-								newTS.total_volume /= factor;
-								newTS.volume /= factor;
-							}
-
-							if (flag & 2)
-							{
-								newTS.total_turnover *= factor;
-								newTS.turn_over *= factor;
-							}
-
-							if (flag & 4)
-							{
-								newTS.open_interest /= factor;
-								newTS.diff_interest /= factor;
-								newTS.pre_interest /= factor;
-							}
+							newTS.open_interest /= factor;
+							newTS.diff_interest /= factor;
+							newTS.pre_interest /= factor;
+						}
 
+						{
+							StdUniqueLock lock(_mtx_data);
 							_price_map[wCode] = newTS.price;
+						}
 
+						post_callback(cit->second, [ctx, wCode, newTick]() {
 							ctx->on_tick(wCode.c_str(), newTick);
 							newTick->release();
-						}
+						});
 					}
-
 				}
 
-
 			}
 
+
 		}
+
 	}
 }
 
@@ -215,6 +264,7 @@ void WtSelEngine::on_minute_end(uint32_t curDate, uint32_t curTime)
 
 	uint32_t weekDay = TimeUtils::getWeekDay(curDate);
 
+	std::vector<uint32_t> fired;
 	for (auto& v : _tasks)
 	{
 		TaskInfoPtr& tInfo = (TaskInfoPtr&)v.second;
@@ -225,20 +275,15 @@ void WtSelEngine::on_minute_end(uint32_t curDate, uint32_t curTime)
 		if (tInfo->_last_exe_time >= now)
 			continue;
 
-		if (_base_data_mgr->isHoliday(tInfo->_trdtpl, curDate, true))
+		//节假日和上一个交易日按交易日模板缓存,同一分钟触发的任务不再各自往前找
+		const TplDayInfo& dInfo = get_day_info(tInfo->_trdtpl, curDate);
+		if (dInfo._is_holiday)
 			continue;
 
-		//获取上一个交易日的日期
-		uint32_t preTDate = TimeUtils::getNextDate(_cur_date, -1);
-		bool bHasHoliday = false;
-		uint32_t days = 1;
-		while (_base_data_mgr->isHoliday(tInfo->_trdtpl, preTDate, true))
-		{
-			bHasHoliday = true;
-			preTDate = TimeUtils::getNextDate(preTDate, -1);
-			days++;
-		}
-		uint32_t preWD = TimeUtils::getWeekDay(preTDate);
+		uint32_t preTDate = dInfo._pre_tdate;
+		bool bHasHoliday = dInfo._has_holiday;
+		uint32_t days = dInfo._days;
+		uint32_t preWD = dInfo._pre_wday;
 
 		WTSSessionInfo* sInfo = get_session_info(tInfo->_session, false);
 
@@ -308,15 +353,271 @@ void WtSelEngine::on_minute_end(uint32_t curDate, uint32_t curTime)
 		if (bIgnore)
 			continue;
 
-		//TODO: 回调任务
-		SelContextPtr ctx = getContext(tInfo->_id);
-		StdThreadPtr thrd(new StdThread([ctx, curDate, curTime, nextTime](){
-			if (ctx)
-				ctx->on_schedule(curDate, curTime, nextTime);
-		}));	
-
+		//任务表的key是策略id,TaskInfo里的_id是任务自己的编号
+		fired.emplace_back(v.first);
 		tInfo->_last_exe_time = now;
 	}
+
+	if (fired.empty())
+		return;
+
+	if (_prefetch_bars)
+		prefetch_bars(fired);
+
+	for (uint32_t sid : fired)
+	{
+		auto it = _sched_states.find(sid);
+		if (it == _sched_states.end())
+			continue;
+
+		post_schedule(it->second, curDate, curTime, nextTime);
+	}
+}
+
+const TplDayInfo& WtSelEngine::get_day_info(const char* trdtpl, uint32_t curDate)
+{
+	TplDayInfo& dInfo = _day_infos[trdtpl];
+	if (dInfo._cur_date == curDate && dInfo._base_date == _cur_date)
+		return dInfo;
+
+	dInfo._cur_date = curDate;
+	dInfo._base_date = _cur_date;
+	dInfo._is_holiday = _base_data_mgr->isHoliday(trdtpl, curDate, true);
+
+	//获取上一个交易日的日期
+	uint32_t preTDate = TimeUtils::getNextDate(_cur_date, -1);
+	bool bHasHoliday = false;
+	uint32_t days = 1;
+	while (_base_data_mgr->isHoliday(trdtpl, preTDate, true))
+	{
+		bHasHoliday = true;
+		preTDate = TimeUtils::getNextDate(preTDate, -1);
+		days++;
+	}
+
+	dInfo._pre_tdate = preTDate;
+	dInfo._pre_wday = TimeUtils::getWeekDay(preTDate);
+	dInfo._days = days;
+	dInfo._has_holiday = bHasHoliday;
+	return dInfo;
+}
+
+void WtSelEngine::post_schedule(SelSchedStatePtr& state, uint32_t curDate, uint32_t curTime, uint32_t fireTime)
+{
+	SelSchedState::Schedule item;
+	item._date = curDate;
+	item._time = curTime;
+	item._fire_time = fireTime;
+	item._post_ns = steady_ns();
+	post_task(state, item);
+}
+
+void WtSelEngine::post_callback(SelSchedStatePtr& state, SelSchedState::Callback cb)
+{
+	SelSchedState::Schedule item;
+	item._date = 0;
+	item._time = 0;
+	item._fire_time = 0;
+	item._post_ns = 0;
+	item._cb = std::move(cb);
+	post_task(state, item);
+}
+
+void WtSelEngine::post_task(SelSchedStatePtr& state, SelSchedState::Schedule& item)
+{
+	bool isSchedule = !item._cb;
+	bool bSubmit = false;
+	std::size_t pending = 0;
+	{
+		SpinLock lock(state->_mtx);
+		state->_pending.emplace_back(std::move(item));
+		pending = state->_pending.size();
+		if (!state->_running)
+		{
+			state->_running = true;
+			bSubmit = true;
+		}
+	}
+
+	if (!bSubmit)
+	{
+		//行情回调排队是正常的,只有调度排队才需要提示
+		if (isSchedule)
+			WTSLogger::warn("Strategy {} still busy, {} tasks pending", state->_ctx->name(), pending);
+		return;
+	}
+
+	if (_pool)
+	{
+		_pool->schedule([this, state]() {
+			run_schedules(state);
+		});
+	}
+	else
+	{
+		run_schedules(state);
+	}
+}
+
+void WtSelEngine::run_schedules(SelSchedStatePtr state)
+{
+	for (;;)
+	{
+		SelSchedState::Schedule item;
+		{
+			SpinLock lock(state->_mtx);
+			if (state->_pending.empty())
+			{
+				state->_running = false;
+				return;
+			}
+
+			item = std::move(state->_pending.front());
+			state->_pending.pop_front();
+		}
+
+		if (item._cb)
+		{
+			item._cb();
+			continue;
+		}
+
+		int64_t start = steady_ns();
+		state->_queue_lat.record((uint64_t)(start - item._post_ns));
+
+		state->_ctx->on_schedule(item._date, item._time, item._fire_time);
+
+		state->_proc_lat.record((uint64_t)(steady_ns() - start));
+		state->_runs++;
+	}
+}
+
+void WtSelEngine::prefetch_bars(const std::vector<uint32_t>& sids)
+{
+	//多个策略请求同一个品种同一个周期的,只按最大条数读一次
+	wt_hashmap<std::string, BarRequest> requests;
+	{
+		StdUniqueLock lock(_mtx_data);
+		for (uint32_t sid : sids)
+		{
+			auto it = _bar_requests.find(sid);
+			if (it == _bar_requests.end())
+				continue;
+
+			for (auto& v : it->second)
+			{
+				const BarRequest& req = v.second;
+				auto rit = requests.find(v.first);
+				if (rit == requests.end())
+					requests[v.first] = req;
+				else if (rit->second._count < req._count)
+					rit->second._count = req._count;
+			}
+		}
+	}
+
+	if (requests.empty())
+		return;
+
+	int64_t start = steady_ns();
+	for (auto& v : requests)
+	{
+		const BarRequest& req = v.second;
+
+		//直接从数据管理器读取,不走WtEngine::get_kline_slice,不然会登记一个不存在的订阅
+		WTSKlinePeriod kp = KP_DAY;
+		uint32_t times = req._times;
+		if (req._period[0] == 'm')
+		{
+			if (times % 5 == 0)
+			{
+				kp = KP_Minute5;
+				times /= 5;
+			}
+			else
+				kp = KP_Minute1;
+		}
+
+		StdUniqueLock lock(_mtx_data);
+		WTSKlineSlice* kline = _data_mgr->get_kline_slice(req._code.c_str(), kp, times, req._count);
+		if (kline)
+			kline->release();
+	}
+
+	WTSLogger::debug("{} bar requests of {} strategies prefetched in {} us", requests.size(), sids.size(), (steady_ns() - start) / 1000);
+}
+
+WTSKlineSlice* WtSelEngine::get_kline_slice(uint32_t sid, const char* stdCode, const char* period, uint32_t count, uint32_t times /* = 1 */, uint64_t etime /* = 0 */)
+{
+	StdUniqueLock lock(_mtx_data);
+	if (_prefetch_bars && etime == 0)
+	{
+		thread_local static char key[64] = { 0 };
+		fmtutil::format_to(key, "{}-{}-{}", stdCode, period, times);
+
+		BarRequest& req = _bar_requests[sid][key];
+		if (req._code.empty())
+		{
+			req._code = stdCode;
+			req._period = period;
+			req._times = times;
+			req._count = count;
+		}
+		else if (req._count < count)
+		{
+			req._count = count;
+		}
+	}
+
+	return WtEngine::get_kline_slice(sid, stdCode, period, count, times, etime);
+}
+
+WTSTickSlice* WtSelEngine::get_tick_slice(uint32_t sid, const char* stdCode, uint32_t count)
+{
+	StdUniqueLock lock(_mtx_data);
+	return WtEngine::get_tick_slice(sid, stdCode, count);
+}
+
+WTSTickData* WtSelEngine::get_last_tick(uint32_t sid, const char* stdCode)
+{
+	StdUniqueLock lock(_mtx_data);
+	return WtEngine::get_last_tick(sid, stdCode);
+}
+
+double WtSelEngine::get_cur_price(const char* stdCode)
+{
+	StdUniqueLock lock(_mtx_data);
+	return WtEngine::get_cur_price(stdCode);
+}
+
+void WtSelEngine::sub_tick(uint32_t sid, const char* stdCode)
+{
+	StdUniqueLock lock(_mtx_data);
+	WtEngine::sub_tick(sid, stdCode);
+}
+
+void WtSelEngine::report_schedules(bool bReset)
+{
+	for (auto& v : _sched_states)
+	{
+		SelSchedStatePtr& state = (SelSchedStatePtr&)v.second;
+		if (state->_runs == 0)
+			continue;
+
+		WTSLogger::info("Strategy {}: {} schedules, queue latency(ns): {}", state->_ctx->name(), state->_runs, state->_queue_lat.summary());
+		WTSLogger::info("Strategy {}: schedule process latency(ns): {}", state->_ctx->name(), state->_proc_lat.summary());
+
+		if (bReset)
+		{
+			SpinLock lock(state->_mtx);
+			if (state->_running)
+				continue;
+
+			state->_runs = 0;
+			state->_queue_lat.reset();
+			state->_proc_lat.reset();
+		}
+	}
 }
 
 void WtSelEngine::run()
@@ -368,6 +669,18 @@ void WtSelEngine::init(WTSVariant* cfg, IBaseDataMgr* bdMgr, WtDtMgr* dataMgr, I
 
 	_cfg = cfg;
 	_cfg->retain();
+
+	/*
+	 *	调度任务放到固定大小的线程池里执行,线程数就是并发上限
+	 *	不配置的话默认4个线程
+	 */
+	uint32_t poolsize = cfg->getUInt32("poolsize");
+	if (poolsize == 0)
+		poolsize = 4;
+	_pool.reset(new boost::threadpool::pool(poolsize));
+
+	_prefetch_bars = cfg->getBoolean("prefetch_bars");
+	WTSLogger::info("Engine task poolsize is {}, bars prefetching {}", poolsize, _prefetch_bars ? "enabled" : "disabled");
 }
 
 void WtSelEngine::addContext(SelContextPtr ctx, uint32_t date, uint32_t time, TaskPeriodType period, bool bStrict /* = true */, const char* trdtpl /* = "CHINA" */, const char* sessionID/* ="TRADING" */)
@@ -396,6 +709,10 @@ void WtSelEngine::addContext(SelContextPtr ctx, uint32_t date, uint32_t time, Ta
 
 	uint32_t sid = ctx->id();
 	_ctx_map[sid] = ctx;
+
+	SelSchedStatePtr state(new SelSchedState);
+	state->_ctx = ctx;
+	_sched_states[sid] = state;
 }
 
 SelContextPtr WtSelEngine::getContext(uint32_t id)
@@ -4,8 +4,12 @@
 
 #include "../Includes/FasterDefs.h"
 #include "../Includes/ISelStraCtx.h"
+#include "../Share/threadpool.hpp"
+#include "../Share/WtLatencyHistogram.hpp"
 
 #include <memory>
+#include <deque>
+#include <functional>
 
 NS_WTP_BEGIN
 
@@ -39,6 +43,52 @@ typedef std::shared_ptr<TaskInfo> TaskInfoPtr;
 typedef std::shared_ptr<ISelStraCtx> SelContextPtr;
 class WtSelRtTicker;
 
+/*
+ *	策略的调度状态
+ *	同一个策略的调度和行情回调在线程池里串行执行,上一个还没跑完,新的就排队等待
+ */
+typedef struct _SelSchedState
+{
+	typedef std::function<void()> Callback;
+
+	typedef struct _Schedule
+	{
+		uint32_t	_date;
+		uint32_t	_time;
+		uint32_t	_fire_time;
+		int64_t		_post_ns;	//投递时间,用于统计排队延迟
+		Callback	_cb;		//行情回调,为空的时候是调度
+	} Schedule;
+
+	SelContextPtr		_ctx;
+	SpinMutex			_mtx;
+	std::deque<Schedule>	_pending;
+	bool				_running;
+
+	uint64_t			_runs;
+	WtLatencyHistogram	_queue_lat;		//从投递到开始执行的延迟
+	WtLatencyHistogram	_proc_lat;		//on_schedule的耗时
+
+	_SelSchedState() :_running(false), _runs(0) {}
+} SelSchedState;
+typedef std::shared_ptr<SelSchedState> SelSchedStatePtr;
+
+/*
+ *	交易日模板在某一天的节假日信息,同一分钟内的任务共用
+ */
+typedef struct _TplDayInfo
+{
+	uint32_t	_cur_date;		//计算时的自然日
+	uint32_t	_base_date;		//计算时的_cur_date
+	bool		_is_holiday;	//当天是否是节假日
+	uint32_t	_pre_tdate;		//上一个交易日
+	uint32_t	_pre_wday;		//上一个交易日的星期
+	uint32_t	_days;			//和上一个交易日相隔的天数
+	bool		_has_holiday;	//和上一个交易日之间是否有节假日
+
+	_TplDayInfo() :_cur_date(0), _base_date(0), _is_holiday(false), _pre_tdate(0), _pre_wday(0), _days(0), _has_holiday(false) {}
+} TplDayInfo;
+
 
 class WtSelEngine : public WtEngine, public IExecuterStub
 {
@@ -65,6 +115,19 @@ public:
 
 	virtual void on_session_end() override;
 
+	virtual WTSKlineSlice* get_kline_slice(uint32_t sid, const char* stdCode, const char* period, uint32_t count, uint32_t times = 1, uint64_t etime = 0) override;
+
+	/*
+	 *	下面几个接口在线程池里被策略调用,和行情推送共用数据锁
+	 */
+	WTSTickSlice*	get_tick_slice(uint32_t sid, const char* stdCode, uint32_t count);
+
+	WTSTickData*	get_last_tick(uint32_t sid, const char* stdCode);
+
+	double	get_cur_price(const char* stdCode);
+
+	void	sub_tick(uint32_t sid, const char* stdCode);
+
 	///////////////////////////////////////////////////////////////////////////
 	//IExecuterStub 接口
 	virtual uint64_t get_real_time() override;
@@ -89,6 +152,27 @@ public:
 
 	void	handle_pos_change(const char* straName, const char* stdCode, double diffQty);
 
+private:
+	const TplDayInfo&	get_day_info(const char* trdtpl, uint32_t curDate);
+
+	void	post_schedule(SelSchedStatePtr& state, uint32_t curDate, uint32_t curTime, uint32_t fireTime);
+
+	/*
+	 *	把on_tick/on_bar投递到策略的队列里,和on_schedule串行执行
+	 */
+	void	post_callback(SelSchedStatePtr& state, SelSchedState::Callback cb);
+
+	void	post_task(SelSchedStatePtr& state, SelSchedState::Schedule& item);
+
+	void	run_schedules(SelSchedStatePtr state);
+
+	/*
+	 *	预读策略上次请求过的K线,让同一分钟触发的策略不用各自从磁盘加载
+	 */
+	void	prefetch_bars(const std::vector<uint32_t>& sids);
+
+	void	report_schedules(bool bReset);
+
 private:
 	wt_hashmap<uint32_t, TaskInfoPtr>	_tasks;
 
@@ -101,6 +185,27 @@ private:
 
 	WtSelRtTicker*	_tm_ticker;
 	WTSVariant*		_cfg;
+
+	typedef std::shared_ptr<boost::threadpool::pool> ThreadPoolPtr;
+	ThreadPoolPtr		_pool;
+	wt_hashmap<uint32_t, SelSchedStatePtr>	_sched_states;
+
+	wt_hashmap<std::string, TplDayInfo>	_day_infos;
+
+	//策略请求过的K线,key为策略id,用于预读
+	typedef struct _BarRequest
+	{
+		std::string	_code;
+		std::string	_period;
+		uint32_t	_count;
+		uint32_t	_times;
+	} BarRequest;
+	typedef wt_hashmap<std::string, BarRequest> BarRequests;
+	wt_hashmap<uint32_t, BarRequests>	_bar_requests;
+	bool			_prefetch_bars;
+
+	//策略在线程池里并发读取K线,数据管理器不是线程安全的,要加锁
+	StdUniqueMutex	_mtx_data;
 };
 
 NS_WTP_END
@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "../Includes/WTSStruct.h"
+#include "../Share/WtCompactData.hpp"
 
 USING_NS_WTP;
 
@@ -32,6 +33,7 @@ typedef enum tagBlockType
 #define BLOCK_VERSION_CMP		0x02	//老结构体压缩
 #define BLOCK_VERSION_RAW_V2	0x03	//新结构体未压缩
 #define BLOCK_VERSION_CMP_V2	0x04	//新结构体压缩
+#define BLOCK_VERSION_CMP_V3	0x05	//定点紧凑结构体压缩,数据区是CompactBlockInfo加紧凑结构体,见WtCompactData.hpp
 
 typedef struct _BlockHeader
 {
@@ -44,7 +46,11 @@ typedef struct _BlockHeader
 	}
 
 	inline bool is_compressed() const {
-		return (_version == BLOCK_VERSION_CMP || _version == BLOCK_VERSION_CMP_V2);
+		return (_version == BLOCK_VERSION_CMP || _version == BLOCK_VERSION_CMP_V2 || _version == BLOCK_VERSION_CMP_V3);
+	}
+
+	inline bool is_compact() const {
+		return (_version == BLOCK_VERSION_CMP_V3);
 	}
 } BlockHeader;
 
@@ -61,7 +67,11 @@ typedef struct _BlockHeaderV2
 	}
 
 	inline bool is_compressed() const {
-		return (_version == BLOCK_VERSION_CMP || _version == BLOCK_VERSION_CMP_V2);
+		return (_version == BLOCK_VERSION_CMP || _version == BLOCK_VERSION_CMP_V2 || _version == BLOCK_VERSION_CMP_V3);
+	}
+
+	inline bool is_compact() const {
+		return (_version == BLOCK_VERSION_CMP_V3);
 	}
 } BlockHeaderV2;
 
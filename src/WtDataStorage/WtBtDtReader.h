@@ -41,6 +41,9 @@ public:
 	virtual bool read_raw_order_queues(const char* exchg, const char* code, uint32_t uDate, std::string& buffer) override;
 	virtual bool read_raw_transactions(const char* exchg, const char* code, uint32_t uDate, std::string& buffer) override;
 
+	//每次读取都是直接读文件,没有共享的状态,可以多个线程同时读
+	virtual bool is_reentrant() override { return true; }
+
 private:
 	std::string		_base_dir;
 };
@@ -90,6 +90,17 @@ bool proc_block_data(std::string& content, bool isBar, bool bKeepHead /* = true
 		}
 	}
 
+	//定点紧凑格式,解压以后还原成标准结构体
+	if (header->is_compact())
+	{
+		std::string rawData;
+		bool bSucc = isBar ? WtCompactCodec::decode_bars(buffer.data(), buffer.size(), rawData) : WtCompactCodec::decode_ticks(buffer.data(), buffer.size(), rawData);
+		if (!bSucc)
+			return false;
+
+		buffer.swap(rawData);
+	}
+
 	if (bOldVer)
 	{
 		if (isBar)
@@ -90,6 +90,7 @@ WtDataWriter::WtDataWriter()
 	, _disable_trans(false)
 	, _disable_tick(false)
 	, _disable_his(false)
+	, _compact_his(false)
 	, _skip_notrade_tick(false)
 	, _skip_notrade_bar(false)
 {
@@ -147,6 +148,25 @@ bool WtDataWriter::init(WTSVariant* params, IDataWriterSink* sink)
 
 	_min_price_mode = params->getUInt32("minbar_price_mode");
 
+	//历史数据用定点紧凑格式存储,老版本的程序读不了,升级完所有读取的程序以后再打开
+	_compact_his = params->getBoolean("compact");
+
+	if (_save_tick_log)
+	{
+		//logcap每个流水文件预分配的tick条数,logsync刷盘间隔(毫秒),logqueue待写入队列的长度
+		//logdrop队列满了是否直接丢弃,默认不丢,等待后台线程写入
+		uint32_t logCap = params->has("logcap") ? params->getUInt32("logcap") : 256 * 1024;
+		uint32_t logSync = params->has("logsync") ? params->getUInt32("logsync") : 1000;
+		uint32_t logQueue = params->has("logqueue") ? params->getUInt32("logqueue") : 64 * 1024;
+		bool logDrop = params->getBoolean("logdrop");
+		std::string path = _base_dir + "rt/ticks/";
+		_tick_journal.reset(new WtTickJournal(path.c_str(), logCap, logSync, logQueue, logDrop));
+		_tick_journal->set_logger([this](WTSLogLevel ll, const std::string& msg) {
+			_sink->outputLog(ll, msg.c_str());
+		});
+		_tick_journal->start();
+	}
+
 	{
 		std::string filename = _base_dir + MARKER_FILE;
 		IniHelper iniHelper;
@@ -164,9 +184,9 @@ bool WtDataWriter::init(WTSVariant* params, IDataWriterSink* sink)
 	_proc_chk.reset(new StdThread(boost::bind(&WtDataWriter::check_loop, this)));
 
 	pipe_writer_log(sink, LL_INFO, "WtDataWriter initialized, root dir: {}, save_csv_tick: {}, async_mode: {}, log_group_size: {}, disable_history: {}, "
-		"disable_tick: {}, disable_min1: {}, disable_min5: {}, disable_day: {}, disable_trans: {}, disable_ordque: {}, disable_orders: {}, min_price_mode: {}", 
+		"disable_tick: {}, disable_min1: {}, disable_min5: {}, disable_day: {}, disable_trans: {}, disable_ordque: {}, disable_orders: {}, min_price_mode: {}, compact_his: {}", 
 		_base_dir, _save_tick_log, _async_proc, _log_group_size, _disable_his, _disable_tick, 
-		_disable_min1, _disable_min5, _disable_day, _disable_trans, _disable_ordque, _disable_orddtl, _min_price_mode);
+		_disable_min1, _disable_min5, _disable_day, _disable_trans, _disable_ordque, _disable_orddtl, _min_price_mode, _compact_his);
 	return true;
 }
 
@@ -179,6 +199,12 @@ void WtDataWriter::release()
 		_proc_thrd->join();
 	}
 
+	if (_tick_journal)
+	{
+		_tick_journal->stop();
+		_tick_journal.reset();
+	}
+
 	for(auto& v : _rt_ticks_blocks)
 	{
 		delete v.second;
@@ -644,21 +670,10 @@ void WtDataWriter::pipeToTicks(WTSContractInfo* ct, WTSTickData* curTick)
 	memcpy(&blk->_ticks[blk->_size], &curTick->getTickStruct(), sizeof(WTSTickStruct));
 	blk->_size += 1;
 
-	if(_save_tick_log && pBlockPair->_fstream)
-	{
-		*(pBlockPair->_fstream) << curTick->code() << ","
-			<< curTick->tradingdate() << ","
-			<< curTick->actiondate() << ","
-			<< curTick->actiontime() << ","
-			<< TimeUtils::getLocalTime(false) << ","
-			<< curTick->price() << ","
-			<< curTick->totalvolume() << ","
-			<< curTick->openinterest() << ","
-			<< (uint64_t)curTick->totalturnover() << ","
-			<< curTick->volume() << ","
-			<< curTick->additional() << ","
-			<< (uint64_t)curTick->turnover() << std::endl;
-	}
+	//只是放到队列里,格式化和写文件都在后台线程,需要csv的时候用WtDtHelper的trans_tick_journal转换
+	//队列满了默认会等待,配置了logdrop才会丢弃,丢弃的条数由流水日志的后台线程汇总报告
+	if(_tick_journal)
+		_tick_journal->append(curTick->getTickStruct());
 }
 
 WtDataWriter::OrdQueBlockPair* WtDataWriter::getOrdQueBlock(WTSContractInfo* ct, uint32_t curDate, bool bAutoCreate /* = true */)
@@ -965,14 +980,6 @@ WtDataWriter::TickBlockPair* WtDataWriter::getTickBlock(WTSContractInfo* ct, uin
 		if (bAutoCreate)
 			BoostFile::create_directories(path.c_str());
 
-		if(_save_tick_log)
-		{
-			std::stringstream fname;
-			fname << path << ct->getCode() << "." << curDate << ".csv";
-			pBlock->_fstream.reset(new std::ofstream());
-			pBlock->_fstream->open(fname.str().c_str(), std::ios_base::app);
-		}
-
 		path += ct->getCode();
 		path += ".dmb";
 
@@ -1818,6 +1825,20 @@ bool WtDataWriter::proc_block_data(const char* tag, std::string& content, bool i
 		}
 	}
 
+	//定点紧凑格式,解压以后还原成标准结构体
+	if (header->is_compact())
+	{
+		std::string rawData;
+		bool bSucc = isBar ? WtCompactCodec::decode_bars(buffer.data(), buffer.size(), rawData) : WtCompactCodec::decode_ticks(buffer.data(), buffer.size(), rawData);
+		if (!bSucc)
+		{
+			pipe_writer_log(_sink, LL_ERROR, "Decoding compact {} data of {} failed", isBar ? "bar" : "tick", tag);
+			return false;
+		}
+
+		buffer.swap(rawData);
+	}
+
 	if (bOldVer)
 	{
 		if (isBar)
@@ -1866,6 +1887,27 @@ bool WtDataWriter::proc_block_data(const char* tag, std::string& content, bool i
 	return true;
 }
 
+std::string WtDataWriter::pack_his_data(WTSContractInfo* ct, const void* data, std::size_t len, bool isBar, uint16_t& version)
+{
+	if (_compact_his && ct != NULL && ct->getCommInfo() != NULL)
+	{
+		uint32_t precision = WtCompactCodec::precision_of(ct->getCommInfo()->getPriceTick());
+		std::string compact;
+		bool bSucc = isBar ? WtCompactCodec::encode_bars((const WTSBarStruct*)data, (uint32_t)(len / sizeof(WTSBarStruct)), precision, compact)
+			: WtCompactCodec::encode_ticks((const WTSTickStruct*)data, (uint32_t)(len / sizeof(WTSTickStruct)), precision, compact);
+		if (bSucc)
+		{
+			version = BLOCK_VERSION_CMP_V3;
+			return WTSCmpHelper::compress_data(compact.data(), compact.size());
+		}
+
+		pipe_writer_log(_sink, LL_INFO, "{} data of {} cannot be stored compactly, normal format used", isBar ? "Bar" : "Tick", ct->getFullCode());
+	}
+
+	version = BLOCK_VERSION_CMP_V2;
+	return WTSCmpHelper::compress_data(data, len);
+}
+
 bool WtDataWriter::dump_day_data(WTSContractInfo* ct, WTSBarStruct* newBar)
 {
 	std::stringstream ss;
@@ -1927,11 +1969,12 @@ bool WtDataWriter::dump_day_data(WTSContractInfo* ct, WTSBarStruct* newBar)
 			bool bNeedCompress = bCompressed || (barcnt > 100);
 			if (bNeedCompress)
 			{
-				std::string cmpData = WTSCmpHelper::compress_data(content.data(), content.size());
+				uint16_t version = BLOCK_VERSION_CMP_V2;
+				std::string cmpData = pack_his_data(ct, content.data(), content.size(), true, version);
 				BlockHeaderV2 header;
 				strcpy(header._blk_flag, BLK_FLAG);
 				header._type = BT_HIS_Day;
-				header._version = BLOCK_VERSION_CMP_V2;
+				header._version = version;
 				header._size = cmpData.size();
 
 				f.truncate_file(0);
@@ -2041,7 +2084,8 @@ uint32_t WtDataWriter::dump_bars_to_file(WTSContractInfo* ct)
 				//追加新的数据
 				buffer.append((const char*)kBlkPair->_block->_bars, sizeof(WTSBarStruct)*size);
 
-				std::string cmpData = WTSCmpHelper::compress_data(buffer.data(), buffer.size());
+				uint16_t version = BLOCK_VERSION_CMP_V2;
+				std::string cmpData = pack_his_data(ct, buffer.data(), buffer.size(), true, version);
 
 				f.truncate_file(0);
 				f.seek_to_begin(0);
@@ -2049,7 +2093,7 @@ uint32_t WtDataWriter::dump_bars_to_file(WTSContractInfo* ct)
 				BlockHeaderV2 header;
 				strcpy(header._blk_flag, BLK_FLAG);
 				header._type = BT_HIS_Minute1;
-				header._version = BLOCK_VERSION_CMP_V2;
+				header._version = version;
 				header._size = cmpData.size();
 				f.write_file(&header, sizeof(header));
 				f.write_file(cmpData);
@@ -2107,7 +2151,8 @@ uint32_t WtDataWriter::dump_bars_to_file(WTSContractInfo* ct)
 
 				buffer.append((const char*)kBlkPair->_block->_bars, sizeof(WTSBarStruct)*size);
 
-				std::string cmpData = WTSCmpHelper::compress_data(buffer.data(), buffer.size());
+				uint16_t version = BLOCK_VERSION_CMP_V2;
+				std::string cmpData = pack_his_data(ct, buffer.data(), buffer.size(), true, version);
 
 				f.truncate_file(0);
 				f.seek_to_begin(0);
@@ -2115,7 +2160,7 @@ uint32_t WtDataWriter::dump_bars_to_file(WTSContractInfo* ct)
 				BlockHeaderV2 header;
 				strcpy(header._blk_flag, BLK_FLAG);
 				header._type = BT_HIS_Minute5;
-				header._version = BLOCK_VERSION_CMP_V2;
+				header._version = version;
 				header._size = cmpData.size();
 				f.write_file(&header, sizeof(header));
 				f.write_file(cmpData);
@@ -2345,9 +2390,6 @@ void WtDataWriter::proc_loop()
 				TickBlockPair *tBlkPair = getTickBlock(ct, uDate, false);
 				if (tBlkPair != NULL)
 				{
-					if (tBlkPair->_fstream)
-						tBlkPair->_fstream.reset();
-
 					if (tBlkPair->_block->_size > 0)
 					{
 						pipe_writer_log(_sink, LL_INFO, "Transfering tick data of {}...", fullcode.c_str());
@@ -2382,12 +2424,13 @@ void WtDataWriter::proc_loop()
 							if (f.create_new_file(filename.c_str()))
 							{
 								//先压缩数据
-								std::string cmp_data = WTSCmpHelper::compress_data(tBlkPair->_block->_ticks, sizeof(WTSTickStruct)*tBlkPair->_block->_size);
+								uint16_t version = BLOCK_VERSION_CMP_V2;
+								std::string cmp_data = pack_his_data(ct, tBlkPair->_block->_ticks, sizeof(WTSTickStruct)*tBlkPair->_block->_size, false, version);
 
 								BlockHeaderV2 header;
 								strcpy(header._blk_flag, BLK_FLAG);
 								header._type = BT_HIS_Ticks;
-								header._version = BLOCK_VERSION_CMP_V2;
+								header._version = version;
 								header._size = cmp_data.size();
 								f.write_file(&header, sizeof(header));
 
@@ -6,6 +6,7 @@
 #include "../Share/StdUtils.hpp"
 #include "../Share/BoostMappingFile.hpp"
 #include "../Share/SpinMutex.hpp"
+#include "../Share/WtTickJournal.hpp"
 
 #include <queue>
 #include <map>
@@ -42,6 +43,12 @@ private:
 
 	bool	proc_block_data(const char* tag, std::string& content, bool isBar, bool bKeepHead = true);
 
+	/*
+	 *	压缩要转储的历史K线或者tick
+	 *	开启了紧凑存储并且数据能无损还原的,用定点紧凑格式,否则用原来的格式,version返回实际的块版本
+	 */
+	std::string	pack_his_data(WTSContractInfo* ct, const void* data, std::size_t len, bool isBar, uint16_t& version);
+
 	void	procTick(WTSTickData* curTick, uint32_t procFlag);
 	void	procQueue(WTSOrdQueData* curOrdQue);
 	void	procOrder(WTSOrdDtlData* curOrdDetail);
@@ -92,13 +99,10 @@ private:
 		SpinMutex		_mutex;
 		uint64_t		_lasttime;
 
-		std::shared_ptr< std::ofstream>	_fstream;
-
 		_TickBlockPair()
 		{
 			_block = NULL;
 			_file = NULL;
-			_fstream = NULL;
 			_lasttime = 0;
 		}
 	} TickBlockPair;
@@ -198,6 +202,8 @@ private:
 	bool			_terminated;
 
 	bool			_save_tick_log;
+	//tick日志改成流水文件,写入线程只入队,后台线程批量写到内存映射文件
+	std::shared_ptr<WtTickJournal>	_tick_journal;
 	bool			_skip_notrade_tick;
 	bool			_skip_notrade_bar;
 	bool			_disable_his;
@@ -211,6 +217,8 @@ private:
 	bool			_disable_ordque;
 	bool			_disable_orddtl;
 
+	bool			_compact_his;	//历史K线和tick用定点紧凑格式存储
+
 	/*
 	 *	by Wesley @ 2023.05.04
 	 *	分钟线价格模式，0-常规模式，1-将买卖价也记录下来，这个设计时只针对期权这种不活跃的品种
@@ -1374,47 +1374,19 @@ bool WtRdmDtReader::cacheHisBarsFromFile(void* codeInfo, const std::string& key,
 				break;
 			}
 
-			HisKlineBlock* kBlock = (HisKlineBlock*)content.c_str();
+			//统一走proc_block_data,压缩、老版本和定点紧凑格式都在里面处理
 			uint32_t barcnt = 0;
-			std::string buffer;
-			bool bOldVer = kBlock->is_old_version();
-			if (kBlock->_version == BLOCK_VERSION_CMP)
-			{
-				if (content.size() < sizeof(HisKlineBlockV2))
-				{
-					pipe_rdmreader_log(_sink, LL_ERROR, "Sizechecking of his kline data file {} failed", filename.c_str());
-					break;
-				}
-
-				HisKlineBlockV2* kBlockV2 = (HisKlineBlockV2*)content.c_str();
-				if (kBlockV2->_size == 0)
-					break;
-
-				buffer = WTSCmpHelper::uncompress_data(kBlockV2->_data, (std::size_t)kBlockV2->_size);
-			}
-			else
+			if (!proc_block_data(content, true, false))
 			{
-				content.erase(0, BLOCK_HEADER_SIZE);
-				buffer.swap(content);
+				pipe_rdmreader_log(_sink, LL_ERROR, "Processing his kline data file {} failed", filename.c_str());
+				break;
 			}
 
+			std::string buffer;
+			buffer.swap(content);
 			if(buffer.empty())
 				break;
 
-			if(bOldVer)
-			{
-				std::string bufV2;
-				uint32_t barcnt = buffer.size() / sizeof(WTSBarStructOld);
-				bufV2.resize(barcnt * sizeof(WTSBarStruct));
-				WTSBarStruct* newBar = (WTSBarStruct*)bufV2.data();
-				WTSBarStructOld* oldBar = (WTSBarStructOld*)buffer.data();
-				for (uint32_t idx = 0; idx < barcnt; idx++)
-				{
-					newBar[idx] = oldBar[idx];
-				}
-				buffer.swap(bufV2);
-			}
-
 			barcnt = buffer.size() / sizeof(WTSBarStruct);
 
 			hotAy = new std::vector<WTSBarStruct>();
@@ -123,7 +123,7 @@ bool WtBtDtReaderAD::read_raw_ticks(const char* exchg, const char* code, uint32_
 
 WtBtDtReaderAD::WtLMDBPtr WtBtDtReaderAD::get_k_db(const char* exchg, WTSKlinePeriod period)
 {
-	WtLMDBMap* the_map = NULL;
+	WtLMDBPool* the_map = NULL;
 	std::string subdir;
 	if (period == KP_Minute1)
 	{
@@ -143,51 +143,29 @@ WtBtDtReaderAD::WtLMDBPtr WtBtDtReaderAD::get_k_db(const char* exchg, WTSKlinePe
 	else
 		return std::move(WtLMDBPtr());
 
-	auto it = the_map->find(exchg);
-	if (it != the_map->end())
-		return std::move(it->second);
-
-	WtLMDBPtr dbPtr(new WtLMDB(true));
 	std::string path = StrUtil::printf("%s%s/%s/", _base_dir.c_str(), subdir.c_str(), exchg);
-	if (!StdFile::exists(path.c_str()))
-		return std::move(WtLMDBPtr());
-
-	if (!dbPtr->open(path.c_str()))
-	{
-		pipe_btreader_log(_sink, LL_ERROR, "Opening {} db if {} failed: {}", subdir, exchg, dbPtr->errmsg());
-		return std::move(WtLMDBPtr());
-	}
-	else
-	{
+	std::string errmsg;
+	bool bOpened = false;
+	WtLMDBPtr dbPtr = the_map->get(exchg, path, errmsg, bOpened);
+	if (!errmsg.empty())
+		pipe_btreader_log(_sink, LL_ERROR, "Opening {} db if {} failed: {}", subdir, exchg, errmsg);
+	else if (bOpened)
 		pipe_btreader_log(_sink, LL_DEBUG, "{} db of {} opened", subdir, exchg);
-	}
 
-	(*the_map)[exchg] = dbPtr;
-	return std::move(dbPtr);
+	return dbPtr;
 }
 
 WtBtDtReaderAD::WtLMDBPtr WtBtDtReaderAD::get_t_db(const char* exchg, const char* code)
 {
 	std::string key = StrUtil::printf("%s.%s", exchg, code);
-	auto it = _tick_dbs.find(key);
-	if (it != _tick_dbs.end())
-		return std::move(it->second);
-
-	WtLMDBPtr dbPtr(new WtLMDB(true));
 	std::string path = StrUtil::printf("%sticks/%s/%s", _base_dir.c_str(), exchg, code);
-	if (!StdFile::exists(path.c_str()))
-		return std::move(WtLMDBPtr());
-
-	if (!dbPtr->open(path.c_str()))
-	{
-		pipe_btreader_log(_sink, LL_ERROR, "Opening tick db of {}.{} failed: {}", exchg, code, dbPtr->errmsg());
-		return std::move(WtLMDBPtr());
-	}
-	else
-	{
+	std::string errmsg;
+	bool bOpened = false;
+	WtLMDBPtr dbPtr = _tick_dbs.get(key, path, errmsg, bOpened);
+	if (!errmsg.empty())
+		pipe_btreader_log(_sink, LL_ERROR, "Opening tick db of {}.{} failed: {}", exchg, code, errmsg);
+	else if (bOpened)
 		pipe_btreader_log(_sink, LL_DEBUG, "Tick db of {}.{} opened", exchg, code);
-	}
 
-	_tick_dbs[exchg] = dbPtr;
-	return std::move(dbPtr);
+	return dbPtr;
 }
\ No newline at end of file
@@ -4,7 +4,7 @@
 #include "../Includes/FasterDefs.h"
 #include "../Includes/IBtDtReader.h"
 
-#include "../WTSUtils/WtLMDB.hpp"
+#include "../WTSUtils/WtLMDBPool.hpp"
 
 NS_WTP_BEGIN
 
@@ -31,16 +31,17 @@ private:
 	 *	这里放LMDB的数据库定义
 	 *	K线数据，按照每个市场m1/m5/d1三个周期一共三个数据库，路径如./m1/CFFEX
 	 *	Tick数据，每个合约一个数据库，路径如./ticks/CFFEX/IF2101
+	 *	回测的预读线程也会调用读取接口，缓存用WtLMDBPool，查找和打开都是加锁的
+	 *	WtLMDB的错误码是共享的，读取接口不可重入，由HisDataMgr加锁排队
 	 */
-	typedef std::shared_ptr<WtLMDB> WtLMDBPtr;
-	typedef wt_hashmap<std::string, WtLMDBPtr> WtLMDBMap;
+	typedef WtLMDBPool::WtLMDBPtr WtLMDBPtr;
 
-	WtLMDBMap	_exchg_m1_dbs;
-	WtLMDBMap	_exchg_m5_dbs;
-	WtLMDBMap	_exchg_d1_dbs;
+	WtLMDBPool	_exchg_m1_dbs;
+	WtLMDBPool	_exchg_m5_dbs;
+	WtLMDBPool	_exchg_d1_dbs;
 
 	//用exchg.code作为key，如BINANCE.BTCUSDT
-	WtLMDBMap	_tick_dbs;
+	WtLMDBPool	_tick_dbs;
 
 	WtLMDBPtr	get_k_db(const char* exchg, WTSKlinePeriod period);
 
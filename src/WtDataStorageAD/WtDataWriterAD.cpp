@@ -7,6 +7,7 @@
 #include "../Includes/WTSVariant.hpp"
 #include "../Share/BoostFile.hpp"
 #include "../Share/StrUtil.hpp"
+#include "../Share/CodeHelper.hpp"
 #include "../Share/decimal.h"
 
 #include "../Includes/IBaseDataMgr.h"
@@ -44,10 +45,30 @@ extern "C"
 			writer = NULL;
 		}
 	}
+
+	//批量导入历史数据的入口,writer必须是createWriter创建的
+	EXPORT_FLAG bool importHisBars(IDataWriter* writer, const char* stdCode, const char* period, WTSBarStruct* bars, uint32_t count)
+	{
+		if (writer == NULL)
+			return false;
+
+		return static_cast<WtDataWriterAD*>(writer)->dumpHisBars(stdCode, period, bars, count);
+	}
+
+	EXPORT_FLAG bool importHisTicks(IDataWriter* writer, const char* stdCode, uint32_t uDate, WTSTickStruct* ticks, uint32_t count)
+	{
+		if (writer == NULL)
+			return false;
+
+		return static_cast<WtDataWriterAD*>(writer)->dumpHisTicks(stdCode, uDate, ticks, count);
+	}
 };
 
 static const uint32_t CACHE_SIZE_STEP_AD = 400;
 
+//批量导入的时候每个事务最多的记录条数
+static const uint32_t BULK_LOAD_STEP_AD = 65536;
+
 
 WtDataWriterAD::WtDataWriterAD()
 	: _terminated(false)
@@ -59,6 +80,7 @@ WtDataWriterAD::WtDataWriterAD()
 	, _tick_cache_block(nullptr)
 	, _tick_mapsize(16*1024*1024)
 	, _kline_mapsize(8*1024*1024)
+	, _batch_write(false)
 {
 }
 
@@ -95,6 +117,32 @@ bool WtDataWriterAD::init(WTSVariant* params, IDataWriterSink* sink)
 	if (params->has("klinemapsize"))
 		_kline_mapsize = params->getUInt32("klinemapsize");
 
+	/*
+	 *	分组提交的配置
+	 *	batchwrite		是否开启,默认不开启,和原来一样每条数据单独提交
+	 *	batchsize		每个事务最多的记录条数,默认1024
+	 *	batchdelay		数据最长等待的毫秒数,默认50
+	 *	syncmode		sync每次提交都落盘,nosync由写线程定时落盘,默认sync
+	 *	syncinterval	nosync模式下落盘的间隔毫秒数,默认1000
+	 */
+	if (params->has("batchwrite"))
+		_batch_write = params->getBoolean("batchwrite");
+
+	if (_batch_write)
+	{
+		uint32_t batchSize = params->has("batchsize") ? params->getUInt32("batchsize") : 1024;
+		uint32_t batchDelay = params->has("batchdelay") ? params->getUInt32("batchdelay") : 50;
+		bool bNoSync = (wt_stricmp(params->getCString("syncmode"), "nosync") == 0);
+		uint32_t syncInterval = params->has("syncinterval") ? params->getUInt32("syncinterval") : 1000;
+
+		_batch_writer.set_error_callback([this](WtLMDB* db, uint32_t count) {
+			pipe_writer_log(_sink, LL_ERROR, "{} records dropped after committing to db failed: {}", count, db->errmsg());
+		});
+		_batch_writer.start(batchSize, batchDelay, bNoSync, syncInterval);
+		pipe_writer_log(_sink, LL_INFO, "Batch writing of lmdb enabled, batchsize: {}, batchdelay: {}ms, syncmode: {}", 
+			batchSize, batchDelay, bNoSync ? "nosync" : "sync");
+	}
+
 	loadCache();
 
 	return true;
@@ -108,6 +156,9 @@ void WtDataWriterAD::release()
 		_task_cond.notify_all();
 		_task_thrd->join();
 	}
+
+	//队列里剩下的数据都要提交
+	_batch_writer.stop();
 }
 
 void WtDataWriterAD::loadCache()
@@ -422,8 +473,7 @@ void WtDataWriterAD::pipeToTicks(WTSContractInfo* ct, WTSTickData* curTick)
 		uint32_t offTime = ct->getCommInfo()->getSessionInfo()->offsetTime(actTime / 100000, true) * 100000 + actTime % 100000;
 
 		LMDBHftKey key(ct->getExchg(), ct->getCode(), curTick->tradingdate(), offTime);
-		WtLMDBQuery query(*db);
-		if (!query.put_and_commit((void*)&key, sizeof(key), &curTick->getTickStruct(), sizeof(WTSTickStruct)))
+		if (!put_to_db(db, (void*)&key, sizeof(key), &curTick->getTickStruct(), sizeof(WTSTickStruct), true))
 		{
 			pipe_writer_log(_sink, LL_ERROR, "pipe tick of {} to db failed: {}", ct->getFullCode(), db->errmsg());
 		}
@@ -451,8 +501,7 @@ void WtDataWriterAD::pipeToDayBars(WTSContractInfo* ct, const WTSBarStruct& bar)
 	if (db)
 	{
 		LMDBBarKey key(ct->getExchg(), ct->getCode(), bar.date);
-		WtLMDBQuery query(*db);
-		if (!query.put_and_commit((void*)&key, sizeof(key), (void*)&bar, sizeof(WTSBarStruct)))
+		if (!put_to_db(db, (void*)&key, sizeof(key), (void*)&bar, sizeof(WTSBarStruct), false))
 		{
 			pipe_writer_log(_sink, LL_ERROR, "pipe day bar @ {} of {} to db failed", bar.date, ct->getFullCode());
 		}
@@ -484,8 +533,7 @@ void WtDataWriterAD::pipeToM1Bars(WTSContractInfo* ct, const WTSBarStruct& bar)
 	if(db)
 	{
 		LMDBBarKey key(ct->getExchg(), ct->getCode(), (uint32_t)bar.time);
-		WtLMDBQuery query(*db);
-		if(!query.put_and_commit((void*)&key, sizeof(key), (void*)&bar, sizeof(WTSBarStruct)))
+		if(!put_to_db(db, (void*)&key, sizeof(key), (void*)&bar, sizeof(WTSBarStruct), false))
 		{
 			pipe_writer_log(_sink, LL_ERROR, "pipe m1 bar @ {} of {} to db failed", bar.time, ct->getFullCode());
 		}
@@ -517,8 +565,7 @@ void WtDataWriterAD::pipeToM5Bars(WTSContractInfo* ct, const WTSBarStruct& bar)
 	if (db)
 	{
 		LMDBBarKey key(ct->getExchg(), ct->getCode(), (uint32_t)bar.time);
-		WtLMDBQuery query(*db);
-		if (!query.put_and_commit((void*)&key, sizeof(key), (void*)&bar, sizeof(bar)))
+		if (!put_to_db(db, (void*)&key, sizeof(key), (void*)&bar, sizeof(bar), false))
 		{
 			pipe_writer_log(_sink, LL_ERROR, "pipe m5 bar @ {} of {} to db failed", bar.time, ct->getFullCode());
 		}
@@ -1030,11 +1077,13 @@ WtDataWriterAD::WtLMDBPtr WtDataWriterAD::get_k_db(const char* exchg, WTSKlinePe
 		subdir = "day";
 	}
 	else
-		return std::move(WtLMDBPtr());
+		return WtLMDBPtr();
 
+	StdUniqueLock lock(_mtx_dbs);
+	//不能move,否则map里的指针就被置空了
 	auto it = the_map->find(exchg);
 	if (it != the_map->end())
-		return std::move(it->second);
+		return it->second;
 
 	WtLMDBPtr dbPtr(new WtLMDB(false));
 	std::string path = StrUtil::printf("%s%s/%s/", _base_dir.c_str(), subdir.c_str(), exchg);
@@ -1046,25 +1095,130 @@ WtDataWriterAD::WtLMDBPtr WtDataWriterAD::get_k_db(const char* exchg, WTSKlinePe
 	}
 
 	(*the_map)[exchg] = dbPtr;
-	return std::move(dbPtr);
+	return dbPtr;
 }
 
 WtDataWriterAD::WtLMDBPtr WtDataWriterAD::get_t_db(const char* exchg, const char* code)
 {
 	std::string key = StrUtil::printf("%s.%s", exchg, code);
+	StdUniqueLock lock(_mtx_dbs);
 	auto it = _tick_dbs.find(key);
 	if (it != _tick_dbs.end())
-		return std::move(it->second);
+		return it->second;
 
 	WtLMDBPtr dbPtr(new WtLMDB(false));
 	std::string path = StrUtil::printf("%sticks/%s/%s", _base_dir.c_str(), exchg, code);
 	boost::filesystem::create_directories(path);
 	if (!dbPtr->open(path.c_str(), _tick_mapsize))
 	{
-		if (_sink) pipe_writer_log(_sink, LL_ERROR, "Opening tick db at {} failed: %s", path, dbPtr->errmsg());
-		return std::move(WtLMDBPtr());
+		if (_sink) pipe_writer_log(_sink, LL_ERROR, "Opening tick db at {} failed: {}", path, dbPtr->errmsg());
+		return WtLMDBPtr();
 	}
 
 	_tick_dbs[key] = dbPtr;
-	return std::move(dbPtr);
+	return dbPtr;
+}
+
+bool WtDataWriterAD::put_to_db(const WtLMDBPtr& db, void* key, std::size_t klen, void* val, std::size_t vlen, bool bAppend)
+{
+	if (_batch_write)
+	{
+		_batch_writer.put(db, key, klen, val, vlen, bAppend);
+		return true;
+	}
+
+	WtLMDBQuery query(*db);
+	return query.put_and_commit(key, klen, val, vlen);
+}
+
+bool WtDataWriterAD::dumpHisBars(const char* stdCode, const char* period, WTSBarStruct* bars, uint32_t count)
+{
+	if (bars == NULL || count == 0)
+		return false;
+
+	WTSKlinePeriod kp = KP_Minute1;
+	if (strcmp(period, "m1") == 0)
+		kp = KP_Minute1;
+	else if (strcmp(period, "m5") == 0)
+		kp = KP_Minute5;
+	else if (strcmp(period, "d1") == 0)
+		kp = KP_DAY;
+	else
+	{
+		pipe_writer_log(_sink, LL_ERROR, "Importing bars of {} failed: period {} not supported", stdCode, period);
+		return false;
+	}
+
+	CodeHelper::CodeInfo cInfo = CodeHelper::extractStdCode(stdCode, NULL);
+	WtLMDBPtr db = get_k_db(cInfo._exchg, kp);
+	if (!db)
+		return false;
+
+	//K线库是一个市场的所有合约共用的,排序以后尽量追加
+	WtLMDBBatch batch;
+	for (uint32_t i = 0; i < count; i += BULK_LOAD_STEP_AD)
+	{
+		uint32_t cnt = min(BULK_LOAD_STEP_AD, count - i);
+		for (uint32_t j = i; j < i + cnt; j++)
+		{
+			const WTSBarStruct& bar = bars[j];
+			LMDBBarKey key(cInfo._exchg, cInfo._code, (kp == KP_DAY) ? bar.date : (uint32_t)bar.time);
+			batch.add(&key, sizeof(key), &bar, sizeof(WTSBarStruct));
+		}
+
+		batch.sort();
+		if (!batch.write(*db, true))
+		{
+			pipe_writer_log(_sink, LL_ERROR, "Importing {} bars of {} failed: {}", period, stdCode, db->errmsg());
+			return false;
+		}
+		batch.clear();
+	}
+
+	pipe_writer_log(_sink, LL_INFO, "{} {} bars of {} imported", count, period, stdCode);
+	return true;
+}
+
+bool WtDataWriterAD::dumpHisTicks(const char* stdCode, uint32_t uDate, WTSTickStruct* ticks, uint32_t count)
+{
+	if (ticks == NULL || count == 0)
+		return false;
+
+	CodeHelper::CodeInfo cInfo = CodeHelper::extractStdCode(stdCode, NULL);
+	WTSContractInfo* ct = _bd_mgr->getContract(cInfo._code, cInfo._exchg);
+	if (ct == NULL)
+	{
+		pipe_writer_log(_sink, LL_ERROR, "Importing ticks of {} failed: contract not found", stdCode);
+		return false;
+	}
+
+	WtLMDBPtr db = get_t_db(ct->getExchg(), ct->getCode());
+	if (!db)
+		return false;
+
+	//和实时落地一样,用交易日和偏移以后的时间作为key
+	WTSSessionInfo* sInfo = ct->getCommInfo()->getSessionInfo();
+	WtLMDBBatch batch;
+	for (uint32_t i = 0; i < count; i += BULK_LOAD_STEP_AD)
+	{
+		uint32_t cnt = min(BULK_LOAD_STEP_AD, count - i);
+		for (uint32_t j = i; j < i + cnt; j++)
+		{
+			const WTSTickStruct& tick = ticks[j];
+			uint32_t offTime = sInfo->offsetTime(tick.action_time / 100000, true) * 100000 + tick.action_time % 100000;
+			LMDBHftKey key(ct->getExchg(), ct->getCode(), uDate, offTime);
+			batch.add(&key, sizeof(key), &tick, sizeof(WTSTickStruct));
+		}
+
+		batch.sort();
+		if (!batch.write(*db, true))
+		{
+			pipe_writer_log(_sink, LL_ERROR, "Importing ticks of {} on {} failed: {}", stdCode, uDate, db->errmsg());
+			return false;
+		}
+		batch.clear();
+	}
+
+	pipe_writer_log(_sink, LL_INFO, "{} ticks of {} on {} imported", count, stdCode, uDate);
+	return true;
 }
@@ -1,7 +1,7 @@
 ﻿#pragma once
 #include "DataDefineAD.h"
 
-#include "../WTSUtils/WtLMDB.hpp"
+#include "../WTSUtils/WtLMDBBatch.hpp"
 
 #include "../Includes/FasterDefs.h"
 #include "../Includes/IDataWriter.h"
@@ -18,7 +18,7 @@ NS_WTP_END
 
 USING_NS_WTP;
 
-class WtDataWriterAD : public IDataWriter
+class WtDataWriterAD : public IDataWriter, public IHisDataDumper
 {
 public:
 	WtDataWriterAD();
@@ -36,6 +36,15 @@ public:
 
 	virtual WTSTickData* getCurTick(const char* code, const char* exchg = "") override;
 
+public:
+	/*
+	 *	批量导入历史数据,不经过写入队列,直接在调用线程上按key排序以后分批提交
+	 *	也可以作为扩展落地模块挂到其他的数据落地模块上
+	 *	@period	m1/m5/d1
+	 */
+	virtual bool dumpHisBars(const char* stdCode, const char* period, WTSBarStruct* bars, uint32_t count) override;
+	virtual bool dumpHisTicks(const char* stdCode, uint32_t uDate, WTSTickStruct* ticks, uint32_t count) override;
+
 private:
 	IBaseDataMgr*		_bd_mgr;
 
@@ -84,6 +93,10 @@ private:
 	uint32_t		_tick_mapsize;
 	uint32_t		_kline_mapsize;
 
+	//分组提交,每笔数据不再单独开一个事务
+	bool				_batch_write;
+	WtLMDBBatchWriter	_batch_writer;
+
 private:
 	//////////////////////////////////////////////////////////////////////////
 	/*
@@ -101,10 +114,19 @@ private:
 	//用exchg.code作为key，如BINANCE.BTCUSDT
 	WtLMDBMap	_tick_dbs;
 
+	//批量导入可能在其他线程上调用
+	StdUniqueMutex	_mtx_dbs;
+
 	WtLMDBPtr	get_k_db(const char* exchg, WTSKlinePeriod period);
 
 	WtLMDBPtr	get_t_db(const char* exchg, const char* code);
 
+	/*
+	 *	写入一条数据,开了分组提交就放到写入队列里,否则直接提交
+	 *	@bAppend	key是否递增
+	 */
+	bool		put_to_db(const WtLMDBPtr& db, void* key, std::size_t klen, void* val, std::size_t vlen, bool bAppend);
+
 private:
 	void loadCache();
 
@@ -289,7 +289,10 @@ void ParserAdapter::handleTransaction(WTSTransData* transData)
 	if (transData->actiondate() == 0 || transData->tradingdate() == 0)
 		return;
 
-	WTSContractInfo* contract = _bd_mgr->getContract(transData->code(), transData->exchg());
+	//解析器已经带了合约信息的,就不用再查一次了
+	WTSContractInfo* contract = transData->getContractInfo();
+	if (contract == NULL)
+		contract = _bd_mgr->getContract(transData->code(), transData->exchg());
 	if (contract == NULL)
 		return;
 
@@ -306,7 +309,10 @@ void ParserAdapter::handleOrderDetail(WTSOrdDtlData* ordDetailData)
 	if (ordDetailData->actiondate() == 0 || ordDetailData->tradingdate() == 0)
 		return;
 
-	WTSContractInfo* contract = _bd_mgr->getContract(ordDetailData->code(), ordDetailData->exchg());
+	//解析器已经带了合约信息的,就不用再查一次了
+	WTSContractInfo* contract = ordDetailData->getContractInfo();
+	if (contract == NULL)
+		contract = _bd_mgr->getContract(ordDetailData->code(), ordDetailData->exchg());
 	if (contract == NULL)
 		return;
 
@@ -323,7 +329,10 @@ void ParserAdapter::handleOrderQueue(WTSOrdQueData* ordQueData)
 	if (ordQueData->actiondate() == 0 || ordQueData->tradingdate() == 0)
 		return;
 
-	WTSContractInfo* contract = _bd_mgr->getContract(ordQueData->code(), ordQueData->exchg());
+	//解析器已经带了合约信息的,就不用再查一次了
+	WTSContractInfo* contract = ordQueData->getContractInfo();
+	if (contract == NULL)
+		contract = _bd_mgr->getContract(ordQueData->code(), ordQueData->exchg());
 	if (contract == NULL)
 		return;
 
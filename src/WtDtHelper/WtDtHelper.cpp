@@ -11,6 +11,7 @@
 #include "../Share/StrUtil.hpp"
 #include "../Share/TimeUtils.hpp"
 #include "../Share/BoostFile.hpp"
+#include "../Share/WtTickJournal.hpp"
 
 #include "../WtDataStorage/DataDefine.h"
 #include "../WTSUtils/WTSCmpHelper.hpp"
@@ -20,7 +21,12 @@
 #include "../Includes/WTSDataDef.hpp"
 #include "../Includes/WTSSessionInfo.hpp"
 
+#include "../WtBtCore/BtOutputDefs.h"
+#include "../Share/fmtlib.h"
+
 #include <rapidjson/document.h>
+#include <algorithm>
+#include <fstream>
 
 namespace rj = rapidjson;
 
@@ -72,6 +78,17 @@ bool proc_block_data(std::string& content, bool isBar, bool bKeepHead /* = true
 		}
 	}
 
+	//定点紧凑格式,解压以后还原成标准结构体
+	if (header->is_compact())
+	{
+		std::string rawData;
+		bool bSucc = isBar ? WtCompactCodec::decode_bars(buffer.data(), buffer.size(), rawData) : WtCompactCodec::decode_ticks(buffer.data(), buffer.size(), rawData);
+		if (!bSucc)
+			return false;
+
+		buffer.swap(rawData);
+	}
+
 	if (bOldVer)
 	{
 		if (isBar)
@@ -399,7 +416,7 @@ void trans_csv_bars(WtString csvFolder, WtString binFolder, WtString period, Fun
 		if(cbLogger)
 			cbLogger(StrUtil::printf("正在读取数据文件%s...", path.c_str()).c_str());
 
-		CsvReader reader(",");
+		CsvMmapReader reader(',');
 		if(!reader.load_from_file(path.c_str()))
 		{
 			if (cbLogger)
@@ -407,31 +424,64 @@ void trans_csv_bars(WtString csvFolder, WtString binFolder, WtString period, Fun
 			continue;
 		}
 
-		std::vector<WTSBarStruct> bars;
-
-		while(reader.next_row())
-		{
-			//逐行读取
-			WTSBarStruct bs;
-			bs.date = strToDate(reader.get_string("date"));
-			if(kp != KP_DAY)
-				bs.time = TimeUtils::timeToMinBar(bs.date, strToTime(reader.get_string("time")));
-			bs.open = reader.get_double("open");
-			bs.high = reader.get_double("high");
-			bs.low = reader.get_double("low");
-			bs.close = reader.get_double("close");
-			bs.vol = reader.get_double("volume");
-			bs.money = reader.get_double("turnover");
-			bs.hold = reader.get_double("open_interest");
-			bs.add = reader.get_double("diff_interest");
-			bs.settle = reader.get_double("settle");
-			bars.emplace_back(bs);
-
-			if (bars.size() % 1000 == 0)
+		/*
+		 *	文件映射到内存以后按换行符分块,每块在单独的线程里解析,最后按顺序拼起来
+		 *	列号先查好,同一天的日期字符串都一样,缓存上一次的解析结果
+		 */
+		int32_t colDate = reader.get_col("date");
+		int32_t colTime = reader.get_col("time");
+		int32_t colOpen = reader.get_col("open");
+		int32_t colHigh = reader.get_col("high");
+		int32_t colLow = reader.get_col("low");
+		int32_t colClose = reader.get_col("close");
+		int32_t colVol = reader.get_col("volume");
+		int32_t colMoney = reader.get_col("turnover");
+		int32_t colHold = reader.get_col("open_interest");
+		int32_t colAdd = reader.get_col("diff_interest");
+		int32_t colSettle = reader.get_col("settle");
+
+		//每块至少1M,数据少的时候不用拆
+		uint32_t threads = std::max(std::thread::hardware_concurrency(), 1U);
+		threads = (uint32_t)std::min((std::size_t)threads, reader.data_size() / (1024 * 1024) + 1);
+		std::vector<std::vector<WTSBarStruct>> chunks(threads);
+		reader.parallel_for(threads, [&](uint32_t chunkIdx, CsvCursor& cursor) {
+			std::vector<WTSBarStruct>& chunkBars = chunks[chunkIdx];
+			std::string lastDate;
+			uint32_t uLastDate = 0;
+			while (cursor.next_row())
 			{
-				if (cbLogger)
-					cbLogger(StrUtil::printf("已读取数据%u条", bars.size()).c_str());
+				//逐行读取
+				WTSBarStruct bs;
+				std::string_view strDate = cursor.get_view(colDate);
+				if (lastDate.empty() || strDate != lastDate)
+				{
+					lastDate.assign(strDate.data(), strDate.size());
+					uLastDate = strToDate(lastDate.c_str());
+				}
+				bs.date = uLastDate;
+				if (kp != KP_DAY)
+					bs.time = TimeUtils::timeToMinBar(bs.date, strToTime(cursor.get_string(colTime)));
+				bs.open = cursor.get_double(colOpen);
+				bs.high = cursor.get_double(colHigh);
+				bs.low = cursor.get_double(colLow);
+				bs.close = cursor.get_double(colClose);
+				bs.vol = cursor.get_double(colVol);
+				bs.money = cursor.get_double(colMoney);
+				bs.hold = cursor.get_double(colHold);
+				bs.add = cursor.get_double(colAdd);
+				bs.settle = cursor.get_double(colSettle);
+				chunkBars.emplace_back(bs);
 			}
+		});
+
+		std::vector<WTSBarStruct> bars;
+		for (auto& chunkBars : chunks)
+		{
+			bars.insert(bars.end(), chunkBars.begin(), chunkBars.end());
+			std::vector<WTSBarStruct>().swap(chunkBars);
+
+			if (cbLogger)
+				cbLogger(StrUtil::printf("已读取数据%u条", bars.size()).c_str());
 		}
 		if (cbLogger)
 			cbLogger(StrUtil::printf("数据文件%s全部读取完成,共%u条", path.c_str(), bars.size()).c_str());
@@ -1111,6 +1161,109 @@ bool store_ticks(WtString tickFile, WTSTickStruct* firstTick, int count, FuncLog
 	return true;
 }
 
+bool compact_dsb_file(WtString srcFile, WtString destFile, double priceTick, FuncLogCallback cbLogger/* = NULL*/)
+{
+	std::string content;
+	BoostFile::read_file_contents(srcFile, content);
+	if (content.size() < sizeof(BlockHeader))
+	{
+		if (cbLogger)
+			cbLogger(StrUtil::printf("文件%s头部校验失败", srcFile).c_str());
+		return false;
+	}
+
+	BlockHeader* header = (BlockHeader*)content.data();
+	uint16_t bType = header->_type;
+	bool isBar = (bType == BT_HIS_Minute1 || bType == BT_HIS_Minute5 || bType == BT_HIS_Day);
+	if (!isBar && bType != BT_HIS_Ticks)
+	{
+		if (cbLogger)
+			cbLogger(StrUtil::printf("文件%s不是K线或者tick数据", srcFile).c_str());
+		return false;
+	}
+
+	if (!proc_block_data(content, isBar, false))
+	{
+		if (cbLogger)
+			cbLogger(StrUtil::printf("文件%s数据处理失败", srcFile).c_str());
+		return false;
+	}
+
+	uint32_t precision = WtCompactCodec::precision_of(priceTick);
+	std::string compact;
+	bool bSucc = isBar ? WtCompactCodec::encode_bars((WTSBarStruct*)content.data(), (uint32_t)(content.size() / sizeof(WTSBarStruct)), precision, compact)
+		: WtCompactCodec::encode_ticks((WTSTickStruct*)content.data(), (uint32_t)(content.size() / sizeof(WTSTickStruct)), precision, compact);
+	if (!bSucc)
+	{
+		if (cbLogger)
+			cbLogger(StrUtil::printf("文件%s的数据不能无损转成紧凑格式", srcFile).c_str());
+		return false;
+	}
+
+	std::string cmp_data = WTSCmpHelper::compress_data(compact.data(), compact.size());
+	BlockHeaderV2 newHeader;
+	strcpy(newHeader._blk_flag, BLK_FLAG);
+	newHeader._type = bType;
+	newHeader._version = BLOCK_VERSION_CMP_V3;
+	newHeader._size = cmp_data.size();
+
+	BoostFile bf;
+	if (!bf.create_new_file(destFile))
+	{
+		if (cbLogger)
+			cbLogger(StrUtil::printf("文件%s创建失败", destFile).c_str());
+		return false;
+	}
+	bf.write_file(&newHeader, sizeof(newHeader));
+	bf.write_file(cmp_data);
+	bf.close_file();
+
+	if (cbLogger)
+		cbLogger(StrUtil::printf("%s转换完成,原始数据%u字节,紧凑数据%u字节,压缩后%u字节", srcFile, (uint32_t)content.size(), (uint32_t)compact.size(), (uint32_t)cmp_data.size()).c_str());
+
+	return true;
+}
+
+WtUInt32 trans_tick_journal(WtString jnlFile, WtString outFolder, FuncLogCallback cbLogger/* = NULL*/)
+{
+	WtTickJournalReader reader;
+	if (!reader.open(jnlFile))
+	{
+		if (cbLogger)
+			cbLogger(StrUtil::printf("流水文件%s不存在或者格式不对", jnlFile).c_str());
+		return 0;
+	}
+
+	std::string folder = StrUtil::standardisePath(outFolder);
+	wt_hashmap<std::string, std::shared_ptr<std::ofstream>> streams;
+	uint64_t count = reader.size();
+	for (uint64_t idx = 0; idx < count; idx++)
+	{
+		const JournalRecord& rec = reader.at(idx);
+		const WTSTickStruct& ts = rec._tick;
+		std::string key = fmt::format("{}.{}", ts.exchg, ts.code);
+		std::shared_ptr<std::ofstream>& fs = streams[key];
+		if (fs == NULL)
+		{
+			//和原来的日志一样按交易所分目录,追加写入
+			std::string path = fmt::format("{}{}/", folder, ts.exchg);
+			BoostFile::create_directories(path.c_str());
+			path += fmt::format("{}.{}.csv", ts.code, reader.date());
+			fs.reset(new std::ofstream(path.c_str(), std::ios_base::app));
+		}
+
+		journal_to_csv(rec, *fs);
+	}
+
+	for (auto& v : streams)
+		v.second->close();
+
+	if (cbLogger)
+		cbLogger(StrUtil::printf("%s转换完成,共%u条tick,%u个合约", jnlFile, (uint32_t)count, (uint32_t)streams.size()).c_str());
+
+	return (WtUInt32)count;
+}
+
 bool store_order_details(WtString tickFile, WTSOrdDtlStruct* firstItem, int count, FuncLogCallback cbLogger/* = NULL*/)
 {
 	if (count == 0)
@@ -1229,4 +1382,207 @@ bool store_transactions(WtString tickFile, WTSTransStruct* firstItem, int count,
 		cbLogger("Write transactions to file succeedd");
 
 	return true;
-}
\ No newline at end of file
+}
+
+/*
+ *	回测输出表转csv
+ *	格式和回测引擎原来直接输出的csv保持一致,数值的格式化方式也一样
+ */
+bool dump_bt_table(const WtRecordTable& table, const std::string& filename)
+{
+	const WtRecTableHeader* header = table.header();
+	std::string flavor = header->_flavor;
+	std::string name = header->_name;
+	uint64_t cnt = table.size();
+
+	std::stringstream ss;
+	if (name == BT_TABLE_TRADES)
+	{
+		if (flavor == BT_FLAVOR_CTA)
+			ss << "code,time,direct,action,price,qty,tag,fee,barno\n";
+		else
+			ss << "code,time,direct,action,price,qty,fee,usertag\n";
+
+		for (uint64_t i = 0; i < cnt; i++)
+		{
+			const BtTradeRecord* rec = table.at<BtTradeRecord>(i);
+			ss << rec->code << "," << rec->time << "," << (rec->direct ? "LONG" : "SHORT") << ",";
+			if (flavor == BT_FLAVOR_UFT)
+				ss << (rec->action == 0 ? "OPEN" : (rec->action == 1 ? "CLOSE" : "CLOSET"));
+			else
+				ss << (rec->action == 0 ? "OPEN" : "CLOSE");
+			ss << "," << rec->price << "," << rec->qty;
+
+			if (flavor == BT_FLAVOR_CTA)
+				ss << "," << rec->usertag << "," << rec->fee << "," << rec->barno << "\n";
+			else if (flavor == BT_FLAVOR_HFT)
+				ss << "," << rec->fee << "," << rec->usertag << "\n";
+			else
+				ss << "," << rec->fee << "\n";
+		}
+	}
+	else if (name == BT_TABLE_CLOSES)
+	{
+		if (flavor == BT_FLAVOR_CTA)
+			ss << "code,direct,opentime,openprice,closetime,closeprice,qty,profit,maxprofit,maxloss,totalprofit,entertag,exittag,openbarno,closebarno\n";
+		else
+			ss << "code,direct,opentime,openprice,closetime,closeprice,qty,profit,maxprofit,maxloss,totalprofit,entertag,exittag\n";
+
+		for (uint64_t i = 0; i < cnt; i++)
+		{
+			const BtCloseRecord* rec = table.at<BtCloseRecord>(i);
+			ss << rec->code << "," << (rec->direct ? "LONG" : "SHORT") << "," << rec->opentime << "," << rec->openprice
+				<< "," << rec->closetime << "," << rec->closeprice << "," << rec->qty << "," << rec->profit << "," << rec->maxprofit << "," << rec->maxloss << ","
+				<< rec->totalprofit;
+
+			if (flavor == BT_FLAVOR_CTA)
+				ss << "," << rec->entertag << "," << rec->exittag << "," << rec->openbarno << "," << rec->closebarno << "\n";
+			else if (flavor == BT_FLAVOR_HFT)
+				ss << "," << rec->entertag << "," << rec->exittag << "\n";
+			else
+				ss << "\n";
+		}
+	}
+	else if (name == BT_TABLE_FUNDS)
+	{
+		ss << "date,closeprofit,positionprofit,dynbalance,fee\n";
+		for (uint64_t i = 0; i < cnt; i++)
+		{
+			const BtFundRecord* rec = table.at<BtFundRecord>(i);
+			ss << fmt::format("{},{:.2f},{:.2f},{:.2f},{:.2f}\n", rec->date, rec->closeprofit, rec->positionprofit, rec->dynbalance, rec->fee);
+		}
+	}
+	else if (name == BT_TABLE_POSITIONS)
+	{
+		if (flavor == BT_FLAVOR_UFT)
+			ss << "date,code,direct,volume,closeprofit,dynprofit\n";
+		else
+			ss << "date,code,volume,closeprofit,dynprofit\n";
+
+		for (uint64_t i = 0; i < cnt; i++)
+		{
+			const BtPositionRecord* rec = table.at<BtPositionRecord>(i);
+			if (flavor == BT_FLAVOR_UFT)
+				ss << fmt::format("{},{},{},{},{:.2f},{:.2f}\n", rec->date, rec->code, rec->direct ? "LONG" : "SHORT", rec->volume, rec->closeprofit, rec->dynprofit);
+			else
+				ss << fmt::format("{},{},{},{:.2f},{:.2f}\n", rec->date, rec->code, rec->volume, rec->closeprofit, rec->dynprofit);
+		}
+	}
+	else if (name == BT_TABLE_SIGNALS && flavor == BT_FLAVOR_CTA)
+	{
+		ss << "code,target,sigprice,gentime,usertag\n";
+		for (uint64_t i = 0; i < cnt; i++)
+		{
+			const BtSignalRecord* rec = table.at<BtSignalRecord>(i);
+			ss << rec->code << "," << rec->target << "," << rec->sigprice << "," << rec->gentime << "," << rec->usertag << "\n";
+		}
+	}
+	else if (name == BT_TABLE_SIGNALS && flavor == BT_FLAVOR_HFT)
+	{
+		ss << "time, action, position, price\n";
+		for (uint64_t i = 0; i < cnt; i++)
+		{
+			const BtHftSignalRecord* rec = table.at<BtHftSignalRecord>(i);
+			ss << rec->date << "." << rec->time << "." << rec->secs << ","
+				<< (rec->qty > 0 ? "+" : "-") << std::abs(rec->qty) << "," << rec->position << "," << rec->price << "\n";
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	const std::string& content = ss.str();
+	BoostFile bf;
+	if (!bf.create_new_file(filename.c_str()))
+		return false;
+
+	bf.write_file(content);
+	bf.close_file();
+	return true;
+}
+
+void dump_bt_outputs(WtString binFolder, WtString csvFolder, FuncLogCallback cbLogger /* = NULL */)
+{
+	std::string srcFolder = StrUtil::standardisePath(binFolder);
+	if (!BoostFile::exists(srcFolder.c_str()))
+	{
+		if (cbLogger)
+			cbLogger(StrUtil::printf("目录%s不存在", binFolder).c_str());
+		return;
+	}
+
+	if (!BoostFile::exists(csvFolder))
+		BoostFile::create_directories(csvFolder);
+
+	boost::filesystem::path myPath(srcFolder);
+	boost::filesystem::directory_iterator endIter;
+	for (boost::filesystem::directory_iterator iter(myPath); iter != endIter; iter++)
+	{
+		if (boost::filesystem::is_directory(iter->path()))
+			continue;
+
+		if (iter->path().extension() != BT_TABLE_FILE_EXT)
+			continue;
+
+		const std::string& path = iter->path().string();
+
+		WtRecordTable table;
+		if (!table.open(path.c_str()))
+		{
+			if (cbLogger)
+				cbLogger(StrUtil::printf("文件%s不是回测输出表，跳过转换", path.c_str()).c_str());
+			continue;
+		}
+
+		std::string filename = StrUtil::standardisePath(csvFolder);
+		filename += iter->path().stem().string();
+		filename += ".csv";
+
+		if (cbLogger)
+			cbLogger(StrUtil::printf("正在写入%s...", filename.c_str()).c_str());
+
+		if (!dump_bt_table(table, filename))
+		{
+			if (cbLogger)
+				cbLogger(StrUtil::printf("%s转换失败", path.c_str()).c_str());
+		}
+	}
+}
+
+WtUInt32 read_bt_output(WtString tableFile, FuncGetBtRecordsCallback cb, FuncLogCallback cbLogger /* = NULL */)
+{
+	WtRecordTable table;
+	if (!table.open(tableFile))
+	{
+		if (cbLogger)
+			cbLogger(StrUtil::printf("文件%s头部校验失败", tableFile).c_str());
+		return 0;
+	}
+
+	//拼成numpy.dtype的字典格式: {"names":[],"formats":[],"offsets":[],"itemsize":n}
+	const WtRecTableHeader* header = table.header();
+	std::string names, formats, offsets;
+	for (uint32_t i = 0; i < header->_col_count; i++)
+	{
+		const WtRecColumn& col = header->_columns[i];
+		if (i > 0)
+		{
+			names += ",";
+			formats += ",";
+			offsets += ",";
+		}
+		names += fmt::format("\"{}\"", col._name);
+		formats += fmt::format("\"{}\"", col._dtype);
+		offsets += fmt::format("{}", col._offset);
+	}
+	std::string dtype = fmt::format("{{\"names\":[{}],\"formats\":[{}],\"offsets\":[{}],\"itemsize\":{}}}", names, formats, offsets, header->_rec_size);
+
+	WtUInt32 cnt = (WtUInt32)table.size();
+	cb(dtype.c_str(), table.data(), cnt);
+
+	if (cbLogger)
+		cbLogger(StrUtil::printf("%s读取完成,共%u条记录", tableFile, cnt).c_str());
+
+	return cnt;
+}
@@ -28,6 +28,11 @@ typedef void(PORTER_FLAG *FuncGetOrdDtlCallback)(WTSOrdDtlStruct* item, WtUInt32
 typedef void(PORTER_FLAG *FuncGetOrdQueCallback)(WTSOrdQueStruct* item, WtUInt32 count, bool isLast);
 typedef void(PORTER_FLAG *FuncGetTransCallback)(WTSTransStruct* item, WtUInt32 count, bool isLast);
 typedef void(PORTER_FLAG *FuncCountDataCallback)(WtUInt32 dataCnt);
+/*
+ *	回测输出表的回调
+ *	dtype是numpy的字典格式描述,python端json解析以后直接传给numpy.dtype,再用numpy.frombuffer构造数组
+ */
+typedef void(PORTER_FLAG *FuncGetBtRecordsCallback)(WtString dtype, const char* data, WtUInt32 count);
 
 //改成直接从python传内存块的方式
 //typedef bool(PORTER_FLAG *FuncGetBarItem)(WTSBarStruct* curBar,int idx);
@@ -41,6 +46,10 @@ extern "C"
 	EXPORT_FLAG	void		dump_ticks(WtString binFolder, WtString csvFolder, WtString strFilter = "", FuncLogCallback cbLogger = NULL);
 	EXPORT_FLAG	void		trans_csv_bars(WtString csvFolder, WtString binFolder, WtString period, FuncLogCallback cbLogger = NULL);
 
+	//回测输出的二进制表转成原来的csv
+	EXPORT_FLAG	void		dump_bt_outputs(WtString binFolder, WtString csvFolder, FuncLogCallback cbLogger = NULL);
+	EXPORT_FLAG	WtUInt32	read_bt_output(WtString tableFile, FuncGetBtRecordsCallback cb, FuncLogCallback cbLogger = NULL);
+
 	EXPORT_FLAG	WtUInt32	read_dsb_ticks(WtString tickFile, FuncGetTicksCallback cb, FuncCountDataCallback cbCnt, FuncLogCallback cbLogger = NULL);
 	EXPORT_FLAG	WtUInt32	read_dsb_order_details(WtString dataFile, FuncGetOrdDtlCallback cb, FuncCountDataCallback cbCnt, FuncLogCallback cbLogger = NULL);
 	EXPORT_FLAG	WtUInt32	read_dsb_order_queues(WtString dataFile, FuncGetOrdQueCallback cb, FuncCountDataCallback cbCnt, FuncLogCallback cbLogger = NULL);
@@ -57,6 +66,12 @@ extern "C"
 	EXPORT_FLAG bool		store_bars(WtString barFile, WTSBarStruct* firstBar, int count, WtString period, FuncLogCallback cbLogger = NULL);
 	EXPORT_FLAG bool		store_ticks(WtString tickFile, WTSTickStruct* firstTick, int count, FuncLogCallback cbLogger = NULL);
 
+	//K线或tick的dsb文件转成定点紧凑格式,priceTick为品种的价格变动单位
+	EXPORT_FLAG bool		compact_dsb_file(WtString srcFile, WtString destFile, double priceTick, FuncLogCallback cbLogger = NULL);
+
+	//落地程序的tick流水文件转成原来的csv日志,输出到outFolder/交易所/代码.交易日.csv
+	EXPORT_FLAG WtUInt32	trans_tick_journal(WtString jnlFile, WtString outFolder, FuncLogCallback cbLogger = NULL);
+
 	//股票level2数据存储
 	EXPORT_FLAG bool		store_order_details(WtString tickFile, WTSOrdDtlStruct* firstItem, int count, FuncLogCallback cbLogger = NULL);
 	EXPORT_FLAG bool		store_order_queues(WtString tickFile, WTSOrdQueStruct* firstItem, int count, FuncLogCallback cbLogger = NULL);
@@ -22,6 +22,7 @@
 #include "../Share/StrUtil.hpp"
 #include "../Share/StdUtils.hpp"
 #include "../Share/CodeHelper.hpp"
+#include "../Share/WtVolProfile.hpp"
 
 USING_NS_WTP;
 
@@ -350,6 +351,83 @@ WTSKlineSlice* WtDtRunner::get_bars_by_count(const char* stdCode, const char* pe
 	return _data_mgr.get_kline_slice_by_count(stdCode, kp, realTimes, count, endTime);
 }
 
+uint32_t WtDtRunner::build_vol_profiles(const char* codes, uint32_t days, uint64_t endTime, const char* filename)
+{
+	if (!_is_inited)
+	{
+		WTSLogger::error("WtDtServo not initialized");
+		return 0;
+	}
+
+	if (endTime == 0)
+	{
+		uint32_t curDate = TimeUtils::getCurDate();
+		endTime = (uint64_t)curDate * 10000 + 2359;
+	}
+
+	TimeUtils::Ticker ticker;
+	std::shared_ptr<WtVolProfileBuilder> builder;
+	std::vector<WTSBarStruct> bars;
+	const StringVector ayCodes = StrUtil::split(codes, ",");
+	for (const std::string& code : ayCodes)
+	{
+		const char* stdCode = code.c_str();
+		CodeHelper::CodeInfo cInfo = CodeHelper::extractStdCode(stdCode, &_hot_mgr);
+		WTSCommodityInfo* commInfo = _bd_mgr.getCommodity(cInfo._exchg, cInfo._product);
+		if (commInfo == NULL)
+		{
+			WTSLogger::warn("Commodity of {} not found, skipped", stdCode);
+			continue;
+		}
+
+		WTSSessionInfo* sInfo = commInfo->getSessionInfo();
+		uint32_t bins = sInfo->getTradingMins();
+		if (builder == NULL)
+			builder.reset(new WtVolProfileBuilder(bins));
+		else if (builder->bins() != bins)
+		{
+			WTSLogger::warn("Trading minutes of {} is {}, not match with {}, skipped", stdCode, bins, builder->bins());
+			continue;
+		}
+
+		WTSKlineSlice* kData = _data_mgr.get_kline_slice_by_count(stdCode, KP_Minute1, 1, days*bins, endTime);
+		if (kData == NULL)
+			continue;
+
+		//切片可能分成好几块,按交易日切分之前先拼成连续的
+		if (kData->get_block_counts() == 1)
+		{
+			builder->add_bars(stdCode, kData->get_block_addr(0), kData->get_block_size(0), sInfo);
+		}
+		else
+		{
+			bars.clear();
+			for (std::size_t i = 0; i < kData->get_block_counts(); i++)
+			{
+				WTSBarStruct* blk = kData->get_block_addr(i);
+				bars.insert(bars.end(), blk, blk + kData->get_block_size(i));
+			}
+			builder->add_bars(stdCode, bars.data(), (uint32_t)bars.size(), sInfo);
+		}
+		kData->release();
+	}
+
+	if (builder == NULL || builder->size() == 0)
+	{
+		WTSLogger::warn("No volume profile built");
+		return 0;
+	}
+
+	if (!builder->save(filename, (uint32_t)(endTime / 10000), days))
+	{
+		WTSLogger::error("Saving volume profiles to {} failed", filename);
+		return 0;
+	}
+
+	WTSLogger::info("{} volume profiles of {} days built and saved to {} in {}ms", builder->size(), days, filename, ticker.milli_seconds());
+	return (uint32_t)builder->size();
+}
+
 WTSTickSlice* WtDtRunner::get_ticks_by_count(const char* stdCode, uint32_t count, uint64_t endTime /* = 0 */)
 {
 	if (!_is_inited)
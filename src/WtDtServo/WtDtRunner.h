@@ -61,6 +61,12 @@ public:
 
 	WTSKlineSlice*	get_sbars_by_date(const char* stdCode, uint32_t secs, uint32_t uDate = 0);
 
+	/*
+	 *	生成成交量分布曲线文件
+	 *	所有代码的分钟数必须和第一个代码一致,不一致的会跳过
+	 */
+	uint32_t		build_vol_profiles(const char* codes, uint32_t days, uint64_t endTime, const char* filename);
+
 private:
 	void	initDataMgr(WTSVariant* config);
 	void	initParsers(WTSVariant* cfg);
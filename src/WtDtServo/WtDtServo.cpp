@@ -237,4 +237,9 @@ void subscribe_bar(const char* stdCode, const char* period)
 void clear_cache()
 {
 	getRunner().clear_cache();
+}
+
+WtUInt32 build_vol_profiles(const char* codes, WtUInt32 days, WtUInt64 endTime, const char* filename)
+{
+	return getRunner().build_vol_profiles(codes, days, endTime, filename);
 }
\ No newline at end of file
@@ -40,6 +40,15 @@ extern "C"
 
 	EXPORT_FLAG void		clear_cache();
 
+	/*
+	 *	用分钟线生成成交量分布曲线文件,供VWAP执行单元使用
+	 *	codes	代码列表,用逗号分隔
+	 *	days	统计的交易日数
+	 *	endTime	截止时间,格式如202311101500,为0则到最新
+	 *	返回值	生成的曲线条数
+	 */
+	EXPORT_FLAG	WtUInt32	build_vol_profiles(const char* codes, WtUInt32 days, WtUInt64 endTime, const char* filename);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -89,6 +89,7 @@ void WtMinImpactExeUnit::init(ExecuteContext* ctx, const char* stdCode, WTSVaria
 
 	_price_offset = cfg->getInt32("offset");	//价格偏移跳数，一般和订单同方向
 	_expire_secs = cfg->getUInt32("expire");	//订单超时秒数
+	_orders_mon.attach(ctx, stdCode, _expire_secs);
 	_price_mode = cfg->getInt32("pricemode");	//价格类型,0-最新价,-1-最优价,1-对手价,2-自动,默认为0
 	_entrust_span = cfg->getUInt32("span");		//发单时间间隔，单位毫秒
 	_by_rate = cfg->getBoolean("byrate");		//是否按照对手的挂单数的比例下单，如果是true，则rate字段生效，如果是false则lots字段生效
@@ -190,6 +191,19 @@ void WtMinImpactExeUnit::on_channel_lost()
 {
 	
 }
+
+void WtMinImpactExeUnit::on_timer(const char* stdCode, uint32_t tag)
+{
+	//执行器支持定时器的话,超时撤单就在这里处理,on_tick里的check_orders会直接返回
+	_orders_mon.on_timer(tag, [this](uint32_t localid) {
+		if (_ctx->cancel(localid))
+		{
+			_cancel_cnt++;
+			_ctx->writeLog(fmtutil::format("[{}@{}] Expired order of {} canceled, cancelcnt -> {}", __FILE__, __LINE__, _code.c_str(), _cancel_cnt));
+		}
+	});
+}
+
 /*
  *	tick数据回调
  *	newTick	最新的tick数据
@@ -93,6 +93,11 @@ public:
 	 */
 	virtual void on_channel_lost() override;
 
+	/*
+	 *	定时事件回调,这里只有订单超时
+	 */
+	virtual void on_timer(const char* stdCode, uint32_t tag) override;
+
 private:
 	WTSTickData* _last_tick;	//上一笔行情
 	double		_target_pos;	//目标仓位
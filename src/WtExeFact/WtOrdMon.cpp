@@ -1,14 +1,33 @@
 ﻿#include "WtOrdMon.h"
 
+void WtOrdMon::attach(ExecuteContext* ctx, const char* stdCode, uint32_t expiresecs)
+{
+	_ctx = ctx;
+	_code = stdCode;
+	_expire_secs = expiresecs;
+}
+
 void WtOrdMon::push_order(const uint32_t* ids, uint32_t cnt, uint64_t curTime, bool bCanCancel /* = true */)
 {
 	StdLocker<StdRecurMutex> lock(_mtx_ords);
 	for (uint32_t idx = 0; idx < cnt; idx++)
 	{
 		uint32_t localid = ids[idx];
-		OrderPair& ordInfo = _orders[localid];
-		ordInfo.first = curTime;
-		ordInfo.second = bCanCancel;
+		auto it = _orders.find(localid);
+		if (it != _orders.end() && it->second._timerid != 0)
+			_ctx->cancelTimer(it->second._timerid);
+
+		OrderInfo& ordInfo = _orders[localid];
+		ordInfo._enter_time = curTime;
+		ordInfo._can_cancel = bCanCancel;
+		ordInfo._timerid = 0;
+
+		//不能撤单的订单不需要超时事件
+		if (_ctx == NULL || _expire_secs == 0 || !bCanCancel)
+			continue;
+
+		ordInfo._timerid = _ctx->scheduleTimer(_code.c_str(), _expire_secs * 1000, localid);
+		_timer_driven = (ordInfo._timerid != 0);
 	}
 }
 
@@ -19,12 +38,16 @@ void WtOrdMon::erase_order(uint32_t localid)
 	if (it == _orders.end())
 		return;
 
+	if (it->second._timerid != 0)
+		_ctx->cancelTimer(it->second._timerid);
+
 	_orders.erase(it);
 }
 
 void WtOrdMon::check_orders(uint32_t expiresecs, uint64_t curTime, EnumOrderCallback callback)
 {
-	if (_orders.empty())
+	//由定时器驱动的,不需要再扫描了
+	if (_orders.empty() || _timer_driven)
 		return;
 
 
@@ -32,11 +55,11 @@ void WtOrdMon::check_orders(uint32_t expiresecs, uint64_t curTime, EnumOrderCall
 	for (auto& m : _orders)
 	{
 		uint32_t localid = m.first;
-		OrderPair& ordInfo = m.second;
-		if (!ordInfo.second)	//如果不能撤单，则直接跳过（一般涨跌停价的挂单是不能撤单的）
+		OrderInfo& ordInfo = m.second;
+		if (!ordInfo._can_cancel)	//如果不能撤单，则直接跳过（一般涨跌停价的挂单是不能撤单的）
 			continue;
 
-		auto entertm = ordInfo.first;
+		auto entertm = ordInfo._enter_time;
 		if (curTime - entertm < expiresecs * 1000)
 			continue;
 
@@ -44,6 +67,33 @@ void WtOrdMon::check_orders(uint32_t expiresecs, uint64_t curTime, EnumOrderCall
 	}
 }
 
+bool WtOrdMon::on_timer(uint32_t localid, EnumOrderCallback callback)
+{
+	StdLocker<StdRecurMutex> lock(_mtx_ords);
+	auto it = _orders.find(localid);
+	if (it == _orders.end())
+		return false;
+
+	OrderInfo& ordInfo = it->second;
+	ordInfo._timerid = 0;
+	if (!ordInfo._can_cancel)
+		return true;
+
+	callback(localid);
+	return true;
+}
+
+void WtOrdMon::clear_orders()
+{
+	StdLocker<StdRecurMutex> lock(_mtx_ords);
+	for (auto& m : _orders)
+	{
+		if (m.second._timerid != 0)
+			_ctx->cancelTimer(m.second._timerid);
+	}
+	_orders.clear();
+}
+
 void WtOrdMon::enumOrder(EnumAllOrderCallback cb)
 {
 	if (_orders.empty())
@@ -53,9 +103,9 @@ void WtOrdMon::enumOrder(EnumAllOrderCallback cb)
 	for (auto& m : _orders)
 	{
 		uint32_t localid = m.first;
-		OrderPair& ordInfo = m.second;
-		uint64_t entertm = ordInfo.first;
-		bool cancancel = ordInfo.second;
+		OrderInfo& ordInfo = m.second;
+		uint64_t entertm = ordInfo._enter_time;
+		bool cancancel = ordInfo._can_cancel;
 		cb(localid, entertm, cancancel);
 	}
 }
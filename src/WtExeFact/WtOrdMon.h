@@ -4,16 +4,39 @@
 #include <functional>
 
 #include "../Share/StdUtils.hpp"
+#include "../Includes/ExecuteDefs.h"
+
+USING_NS_WTP;
 
 typedef std::function<void(uint32_t)> EnumOrderCallback;
 typedef std::function<void(uint32_t, uint64_t, bool)> EnumAllOrderCallback;
 
+/*
+ *	执行单元定时器的标记
+ *	订单超时直接用本地订单号作为标记,本地订单号从1开始,所以不会和0冲突
+ */
+static const uint32_t TIMER_TAG_FIRE = 0;	//下一次发单
+
 /*
  *	订单管理器
  */
 class WtOrdMon
 {
 public:
+	WtOrdMon() :_ctx(NULL), _expire_secs(0), _timer_driven(false) {}
+
+	/*
+	 *	绑定执行环境和订单超时时间
+	 *	如果执行器支持定时器,添加订单的时候就注册一个超时事件,到期以后由执行单元的on_timer转给这里处理
+	 *	这样就不需要每笔tick都扫描一遍全部订单了,没有行情的合约也能按时撤单
+	 */
+	void attach(ExecuteContext* ctx, const char* stdCode, uint32_t expiresecs);
+
+	/*
+	 *	超时是否由定时器驱动,是的话check_orders直接返回
+	 */
+	inline bool is_timer_driven() const { return _timer_driven; }
+
 	/*
 	 *	添加订单
 	 *
@@ -40,17 +63,32 @@ public:
 
 	void check_orders(uint32_t expiresecs, uint64_t curTime, EnumOrderCallback callback);
 
-	inline void clear_orders()
-	{
-		_orders.clear();
-	}
+	/*
+	 *	订单超时事件
+	 *	订单还在并且可以撤销,则回调
+	 *
+	 *	返回值	是否是本管理器注册的定时器
+	 */
+	bool on_timer(uint32_t localid, EnumOrderCallback callback);
+
+	void clear_orders();
 
 	void enumOrder(EnumAllOrderCallback cb);
 
 private:
-	typedef std::pair<uint64_t, bool> OrderPair;	//uint64_t - entertime, bool - cancancel
-	typedef std::unordered_map<uint32_t, OrderPair> IDMap;
+	typedef struct _OrderInfo
+	{
+		uint64_t	_enter_time;
+		bool		_can_cancel;
+		uint64_t	_timerid;		//超时定时器,0为没有
+	} OrderInfo;
+	typedef std::unordered_map<uint32_t, OrderInfo> IDMap;
 	IDMap			_orders;
 	StdRecurMutex	_mtx_ords;
+
+	ExecuteContext*	_ctx;
+	std::string		_code;
+	uint32_t		_expire_secs;
+	bool			_timer_driven;
 };
 
@@ -16,6 +16,9 @@ WtStockVWapExeUnit::WtStockVWapExeUnit()
 	, _cancel_cnt(0)
 	, _channel_ready(false)
 	, _last_fire_time(0)
+	, _fire_timer(0)
+	, _profile(NULL)
+	, _start_pos(0)
 	, _fired_times(0)
 	, _total_times(0)
 	, _total_secs(0)
@@ -106,6 +109,7 @@ void WtStockVWapExeUnit::init(ExecuteContext * ctx, const char * stdCode, WTSVar
 	_begin_time = cfg->getUInt32("begin_time");
 	_end_time = cfg->getUInt32("end_time");
 	_ord_sticky = cfg->getUInt32("ord_sticky");	//挂单时限
+	_orders_mon.attach(ctx, stdCode, _ord_sticky);
 	_tail_secs = cfg->getUInt32("tail_secs");	//执行尾部时间
 	_total_times = cfg->getUInt32("total_times");//总执行次数
 	_price_mode = cfg->getUInt32("price_mode");
@@ -135,6 +139,31 @@ void WtStockVWapExeUnit::init(ExecuteContext * ctx, const char * stdCode, WTSVar
 	// 确定T0交易模式
 	if (_comm_info->getTradingMode() == TradingMode::TM_Long)
 		_is_t0 = true;
+	/*
+	 *	优先使用WtDtServo::build_vol_profiles生成的曲线文件,文件在进程内只映射一次
+	 *	先按标准代码查找,再按品种代码查找,都找不到再读原来的文本文件
+	 */
+	const char* profile = cfg->getCString("profile");
+	if (strlen(profile) > 0)
+	{
+		_profile_store = WtVolProfileStore::shared(profile);
+		//曲线的分钟数要按交易时间模板换算,没有模板就不用曲线
+		if (_profile_store && _sess_info)
+		{
+			_profile = _profile_store->get(stdCode);
+			if (_profile == NULL)
+				_profile = _profile_store->get(_comm_info->getFullPid());
+		}
+
+		if (_profile != NULL)
+		{
+			_ctx->writeLog(fmtutil::format("Volume profile of {} loaded from {}", stdCode, profile));
+			return;
+		}
+
+		_ctx->writeLog(fmtutil::format("Volume profile of {} not found in {}, text file will be used", stdCode, profile));
+	}
+
 	std::string filename = "Vwap_";
 	filename += _comm_info->getName();
 	filename += ".txt";
@@ -267,8 +296,12 @@ void WtStockVWapExeUnit::on_tick(WTSTickData * newTick)
 			do_calc();
 		}
 	}
-	else
+	else if (_fire_timer == 0)
 	{
+		/*
+		 *	执行器支持定时器的话,订单超时和下一次发单都由on_timer触发
+		 *	只有没有挂起的发单定时器的时候,才由行情驱动,不支持定时器的执行器会一直走这里
+		 */
 		uint64_t now = TimeUtils::getLocalTimeNow();
 		bool hasCancel = false;
 		if (_ord_sticky != 0 && _orders_mon.has_order())
@@ -403,7 +436,11 @@ void WtStockVWapExeUnit::do_calc()
 	}
 	_last_tick_time = curTickTime;
 	double InminsTm = calTmStamp(_last_tick->actiontime());//当前tick属于vwap240分钟内的第几(-1)分钟
-	double aimQty = VwapAim[InminsTm];//取到对应时刻的目标vwapaim （递增）
+	double aimQty = 0;
+	if (_profile != NULL)
+		aimQty = _start_pos + (newVol - _start_pos) * profile_ratio(_last_tick->actiontime() / 100000);//按曲线从起始仓位向目标仓位插值
+	else
+		aimQty = VwapAim[InminsTm];//取到对应时刻的目标vwapaim （递增）
 
 	uint32_t leftTimes = _total_times - _fired_times;
 	_ctx->writeLog(fmt::format("第 {} 次发单", _fired_times + 1).c_str());
@@ -495,6 +532,8 @@ void WtStockVWapExeUnit::do_calc()
 	_last_fire_time = now;
 	_fired_times += 1;
 
+	schedule_fire(_fire_span * 1000);
+
 	curTick->release();
 }
 
@@ -561,6 +600,7 @@ void WtStockVWapExeUnit::set_position(const char * stdCode, double newVol)
 		return;
 	}
 	_target_pos = newVol;
+	_start_pos = _ctx->getPosition(stdCode);
 
 	_target_mode = TargetMode::stocks;
 	_is_finish = false;
@@ -578,6 +618,45 @@ void WtStockVWapExeUnit::set_position(const char * stdCode, double newVol)
 void WtStockVWapExeUnit::on_channel_lost()
 {
 }
+
+double WtStockVWapExeUnit::profile_ratio(uint32_t curTime)
+{
+	return WtVolProfileStore::window_ratio(_profile, _profile_store->bins(), _sess_info, _begin_time, _end_time, curTime);
+}
+
+void WtStockVWapExeUnit::schedule_fire(uint32_t delay)
+{
+	if (_fire_timer != 0)
+		_ctx->cancelTimer(_fire_timer);
+
+	_fire_timer = _ctx->scheduleTimer(_code.c_str(), delay, TIMER_TAG_FIRE);
+}
+
+void WtStockVWapExeUnit::on_timer(const char* stdCode, uint32_t tag)
+{
+	if (tag != TIMER_TAG_FIRE)
+	{
+		//订单超时,标记就是本地订单号
+		_orders_mon.on_timer(tag, [this](uint32_t localid) {
+			if (_ctx->cancel(localid))
+			{
+				_cancel_cnt++;
+				_ctx->writeLog(fmt::format("Order {} expired, cancelcnt updated to {}", localid, _cancel_cnt).c_str());
+			}
+		});
+		return;
+	}
+
+	_fire_timer = 0;
+	uint64_t now = TimeUtils::getLocalTimeNow();
+	if (now - _last_fire_time >= _fire_span * 1000)
+		do_calc();
+
+	//本轮没有发单,一般是还有撤单或者挂单没完成,过1秒再检查一次
+	if (_fire_timer == 0 && !decimal::eq(get_real_target(_target_pos), _ctx->getPosition(stdCode)))
+		schedule_fire(1000);
+}
+
 void WtStockVWapExeUnit::clear_all_position(const char* stdCode) {
 	if (_code.compare(stdCode) != 0)
 		return;
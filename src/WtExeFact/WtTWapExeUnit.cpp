@@ -21,6 +21,7 @@ WtTWapExeUnit::WtTWapExeUnit()
 	, _cancel_cnt(0)
 	, _channel_ready(false)
 	, _last_fire_time(0)
+	, _fire_timer(0)
 	, _fired_times(0)
 	, _total_times(0)
 	, _total_secs(0)
@@ -82,6 +83,7 @@ void WtTWapExeUnit::init(ExecuteContext* ctx, const char* stdCode, WTSVariant* c
 	if (_sess_info)
 		_sess_info->retain();
 	_ord_sticky = cfg->getUInt32("ord_sticky");
+	_orders_mon.attach(ctx, stdCode, _ord_sticky);
 	_begin_time= cfg->getUInt32("begin_time");
 	_end_time = cfg->getUInt32("end_time");
 	_total_secs = cfg->getUInt32("total_secs");
@@ -191,6 +193,39 @@ void WtTWapExeUnit::on_channel_lost()
 
 }
 
+void WtTWapExeUnit::schedule_fire(uint32_t delay)
+{
+	if (_fire_timer != 0)
+		_ctx->cancelTimer(_fire_timer);
+
+	_fire_timer = _ctx->scheduleTimer(_code.c_str(), delay, TIMER_TAG_FIRE);
+}
+
+void WtTWapExeUnit::on_timer(const char* stdCode, uint32_t tag)
+{
+	if (tag != TIMER_TAG_FIRE)
+	{
+		//订单超时,标记就是本地订单号
+		_orders_mon.on_timer(tag, [this](uint32_t localid) {
+			if (_ctx->cancel(localid))
+			{
+				_cancel_cnt++;
+				_ctx->writeLog(fmt::format("Order {} expired, cancelcnt updated to {}", localid, _cancel_cnt).c_str());
+			}
+		});
+		return;
+	}
+
+	_fire_timer = 0;
+	uint64_t now = TimeUtils::getLocalTimeNow();
+	if (now - _last_fire_time >= _fire_span * 1000)
+		do_calc();
+
+	//本轮没有发单,一般是还有撤单或者挂单没完成,过1秒再检查一次
+	if (_fire_timer == 0 && !decimal::eq(get_real_target(_target_pos), _ctx->getPosition(stdCode)))
+		schedule_fire(1000);
+}
+
 
 void WtTWapExeUnit::on_tick(WTSTickData* newTick)
 {
@@ -234,8 +269,12 @@ void WtTWapExeUnit::on_tick(WTSTickData* newTick)
 			do_calc();
 		}
 	}
-	else
+	else if (_fire_timer == 0)
 	{
+		/*
+		 *	执行器支持定时器的话,订单超时和下一次发单都由on_timer触发
+		 *	只有没有挂起的发单定时器的时候,才由行情驱动,不支持定时器的执行器会一直走这里
+		 */
 		uint64_t now = TimeUtils::getLocalTimeNow();
 		bool hasCancel = false;
 		if (_ord_sticky != 0 && _orders_mon.has_order()) 
@@ -499,6 +538,8 @@ void WtTWapExeUnit::do_calc()
 	_last_fire_time = now;
 	_fired_times += 1;
 
+	schedule_fire(_fire_span * 1000);
+
 	curTick->release();
 }
 
@@ -14,6 +14,7 @@ public:
 private:
 	void	do_calc();
 	void	fire_at_once(double qty);
+	void	schedule_fire(uint32_t delay);
 
 public:
 	/*
@@ -81,6 +82,11 @@ public:
 	*/
 	virtual void on_channel_lost() override;
 
+	/*
+	*	定时事件回调,订单超时和下一次发单
+	*/
+	virtual void on_timer(const char* stdCode, uint32_t tag) override;
+
 
 private:
 	WTSTickData*	 _last_tick;	//上一笔行情
@@ -119,6 +125,7 @@ private:
 	uint32_t		_fire_span;		//发单间隔//ms
 	uint32_t		_fired_times;	//已执行次数
 	uint64_t		_last_fire_time; //上次已执行的时间
+	uint64_t		_fire_timer;	//下一次发单的定时器,0为没有
 	uint64_t		_last_place_time;//上个下单时间
 	uint64_t		_last_tick_time;//上个tick时间
 	std::atomic<bool> _in_calc;
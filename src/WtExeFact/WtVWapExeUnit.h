@@ -3,6 +3,7 @@
 23.5.23--zhaoyv--VWAP
 */
 #include "WtOrdMon.h"
+#include "../Share/WtVolProfile.hpp"
 #include "../Includes/ExecuteDefs.h"
 #include "../Share/StdUtils.hpp"
 #include <fstream>
@@ -18,6 +19,12 @@ public:
 private:
 	void	do_calc();
 	void	fire_at_once(double qty);
+	void	schedule_fire(uint32_t delay);
+
+	/*
+	 *	根据成交量分布曲线,计算执行时段内截止到curTime(HHMM)应完成的比例
+	 */
+	double	profile_ratio(uint32_t curTime);
 
 public:
 	/*
@@ -85,6 +92,11 @@ public:
 	*/
 	virtual void on_channel_lost() override;
 
+	/*
+	*	定时事件回调,订单超时和下一次发单
+	*/
+	virtual void on_timer(const char* stdCode, uint32_t tag) override;
+
 private:
 	WTSTickData* _last_tick;	//上一笔行情
 	double		_target_pos;	//目标仓位
@@ -102,6 +114,9 @@ private:
 	WtOrdMon		_orders_mon;
 	uint32_t		_cancel_cnt;
 	vector<double>	VwapAim;			//分钟记，目标VWap预测 总报单量
+	WtVolProfileStorePtr	_profile_store;	//成交量分布曲线存储,所有执行单元共享
+	const float*	_profile;			//本合约的累计成交量占比曲线,为NULL则用VwapAim
+	double			_start_pos;			//设置目标仓位时的仓位
 	//////////////////////////////////////////////////////////////////////////
 	//参数
 	uint32_t		_total_secs;	//执行总时间,单位s
@@ -121,6 +136,7 @@ private:
 	uint32_t		_fire_span;		//发单间隔//ms
 	uint32_t		_fired_times;	//已执行次数
 	uint64_t		_last_fire_time; //上次已执行的时间
+	uint64_t		_fire_timer;	//下一次发单的定时器,0为没有
 	uint64_t		_last_place_time;//上个下单时间
 	uint64_t		_last_tick_time;//上个tick时间
 	double			_Vwap_vol ;		//vwap单位时间下单量
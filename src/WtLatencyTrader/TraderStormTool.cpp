@@ -0,0 +1,390 @@
+﻿/*!
+ * \file TraderStormTool.cpp
+ * \project	WonderTrader
+ *
+ * \brief
+ */
+#include "TraderStormTool.h"
+#include "../WtCore/WtHelper.h"
+
+#include "../Includes/WTSVariant.hpp"
+#include "../Includes/WTSContractInfo.hpp"
+
+#include "../WTSTools/WTSLogger.h"
+#include "../WTSUtils/WTSCfgLoader.h"
+
+#include "../Share/StdUtils.hpp"
+#include "../Share/DLLHelper.hpp"
+#include "../Share/CodeHelper.hpp"
+#include "../Share/StrUtil.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <deque>
+#include <random>
+#include <thread>
+#include <chrono>
+
+inline int64_t steady_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* getBinDir()
+{
+	static std::string basePath;
+	if (basePath.empty())
+	{
+		basePath = boost::filesystem::initial_path<boost::filesystem::path>().string();
+
+		basePath = StrUtil::standardisePath(basePath);
+	}
+
+	return basePath.c_str();
+}
+
+typedef bool(*FuncReplayJournal)(const char* filename, uint64_t* trades, uint64_t* digest);
+
+void test_storm()
+{
+	TraderStormTool tool;
+	if (!tool.init())
+		return;
+
+	tool.run();
+}
+
+//////////////////////////////////////////////////////////////////////////
+//StormSink
+void StormSink::on_sent(uint32_t localid, int64_t sendNs)
+{
+	SpinLock lock(_mtx);
+	StormSlot& slot = _slots[localid % STORM_SLOT_COUNT];
+	slot._localid = localid;
+	slot._send_ns = sendNs;
+	slot._cancel_ns = 0;
+	slot._acked = false;
+	slot._filled = false;
+	_sent++;
+}
+
+void StormSink::on_cancel_sent(uint32_t localid, int64_t sendNs)
+{
+	SpinLock lock(_mtx);
+	StormSlot& slot = _slots[localid % STORM_SLOT_COUNT];
+	if (slot._localid == localid)
+		slot._cancel_ns = sendNs;
+}
+
+void StormSink::on_order(uint32_t localid, const char* stdCode, bool isBuy, double totalQty, double leftQty, double price, bool isCanceled /* = false */)
+{
+	int64_t now = steady_ns();
+	SpinLock lock(_mtx);
+	StormSlot& slot = _slots[localid % STORM_SLOT_COUNT];
+	//回报比登记还早到,或者槽位已经被后面的订单占用了,都不统计
+	if (slot._localid != localid)
+		return;
+
+	if (!slot._acked)
+	{
+		slot._acked = true;
+		_acked++;
+		_ack_lat.record((uint64_t)(now - slot._send_ns));
+	}
+
+	if (isCanceled)
+	{
+		//没有发过撤单的,就是撮合所拒单
+		if (slot._cancel_ns != 0)
+		{
+			_canceled++;
+			_cancel_lat.record((uint64_t)(now - slot._cancel_ns));
+		}
+		else
+		{
+			_rejected++;
+		}
+		slot._localid = 0;
+	}
+}
+
+void StormSink::on_trade(uint32_t localid, const char* stdCode, bool isBuy, double vol, double price)
+{
+	int64_t now = steady_ns();
+	SpinLock lock(_mtx);
+	_trades++;
+	StormSlot& slot = _slots[localid % STORM_SLOT_COUNT];
+	if (slot._localid != localid || slot._filled)
+		return;
+
+	slot._filled = true;
+	_filled++;
+	_fill_lat.record((uint64_t)(now - slot._send_ns));
+}
+
+void StormSink::on_entrust(uint32_t localid, const char* stdCode, bool bSuccess, const char* message)
+{
+	if (bSuccess)
+		return;
+
+	SpinLock lock(_mtx);
+	_rejected++;
+	StormSlot& slot = _slots[localid % STORM_SLOT_COUNT];
+	if (slot._localid == localid)
+		slot._localid = 0;
+}
+
+void StormSink::report(double seconds)
+{
+	SpinLock lock(_mtx);
+	WTSLogger::warn("[{}] {} orders sent in {:.2f}s, {:.0f} orders/s, {} acked, {} rejected, {} canceled, {} filled with {} trades",
+		_id, _sent, seconds, _sent / seconds, _acked, _rejected, _canceled, _filled, _trades);
+	WTSLogger::warn("[{}] ack latency(ns): {}", _id, _ack_lat.summary());
+	WTSLogger::warn("[{}] fill latency(ns): {}", _id, _fill_lat.summary());
+	WTSLogger::warn("[{}] cancel latency(ns): {}", _id, _cancel_lat.summary());
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//TraderStormTool
+TraderStormTool::TraderStormTool()
+	: _price(0)
+	, _spread(0)
+	, _rate(1000)
+	, _duration(10)
+	, _cancel_ratio(0)
+	, _cancel_lag(16)
+{
+}
+
+TraderStormTool::~TraderStormTool()
+{
+}
+
+bool TraderStormTool::init()
+{
+	WTSLogger::init("logcfg.yaml");
+	WtHelper::setInstDir(getBinDir());
+
+	WTSVariant* config = WTSCfgLoader::load_from_file("config.yaml");
+	if (config == NULL)
+	{
+		WTSLogger::log_raw(LL_ERROR, "Loading config file config.yaml failed");
+		return false;
+	}
+
+	//基础数据文件
+	WTSVariant* cfgBF = config->get("basefiles");
+	if (cfgBF->get("session"))
+		_bd_mgr.loadSessions(cfgBF->getCString("session"));
+
+	if (cfgBF->get("commodity"))
+		_bd_mgr.loadCommodities(cfgBF->getCString("commodity"));
+
+	if (cfgBF->get("contract"))
+		_bd_mgr.loadContracts(cfgBF->getCString("contract"));
+
+	if (StdFile::exists("actpolicy.yaml"))
+		_act_mgr.init("actpolicy.yaml");
+
+	WTSVariant* cfgStorm = config->get("storm");
+	_code = cfgStorm->getCString("code");
+	_price = cfgStorm->getDouble("price");
+	_spread = cfgStorm->getUInt32("spread");
+	if (cfgStorm->has("rate"))
+		_rate = std::max(cfgStorm->getUInt32("rate"), (uint32_t)1);
+	if (cfgStorm->has("duration"))
+		_duration = cfgStorm->getUInt32("duration");
+	_cancel_ratio = cfgStorm->getDouble("cancel_ratio");
+	if (cfgStorm->has("cancel_lag"))
+		_cancel_lag = cfgStorm->getUInt32("cancel_lag");
+
+	WTSLogger::warn("Storm on {}: {} orders/s per account, {}s, {} ticks around {}, cancel ratio {}",
+		_code, _rate, _duration, _spread, _price, _cancel_ratio);
+
+	bool bSucc = initTraders(config->get("traders"));
+	config->release();
+	return bSucc;
+}
+
+bool TraderStormTool::initTraders(WTSVariant* cfg)
+{
+	if (cfg == NULL || cfg->type() != WTSVariant::VT_Array)
+		return false;
+
+	for (uint32_t idx = 0; idx < cfg->size(); idx++)
+	{
+		WTSVariant* cfgItem = cfg->get(idx);
+		if (!cfgItem->getBoolean("active"))
+			continue;
+
+		const char* id = cfgItem->getCString("id");
+
+		TraderAdapterPtr adapter(new TraderAdapter());
+		if (!adapter->init(id, cfgItem, &_bd_mgr, &_act_mgr))
+		{
+			WTSLogger::error("Initializing trader {} failed", id);
+			return false;
+		}
+
+		StormSinkPtr sink(new StormSink(id));
+		adapter->addSink(sink.get());
+
+		_traders.addAdapter(id, adapter);
+		_adapters.emplace_back(adapter);
+		_sinks.emplace_back(sink);
+
+		WTSVariant* cfgExchg = cfgItem->get("exchange");
+		if (cfgExchg && _journal.empty())
+			_journal = cfgExchg->getCString("journal");
+
+		if (_module.empty())
+			_module = cfgItem->getCString("module");
+	}
+
+	WTSLogger::warn("{} accounts loaded", _adapters.size());
+	return !_adapters.empty();
+}
+
+void TraderStormTool::storm(uint32_t idx)
+{
+	TraderAdapterPtr adapter = _adapters[idx];
+	StormSinkPtr sink = _sinks[idx];
+
+	CodeHelper::CodeInfo codeInfo = CodeHelper::extractStdCode(_code.c_str(), NULL);
+	WTSContractInfo* cInfo = _bd_mgr.getContract(codeInfo._code, codeInfo._exchg);
+	if (cInfo == NULL)
+	{
+		WTSLogger::error("Instrument {} not exists", _code);
+		return;
+	}
+
+	double pricetick = cInfo->getCommInfo()->getPriceTick();
+
+	//每个账户的随机序列是固定的,同样的配置每次发出的委托序列一样
+	std::mt19937 rng(idx + 1);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	std::deque<uint32_t> recent;
+
+	int64_t interval = 1000000000LL / _rate;
+	int64_t start = steady_ns();
+	int64_t end = start + (int64_t)_duration * 1000000000LL;
+	int64_t next = start;
+	uint64_t n = 0;
+	for (;;)
+	{
+		int64_t now = steady_ns();
+		if (now >= end)
+			break;
+
+		if (now < next)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		//落后太多就不补发了,实际的发单速率在报告里体现
+		next += interval;
+		if (next + 1000000000LL < now)
+			next = now;
+
+		int32_t offset = (int32_t)(rng() % (2 * _spread + 1)) - (int32_t)_spread;
+		double price = _price + offset * pricetick;
+		bool isBuy = ((idx + n) & 1) == 0;
+		n++;
+
+		int64_t sendNs = steady_ns();
+		uint32_t localid = isBuy ? adapter->openLong(_code.c_str(), price, 1, 0, cInfo) : adapter->openShort(_code.c_str(), price, 1, 0, cInfo);
+		if (localid == UINT_MAX)
+			continue;
+
+		sink->on_sent(localid, sendNs);
+
+		//撤若干笔之前的订单,这时候大部分订单已经确认了
+		recent.emplace_back(localid);
+		if (recent.size() > _cancel_lag)
+		{
+			uint32_t oldid = recent.front();
+			recent.pop_front();
+			if (_cancel_ratio > 0 && uniform(rng) < _cancel_ratio)
+			{
+				//还没确认的订单TraderAdapter里查不到,撤单会失败
+				int64_t cancelNs = steady_ns();
+				if (adapter->cancel(oldid))
+					sink->on_cancel_sent(oldid, cancelNs);
+			}
+		}
+	}
+}
+
+void TraderStormTool::run()
+{
+	_traders.run();
+
+	//等所有账户就绪
+	int64_t deadline = steady_ns() + 30 * 1000000000LL;
+	for (;;)
+	{
+		bool bAllReady = true;
+		for (TraderAdapterPtr& adapter : _adapters)
+			bAllReady = bAllReady && adapter->isReady();
+
+		if (bAllReady)
+			break;
+
+		if (steady_ns() > deadline)
+		{
+			WTSLogger::error("Not all accounts are ready in 30s");
+			return;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+
+	WTSLogger::warn("All accounts ready, storm begins");
+
+	int64_t start = steady_ns();
+	std::vector<StdThreadPtr> threads;
+	for (uint32_t idx = 0; idx < _adapters.size(); idx++)
+	{
+		threads.emplace_back(new StdThread([this, idx]() {
+			storm(idx);
+		}));
+	}
+
+	for (StdThreadPtr& thrd : threads)
+		thrd->join();
+
+	double seconds = (steady_ns() - start) / 1e9;
+
+	//等在途的回报处理完
+	std::this_thread::sleep_for(std::chrono::seconds(1));
+
+	uint64_t total = 0;
+	for (StormSinkPtr& sink : _sinks)
+	{
+		sink->report(seconds);
+		total += sink->_sent;
+	}
+	WTSLogger::warn("{} orders sent by {} accounts in {:.2f}s, {:.0f} orders/s in total", total, _sinks.size(), seconds, total / seconds);
+
+	//最后一个账户退出以后撮合所才会写完事件日志
+	_traders.release();
+
+	if (!_journal.empty() && !_module.empty())
+	{
+		std::string module = DLLHelper::wrap_module(_module.c_str(), "lib");
+		std::string dllpath = WtHelper::getModulePath(module.c_str(), "traders", true);
+		if (!StdFile::exists(dllpath.c_str()))
+			dllpath = WtHelper::getModulePath(module.c_str(), "traders", false);
+
+		DllHandle hInst = DLLHelper::load_library(dllpath.c_str());
+		FuncReplayJournal funcReplay = (hInst == NULL) ? NULL : (FuncReplayJournal)DLLHelper::get_symbol(hInst, "replayMockJournal");
+		if (funcReplay)
+		{
+			uint64_t trades = 0, digest = 0;
+			bool bMatched = funcReplay(_journal.c_str(), &trades, &digest);
+			WTSLogger::warn("Journal {} replayed: {} trades, digest {:016x}, {}", _journal, trades, digest, bMatched ? "matched" : "NOT matched");
+		}
+	}
+}
@@ -0,0 +1,129 @@
+﻿/*!
+ * \file TraderStormTool.h
+ * \project	WonderTrader
+ *
+ * \brief 交易通道压力测试工具
+ *
+ * 通过TraderAdapter按固定速率向交易通道持续发单,统计委托确认、成交和撤单的端到端延迟以及吞吐
+ * 一般配合TraderMocker的本地撮合所使用,多个账户共享同一个撮合所,全部在本机完成
+ */
+#pragma once
+#include "../WtCore/TraderAdapter.h"
+#include "../WtCore/ActionPolicyMgr.h"
+#include "../WtCore/ITrdNotifySink.h"
+
+#include "../WTSTools/WTSBaseDataMgr.h"
+
+#include "../Share/SpinMutex.hpp"
+#include "../Share/WtLatencyHistogram.hpp"
+
+#include <atomic>
+#include <vector>
+
+NS_WTP_BEGIN
+class WTSVariant;
+NS_WTP_END
+
+USING_NS_WTP;
+
+//每个账户跟踪的在途订单数,按本地订单号取模
+#define STORM_SLOT_COUNT	65536
+
+/*
+ *	单个账户的回报统计
+ */
+class StormSink : public ITrdNotifySink
+{
+public:
+	StormSink(const char* id) :_id(id), _ready(false), _sent(0), _acked(0), _rejected(0)
+		, _canceled(0), _filled(0), _trades(0), _slots(STORM_SLOT_COUNT) {}
+
+	/*
+	 *	发单以后登记发送时间
+	 */
+	void	on_sent(uint32_t localid, int64_t sendNs);
+	void	on_cancel_sent(uint32_t localid, int64_t sendNs);
+
+	void	report(double seconds);
+
+public:
+	virtual void on_trade(uint32_t localid, const char* stdCode, bool isBuy, double vol, double price) override;
+
+	virtual void on_order(uint32_t localid, const char* stdCode, bool isBuy, double totalQty, double leftQty, double price, bool isCanceled = false) override;
+
+	virtual void on_channel_ready() override { _ready = true; }
+
+	virtual void on_channel_lost() override { _ready = false; }
+
+	virtual void on_entrust(uint32_t localid, const char* stdCode, bool bSuccess, const char* message) override;
+
+public:
+	std::string			_id;
+	std::atomic<bool>	_ready;
+
+	uint64_t	_sent;
+	uint64_t	_acked;
+	uint64_t	_rejected;
+	uint64_t	_canceled;
+	uint64_t	_filled;	//有成交的订单数
+	uint64_t	_trades;	//成交回报数
+
+private:
+	typedef struct _StormSlot
+	{
+		uint32_t	_localid;
+		int64_t		_send_ns;
+		int64_t		_cancel_ns;
+		bool		_acked;
+		bool		_filled;
+
+		_StormSlot() :_localid(0), _send_ns(0), _cancel_ns(0), _acked(false), _filled(false) {}
+	} StormSlot;
+
+	//发单线程和回报线程都会访问
+	SpinMutex				_mtx;
+	std::vector<StormSlot>	_slots;
+
+	WtLatencyHistogram	_ack_lat;		//发单到第一笔订单回报
+	WtLatencyHistogram	_fill_lat;		//发单到第一笔成交回报
+	WtLatencyHistogram	_cancel_lat;	//撤单到撤单回报
+};
+typedef std::shared_ptr<StormSink> StormSinkPtr;
+
+class TraderStormTool
+{
+public:
+	TraderStormTool();
+	~TraderStormTool();
+
+public:
+	bool	init();
+
+	void	run();
+
+private:
+	bool	initTraders(WTSVariant* cfg);
+
+	/*
+	 *	单个账户的发单线程
+	 */
+	void	storm(uint32_t idx);
+
+private:
+	TraderAdapterMgr	_traders;
+	WTSBaseDataMgr		_bd_mgr;
+	ActionPolicyMgr		_act_mgr;
+
+	std::vector<TraderAdapterPtr>	_adapters;
+	std::vector<StormSinkPtr>		_sinks;
+
+	std::string		_code;		//标准代码
+	double			_price;		//中间价
+	uint32_t		_spread;	//委托价在中间价上下浮动的最大跳数
+	uint32_t		_rate;		//每个账户每秒的发单笔数
+	uint32_t		_duration;	//持续秒数
+	double			_cancel_ratio;	//撤单比例,撤的是若干笔之前发出的订单
+	uint32_t		_cancel_lag;
+	std::string		_journal;	//撮合所的事件日志,结束以后回放校验
+	std::string		_module;
+};
@@ -0,0 +1,17 @@
+﻿/*!
+ * /file main.cpp
+ * /project	WonderTrader
+ *
+ * /brief 
+ */
+
+#include "../WTSTools/WTSLogger.h"
+
+extern void test_storm();
+
+int main()
+{
+	test_storm();
+	WTSLogger::stop();
+	return 0;
+}
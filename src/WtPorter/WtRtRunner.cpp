@@ -317,7 +317,9 @@ uint32_t WtRtRunner::createCtaContext(const char* name, int32_t slippage /* = 0
 uint32_t WtRtRunner::createHftContext(const char* name, const char* trader, bool bAgent, int32_t slippage /* = 0 */)
 {
 	ExpHftContext* ctx = new ExpHftContext(&_hft_engine, name, bAgent, slippage);
-	_hft_engine.addContext(HftContextPtr(ctx));
+	//交易通道已经被工作线程里的策略占用的时候,不能再在行情线程里使用
+	if (!_hft_engine.addContext(HftContextPtr(ctx), -1, trader))
+		return 0;
 	TraderAdapterPtr trdPtr = _traders.getAdapter(trader);
 	if(trdPtr)
 	{
@@ -811,19 +813,23 @@ bool WtRtRunner::initHftStrategies()
 		HftStraContext* ctx = new HftStraContext(&_hft_engine, id, bAgent, slippage);
 		ctx->set_strategy(stra->self());
 
+		//配置了core的策略在独立的工作线程里运行,交易回报也要转到工作线程里
+		//同一个交易通道的策略要在同一个线程里,否则不加载
 		const char* traderid = cfgItem->getCString("trader");
+		int32_t core = cfgItem->has("core") ? cfgItem->getInt32("core") : -1;
+		if (!_hft_engine.addContext(HftContextPtr(ctx), core, traderid))
+			continue;
+
 		TraderAdapterPtr trader = _traders.getAdapter(traderid);
 		if (trader)
 		{
 			ctx->setTrader(trader.get());
-			trader->addSink(ctx);
+			trader->addSink(_hft_engine.getTradeSink(ctx->id(), ctx));
 		}
 		else
 		{
 			WTSLogger::error("Trader {} not exists, Binding trader to HFT strategy failed", traderid);
 		}
-
-		_hft_engine.addContext(HftContextPtr(ctx));
 	}
 
 	return true;
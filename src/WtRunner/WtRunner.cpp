@@ -346,19 +346,23 @@ bool WtRunner::initHftStrategies()
 		HftStraContext* ctx = new HftStraContext(&_hft_engine, id, agent,slippage);
 		ctx->set_strategy(stra->self());
 
+		//配置了core的策略在独立的工作线程里运行,交易回报也要转到工作线程里
+		//同一个交易通道的策略要在同一个线程里,否则不加载
 		const char* traderid = cfgItem->getCString("trader");
+		int32_t core = cfgItem->has("core") ? cfgItem->getInt32("core") : -1;
+		if (!_hft_engine.addContext(HftContextPtr(ctx), core, traderid))
+			continue;
+
 		TraderAdapterPtr trader = _traders.getAdapter(traderid);
 		if(trader)
 		{
 			ctx->setTrader(trader.get());
-			trader->addSink(ctx);
+			trader->addSink(_hft_engine.getTradeSink(ctx->id(), ctx));
 		}
 		else
 		{
 			WTSLogger::error("Trader {} not exists, binding trader to HFT strategy failed", traderid);
 		}
-
-		_hft_engine.addContext(HftContextPtr(ctx));
 	}
 
 	return true;
@@ -17,6 +17,7 @@
 #include "../Includes/IBaseDataMgr.h"
 
 #include "../Share/StrUtil.hpp"
+#include "../Share/WtTickTrace.hpp"
 
 #include "../WTSTools/WTSLogger.h"
 
@@ -28,6 +29,7 @@ ParserAdapter::ParserAdapter()
 	: _parser_api(NULL)
 	, _remover(NULL)
 	, _stopped(false)
+	, _sub_filtered(false)
 	, _bd_mgr(NULL)
 	, _stub(NULL)
 	, _cfg(NULL)
@@ -125,6 +127,7 @@ bool ParserAdapter::init(const char* id, WTSVariant* cfg, IParserStub* stub, IBa
 		if (_parser_api->init(cfg))
 		{
 			ContractSet contractSet;
+			_sub_filtered = !_code_filter.empty() || !_exchg_filter.empty();
 			WTSArray* ay = _bd_mgr->getContracts();
 			for(auto it = ay->begin(); it != ay->end(); it++)
 			{
@@ -138,6 +141,7 @@ bool ParserAdapter::init(const char* id, WTSVariant* cfg, IParserStub* stub, IBa
 					if (cit != _code_filter.end() || pit != _code_filter.end())
 					{
 						contractSet.insert(cInfo->getFullCode());
+						add_sub_bit(cInfo);
 						continue;
 					}
 				}
@@ -149,6 +153,7 @@ bool ParserAdapter::init(const char* id, WTSVariant* cfg, IParserStub* stub, IBa
 					if (eit != _exchg_filter.end())
 					{
 						contractSet.insert(cInfo->getFullCode());
+						add_sub_bit(cInfo);
 						continue;
 					}
 					else
@@ -209,6 +214,7 @@ bool ParserAdapter::initExt(const char* id, IParserApi* api, IParserStub* stub,
 					if (cit != _code_filter.end() || pit != _code_filter.end())
 					{
 						contractSet.insert(cInfo->getFullCode());
+						add_sub_bit(cInfo);
 						continue;
 					}
 				}
@@ -220,6 +226,7 @@ bool ParserAdapter::initExt(const char* id, IParserApi* api, IParserStub* stub,
 					if (eit != _code_filter.end())
 					{
 						contractSet.insert(cInfo->getFullCode());
+						add_sub_bit(cInfo);
 						continue;
 					}
 					else
@@ -269,14 +276,39 @@ bool ParserAdapter::run()
 	return true;
 }
 
+void ParserAdapter::add_sub_bit(WTSContractInfo* cInfo)
+{
+	if (!WtSubBitset::is_valid(cInfo->getTotalIndex()))
+		WTSLogger::log_dyn("parser", _id.c_str(), LL_WARN, "[{}] Instrument {} has no valid index, will be filtered", _id.c_str(), cInfo->getFullCode());
+	else
+		_sub_bits.set(cInfo->getTotalIndex());
+}
+
+bool ParserAdapter::is_subscribed(WTSContractInfo* cInfo) const
+{
+	if (!_sub_filtered || _sub_bits.test(cInfo->getTotalIndex()))
+		return true;
+
+	//初始化以后才加入基础数据的合约不在位图里,和初始化时一样按合约、品种、交易所判断一次,符合的补到位图里
+	bool bMatch = _code_filter.find(cInfo->getFullCode()) != _code_filter.end()
+		|| _code_filter.find(cInfo->getFullPid()) != _code_filter.end()
+		|| _exchg_filter.find(cInfo->getExchg()) != _exchg_filter.end();
+
+	if (bMatch)
+		_sub_bits.set(cInfo->getTotalIndex());
+	return bMatch;
+}
+
 void ParserAdapter::handleQuote(WTSTickData *quote, uint32_t procFlag)
 {
 	if (quote == NULL || _stopped || quote->actiondate() == 0)
 		return;
 
+	WT_TRACE_STAMP(quote, TTS_PARSER_ADAPTER);
+
 	WTSContractInfo* cInfo = quote->getContractInfo();
 	if (cInfo == NULL) cInfo = _bd_mgr->getContract(quote->code(), quote->exchg());
-	if (cInfo == NULL)
+	if (cInfo == NULL || !is_subscribed(cInfo))
 		return;
 
 	quote->setCode(cInfo->getFullCode());
@@ -289,14 +321,14 @@ void ParserAdapter::handleOrderQueue(WTSOrdQueData* ordQueData)
 	if (_stopped)
 		return;
 
-	if (!_exchg_filter.empty() && (_exchg_filter.find(ordQueData->exchg()) == _exchg_filter.end()))
-		return;
-
 	if (ordQueData->actiondate() == 0 || ordQueData->tradingdate() == 0)
 		return;
 
-	WTSContractInfo* cInfo = _bd_mgr->getContract(ordQueData->code(), ordQueData->exchg());
+	//解析器已经带了合约信息的,就不用再查一次了
+	WTSContractInfo* cInfo = ordQueData->getContractInfo();
 	if (cInfo == NULL)
+		cInfo = _bd_mgr->getContract(ordQueData->code(), ordQueData->exchg());
+	if (cInfo == NULL || !is_subscribed(cInfo))
 		return;
 
 	ordQueData->setCode(cInfo->getFullCode());
@@ -310,14 +342,14 @@ void ParserAdapter::handleOrderDetail(WTSOrdDtlData* ordDtlData)
 	if (_stopped)
 		return;
 
-	if (!_exchg_filter.empty() && (_exchg_filter.find(ordDtlData->exchg()) == _exchg_filter.end()))
-		return;
-
 	if (ordDtlData->actiondate() == 0 || ordDtlData->tradingdate() == 0)
 		return;
 
-	WTSContractInfo* cInfo = _bd_mgr->getContract(ordDtlData->code(), ordDtlData->exchg());
+	//解析器已经带了合约信息的,就不用再查一次了
+	WTSContractInfo* cInfo = ordDtlData->getContractInfo();
 	if (cInfo == NULL)
+		cInfo = _bd_mgr->getContract(ordDtlData->code(), ordDtlData->exchg());
+	if (cInfo == NULL || !is_subscribed(cInfo))
 		return;
 
 	ordDtlData->setCode(cInfo->getFullCode());
@@ -331,14 +363,14 @@ void ParserAdapter::handleTransaction(WTSTransData* transData)
 	if (_stopped)
 		return;
 
-	if (!_exchg_filter.empty() && (_exchg_filter.find(transData->exchg()) == _exchg_filter.end()))
-		return;
-
 	if (transData->actiondate() == 0 || transData->tradingdate() == 0)
 		return;
 
-	WTSContractInfo* cInfo = _bd_mgr->getContract(transData->code(), transData->exchg());
+	//解析器已经带了合约信息的,就不用再查一次了
+	WTSContractInfo* cInfo = transData->getContractInfo();
 	if (cInfo == NULL)
+		cInfo = _bd_mgr->getContract(transData->code(), transData->exchg());
+	if (cInfo == NULL || !is_subscribed(cInfo))
 		return;
 
 	transData->setCode(cInfo->getFullCode());
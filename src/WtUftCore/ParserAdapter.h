@@ -13,10 +13,12 @@
 
 #include "../Includes/FasterDefs.h"
 #include "../Includes/IParserApi.h"
+#include "../Share/WtSubBitset.hpp"
 
 
 NS_WTP_BEGIN
 class WTSVariant;
+class WTSContractInfo;
 
 class IParserStub
 {
@@ -77,6 +79,15 @@ public:
 
 	virtual IBaseDataMgr* getBaseDataMgr() override { return _bd_mgr; }
 
+private:
+	/*
+	 *	合约是否在订阅范围内
+	 *	初始化的时候按合约全局索引把订阅的合约设置到位图里,每笔数据只需要测试一位
+	 *	位图里没有的,是初始化以后才加载的合约,再按合约、品种或者交易所过滤器判断,符合的补到位图里
+	 */
+	bool	is_subscribed(WTSContractInfo* cInfo) const;
+
+	void	add_sub_bit(WTSContractInfo* cInfo);
 
 private:
 	IParserApi*			_parser_api;
@@ -87,6 +98,8 @@ private:
 	typedef wt_hashset<std::string>	ExchgFilter;
 	ExchgFilter			_exchg_filter;
 	ExchgFilter			_code_filter;
+	bool				_sub_filtered;	//是否配置了过滤器,没有配置则全部接收
+	mutable WtSubBitset	_sub_bits;		//订阅的合约,按合约全局索引
 	IBaseDataMgr*		_bd_mgr;
 	IParserStub*		_stub;
 	WTSVariant*			_cfg;
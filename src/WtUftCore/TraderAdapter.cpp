@@ -27,6 +27,7 @@
 #include "../Share/decimal.h"
 #include "../Share/DLLHelper.hpp"
 #include "../Share/StrUtil.hpp"
+#include "../Share/WtTickTrace.hpp"
 
 #include <exception>
 #include <rapidjson/document.h>
@@ -159,6 +160,8 @@ bool TraderAdapter::init(const char* id, WTSVariant* params, IBaseDataMgr* bdMgr
 		WTSLogger::log_dyn("trader", _id.c_str(), LL_WARN, "[{}] No risk control rule setup of trading channel", _id.c_str());
 	}
 
+	initPreTrade(params->get("pretrade"));
+
 	if (params->getString("module").empty())
 		return false;
 
@@ -222,6 +225,9 @@ bool TraderAdapter::run()
 
 void TraderAdapter::release()
 {
+	if (_pretrade.is_active() && _pretrade.latency().count() > 0)
+		WTSLogger::log_dyn("trader", _id.c_str(), LL_INFO, "[{}] Latency of pre-trade risk checks(ns): {}", _id.c_str(), _pretrade.latency().summary());
+
 	if (_trader_api)
 	{
 		_trader_api->registerSpi(NULL);
@@ -313,6 +319,30 @@ uint32_t TraderAdapter::doEntrust(WTSEntrust* entrust)
 	_trader_api->makeEntrustID(entrust->getEntrustID(), 64);
 
 	const char* stdCode = entrust->getCode();
+
+	//事前风控检查,要在代码被拆分之前执行
+	//找不到合约的不做事前风控,也不登记挂单,免得记到别的代码的槽位上
+	uint32_t ptIdx = UINT_MAX;
+	bool isBuy = (entrust->getDirection() == WDT_LONG && entrust->getOffsetType() == WOT_OPEN) || (entrust->getDirection() == WDT_SHORT && entrust->getOffsetType() != WOT_OPEN);
+	WT_TRACE_STAMP_CUR(TTS_RISK_CHECK);
+	if (_pretrade.is_active())
+	{
+		WTSContractInfo* cInfo = entrust->getContractInfo();
+		if (cInfo == NULL) cInfo = getContract(stdCode);
+
+		if (cInfo != NULL)
+		{
+			ptIdx = getPreTradeSlot(stdCode, cInfo);
+			PreTradeResult ptRet = _pretrade.check(ptIdx, isBuy, entrust->getPrice(), entrust->getVolume(), TimeUtils::getLocalTimeNow());
+			if (ptRet != PTR_PASS)
+			{
+				WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] Order of {} rejected by pre-trade risk control: {}",
+					_id.c_str(), stdCode, WtPreTradeRisk::result_name(ptRet));
+				return UINT_MAX;
+			}
+		}
+	}
+
 	std::size_t pos = StrUtil::findFirst(entrust->getCode(), '.');
 	entrust->setExchange(stdCode, pos);
 	entrust->setCode(stdCode + pos + 1);
@@ -328,7 +358,9 @@ uint32_t TraderAdapter::doEntrust(WTSEntrust* entrust)
 	usertag[_order_pattern.size()] = '.';
 	fmtutil::format_to(usertag + _order_pattern.size() + 1, "{}", localid);
 	
+	WT_TRACE_STAMP_CUR(TTS_API_SEND);
 	int32_t ret = _trader_api->orderInsert(entrust);
+	WT_TRACE_STAMP_CUR(TTS_API_RETURN);
 	if(ret < 0)
 	{
 		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] Order placing failed: {}", _id, ret);
@@ -336,9 +368,12 @@ uint32_t TraderAdapter::doEntrust(WTSEntrust* entrust)
 	}
 	//else if(_risk_mon_enabled)
 	//{
-	//	int64_t now = TimeUtils::getLocalTimeNow();
-	//	_order_time_cache[entrust->getCode()].emplace_back(now);
+	//	getRiskSlot(entrust->getCode())->_order_limiter.record(TimeUtils::getLocalTimeNow());
 	//}
+	else if (ptIdx != UINT_MAX)
+	{
+		_pretrade.on_entrust(ptIdx, localid, isBuy, entrust->getPrice(), entrust->getVolume(), TimeUtils::getLocalTimeNow());
+	}
 	return localid;
 }
 
@@ -389,7 +424,7 @@ bool TraderAdapter::cancel(uint32_t localid)
 	bool bRet = doCancel(ordInfo);
 
 	//if(_risk_mon_enabled)
-	//	_cancel_time_cache[ordInfo->getCode()].emplace_back(TimeUtils::getLocalTimeNow());
+	//	getRiskSlot(ordInfo->getCode())->_cancel_limiter.record(TimeUtils::getLocalTimeNow());
 
 	ordInfo->release();
 
@@ -417,7 +452,7 @@ OrderIDs TraderAdapter::cancelAll(const char* stdCode)
 				{
 					ret.emplace_back(it->first);
 					//if (_risk_mon_enabled)
-					//	_cancel_time_cache[cInfo->getCode()].emplace_back(TimeUtils::getLocalTimeNow());
+					//	getRiskSlot(cInfo->getCode())->_cancel_limiter.record(TimeUtils::getLocalTimeNow());
 				}
 			}
 		}
@@ -1179,6 +1214,13 @@ void TraderAdapter::onRspEntrust(WTSEntrust* entrust, WTSError *err)
 		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, 
 			"[{}] Order placing failed: {}, instrument: {}, action: {}, qty: {}", _id.c_str(), err->getMessage(), entrust->getCode(), action.c_str(), qty);
 
+		//下单失败的订单要从事前风控的挂单里释放,重复通知的时候已经找不到这笔订单,不会重复扣减
+		if (_pretrade.is_active() && strlen(entrust->getUserTag()) > 0)
+		{
+			uint32_t localid = strtoul(entrust->getUserTag() + _order_pattern.size() + 1, NULL, 10);
+			_pretrade.on_order(getPreTradeSlot(stdCode.c_str(), cInfo), localid, 0);
+		}
+
 		//如果下单失败, 要更新未完成数量
 		//实盘中发现错误单有时候会推送两次
 		//所以这里加一个检查未完成单的逻辑
@@ -1250,6 +1292,14 @@ void TraderAdapter::onRspPosition(const WTSArray* ayPositions)
 			const char* stdCode = it->first.c_str();
 			const PosItem& pItem = it->second;
 			printPosition(stdCode, pItem);
+
+			if (_pretrade.is_active())
+			{
+				WTSContractInfo* cInfo = getContract(stdCode);
+				if (cInfo != NULL)
+					_pretrade.on_position(getPreTradeSlot(stdCode, cInfo), pItem.total_pos(true) - pItem.total_pos(false));
+			}
+
 			for (auto sink : _sinks)
 			{
 				sink->on_position(stdCode, true, pItem.l_prevol, pItem.l_preavail, pItem.l_newvol, pItem.l_newavail, _trading_day);
@@ -1724,6 +1774,9 @@ void TraderAdapter::onPushOrder(WTSOrderInfo* orderInfo)
 		else
 			offset = 2;
 
+		if (_pretrade.is_active())
+			_pretrade.on_order(getPreTradeSlot(stdCode.c_str(), cInfo), localid, orderInfo->isAlive() ? orderInfo->getVolLeft() : 0);
+
 		//通知所有监听接口
 		for (auto sink : _sinks)
 			sink->on_order(localid, stdCode.c_str(), orderInfo->getDirection()==WDT_LONG, offset, 
@@ -1821,6 +1874,8 @@ void TraderAdapter::onPushTrade(WTSTradeInfo* tradeRecord)
 
 	printPosition(stdCode.c_str(), pItem);
 
+	if (_pretrade.is_active())
+		_pretrade.on_trade(getPreTradeSlot(stdCode.c_str(), cInfo), isBuy, vol, tradeRecord->getPrice());
 
 	uint32_t offset;
 	if (tradeRecord->getOffsetType() == WOT_OPEN)
@@ -1853,50 +1908,36 @@ void TraderAdapter::handleTraderLog(WTSLogLevel ll, const char* message)
 
 bool TraderAdapter::checkCancelLimits(const char* stdCode)
 {
-	if (_exclude_codes.find(stdCode) != _exclude_codes.end())
+	CodeRiskSlot* slot = getRiskSlot(stdCode);
+	if (slot->_excluded)
 		return false;
 
-	const RiskParams* riskPara = getRiskParams(stdCode);
+	const RiskParams* riskPara = slot->_params;
 	if (riskPara == NULL)
 		return true;
 
-	WTSTradeStateInfo* statInfo = (WTSTradeStateInfo*)_stat_map->get(stdCode);
+	if (slot->_stat == NULL)
+		slot->_stat = (WTSTradeStateInfo*)_stat_map->get(stdCode);
+
+	WTSTradeStateInfo* statInfo = slot->_stat;
 	if (statInfo && riskPara->_cancel_total_limits != 0 && statInfo->total_cancels() >= riskPara->_cancel_total_limits)
 	{
-		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} cancel {} times totaly, beyond boundary {} times, adding to excluding list",
+		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} cancel {} times totally, beyond boundary {} times, adding to excluding list",
 			_id.c_str(), stdCode, statInfo->total_cancels(), riskPara->_cancel_total_limits);
 		_exclude_codes.insert(stdCode);
+		slot->_excluded = true;
 		return false;
 	}
 
-	//撤单频率检查
-	auto it = _cancel_time_cache.find(stdCode);
-	if (it != _cancel_time_cache.end())
+	//撤单频率检查,环形缓冲区里最早的一笔还在时间窗口内,就说明超限了
+	const WtRateLimiter& limiter = slot->_cancel_limiter;
+	if (limiter.exceeded())
 	{
-		TimeCacheList& cache = (TimeCacheList&)it->second;
-		uint32_t cnt = cache.size();
-		if (cnt >= riskPara->_cancel_times_boundary)
-		{
-			uint64_t eTime = cache[cnt - 1];
-			uint64_t sTime = eTime - riskPara->_cancel_stat_timespan * 1000;
-			auto tit = std::lower_bound(cache.begin(), cache.end(), sTime);
-			auto sIdx = tit - cache.begin();
-			auto times = cnt - sIdx - 1;
-			if (times > riskPara->_cancel_times_boundary)
-			{
-				WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} cancel {} times within {} seconds, beyond boundary {} times, adding to excluding list",
-					_id.c_str(), stdCode, times, riskPara->_cancel_stat_timespan, riskPara->_cancel_times_boundary);
-				_exclude_codes.insert(stdCode);
-				return false;
-			}
-
-			//这里必须要清理一下, 没有特别好的办法
-			//不然随着时间推移, vector长度会越来越长
-			if (tit != cache.begin())
-			{
-				cache.erase(cache.begin(), tit);
-			}
-		}
+		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} cancel {} times within {} seconds, beyond boundary {} times, adding to excluding list",
+			_id.c_str(), stdCode, limiter.times(), riskPara->_cancel_stat_timespan, riskPara->_cancel_times_boundary);
+		_exclude_codes.insert(stdCode);
+		slot->_excluded = true;
+		return false;
 	}
 
 	return true;
@@ -1915,50 +1956,36 @@ bool TraderAdapter::isTradeEnabled(const char* stdCode) const
 
 bool TraderAdapter::checkOrderLimits(const char* stdCode)
 {
-	if (_exclude_codes.find(stdCode) != _exclude_codes.end())
+	CodeRiskSlot* slot = getRiskSlot(stdCode);
+	if (slot->_excluded)
 		return false;
 
-	const RiskParams* riskPara = getRiskParams(stdCode);
+	const RiskParams* riskPara = slot->_params;
 	if (riskPara == NULL)
 		return true;
 
-	WTSTradeStateInfo* statInfo = (WTSTradeStateInfo*)_stat_map->get(stdCode);
+	if (slot->_stat == NULL)
+		slot->_stat = (WTSTradeStateInfo*)_stat_map->get(stdCode);
+
+	WTSTradeStateInfo* statInfo = slot->_stat;
 	if (statInfo && riskPara->_order_total_limits != 0 && statInfo->total_orders() >= riskPara->_order_total_limits)
 	{
 		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} entrust {} times totally, beyond boundary {} times, adding to excluding list",
 			_id.c_str(), stdCode, statInfo->total_orders(), riskPara->_order_total_limits);
 		_exclude_codes.insert(stdCode);
+		slot->_excluded = true;
 		return false;
 	}
 
-	//撤单频率检查
-	auto it = _order_time_cache.find(stdCode);
-	if (it != _order_time_cache.end())
+	//下单频率检查,环形缓冲区里最早的一笔还在时间窗口内,就说明超限了
+	const WtRateLimiter& limiter = slot->_order_limiter;
+	if (limiter.exceeded())
 	{
-		TimeCacheList& cache = (TimeCacheList&)it->second;
-		uint32_t cnt = cache.size();
-		if (cnt >= riskPara->_order_times_boundary)
-		{
-			uint64_t eTime = cache[cnt - 1];
-			uint64_t sTime = eTime - riskPara->_order_stat_timespan * 1000;
-			auto tit = std::lower_bound(cache.begin(), cache.end(), sTime);
-			auto sIdx = tit - cache.begin();
-			auto times = cnt - sIdx - 1;
-			if (times > riskPara->_order_times_boundary)
-			{
-				WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} entrust {} times within {} seconds, beyond boundary {} times, adding to excluding list",
-					_id.c_str(), stdCode, times, riskPara->_order_stat_timespan, riskPara->_order_times_boundary);
-				_exclude_codes.insert(stdCode);
-				return false;
-			}
-
-			//这里必须要清理一下, 没有特别好的办法
-			//不然随着时间推移, vector长度会越来越长
-			if (tit != cache.begin())
-			{
-				cache.erase(cache.begin(), tit);
-			}
-		}
+		WTSLogger::log_dyn("trader", _id.c_str(), LL_ERROR, "[{}] {} entrust {} times within {} seconds, beyond boundary {} times, adding to excluding list",
+			_id.c_str(), stdCode, limiter.times(), riskPara->_order_stat_timespan, riskPara->_order_times_boundary);
+		_exclude_codes.insert(stdCode);
+		slot->_excluded = true;
+		return false;
 	}
 
 	return true;
@@ -1977,7 +2004,61 @@ const TraderAdapter::RiskParams* TraderAdapter::getRiskParams(const char* stdCod
 		return &it->second;
 
 	it = _risk_params_map.find("default");
-	return &it->second;
+	if (it != _risk_params_map.end())
+		return &it->second;
+
+	return NULL;
+}
+
+TraderAdapter::CodeRiskSlot* TraderAdapter::getRiskSlot(const char* stdCode)
+{
+	auto it = _risk_slots.find(stdCode);
+	if (it != _risk_slots.end())
+		return &it->second;
+
+	CodeRiskSlot& slot = _risk_slots[stdCode];
+	slot._params = getRiskParams(stdCode);
+	if (slot._params != NULL)
+	{
+		slot._order_limiter.init(slot._params->_order_times_boundary, slot._params->_order_stat_timespan * 1000);
+		slot._cancel_limiter.init(slot._params->_cancel_times_boundary, slot._params->_cancel_stat_timespan * 1000);
+	}
+	slot._excluded = (_exclude_codes.find(stdCode) != _exclude_codes.end());
+	return &slot;
+}
+
+void TraderAdapter::initPreTrade(WTSVariant* cfg)
+{
+	if (cfg == NULL || !cfg->getBoolean("active"))
+		return;
+
+	_pretrade.set_active(true);
+	_pretrade.set_account_limits(cfg->getDouble("max_working_notional"), cfg->getUInt32("order_times_boundary"), cfg->getUInt32("order_stat_timespan") * 1000);
+
+	WTSVariant* cfgRules = cfg->get("rules");
+	if (cfgRules)
+	{
+		auto keys = cfgRules->memberNames();
+		for (const std::string& key : keys)
+		{
+			WTSVariant* cfgItem = cfgRules->get(key.c_str());
+			PreTradeLimits limits;
+			limits._max_order_qty = cfgItem->getDouble("max_order_qty");
+			limits._max_order_notional = cfgItem->getDouble("max_order_notional");
+			limits._max_net_pos = cfgItem->getDouble("max_net_pos");
+			limits._price_band = cfgItem->getDouble("price_band");
+			limits._check_selfmatch = cfgItem->getBoolean("check_selfmatch");
+			_pretrade.add_limits(key.c_str(), limits);
+		}
+	}
+
+	WTSLogger::log_dyn("trader", _id.c_str(), LL_INFO, "[{}] Pre-trade risk control of trading channel activated", _id.c_str());
+}
+
+uint32_t TraderAdapter::getPreTradeSlot(const char* stdCode, WTSContractInfo* cInfo)
+{
+	WTSCommodityInfo* commInfo = cInfo->getCommInfo();
+	return _pretrade.slot_of(stdCode, commInfo->getFullPid(), commInfo->getVolScale());
 }
 
 #pragma endregion "ITraderSpi接口"
@@ -15,11 +15,14 @@
 #include "../Share/StdUtils.hpp"
 #include "../Includes/WTSCollection.hpp"
 #include "../Share/SpinMutex.hpp"
+#include "../Share/WtRateLimiter.hpp"
+#include "../Share/WtPreTradeRisk.hpp"
 
 NS_WTP_BEGIN
 class WTSVariant;
 class WTSContractInfo;
 class WTSCommodityInfo;
+class WTSTradeStateInfo;
 class ITrdNotifySink;
 class ActionPolicyMgr;
 
@@ -127,6 +130,27 @@ private:
 
 	const RiskParams* getRiskParams(const char* stdCode);
 
+	typedef struct _CodeRiskSlot
+	{
+		const RiskParams*	_params;		//风控参数,第一次访问时确定,后面不再查找
+		WTSTradeStateInfo*	_stat;			//交易统计,由_stat_map持有
+		WtRateLimiter		_order_limiter;	//下单流控
+		WtRateLimiter		_cancel_limiter;//撤单流控
+		bool				_excluded;		//是否已被风控排除
+
+		_CodeRiskSlot() :_params(NULL), _stat(NULL), _excluded(false) {}
+	} CodeRiskSlot;
+
+	/*
+	 *	获取代码对应的风控槽位
+	 *	一次hash查找拿到风控参数、统计数据和流控器
+	 */
+	CodeRiskSlot* getRiskSlot(const char* stdCode);
+
+	void	initPreTrade(WTSVariant* cfg);
+
+	inline uint32_t	getPreTradeSlot(const char* stdCode, WTSContractInfo* cInfo);
+
 public:
 	double	getPosition(const char* stdCode, bool bValidOnly, int32_t flag = 3);
 	double	enumPosition(const char* stdCode = "");
@@ -195,6 +219,11 @@ public:
 	bool	checkCancelLimits(const char* stdCode);
 	bool	checkOrderLimits(const char* stdCode);
 
+	/*
+	 *	事前风控检查耗时的统计
+	 */
+	inline const WtLatencyHistogram& getPreTradeLatency() const { return _pretrade.latency(); }
+
 public:
 	//////////////////////////////////////////////////////////////////////////
 	//ITraderSpi接口
@@ -251,11 +280,9 @@ private:
 	typedef WTSHashMap<std::string>	TradeStatMap;
 	TradeStatMap*	_stat_map;	//统计数据
 
-	//这两个缓存时间内的容器,主要是为了控制瞬间流量而设置的
-	typedef std::vector<uint64_t> TimeCacheList;
-	typedef wt_hashmap<std::string, TimeCacheList> CodeTimeCacheMap;
-	CodeTimeCacheMap	_order_time_cache;	//下单时间缓存
-	CodeTimeCacheMap	_cancel_time_cache;	//撤单时间缓存
+	//每个代码的风控槽位,主要是为了控制瞬间流量而设置的
+	typedef wt_hashmap<std::string, CodeRiskSlot> CodeRiskSlotMap;
+	CodeRiskSlotMap		_risk_slots;
 
 	//如果被风控了,就会进入到排除队列
 	wt_hashset<std::string>	_exclude_codes;
@@ -263,6 +290,8 @@ private:
 	typedef wt_hashmap<std::string, RiskParams>	RiskParamsMap;
 	RiskParamsMap	_risk_params_map;
 	bool			_risk_mon_enabled;
+
+	WtPreTradeRisk	_pretrade;		//事前风控
 };
 
 typedef std::shared_ptr<TraderAdapter>					TraderAdapterPtr;
@@ -21,6 +21,7 @@
 
 #include "../Share/decimal.h"
 #include "../Share/TimeUtils.hpp"
+#include "../Share/WtTickTrace.hpp"
 
 #include "../WTSTools/WTSLogger.h"
 #include "../WTSUtils/WTSCfgLoader.h"
@@ -88,7 +89,11 @@ void UftStraContext::on_tick(const char* stdCode, WTSTickData* newTick)
 	}
 
 	if (_strategy)
+	{
+		WT_TRACE_ENTER(newTick);
 		_strategy->on_tick(this, stdCode, newTick);
+		WT_TRACE_LEAVE();
+	}
 }
 
 void UftStraContext::on_order_queue(const char* stdCode, WTSOrdQueData* newOrdQue)
@@ -18,6 +18,7 @@
 #include "../Share/decimal.h"
 #include "../Share/StrUtil.hpp"
 #include "../Share/TimeUtils.hpp"
+#include "../Share/WtTickTrace.hpp"
 
 #include "../Includes/WTSVariant.hpp"
 #include "../Includes/IBaseDataMgr.h"
@@ -323,11 +324,17 @@ void WtUftEngine::on_session_end()
 		ctx->on_session_end(_cur_tdate);
 	}
 
+#ifdef WT_TICK_TRACE
+	WTSLogger::log_raw(LL_INFO, TickTracer::dump(true).c_str());
+#endif
+
 	WTSLogger::info("Trading day {} ended", _cur_tdate);
 }
 
 void WtUftEngine::on_tick(const char* stdCode, WTSTickData* curTick)
 {
+	WT_TRACE_STAMP(curTick, TTS_ENGINE_DISPATCH);
+
 	if(_data_mgr)
 		_data_mgr->handle_push_quote(stdCode, curTick);
 